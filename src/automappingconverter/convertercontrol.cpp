@@ -28,8 +28,10 @@
 #include "mapreader.h"
 #include "mapwriter.h"
 
+#include <QCoreApplication>
 #include <QDebug>
 #include <QSettings>
+#include <QThread>
 
 using namespace Tiled;
 
@@ -37,22 +39,57 @@ ConverterControl::ConverterControl()
 {
 }
 
-QString ConverterControl::automappingRuleFileVersion(const QString &fileName)
+static bool isGuiThread()
 {
+    return QThread::currentThread() == QCoreApplication::instance()->thread();
+}
+
+/**
+ * Returns whether writing the \a map needs the images of its tiles or image
+ * layers. This is the case for embedded image collections, since their tile
+ * sizes and embedded images are written.
+ */
+static bool needsImages(const Tiled::Map *map)
+{
+    foreach (const Tiled::Tileset *tileset, map->tilesets()) {
+        if (tileset->fileName().isEmpty() && tileset->imageSource().isEmpty()
+                && tileset->tileCount() > 0)
+            return true;
+    }
+    foreach (const Tiled::Layer *layer, map->layers())
+        if (layer->isImageLayer())
+            return true;
+    return false;
+}
+
+static void deleteMap(Tiled::Map *map)
+{
+    qDeleteAll(map->tilesets());
+    delete map;
+}
+
+QString ConverterControl::automappingRuleFileVersion(const QString &fileName) const
+{
+    // The images are not needed for looking at the layer names, and can't
+    // be loaded on a worker thread anyway
     Tiled::MapReader reader;
+    reader.setDeferredImageLoading(true);
     Tiled::Map *map = reader.readMap(fileName);
 
     if (!map)
         return versionNotAMap();
 
+
     // version 1 check
     bool hasonlyruleprefix = true;
     foreach (Tiled::Layer *layer, map->layers()) {
         if (!layer->name().startsWith("rule", Qt::CaseInsensitive))
             hasonlyruleprefix = false;
     }
-    if (hasonlyruleprefix)
+    if (hasonlyruleprefix) {
+        deleteMap(map);
         return version1();
+    }
 
     // version 2 check
     bool hasrule = false;
@@ -77,21 +114,34 @@ QString ConverterControl::automappingRuleFileVersion(const QString &fileName)
         if (isunused)
             allused = false;
     }
+    deleteMap(map);
+
     if (allused && hasoutput && hasregion && hasrule)
         return version2();
 
     return versionUnknown();
 }
 
-void ConverterControl::convertV1toV2(const QString &fileName)
+ConverterControl::ConversionResult
+ConverterControl::convertV1toV2(const QString &fileName, QString *error) const
 {
+    const bool guiThread = isGuiThread();
+
     Tiled::MapReader reader;
+    reader.setDeferredImageLoading(!guiThread);
     Tiled::Map *map = reader.readMap(fileName);
 
     if (!map) {
         qWarning() << "Error at conversion of " << fileName << ":\n"
                    << reader.errorString();
-        return;
+        if (error)
+            *error = reader.errorString();
+        return ConversionFailed;
+    }
+
+    if (!guiThread && needsImages(map)) {
+        deleteMap(map);
+        return NeedsGuiThread;
     }
 
     foreach (Tiled::Layer *layer, map->layers()) {
@@ -111,8 +161,14 @@ void ConverterControl::convertV1toV2(const QString &fileName)
     }
 
     Tiled::MapWriter writer;
-    writer.writeMap(map, fileName);
+    const bool written = writer.writeMap(map, fileName);
+    if (!written) {
+        qWarning() << "Error at conversion of " << fileName << ":\n"
+                   << writer.errorString();
+        if (error)
+            *error = writer.errorString();
+    }
 
-    qDeleteAll(map->tilesets());
-    delete map;
+    deleteMap(map);
+    return written ? Converted : ConversionFailed;
 }
@@ -25,9 +25,25 @@
 #include <QString>
 #include <QObject>
 
+/**
+ * Detects the version of automapping rule files and converts them. The
+ * functions can be called from multiple threads at the same time.
+ */
 class ConverterControl
 {
 public:
+    enum ConversionResult {
+        Converted,
+        ConversionFailed,
+
+        /**
+         * Returned when converting on a worker thread a map that can only
+         * be written once its images are loaded, which needs to happen on
+         * the GUI thread.
+         */
+        NeedsGuiThread
+    };
+
     ConverterControl();
 
     QString version1() const { return QObject::tr("v0.8 and before"); }
@@ -35,8 +51,9 @@ public:
     QString versionUnknown() const { return QObject::tr("unknown"); }
     QString versionNotAMap() const { return QObject::tr("not a map"); }
 
-    QString automappingRuleFileVersion(const QString &fileName);
-    void convertV1toV2(const QString &fileName);
+    QString automappingRuleFileVersion(const QString &fileName) const;
+    ConversionResult convertV1toV2(const QString &fileName,
+                                   QString *error = 0) const;
 };
 
 #endif // CONVERTERCONTROL_H
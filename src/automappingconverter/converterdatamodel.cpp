@@ -22,10 +22,60 @@
 #include "converterdatamodel.h"
 #include "convertercontrol.h"
 
+#include <QCoreApplication>
 #include <QDebug>
+#include <QRunnable>
+
+/**
+ * Detects the version of a single file or converts it, on a worker thread.
+ */
+class ConverterTask : public QRunnable
+{
+public:
+    enum Action {
+        DetectVersion,
+        Convert
+    };
+
+    ConverterTask(ConverterDataModel *model, const QString &fileName,
+                  Action action)
+        : mModel(model)
+        , mFileName(fileName)
+        , mAction(action)
+    {}
+
+    void run()
+    {
+        const ConverterControl *control = mModel->mControl;
+
+        if (mAction == DetectVersion) {
+            const QString version = control->automappingRuleFileVersion(mFileName);
+            QMetaObject::invokeMethod(mModel, "versionDetected",
+                                      Qt::QueuedConnection,
+                                      Q_ARG(QString, mFileName),
+                                      Q_ARG(QString, version));
+        } else {
+            QString error;
+            const int result = control->convertV1toV2(mFileName, &error);
+            QMetaObject::invokeMethod(mModel, "conversionFinished",
+                                      Qt::QueuedConnection,
+                                      Q_ARG(QString, mFileName),
+                                      Q_ARG(int, result),
+                                      Q_ARG(QString, error));
+        }
+    }
+
+private:
+    ConverterDataModel *mModel;
+    const QString mFileName;
+    const Action mAction;
+};
+
 
 ConverterDataModel::ConverterDataModel(ConverterControl *control, QObject *parent)
     : QAbstractListModel(parent)
+    , mPendingTasks(0)
+    , mFailureCount(0)
 {
     mControl = control;
 }
@@ -37,7 +87,7 @@ int ConverterDataModel::rowCount(const QModelIndex &parent) const
 
 int ConverterDataModel::columnCount(const QModelIndex &parent) const
 {
-    return parent.isValid() ? 0 : 2;
+    return parent.isValid() ? 0 : 3;
 }
 
 QVariant ConverterDataModel::data(const QModelIndex &index, int role) const
@@ -58,6 +108,8 @@ QVariant ConverterDataModel::data(const QModelIndex &index, int role) const
             return fileName;
         else if (columnIndex == 1)
             return mFileVersions[fileName];
+        else if (columnIndex == 2)
+            return mFileStatus[fileName];
         else
             return QVariant();
     }
@@ -77,6 +129,9 @@ QVariant ConverterDataModel::headerData(int section, Qt::Orientation orientation
         case 1:
             return tr("Version");
             break;
+        case 2:
+            return tr("Status");
+            break;
         }
     }
     return QAbstractListModel::headerData(section, orientation, role);
@@ -88,8 +143,12 @@ void ConverterDataModel::insertFileNames(const QStringList &fileNames)
     beginInsertRows(QModelIndex(), row, row + fileNames.count() - 1);
     mFileNames.append(fileNames);
     foreach (const QString &fileName, fileNames)
-         mFileVersions[fileName] = mControl->automappingRuleFileVersion(fileName);
+         mFileStatus[fileName] = tr("Reading...");
     endInsertRows();
+
+    foreach (const QString &fileName, fileNames)
+        startTask(new ConverterTask(this, fileName,
+                                    ConverterTask::DetectVersion));
 }
 
 void ConverterDataModel::updateVersions()
@@ -97,11 +156,72 @@ void ConverterDataModel::updateVersions()
     for (int i = 0; i < count(); ++i) {
         const QString fileName = mFileNames.at(i);
         const QString version = mFileVersions[fileName];
-        qWarning() << "processing" << fileName << "at version" << version;
         if (version == mControl->version1()) {
-            mControl->convertV1toV2(fileName);
-            mFileVersions[fileName] = mControl->version2();
+            qWarning() << "processing" << fileName << "at version" << version;
+            mFileStatus[fileName] = tr("Converting...");
+            startTask(new ConverterTask(this, fileName,
+                                        ConverterTask::Convert));
         }
     }
-    emit dataChanged(index(0), index(count()));
+    emit dataChanged(index(0, 0), index(count() - 1, columnCount() - 1));
+}
+
+void ConverterDataModel::waitForDone()
+{
+    while (isBusy()) {
+        mThreadPool.waitForDone();
+        QCoreApplication::sendPostedEvents(this, QEvent::MetaCall);
+    }
+}
+
+void ConverterDataModel::versionDetected(const QString &fileName,
+                                         const QString &version)
+{
+    mFileVersions[fileName] = version;
+    mFileStatus[fileName] = QString();
+    fileChanged(fileName);
+    taskFinished();
+}
+
+void ConverterDataModel::conversionFinished(const QString &fileName,
+                                            int result,
+                                            const QString &error)
+{
+    QString errorString = error;
+
+    // Maps whose images need to be loaded are converted here instead
+    if (result == ConverterControl::NeedsGuiThread)
+        result = mControl->convertV1toV2(fileName, &errorString);
+
+    if (result == ConverterControl::Converted) {
+        mFileVersions[fileName] = mControl->version2();
+        mFileStatus[fileName] = tr("Converted");
+    } else {
+        mFileStatus[fileName] = tr("Failed: %1").arg(errorString);
+        ++mFailureCount;
+    }
+
+    fileChanged(fileName);
+    taskFinished();
+}
+
+void ConverterDataModel::startTask(ConverterTask *task)
+{
+    if (mPendingTasks++ == 0)
+        emit busyChanged(true);
+
+    mThreadPool.start(task);
+}
+
+void ConverterDataModel::taskFinished()
+{
+    if (--mPendingTasks == 0)
+        emit busyChanged(false);
+}
+
+void ConverterDataModel::fileChanged(const QString &fileName)
+{
+    const int row = mFileNames.indexOf(fileName);
+    if (row != -1)
+        emit dataChanged(index(row, 0), index(row, columnCount() - 1));
 }
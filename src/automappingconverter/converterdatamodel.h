@@ -27,9 +27,16 @@
 #include <QMap>
 #include <QString>
 #include <QStringList>
+#include <QThreadPool>
 
 class ConverterControl;
+class ConverterTask;
 
+/**
+ * Lists the rule files with their versions and the result of their
+ * conversion. The files are read and converted on a thread pool, and their
+ * results are reported back to the model as they come in.
+ */
 class ConverterDataModel : public QAbstractListModel
 {
     Q_OBJECT
@@ -56,13 +63,51 @@ public:
     QString versionOfFile(const QString &fileName) const
     { return mFileVersions[fileName]; }
 
+    /**
+     * Returns the result of the last conversion of the given file, or the
+     * reason it was not converted.
+     */
+    QString statusOfFile(const QString &fileName) const
+    { return mFileStatus[fileName]; }
+
+    bool hasFailures() const { return mFailureCount > 0; }
+
+    /**
+     * Returns whether files are still being read or converted.
+     */
+    bool isBusy() const { return mPendingTasks > 0; }
+
+    /**
+     * Blocks until all files have been read or converted and their results
+     * have been reported to the model.
+     */
+    void waitForDone();
+
 public slots:
     void updateVersions();
 
+signals:
+    void busyChanged(bool busy);
+
+private slots:
+    void versionDetected(const QString &fileName, const QString &version);
+    void conversionFinished(const QString &fileName, int result,
+                            const QString &error);
+
 private:
+    friend class ConverterTask;
+
+    void startTask(ConverterTask *task);
+    void taskFinished();
+    void fileChanged(const QString &fileName);
+
     ConverterControl *mControl;
     QList<QString> mFileNames;
     QMap<QString, QString> mFileVersions;
+    QMap<QString, QString> mFileStatus;
+    QThreadPool mThreadPool;
+    int mPendingTasks;
+    int mFailureCount;
 };
 
 #endif // CONVERTERDATAMODEL_H
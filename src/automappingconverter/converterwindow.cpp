@@ -38,6 +38,8 @@ ConverterWindow::ConverterWindow(QWidget *parent) :
     connect(ui->addbutton, SIGNAL(clicked()), this, SLOT(addRule()));
     connect(ui->saveButton, SIGNAL(clicked()),
             mDataModel, SLOT(updateVersions()));
+    connect(mDataModel, SIGNAL(busyChanged(bool)),
+            ui->saveButton, SLOT(setDisabled(bool)));
 
     ui->treeView->setModel(mDataModel);
 
@@ -54,6 +56,9 @@ ConverterWindow::ConverterWindow(QWidget *parent) :
 ConverterWindow::~ConverterWindow()
 {
     delete ui;
+
+    // Waits for the running conversions, which use the control
+    delete mDataModel;
     delete mControl;
 }
 
@@ -71,6 +76,7 @@ void ConverterWindow::addRule()
     if (fileNames.isEmpty())
         return;
 
-    mDataModel->insertFileNames(fileNames);
+    // Disabled again until the versions of the files are known
     ui->saveButton->setEnabled(true);
+    mDataModel->insertFileNames(fileNames);
 }
@@ -19,13 +19,64 @@
  * this program. If not, see <http://www.gnu.org/licenses/>.
  */
  
+#include "convertercontrol.h"
+#include "converterdatamodel.h"
 #include "converterwindow.h"
 
 #include <QApplication>
+#include <QTextStream>
+
+static void showHelp()
+{
+    QTextStream(stdout) <<
+            "Usage: automappingconverter [file...]\n\n"
+            "Without files, the converter window is opened. Otherwise the\n"
+            "given rule files are converted without opening a window.\n";
+}
+
+/**
+ * Converts the given rule files without showing the window, printing the
+ * result for each file. Returns the exit code.
+ */
+static int convertFiles(const QStringList &fileNames)
+{
+    ConverterControl control;
+    ConverterDataModel model(&control);
+
+    model.insertFileNames(fileNames);
+    model.waitForDone();
+
+    model.updateVersions();
+    model.waitForDone();
+
+    QTextStream out(stdout);
+    foreach (const QString &fileName, fileNames) {
+        out << fileName << ": " << model.versionOfFile(fileName);
+        const QString status = model.statusOfFile(fileName);
+        if (!status.isEmpty())
+            out << " (" << status << ")";
+        out << "\n";
+    }
+
+    return model.hasFailures() ? 1 : 0;
+}
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
+
+    QStringList fileNames = a.arguments();
+    fileNames.removeFirst();
+
+    if (fileNames.contains(QLatin1String("--help"))
+            || fileNames.contains(QLatin1String("-h"))) {
+        showHelp();
+        return 0;
+    }
+
+    if (!fileNames.isEmpty())
+        return convertFiles(fileNames);
+
     ConverterWindow w;
     w.show();
 
@@ -0,0 +1,247 @@
+/*
+ * collisionmerger.cpp
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "collisionmerger.h"
+
+#include "mapobject.h"
+#include "objectgroup.h"
+#include "tile.h"
+#include "tilelayer.h"
+#include "tileset.h"
+
+#include <QMap>
+#include <QPainterPath>
+#include <QTransform>
+#include <QVector>
+
+using namespace Tiled;
+
+namespace {
+
+/**
+ * The shapes of a single object type.
+ */
+struct CollisionShapes
+{
+    // Overlapping shapes need to add up rather than cancel out
+    CollisionShapes() { path.setFillRule(Qt::WindingFill); }
+
+    QVector<bool> fullCells;
+    QPainterPath path;
+};
+
+/**
+ * Returns the outline of a collision object, relative to its tile.
+ */
+QPolygonF objectOutline(const MapObject *object)
+{
+    QPolygonF outline;
+
+    switch (object->shape()) {
+    case MapObject::Rectangle:
+        outline = QPolygonF(QRectF(object->position(), object->size()));
+        break;
+    case MapObject::Polygon:
+        outline = object->polygon().translated(object->position());
+        break;
+    case MapObject::Ellipse: {
+        QPainterPath path;
+        path.addEllipse(QRectF(object->position(), object->size()));
+        outline = path.toFillPolygon();
+        break;
+    }
+    case MapObject::Polyline:
+        break;
+    }
+
+    if (object->rotation() != 0) {
+        const QPointF &origin = object->position();
+        QTransform transform;
+        transform.translate(origin.x(), origin.y());
+        transform.rotate(object->rotation());
+        transform.translate(-origin.x(), -origin.y());
+        outline = transform.map(outline);
+    }
+
+    return outline;
+}
+
+/**
+ * Returns the transformation from the coordinates of the tile in \a cell to
+ * those of the map, for a cell at \a cellRect.
+ */
+QTransform cellTransform(const Cell &cell, const QRectF &cellRect)
+{
+    const Tile *tile = cell.tile;
+    QSizeF size = tile->size();
+
+    QTransform transform;
+
+    if (cell.flippedAntiDiagonally) {
+        transform = QTransform(0, 1, 1, 0, 0, 0);
+        size.transpose();
+    }
+    if (cell.flippedHorizontally)
+        transform *= QTransform(-1, 0, 0, 1, size.width(), 0);
+    if (cell.flippedVertically)
+        transform *= QTransform(1, 0, 0, -1, 0, size.height());
+
+    // Tiles are aligned to the bottom-left corner of their cell
+    const QPointF offset = tile->tileset()->tileOffset();
+    transform *= QTransform::fromTranslate(
+                cellRect.left() + offset.x(),
+                cellRect.bottom() - size.height() + offset.y());
+
+    return transform;
+}
+
+/**
+ * Adds rectangle objects covering the cells in \a fullCells to \a objectGroup,
+ * extending each rectangle first horizontally and then vertically.
+ */
+void addGreedyRectangles(QVector<bool> &fullCells, int width, int height,
+                         const QSize &tileSize, const QString &type,
+                         ObjectGroup *objectGroup)
+{
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            if (!fullCells.at(x + y * width))
+                continue;
+
+            int right = x + 1;
+            while (right < width && fullCells.at(right + y * width))
+                ++right;
+
+            int bottom = y + 1;
+            for (; bottom < height; ++bottom) {
+                bool fullRow = true;
+                for (int i = x; i < right && fullRow; ++i)
+                    fullRow = fullCells.at(i + bottom * width);
+                if (!fullRow)
+                    break;
+            }
+
+            for (int j = y; j < bottom; ++j)
+                for (int i = x; i < right; ++i)
+                    fullCells[i + j * width] = false;
+
+            objectGroup->addObject(new MapObject(QString(), type,
+                                                 QPointF(x * tileSize.width(),
+                                                         y * tileSize.height()),
+                                                 QSizeF((right - x) * tileSize.width(),
+                                                        (bottom - y) * tileSize.height())));
+        }
+    }
+}
+
+/**
+ * Adds polygon objects for the area enclosed by \a path to \a objectGroup.
+ */
+void addPolygons(const QPainterPath &path, const QString &type,
+                 ObjectGroup *objectGroup)
+{
+    foreach (QPolygonF polygon, path.simplified().toFillPolygons()) {
+        // The fill polygons are closed, which objects are implicitly
+        if (polygon.size() > 1 && polygon.first() == polygon.last())
+            polygon.removeLast();
+        if (polygon.size() < 3)
+            continue;
+
+        const QPointF position = polygon.boundingRect().topLeft();
+
+        MapObject *object = new MapObject(QString(), type, position, QSizeF());
+        object->setShape(MapObject::Polygon);
+        object->setPolygon(polygon.translated(-position));
+        objectGroup->addObject(object);
+    }
+}
+
+} // anonymous namespace
+
+ObjectGroup *Tiled::mergeCollisionShapes(const TileLayer *layer,
+                                         const QSize &tileSize)
+{
+    const int width = layer->width();
+    const int height = layer->height();
+
+    QMap<QString, CollisionShapes> shapesByType;
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            const Cell &cell = layer->cellAt(x, y);
+            if (cell.isEmpty())
+                continue;
+
+            const ObjectGroup *collision = cell.tile->objectGroup();
+            if (!collision || collision->isEmpty())
+                continue;
+
+            const QRectF cellRect(x * tileSize.width(), y * tileSize.height(),
+                                  tileSize.width(), tileSize.height());
+            const QTransform transform = cellTransform(cell, cellRect);
+
+            foreach (const MapObject *object, collision->objects()) {
+                CollisionShapes &shapes = shapesByType[object->type()];
+
+                if (object->shape() == MapObject::Rectangle &&
+                        object->rotation() == 0) {
+                    const QRectF rect = transform.mapRect(object->bounds());
+                    if (rect == cellRect) {
+                        if (shapes.fullCells.isEmpty())
+                            shapes.fullCells.fill(false, width * height);
+                        shapes.fullCells[x + y * width] = true;
+                        continue;
+                    }
+                }
+
+                const QPolygonF outline = objectOutline(object);
+                if (outline.size() < 3)
+                    continue;
+
+                shapes.path.addPolygon(transform.map(outline));
+                shapes.path.closeSubpath();
+            }
+        }
+    }
+
+    ObjectGroup *objectGroup = new ObjectGroup(layer->name(), 0, 0,
+                                               width, height);
+
+    QMap<QString, CollisionShapes>::iterator it = shapesByType.begin();
+    for (; it != shapesByType.end(); ++it) {
+        CollisionShapes &shapes = it.value();
+
+        if (!shapes.fullCells.isEmpty())
+            addGreedyRectangles(shapes.fullCells, width, height, tileSize,
+                                it.key(), objectGroup);
+        if (!shapes.path.isEmpty())
+            addPolygons(shapes.path, it.key(), objectGroup);
+    }
+
+    return objectGroup;
+}
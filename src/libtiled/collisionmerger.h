@@ -0,0 +1,59 @@
+/*
+ * collisionmerger.h
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TILED_COLLISIONMERGER_H
+#define TILED_COLLISIONMERGER_H
+
+#include "tiled_global.h"
+
+#include <QSize>
+
+namespace Tiled {
+
+class ObjectGroup;
+class TileLayer;
+
+/**
+ * Combines the collision shapes of the tiles placed on an orthogonal
+ * \a layer into as few objects as possible, so that a game only needs to
+ * create a few large colliders instead of one for each placed tile.
+ *
+ * Rectangles covering a whole cell are merged into larger rectangles by
+ * greedy meshing. All other shapes are united into polygons. Shapes are only
+ * merged with shapes of the same object type, and polylines are left out
+ * since they don't enclose an area.
+ *
+ * Returns a new object group, owned by the caller, with the merged shapes in
+ * pixel coordinates.
+ */
+TILEDSHARED_EXPORT ObjectGroup *mergeCollisionShapes(const TileLayer *layer,
+                                                     const QSize &tileSize);
+
+} // namespace Tiled
+
+#endif // TILED_COLLISIONMERGER_H
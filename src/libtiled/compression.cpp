@@ -34,6 +34,14 @@
 #include <zlib.h>
 #endif
 
+#ifdef TILED_ZSTD_SUPPORT
+#include <zstd.h>
+#endif
+
+#ifdef TILED_LZ4_SUPPORT
+#include <lz4.h>
+#endif
+
 #include <QByteArray>
 #include <QDebug>
 
@@ -63,8 +71,226 @@ static void logZlibError(int error)
     }
 }
 
-QByteArray Tiled::decompress(const QByteArray &data, int expectedSize)
+bool Tiled::isCompressionMethodSupported(CompressionMethod method)
+{
+    switch (method) {
+    case Gzip:
+    case Zlib:
+        return true;
+    case Zstandard:
+#ifdef TILED_ZSTD_SUPPORT
+        return true;
+#else
+        return false;
+#endif
+    case Lz4:
+#ifdef TILED_LZ4_SUPPORT
+        return true;
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+#ifdef TILED_ZSTD_SUPPORT
+static QByteArray zstdDecompress(const QByteArray &data, int expectedSize)
+{
+    const unsigned long long contentSize =
+            ZSTD_getFrameContentSize(data.constData(), data.size());
+
+    if (contentSize == ZSTD_CONTENTSIZE_ERROR) {
+        qDebug() << "Incorrect Zstandard compressed data!";
+        return QByteArray();
+    }
+
+    // The size is stored unless the data was compressed as a stream. It comes
+    // from the data, so it may only lower the expected size, never raise it.
+    if (contentSize != ZSTD_CONTENTSIZE_UNKNOWN) {
+        if (contentSize > static_cast<unsigned long long>(qMax(expectedSize, 0))) {
+            qDebug() << "Zstandard compressed data is larger than expected!";
+            return QByteArray();
+        }
+        expectedSize = static_cast<int>(contentSize);
+    }
+
+    QByteArray out;
+    out.resize(qMax(expectedSize, 1024));
+
+    for (;;) {
+        const size_t size = ZSTD_decompress(out.data(), out.size(),
+                                            data.constData(), data.size());
+
+        if (!ZSTD_isError(size)) {
+            out.resize(size);
+            return out;
+        }
+
+        if (ZSTD_getErrorCode(size) != ZSTD_error_dstSize_tooSmall) {
+            qDebug() << "Error while decompressing Zstandard data:"
+                     << ZSTD_getErrorName(size);
+            return QByteArray();
+        }
+
+        out.resize(out.size() * 2);
+    }
+}
+
+static QByteArray zstdCompress(const QByteArray &data, int level)
+{
+    if (level == DefaultCompressionLevel)
+        level = ZSTD_CLEVEL_DEFAULT;
+
+    QByteArray out;
+    out.resize(ZSTD_compressBound(data.size()));
+
+    const size_t size = ZSTD_compress(out.data(), out.size(),
+                                      data.constData(), data.size(),
+                                      level);
+
+    if (ZSTD_isError(size)) {
+        qDebug() << "Error while compressing Zstandard data:"
+                 << ZSTD_getErrorName(size);
+        return QByteArray();
+    }
+
+    out.resize(size);
+    return out;
+}
+#endif // TILED_ZSTD_SUPPORT
+
+#ifdef TILED_LZ4_SUPPORT
+/**
+ * LZ4 blocks do not store their uncompressed size, so when the expected size
+ * turns out to be too small the buffer is grown until the data fits.
+ */
+static QByteArray lz4Decompress(const QByteArray &data, int expectedSize)
+{
+    QByteArray out;
+    out.resize(qMax(expectedSize, 1024));
+
+    for (;;) {
+        const int size = LZ4_decompress_safe(data.constData(), out.data(),
+                                             data.size(), out.size());
+        if (size >= 0) {
+            out.resize(size);
+            return out;
+        }
+
+        // A negative result is returned for both corrupt data and a too
+        // small buffer, so give up at the maximum possible ratio.
+        if (out.size() / 255 > data.size() + 1) {
+            qDebug() << "Incorrect LZ4 compressed data!";
+            return QByteArray();
+        }
+
+        out.resize(out.size() * 2);
+    }
+}
+
+static QByteArray lz4Compress(const QByteArray &data)
+{
+    QByteArray out;
+    out.resize(LZ4_compressBound(data.size()));
+
+    const int size = LZ4_compress_default(data.constData(), out.data(),
+                                          data.size(), out.size());
+    if (size <= 0 && !data.isEmpty()) {
+        qDebug() << "Error while compressing LZ4 data!";
+        return QByteArray();
+    }
+
+    out.resize(size);
+    return out;
+}
+#endif // TILED_LZ4_SUPPORT
+
+static int zlibStrategy(CompressionStrategy strategy)
+{
+    switch (strategy) {
+    case FilteredStrategy:      return Z_FILTERED;
+    case HuffmanOnlyStrategy:   return Z_HUFFMAN_ONLY;
+    case RleStrategy:           return Z_RLE;
+    case DefaultStrategy:       break;
+    }
+    return Z_DEFAULT_STRATEGY;
+}
+
+static int initDeflate(z_stream *strm, CompressionMethod method,
+                       int level, CompressionStrategy strategy)
+{
+    strm->zalloc = Z_NULL;
+    strm->zfree = Z_NULL;
+    strm->opaque = Z_NULL;
+
+    const int windowBits = (method == Gzip) ? 15 + 16 : 15;
+
+    return deflateInit2(strm, level, Z_DEFLATED, windowBits,
+                        8, zlibStrategy(strategy));
+}
+
+/**
+ * Compresses \a data using the initialized stream. The output buffer is
+ * allocated once based on deflateBound, though older zlib versions may not
+ * account for the gzip header, so it can still grow when needed.
+ */
+static QByteArray deflateData(z_stream *strm, const QByteArray &data)
+{
+    QByteArray out;
+    out.resize(deflateBound(strm, data.length()));
+
+    strm->next_in = (Bytef *) data.data();
+    strm->avail_in = data.length();
+    strm->next_out = (Bytef *) out.data();
+    strm->avail_out = out.size();
+
+    int err;
+
+    do {
+        err = deflate(strm, Z_FINISH);
+        Q_ASSERT(err != Z_STREAM_ERROR);
+
+        if (err == Z_OK || err == Z_BUF_ERROR) {
+            // More output space needed
+            int oldSize = out.size();
+            out.resize(out.size() * 2);
+
+            strm->next_out = (Bytef *)(out.data() + oldSize);
+            strm->avail_out = oldSize;
+            err = Z_OK;
+        }
+    } while (err == Z_OK);
+
+    if (err != Z_STREAM_END) {
+        logZlibError(err);
+        return QByteArray();
+    }
+
+    out.resize(out.size() - strm->avail_out);
+    return out;
+}
+
+QByteArray Tiled::decompress(const QByteArray &data, int expectedSize,
+                             CompressionMethod method)
 {
+    switch (method) {
+    case Gzip:
+    case Zlib:
+        break;
+    case Zstandard:
+#ifdef TILED_ZSTD_SUPPORT
+        return zstdDecompress(data, expectedSize);
+#else
+        return QByteArray();
+#endif
+    case Lz4:
+#ifdef TILED_LZ4_SUPPORT
+        return lz4Decompress(data, expectedSize);
+#else
+        return QByteArray();
+#endif
+    }
+
     QByteArray out;
     out.resize(expectedSize);
     z_stream strm;
@@ -96,19 +322,28 @@ QByteArray Tiled::decompress(const QByteArray &data, int expectedSize)
                 inflateEnd(&strm);
                 logZlibError(ret);
                 return QByteArray();
+            case Z_BUF_ERROR:
+                // No progress possible, the input data is truncated
+                if (strm.avail_out != 0) {
+                    inflateEnd(&strm);
+                    logZlibError(Z_DATA_ERROR);
+                    return QByteArray();
+                }
         }
 
-        if (ret != Z_STREAM_END) {
+        // Only grow when the expected size turned out to be too small
+        if (ret != Z_STREAM_END && strm.avail_out == 0) {
             int oldSize = out.size();
-            out.resize(out.size() * 2);
+            out.resize(qMax(oldSize * 2, 1024));
 
             strm.next_out = (Bytef *)(out.data() + oldSize);
-            strm.avail_out = oldSize;
+            strm.avail_out = out.size() - oldSize;
         }
     }
     while (ret != Z_STREAM_END);
 
     if (strm.avail_in != 0) {
+        inflateEnd(&strm);
         logZlibError(Z_DATA_ERROR);
         return QByteArray();
     }
@@ -120,52 +355,152 @@ QByteArray Tiled::decompress(const QByteArray &data, int expectedSize)
     return out;
 }
 
-QByteArray Tiled::compress(const QByteArray &data, CompressionMethod method)
+QByteArray Tiled::compress(const QByteArray &data, CompressionMethod method,
+                           int level, CompressionStrategy strategy)
 {
-    QByteArray out;
-    out.resize(1024);
-    int err;
-    z_stream strm;
-    strm.zalloc = Z_NULL;
-    strm.zfree = Z_NULL;
-    strm.opaque = Z_NULL;
-    strm.next_in = (Bytef *) data.data();
-    strm.avail_in = data.length();
-    strm.next_out = (Bytef *) out.data();
-    strm.avail_out = out.size();
+    switch (method) {
+    case Gzip:
+    case Zlib:
+        break;
+    case Zstandard:
+#ifdef TILED_ZSTD_SUPPORT
+        return zstdCompress(data, level);
+#else
+        return QByteArray();
+#endif
+    case Lz4:
+#ifdef TILED_LZ4_SUPPORT
+        return lz4Compress(data);
+#else
+        return QByteArray();
+#endif
+    }
 
-    const int windowBits = (method == Gzip) ? 15 + 16 : 15;
+    z_stream strm;
 
-    err = deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, windowBits,
-                       8, Z_DEFAULT_STRATEGY);
+    int err = initDeflate(&strm, method, level, strategy);
     if (err != Z_OK) {
         logZlibError(err);
         return QByteArray();
     }
 
-    do {
-        err = deflate(&strm, Z_FINISH);
-        Q_ASSERT(err != Z_STREAM_ERROR);
+    const QByteArray out = deflateData(&strm, data);
+    deflateEnd(&strm);
+    return out;
+}
 
-        if (err == Z_OK) {
-            // More output space needed
-            int oldSize = out.size();
-            out.resize(out.size() * 2);
 
-            strm.next_out = (Bytef *)(out.data() + oldSize);
-            strm.avail_out = oldSize;
-        }
-    } while (err == Z_OK);
+struct Compressor::Stream
+{
+    z_stream strm;
+};
 
-    if (err != Z_STREAM_END) {
+Compressor::Compressor(CompressionMethod method,
+                       int level,
+                       CompressionStrategy strategy)
+    : mStream(0)
+    , mInitialized(false)
+    , mMethod(method)
+    , mLevel(level)
+{
+    if (method != Gzip && method != Zlib)
+        return;
+
+    mStream = new Stream;
+
+    const int err = initDeflate(&mStream->strm, method, level, strategy);
+    mInitialized = err == Z_OK;
+    if (!mInitialized)
         logZlibError(err);
-        deflateEnd(&strm);
-        return QByteArray();
-    }
+}
 
-    const int outLength = out.size() - strm.avail_out;
-    deflateEnd(&strm);
+Compressor::~Compressor()
+{
+    if (mInitialized)
+        deflateEnd(&mStream->strm);
+    delete mStream;
+}
 
-    out.resize(outLength);
+QByteArray Compressor::compress(const QByteArray &data)
+{
+    if (!mStream)
+        return Tiled::compress(data, mMethod, mLevel);
+    if (!mInitialized)
+        return QByteArray();
+
+    const QByteArray out = deflateData(&mStream->strm, data);
+    deflateReset(&mStream->strm);
     return out;
 }
+
+
+struct Decompressor::Stream
+{
+    z_stream strm;
+};
+
+Decompressor::Decompressor()
+    : mStream(new Stream)
+    , mFinished(false)
+{
+    z_stream &strm = mStream->strm;
+    strm.zalloc = Z_NULL;
+    strm.zfree = Z_NULL;
+    strm.opaque = Z_NULL;
+    strm.next_in = Z_NULL;
+    strm.avail_in = 0;
+
+    const int err = inflateInit2(&strm, 15 + 32);
+    mInitialized = err == Z_OK;
+    if (!mInitialized)
+        logZlibError(err);
+}
+
+Decompressor::~Decompressor()
+{
+    if (mInitialized)
+        inflateEnd(&mStream->strm);
+    delete mStream;
+}
+
+void Decompressor::setInput(const char *data, int size)
+{
+    mStream->strm.next_in = (Bytef *) data;
+    mStream->strm.avail_in = size;
+}
+
+bool Decompressor::needsInput() const
+{
+    return mStream->strm.avail_in == 0;
+}
+
+int Decompressor::read(char *out, int maxSize)
+{
+    if (!mInitialized)
+        return -1;
+    if (mFinished)
+        return 0;
+
+    z_stream &strm = mStream->strm;
+    strm.next_out = (Bytef *) out;
+    strm.avail_out = maxSize;
+
+    int ret = inflate(&strm, Z_NO_FLUSH);
+
+    switch (ret) {
+    case Z_STREAM_END:
+        mFinished = true;
+        break;
+    case Z_OK:
+    case Z_BUF_ERROR:   // No progress possible without more input
+        break;
+    case Z_NEED_DICT:
+    case Z_STREAM_ERROR:
+        ret = Z_DATA_ERROR;
+    default:
+        logZlibError(ret);
+        return -1;
+    }
+
+    return maxSize - strm.avail_out;
+}
@@ -37,9 +37,36 @@ namespace Tiled {
 
 enum CompressionMethod {
     Gzip,
-    Zlib
+    Zlib,
+    Zstandard,
+    Lz4
 };
 
+/**
+ * Returns whether the given compression \a method is available. Gzip and
+ * zlib are always available, while Zstandard and LZ4 support depends on
+ * whether Tiled was compiled with ZSTD_SUPPORT or LZ4_SUPPORT.
+ */
+bool TILEDSHARED_EXPORT isCompressionMethodSupported(CompressionMethod method);
+
+/**
+ * The compression strategies supported by zlib. The strategy only affects
+ * the compression ratio and speed, not the validity of the output.
+ */
+enum CompressionStrategy {
+    DefaultStrategy,
+    FilteredStrategy,
+    HuffmanOnlyStrategy,
+    RleStrategy
+};
+
+/**
+ * Used to select the default compression level of the compression method.
+ * Other valid levels range from 0 (no compression) to 9 (best compression).
+ * The level is ignored for LZ4.
+ */
+const int DefaultCompressionLevel = -1;
+
 /**
  * Decompresses either zlib or gzip compressed memory. Returns a null
  * QByteArray if decompressing failed.
@@ -48,24 +75,106 @@ enum CompressionMethod {
  * this method does not need the expected size to be prepended to the data,
  * but it can be passed as optional parameter.
  *
+ * Zlib and gzip compressed data are detected automatically, but Zstandard
+ * and LZ4 compressed data needs the \a method to be specified.
+ *
  * @param data         the compressed data
  * @param expectedSize the expected size of the uncompressed data in bytes
+ * @param method       the compression method used for the data
  * @return the uncompressed data, or a null QByteArray if decompressing failed
  */
 QByteArray TILEDSHARED_EXPORT decompress(const QByteArray &data,
-                                         int expectedSize = 1024);
+                                         int expectedSize = 1024,
+                                         CompressionMethod method = Zlib);
 
 /**
- * Compresses the give data in either gzip or zlib format. Returns a null
- * QByteArray if compression failed.
+ * Compresses the give data in gzip, zlib, Zstandard or LZ4 format. Returns a
+ * null QByteArray if compression failed.
  *
  * Needed because qCompress does not support gzip compression.
  *
- * @param data the uncompressed data
+ * @param data     the uncompressed data
+ * @param level    the compression level, from 0 to 9 or
+ *                 DefaultCompressionLevel
+ * @param strategy the compression strategy
  * @return the compressed data, or a null QByteArray if compression failed
  */
 QByteArray TILEDSHARED_EXPORT compress(const QByteArray &data,
-                                       CompressionMethod method = Zlib);
+                                       CompressionMethod method = Zlib,
+                                       int level = DefaultCompressionLevel,
+                                       CompressionStrategy strategy = DefaultStrategy);
+
+/**
+ * Compresses multiple blocks of data using the same settings. For gzip and
+ * zlib, the stream is only set up once and reset between blocks, which
+ * avoids allocating the compression state again for each block.
+ */
+class TILEDSHARED_EXPORT Compressor
+{
+public:
+    Compressor(CompressionMethod method = Zlib,
+               int level = DefaultCompressionLevel,
+               CompressionStrategy strategy = DefaultStrategy);
+    ~Compressor();
+
+    /**
+     * Compresses the given data. Returns a null QByteArray if compression
+     * failed.
+     */
+    QByteArray compress(const QByteArray &data);
+
+private:
+    Q_DISABLE_COPY(Compressor)
+
+    struct Stream;
+    Stream *mStream;
+    bool mInitialized;
+
+    const CompressionMethod mMethod;
+    const int mLevel;
+};
+
+/**
+ * Decompresses zlib or gzip compressed data incrementally, which allows
+ * large data to be processed using small buffers.
+ */
+class TILEDSHARED_EXPORT Decompressor
+{
+public:
+    Decompressor();
+    ~Decompressor();
+
+    /**
+     * Sets the next block of compressed input. The data needs to remain
+     * valid until it has been consumed by read().
+     */
+    void setInput(const char *data, int size);
+
+    /**
+     * Returns whether all input passed to setInput() has been consumed.
+     */
+    bool needsInput() const;
+
+    /**
+     * Decompresses up to \a maxSize bytes into \a out. Returns the number
+     * of bytes written, which is 0 when more input is needed, or -1 when
+     * the data is corrupt.
+     */
+    int read(char *out, int maxSize);
+
+    /**
+     * Returns whether the end of the compressed stream has been reached.
+     */
+    bool isFinished() const { return mFinished; }
+
+private:
+    Q_DISABLE_COPY(Decompressor)
+
+    struct Stream;
+    Stream *mStream;
+    bool mInitialized;
+    bool mFinished;
+};
 
 } // namespace Tiled
 
@@ -31,6 +31,8 @@
 #include "tile.h"
 #include "tileset.h"
 
+#include <algorithm>
+
 using namespace Tiled;
 
 // Bits on the far end of the 32-bit global tile ID are used for tile flags
@@ -51,6 +53,45 @@ GidMapper::GidMapper(const QList<Tileset *> &tilesets)
     }
 }
 
+void GidMapper::insert(unsigned firstGid, Tileset *tileset)
+{
+    // Tilesets are usually inserted in order, so search from the back
+    int index = mFirstGids.size();
+    while (index > 0 && mFirstGids.at(index - 1) > firstGid)
+        --index;
+
+    const int columnCount = mTilesetColumnCounts.value(tileset);
+
+    if (index > 0 && mFirstGids.at(index - 1) == firstGid) {
+        // Replace the tileset using the same first gid
+        --index;
+        if (mTilesetFirstGids.value(mTilesets.at(index)) == firstGid)
+            mTilesetFirstGids.remove(mTilesets.at(index));
+        mTilesets[index] = tileset;
+        mColumnCounts[index] = columnCount;
+    } else {
+        mFirstGids.insert(index, firstGid);
+        mTilesets.insert(index, tileset);
+        mColumnCounts.insert(index, columnCount);
+    }
+
+    // When a tileset is used more than once, the lowest first gid is used
+    QHash<const Tileset*, unsigned>::iterator it = mTilesetFirstGids.find(tileset);
+    if (it == mTilesetFirstGids.end())
+        mTilesetFirstGids.insert(tileset, firstGid);
+    else if (it.value() > firstGid)
+        it.value() = firstGid;
+}
+
+void GidMapper::clear()
+{
+    mFirstGids.clear();
+    mTilesets.clear();
+    mColumnCounts.clear();
+    mTilesetFirstGids.clear();
+    mTilesetColumnCounts.clear();
+}
+
 Cell GidMapper::gidToCell(unsigned gid, bool &ok) const
 {
     Cell result;
@@ -67,17 +108,20 @@ Cell GidMapper::gidToCell(unsigned gid, bool &ok) const
 
     if (gid == 0) {
         ok = true;
-    } else if (isEmpty()) {
+    } else if (isEmpty() || gid < mFirstGids.first()) {
         ok = false;
     } else {
-        // Find the tileset containing this tile
-        QMap<unsigned, Tileset*>::const_iterator i = mFirstGidToTileset.upperBound(gid);
-        --i; // Navigate one tileset back since upper bound finds the next
-        int tileId = gid - i.key();
-        const Tileset *tileset = i.value();
+        // Find the tileset containing this tile. Upper bound finds the next
+        // tileset, so the one before it is the one containing this tile.
+        const unsigned *begin = mFirstGids.constData();
+        const unsigned *end = begin + mFirstGids.size();
+        const int index = std::upper_bound(begin, end, gid) - begin - 1;
+
+        int tileId = gid - mFirstGids.at(index);
+        const Tileset *tileset = mTilesets.at(index);
 
         if (tileset) {
-            const int columnCount = mTilesetColumnCounts.value(tileset);
+            const int columnCount = mColumnCounts.at(index);
             if (columnCount > 0 && columnCount != tileset->columnCount()) {
                 // Correct tile index for changes in image width
                 const int row = tileId / columnCount;
@@ -104,15 +148,13 @@ unsigned GidMapper::cellToGid(const Cell &cell) const
     const Tileset *tileset = cell.tile->tileset();
 
     // Find the first GID for the tileset
-    QMap<unsigned, Tileset*>::const_iterator i = mFirstGidToTileset.begin();
-    QMap<unsigned, Tileset*>::const_iterator i_end = mFirstGidToTileset.end();
-    while (i != i_end && i.value() != tileset)
-        ++i;
+    QHash<const Tileset*, unsigned>::const_iterator it =
+            mTilesetFirstGids.find(tileset);
 
-    if (i == i_end) // tileset not found
+    if (it == mTilesetFirstGids.end()) // tileset not found
         return 0;
 
-    unsigned gid = i.key() + cell.tile->id();
+    unsigned gid = it.value() + cell.tile->id();
     if (cell.flippedHorizontally)
         gid |= FlippedHorizontallyFlag;
     if (cell.flippedVertically)
@@ -128,5 +170,25 @@ void GidMapper::setTilesetWidth(const Tileset *tileset, int width)
     if (tileset->tileWidth() == 0)
         return;
 
-    mTilesetColumnCounts.insert(tileset, tileset->columnCountForWidth(width));
+    const int columnCount = tileset->columnCountForWidth(width);
+    mTilesetColumnCounts.insert(tileset, columnCount);
+
+    for (int i = 0, i_end = mTilesets.size(); i < i_end; ++i)
+        if (mTilesets.at(i) == tileset)
+            mColumnCounts[i] = columnCount;
+}
+
+bool GidMapper::hasSameGids(const GidMapper &other) const
+{
+    if (mFirstGids != other.mFirstGids || mTilesets != other.mTilesets)
+        return false;
+
+    for (int i = 0, i_end = mTilesets.size(); i < i_end; ++i) {
+        const Tileset *tileset = mTilesets.at(i);
+        const int columnCount = mColumnCounts.at(i);
+        if (tileset && columnCount > 0 && columnCount != tileset->columnCount())
+            return false;
+    }
+
+    return true;
 }
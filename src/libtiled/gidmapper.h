@@ -31,12 +31,18 @@
 
 #include "tilelayer.h"
 
-#include <QMap>
+#include <QHash>
+#include <QVector>
 
 namespace Tiled {
 
 /**
  * A class that maps cells to global IDs (gids) and back.
+ *
+ * The tilesets are kept in a flat array sorted by their first gid, so that
+ * looking up the tileset for a gid is a binary search over a small array.
+ * The mapper has no mutable state, so a single instance can be used from
+ * multiple threads once it has been set up.
  */
 class TILEDSHARED_EXPORT GidMapper
 {
@@ -55,18 +61,17 @@ public:
     /**
      * Insert the given \a tileset with \a firstGid as its first global ID.
      */
-    void insert(unsigned firstGid, Tileset *tileset)
-    { mFirstGidToTileset.insert(firstGid, tileset); }
+    void insert(unsigned firstGid, Tileset *tileset);
 
     /**
      * Clears the gid mapper, so that it can be reused.
      */
-    void clear() { mFirstGidToTileset.clear(); }
+    void clear();
 
     /**
      * Returns true when no tilesets are known to this gid mapper.
      */
-    bool isEmpty() const { return mFirstGidToTileset.isEmpty(); }
+    bool isEmpty() const { return mFirstGids.isEmpty(); }
 
     /**
      * Returns the cell data matched by the given \a gid. The \a ok parameter
@@ -87,9 +92,23 @@ public:
      */
     void setTilesetWidth(const Tileset *tileset, int width);
 
+    /**
+     * Returns whether the gids decoded by this mapper refer to the same
+     * tiles as the gids encoded by \a other. This is not the case when the
+     * tilesets or their first gids differ, or when this mapper corrects the
+     * tile indexes for a change in tileset width.
+     */
+    bool hasSameGids(const GidMapper &other) const;
+
 private:
-    QMap<unsigned, Tileset*> mFirstGidToTileset;
-    QMap<const Tileset*, int> mTilesetColumnCounts;
+    // Sorted by first gid, with the tileset and its original column count
+    // at the same index
+    QVector<unsigned> mFirstGids;
+    QVector<Tileset*> mTilesets;
+    QVector<int> mColumnCounts;
+
+    QHash<const Tileset*, unsigned> mTilesetFirstGids;
+    QHash<const Tileset*, int> mTilesetColumnCounts;
 };
 
 } // namespace Tiled
@@ -33,12 +33,10 @@
 #include "tile.h"
 #include "tilelayer.h"
 #include "tileset.h"
+#include "trace.h"
 
-#include <QVector2D>
 #include <QtCore/qmath.h>
 
-#include <limits>
-
 using namespace Tiled;
 
 HexagonalRenderer::RenderParams::RenderParams(const Map *map)
@@ -249,12 +247,31 @@ void HexagonalRenderer::drawGrid(QPainter *painter, const QRectF &exposed,
     }
 }
 
+/**
+ * Returns the area of the \a layer, in layer coordinates, outside of which
+ * no tiles have been placed.
+ */
+static QRect occupiedArea(const TileLayer *layer)
+{
+    QRect area;
+    foreach (const QRect &rect, layer->chunkRects())
+        area |= rect;
+    return area;
+}
+
 void HexagonalRenderer::drawTileLayer(QPainter *painter,
                                       const TileLayer *layer,
                                       const QRectF &exposed) const
 {
+    TILED_TRACE_SCOPE_DETAIL("MapRenderer::drawTileLayer", layer->name());
+
     const RenderParams p(map());
 
+    // Only the rows and columns in which tiles have been placed are visited
+    const QRect occupied = occupiedArea(layer);
+    if (occupied.isEmpty())
+        return;
+
     QRect rect = exposed.toAlignedRect();
 
     if (rect.isNull())
@@ -294,26 +311,45 @@ void HexagonalRenderer::drawTileLayer(QPainter *painter,
 
     if (p.staggerX) {
         startTile.setX(qMax(-1, startTile.x()));
-        startTile.setY(qMax(-1, startTile.y()));
+        startTile.setY(qMax(occupied.top() - 1, startTile.y()));
 
         startPos = tileToScreenCoords(startTile + layer->position()).toPoint();
         startPos.ry() += p.tileHeight;
 
         bool staggeredRow = p.doStaggerX(startTile.x() + layer->x());
 
-        for (; startPos.y() < rect.bottom() && startTile.y() < layer->height();) {
+        for (; startPos.y() < rect.bottom() && startTile.y() <= occupied.bottom();) {
             QPoint rowTile = startTile;
             QPoint rowPos = startPos;
 
-            for (; rowPos.x() < rect.right() && rowTile.x() < layer->width(); rowTile.rx() += 2) {
-                if (layer->contains(rowTile)) {
-                    const Cell &cell = layer->cellAt(rowTile);
+            while (rowPos.x() < rect.right() && rowTile.x() < layer->width()) {
+                if (!layer->contains(rowTile)) {
+                    rowTile.rx() += 2;
+                    rowPos.rx() += p.tileWidth + p.sideLengthX;
+                    continue;
+                }
+
+                // Go over every second cell of the part of the row that is
+                // stored contiguously
+                int count;
+                const Cell *cells = layer->cellRow(rowTile.x(), rowTile.y(), &count);
+                const int steps = (count + 1) / 2;
+
+                if (!cells) {
+                    // Skip the part of the row where no tiles have been placed
+                    rowTile.rx() += steps * 2;
+                    rowPos.rx() += steps * (p.tileWidth + p.sideLengthX);
+                    continue;
+                }
 
+                for (int i = 0; i < steps && rowPos.x() < rect.right(); ++i) {
+                    const Cell &cell = cells[i * 2];
                     if (!cell.isEmpty())
                         renderer.render(cell, rowPos, QSizeF(0, 0), CellRenderer::BottomLeft);
-                }
 
-                rowPos.rx() += p.tileWidth + p.sideLengthX;
+                    rowTile.rx() += 2;
+                    rowPos.rx() += p.tileWidth + p.sideLengthX;
+                }
             }
 
             if (staggeredRow) {
@@ -330,30 +366,51 @@ void HexagonalRenderer::drawTileLayer(QPainter *painter,
             startPos.ry() += p.rowHeight;
         }
     } else {
-        startTile.setX(qMax(0, startTile.x()));
-        startTile.setY(qMax(0, startTile.y()));
+        startTile.setX(qMax(occupied.left(), startTile.x()));
+        startTile.setY(qMax(occupied.top(), startTile.y()));
 
         startPos = tileToScreenCoords(startTile + layer->position()).toPoint();
         startPos.ry() += p.tileHeight;
 
-        // Odd row shifting is applied in the rendering loop, so un-apply it here
-        if (p.doStaggerY(startTile.y() + layer->y()))
+        // Odd row shifting is applied in the rendering loop, so un-apply it
+        // here. From then on the parity alternates with each row.
+        bool staggeredRow = p.doStaggerY(startTile.y() + layer->y());
+        if (staggeredRow)
             startPos.rx() -= p.columnWidth;
 
-        for (; startPos.y() < rect.bottom() && startTile.y() < layer->height(); startTile.ry()++) {
+        // The columns to draw are the same for each row
+        const int columnStep = p.tileWidth + p.sideLengthX;
+        const int endX = qMin(occupied.right() + 1,
+                              startTile.x() + (rect.right() - startPos.x()) / columnStep + 1);
+
+        for (; startPos.y() < rect.bottom() && startTile.y() <= occupied.bottom(); startTile.ry()++) {
             QPoint rowTile = startTile;
             QPoint rowPos = startPos;
 
-            if (p.doStaggerY(startTile.y() + layer->y()))
+            if (staggeredRow)
                 rowPos.rx() += p.columnWidth;
+            staggeredRow = !staggeredRow;
 
-            for (; rowPos.x() < rect.right() && rowTile.x() < layer->width(); rowTile.rx()++) {
-                const Cell &cell = layer->cellAt(rowTile);
+            while (rowPos.x() < rect.right() && rowTile.x() < endX) {
+                int count;
+                const Cell *cells = layer->cellRow(rowTile.x(), rowTile.y(), &count);
 
-                if (!cell.isEmpty())
-                    renderer.render(cell, rowPos, QSizeF(0, 0), CellRenderer::BottomLeft);
+                if (!cells) {
+                    // Skip the part of the row where no tiles have been placed
+                    rowTile.rx() += count;
+                    rowPos.rx() += count * columnStep;
+                    continue;
+                }
 
-                rowPos.rx() += p.tileWidth + p.sideLengthX;
+                count = qMin(count, endX - rowTile.x());
+                for (int i = 0; i < count; ++i) {
+                    const Cell &cell = cells[i];
+                    if (!cell.isEmpty())
+                        renderer.render(cell, rowPos, QSizeF(0, 0), CellRenderer::BottomLeft);
+
+                    rowPos.rx() += columnStep;
+                }
+                rowTile.rx() += count;
             }
 
             startPos.ry() += p.rowHeight;
@@ -408,8 +465,8 @@ QPointF HexagonalRenderer::screenToTileCoords(qreal x, qreal y) const
                                    qFloor(y / (p.tileHeight + p.sideLengthY)));
 
     // Relative x and y position on the base square of the grid-aligned tile
-    const QVector2D rel(x - referencePoint.x() * (p.tileWidth + p.sideLengthX),
-                        y - referencePoint.y() * (p.tileHeight + p.sideLengthY));
+    const qreal relX = x - referencePoint.x() * (p.tileWidth + p.sideLengthX);
+    const qreal relY = y - referencePoint.y() * (p.tileHeight + p.sideLengthY);
 
     // Adjust the reference point to the correct tile coordinates
     int &staggerAxisIndex = p.staggerX ? referencePoint.rx() : referencePoint.ry();
@@ -417,40 +474,39 @@ QPointF HexagonalRenderer::screenToTileCoords(qreal x, qreal y) const
     if (p.staggerEven)
         ++staggerAxisIndex;
 
-    // Determine the nearest hexagon tile by the distance to the center
-    QVector2D centers[4];
+    /*
+     * The base square touches four hexagons, whose centers form a rhombus
+     * around the center of the square. Centers 0 and 3 are on either side
+     * along the stagger axis, centers 1 and 2 on either side across it.
+     *
+     * Relative to the center of the rhombus, the squared distance to a
+     * center at distance s along an axis where the position is d, differs
+     * from |d|^2 by s * (s - 2|d|) for the closer one of each pair. So the
+     * nearest center follows from comparing just these two values.
+     */
+    qreal alongDist, alongSide;
+    qreal acrossDist, acrossSide;
 
     if (p.staggerX) {
-        const int left = p.sideLengthX / 2;
-        const int centerX = left + p.columnWidth;
-        const int centerY = p.tileHeight / 2;
-
-        centers[0] = QVector2D(left,                    centerY);
-        centers[1] = QVector2D(centerX,                 centerY - p.rowHeight);
-        centers[2] = QVector2D(centerX,                 centerY + p.rowHeight);
-        centers[3] = QVector2D(centerX + p.columnWidth, centerY);
+        alongDist = relX - (p.sideLengthX / 2 + p.columnWidth);
+        acrossDist = relY - p.tileHeight / 2;
+        alongSide = p.columnWidth;
+        acrossSide = p.rowHeight;
     } else {
-        const int top = p.sideLengthY / 2;
-        const int centerX = p.tileWidth / 2;
-        const int centerY = top + p.rowHeight;
-
-        centers[0] = QVector2D(centerX,                 top);
-        centers[1] = QVector2D(centerX - p.columnWidth, centerY);
-        centers[2] = QVector2D(centerX + p.columnWidth, centerY);
-        centers[3] = QVector2D(centerX,                 centerY + p.rowHeight);
+        alongDist = relY - (p.sideLengthY / 2 + p.rowHeight);
+        acrossDist = relX - p.tileWidth / 2;
+        alongSide = p.rowHeight;
+        acrossSide = p.columnWidth;
     }
 
-    int nearest = 0;
-    qreal minDist = std::numeric_limits<qreal>::max();
+    const int nearestAlong = alongDist <= 0 ? 0 : 3;
+    const int nearestAcross = acrossDist <= 0 ? 1 : 2;
+    const qreal along = alongSide * (alongSide - 2 * qAbs(alongDist));
+    const qreal across = acrossSide * (acrossSide - 2 * qAbs(acrossDist));
 
-    for (int i = 0; i < 4; ++i) {
-        const QVector2D &center = centers[i];
-        const qreal dc = (center - rel).lengthSquared();
-        if (dc < minDist) {
-            minDist = dc;
-            nearest = i;
-        }
-    }
+    // On a tie, the center with the lowest index is used
+    const bool useAlong = along < across || (along == across && nearestAlong == 0);
+    const int nearest = useAlong ? nearestAlong : nearestAcross;
 
     static const QPoint offsetsStaggerX[4] = {
         QPoint( 0,  0),
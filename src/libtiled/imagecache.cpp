@@ -0,0 +1,292 @@
+/*
+ * imagecache.cpp
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "imagecache.h"
+
+#include <QCache>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QTemporaryFile>
+
+#include <cstring>
+
+using namespace Tiled;
+
+namespace {
+
+struct CachedImage
+{
+    QDateTime lastModified;
+    QImage image;
+};
+
+// Accessed only while holding the mutex
+struct ImageCacheData
+{
+    ImageCacheData() : images(256 * 1024) {}
+
+    QMutex mutex;
+    QCache<QString, CachedImage> images;
+    QString diskCacheDirectory;
+};
+
+int costOf(const QImage &image)
+{
+    return qMax(1, image.byteCount() / 1024);
+}
+
+// Images smaller than this decode about as fast as they can be read back
+const int MinimumDiskCacheBytes = 1024 * 1024;
+
+/**
+ * Precedes the pixels of an image in the disk cache. The file is written in
+ * the byte order of the machine, since the cache is local to it.
+ */
+struct DiskCacheHeader
+{
+    char magic[4];
+    quint32 version;
+    qint64 fileSize;
+    qint64 lastModified;
+    qint32 width;
+    qint32 height;
+    qint32 bytesPerLine;
+    qint32 reserved;
+};
+
+const char DiskCacheMagic[4] = { 'T', 'I', 'M', 'G' };
+const quint32 DiskCacheVersion = 1;
+
+QString diskCacheFileName(const QString &directory,
+                          const QString &canonicalPath)
+{
+    const QByteArray hash = QCryptographicHash::hash(canonicalPath.toUtf8(),
+                                                     QCryptographicHash::Md5);
+
+    return directory + QLatin1Char('/') +
+            QString::fromLatin1(hash.toHex()) + QLatin1String(".img");
+}
+
+void initHeader(DiskCacheHeader &header, const QFileInfo &info)
+{
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, DiskCacheMagic, sizeof(header.magic));
+    header.version = DiskCacheVersion;
+    header.fileSize = info.size();
+    header.lastModified = info.lastModified().toMSecsSinceEpoch();
+}
+
+/**
+ * Reads the image for the file described by \a info from the disk cache.
+ * Returns a null image when it isn't cached or when the file has changed.
+ */
+QImage readFromDiskCache(const QString &directory, const QFileInfo &info)
+{
+    QFile file(diskCacheFileName(directory, info.canonicalFilePath()));
+    if (!file.open(QIODevice::ReadOnly))
+        return QImage();
+
+    const qint64 size = file.size();
+    if (size < qint64(sizeof(DiskCacheHeader)))
+        return QImage();
+
+    DiskCacheHeader expected;
+    initHeader(expected, info);
+
+    // Mapping the file avoids reading it through a buffer first
+    uchar *mapped = file.map(0, size);
+    QByteArray contents;
+    const uchar *data = mapped;
+    if (!data) {
+        contents = file.readAll();
+        if (contents.size() != size)
+            return QImage();
+        data = reinterpret_cast<const uchar*>(contents.constData());
+    }
+
+    DiskCacheHeader header;
+    std::memcpy(&header, data, sizeof(header));
+
+    QImage image;
+    if (std::memcmp(header.magic, expected.magic, sizeof(header.magic)) == 0 &&
+            header.version == expected.version &&
+            header.fileSize == expected.fileSize &&
+            header.lastModified == expected.lastModified &&
+            header.width > 0 && header.height > 0 &&
+            size == qint64(sizeof(header)) +
+                    qint64(header.bytesPerLine) * header.height) {
+        image = QImage(header.width, header.height,
+                       QImage::Format_ARGB32_Premultiplied);
+
+        if (!image.isNull()) {
+            const uchar *pixels = data + sizeof(header);
+            const int lineSize = qMin(header.bytesPerLine, image.bytesPerLine());
+            for (int y = 0; y < header.height; ++y)
+                std::memcpy(image.scanLine(y),
+                            pixels + qint64(y) * header.bytesPerLine,
+                            lineSize);
+        }
+    }
+
+    if (mapped)
+        file.unmap(mapped);
+
+    return image;
+}
+
+/**
+ * Writes the premultiplied \a image for the file described by \a info to
+ * the disk cache. The image is written to a temporary file first, so that
+ * other processes never see a partially written one.
+ */
+void writeToDiskCache(const QString &directory, const QFileInfo &info,
+                      const QImage &image)
+{
+    if (!QDir().mkpath(directory))
+        return;
+
+    DiskCacheHeader header;
+    initHeader(header, info);
+    header.width = image.width();
+    header.height = image.height();
+    header.bytesPerLine = image.bytesPerLine();
+
+    QTemporaryFile file(directory + QLatin1String("/XXXXXX.tmp"));
+    if (!file.open())
+        return;
+
+    const qint64 pixelBytes = qint64(image.bytesPerLine()) * image.height();
+    if (file.write(reinterpret_cast<const char*>(&header), sizeof(header))
+            != qint64(sizeof(header)) ||
+            file.write(reinterpret_cast<const char*>(image.constBits()),
+                       pixelBytes) != pixelBytes)
+        return;
+
+    file.close();
+
+    const QString fileName = diskCacheFileName(directory,
+                                               info.canonicalFilePath());
+    QFile::remove(fileName);
+    if (file.rename(fileName))
+        file.setAutoRemove(false);
+}
+
+} // anonymous namespace
+
+Q_GLOBAL_STATIC(ImageCacheData, cacheData)
+
+QImage ImageCache::loadImage(const QString &fileName)
+{
+    const QFileInfo info(fileName);
+    const QString canonicalPath = info.canonicalFilePath();
+
+    // Files that don't exist can't be cached, but QImage may still know
+    // how to load them (for example from a Qt resource)
+    if (canonicalPath.isEmpty())
+        return QImage(fileName);
+
+    const QDateTime lastModified = info.lastModified();
+    ImageCacheData *data = cacheData();
+    QString diskCacheDirectory;
+
+    {
+        QMutexLocker locker(&data->mutex);
+        if (CachedImage *cached = data->images.object(canonicalPath))
+            if (cached->lastModified == lastModified)
+                return cached->image;
+        diskCacheDirectory = data->diskCacheDirectory;
+    }
+
+    // Decoding happens outside of the lock, so that multiple images can be
+    // loaded at the same time
+    QImage image;
+    if (!diskCacheDirectory.isEmpty())
+        image = readFromDiskCache(diskCacheDirectory, info);
+
+    if (image.isNull()) {
+        image = QImage(canonicalPath);
+        if (image.isNull())
+            return image;
+
+        // Stored premultiplied, since that is how tilesets draw it
+        if (!diskCacheDirectory.isEmpty() &&
+                image.byteCount() >= MinimumDiskCacheBytes) {
+            image = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+            writeToDiskCache(diskCacheDirectory, info, image);
+        }
+    }
+
+    CachedImage *cached = new CachedImage;
+    cached->lastModified = lastModified;
+    cached->image = image;
+
+    QMutexLocker locker(&data->mutex);
+    data->images.insert(canonicalPath, cached, costOf(image));
+
+    return image;
+}
+
+void ImageCache::setMaximumSize(int kilobytes)
+{
+    ImageCacheData *data = cacheData();
+    QMutexLocker locker(&data->mutex);
+    data->images.setMaxCost(kilobytes);
+}
+
+int ImageCache::maximumSize()
+{
+    ImageCacheData *data = cacheData();
+    QMutexLocker locker(&data->mutex);
+    return data->images.maxCost();
+}
+
+void ImageCache::setDiskCacheDirectory(const QString &path)
+{
+    ImageCacheData *data = cacheData();
+    QMutexLocker locker(&data->mutex);
+    data->diskCacheDirectory = path;
+}
+
+QString ImageCache::diskCacheDirectory()
+{
+    ImageCacheData *data = cacheData();
+    QMutexLocker locker(&data->mutex);
+    return data->diskCacheDirectory;
+}
+
+void ImageCache::clear()
+{
+    ImageCacheData *data = cacheData();
+    QMutexLocker locker(&data->mutex);
+    data->images.clear();
+}
@@ -0,0 +1,86 @@
+/*
+ * imagecache.h
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef IMAGECACHE_H
+#define IMAGECACHE_H
+
+#include "tiled_global.h"
+
+#include <QImage>
+#include <QString>
+
+namespace Tiled {
+
+/**
+ * A process-wide cache of the images loaded for tilesets and image layers.
+ * It allows maps that share a tileset to decode its image only once.
+ *
+ * Images are identified by their canonical file path and are loaded again
+ * when the modification time of the file has changed. The cache is safe to
+ * use from multiple threads.
+ */
+class TILEDSHARED_EXPORT ImageCache
+{
+public:
+    /**
+     * Returns the image stored in the file with the given \a fileName,
+     * loading it when it isn't cached yet or when the file has changed.
+     * Returns a null image when the image could not be loaded.
+     */
+    static QImage loadImage(const QString &fileName);
+
+    /**
+     * Sets the maximum total size of the cached images, in kilobytes.
+     * Defaults to 256 MB. Images larger than this are not cached.
+     */
+    static void setMaximumSize(int kilobytes);
+    static int maximumSize();
+
+    /**
+     * Sets the directory in which decoded images are stored, so that they
+     * don't need to be decoded again the next time the application runs.
+     * The images are stored premultiplied, keyed by their canonical file
+     * path, and are only used when the size and modification time of the
+     * file still match. Only large images are stored this way, since small
+     * ones decode quickly anyway.
+     *
+     * An empty \a path, the default, disables the disk cache. The directory
+     * is created when needed.
+     */
+    static void setDiskCacheDirectory(const QString &path);
+    static QString diskCacheDirectory();
+
+    /**
+     * Removes all images from the cache. The disk cache is left alone.
+     */
+    static void clear();
+};
+
+} // namespace Tiled
+
+#endif // IMAGECACHE_H
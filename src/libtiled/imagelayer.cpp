@@ -28,9 +28,10 @@
  */
 
 #include "imagelayer.h"
+#include "imageutils.h"
 #include "map.h"
-
-#include <QBitmap>
+#include "maprenderer.h"
+#include "memoryusage.h"
 
 using namespace Tiled;
 
@@ -43,9 +44,16 @@ ImageLayer::~ImageLayer()
 {
 }
 
+void ImageLayer::setImage(const QPixmap &image)
+{
+    mImage = image;
+    mImageData = image.toImage();
+}
+
 void ImageLayer::resetImage()
 {
     mImage = QPixmap();
+    mImageData = QImage();
     mImageSource.clear();
 }
 
@@ -55,15 +63,17 @@ bool ImageLayer::loadFromImage(const QImage &image, const QString &fileName)
 
     if (image.isNull()) {
         mImage = QPixmap();
+        mImageData = QImage();
         return false;
     }
 
-    mImage = QPixmap::fromImage(image);
+    mImageData = premultipliedImage(image, mTransparentColor);
 
-    if (mTransparentColor.isValid()) {
-        const QImage mask = image.createMaskFromColor(mTransparentColor.rgb());
-        mImage.setMask(QBitmap::fromImage(mask));
-    }
+    // Outside of the GUI thread only the image data can be used
+    if (CellRenderer::isGuiThread())
+        mImage = QPixmap::fromImage(mImageData);
+    else
+        mImage = QPixmap();
 
     return true;
 }
@@ -78,6 +88,15 @@ Layer *ImageLayer::clone() const
     return initializeClone(new ImageLayer(mName, mX, mY, mWidth, mHeight));
 }
 
+qint64 ImageLayer::memoryUsage() const
+{
+    return sizeof(ImageLayer) +
+            stringMemoryUsage(mName) +
+            stringMemoryUsage(mImageSource) +
+            propertiesMemoryUsage(properties()) +
+            pixmapMemoryUsage(mImage);
+}
+
 ImageLayer *ImageLayer::initializeClone(ImageLayer *clone) const
 {
     Layer::initializeClone(clone);
@@ -85,6 +104,7 @@ ImageLayer *ImageLayer::initializeClone(ImageLayer *clone) const
     clone->mImageSource = mImageSource;
     clone->mTransparentColor = mTransparentColor;
     clone->mImage = mImage;
+    clone->mImageData = mImageData;
 
     return clone;
 }
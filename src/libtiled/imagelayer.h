@@ -36,10 +36,9 @@
 #include "tileset.h"
 
 #include <QColor>
+#include <QImage>
 #include <QPixmap>
 
-class QImage;
-
 namespace Tiled {
 
 /**
@@ -92,10 +91,16 @@ public:
       */
     const QPixmap &image() const { return mImage; }
 
+    /**
+     * Returns the image of this layer as a QImage, which unlike the pixmap
+     * can be drawn outside of the GUI thread.
+     */
+    const QImage &imageData() const { return mImageData; }
+
     /**
       * Sets the image of this layer.
       */
-    void setImage(const QPixmap &image) { mImage = image; }
+    void setImage(const QPixmap &image);
 
     /**
      * Resets layer image.
@@ -122,6 +127,8 @@ public:
 
     Layer *clone() const;
 
+    qint64 memoryUsage() const;
+
     virtual ImageLayer *asImageLayer() { return this; }
 
 protected:
@@ -131,6 +138,7 @@ private:
     QString mImageSource;
     QColor mTransparentColor;
     QPixmap mImage;
+    QImage mImageData;
 };
 
 } // namespace Tiled
@@ -0,0 +1,77 @@
+/*
+ * imageutils.cpp
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "imageutils.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace Tiled;
+
+/**
+ * Clears the \a count pixels starting at \a pixels that are equal to \a key.
+ */
+static void clearColorKey(quint32 *pixels, int count, quint32 key)
+{
+    int i = 0;
+
+#ifdef __SSE2__
+    const __m128i keys = _mm_set1_epi32(int(key));
+    for (; i + 4 <= count; i += 4) {
+        __m128i *p = reinterpret_cast<__m128i*>(pixels + i);
+        const __m128i values = _mm_loadu_si128(p);
+        const __m128i matches = _mm_cmpeq_epi32(values, keys);
+        _mm_storeu_si128(p, _mm_andnot_si128(matches, values));
+    }
+#endif
+
+    for (; i < count; ++i)
+        if (pixels[i] == key)
+            pixels[i] = 0;
+}
+
+QImage Tiled::premultipliedImage(const QImage &image,
+                                 const QColor &transparentColor)
+{
+    QImage result = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    if (!transparentColor.isValid() || result.isNull())
+        return result;
+
+    // Only opaque pixels match the key, and these are the same whether
+    // premultiplied or not
+    const quint32 key = transparentColor.rgb();
+
+    const int width = result.width();
+    for (int y = 0; y < result.height(); ++y) {
+        quint32 *line = reinterpret_cast<quint32*>(result.scanLine(y));
+        clearColorKey(line, width, key);
+    }
+
+    return result;
+}
@@ -33,6 +33,7 @@
 #include "tile.h"
 #include "tilelayer.h"
 #include "tileset.h"
+#include "trace.h"
 
 #include <cmath>
 
@@ -68,7 +69,7 @@ QRectF IsometricRenderer::boundingRect(const MapObject *object) const
     if (!object->cell().isEmpty()) {
         const QPointF bottomCenter = pixelToScreenCoords(object->position());
         const Tile *tile = object->cell().tile;
-        const QSize imgSize = tile->image().size();
+        const QSize imgSize = tile->size();
         const QPoint tileOffset = tile->tileset()->tileOffset();
         const QSizeF objectSize = object->size();
         const QSizeF scale(objectSize.width() / imgSize.width(), objectSize.height() / imgSize.height());
@@ -77,30 +78,42 @@ QRectF IsometricRenderer::boundingRect(const MapObject *object) const
                       bottomCenter.y() + (tileOffset.y() * scale.height()) - objectSize.height(),
                       objectSize.width(),
                       objectSize.height()).adjusted(-1, -1, 1, 1);
-    } else if (!object->polygon().isEmpty()) {
+    }
+
+    QRectF boundingRect;
+    if (cachedBoundingRect(object, boundingRect))
+        return boundingRect;
+
+    if (!object->polygon().isEmpty()) {
         const qreal extraSpace = qMax(objectLineWidth() / 2, qreal(1));
         const QPointF &pos = object->position();
         const QPolygonF polygon = object->polygon().translated(pos);
         const QPolygonF screenPolygon = pixelToScreenCoords(polygon);
-        return screenPolygon.boundingRect().adjusted(-extraSpace,
-                                                     -extraSpace - 1,
-                                                     extraSpace,
-                                                     extraSpace);
+        boundingRect = screenPolygon.boundingRect().adjusted(-extraSpace,
+                                                             -extraSpace - 1,
+                                                             extraSpace,
+                                                             extraSpace);
     } else {
         // Take the bounding rect of the projected object, and then add a few
         // pixels on all sides to correct for the line width.
         const QRectF base = pixelRectToScreenPolygon(object->bounds()).boundingRect();
         const qreal extraSpace = qMax(objectLineWidth() / 2, qreal(1));
 
-        return base.adjusted(-extraSpace,
-                             -extraSpace - 1,
-                             extraSpace, extraSpace);
+        boundingRect = base.adjusted(-extraSpace,
+                                     -extraSpace - 1,
+                                     extraSpace, extraSpace);
     }
+
+    cacheBoundingRect(object, boundingRect);
+    return boundingRect;
 }
 
 QPainterPath IsometricRenderer::shape(const MapObject *object) const
 {
     QPainterPath path;
+    if (cachedShape(object, path))
+        return path;
+
     if (!object->cell().isEmpty()) {
         path.addRect(boundingRect(object));
     } else {
@@ -127,6 +140,8 @@ QPainterPath IsometricRenderer::shape(const MapObject *object) const
         }
         }
     }
+
+    cacheShape(object, path);
     return path;
 }
 
@@ -170,6 +185,8 @@ void IsometricRenderer::drawTileLayer(QPainter *painter,
                                       const TileLayer *layer,
                                       const QRectF &exposed) const
 {
+    TILED_TRACE_SCOPE_DETAIL("MapRenderer::drawTileLayer", layer->name());
+
     const int tileWidth = map()->tileWidth();
     const int tileHeight = map()->tileHeight();
 
@@ -231,10 +248,20 @@ void IsometricRenderer::drawTileLayer(QPainter *painter,
 
         for (int x = startPos.x(); x < rect.right(); x += tileWidth) {
             if (layer->contains(columnItr)) {
-                const Cell &cell = layer->cellAt(columnItr);
-                if (!cell.isEmpty()) {
-                    renderer.render(cell, QPointF(x, y), QSizeF(0, 0),
-                                    CellRenderer::BottomLeft);
+                const QRect empty = layer->emptyChunkAt(columnItr.x(),
+                                                        columnItr.y());
+                if (!empty.isNull()) {
+                    // Skip to the last position in this chunk
+                    const int skip = qMin(empty.right() - columnItr.x(),
+                                          columnItr.y() - empty.top());
+                    columnItr += QPoint(skip, -skip);
+                    x += skip * tileWidth;
+                } else {
+                    const Cell &cell = layer->cellAt(columnItr);
+                    if (!cell.isEmpty()) {
+                        renderer.render(cell, QPointF(x, y), QSizeF(0, 0),
+                                        CellRenderer::BottomLeft);
+                    }
                 }
             }
 
@@ -482,6 +509,67 @@ QPointF IsometricRenderer::pixelToScreenCoords(qreal x, qreal y) const
                    (tileX + tileY) * tileHeight / 2);
 }
 
+/*
+ * The conversions of arrays of points use the same formulas as the ones of
+ * single points, but look up the map parameters only once. The loops have no
+ * branches or calls, which allows compilers to vectorize them.
+ */
+
+void IsometricRenderer::screenToTileCoords(QPointF *points, int count) const
+{
+    const qreal tileWidth = map()->tileWidth();
+    const qreal tileHeight = map()->tileHeight();
+    const qreal originX = map()->height() * map()->tileWidth() / 2;
+
+    for (QPointF *end = points + count; points != end; ++points) {
+        const qreal tileY = points->y() / tileHeight;
+        const qreal tileX = (points->x() - originX) / tileWidth;
+        *points = QPointF(tileY + tileX, tileY - tileX);
+    }
+}
+
+void IsometricRenderer::tileToScreenCoords(QPointF *points, int count) const
+{
+    const qreal tileWidth = map()->tileWidth();
+    const qreal tileHeight = map()->tileHeight();
+    const qreal originX = map()->height() * map()->tileWidth() / 2;
+
+    for (QPointF *end = points + count; points != end; ++points) {
+        const qreal x = points->x();
+        const qreal y = points->y();
+        *points = QPointF((x - y) * tileWidth / 2 + originX,
+                          (x + y) * tileHeight / 2);
+    }
+}
+
+void IsometricRenderer::screenToPixelCoords(QPointF *points, int count) const
+{
+    const qreal tileWidth = map()->tileWidth();
+    const qreal tileHeight = map()->tileHeight();
+    const qreal originX = map()->height() * map()->tileWidth() / 2;
+
+    for (QPointF *end = points + count; points != end; ++points) {
+        const qreal tileY = points->y() / tileHeight;
+        const qreal tileX = (points->x() - originX) / tileWidth;
+        *points = QPointF((tileY + tileX) * tileHeight,
+                          (tileY - tileX) * tileHeight);
+    }
+}
+
+void IsometricRenderer::pixelToScreenCoords(QPointF *points, int count) const
+{
+    const qreal tileWidth = map()->tileWidth();
+    const qreal tileHeight = map()->tileHeight();
+    const qreal originX = map()->height() * map()->tileWidth() / 2;
+
+    for (QPointF *end = points + count; points != end; ++points) {
+        const qreal tileY = points->y() / tileHeight;
+        const qreal tileX = points->x() / tileHeight;
+        *points = QPointF((tileX - tileY) * tileWidth / 2 + originX,
+                          (tileX + tileY) * tileHeight / 2);
+    }
+}
+
 QPolygonF IsometricRenderer::pixelRectToScreenPolygon(const QRectF &rect) const
 {
     QPolygonF polygon;
@@ -74,15 +74,19 @@ public:
     
     using MapRenderer::screenToTileCoords;
     QPointF screenToTileCoords(qreal x, qreal y) const;
+    void screenToTileCoords(QPointF *points, int count) const;
 
     using MapRenderer::tileToScreenCoords;
     QPointF tileToScreenCoords(qreal x, qreal y) const;
+    void tileToScreenCoords(QPointF *points, int count) const;
     
     using MapRenderer::screenToPixelCoords;
     QPointF screenToPixelCoords(qreal x, qreal y) const;
+    void screenToPixelCoords(QPointF *points, int count) const;
 
     using MapRenderer::pixelToScreenCoords;
     QPointF pixelToScreenCoords(qreal x, qreal y) const;
+    void pixelToScreenCoords(QPointF *points, int count) const;
 
 private:
     QPolygonF pixelRectToScreenPolygon(const QRectF &rect) const;
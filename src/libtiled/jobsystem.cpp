@@ -0,0 +1,322 @@
+/*
+ * jobsystem.cpp
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "jobsystem.h"
+
+#include <QList>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThread>
+#include <QVector>
+
+namespace Tiled {
+
+struct Job
+{
+    QRunnable *runnable;
+    JobGroup *group;
+};
+
+class JobWorker : public QThread
+{
+public:
+    explicit JobWorker(JobSystemPrivate *system)
+        : mSystem(system)
+    {}
+
+    QMutex mutex;
+    QList<Job> queues[JobSystem::PriorityCount];    // guarded by the mutex
+
+protected:
+    void run();
+
+private:
+    JobSystemPrivate *mSystem;
+};
+
+class JobSystemPrivate
+{
+public:
+    JobSystemPrivate();
+    ~JobSystemPrivate();
+
+    void start(QRunnable *runnable, JobGroup *group,
+               JobSystem::Priority priority);
+    bool takeJob(Job &job, const JobGroup *group);
+    void runJob(const Job &job);
+    void runWorker();
+
+    int workerCount() const { return mWorkers.size(); }
+
+private:
+    bool takeJob(JobWorker *worker, int priority, const JobGroup *group,
+                 bool newest, Job &job);
+
+    // Created once, so that the list can be read without locking
+    QVector<JobWorker*> mWorkers;
+
+    QMutex mMutex;
+    QWaitCondition mJobsAvailable;
+    int mQueuedJobs;            // guarded by the mutex
+    int mNextWorker;            // guarded by the mutex
+    bool mQuit;                 // guarded by the mutex
+};
+
+} // namespace Tiled
+
+using namespace Tiled;
+
+Q_GLOBAL_STATIC(JobSystemPrivate, jobSystem)
+
+static JobWorker *currentWorker()
+{
+    return dynamic_cast<JobWorker*>(QThread::currentThread());
+}
+
+void JobWorker::run()
+{
+    mSystem->runWorker();
+}
+
+JobSystemPrivate::JobSystemPrivate()
+    : mQueuedJobs(0)
+    , mNextWorker(0)
+    , mQuit(false)
+{
+    const int count = qMax(1, QThread::idealThreadCount());
+    for (int i = 0; i < count; ++i)
+        mWorkers.append(new JobWorker(this));
+    foreach (JobWorker *worker, mWorkers)
+        worker->start();
+}
+
+JobSystemPrivate::~JobSystemPrivate()
+{
+    {
+        QMutexLocker locker(&mMutex);
+        mQuit = true;
+        mJobsAvailable.wakeAll();
+    }
+
+    foreach (JobWorker *worker, mWorkers)
+        worker->wait();
+
+    // Jobs that never got to run are only deleted
+    foreach (JobWorker *worker, mWorkers) {
+        for (int priority = 0; priority < JobSystem::PriorityCount; ++priority)
+            foreach (const Job &job, worker->queues[priority])
+                if (job.runnable->autoDelete())
+                    delete job.runnable;
+        delete worker;
+    }
+}
+
+void JobSystemPrivate::start(QRunnable *runnable, JobGroup *group,
+                             JobSystem::Priority priority)
+{
+    const Job job = { runnable, group };
+
+    // Jobs started by a job stay on the same worker, others are spread
+    JobWorker *worker = currentWorker();
+    if (!worker) {
+        QMutexLocker locker(&mMutex);
+        worker = mWorkers.at(mNextWorker);
+        mNextWorker = (mNextWorker + 1) % mWorkers.size();
+    }
+
+    {
+        QMutexLocker locker(&worker->mutex);
+        worker->queues[priority].append(job);
+    }
+
+    QMutexLocker locker(&mMutex);
+    ++mQueuedJobs;
+    mJobsAvailable.wakeOne();
+}
+
+/**
+ * Takes the job with the highest priority. The own queue of the current
+ * worker is tried first, taking its newest job while its caches are still
+ * warm. Otherwise the oldest job is stolen from one of the other workers.
+ * When a \a group is given, only the jobs of that group are taken.
+ */
+bool JobSystemPrivate::takeJob(Job &job, const JobGroup *group)
+{
+    JobWorker *self = currentWorker();
+    const int first = qMax(0, mWorkers.indexOf(self));
+    const int count = mWorkers.size();
+
+    for (int priority = 0; priority < JobSystem::PriorityCount; ++priority) {
+        bool found = self && takeJob(self, priority, group, true, job);
+
+        for (int i = 0; !found && i < count; ++i) {
+            JobWorker *worker = mWorkers.at((first + i) % count);
+            if (worker != self)
+                found = takeJob(worker, priority, group, false, job);
+        }
+
+        if (found) {
+            QMutexLocker locker(&mMutex);
+            --mQueuedJobs;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool JobSystemPrivate::takeJob(JobWorker *worker, int priority,
+                               const JobGroup *group, bool newest, Job &job)
+{
+    QMutexLocker locker(&worker->mutex);
+    QList<Job> &queue = worker->queues[priority];
+
+    if (group) {
+        for (int i = 0; i < queue.size(); ++i) {
+            if (queue.at(i).group == group) {
+                job = queue.takeAt(i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    if (queue.isEmpty())
+        return false;
+
+    job = newest ? queue.takeLast() : queue.takeFirst();
+    return true;
+}
+
+void JobSystemPrivate::runJob(const Job &job)
+{
+    QRunnable *runnable = job.runnable;
+    const bool autoDelete = runnable->autoDelete();
+
+    if (!job.group || !job.group->isCanceled())
+        runnable->run();
+
+    if (autoDelete)
+        delete runnable;
+
+    // The group may be gone as soon as it knows its jobs have finished
+    if (job.group)
+        job.group->jobFinished();
+}
+
+void JobSystemPrivate::runWorker()
+{
+    forever {
+        Job job;
+        if (takeJob(job, 0)) {
+            runJob(job);
+            continue;
+        }
+
+        QMutexLocker locker(&mMutex);
+        if (mQuit)
+            return;
+
+        // Jobs queued since looking are counted before they wake anyone
+        if (mQueuedJobs <= 0)
+            mJobsAvailable.wait(&mMutex);
+    }
+}
+
+
+void JobSystem::start(QRunnable *job, Priority priority)
+{
+    jobSystem()->start(job, 0, priority);
+}
+
+int JobSystem::workerCount()
+{
+    return jobSystem()->workerCount();
+}
+
+
+JobGroup::JobGroup(JobSystem::Priority priority)
+    : mPriority(priority)
+    , mPendingJobs(0)
+    , mCanceled(false)
+{
+}
+
+JobGroup::~JobGroup()
+{
+    wait();
+}
+
+void JobGroup::start(QRunnable *job)
+{
+    {
+        QMutexLocker locker(&mMutex);
+        ++mPendingJobs;
+    }
+
+    jobSystem()->start(job, this, mPriority);
+}
+
+void JobGroup::wait()
+{
+    JobSystemPrivate *system = jobSystem();
+
+    forever {
+        // Rather than only waiting, help with the jobs of this group
+        Job job;
+        if (system->takeJob(job, this)) {
+            system->runJob(job);
+            continue;
+        }
+
+        QMutexLocker locker(&mMutex);
+        if (mPendingJobs == 0)
+            return;
+
+        mFinished.wait(&mMutex);
+    }
+}
+
+void JobGroup::cancel()
+{
+    QMutexLocker locker(&mMutex);
+    mCanceled = true;
+}
+
+bool JobGroup::isCanceled() const
+{
+    QMutexLocker locker(&mMutex);
+    return mCanceled;
+}
+
+void JobGroup::jobFinished()
+{
+    QMutexLocker locker(&mMutex);
+    if (--mPendingJobs == 0)
+        mFinished.wakeAll();
+}
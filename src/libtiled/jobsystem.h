@@ -0,0 +1,127 @@
+/*
+ * jobsystem.h
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+#include "tiled_global.h"
+
+#include <QMutex>
+#include <QWaitCondition>
+
+class QRunnable;
+
+namespace Tiled {
+
+class JobSystemPrivate;
+
+/**
+ * A process-wide set of worker threads that run the jobs of libtiled, the
+ * editor, the tools and the plugins. Sharing the workers avoids each
+ * feature starting its own threads, which would oversubscribe the cores when
+ * several of them are busy at the same time.
+ *
+ * Each worker has its own queues. Jobs started from a worker are queued on
+ * that worker, and workers that run out of jobs steal them from the others.
+ * Jobs with a higher priority are always taken first.
+ *
+ * Jobs are QRunnable instances, which are deleted after they ran when their
+ * autoDelete() is set. Usually jobs are started through a JobGroup, so that
+ * they can be waited for.
+ */
+class TILEDSHARED_EXPORT JobSystem
+{
+public:
+    enum Priority {
+        Interactive,    // the user is waiting for the result
+        Normal,
+        Background,     // for example indexing or generating thumbnails
+        PriorityCount
+    };
+
+    /**
+     * Starts the given \a job, which isn't part of any group.
+     */
+    static void start(QRunnable *job, Priority priority = Normal);
+
+    /**
+     * Returns the number of worker threads, which matches the number of
+     * cores.
+     */
+    static int workerCount();
+};
+
+/**
+ * A set of jobs that is waited for or canceled together. It replaces a
+ * QThreadPool that is only created to wait for a few jobs:
+ *
+ * \code
+ * JobGroup jobs;
+ * foreach (QRunnable *job, pendingJobs)
+ *     jobs.start(job);
+ * jobs.wait();
+ * \endcode
+ *
+ * The thread waiting for a group runs the queued jobs of the group itself,
+ * so groups may also be waited for from within a job. The destructor waits
+ * for the jobs that are still running.
+ */
+class TILEDSHARED_EXPORT JobGroup
+{
+public:
+    explicit JobGroup(JobSystem::Priority priority = JobSystem::Normal);
+    ~JobGroup();
+
+    JobSystem::Priority priority() const { return mPriority; }
+
+    void start(QRunnable *job);
+    void wait();
+
+    /**
+     * Skips the jobs of this group that didn't start yet. Jobs that are
+     * running can check isCanceled() to stop early.
+     */
+    void cancel();
+    bool isCanceled() const;
+
+private:
+    Q_DISABLE_COPY(JobGroup)
+    friend class JobSystemPrivate;
+
+    void jobFinished();
+
+    const JobSystem::Priority mPriority;
+    mutable QMutex mMutex;
+    QWaitCondition mFinished;
+    int mPendingJobs;           // guarded by the mutex
+    bool mCanceled;             // guarded by the mutex
+};
+
+} // namespace Tiled
+
+#endif // JOBSYSTEM_H
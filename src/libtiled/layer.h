@@ -204,6 +204,11 @@ public:
      */
     virtual Layer *clone() const = 0;
 
+    /**
+     * Returns an estimate of the memory used by this layer, in bytes.
+     */
+    virtual qint64 memoryUsage() const = 0;
+
     // These functions allow checking whether this Layer is an instance of the
     // given subclass without relying on a dynamic_cast.
     bool isTileLayer() const { return mLayerType == TileLayerType; }
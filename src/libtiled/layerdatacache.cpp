@@ -0,0 +1,81 @@
+/*
+ * layerdatacache.cpp
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "layerdatacache.h"
+
+#include "tilelayer.h"
+
+using namespace Tiled;
+
+void LayerDataCache::setKey(const QByteArray &key)
+{
+    if (mKey == key)
+        return;
+
+    clear();
+    mKey = key;
+}
+
+bool LayerDataCache::find(const TileLayer *tileLayer, QString &data)
+{
+    const unsigned revision = tileLayer->revision();
+    QHash<unsigned, QString>::const_iterator it = mData.constFind(revision);
+    if (it == mData.constEnd())
+        return false;
+
+    data = it.value();
+    mUsed.insert(revision);
+    return true;
+}
+
+void LayerDataCache::insert(const TileLayer *tileLayer, const QString &data)
+{
+    const unsigned revision = tileLayer->revision();
+    mData.insert(revision, data);
+    mUsed.insert(revision);
+}
+
+void LayerDataCache::removeUnused()
+{
+    QHash<unsigned, QString>::iterator it = mData.begin();
+    while (it != mData.end()) {
+        if (mUsed.contains(it.key()))
+            ++it;
+        else
+            it = mData.erase(it);
+    }
+
+    mUsed.clear();
+}
+
+void LayerDataCache::clear()
+{
+    mKey.clear();
+    mData.clear();
+    mUsed.clear();
+}
@@ -0,0 +1,90 @@
+/*
+ * layerdatacache.h
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LAYERDATACACHE_H
+#define LAYERDATACACHE_H
+
+#include "tiled_global.h"
+
+#include <QByteArray>
+#include <QHash>
+#include <QSet>
+#include <QString>
+
+namespace Tiled {
+
+class TileLayer;
+
+/**
+ * Remembers the encoded data of tile layers between saves, so that only the
+ * layers whose cells have changed need to be encoded again.
+ *
+ * Entries are identified by the revision of the tile layer. The data also
+ * depends on the layer data format and the tilesets of the map, which are
+ * described by the key. Changing the key clears the cache.
+ */
+class TILEDSHARED_EXPORT LayerDataCache
+{
+public:
+    /**
+     * Sets the key describing how the cached data was encoded. Clears the
+     * cache when the key differs from the current one.
+     */
+    void setKey(const QByteArray &key);
+    const QByteArray &key() const { return mKey; }
+
+    /**
+     * Looks up the encoded data for the current cells of \a tileLayer.
+     * Returns whether it was found.
+     */
+    bool find(const TileLayer *tileLayer, QString &data);
+
+    /**
+     * Stores the encoded \a data for the current cells of \a tileLayer.
+     */
+    void insert(const TileLayer *tileLayer, const QString &data);
+
+    /**
+     * Removes the entries that were not looked up or inserted since the
+     * last call to this function.
+     */
+    void removeUnused();
+
+    void clear();
+
+    int size() const { return mData.size(); }
+
+private:
+    QByteArray mKey;
+    QHash<unsigned, QString> mData;
+    QSet<unsigned> mUsed;
+};
+
+} // namespace Tiled
+
+#endif // LAYERDATACACHE_H
@@ -0,0 +1,160 @@
+/*
+ * layerexportcache.cpp
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "layerexportcache.h"
+
+#include "tilelayer.h"
+
+using namespace Tiled;
+
+LayerExportCache *LayerExportCache::mCurrent = 0;
+
+/**
+ * Encodes the gids of the cells of \a tileLayer as 32-bit little-endian
+ * values.
+ */
+static QByteArray encodeGids(const TileLayer *tileLayer,
+                             const GidMapper &gidMapper)
+{
+    QByteArray data;
+    data.resize(tileLayer->width() * tileLayer->height() * 4);
+    uchar *out = reinterpret_cast<uchar*>(data.data());
+
+    for (int y = 0; y < tileLayer->height(); ++y) {
+        for (int x = 0; x < tileLayer->width(); ++x) {
+            const unsigned gid = gidMapper.cellToGid(tileLayer->cellAt(x, y));
+            *out++ = uchar(gid);
+            *out++ = uchar(gid >> 8);
+            *out++ = uchar(gid >> 16);
+            *out++ = uchar(gid >> 24);
+        }
+    }
+
+    return data;
+}
+
+/**
+ * Returns a key identifying the compression settings.
+ */
+static int compressionKey(CompressionMethod method, int level,
+                          CompressionStrategy strategy)
+{
+    return (method * 16 + (level + 1)) * 16 + strategy;
+}
+
+LayerExportCache::LayerExportCache()
+    : mPrevious(mCurrent)
+{
+    mCurrent = this;
+}
+
+LayerExportCache::~LayerExportCache()
+{
+    mCurrent = mPrevious;
+}
+
+QByteArray LayerExportCache::gids(const TileLayer *tileLayer,
+                                  const GidMapper &gidMapper)
+{
+    LayerExportCache *cache = mCurrent;
+    if (!cache)
+        return encodeGids(tileLayer, gidMapper);
+
+    {
+        QMutexLocker locker(&cache->mMutex);
+        if (Entry *entry = cache->findEntry(tileLayer, gidMapper))
+            if (!entry->gids.isNull())
+                return entry->gids;
+    }
+
+    // Encoded without holding the lock, so that layers can be encoded in
+    // parallel
+    const QByteArray data = encodeGids(tileLayer, gidMapper);
+
+    QMutexLocker locker(&cache->mMutex);
+    Entry *entry = cache->findEntry(tileLayer, gidMapper);
+    if (!entry) {
+        QList<Entry> &entries = cache->mEntries[tileLayer->revision()];
+        entries.append(Entry());
+        entry = &entries.last();
+        entry->gidMapper = gidMapper;
+    }
+    entry->gids = data;
+    return data;
+}
+
+QByteArray LayerExportCache::compressedGids(const TileLayer *tileLayer,
+                                            const GidMapper &gidMapper,
+                                            CompressionMethod method,
+                                            int level,
+                                            CompressionStrategy strategy)
+{
+    LayerExportCache *cache = mCurrent;
+    if (!cache)
+        return compress(encodeGids(tileLayer, gidMapper), method, level, strategy);
+
+    const int key = compressionKey(method, level, strategy);
+
+    {
+        QMutexLocker locker(&cache->mMutex);
+        if (Entry *entry = cache->findEntry(tileLayer, gidMapper)) {
+            QHash<int, QByteArray>::const_iterator it = entry->compressed.constFind(key);
+            if (it != entry->compressed.constEnd())
+                return it.value();
+        }
+    }
+
+    const QByteArray data = compress(gids(tileLayer, gidMapper),
+                                     method, level, strategy);
+
+    // The entry was added by gids()
+    QMutexLocker locker(&cache->mMutex);
+    if (Entry *entry = cache->findEntry(tileLayer, gidMapper))
+        entry->compressed.insert(key, data);
+    return data;
+}
+
+/**
+ * Returns the entry for the current cells of \a tileLayer, as encoded by
+ * \a gidMapper, or 0 when there is none. Needs to be called with the mutex
+ * locked.
+ */
+LayerExportCache::Entry *LayerExportCache::findEntry(const TileLayer *tileLayer,
+                                                     const GidMapper &gidMapper)
+{
+    QHash<unsigned, QList<Entry> >::iterator it = mEntries.find(tileLayer->revision());
+    if (it == mEntries.end())
+        return 0;
+
+    QList<Entry> &entries = it.value();
+    for (int i = 0; i < entries.size(); ++i)
+        if (entries.at(i).gidMapper.hasSameGids(gidMapper))
+            return &entries[i];
+
+    return 0;
+}
@@ -0,0 +1,117 @@
+/*
+ * layerexportcache.h
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LAYEREXPORTCACHE_H
+#define LAYEREXPORTCACHE_H
+
+#include "compression.h"
+#include "gidmapper.h"
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+
+namespace Tiled {
+
+class TileLayer;
+
+/**
+ * Shares the gids and the compressed layer data of tile layers between the
+ * writers used while exporting a map to several formats at once.
+ *
+ * While an instance exists, it is returned by current() and the writers look
+ * up the data of their tile layers in it. Entries are identified by the
+ * revision of the tile layer and are only shared by writers that assign the
+ * same gids. The cache can be used from multiple threads.
+ */
+class TILEDSHARED_EXPORT LayerExportCache
+{
+public:
+    /**
+     * Creates a cache and makes it the current one, until it is destroyed.
+     * Should be created on the GUI thread.
+     */
+    LayerExportCache();
+    ~LayerExportCache();
+
+    /**
+     * Returns the cache of the export in progress, or 0 when there is none.
+     */
+    static LayerExportCache *current() { return mCurrent; }
+
+    /**
+     * Returns the gids of the cells of \a tileLayer, row by row, as 32-bit
+     * little-endian values. Uses the current cache when there is one.
+     */
+    static QByteArray gids(const TileLayer *tileLayer,
+                           const GidMapper &gidMapper);
+
+    /**
+     * Returns the gids of the cells of \a tileLayer as returned by gids(),
+     * compressed using the given settings. Uses the current cache when there
+     * is one. Returns a null QByteArray if compression failed.
+     */
+    static QByteArray compressedGids(const TileLayer *tileLayer,
+                                     const GidMapper &gidMapper,
+                                     CompressionMethod method,
+                                     int level = DefaultCompressionLevel,
+                                     CompressionStrategy strategy = DefaultStrategy);
+
+    /**
+     * Returns the gid at \a index of the \a data returned by gids().
+     */
+    static unsigned gidAt(const QByteArray &data, int index)
+    {
+        const uchar *bytes = reinterpret_cast<const uchar*>(data.constData())
+                + index * 4;
+        return bytes[0] | bytes[1] << 8 | bytes[2] << 16 | unsigned(bytes[3]) << 24;
+    }
+
+private:
+    Q_DISABLE_COPY(LayerExportCache)
+
+    struct Entry
+    {
+        GidMapper gidMapper;
+        QByteArray gids;
+        QHash<int, QByteArray> compressed;
+    };
+
+    Entry *findEntry(const TileLayer *tileLayer, const GidMapper &gidMapper);
+
+    QMutex mMutex;
+    QHash<unsigned, QList<Entry> > mEntries;
+    LayerExportCache *mPrevious;
+
+    static LayerExportCache *mCurrent;
+};
+
+} // namespace Tiled
+
+#endif // LAYEREXPORTCACHE_H
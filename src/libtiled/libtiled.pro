@@ -22,52 +22,94 @@ win32 {
     LIBS += -lz
 }
 
+# Optional support for Zstandard and LZ4 compressed layer data, enabled by
+# passing ZSTD_SUPPORT=yes or LZ4_SUPPORT=yes to qmake
+contains(ZSTD_SUPPORT, yes) {
+    DEFINES += TILED_ZSTD_SUPPORT
+    LIBS += -lzstd
+}
+contains(LZ4_SUPPORT, yes) {
+    DEFINES += TILED_LZ4_SUPPORT
+    LIBS += -llz4
+}
+
 DEFINES += QT_NO_CAST_FROM_ASCII \
     QT_NO_CAST_TO_ASCII
 DEFINES += TILED_LIBRARY
 contains(QT_CONFIG, reduce_exports): CONFIG += hide_symbols
 
-SOURCES += compression.cpp \
+SOURCES += collisionmerger.cpp \
+    compression.cpp \
     gidmapper.cpp \
+    imagecache.cpp \
     imagelayer.cpp \
+    imageutils.cpp \
     isometricrenderer.cpp \
+    jobsystem.cpp \
     layer.cpp \
+    layerdatacache.cpp \
+    layerexportcache.cpp \
     map.cpp \
+    mapcellcache.cpp \
     mapobject.cpp \
     mapreader.cpp \
     maprenderer.cpp \
     mapwriter.cpp \
+    numberutils.cpp \
     objectgroup.cpp \
+    objectindex.cpp \
     orthogonalrenderer.cpp \
+    packedcell.cpp \
+    progresscontext.cpp \
     properties.cpp \
+    regionmask.cpp \
     staggeredrenderer.cpp \
     tile.cpp \
+    tileatlas.cpp \
     tilelayer.cpp \
     tileset.cpp \
+    trace.cpp \
     hexagonalrenderer.cpp
-HEADERS += compression.h \
+HEADERS += collisionmerger.h \
+    compression.h \
     gidmapper.h \
+    imagecache.h \
     imagelayer.h \
+    imageutils.h \
     isometricrenderer.h \
+    jobsystem.h \
     layer.h \
+    layerdatacache.h \
+    layerexportcache.h \
     map.h \
+    mapcellcache.h \
     mapobject.h \
     mapreader.h \
     mapreaderinterface.h \
     maprenderer.h \
     mapwriter.h \
     mapwriterinterface.h \
+    memoryusage.h \
+    numberutils.h \
     object.h \
     objectgroup.h \
+    objectindex.h \
     orthogonalrenderer.h \
+    packedcell.h \
+    progresscontext.h \
     properties.h \
+    randompicker.h \
+    regionbuilder.h \
+    regionmask.h \
     staggeredrenderer.h \
     terrain.h \
     tile.h \
+    tileatlas.h \
     tiled.h \
     tiled_global.h \
     tilelayer.h \
     tileset.h \
+    trace.h \
     logginginterface.h \
     hexagonalrenderer.h
 
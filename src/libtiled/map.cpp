@@ -30,15 +30,64 @@
 
 #include "map.h"
 
+#include "compression.h"
+#include "jobsystem.h"
 #include "layer.h"
+#include "memoryusage.h"
 #include "objectgroup.h"
 #include "tile.h"
 #include "tilelayer.h"
 #include "tileset.h"
 #include "mapobject.h"
 
+#include <QRunnable>
+
 using namespace Tiled;
 
+namespace {
+
+/**
+ * Replaces the references to a tileset in a single layer. Used to rewrite
+ * the layers of a map on multiple threads.
+ */
+class TilesetReferenceReplacer : public QRunnable
+{
+public:
+    TilesetReferenceReplacer(Layer *layer,
+                             Tileset *oldTileset,
+                             Tileset *newTileset)
+        : mLayer(layer)
+        , mOldTileset(oldTileset)
+        , mNewTileset(newTileset)
+    {
+        setAutoDelete(false);
+    }
+
+    void run()
+    {
+        mLayer->replaceReferencesToTileset(mOldTileset, mNewTileset);
+    }
+
+private:
+    Layer * const mLayer;
+    Tileset * const mOldTileset;
+    Tileset * const mNewTileset;
+};
+
+/**
+ * Returns whether the references in \a layer can be replaced on another
+ * thread. Tile layers that still need to be decoded are excluded, since
+ * decoding adjusts the draw margins of the map.
+ */
+bool canReplaceInParallel(const Layer *layer)
+{
+    if (layer->isTileLayer())
+        return static_cast<const TileLayer*>(layer)->isLoaded();
+    return layer->isObjectGroup();
+}
+
+} // anonymous namespace
+
 Map::Map(Orientation orientation,
          int width, int height, int tileWidth, int tileHeight):
     Object(MapType),
@@ -52,6 +101,7 @@ Map::Map(Orientation orientation,
     mStaggerAxis(StaggerY),
     mStaggerIndex(StaggerOdd),
     mLayerDataFormat(Base64Zlib),
+    mInfinite(false),
     mNextObjectId(1)
 {
 }
@@ -71,6 +121,7 @@ Map::Map(const Map &map):
     mDrawMargins(map.mDrawMargins),
     mTilesets(map.mTilesets),
     mLayerDataFormat(map.mLayerDataFormat),
+    mInfinite(map.mInfinite),
     mNextObjectId(1)
 {
     foreach (const Layer *layer, map.mLayers) {
@@ -226,8 +277,27 @@ void Map::replaceTileset(Tileset *oldTileset, Tileset *newTileset)
     const int index = mTilesets.indexOf(oldTileset);
     Q_ASSERT(index != -1);
 
-    foreach (Layer *layer, mLayers)
-        layer->replaceReferencesToTileset(oldTileset, newTileset);
+    // The layers are independent, so they are rewritten concurrently
+    QList<TilesetReferenceReplacer*> replacers;
+    foreach (Layer *layer, mLayers) {
+        if (canReplaceInParallel(layer))
+            replacers.append(new TilesetReferenceReplacer(layer, oldTileset,
+                                                          newTileset));
+        else
+            layer->replaceReferencesToTileset(oldTileset, newTileset);
+    }
+
+    if (replacers.size() > 1) {
+        JobGroup jobs;
+        foreach (TilesetReferenceReplacer *replacer, replacers)
+            jobs.start(replacer);
+        jobs.wait();
+    } else {
+        foreach (TilesetReferenceReplacer *replacer, replacers)
+            replacer->run();
+    }
+
+    qDeleteAll(replacers);
 
     mTilesets.replace(index, newTileset);
 }
@@ -241,6 +311,30 @@ bool Map::isTilesetUsed(Tileset *tileset) const
     return false;
 }
 
+QSet<Tileset*> Map::usedTilesets() const
+{
+    QSet<Tileset*> tilesets;
+    foreach (const Layer *layer, mLayers)
+        tilesets.unite(layer->usedTilesets());
+    return tilesets;
+}
+
+int Map::removeUnusedTilesets()
+{
+    const QSet<Tileset*> used = usedTilesets();
+    const int count = mTilesets.size();
+
+    QList<Tileset*>::iterator it = mTilesets.begin();
+    while (it != mTilesets.end()) {
+        if (used.contains(*it))
+            ++it;
+        else
+            it = mTilesets.erase(it);
+    }
+
+    return count - mTilesets.size();
+}
+
 
 QString Tiled::staggerAxisToString(Map::StaggerAxis staggerAxis)
 {
@@ -353,9 +447,32 @@ Map::RenderOrder Tiled::renderOrderFromString(const QString &string)
     return renderOrder;
 }
 
+bool Tiled::isLayerDataFormatSupported(Map::LayerDataFormat format)
+{
+    switch (format) {
+    case Map::Base64Zstandard:
+        return isCompressionMethodSupported(Zstandard);
+    case Map::Base64Lz4:
+        return isCompressionMethodSupported(Lz4);
+    default:
+        return true;
+    }
+}
+
 Map *Map::fromLayer(Layer *layer)
 {
     Map *result = new Map(Unknown, layer->width(), layer->height(), 0, 0);
     result->addLayer(layer);
     return result;
 }
+
+qint64 Map::memoryUsage() const
+{
+    qint64 usage = sizeof(Map) + propertiesMemoryUsage(properties());
+
+    foreach (const Layer *layer, mLayers)
+        usage += sizeof(Layer*) + layer->memoryUsage();
+
+    usage += qint64(mTilesets.size()) * sizeof(Tileset*);
+    return usage;
+}
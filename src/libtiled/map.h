@@ -37,6 +37,7 @@
 #include <QColor>
 #include <QList>
 #include <QMargins>
+#include <QSet>
 #include <QSize>
 
 namespace Tiled {
@@ -73,11 +74,13 @@ public:
      * The different formats in which the tile layer data can be stored.
      */
     enum LayerDataFormat {
-        XML        = 0,
-        Base64     = 1,
-        Base64Gzip = 2,
-        Base64Zlib = 3,
-        CSV        = 4
+        XML             = 0,
+        Base64          = 1,
+        Base64Gzip      = 2,
+        Base64Zlib      = 3,
+        CSV             = 4,
+        Base64Zstandard = 5,
+        Base64Lz4       = 6
     };
 
     /**
@@ -354,6 +357,19 @@ public:
      */
     bool isTilesetUsed(Tileset *tileset) const;
 
+    /**
+     * Returns the tilesets that are used by any layer of this map.
+     */
+    QSet<Tileset*> usedTilesets() const;
+
+    /**
+     * Removes the tilesets that are not used by any layer of this map. The
+     * remaining tilesets keep their order, so their global IDs become
+     * consecutive when the map is written. Returns the number of tilesets
+     * that were removed. The tilesets are not deleted.
+     */
+    int removeUnusedTilesets();
+
     /**
      * Creates a new map that contains the given \a layer. The map size will be
      * determined by the size of the layer.
@@ -364,6 +380,14 @@ public:
      */
     static Map *fromLayer(Layer *layer);
 
+    /**
+     * Returns whether this map is infinite. The tile layers of an infinite
+     * map are saved as chunks, leaving out the areas that have no tiles, so
+     * that large and sparse worlds stay small on disk.
+     */
+    bool isInfinite() const { return mInfinite; }
+    void setInfinite(bool infinite) { mInfinite = infinite; }
+
     LayerDataFormat layerDataFormat() const
     { return mLayerDataFormat; }
     void setLayerDataFormat(LayerDataFormat format)
@@ -388,6 +412,13 @@ public:
      */
     int takeNextObjectId() { return mNextObjectId++; }
 
+    /**
+     * Returns an estimate of the memory used by this map and its layers, in
+     * bytes. The tilesets are not included, since they may be shared with
+     * other maps.
+     */
+    qint64 memoryUsage() const;
+
 private:
     void adoptLayer(Layer *layer);
 
@@ -405,6 +436,7 @@ private:
     QList<Layer*> mLayers;
     QList<Tileset*> mTilesets;
     LayerDataFormat mLayerDataFormat;
+    bool mInfinite;
     int mNextObjectId;
 };
 
@@ -466,6 +498,13 @@ TILEDSHARED_EXPORT Map::Orientation orientationFromString(const QString &);
 TILEDSHARED_EXPORT QString renderOrderToString(Map::RenderOrder renderOrder);
 TILEDSHARED_EXPORT Map::RenderOrder renderOrderFromString(const QString &);
 
+/**
+ * Returns whether maps using the given layer data \a format can be written
+ * by this build. The Zstandard and LZ4 compressed formats depend on the
+ * compression methods that were compiled in.
+ */
+TILEDSHARED_EXPORT bool isLayerDataFormatSupported(Map::LayerDataFormat format);
+
 } // namespace Tiled
 
 #endif // MAP_H
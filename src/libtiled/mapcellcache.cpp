@@ -0,0 +1,401 @@
+/*
+ * mapcellcache.cpp
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "mapcellcache.h"
+
+#include "map.h"
+#include "tile.h"
+#include "tilelayer.h"
+#include "tileset.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QTemporaryFile>
+#include <QVector>
+
+#include <cstring>
+
+using namespace Tiled;
+
+namespace {
+
+/**
+ * The start of an entry. It is followed by a LayerEntry for each tile layer
+ * of the map, and then by the cells of the stored layers. The file is
+ * written in the byte order of the machine, since the cache is local to it.
+ */
+struct Header
+{
+    char magic[4];
+    quint32 version;
+    qint64 fileSize;
+    qint64 lastModified;
+    char hash[16];
+    quint32 layerCount;
+    quint32 reserved;
+};
+
+/**
+ * Describes the cells stored for a tile layer, which are a row-major array
+ * of width times height cell values. The offset is 0 when the layer is not
+ * stored.
+ */
+struct LayerEntry
+{
+    qint32 width;
+    qint32 height;
+    qint64 offset;
+};
+
+const char Magic[4] = { 'T', 'M', 'C', 'C' };
+const quint32 Version = 1;
+const int DataAlignment = 16;
+
+// The flags use the same bits as in gids, followed by the tileset index
+// plus one and the tile id. A value of 0 is an empty cell.
+const quint32 FlippedHorizontallyFlag   = 0x80000000;
+const quint32 FlippedVerticallyFlag     = 0x40000000;
+const quint32 FlippedAntiDiagonallyFlag = 0x20000000;
+const int TilesetShift = 21;
+const quint32 TilesetMask = 0xFF;
+const quint32 TileIdMask = (1 << TilesetShift) - 1;
+
+struct CacheData
+{
+    QMutex mutex;
+    QString directory;
+};
+
+QString entryFileName(const QString &directory, const QString &canonicalPath)
+{
+    const QByteArray hash = QCryptographicHash::hash(canonicalPath.toUtf8(),
+                                                     QCryptographicHash::Md5);
+
+    return directory + QLatin1Char('/') +
+            QString::fromLatin1(hash.toHex()) + QLatin1String(".cells");
+}
+
+QByteArray fileHash(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return QByteArray();
+
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    while (!file.atEnd())
+        hash.addData(file.read(1024 * 1024));
+
+    return hash.result();
+}
+
+void initHeader(Header &header, const QFileInfo &info, const QByteArray &hash)
+{
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, Magic, sizeof(header.magic));
+    header.version = Version;
+    header.fileSize = info.size();
+    header.lastModified = info.lastModified().toMSecsSinceEpoch();
+    std::memcpy(header.hash, hash.constData(),
+                qMin(int(sizeof(header.hash)), hash.size()));
+}
+
+/**
+ * Encodes the cells of \a tileLayer into \a cells. Returns false when a
+ * cell refers to a tileset or tile that doesn't fit in a cell value.
+ */
+bool encodeCells(const TileLayer *tileLayer,
+                 const QHash<Tileset*, int> &tilesetIndexes,
+                 QVector<quint32> &cells)
+{
+    const int width = tileLayer->width();
+    const int height = tileLayer->height();
+
+    cells.fill(0, width * height);
+    quint32 *value = cells.data();
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x, ++value) {
+            const Cell &cell = tileLayer->cellAt(x, y);
+            if (cell.isEmpty())
+                continue;
+
+            const int index = tilesetIndexes.value(cell.tile->tileset(), -1);
+            const quint32 tileId = cell.tile->id();
+            if (index == -1 || quint32(index + 1) > TilesetMask ||
+                    tileId > TileIdMask)
+                return false;
+
+            *value = (quint32(index + 1) << TilesetShift) | tileId;
+            if (cell.flippedHorizontally)
+                *value |= FlippedHorizontallyFlag;
+            if (cell.flippedVertically)
+                *value |= FlippedVerticallyFlag;
+            if (cell.flippedAntiDiagonally)
+                *value |= FlippedAntiDiagonallyFlag;
+        }
+    }
+
+    return true;
+}
+
+bool writeAll(QIODevice &device, const void *data, qint64 size)
+{
+    return device.write(static_cast<const char*>(data), size) == size;
+}
+
+} // anonymous namespace
+
+Q_GLOBAL_STATIC(CacheData, cacheData)
+
+void MapCellCache::setDirectory(const QString &path)
+{
+    CacheData *data = cacheData();
+    QMutexLocker locker(&data->mutex);
+    data->directory = path;
+}
+
+QString MapCellCache::directory()
+{
+    CacheData *data = cacheData();
+    QMutexLocker locker(&data->mutex);
+    return data->directory;
+}
+
+MapCellCache::MapCellCache(const QString &fileName)
+    : mData(0)
+    , mSize(0)
+{
+    const QString cacheDirectory = directory();
+    if (cacheDirectory.isEmpty())
+        return;
+
+    const QFileInfo info(fileName);
+    const QString canonicalPath = info.canonicalFilePath();
+    if (canonicalPath.isEmpty())
+        return;
+
+    mFile.setFileName(entryFileName(cacheDirectory, canonicalPath));
+    if (!mFile.open(QIODevice::ReadOnly))
+        return;
+
+    const qint64 size = mFile.size();
+    if (size < qint64(sizeof(Header)))
+        return;
+
+    uchar *data = mFile.map(0, size);
+    if (!data)
+        return;
+
+    Header header;
+    std::memcpy(&header, data, sizeof(header));
+
+    // The quick checks come first, so that the file is only hashed when the
+    // entry is likely to be valid
+    Header expected;
+    initHeader(expected, info, QByteArray());
+
+    bool valid = std::memcmp(header.magic, expected.magic,
+                             sizeof(header.magic)) == 0 &&
+            header.version == expected.version &&
+            header.fileSize == expected.fileSize &&
+            header.lastModified == expected.lastModified &&
+            size >= qint64(sizeof(Header)) +
+                    qint64(header.layerCount) * qint64(sizeof(LayerEntry));
+
+    if (valid) {
+        const QByteArray hash = fileHash(canonicalPath);
+        valid = hash.size() == int(sizeof(header.hash)) &&
+                std::memcmp(header.hash, hash.constData(),
+                            sizeof(header.hash)) == 0;
+    }
+
+    if (!valid) {
+        mFile.unmap(data);
+        mFile.close();
+        return;
+    }
+
+    mData = data;
+    mSize = size;
+}
+
+MapCellCache::~MapCellCache()
+{
+    if (mData)
+        mFile.unmap(const_cast<uchar*>(mData));
+}
+
+bool MapCellCache::readLayer(int index, const Map *map,
+                             TileLayer *tileLayer) const
+{
+    if (!mData || index < 0)
+        return false;
+
+    Header header;
+    std::memcpy(&header, mData, sizeof(header));
+    if (quint32(index) >= header.layerCount)
+        return false;
+
+    LayerEntry entry;
+    std::memcpy(&entry, mData + sizeof(Header) + index * sizeof(LayerEntry),
+                sizeof(entry));
+
+    const int width = tileLayer->width();
+    const int height = tileLayer->height();
+    const qint64 cellCount = qint64(width) * height;
+
+    if (entry.offset < qint64(sizeof(Header)) ||
+            entry.width != width || entry.height != height ||
+            entry.offset % sizeof(quint32) != 0 ||
+            entry.offset + cellCount * qint64(sizeof(quint32)) > mSize)
+        return false;
+
+    const quint32 *cells = reinterpret_cast<const quint32*>(mData + entry.offset);
+    const int tilesetCount = map->tilesetCount();
+
+    // Check all cells before changing the layer, since it is decoded from
+    // the map file instead when anything doesn't match
+    for (qint64 i = 0; i < cellCount; ++i) {
+        const quint32 value = cells[i];
+        if (!value)
+            continue;
+
+        const int tilesetIndex = int((value >> TilesetShift) & TilesetMask) - 1;
+        if (tilesetIndex < 0 || tilesetIndex >= tilesetCount)
+            return false;
+        if (int(value & TileIdMask) >= map->tilesetAt(tilesetIndex)->tileCount())
+            return false;
+    }
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            const quint32 value = *cells++;
+            if (!value)
+                continue;
+
+            const int tilesetIndex = int((value >> TilesetShift) & TilesetMask) - 1;
+            Tileset *tileset = map->tilesetAt(tilesetIndex);
+
+            Cell cell(tileset->tileAt(int(value & TileIdMask)));
+            cell.flippedHorizontally = value & FlippedHorizontallyFlag;
+            cell.flippedVertically = value & FlippedVerticallyFlag;
+            cell.flippedAntiDiagonally = value & FlippedAntiDiagonallyFlag;
+            tileLayer->setCell(x, y, cell);
+        }
+    }
+
+    return true;
+}
+
+bool MapCellCache::write(const QString &fileName, const Map *map)
+{
+    const QString cacheDirectory = directory();
+    if (cacheDirectory.isEmpty() || map->isInfinite())
+        return false;
+
+    const QFileInfo info(fileName);
+    const QString canonicalPath = info.canonicalFilePath();
+    if (canonicalPath.isEmpty() || !QDir().mkpath(cacheDirectory))
+        return false;
+
+    const QByteArray hash = fileHash(canonicalPath);
+    if (hash.isEmpty())
+        return false;
+
+    QHash<Tileset*, int> tilesetIndexes;
+    for (int i = 0; i < map->tilesetCount(); ++i)
+        tilesetIndexes.insert(map->tilesetAt(i), i);
+
+    const QList<TileLayer*> tileLayers = map->tileLayers();
+
+    Header header;
+    initHeader(header, info, hash);
+    header.layerCount = tileLayers.size();
+
+    QVector<LayerEntry> entries(tileLayers.size());
+
+    QTemporaryFile file(cacheDirectory + QLatin1String("/XXXXXX.tmp"));
+    if (!file.open())
+        return false;
+
+    // The layer table is written again once the offsets are known
+    if (!writeAll(file, &header, sizeof(header)) ||
+            !writeAll(file, entries.constData(),
+                      entries.size() * sizeof(LayerEntry)))
+        return false;
+
+    QVector<quint32> cells;
+    for (int i = 0; i < tileLayers.size(); ++i) {
+        const TileLayer *tileLayer = tileLayers.at(i);
+        LayerEntry &entry = entries[i];
+        entry.width = tileLayer->width();
+        entry.height = tileLayer->height();
+        entry.offset = 0;
+
+        // Leave hidden layers that are decoded lazily as they are
+        if (!tileLayer->isLoaded() ||
+                !encodeCells(tileLayer, tilesetIndexes, cells))
+            continue;
+
+        qint64 offset = file.pos();
+        const qint64 padding = (DataAlignment - offset % DataAlignment) %
+                DataAlignment;
+        if (padding > 0) {
+            const char zeros[DataAlignment] = { 0 };
+            if (!writeAll(file, zeros, padding))
+                return false;
+            offset += padding;
+        }
+
+        if (!writeAll(file, cells.constData(),
+                      qint64(cells.size()) * qint64(sizeof(quint32))))
+            return false;
+
+        entry.offset = offset;
+    }
+
+    if (!file.seek(sizeof(Header)) ||
+            !writeAll(file, entries.constData(),
+                      entries.size() * sizeof(LayerEntry)))
+        return false;
+
+    file.close();
+
+    const QString entryName = entryFileName(cacheDirectory, canonicalPath);
+    QFile::remove(entryName);
+    if (!file.rename(entryName))
+        return false;
+
+    file.setAutoRemove(false);
+    return true;
+}
@@ -0,0 +1,97 @@
+/*
+ * mapcellcache.h
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MAPCELLCACHE_H
+#define MAPCELLCACHE_H
+
+#include "tiled_global.h"
+
+#include <QFile>
+#include <QString>
+
+namespace Tiled {
+
+class Map;
+class TileLayer;
+
+/**
+ * A cache on disk of the decoded cells of the tile layers of map files, so
+ * that large maps can be opened again without decoding their layer data.
+ *
+ * Each map file has an entry, which is only used as long as the size,
+ * modification time and MD5 hash of the file match the ones it was written
+ * for. The cells are stored as 32-bit values referring to the tilesets by
+ * their index, so that the entry can be memory mapped and used in place.
+ *
+ * The caching is disabled until a directory has been set.
+ */
+class TILEDSHARED_EXPORT MapCellCache
+{
+public:
+    /**
+     * Sets the directory in which the entries are stored. An empty \a path,
+     * the default, disables the cache. The directory is created when needed.
+     */
+    static void setDirectory(const QString &path);
+    static QString directory();
+
+    /**
+     * Opens the entry for the map stored in \a fileName. It is only valid
+     * when it was written for the current contents of the file.
+     */
+    explicit MapCellCache(const QString &fileName);
+    ~MapCellCache();
+
+    bool isValid() const { return mData != 0; }
+
+    /**
+     * Sets the cells of \a tileLayer from the entry, when it stores the
+     * tile layer at \a index, counting only the tile layers of the map.
+     * The tilesets are looked up in \a map. Returns false when the layer is
+     * not stored or it doesn't match \a tileLayer.
+     */
+    bool readLayer(int index, const Map *map, TileLayer *tileLayer) const;
+
+    /**
+     * Writes the entry for the \a map that was just read from or saved to
+     * \a fileName. Tile layers that are not loaded yet are left out, as
+     * well as layers whose tiles can't be referred to by the entry.
+     */
+    static bool write(const QString &fileName, const Map *map);
+
+private:
+    Q_DISABLE_COPY(MapCellCache)
+
+    QFile mFile;
+    const uchar *mData;
+    qint64 mSize;
+};
+
+} // namespace Tiled
+
+#endif // MAPCELLCACHE_H
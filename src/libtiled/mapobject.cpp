@@ -30,11 +30,139 @@
 #include "mapobject.h"
 
 #include "map.h"
+#include "memoryusage.h"
 #include "objectgroup.h"
 #include "tile.h"
 
+#include <QMutex>
+#include <QMutexLocker>
+#include <QVector>
+
+#include <new>
+
 using namespace Tiled;
 
+namespace {
+
+// The number of objects the pool allocates memory for at once
+const int ObjectsPerChunk = 256;
+
+// The size of each slot, rounded up to keep the objects aligned
+const size_t SlotSize = (sizeof(MapObject) + 15) & ~size_t(15);
+
+/**
+ * Hands out memory for map objects from chunks with room for many objects.
+ * Freed slots are kept in a free list, and when no objects remain all but
+ * the first chunk are released again.
+ */
+class MapObjectPool
+{
+public:
+    MapObjectPool()
+        : mFreeList(0)
+        , mLiveCount(0)
+    {}
+
+    ~MapObjectPool()
+    {
+        // Objects still alive at exit are leaked along with their chunks
+        if (mLiveCount == 0)
+            qDeleteAll(mChunks);
+    }
+
+    void *allocate()
+    {
+        QMutexLocker locker(&mMutex);
+
+        if (!mFreeList)
+            addChunk();
+
+        void *slot = mFreeList;
+        mFreeList = *static_cast<void**>(slot);
+        ++mLiveCount;
+        return slot;
+    }
+
+    void release(void *slot)
+    {
+        QMutexLocker locker(&mMutex);
+
+        *static_cast<void**>(slot) = mFreeList;
+        mFreeList = slot;
+
+        if (--mLiveCount == 0 && mChunks.size() > 1)
+            releaseChunks();
+    }
+
+private:
+    struct Chunk
+    {
+        char data[ObjectsPerChunk * SlotSize];
+    };
+
+    void addChunk()
+    {
+        Chunk *chunk = new Chunk;
+        mChunks.append(chunk);
+        addToFreeList(chunk);
+    }
+
+    void addToFreeList(Chunk *chunk)
+    {
+        for (int i = ObjectsPerChunk - 1; i >= 0; --i) {
+            void *slot = chunk->data + i * SlotSize;
+            *static_cast<void**>(slot) = mFreeList;
+            mFreeList = slot;
+        }
+    }
+
+    void releaseChunks()
+    {
+        for (int i = 1; i < mChunks.size(); ++i)
+            delete mChunks.at(i);
+        mChunks.resize(1);
+
+        mFreeList = 0;
+        addToFreeList(mChunks.first());
+    }
+
+    QMutex mMutex;
+    void *mFreeList;
+    int mLiveCount;
+    QVector<Chunk*> mChunks;
+};
+
+} // anonymous namespace
+
+Q_GLOBAL_STATIC(MapObjectPool, objectPool)
+
+void *MapObject::operator new(size_t size)
+{
+    // Subclasses don't fit in the slots
+    if (size != sizeof(MapObject))
+        return ::operator new(size);
+
+    if (MapObjectPool *pool = objectPool())
+        return pool->allocate();
+
+    return ::operator new(size);
+}
+
+void MapObject::operator delete(void *pointer, size_t size)
+{
+    if (!pointer)
+        return;
+
+    if (size != sizeof(MapObject)) {
+        ::operator delete(pointer);
+        return;
+    }
+
+    // After the pool was destroyed at exit, the memory is left alone
+    if (MapObjectPool *pool = objectPool())
+        pool->release(pointer);
+}
+
 MapObject::MapObject():
     Object(MapObjectType),
     mId(0),
@@ -62,6 +190,18 @@ MapObject::MapObject(const QString &name, const QString &type,
 {
 }
 
+/**
+ * Drops the geometry cached by renderers and lets the object group know that
+ * this object may have moved from its \a oldBounds.
+ */
+void MapObject::geometryChanged(const QRectF &oldBounds)
+{
+    mRendererCache.key = 0;
+
+    if (mObjectGroup)
+        mObjectGroup->objectGeometryChanged(this, oldBounds);
+}
+
 QRectF MapObject::boundsUseTile() const
 {
     if (mCell.isEmpty()) {
@@ -109,6 +249,8 @@ void MapObject::flip(FlipDirection direction)
             mCell.flippedVertically = !mCell.flippedVertically;
     }
 
+    geometryChanged();
+
     if (!mPolygon.isEmpty()) {
         const QPointF center2 = mPolygon.boundingRect().center() * 2;
 
@@ -132,3 +274,13 @@ MapObject *MapObject::clone() const
     o->setRotation(mRotation);
     return o;
 }
+
+qint64 MapObject::memoryUsage() const
+{
+    return sizeof(MapObject) +
+            stringMemoryUsage(mName) +
+            stringMemoryUsage(mType) +
+            polygonMemoryUsage(mPolygon) +
+            propertiesMemoryUsage(properties()) +
+            pathMemoryUsage(mRendererCache.shape);
+}
@@ -35,6 +35,7 @@
 #include "tiled.h"
 #include "tilelayer.h"
 
+#include <QPainterPath>
 #include <QPolygonF>
 #include <QSizeF>
 #include <QString>
@@ -116,7 +117,8 @@ public:
     /**
      * Sets the position of this object.
      */
-    void setPosition(const QPointF &pos) { mPos = pos; }
+    void setPosition(const QPointF &pos)
+    { const QRectF oldBounds = bounds(); mPos = pos; geometryChanged(oldBounds); }
 
     /**
      * Returns the x position of this object.
@@ -126,7 +128,8 @@ public:
     /**
      * Sets the x position of this object.
      */
-    void setX(qreal x) { mPos.setX(x); }
+    void setX(qreal x)
+    { const QRectF oldBounds = bounds(); mPos.setX(x); geometryChanged(oldBounds); }
 
     /**
      * Returns the y position of this object.
@@ -136,7 +139,8 @@ public:
     /**
      * Sets the x position of this object.
      */
-    void setY(qreal y) { mPos.setY(y); }
+    void setY(qreal y)
+    { const QRectF oldBounds = bounds(); mPos.setY(y); geometryChanged(oldBounds); }
 
     /**
      * Returns the size of this object.
@@ -146,7 +150,8 @@ public:
     /**
      * Sets the size of this object.
      */
-    void setSize(const QSizeF &size) { mSize = size; }
+    void setSize(const QSizeF &size)
+    { const QRectF oldBounds = bounds(); mSize = size; geometryChanged(oldBounds); }
 
     void setSize(qreal width, qreal height)
     { setSize(QSizeF(width, height)); }
@@ -159,7 +164,8 @@ public:
     /**
      * Sets the width of this object.
      */
-    void setWidth(qreal width) { mSize.setWidth(width); }
+    void setWidth(qreal width)
+    { const QRectF oldBounds = bounds(); mSize.setWidth(width); geometryChanged(oldBounds); }
 
     /**
      * Returns the height of this object.
@@ -169,7 +175,8 @@ public:
     /**
      * Sets the height of this object.
      */
-    void setHeight(qreal height) { mSize.setHeight(height); }
+    void setHeight(qreal height)
+    { const QRectF oldBounds = bounds(); mSize.setHeight(height); geometryChanged(oldBounds); }
 
     /**
      * Sets the polygon associated with this object. The polygon is only used
@@ -177,7 +184,8 @@ public:
      *
      * \sa setShape()
      */
-    void setPolygon(const QPolygonF &polygon) { mPolygon = polygon; }
+    void setPolygon(const QPolygonF &polygon)
+    { mPolygon = polygon; geometryChanged(); }
 
     /**
      * Returns the polygon associated with this object. Returns an empty
@@ -188,7 +196,7 @@ public:
     /**
      * Sets the shape of the object.
      */
-    void setShape(Shape shape) { mShape = shape; }
+    void setShape(Shape shape) { mShape = shape; geometryChanged(); }
 
     /**
      * Returns the shape of the object.
@@ -211,7 +219,7 @@ public:
      *
      * \warning The object shape is ignored for tile objects!
      */
-    void setCell(const Cell &cell) { mCell = cell; }
+    void setCell(const Cell &cell) { mCell = cell; geometryChanged(); }
 
     /**
      * Returns the tile associated with this object.
@@ -238,7 +246,7 @@ public:
     /**
      * Sets the rotation of the object in degrees.
      */
-    void setRotation(qreal rotation) { mRotation = rotation; }
+    void setRotation(qreal rotation) { mRotation = rotation; geometryChanged(); }
 
     Alignment alignment() const;
 
@@ -257,7 +265,43 @@ public:
      */
     MapObject *clone() const;
 
+    /**
+     * Returns an estimate of the memory used by this object, including its
+     * polygon, its properties and the shape cached by the renderer.
+     */
+    qint64 memoryUsage() const;
+
+    /**
+     * Map objects are allocated from a pool, since maps may contain a great
+     * many of them. This avoids a call to the general allocator for each
+     * object when loading a map and makes deleting them cheap.
+     */
+    static void *operator new(size_t size);
+    static void operator delete(void *pointer, size_t size);
+
 private:
+    /**
+     * Geometry of this object as computed by the renderer identified by
+     * \c key. It is dropped whenever the geometry of this object changes.
+     */
+    struct RendererCache
+    {
+        RendererCache()
+            : key(0)
+            , hasBoundingRect(false)
+            , hasShape(false)
+        {}
+
+        unsigned key;
+        bool hasBoundingRect;
+        bool hasShape;
+        QRectF boundingRect;
+        QPainterPath shape;
+    };
+
+    void geometryChanged() { geometryChanged(bounds()); }
+    void geometryChanged(const QRectF &oldBounds);
+
     int mId;
     QString mName;
     QString mType;
@@ -269,6 +313,9 @@ private:
     ObjectGroup *mObjectGroup;
     qreal mRotation;
     bool mVisible;
+
+    mutable RendererCache mRendererCache;
+    friend class MapRenderer;
 };
 
 } // namespace Tiled
@@ -32,19 +32,29 @@
 
 #include "compression.h"
 #include "gidmapper.h"
+#include "imagecache.h"
 #include "imagelayer.h"
+#include "jobsystem.h"
 #include "objectgroup.h"
 #include "map.h"
+#include "mapcellcache.h"
 #include "mapobject.h"
+#include "maprenderer.h"
+#include "progresscontext.h"
 #include "tile.h"
 #include "tilelayer.h"
 #include "tileset.h"
 #include "terrain.h"
+#include "trace.h"
 
+#include <QBuffer>
 #include <QCoreApplication>
 #include <QDebug>
 #include <QDir>
 #include <QFileInfo>
+#include <QImageReader>
+#include <QRunnable>
+#include <QSet>
 #include <QVector>
 #include <QXmlStreamReader>
 
@@ -54,6 +64,99 @@ using namespace Tiled::Internal;
 namespace Tiled {
 namespace Internal {
 
+/**
+ * Decodes the data of a single tile layer. Used to decode the layers on
+ * multiple threads once the XML has been read.
+ *
+ * The cells are decoded into a separate layer, which is not part of any map,
+ * so that the decoding does not touch any shared state.
+ */
+class LayerDataDecoder : public QRunnable
+{
+public:
+    LayerDataDecoder(TileLayer *tileLayer,
+                     const GidMapper &gidMapper,
+                     const QString &encoding,
+                     const QString &compression,
+                     const QString &text);
+    ~LayerDataDecoder();
+
+    void run();
+
+    TileLayer *mTileLayer;
+    TileLayer *mDecodedLayer;
+    QString mError;
+
+private:
+    const GidMapper mGidMapper;
+    const QString mEncoding;
+    const QString mCompression;
+    const QString mText;
+};
+
+/**
+ * Keeps the data of a tile layer as it was read, without decoding it. The
+ * data is only decoded once the cells of the layer are needed. Used for the
+ * hidden layers when lazy layer decoding is enabled.
+ */
+class EncodedLayerData : public TileLayerLoader
+{
+public:
+    EncodedLayerData(const GidMapper &gidMapper,
+                     Map::LayerDataFormat format,
+                     const QString &encoding,
+                     const QString &compression,
+                     const QStringRef &text);
+
+    void load(TileLayer *tileLayer);
+    TileLayerLoader *clone() const;
+    QString encodedData(Map::LayerDataFormat format,
+                        const GidMapper &gidMapper) const;
+    qint64 memoryUsage() const;
+
+private:
+    const GidMapper mGidMapper;
+    const Map::LayerDataFormat mFormat;
+    const QString mEncoding;
+    const QString mCompression;
+    const QByteArray mText;     // Latin-1 is enough for base64 and CSV
+};
+
+/**
+ * Decodes the external image of a tileset. Used to decode the images on
+ * multiple threads while the rest of the map is being read.
+ */
+class TilesetImageDecoder : public QRunnable
+{
+public:
+    TilesetImageDecoder(MapReaderPrivate *reader,
+                        Tileset *tileset,
+                        const QString &source);
+
+    void run();
+
+    Tileset *mTileset;
+    const QString mSource;
+    QImage mImage;
+
+private:
+    MapReaderPrivate *mReader;
+};
+
+/**
+ * An image that is converted to pixmaps once it is back on the GUI thread.
+ * Either the tileset image, the image of a single tile (when tileId is not
+ * -1) or the image of an image layer.
+ */
+struct DeferredImage
+{
+    Tileset *tileset;
+    int tileId;
+    ImageLayer *imageLayer;
+    QImage image;
+    QString source;
+};
+
 class MapReaderPrivate
 {
     Q_DECLARE_TR_FUNCTIONS(MapReader)
@@ -64,7 +167,17 @@ public:
     MapReaderPrivate(MapReader *mapReader):
         p(mapReader),
         mMap(0),
-        mReadingExternalTileset(false)
+        mReadingExternalTileset(false),
+        mParallelLayerDecoding(false),
+        mLazyLayerDecoding(false),
+        mMemoryMapping(false),
+        mDeferImages(false),
+        mParallelImageDecoding(false),
+        mLoadImages(true),
+        mProgress(0),
+        mCellCache(0),
+        mTileLayerIndex(0),
+        mRoot(this)
     {}
 
     Map *readMap(QIODevice *device, const QString &path);
@@ -74,10 +187,15 @@ public:
 
     QString errorString() const;
 
+    QImage readExternalImage(const QString &source)
+    { return p->readExternalImage(source); }
+
 private:
     void readUnknownElement();
 
     Map *readMap();
+    bool isFilteredLayer() const;
+    void checkProgress(int layersRead);
 
     Tileset *readTileset();
     void readTilesetTile(Tileset *tileset);
@@ -86,11 +204,19 @@ private:
     QImage readImage();
 
     TileLayer *readLayer();
-    void readLayerData(TileLayer *tileLayer);
-    void decodeBinaryLayerData(TileLayer *tileLayer,
-                               const QStringRef &text,
-                               const QStringRef &compression);
-    void decodeCSVLayerData(TileLayer *tileLayer, const QString &text);
+    void readLayerData(TileLayer *tileLayer, int index);
+    void readTileData(TileLayer *tileLayer,
+                      const QStringRef &encoding,
+                      const QStringRef &compression);
+    void readTileElements(TileLayer *tileLayer,
+                          const QStringRef &compression);
+    void readChunk(TileLayer *tileLayer,
+                   const QStringRef &encoding,
+                   const QStringRef &compression);
+    void decodePendingLayerData();
+    bool decodeTilesetImageInBackground(Tileset *tileset,
+                                        const QString &source);
+    void finishPendingImages();
 
     /**
      * Returns the cell for the given global tile ID. Errors are raised with
@@ -102,6 +228,9 @@ private:
      */
     Cell cellForGid(unsigned gid);
 
+    void deferImage(Tileset *tileset, int tileId, ImageLayer *imageLayer,
+                    const QImage &image, const QString &source);
+
     ImageLayer *readImageLayer();
     void readImageLayerImage(ImageLayer *imageLayer);
 
@@ -121,6 +250,27 @@ private:
     QList<Tileset*> mCreatedTilesets;
     GidMapper mGidMapper;
     bool mReadingExternalTileset;
+    bool mParallelLayerDecoding;
+    bool mLazyLayerDecoding;
+    bool mMemoryMapping;
+    bool mDeferImages;
+    bool mParallelImageDecoding;
+    bool mLoadImages;
+    QSet<QString> mLayerFilter;
+    ProgressContext *mProgress;
+    const MapCellCache *mCellCache;
+    int mTileLayerIndex;
+    QList<LayerDataDecoder*> mPendingDecoders;
+    QList<DeferredImage> mDeferredImages;
+
+    /**
+     * The reader of the map, which also decodes the images of the external
+     * tilesets it references. Points to this reader when it is not reading
+     * an external tileset for another one.
+     */
+    MapReaderPrivate *mRoot;
+    JobGroup mImageJobs;
+    QList<TilesetImageDecoder*> mPendingImages;
 
     QXmlStreamReader xml;
 };
@@ -128,8 +278,521 @@ private:
 } // namespace Internal
 } // namespace Tiled
 
+/**
+ * Returns the cell for the given global tile ID. When the gid is invalid,
+ * \a error is set unless an earlier error was already recorded.
+ */
+static Cell cellForGid(const GidMapper &gidMapper, unsigned gid,
+                       QString *error)
+{
+    bool ok;
+    const Cell result = gidMapper.gidToCell(gid, ok);
+
+    if (!ok && error->isEmpty()) {
+        if (gidMapper.isEmpty())
+            *error = QCoreApplication::translate("MapReader",
+                                                 "Tile used but no tilesets specified");
+        else
+            *error = QCoreApplication::translate("MapReader",
+                                                 "Invalid tile: %1").arg(gid);
+    }
+
+    return result;
+}
+
+namespace {
+
+/**
+ * Converts decoded layer data to cells as it comes in. The data can be
+ * passed in blocks of any size, so it never needs to be stored as a whole.
+ */
+class GidReader
+{
+public:
+    GidReader(TileLayer *tileLayer, const GidMapper &gidMapper)
+        : mTileLayer(tileLayer)
+        , mGidMapper(gidMapper)
+        , mX(0)
+        , mY(0)
+        , mPartialSize(0)
+    {}
+
+    /**
+     * Adds the next block of data. Returns false when there is more data
+     * than fits in the layer.
+     */
+    bool append(const unsigned char *data, int size)
+    {
+        // Complete a gid that was split between blocks
+        while (mPartialSize > 0 && size > 0) {
+            mPartial[mPartialSize++] = *data++;
+            --size;
+
+            if (mPartialSize == 4) {
+                mPartialSize = 0;
+                if (!addGid(mPartial))
+                    return false;
+            }
+        }
+
+        for (; size >= 4; data += 4, size -= 4)
+            if (!addGid(data))
+                return false;
+
+        while (size-- > 0)
+            mPartial[mPartialSize++] = *data++;
+
+        return true;
+    }
+
+    /**
+     * Returns whether exactly one gid was read for every cell.
+     */
+    bool isComplete() const
+    { return mY == mTileLayer->height() && mPartialSize == 0; }
+
+    QString mError;
+
+private:
+    bool addGid(const unsigned char *data)
+    {
+        if (mY >= mTileLayer->height())
+            return false;
+
+        const unsigned gid = data[0] |
+                             data[1] << 8 |
+                             data[2] << 16 |
+                             data[3] << 24;
+
+        mTileLayer->setCell(mX, mY, cellForGid(mGidMapper, gid, &mError));
+
+        if (++mX == mTileLayer->width()) {
+            mX = 0;
+            ++mY;
+        }
+
+        return true;
+    }
+
+    TileLayer *mTileLayer;
+    const GidMapper &mGidMapper;
+    int mX;
+    int mY;
+    unsigned char mPartial[4];
+    int mPartialSize;
+};
+
+/**
+ * Receives the base64 decoded layer data and decompresses it into the
+ * GidReader in bounded buffers. Zstandard and LZ4 compressed data is
+ * collected and decompressed in one go.
+ */
+class BinaryDataSink
+{
+public:
+    BinaryDataSink(GidReader &reader, bool compressed,
+                   CompressionMethod method, int expectedSize)
+        : mReader(reader)
+        , mCompressed(compressed)
+        , mMethod(method)
+        , mExpectedSize(expectedSize)
+        , mDecompressor(0)
+    {
+        if (compressed && (method == Zlib || method == Gzip))
+            mDecompressor = new Decompressor;
+    }
+
+    ~BinaryDataSink()
+    {
+        delete mDecompressor;
+    }
+
+    bool write(const char *data, int size)
+    {
+        if (!mCompressed)
+            return mReader.append(reinterpret_cast<const unsigned char*>(data), size);
+
+        if (!mDecompressor) {
+            mCompressedData.append(data, size);
+            return true;
+        }
+
+        // Data following the end of the compressed stream is an error
+        if (mDecompressor->isFinished())
+            return size == 0;
+
+        mDecompressor->setInput(data, size);
+
+        for (;;) {
+            const int length = mDecompressor->read(mBuffer, BufferSize);
+            if (length < 0)
+                return false;
+            if (length == 0)
+                break;
+            if (!mReader.append(reinterpret_cast<const unsigned char*>(mBuffer), length))
+                return false;
+        }
+
+        return mDecompressor->isFinished() ? mDecompressor->needsInput() : true;
+    }
+
+    bool finish()
+    {
+        if (mDecompressor)
+            return mDecompressor->isFinished();
+
+        if (mCompressed) {
+            const QByteArray tileData = decompress(mCompressedData,
+                                                   mExpectedSize,
+                                                   mMethod);
+            return mReader.append(reinterpret_cast<const unsigned char*>(tileData.constData()),
+                                  tileData.size());
+        }
+
+        return true;
+    }
+
+    enum { BufferSize = 16384 };
+
+private:
+    GidReader &mReader;
+    const bool mCompressed;
+    const CompressionMethod mMethod;
+    const int mExpectedSize;
+    Decompressor *mDecompressor;
+    QByteArray mCompressedData;
+    char mBuffer[BufferSize];
+};
+
+} // anonymous namespace
+
+static int base64Value(ushort c)
+{
+    if (c >= 'A' && c <= 'Z')
+        return c - 'A';
+    if (c >= 'a' && c <= 'z')
+        return c - 'a' + 26;
+    if (c >= '0' && c <= '9')
+        return c - '0' + 52;
+    if (c == '+')
+        return 62;
+    if (c == '/')
+        return 63;
+    return -1;
+}
+
+/**
+ * Decodes base64 encoded and optionally compressed layer data. The text is
+ * decoded in blocks, which are decompressed and converted to cells in turn,
+ * to avoid keeping several full size copies of the layer data around.
+ */
+static QString decodeBinaryLayerData(TileLayer *tileLayer,
+                                     const GidMapper &gidMapper,
+                                     const QStringRef &text,
+                                     const QString &compression)
+{
+    const int size = (tileLayer->width() * tileLayer->height()) * 4;
+
+    CompressionMethod method = Zlib;
+    bool compressed = !compression.isEmpty();
+
+    if (compression == QLatin1String("zstd"))
+        method = Zstandard;
+    else if (compression == QLatin1String("lz4"))
+        method = Lz4;
+    else if (compression == QLatin1String("gzip"))
+        method = Gzip;
+    else if (compression != QLatin1String("zlib"))
+        compressed = false;
+
+    if (!compression.isEmpty() &&
+            !(compressed && isCompressionMethodSupported(method))) {
+        return QCoreApplication::translate("MapReader",
+                                           "Compression method '%1' not supported")
+                .arg(compression);
+    }
+
+    GidReader reader(tileLayer, gidMapper);
+    BinaryDataSink sink(reader, compressed, method, size);
+
+    char decoded[BinaryDataSink::BufferSize];
+    int decodedSize = 0;
+    unsigned bits = 0;
+    int bitCount = 0;
+    bool ok = true;
+
+    const QChar *c = text.unicode();
+    const QChar *end = c + text.size();
+
+    for (; c != end && ok; ++c) {
+        const int value = base64Value(c->unicode());
+        if (value == -1) {
+            if (*c == QLatin1Char('='))
+                break;
+            continue;   // Skip whitespace
+        }
+
+        bits = (bits << 6) | value;
+        bitCount += 6;
+
+        if (bitCount >= 8) {
+            bitCount -= 8;
+            decoded[decodedSize++] = char(bits >> bitCount);
+            bits &= (1 << bitCount) - 1;
+
+            if (decodedSize == BinaryDataSink::BufferSize) {
+                ok = sink.write(decoded, decodedSize);
+                decodedSize = 0;
+            }
+        }
+    }
+
+    ok = ok && sink.write(decoded, decodedSize) && sink.finish();
+
+    if (!ok || !reader.isComplete()) {
+        return QCoreApplication::translate("MapReader",
+                                           "Corrupt layer data for layer '%1'")
+                .arg(tileLayer->name());
+    }
+
+    return reader.mError;
+}
+
+/**
+ * Parses comma separated gids directly from the text, without splitting it
+ * into separate strings first. Whitespace around the values is ignored.
+ */
+static QString decodeCSVLayerData(TileLayer *tileLayer,
+                                  const GidMapper &gidMapper,
+                                  const QStringRef &text)
+{
+    const int width = tileLayer->width();
+    const int cellCount = width * tileLayer->height();
+
+    const QChar *c = text.unicode();
+    const QChar *end = c + text.size();
+    int index = 0;
+    QString error;
+
+    for (;;) {
+        while (c != end && c->isSpace())
+            ++c;
+
+        quint64 gid = 0;
+        const QChar *digitsBegin = c;
+
+        while (c != end && gid <= 0xFFFFFFFFu) {
+            const ushort digit = c->unicode() - '0';
+            if (digit > 9)
+                break;
+            gid = gid * 10 + digit;
+            ++c;
+        }
+
+        const bool validNumber = c != digitsBegin && gid <= 0xFFFFFFFFu;
+
+        while (c != end && c->isSpace())
+            ++c;
+
+        if (index == cellCount) {
+            return QCoreApplication::translate("MapReader",
+                                               "Corrupt layer data for layer '%1'")
+                    .arg(tileLayer->name());
+        }
+
+        if (!validNumber || (c != end && *c != QLatin1Char(','))) {
+            return QCoreApplication::translate("MapReader",
+                                               "Unable to parse tile at (%1,%2) on layer '%3'")
+                    .arg(index % width + 1).arg(index / width + 1)
+                    .arg(tileLayer->name());
+        }
+
+        tileLayer->setCell(index % width, index / width,
+                           cellForGid(gidMapper, unsigned(gid), &error));
+        ++index;
+
+        if (c == end)
+            break;
+
+        ++c;    // Skip the comma
+    }
+
+    if (index != cellCount) {
+        return QCoreApplication::translate("MapReader",
+                                           "Corrupt layer data for layer '%1'")
+                .arg(tileLayer->name());
+    }
+
+    return error;
+}
+
+static QString decodeLayerData(TileLayer *tileLayer,
+                               const GidMapper &gidMapper,
+                               const QString &encoding,
+                               const QString &compression,
+                               const QStringRef &text)
+{
+    QString error;
+
+    if (encoding == QLatin1String("base64")) {
+        error = decodeBinaryLayerData(tileLayer, gidMapper,
+                                      text, compression);
+    } else if (encoding == QLatin1String("csv")) {
+        error = decodeCSVLayerData(tileLayer, gidMapper, text);
+    } else {
+        return QCoreApplication::translate("MapReader", "Unknown encoding: %1")
+                .arg(encoding);
+    }
+
+    // Content that is repeated across the layer is only kept once
+    if (error.isEmpty())
+        tileLayer->shareEqualChunks();
+
+    return error;
+}
+
+
+LayerDataDecoder::LayerDataDecoder(TileLayer *tileLayer,
+                                   const GidMapper &gidMapper,
+                                   const QString &encoding,
+                                   const QString &compression,
+                                   const QString &text)
+    : mTileLayer(tileLayer)
+    , mDecodedLayer(0)
+    , mGidMapper(gidMapper)
+    , mEncoding(encoding)
+    , mCompression(compression)
+    , mText(text)
+{
+    setAutoDelete(false);
+}
+
+LayerDataDecoder::~LayerDataDecoder()
+{
+    delete mDecodedLayer;
+}
+
+void LayerDataDecoder::run()
+{
+    TILED_TRACE_SCOPE_DETAIL("MapReader::decodeLayerData", mTileLayer->name());
+
+    mDecodedLayer = new TileLayer(mTileLayer->name(), 0, 0,
+                                  mTileLayer->width(),
+                                  mTileLayer->height());
+
+    mError = decodeLayerData(mDecodedLayer, mGidMapper,
+                             mEncoding, mCompression, QStringRef(&mText));
+}
+
+
+TilesetImageDecoder::TilesetImageDecoder(MapReaderPrivate *reader,
+                                         Tileset *tileset,
+                                         const QString &source)
+    : mTileset(tileset)
+    , mSource(source)
+    , mReader(reader)
+{
+    setAutoDelete(false);
+}
+
+void TilesetImageDecoder::run()
+{
+    TILED_TRACE_SCOPE_DETAIL("MapReader::decodeTilesetImage", mSource);
+
+    mImage = mReader->readExternalImage(mSource);
+}
+
+
+EncodedLayerData::EncodedLayerData(const GidMapper &gidMapper,
+                                   Map::LayerDataFormat format,
+                                   const QString &encoding,
+                                   const QString &compression,
+                                   const QStringRef &text)
+    : mGidMapper(gidMapper)
+    , mFormat(format)
+    , mEncoding(encoding)
+    , mCompression(compression)
+    , mText(text.toString().trimmed().toLatin1())
+{
+}
+
+void EncodedLayerData::load(TileLayer *tileLayer)
+{
+    TILED_TRACE_SCOPE_DETAIL("MapReader::decodeLayerData", tileLayer->name());
+
+    const QString text = QString::fromLatin1(mText.constData(), mText.size());
+    const QString error = decodeLayerData(tileLayer, mGidMapper,
+                                          mEncoding, mCompression,
+                                          QStringRef(&text));
+
+    // The map has been read a long time ago, so all that can be done is
+    // to report the problem
+    if (!error.isEmpty()) {
+        qWarning("Failed to decode layer '%s': %s",
+                 qPrintable(tileLayer->name()), qPrintable(error));
+    }
+}
+
+TileLayerLoader *EncodedLayerData::clone() const
+{
+    return new EncodedLayerData(*this);
+}
+
+QString EncodedLayerData::encodedData(Map::LayerDataFormat format,
+                                      const GidMapper &gidMapper) const
+{
+    if (format != mFormat || !mGidMapper.hasSameGids(gidMapper))
+        return QString();
+
+    // The writer ends CSV data with a newline
+    QString data = QString::fromLatin1(mText.constData(), mText.size());
+    if (format == Map::CSV)
+        data.append(QLatin1Char('\n'));
+    return data;
+}
+
+qint64 EncodedLayerData::memoryUsage() const
+{
+    return sizeof(EncodedLayerData) + mText.capacity();
+}
+
+/**
+ * Determines the layer data \a format used for the given \a encoding and
+ * \a compression. Returns false when they are not known.
+ */
+static bool layerDataFormat(const QStringRef &encoding,
+                            const QStringRef &compression,
+                            Map::LayerDataFormat *format)
+{
+    if (encoding.isEmpty()) {
+        *format = Map::XML;
+    } else if (encoding == QLatin1String("csv")) {
+        *format = Map::CSV;
+    } else if (encoding == QLatin1String("base64")) {
+        if (compression.isEmpty())
+            *format = Map::Base64;
+        else if (compression == QLatin1String("gzip"))
+            *format = Map::Base64Gzip;
+        else if (compression == QLatin1String("zlib"))
+            *format = Map::Base64Zlib;
+        else if (compression == QLatin1String("zstd"))
+            *format = Map::Base64Zstandard;
+        else if (compression == QLatin1String("lz4"))
+            *format = Map::Base64Lz4;
+        else
+            return false;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+
 Map *MapReaderPrivate::readMap(QIODevice *device, const QString &path)
 {
+    TILED_TRACE_SCOPE_DETAIL("MapReader::readMap", path);
+
     mError.clear();
     mPath = path;
     Map *map = 0;
@@ -161,6 +824,10 @@ Tileset *MapReaderPrivate::readTileset(QIODevice *device, const QString &path)
         xml.raiseError(tr("Not a tileset file."));
 
     mReadingExternalTileset = false;
+
+    if (mRoot == this)
+        finishPendingImages();
+
     return tileset;
 }
 
@@ -240,16 +907,20 @@ Map *MapReaderPrivate::readMap()
 
     const int nextObjectId =
             atts.value(QLatin1String("nextobjectid")).toString().toInt();
+    const bool infinite =
+            atts.value(QLatin1String("infinite")).toString().toInt();
 
     mMap = new Map(orientation, mapWidth, mapHeight, tileWidth, tileHeight);
     mMap->setHexSideLength(hexSideLength);
     mMap->setStaggerAxis(staggerAxis);
     mMap->setStaggerIndex(staggerIndex);
     mMap->setRenderOrder(renderOrder);
+    mMap->setInfinite(infinite);
     if (nextObjectId)
         mMap->setNextObjectId(nextObjectId);
 
     mCreatedTilesets.clear();
+    mTileLayerIndex = 0;
 
     QStringRef bgColorString = atts.value(QLatin1String("backgroundcolor"));
     if (!bgColorString.isEmpty())
@@ -260,6 +931,11 @@ Map *MapReaderPrivate::readMap()
             mMap->mergeProperties(readProperties());
         else if (xml.name() == QLatin1String("tileset"))
             mMap->addTileset(readTileset());
+        else if (isFilteredLayer()) {
+            if (xml.name() == QLatin1String("layer"))
+                ++mTileLayerIndex;
+            xml.skipCurrentElement();
+        }
         else if (xml.name() == QLatin1String("layer"))
             mMap->addLayer(readLayer());
         else if (xml.name() == QLatin1String("objectgroup"))
@@ -268,13 +944,19 @@ Map *MapReaderPrivate::readMap()
             mMap->addLayer(readImageLayer());
         else
             readUnknownElement();
+
+        checkProgress(mMap->layerCount());
     }
 
+    decodePendingLayerData();
+    finishPendingImages();
+
     // Clean up in case of error
     if (xml.hasError()) {
         // The tilesets are not owned by the map
         qDeleteAll(mCreatedTilesets);
         mCreatedTilesets.clear();
+        mDeferredImages.clear();
 
         delete mMap;
         mMap = 0;
@@ -283,6 +965,46 @@ Map *MapReaderPrivate::readMap()
     return mMap;
 }
 
+/**
+ * Returns whether the current element is a layer that is left out by the
+ * layer filter.
+ */
+bool MapReaderPrivate::isFilteredLayer() const
+{
+    if (mLayerFilter.isEmpty())
+        return false;
+
+    const QStringRef name = xml.name();
+    if (name != QLatin1String("layer") &&
+            name != QLatin1String("objectgroup") &&
+            name != QLatin1String("imagelayer"))
+        return false;
+
+    const QString layerName =
+            xml.attributes().value(QLatin1String("name")).toString();
+    return !mLayerFilter.contains(layerName);
+}
+
+/**
+ * Reports how much of the map has been read and stops reading when the
+ * progress context got canceled.
+ */
+void MapReaderPrivate::checkProgress(int layersRead)
+{
+    if (!mProgress || xml.hasError())
+        return;
+
+    const QIODevice *device = xml.device();
+    const qint64 size = device->isSequential() ? 0 : device->size();
+    if (size > 0)
+        mProgress->setProgress(int(device->pos() * 1000 / size), 1000);
+    else
+        mProgress->setProgress(layersRead, 0);
+
+    if (mProgress->isCanceled())
+        xml.raiseError(tr("Reading the map was canceled."));
+}
+
 Tileset *MapReaderPrivate::readTileset()
 {
     Q_ASSERT(xml.isStartElement() && xml.name() == QLatin1String("tileset"));
@@ -363,6 +1085,22 @@ Tileset *MapReaderPrivate::readTileset()
     return tileset;
 }
 
+/**
+ * Returns the size of the image with the given \a source, as stored in the
+ * attributes of its image element when the map was saved. Falls back to
+ * reading just the header of the image.
+ */
+static QSize imageSize(const QXmlStreamAttributes &atts, const QString &source)
+{
+    const QSize size(atts.value(QLatin1String("width")).toString().toInt(),
+                     atts.value(QLatin1String("height")).toString().toInt());
+    if (!size.isEmpty())
+        return size;
+
+    const QSize headerSize = QImageReader(source).size();
+    return headerSize.isValid() ? headerSize : QSize(0, 0);
+}
+
 void MapReaderPrivate::readTilesetTile(Tileset *tileset)
 {
     Q_ASSERT(xml.isStartElement() && xml.name() == QLatin1String("tile"));
@@ -417,7 +1155,19 @@ void MapReaderPrivate::readTilesetTile(Tileset *tileset)
             QString source = xml.attributes().value(QLatin1String("source")).toString();
             if (!source.isEmpty())
                 source = p->resolveReference(source, mPath);
-            tileset->setTileImage(id, QPixmap::fromImage(readImage()), source);
+            if (!mLoadImages && !source.isEmpty()) {
+                tileset->setTileImageSize(id, imageSize(xml.attributes(), source),
+                                          source);
+                xml.skipCurrentElement();
+                continue;
+            }
+            const QImage image = readImage();
+            if (mDeferImages) {
+                tileset->setTileImage(id, QPixmap(), source);
+                deferImage(tileset, id, 0, image, source);
+            } else {
+                tileset->setTileImage(id, QPixmap::fromImage(image), source);
+            }
         } else if (xml.name() == QLatin1String("objectgroup")) {
             tile->setObjectGroup(readObjectGroup());
         } else if (xml.name() == QLatin1String("animation")) {
@@ -470,8 +1220,23 @@ void MapReaderPrivate::readTilesetImage(Tileset *tileset)
     const int width = atts.value(QLatin1String("width")).toString().toInt();
     mGidMapper.setTilesetWidth(tileset, width);
 
-    if (!tileset->loadFromImage(readImage(), source))
+    // Embedded images are still read, since they would be lost otherwise
+    if (!mLoadImages && !source.isEmpty() &&
+            tileset->prepareFromImage(imageSize(atts, source), source)) {
+        xml.skipCurrentElement();
+        return;
+    }
+
+    if (mParallelImageDecoding && decodeTilesetImageInBackground(tileset, source))
+        return;
+
+    const QImage image = readImage();
+    const bool loaded = mDeferImages ? tileset->prepareFromImage(image, source)
+                                     : tileset->loadFromImage(image, source);
+    if (!loaded)
         xml.raiseError(tr("Error loading tileset image:\n'%1'").arg(source));
+    else if (mDeferImages)
+        deferImage(tileset, -1, 0, image, source);
 }
 
 QImage MapReaderPrivate::readImage()
@@ -561,6 +1326,11 @@ TileLayer *MapReaderPrivate::readLayer()
     const int width = atts.value(QLatin1String("width")).toString().toInt();
     const int height = atts.value(QLatin1String("height")).toString().toInt();
 
+    TILED_TRACE_SCOPE_DETAIL("MapReader::readLayer", name);
+
+    // The index among the tile layers, by which the cell cache knows them
+    const int index = mTileLayerIndex++;
+
     TileLayer *tileLayer = new TileLayer(name, x, y, width, height);
     readLayerAttributes(tileLayer, atts);
 
@@ -568,7 +1338,7 @@ TileLayer *MapReaderPrivate::readLayer()
         if (xml.name() == QLatin1String("properties"))
             tileLayer->mergeProperties(readProperties());
         else if (xml.name() == QLatin1String("data"))
-            readLayerData(tileLayer);
+            readLayerData(tileLayer, index);
         else
             readUnknownElement();
     }
@@ -576,7 +1346,7 @@ TileLayer *MapReaderPrivate::readLayer()
     return tileLayer;
 }
 
-void MapReaderPrivate::readLayerData(TileLayer *tileLayer)
+void MapReaderPrivate::readLayerData(TileLayer *tileLayer, int index)
 {
     Q_ASSERT(xml.isStartElement() && xml.name() == QLatin1String("data"));
 
@@ -585,20 +1355,33 @@ void MapReaderPrivate::readLayerData(TileLayer *tileLayer)
     QStringRef compression = atts.value(QLatin1String("compression"));
 
     bool respect = true; // TODO: init from preferences
-    if (respect) {
-        if (encoding.isEmpty())
-            mMap->setLayerDataFormat(Map::XML);
-        else if (encoding == QLatin1String("csv"))
-            mMap->setLayerDataFormat(Map::CSV);
-        else if (encoding == QLatin1String("base64")) {
-            if (compression.isEmpty())
-                mMap->setLayerDataFormat(Map::Base64);
-            else if (compression == QLatin1String("gzip"))
-                mMap->setLayerDataFormat(Map::Base64Gzip);
-            else if (compression == QLatin1String("zlib"))
-                mMap->setLayerDataFormat(Map::Base64Zlib);
-        }
-        // else, error handled below
+    Map::LayerDataFormat format;
+    if (respect && layerDataFormat(encoding, compression, &format))
+        mMap->setLayerDataFormat(format);
+    // else, error handled below
+
+    // Hidden layers that are decoded lazily are left to their loader
+    const bool lazy = mLazyLayerDecoding && !tileLayer->isVisible();
+    if (mCellCache && !lazy && !mMap->isInfinite() &&
+            mCellCache->readLayer(index, mMap, tileLayer)) {
+        xml.skipCurrentElement();
+        return;
+    }
+
+    readTileData(tileLayer, encoding, compression);
+}
+
+/**
+ * Reads the cells of the \a tileLayer from the contents of the current
+ * element, which is either a <data> or a <chunk> element.
+ */
+void MapReaderPrivate::readTileData(TileLayer *tileLayer,
+                                    const QStringRef &encoding,
+                                    const QStringRef &compression)
+{
+    if (encoding.isEmpty()) {
+        readTileElements(tileLayer, compression);
+        return;
     }
 
     int x = 0;
@@ -625,113 +1408,280 @@ void MapReaderPrivate::readLayerData(TileLayer *tileLayer)
                 }
 
                 xml.skipCurrentElement();
+            } else if (xml.name() == QLatin1String("chunk")) {
+                readChunk(tileLayer, encoding, compression);
             } else {
                 readUnknownElement();
             }
         } else if (xml.isCharacters() && !xml.isWhitespace()) {
-            if (encoding == QLatin1String("base64")) {
-                decodeBinaryLayerData(tileLayer,
-                                      xml.text(),
-                                      compression);
-            } else if (encoding == QLatin1String("csv")) {
-                decodeCSVLayerData(tileLayer, xml.text().toString());
-            } else {
+            if (encoding != QLatin1String("base64") &&
+                    encoding != QLatin1String("csv")) {
                 xml.raiseError(tr("Unknown encoding: %1")
                                .arg(encoding.toString()));
                 continue;
             }
+
+            Map::LayerDataFormat format;
+            if (mLazyLayerDecoding && !tileLayer->isVisible() &&
+                    layerDataFormat(encoding, compression, &format)) {
+                // Only decode hidden layers once their cells are needed
+                tileLayer->setLoader(new EncodedLayerData(mGidMapper,
+                                                          format,
+                                                          encoding.toString(),
+                                                          compression.toString(),
+                                                          xml.text()));
+            } else if (mParallelLayerDecoding) {
+                // Postpone the decoding until the whole map has been read
+                mPendingDecoders.append(
+                            new LayerDataDecoder(tileLayer,
+                                                 mGidMapper,
+                                                 encoding.toString(),
+                                                 compression.toString(),
+                                                 xml.text().toString()));
+            } else {
+                const QString error = decodeLayerData(tileLayer,
+                                                      mGidMapper,
+                                                      encoding.toString(),
+                                                      compression.toString(),
+                                                      xml.text());
+                if (!error.isEmpty())
+                    xml.raiseError(error);
+            }
         }
     }
 }
 
-void MapReaderPrivate::decodeBinaryLayerData(TileLayer *tileLayer,
-                                             const QStringRef &text,
-                                             const QStringRef &compression)
+/**
+ * Parses the decimal gid in \a text without creating a string. Returns 0,
+ * the empty cell, for anything that is not a valid gid, like the
+ * QString::toUInt() used before.
+ */
+static unsigned parseGid(const QStringRef &text)
 {
-#if QT_VERSION < 0x040800
-    const QString textData = QString::fromRawData(text.unicode(), text.size());
-    const QByteArray latin1Text = textData.toLatin1();
-#else
-    const QByteArray latin1Text = text.toLatin1();
-#endif
-    QByteArray tileData = QByteArray::fromBase64(latin1Text);
-    const int size = (tileLayer->width() * tileLayer->height()) * 4;
+    const QChar *c = text.unicode();
+    const QChar *end = c + text.size();
+    quint64 gid = 0;
 
-    if (compression == QLatin1String("zlib")
-        || compression == QLatin1String("gzip")) {
-        tileData = decompress(tileData, size);
-    } else if (!compression.isEmpty()) {
-        xml.raiseError(tr("Compression method '%1' not supported")
-                       .arg(compression.toString()));
-        return;
+    for (; c != end; ++c) {
+        const ushort digit = c->unicode() - '0';
+        if (digit > 9)
+            return 0;
+        gid = gid * 10 + digit;
+        if (gid > 0xFFFFFFFFu)
+            return 0;
     }
 
-    if (size != tileData.length()) {
-        xml.raiseError(tr("Corrupt layer data for layer '%1'")
-                       .arg(tileLayer->name()));
-        return;
-    }
+    return unsigned(gid);
+}
+
+/**
+ * Reads the cells of the \a tileLayer from <tile> elements, as stored by
+ * the XML layer data format. Since this format uses one element per cell,
+ * the work per element is kept to a minimum: the gid is parsed straight
+ * from the attribute text, the element is not skipped separately, and the
+ * cell is only looked up again when the gid differs from the previous one.
+ */
+void MapReaderPrivate::readTileElements(TileLayer *tileLayer,
+                                        const QStringRef &compression)
+{
+    const QLatin1String tileName("tile");
+    const QLatin1String gidName("gid");
+    const int width = tileLayer->width();
+    const int height = tileLayer->height();
 
-    const unsigned char *data =
-            reinterpret_cast<const unsigned char*>(tileData.constData());
     int x = 0;
     int y = 0;
+    unsigned previousGid = 0;
+    Cell previousCell;
+    QString error;
+
+    while (xml.readNext() != QXmlStreamReader::Invalid) {
+        if (xml.isEndElement()) {
+            // The <tile> elements are empty, so their end follows directly
+            if (xml.name() == tileName)
+                continue;
+            break;
+        } else if (xml.isStartElement()) {
+            if (xml.name() == tileName) {
+                if (y >= height) {
+                    xml.raiseError(tr("Too many <tile> elements"));
+                    continue;
+                }
+
+                const unsigned gid = parseGid(xml.attributes().value(gidName));
+                if (gid != previousGid) {
+                    previousCell = ::cellForGid(mGidMapper, gid, &error);
+                    previousGid = gid;
 
-    for (int i = 0; i < size - 3; i += 4) {
-        const unsigned gid = data[i] |
-                             data[i + 1] << 8 |
-                             data[i + 2] << 16 |
-                             data[i + 3] << 24;
+                    if (!error.isEmpty()) {
+                        xml.raiseError(error);
+                        continue;
+                    }
+                }
 
-        tileLayer->setCell(x, y, cellForGid(gid));
+                if (!previousCell.isEmpty())
+                    tileLayer->setCell(x, y, previousCell);
 
-        x++;
-        if (x == tileLayer->width()) {
-            x = 0;
-            y++;
+                if (++x == width) {
+                    x = 0;
+                    ++y;
+                }
+            } else if (xml.name() == QLatin1String("chunk")) {
+                readChunk(tileLayer, QStringRef(), compression);
+            } else {
+                readUnknownElement();
+            }
+        } else if (xml.isCharacters() && !xml.isWhitespace()) {
+            xml.raiseError(tr("Unknown encoding: %1").arg(QString()));
         }
     }
 }
 
-void MapReaderPrivate::decodeCSVLayerData(TileLayer *tileLayer, const QString &text)
+/**
+ * Reads a <chunk> element, which stores the cells of a part of the
+ * \a tileLayer. Infinite maps save only the chunks that contain tiles.
+ */
+void MapReaderPrivate::readChunk(TileLayer *tileLayer,
+                                 const QStringRef &encoding,
+                                 const QStringRef &compression)
 {
-    QString trimText = text.trimmed();
-    QStringList tiles = trimText.split(QLatin1Char(','));
+    Q_ASSERT(xml.isStartElement() && xml.name() == QLatin1String("chunk"));
 
-    if (tiles.length() != tileLayer->width() * tileLayer->height()) {
-        xml.raiseError(tr("Corrupt layer data for layer '%1'")
-                       .arg(tileLayer->name()));
+    const QXmlStreamAttributes atts = xml.attributes();
+    const QRect rect(atts.value(QLatin1String("x")).toString().toInt(),
+                     atts.value(QLatin1String("y")).toString().toInt(),
+                     atts.value(QLatin1String("width")).toString().toInt(),
+                     atts.value(QLatin1String("height")).toString().toInt());
+
+    if (rect.isEmpty() || !QRect(0, 0, tileLayer->width(),
+                                 tileLayer->height()).contains(rect)) {
+        xml.raiseError(tr("Invalid chunk at %1,%2")
+                       .arg(rect.x()).arg(rect.y()));
         return;
     }
 
-    for (int y = 0; y < tileLayer->height(); y++) {
-        for (int x = 0; x < tileLayer->width(); x++) {
-            bool conversionOk;
-            const unsigned gid = tiles.at(y * tileLayer->width() + x)
-                    .toUInt(&conversionOk);
-            if (!conversionOk) {
-                xml.raiseError(
-                        tr("Unable to parse tile at (%1,%2) on layer '%3'")
-                               .arg(x + 1).arg(y + 1).arg(tileLayer->name()));
-                return;
+    TileLayer chunk(QString(), 0, 0, rect.width(), rect.height());
+
+    // The chunk only lives until its cells have been copied to the layer,
+    // so it can't be decoded later on another thread
+    const bool parallel = mParallelLayerDecoding;
+    mParallelLayerDecoding = false;
+    readTileData(&chunk, encoding, compression);
+    mParallelLayerDecoding = parallel;
+
+    tileLayer->setCells(rect.x(), rect.y(), &chunk);
+}
+
+/**
+ * Decodes the layer data collected while reading the map, one task per
+ * layer, and waits for all of them to finish. The decoded cells are then
+ * moved into their layers on this thread.
+ */
+void MapReaderPrivate::decodePendingLayerData()
+{
+    if (mPendingDecoders.isEmpty())
+        return;
+
+    if (!xml.hasError()) {
+        JobGroup jobs;
+        foreach (LayerDataDecoder *decoder, mPendingDecoders)
+            jobs.start(decoder);
+        jobs.wait();
+
+        foreach (LayerDataDecoder *decoder, mPendingDecoders) {
+            if (!decoder->mError.isEmpty()) {
+                xml.raiseError(decoder->mError);
+                break;
             }
-            tileLayer->setCell(x, y, cellForGid(gid));
+
+            decoder->mTileLayer->setCells(0, 0, decoder->mDecodedLayer);
         }
     }
+
+    qDeleteAll(mPendingDecoders);
+    mPendingDecoders.clear();
 }
 
-Cell MapReaderPrivate::cellForGid(unsigned gid)
+/**
+ * Sets up the tiles of \a tileset from the size of its external image and
+ * starts decoding the image on a worker thread, so that reading can continue
+ * in the meantime. The image is loaded by finishPendingImages().
+ *
+ * Returns false when the size of the image can't be determined without
+ * decoding it, in which case it should be read as usual.
+ */
+bool MapReaderPrivate::decodeTilesetImageInBackground(Tileset *tileset,
+                                                      const QString &source)
 {
-    bool ok;
-    const Cell result = mGidMapper.gidToCell(gid, ok);
+    if (source.isEmpty())
+        return false;
 
-    if (!ok) {
-        if (mGidMapper.isEmpty())
-            xml.raiseError(tr("Tile used but no tilesets specified"));
-        else
-            xml.raiseError(tr("Invalid tile: %1").arg(gid));
+    const QSize size = QImageReader(source).size();
+    if (!size.isValid() || !tileset->prepareFromImage(size, source))
+        return false;
+
+    xml.skipCurrentElement();
+
+    TilesetImageDecoder *decoder = new TilesetImageDecoder(mRoot, tileset,
+                                                           source);
+    mRoot->mPendingImages.append(decoder);
+    mRoot->mImageJobs.start(decoder);
+    return true;
+}
+
+/**
+ * Waits for the tileset images that are decoded in the background and loads
+ * them into their tilesets, or defers them when deferred image loading is
+ * enabled.
+ */
+void MapReaderPrivate::finishPendingImages()
+{
+    if (mPendingImages.isEmpty())
+        return;
+
+    mImageJobs.wait();
+
+    foreach (TilesetImageDecoder *decoder, mPendingImages) {
+        if (xml.hasError())
+            break;
+
+        if (decoder->mImage.isNull()) {
+            xml.raiseError(tr("Error loading tileset image:\n'%1'")
+                           .arg(decoder->mSource));
+        } else if (mDeferImages) {
+            deferImage(decoder->mTileset, -1, 0,
+                       decoder->mImage, decoder->mSource);
+        } else {
+            decoder->mTileset->loadFromImage(decoder->mImage,
+                                             decoder->mSource);
+        }
     }
 
+    qDeleteAll(mPendingImages);
+    mPendingImages.clear();
+}
+
+void MapReaderPrivate::deferImage(Tileset *tileset, int tileId,
+                                  ImageLayer *imageLayer,
+                                  const QImage &image, const QString &source)
+{
+    DeferredImage deferred;
+    deferred.tileset = tileset;
+    deferred.tileId = tileId;
+    deferred.imageLayer = imageLayer;
+    deferred.image = image;
+    deferred.source = source;
+    mDeferredImages.append(deferred);
+}
+
+Cell MapReaderPrivate::cellForGid(unsigned gid)
+{
+    QString error;
+    const Cell result = ::cellForGid(mGidMapper, gid, &error);
+
+    if (!error.isEmpty())
+        xml.raiseError(error);
+
     return result;
 }
 
@@ -818,9 +1768,19 @@ void MapReaderPrivate::readImageLayerImage(ImageLayer *imageLayer)
 
     source = p->resolveReference(source, mPath);
 
+    if (!mLoadImages) {
+        imageLayer->setSource(source);
+        xml.skipCurrentElement();
+        return;
+    }
+
     const QImage imageLayerImage = p->readExternalImage(source);
-    if (!imageLayer->loadFromImage(imageLayerImage, source))
+    if (mDeferImages && !imageLayerImage.isNull()) {
+        imageLayer->setSource(source);
+        deferImage(0, -1, imageLayer, imageLayerImage, source);
+    } else if (!imageLayer->loadFromImage(imageLayerImage, source)) {
         xml.raiseError(tr("Error loading image layer image:\n'%1'").arg(source));
+    }
 
     xml.skipCurrentElement();
 }
@@ -837,7 +1797,8 @@ MapObject *MapReaderPrivate::readObject()
     const qreal y = atts.value(QLatin1String("y")).toString().toDouble();
     const qreal width = atts.value(QLatin1String("width")).toString().toDouble();
     const qreal height = atts.value(QLatin1String("height")).toString().toDouble();
-    const QString type = atts.value(QLatin1String("type")).toString();
+    const QString type =
+            Properties::internedName(atts.value(QLatin1String("type")).toString());
     const QStringRef visibleRef = atts.value(QLatin1String("visible"));
 
     const QPointF pos(x, y);
@@ -898,6 +1859,7 @@ QPolygonF MapReaderPrivate::readPolygon()
                                                 QString::SkipEmptyParts);
 
     QPolygonF polygon;
+    polygon.reserve(pointsList.size());
     bool ok = true;
 
     foreach (const QString &point, pointsList) {
@@ -969,7 +1931,8 @@ void MapReaderPrivate::readProperty(Properties *properties)
     Q_ASSERT(xml.isStartElement() && xml.name() == QLatin1String("property"));
 
     const QXmlStreamAttributes atts = xml.attributes();
-    QString propertyName = atts.value(QLatin1String("name")).toString();
+    const QString propertyName =
+            Properties::internedName(atts.value(QLatin1String("name")).toString());
     QString propertyValue = atts.value(QLatin1String("value")).toString();
 
     while (xml.readNext() != QXmlStreamReader::Invalid) {
@@ -1008,7 +1971,43 @@ Map *MapReader::readMap(const QString &fileName)
     if (!d->openFile(&file))
         return 0;
 
-    return readMap(&file, QFileInfo(fileName).absolutePath());
+    const QString path = QFileInfo(fileName).absolutePath();
+
+    const MapCellCache cellCache(fileName);
+    d->mCellCache = cellCache.isValid() ? &cellCache : 0;
+
+    Map *map = 0;
+    bool mapped = false;
+
+    if (d->mMemoryMapping && file.size() > 0) {
+        if (uchar *data = file.map(0, file.size())) {
+            // Read from the mapped file, so that the page cache holds the
+            // only copy of the file contents
+            const QByteArray bytes =
+                    QByteArray::fromRawData(reinterpret_cast<const char*>(data),
+                                            file.size());
+            QBuffer buffer;
+            buffer.setData(bytes);
+            buffer.open(QIODevice::ReadOnly);
+
+            map = readMap(&buffer, path);
+            mapped = true;
+
+            buffer.close();
+            file.unmap(data);
+        }
+    }
+
+    if (!mapped)
+        map = readMap(&file, path);
+
+    d->mCellCache = 0;
+
+    // Filtered maps miss layers, so they can't be cached
+    if (map && !cellCache.isValid() && d->mLayerFilter.isEmpty())
+        MapCellCache::write(fileName, map);
+
+    return map;
 }
 
 Tileset *MapReader::readTileset(QIODevice *device, const QString &path)
@@ -1034,6 +2033,113 @@ QString MapReader::errorString() const
     return d->errorString();
 }
 
+void MapReader::setParallelLayerDecoding(bool enabled)
+{
+    d->mParallelLayerDecoding = enabled;
+}
+
+bool MapReader::parallelLayerDecoding() const
+{
+    return d->mParallelLayerDecoding;
+}
+
+void MapReader::setLazyLayerDecoding(bool enabled)
+{
+    d->mLazyLayerDecoding = enabled;
+}
+
+bool MapReader::lazyLayerDecoding() const
+{
+    return d->mLazyLayerDecoding;
+}
+
+void MapReader::setMemoryMappingEnabled(bool enabled)
+{
+    d->mMemoryMapping = enabled;
+}
+
+bool MapReader::isMemoryMappingEnabled() const
+{
+    return d->mMemoryMapping;
+}
+
+void MapReader::setDeferredImageLoading(bool enabled)
+{
+    d->mDeferImages = enabled;
+}
+
+bool MapReader::isDeferredImageLoadingEnabled() const
+{
+    return d->mDeferImages;
+}
+
+void MapReader::setParallelImageDecoding(bool enabled)
+{
+    d->mParallelImageDecoding = enabled;
+}
+
+bool MapReader::parallelImageDecoding() const
+{
+    return d->mParallelImageDecoding;
+}
+
+void MapReader::setLayerFilter(const QStringList &layerNames)
+{
+    d->mLayerFilter = layerNames.toSet();
+}
+
+QStringList MapReader::layerFilter() const
+{
+    return d->mLayerFilter.toList();
+}
+
+void MapReader::setImageLoading(bool enabled)
+{
+    d->mLoadImages = enabled;
+}
+
+bool MapReader::isImageLoadingEnabled() const
+{
+    return d->mLoadImages;
+}
+
+void MapReader::setProgressContext(ProgressContext *progress)
+{
+    d->mProgress = progress;
+}
+
+ProgressContext *MapReader::progressContext() const
+{
+    return d->mProgress;
+}
+
+void MapReader::loadDeferredImages()
+{
+    const bool guiThread = CellRenderer::isGuiThread();
+
+    foreach (const DeferredImage &deferred, d->mDeferredImages) {
+        if (deferred.imageLayer) {
+            deferred.imageLayer->loadFromImage(deferred.image, deferred.source);
+        } else if (deferred.tileId != -1) {
+            if (guiThread) {
+                deferred.tileset->setTileImage(deferred.tileId,
+                                               QPixmap::fromImage(deferred.image),
+                                               deferred.source);
+            } else {
+                deferred.tileset->setTileImageSize(deferred.tileId,
+                                                   deferred.image.size(),
+                                                   deferred.source);
+                if (Tile *tile = deferred.tileset->tileAt(deferred.tileId))
+                    tile->setImageData(deferred.image);
+            }
+        } else {
+            deferred.tileset->loadFromImage(deferred.image, deferred.source);
+        }
+    }
+
+    d->mDeferredImages.clear();
+}
+
 QString MapReader::resolveReference(const QString &reference,
                                     const QString &mapPath)
 {
@@ -1045,19 +2151,28 @@ QString MapReader::resolveReference(const QString &reference,
 
 QImage MapReader::readExternalImage(const QString &source)
 {
-    return QImage(source);
+    return ImageCache::loadImage(source);
 }
 
 Tileset *MapReader::readExternalTileset(const QString &source,
                                         QString *error)
 {
     MapReader reader;
+    reader.setDeferredImageLoading(d->mDeferImages);
+    reader.setParallelImageDecoding(d->mParallelImageDecoding);
+    reader.setImageLoading(d->mLoadImages);
+
+    // Let the images be decoded alongside those of the map
+    if (d->mParallelImageDecoding)
+        reader.d->mRoot = d->mRoot;
 
     Tileset *tileset = reader.readTileset(source);
-    if (!tileset)
+    if (!tileset) {
         *error = reader.errorString();
-    else
+    } else {
         d->mCreatedTilesets.append(tileset);
+        d->mDeferredImages.append(reader.d->mDeferredImages);
+    }
 
     return tileset;
 }
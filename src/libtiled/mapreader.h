@@ -32,12 +32,14 @@
 #include "tiled_global.h"
 
 #include <QImage>
+#include <QStringList>
 
 class QFile;
 
 namespace Tiled {
 
 class Map;
+class ProgressContext;
 class Tileset;
 
 namespace Internal {
@@ -54,7 +56,7 @@ class TILEDSHARED_EXPORT MapReader
 {
 public:
     MapReader();
-    ~MapReader();
+    virtual ~MapReader();
 
     /**
      * Reads a TMX map from the given \a device. Optionally a \a path can
@@ -95,6 +97,100 @@ public:
      */
     QString errorString() const;
 
+    /**
+     * Sets whether the data of tile layers is decoded on multiple threads.
+     * When enabled, the layer data is only collected while reading the XML
+     * and decoded using one task per layer before readMap() returns.
+     *
+     * The resulting map is the same either way. Disabled by default.
+     */
+    void setParallelLayerDecoding(bool enabled);
+    bool parallelLayerDecoding() const;
+
+    /**
+     * Sets whether the data of hidden tile layers is decoded only once their
+     * cells are needed, which saves memory on maps with many hidden layers.
+     * The data is kept as it was read until then, and written back as is
+     * when the map is saved in the same format. Errors in the data of such
+     * layers are only reported as warnings when it is decoded.
+     *
+     * Layers stored as chunks or as <tile> elements are always decoded right
+     * away. Disabled by default.
+     */
+    void setLazyLayerDecoding(bool enabled);
+    bool lazyLayerDecoding() const;
+
+    /**
+     * Sets whether readMap(const QString&) maps the file into memory instead
+     * of reading it through a file buffer. Falls back to reading the file
+     * normally when it can't be mapped. Disabled by default.
+     */
+    void setMemoryMappingEnabled(bool enabled);
+    bool isMemoryMappingEnabled() const;
+
+    /**
+     * Sets whether the creation of pixmaps for tileset and image layer images
+     * is deferred. Pixmaps may only be created on the GUI thread, so this
+     * needs to be enabled when reading on a worker thread. The images are
+     * then kept until loadDeferredImages() is called. Disabled by default.
+     */
+    void setDeferredImageLoading(bool enabled);
+    bool isDeferredImageLoadingEnabled() const;
+
+    /**
+     * Sets whether the external images of tilesets are decoded on multiple
+     * threads while the rest of the map is read. The tiles are set up from
+     * the size of the image, and the images are loaded once the map or
+     * tileset has been read. This includes the images of external tilesets.
+     *
+     * When enabled, readExternalImage() is called from worker threads.
+     * Disabled by default.
+     */
+    void setParallelImageDecoding(bool enabled);
+    bool parallelImageDecoding() const;
+
+    /**
+     * Sets the names of the layers to read. Other layers are skipped without
+     * decoding their data, which makes reading much faster when only a few
+     * layers are needed. An empty list, the default, reads all layers.
+     *
+     * Only applies to the top-level layers of the map, not to the object
+     * groups of tiles.
+     */
+    void setLayerFilter(const QStringList &layerNames);
+    QStringList layerFilter() const;
+
+    /**
+     * Sets whether the images of tilesets and image layers are loaded. When
+     * disabled, only the geometry of the map is read: the tiles of tileset
+     * images are set up from the size of the image and their pixmaps stay
+     * empty, while tiles with their own image and image layers only get
+     * their image source. Enabled by default.
+     */
+    void setImageLoading(bool enabled);
+    bool isImageLoadingEnabled() const;
+
+    /**
+     * Sets the context to report the progress of reading a map to. The
+     * progress is reported after each layer, in thousandths of the device
+     * size, or as the number of layers read when the size isn't known.
+     * When the context gets canceled, reading fails with an error.
+     */
+    void setProgressContext(ProgressContext *progress);
+    ProgressContext *progressContext() const;
+
+    /**
+     * Creates the pixmaps for the images collected while reading with
+     * deferred image loading enabled. Needs to be called before the map or
+     * tileset is used. The draw margins of the map should be recomputed
+     * afterwards.
+     *
+     * When called outside of the GUI thread, only the image data is set up,
+     * which is enough for rendering on that thread but leaves the pixmaps
+     * empty.
+     */
+    void loadDeferredImages();
+
 protected:
     /**
      * Called for each \a reference to an external file. Should return the path
@@ -106,6 +202,8 @@ protected:
 
     /**
      * Called when an external image is encountered while a tileset is loaded.
+     * The default implementation loads the image through the ImageCache, so
+     * that images shared by several maps are only decoded once.
      */
     virtual QImage readExternalImage(const QString &source);
 
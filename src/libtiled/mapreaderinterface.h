@@ -37,6 +37,7 @@ class QString;
 namespace Tiled {
 
 class Map;
+class ProgressContext;
 
 /**
  * An interface to be implemented by map readers. A map reader implements
@@ -52,8 +53,12 @@ public:
 
     /**
      * Reads the map and returns a new Map instance, or 0 if reading failed.
+     *
+     * When a \a progress context is given, the reader may report its
+     * progress to it and should fail when it gets canceled.
      */
-    virtual Map *read(const QString &fileName) = 0;
+    virtual Map *read(const QString &fileName,
+                      ProgressContext *progress = 0) = 0;
 
     /**
      * Returns name filters of this map reader, for multiple formats.
@@ -87,7 +92,9 @@ protected:
 
 } // namespace Tiled
 
+// Bump the version whenever the virtual functions change, so that plugins
+// built against an older interface are rejected
 Q_DECLARE_INTERFACE(Tiled::MapReaderInterface,
-                    "org.mapeditor.MapReaderInterface")
+                    "org.mapeditor.MapReaderInterface/2")
 
 #endif // MAPREADERINTERFACE_H
@@ -29,12 +29,20 @@
 #include "maprenderer.h"
 
 #include "imagelayer.h"
+#include "mapobject.h"
 #include "tile.h"
 #include "tilelayer.h"
+#include "tileset.h"
 
+#include <QAtomicInt>
+#include <QCache>
+#include <QCoreApplication>
 #include <QPaintEngine>
 #include <QPainter>
+#include <QThread>
+#include <QPair>
 #include <QVector2D>
+#include <QtCore/qmath.h>
 
 using namespace Tiled;
 
@@ -50,8 +58,37 @@ void MapRenderer::drawImageLayer(QPainter *painter,
 {
     Q_UNUSED(exposed)
 
-    painter->drawPixmap(imageLayer->position(),
-                        imageLayer->image());
+    if (CellRenderer::isGuiThread()) {
+        painter->drawPixmap(imageLayer->position(),
+                            imageLayer->image());
+    } else {
+        painter->drawImage(imageLayer->position(),
+                           imageLayer->imageData());
+    }
+}
+
+void MapRenderer::screenToTileCoords(QPointF *points, int count) const
+{
+    for (QPointF *end = points + count; points != end; ++points)
+        *points = screenToTileCoords(points->x(), points->y());
+}
+
+void MapRenderer::tileToScreenCoords(QPointF *points, int count) const
+{
+    for (QPointF *end = points + count; points != end; ++points)
+        *points = tileToScreenCoords(points->x(), points->y());
+}
+
+void MapRenderer::screenToPixelCoords(QPointF *points, int count) const
+{
+    for (QPointF *end = points + count; points != end; ++points)
+        *points = screenToPixelCoords(points->x(), points->y());
+}
+
+void MapRenderer::pixelToScreenCoords(QPointF *points, int count) const
+{
+    for (QPointF *end = points + count; points != end; ++points)
+        *points = pixelToScreenCoords(points->x(), points->y());
 }
 
 void MapRenderer::setFlag(RenderFlag flag, bool enabled)
@@ -62,6 +99,86 @@ void MapRenderer::setFlag(RenderFlag flag, bool enabled)
         mFlags &= ~flag;
 }
 
+void MapRenderer::setObjectLineWidth(qreal lineWidth)
+{
+    if (mObjectLineWidth == lineWidth)
+        return;
+
+    mObjectLineWidth = lineWidth;
+    invalidateObjectGeometry();
+}
+
+void MapRenderer::invalidateObjectGeometry()
+{
+    mObjectGeometryKey = nextObjectGeometryKey();
+}
+
+bool MapRenderer::cachedBoundingRect(const MapObject *object,
+                                     QRectF &rect) const
+{
+    const MapObject::RendererCache &cache = object->mRendererCache;
+    if (cache.key != mObjectGeometryKey || !cache.hasBoundingRect)
+        return false;
+
+    rect = cache.boundingRect;
+    return true;
+}
+
+void MapRenderer::cacheBoundingRect(const MapObject *object,
+                                    const QRectF &rect) const
+{
+    if (!object->cell().isEmpty())
+        return;
+
+    MapObject::RendererCache &cache = object->mRendererCache;
+    if (cache.key != mObjectGeometryKey) {
+        cache.key = mObjectGeometryKey;
+        cache.hasShape = false;
+    }
+
+    cache.boundingRect = rect;
+    cache.hasBoundingRect = true;
+}
+
+bool MapRenderer::cachedShape(const MapObject *object,
+                              QPainterPath &shape) const
+{
+    const MapObject::RendererCache &cache = object->mRendererCache;
+    if (cache.key != mObjectGeometryKey || !cache.hasShape)
+        return false;
+
+    shape = cache.shape;
+    return true;
+}
+
+void MapRenderer::cacheShape(const MapObject *object,
+                             const QPainterPath &shape) const
+{
+    if (!object->cell().isEmpty())
+        return;
+
+    MapObject::RendererCache &cache = object->mRendererCache;
+    if (cache.key != mObjectGeometryKey) {
+        cache.key = mObjectGeometryKey;
+        cache.hasBoundingRect = false;
+    }
+
+    cache.shape = shape;
+    cache.hasShape = true;
+}
+
+static QAtomicInt nextGeometryKey(1);
+
+unsigned MapRenderer::nextObjectGeometryKey()
+{
+    unsigned key;
+    do {
+        key = unsigned(nextGeometryKey.fetchAndAddRelaxed(1));
+    } while (key == 0);
+
+    return key;
+}
+
 /**
  * Converts a line running from \a start to \a end to a polygon which
  * extends 5 pixels from the line in all directions.
@@ -91,10 +208,191 @@ static bool hasOpenGLEngine(const QPainter *painter)
             type == QPaintEngine::OpenGL2);
 }
 
+/**
+ * The OpenGL paint engine samples outside of the source rectangle when
+ * filtering, which would blend in pixels of the neighbouring tiles along
+ * the edges when drawing from a tileset image, unless the tiles end up on
+ * whole pixels without scaling. The raster engine clamps to the source.
+ */
+static bool canDrawFromTilesetImage(const QPainter *painter)
+{
+    if (!hasOpenGLEngine(painter))
+        return true;
+    if (!painter->testRenderHint(QPainter::SmoothPixmapTransform))
+        return true;
+
+    const QTransform transform = painter->combinedTransform();
+    return transform.type() <= QTransform::TxTranslate &&
+            transform.dx() == qRound(transform.dx()) &&
+            transform.dy() == qRound(transform.dy());
+}
+
+/**
+ * Returns the tileset image mipmap level best suited for drawing with the
+ * given \a painter, which is the smallest one that still needs to be scaled
+ * down rather than up.
+ */
+static int mipmapLevel(const QPainter *painter)
+{
+    const QTransform transform = painter->combinedTransform();
+    const qreal scale = qSqrt(qAbs(transform.determinant()));
+
+    int level = 0;
+    while (level < Tileset::MipmapLevels && scale * (2 << level) <= 1)
+        ++level;
+
+    return level;
+}
+
+static bool collectStatistics = false;
+static QAtomicInt drawCalls(0);
+static QAtomicInt fragments(0);
+
+namespace {
+
+enum FlipFlag {
+    FlippedHorizontally     = 0x1,
+    FlippedVertically       = 0x2,
+    FlippedAntiDiagonally   = 0x4
+};
+
+/**
+ * Identifies a flipped variant by the cache key of the original pixmap and
+ * the flip flags.
+ */
+typedef QPair<qint64, int> FlippedPixmapKey;
+
+// The amount of memory used by flipped variants of tileset images, in KB
+const int MaxFlippedPixmapsCost = 32 * 1024;
+
+// Only accessed from the GUI thread, since it holds pixmaps
+struct FlippedPixmapCacheData
+{
+    FlippedPixmapCacheData() : pixmaps(MaxFlippedPixmapsCost) {}
+
+    QCache<FlippedPixmapKey, QPixmap> pixmaps;
+};
+
+} // anonymous namespace
+
+Q_GLOBAL_STATIC(FlippedPixmapCacheData, flippedPixmapCache)
+
+static bool useFlippedPixmaps = true;
+
+/**
+ * Pixmaps may not outlive the application object.
+ */
+static void clearFlippedPixmapCache()
+{
+    flippedPixmapCache()->pixmaps.clear();
+}
+
+static int flipFlags(const Cell &cell)
+{
+    return (cell.flippedHorizontally ? FlippedHorizontally : 0) |
+            (cell.flippedVertically ? FlippedVertically : 0) |
+            (cell.flippedAntiDiagonally ? FlippedAntiDiagonally : 0);
+}
+
+/**
+ * Returns the \a pixmap flipped according to \a flags. Like for cells, the
+ * anti-diagonal flip is applied first. Since the whole image is flipped,
+ * each tile in a tileset image ends up flipped in place, at the position
+ * returned by flippedRect().
+ */
+static const QPixmap *flippedPixmap(const QPixmap &pixmap, int flags)
+{
+    const FlippedPixmapKey key(pixmap.cacheKey(), flags);
+
+    FlippedPixmapCacheData *data = flippedPixmapCache();
+    if (const QPixmap *cached = data->pixmaps.object(key))
+        return cached;
+
+    QImage image = pixmap.toImage();
+    if (flags & FlippedAntiDiagonally)
+        image = image.transformed(QTransform(0, 1, 1, 0, 0, 0));
+    image = image.mirrored(flags & FlippedHorizontally,
+                           flags & FlippedVertically);
+
+    const int cost = image.width() * image.height() * 4 / 1024;
+    if (cost > MaxFlippedPixmapsCost)
+        return 0;
+
+    static bool postRoutineAdded = false;
+    if (!postRoutineAdded) {
+        qAddPostRoutine(clearFlippedPixmapCache);
+        postRoutineAdded = true;
+    }
+
+    QPixmap *flipped = new QPixmap(QPixmap::fromImage(image));
+    data->pixmaps.insert(key, flipped, qMax(cost, 1));
+    return flipped;
+}
+
+/**
+ * Returns where \a rect of an image of the given \a size ends up in the
+ * image flipped according to \a flags.
+ */
+static QRectF flippedRect(const QRectF &rect, QSizeF size, int flags)
+{
+    QRectF result = rect;
+
+    if (flags & FlippedAntiDiagonally) {
+        result = QRectF(rect.y(), rect.x(), rect.height(), rect.width());
+        size.transpose();
+    }
+    if (flags & FlippedHorizontally)
+        result.moveLeft(size.width() - result.right());
+    if (flags & FlippedVertically)
+        result.moveTop(size.height() - result.bottom());
+
+    return result;
+}
+
+void CellRenderer::setFlippedPixmapsEnabled(bool enabled)
+{
+    useFlippedPixmaps = enabled;
+}
+
+bool CellRenderer::flippedPixmapsEnabled()
+{
+    return useFlippedPixmaps;
+}
+
+void CellRenderer::setCollectStatistics(bool enabled)
+{
+    collectStatistics = enabled;
+}
+
+int CellRenderer::drawCallCount()
+{
+    return drawCalls.fetchAndAddRelaxed(0);
+}
+
+int CellRenderer::fragmentCount()
+{
+    return fragments.fetchAndAddRelaxed(0);
+}
+
+void CellRenderer::resetStatistics()
+{
+    drawCalls.fetchAndStoreRelaxed(0);
+    fragments.fetchAndStoreRelaxed(0);
+}
+
+bool CellRenderer::isGuiThread()
+{
+    // Without an application there is no GUI thread to be concerned with
+    const QCoreApplication *app = QCoreApplication::instance();
+    return !app || QThread::currentThread() == app->thread();
+}
+
 CellRenderer::CellRenderer(QPainter *painter)
     : mPainter(painter)
-    , mTile(0)
     , mIsOpenGL(hasOpenGLEngine(painter))
+    , mUseTilesetImages(canDrawFromTilesetImage(painter))
+    , mUseImageData(!isGuiThread())
+    , mMipmapLevel(mipmapLevel(painter))
 {
 }
 
@@ -102,30 +400,67 @@ CellRenderer::CellRenderer(QPainter *painter)
  * Renders a \a cell with the given \a origin at \a pos, taking into account
  * the flipping and tile offset.
  *
- * For performance reasons, the actual drawing is delayed until a different
- * kind of tile has to be drawn. For this reason it is necessary to call
+ * For performance reasons, the actual drawing is delayed until a tile from a
+ * different image has to be drawn. Tiles from a tileset based on a single
+ * image are drawn from that image, so they can all be drawn in one call
+ * regardless of which tile they are. For this reason it is necessary to call
  * flush when finished doing drawCell calls. This function is also called by
  * the destructor so usually an explicit call is not needed.
  */
 void CellRenderer::render(const Cell &cell, const QPointF &pos, const QSizeF &cellSize, Origin origin)
 {
-    if (mTile != cell.tile)
-        flush();
-
-    const QPixmap &image = cell.tile->currentFrameImage();
-    const QSizeF size = image.size();
+    const Tile *tile = cell.tile->currentFrameTile();
+    const QSizeF size = tile->size();
     const QSizeF objectSize = (cellSize == QSizeF(0,0)) ? size : cellSize;
     const QSizeF scale(objectSize.width() / size.width(), objectSize.height() / size.height());
     const QPoint offset = cell.tile->tileset()->tileOffset();
+
+    const QPixmap *source = 0;
+    const QImage *sourceImage = 0;
+    QRectF sourceRect(QPointF(0, 0), size);
+
+    if (mUseImageData) {
+        // Pixmaps can't be used, so draw each tile on its own from the
+        // QImage copies at full resolution
+        const Tileset *tileset = tile->tileset();
+        const QRect rect = tileset->imageRect(tile->id());
+        if (!rect.isNull()) {
+            sourceImage = &tileset->imageData();
+            sourceRect = rect;
+        } else {
+            sourceImage = &tile->imageData();
+        }
+    } else if (mUseTilesetImages && scale == QSizeF(1, 1)) {
+        const Tileset *tileset = tile->tileset();
+        const QRect rect = tileset->imageRect(tile->id());
+        if (!rect.isNull()) {
+            source = &tileset->mipmap(mMipmapLevel);
+
+            const qreal sx = qreal(source->width()) / tileset->image().width();
+            const qreal sy = qreal(source->height()) / tileset->image().height();
+            sourceRect = QRectF(rect.x() * sx, rect.y() * sy,
+                                rect.width() * sx, rect.height() * sy);
+        }
+    }
+
+    // Only ask for the tile image when not drawing from the tileset image,
+    // since it may need to be created
+    if (!source && !sourceImage)
+        source = &tile->image();
+
+    // Scales the source up to the tile size when drawing from a mipmap
+    const QSizeF sourceScale(size.width() / sourceRect.width(),
+                             size.height() / sourceRect.height());
+
     const QPointF sizeHalf = QPointF(objectSize.width() / 2, objectSize.height() / 2);
 
     QPainter::PixmapFragment fragment;
     fragment.x = pos.x() + (offset.x() * scale.width()) + sizeHalf.x();
     fragment.y = pos.y() + (offset.y() * scale.height()) + sizeHalf.y() - objectSize.height();
-    fragment.sourceLeft = 0;
-    fragment.sourceTop = 0;
-    fragment.width = size.width();
-    fragment.height = size.height();
+    fragment.sourceLeft = sourceRect.x();
+    fragment.sourceTop = sourceRect.y();
+    fragment.width = sourceRect.width();
+    fragment.height = sourceRect.height();
     fragment.scaleX = cell.flippedHorizontally ? -1 : 1;
     fragment.scaleY = cell.flippedVertically ? -1 : 1;
     fragment.rotation = 0;
@@ -150,17 +485,44 @@ void CellRenderer::render(const Cell &cell, const QPointF &pos, const QSizeF &ce
             fragment.x += halfDiff;
     }
     
-    fragment.scaleX = scale.width() * (flippedHorizontally ? -1 : 1);
-    fragment.scaleY = scale.height() * (flippedVertically ? -1 : 1);
+    fragment.scaleX = scale.width() * sourceScale.width() * (flippedHorizontally ? -1 : 1);
+    fragment.scaleY = scale.height() * sourceScale.height() * (flippedVertically ? -1 : 1);
 
-    if (mIsOpenGL || (fragment.scaleX > 0 && fragment.scaleY > 0)) {
-        mTile = cell.tile;
+    // On the raster engine, drawing transformed fragments is slow and
+    // negative scales are not supported, so draw from a flipped variant of
+    // the image instead
+    const int flags = flipFlags(cell);
+    if (source && flags && !mIsOpenGL && useFlippedPixmaps) {
+        if (const QPixmap *flipped = flippedPixmap(*source, flags)) {
+            const QRectF rect = flippedRect(sourceRect, source->size(), flags);
+            const qreal scaleX = qAbs(fragment.scaleX);
+            const qreal scaleY = qAbs(fragment.scaleY);
+            const bool swapped = flags & FlippedAntiDiagonally;
+
+            source = flipped;
+            fragment.sourceLeft = rect.x();
+            fragment.sourceTop = rect.y();
+            fragment.width = rect.width();
+            fragment.height = rect.height();
+            fragment.rotation = 0;
+            fragment.scaleX = swapped ? scaleY : scaleX;
+            fragment.scaleY = swapped ? scaleX : scaleY;
+        }
+    }
+
+    if (!mFragments.isEmpty() && (!source || mPixmap.cacheKey() != source->cacheKey()))
+        flush();
+
+    if (source && (mIsOpenGL || (fragment.scaleX > 0 && fragment.scaleY > 0))) {
+        if (mFragments.isEmpty())
+            mPixmap = *source;
         mFragments.append(fragment);
         return;
     }
 
     // The Raster paint engine as of Qt 4.8.4 / 5.0.2 does not support
-    // drawing fragments with a negative scaling factor.
+    // drawing fragments with a negative scaling factor. There are also no
+    // fragments for drawing images.
 
     flush(); // make sure we drew all tiles so far
 
@@ -172,11 +534,18 @@ void CellRenderer::render(const Cell &cell, const QPointF &pos, const QSizeF &ce
 
     const QRectF target(fragment.width * -0.5, fragment.height * -0.5,
                         fragment.width, fragment.height);
-    const QRectF source(0, 0, fragment.width, fragment.height);
 
     mPainter->setTransform(transform);
-    mPainter->drawPixmap(target, image, source);
+    if (sourceImage)
+        mPainter->drawImage(target, *sourceImage, sourceRect);
+    else
+        mPainter->drawPixmap(target, *source, sourceRect);
     mPainter->setTransform(oldTransform);
+
+    if (collectStatistics) {
+        drawCalls.fetchAndAddRelaxed(1);
+        fragments.fetchAndAddRelaxed(1);
+    }
 }
 
 /**
@@ -184,13 +553,18 @@ void CellRenderer::render(const Cell &cell, const QPointF &pos, const QSizeF &ce
  */
 void CellRenderer::flush()
 {
-    if (!mTile)
+    if (mFragments.isEmpty())
         return;
 
     mPainter->drawPixmapFragments(mFragments.constData(),
                                   mFragments.size(),
-                                  mTile->currentFrameImage());
+                                  mPixmap);
+
+    if (collectStatistics) {
+        drawCalls.fetchAndAddRelaxed(1);
+        fragments.fetchAndAddRelaxed(mFragments.size());
+    }
 
-    mTile = 0;
+    mPixmap = QPixmap();
     mFragments.resize(0);
 }
@@ -62,6 +62,7 @@ public:
         , mFlags(0)
         , mObjectLineWidth(2)
         , mPainterScale(1)
+        , mObjectGeometryKey(nextObjectGeometryKey())
     {}
 
     virtual ~MapRenderer() {}
@@ -134,7 +135,8 @@ public:
                                const QColor &color) const = 0;
 
     /**
-     * Draws the given image \a layer using the given \a painter.
+     * Draws the given image \a layer using the given \a painter. Outside of
+     * the GUI thread the layer is drawn from its QImage copy.
      */
     void drawImageLayer(QPainter *painter,
                         const ImageLayer *imageLayer,
@@ -148,14 +150,6 @@ public:
     inline QPointF pixelToTileCoords(const QPointF &point) const
     { return pixelToTileCoords(point.x(), point.y()); }
 
-    QPolygonF pixelToScreenCoords(const QPolygonF &polygon) const
-    {
-        QPolygonF screenPolygon(polygon.size());
-        for (int i = polygon.size() - 1; i >= 0; --i)
-            screenPolygon[i] = pixelToScreenCoords(polygon[i]);
-        return screenPolygon;
-    }
-
     /**
      * Returns the pixel coordinates matching the given tile coordinates.
      */
@@ -176,26 +170,41 @@ public:
     virtual QPointF screenToTileCoords(qreal x, qreal y) const = 0;
     inline QPointF screenToTileCoords(const QPointF &point) const;
 
+    /**
+     * Converts the \a count screen positions starting at \a points to tile
+     * coordinates, in place.
+     *
+     * The conversions of arrays of points are done in a single virtual call.
+     * The default implementations convert each point on its own, renderers
+     * override them where the conversion can be done more efficiently.
+     */
+    virtual void screenToTileCoords(QPointF *points, int count) const;
+
     /**
      * Returns the screen position matching the given tile coordinates.
      */
     virtual QPointF tileToScreenCoords(qreal x, qreal y) const = 0;
     inline QPointF tileToScreenCoords(const QPointF &point) const;
+    virtual void tileToScreenCoords(QPointF *points, int count) const;
 
     /**
      * Returns the pixel position matching the given screen position.
      */
     virtual QPointF screenToPixelCoords(qreal x, qreal y) const = 0;
     inline QPointF screenToPixelCoords(const QPointF &point) const;
+    virtual void screenToPixelCoords(QPointF *points, int count) const;
+    QPolygonF screenToPixelCoords(const QPolygonF &polygon) const;
 
     /**
      * Returns the screen position matching the given pixel position.
      */
     virtual QPointF pixelToScreenCoords(qreal x, qreal y) const = 0;
     inline QPointF pixelToScreenCoords(const QPointF &point) const;
+    virtual void pixelToScreenCoords(QPointF *points, int count) const;
+    QPolygonF pixelToScreenCoords(const QPolygonF &polygon) const;
 
     qreal objectLineWidth() const { return mObjectLineWidth; }
-    void setObjectLineWidth(qreal lineWidth) { mObjectLineWidth = lineWidth; }
+    void setObjectLineWidth(qreal lineWidth);
 
     void setFlag(RenderFlag flag, bool enabled = true);
     bool testFlag(RenderFlag flag) const
@@ -209,18 +218,38 @@ public:
 
     static QPolygonF lineToPolygon(const QPointF &start, const QPointF &end);
 
+    /**
+     * Drops the bounding rects and shapes of map objects cached by this
+     * renderer. Should be called when a map property that affects the
+     * geometry of objects, like the tile size, was changed.
+     */
+    void invalidateObjectGeometry();
+
 protected:
     /**
      * Returns the map this renderer is associated with.
      */
     const Map *map() const { return mMap; }
 
+    /**
+     * Helpers for caching the geometry computed for a map object on the
+     * object itself. Tile objects are not cached, since their geometry
+     * depends on their tile.
+     */
+    bool cachedBoundingRect(const MapObject *object, QRectF &rect) const;
+    void cacheBoundingRect(const MapObject *object, const QRectF &rect) const;
+    bool cachedShape(const MapObject *object, QPainterPath &shape) const;
+    void cacheShape(const MapObject *object, const QPainterPath &shape) const;
+
 private:
+    static unsigned nextObjectGeometryKey();
+
     const Map *mMap;
 
     RenderFlags mFlags;
     qreal mObjectLineWidth;
     qreal mPainterScale;
+    unsigned mObjectGeometryKey;
 };
 
 inline QPointF MapRenderer::screenToTileCoords(const QPointF &point) const
@@ -243,11 +272,29 @@ inline QPointF MapRenderer::pixelToScreenCoords(const QPointF &point) const
     return pixelToScreenCoords(point.x(), point.y());
 }
 
+inline QPolygonF MapRenderer::screenToPixelCoords(const QPolygonF &polygon) const
+{
+    QPolygonF pixelPolygon(polygon);
+    screenToPixelCoords(pixelPolygon.data(), pixelPolygon.size());
+    return pixelPolygon;
+}
+
+inline QPolygonF MapRenderer::pixelToScreenCoords(const QPolygonF &polygon) const
+{
+    QPolygonF screenPolygon(polygon);
+    pixelToScreenCoords(screenPolygon.data(), screenPolygon.size());
+    return screenPolygon;
+}
+
 
 /**
  * A utility class for rendering cells.
+ *
+ * When used outside of the GUI thread, for example to render a map to a
+ * QImage in a worker thread, the cells are drawn from the QImage copies of
+ * the tile images, since pixmaps can only be used on the GUI thread.
  */
-class CellRenderer
+class TILEDSHARED_EXPORT CellRenderer
 {
 public:
     enum Origin {
@@ -262,11 +309,47 @@ public:
     void render(const Cell &cell, const QPointF &pos, const QSizeF &size, Origin origin);
     void flush();
 
+    /**
+     * Sets whether the number of draw calls and the number of cells drawn
+     * by all cell renderers are counted, for profiling purposes.
+     */
+    static void setCollectStatistics(bool enabled);
+
+    /**
+     * Returns the number of draw calls made since the last reset.
+     */
+    static int drawCallCount();
+
+    /**
+     * Returns the number of cells drawn since the last reset.
+     */
+    static int fragmentCount();
+
+    static void resetStatistics();
+
+    /**
+     * Sets whether flipped cells are drawn from flipped copies of the tileset
+     * images on the raster paint engine. This avoids a transformed draw call
+     * for each flipped cell, at the cost of keeping the flipped copies in
+     * memory. Enabled by default.
+     */
+    static void setFlippedPixmapsEnabled(bool enabled);
+    static bool flippedPixmapsEnabled();
+
+    /**
+     * Returns whether the current thread is the GUI thread, which is the
+     * only one in which pixmaps may be used.
+     */
+    static bool isGuiThread();
+
 private:
     QPainter * const mPainter;
-    Tile *mTile;
+    QPixmap mPixmap;
     QVector<QPainter::PixmapFragment> mFragments;
     const bool mIsOpenGL;
+    const bool mUseTilesetImages;
+    const bool mUseImageData;
+    const int mMipmapLevel;
 };
 
 } // namespace Tiled
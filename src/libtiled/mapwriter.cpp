@@ -33,19 +33,31 @@
 #include "compression.h"
 #include "gidmapper.h"
 #include "map.h"
+#include "mapcellcache.h"
 #include "mapobject.h"
 #include "imagelayer.h"
+#include "jobsystem.h"
+#include "layerdatacache.h"
+#include "layerexportcache.h"
+#include "numberutils.h"
 #include "objectgroup.h"
+#include "progresscontext.h"
 #include "tile.h"
 #include "tilelayer.h"
 #include "tileset.h"
 #include "terrain.h"
+#include "trace.h"
 
 #include <QCoreApplication>
 #include <QBuffer>
 #include <QDir>
+#include <QHash>
+#include <QRunnable>
+#include <QScopedPointer>
 #include <QXmlStreamWriter>
 
+#include <cstring>
+
 #if QT_VERSION >= 0x050100
 #define HAS_QSAVEFILE_SUPPORT
 #endif
@@ -60,6 +72,31 @@ using namespace Tiled::Internal;
 namespace Tiled {
 namespace Internal {
 
+/**
+ * Encodes the data of a single tile layer. Used to encode and compress the
+ * tile layers on multiple threads before the map is written.
+ */
+class LayerDataEncoder : public QRunnable
+{
+public:
+    LayerDataEncoder(const TileLayer *tileLayer,
+                     const GidMapper &gidMapper,
+                     Map::LayerDataFormat format,
+                     int compressionLevel,
+                     CompressionStrategy compressionStrategy);
+
+    void run();
+
+    const TileLayer * const mTileLayer;
+    QString mEncodedData;
+
+private:
+    const GidMapper &mGidMapper;
+    const Map::LayerDataFormat mFormat;
+    const int mCompressionLevel;
+    const CompressionStrategy mCompressionStrategy;
+};
+
 class MapWriterPrivate
 {
     Q_DECLARE_TR_FUNCTIONS(MapReader)
@@ -78,33 +115,232 @@ public:
     QString mError;
     Map::LayerDataFormat mLayerDataFormat;
     bool mDtdEnabled;
+    bool mParallelLayerEncoding;
+    int mCompressionLevel;
+    CompressionStrategy mCompressionStrategy;
+    LayerDataCache *mLayerDataCache;
+    ProgressContext *mProgress;
+    bool mCanceled;
 
 private:
     void writeMap(QXmlStreamWriter &w, const Map *map);
     void writeTileset(QXmlStreamWriter &w, const Tileset *tileset,
                       unsigned firstGid);
+    void encodeLayerData(const Map *map);
+    bool reuseEncodedData(const TileLayer *tileLayer);
+    QByteArray layerDataCacheKey(const Map *map) const;
     void writeTileLayer(QXmlStreamWriter &w, const TileLayer *tileLayer);
+    void writeTileLayerData(QXmlStreamWriter &w, const TileLayer *tileLayer);
     void writeLayerAttributes(QXmlStreamWriter &w, const Layer *layer);
     void writeObjectGroup(QXmlStreamWriter &w, const ObjectGroup *objectGroup);
     void writeObject(QXmlStreamWriter &w, const MapObject *mapObject);
     void writeImageLayer(QXmlStreamWriter &w, const ImageLayer *imageLayer);
     void writeProperties(QXmlStreamWriter &w,
                          const Properties &properties);
+    const QString &number(qreal value);
 
     QDir mMapDir;     // The directory in which the map is being saved
     GidMapper mGidMapper;
     bool mUseAbsolutePaths;
+    QHash<const TileLayer*, QString> mEncodedLayerData;
+    Compressor *mCompressor;
+    QByteArray mRowBuffer;  // Reused for writing all layers
+    QString mNumber;        // Reused for writing all object coordinates
+    QString mPoints;
 };
 
 } // namespace Internal
 } // namespace Tiled
 
 
+static CompressionMethod compressionMethod(Map::LayerDataFormat format)
+{
+    switch (format) {
+    case Map::Base64Gzip:       return Gzip;
+    case Map::Base64Zstandard:  return Zstandard;
+    case Map::Base64Lz4:        return Lz4;
+    default:                    return Zlib;
+    }
+}
+
+static bool isCompressed(Map::LayerDataFormat format)
+{
+    return format == Map::Base64Gzip
+            || format == Map::Base64Zlib
+            || format == Map::Base64Zstandard
+            || format == Map::Base64Lz4;
+}
+
+/**
+ * Writes the decimal representation of \a value to \a out, which needs room
+ * for at least 10 characters. Returns the number of characters written.
+ */
+static inline int formatUnsigned(char *out, unsigned value)
+{
+    char digits[10];
+    int count = 0;
+
+    do {
+        digits[count++] = char('0' + value % 10);
+        value /= 10;
+    } while (value);
+
+    for (int i = 0; i < count; ++i)
+        out[i] = digits[count - 1 - i];
+
+    return count;
+}
+
+/**
+ * Formats row \a y of the \a tileLayer as CSV into \a buffer, which is
+ * grown as needed. Returns the length of the row.
+ */
+static int formatCSVRow(QByteArray &buffer,
+                        const TileLayer *tileLayer,
+                        const GidMapper &gidMapper,
+                        int y)
+{
+    const int width = tileLayer->width();
+    const bool lastRow = y == tileLayer->height() - 1;
+
+    // Up to 10 digits and a comma per cell, and a newline
+    if (buffer.size() < width * 11 + 1)
+        buffer.resize(width * 11 + 1);
+
+    char * const begin = buffer.data();
+    char *out = begin;
+
+    for (int x = 0; x < width; ++x) {
+        out += formatUnsigned(out, gidMapper.cellToGid(tileLayer->cellAt(x, y)));
+        if (x != width - 1 || !lastRow)
+            *out++ = ',';
+    }
+    *out++ = '\n';
+
+    return out - begin;
+}
+
+/**
+ * Formats row \a y of the \a tileLayer as <tile> elements into \a buffer,
+ * matching the output of QXmlStreamWriter with auto-formatting. Returns the
+ * length of the row.
+ */
+static int formatXMLRow(QByteArray &buffer,
+                        const TileLayer *tileLayer,
+                        const GidMapper &gidMapper,
+                        int y)
+{
+    static const char tileStart[] = "\n   <tile gid=\"";
+    static const char tileEnd[] = "\"/>";
+    const int tileStartLength = sizeof(tileStart) - 1;
+    const int tileEndLength = sizeof(tileEnd) - 1;
+
+    const int width = tileLayer->width();
+    const int maxLength = width * (tileStartLength + 10 + tileEndLength);
+
+    if (buffer.size() < maxLength)
+        buffer.resize(maxLength);
+
+    char * const begin = buffer.data();
+    char *out = begin;
+
+    for (int x = 0; x < width; ++x) {
+        memcpy(out, tileStart, tileStartLength);
+        out += tileStartLength;
+        out += formatUnsigned(out, gidMapper.cellToGid(tileLayer->cellAt(x, y)));
+        memcpy(out, tileEnd, tileEndLength);
+        out += tileEndLength;
+    }
+
+    return out - begin;
+}
+
+/**
+ * Returns the data of the given \a tileLayer, encoded in the given CSV or
+ * base64 based \a format. The \a compressor is used for the compressed
+ * formats, unless the data is shared with the other formats of an export
+ * through the current LayerExportCache, which compresses using the given
+ * \a level and \a strategy.
+ */
+static QString encodeLayerData(const TileLayer *tileLayer,
+                               const GidMapper &gidMapper,
+                               Map::LayerDataFormat format,
+                               Compressor *compressor,
+                               int level,
+                               CompressionStrategy strategy)
+{
+    if (format == Map::CSV) {
+        QByteArray tileData;
+        QByteArray row;
+
+        for (int y = 0; y < tileLayer->height(); ++y) {
+            const int length = formatCSVRow(row, tileLayer, gidMapper, y);
+            tileData.append(row.constData(), length);
+        }
+
+        return QString::fromLatin1(tileData);
+    }
+
+    QByteArray tileData;
+
+    if (!isCompressed(format)) {
+        tileData = LayerExportCache::gids(tileLayer, gidMapper);
+    } else if (LayerExportCache::current()) {
+        tileData = LayerExportCache::compressedGids(tileLayer, gidMapper,
+                                                    compressionMethod(format),
+                                                    level, strategy);
+    } else {
+        tileData = compressor->compress(LayerExportCache::gids(tileLayer,
+                                                               gidMapper));
+    }
+
+    return QString::fromLatin1(tileData.toBase64());
+}
+
+
+LayerDataEncoder::LayerDataEncoder(const TileLayer *tileLayer,
+                                   const GidMapper &gidMapper,
+                                   Map::LayerDataFormat format,
+                                   int compressionLevel,
+                                   CompressionStrategy compressionStrategy)
+    : mTileLayer(tileLayer)
+    , mGidMapper(gidMapper)
+    , mFormat(format)
+    , mCompressionLevel(compressionLevel)
+    , mCompressionStrategy(compressionStrategy)
+{
+    setAutoDelete(false);
+}
+
+void LayerDataEncoder::run()
+{
+    TILED_TRACE_SCOPE_DETAIL("MapWriter::encodeLayerData", mTileLayer->name());
+
+    Compressor compressor(compressionMethod(mFormat),
+                          mCompressionLevel,
+                          mCompressionStrategy);
+
+    mEncodedData = encodeLayerData(mTileLayer, mGidMapper, mFormat,
+                                   &compressor, mCompressionLevel,
+                                   mCompressionStrategy);
+}
+
+
 MapWriterPrivate::MapWriterPrivate()
     : mLayerDataFormat(Map::Base64Zlib)
     , mDtdEnabled(false)
+    , mParallelLayerEncoding(false)
+    , mCompressionLevel(DefaultCompressionLevel)
+    , mCompressionStrategy(DefaultStrategy)
+    , mLayerDataCache(0)
+    , mProgress(0)
+    , mCanceled(false)
     , mUseAbsolutePaths(false)
+    , mCompressor(0)
 {
+    // Reserving makes the strings keep their memory when resized to 0
+    mNumber.reserve(MaxNumberLength);
+    mPoints.reserve(1024);
 }
 
 bool MapWriterPrivate::openFile(QIODevice *file)
@@ -128,9 +364,20 @@ static QXmlStreamWriter *createWriter(QIODevice *device)
 void MapWriterPrivate::writeMap(const Map *map, QIODevice *device,
                                 const QString &path)
 {
+    TILED_TRACE_SCOPE_DETAIL("MapWriter::writeMap", path);
+
     mMapDir = QDir(path);
     mUseAbsolutePaths = path.isEmpty();
     mLayerDataFormat = map->layerDataFormat();
+    mCanceled = false;
+
+    // Writing to a file fails in this case, but when writing to a device
+    // this build falls back to zlib
+    if (!isLayerDataFormatSupported(mLayerDataFormat)) {
+        qWarning("Layer data format not supported by this build, "
+                 "using zlib compression instead");
+        mLayerDataFormat = Map::Base64Zlib;
+    }
 
     QXmlStreamWriter *writer = createWriter(device);
     writer->writeStartDocument();
@@ -203,6 +450,9 @@ void MapWriterPrivate::writeMap(QXmlStreamWriter &w, const Map *map)
     w.writeAttribute(QLatin1String("nextobjectid"),
                      QString::number(map->nextObjectId()));
 
+    if (map->isInfinite())
+        w.writeAttribute(QLatin1String("infinite"), QLatin1String("1"));
+
     writeProperties(w, map->properties());
 
     mGidMapper.clear();
@@ -213,7 +463,28 @@ void MapWriterPrivate::writeMap(QXmlStreamWriter &w, const Map *map)
         firstGid += tileset->tileCount();
     }
 
-    foreach (const Layer *layer, map->layers()) {
+    // The chunks of infinite maps are encoded while they are written
+    const bool encodeAhead = (mParallelLayerEncoding || mLayerDataCache) &&
+            !map->isInfinite();
+    if (encodeAhead && mLayerDataFormat != Map::XML && !isCanceled(mProgress))
+        encodeLayerData(map);
+
+    // The same compression state is reused for all layers written here
+    if (isCompressed(mLayerDataFormat) && !encodeAhead) {
+        mCompressor = new Compressor(compressionMethod(mLayerDataFormat),
+                                     mCompressionLevel,
+                                     mCompressionStrategy);
+    }
+
+    const int layerCount = map->layerCount();
+    for (int i = 0; i < layerCount; ++i) {
+        if (isCanceled(mProgress)) {
+            mCanceled = true;
+            mError = tr("Saving the map was canceled.");
+            break;
+        }
+
+        const Layer *layer = map->layerAt(i);
         const Layer::TypeFlag type = layer->layerType();
         if (type == Layer::TileLayerType)
             writeTileLayer(w, static_cast<const TileLayer*>(layer));
@@ -221,11 +492,106 @@ void MapWriterPrivate::writeMap(QXmlStreamWriter &w, const Map *map)
             writeObjectGroup(w, static_cast<const ObjectGroup*>(layer));
         else if (type == Layer::ImageLayerType)
             writeImageLayer(w, static_cast<const ImageLayer*>(layer));
+
+        reportProgress(mProgress, i + 1, layerCount);
     }
 
+    mEncodedLayerData.clear();
+    delete mCompressor;
+    mCompressor = 0;
+    mRowBuffer.clear();
+
     w.writeEndElement();
 }
 
+/**
+ * Encodes the data of all tile layers of the \a map ahead of time. When
+ * parallel encoding is enabled, one task is used per layer. Layers whose
+ * data is found in the layer data cache are not encoded again. The results
+ * are picked up by writeTileLayer().
+ */
+void MapWriterPrivate::encodeLayerData(const Map *map)
+{
+    if (mLayerDataCache)
+        mLayerDataCache->setKey(layerDataCacheKey(map));
+
+    QList<LayerDataEncoder*> encoders;
+
+    foreach (const Layer *layer, map->layers()) {
+        if (!layer->isTileLayer())
+            continue;
+
+        const TileLayer *tileLayer = static_cast<const TileLayer*>(layer);
+
+        if (reuseEncodedData(tileLayer))
+            continue;
+
+        // Loading the cells of a lazily decoded layer changes the layer and
+        // the draw margins of the map, which is not thread-safe, so it is
+        // done here rather than by the encoders
+        tileLayer->load();
+
+        QString cachedData;
+        if (mLayerDataCache && mLayerDataCache->find(tileLayer, cachedData)) {
+            mEncodedLayerData.insert(tileLayer, cachedData);
+            continue;
+        }
+
+        encoders.append(new LayerDataEncoder(tileLayer, mGidMapper,
+                                             mLayerDataFormat,
+                                             mCompressionLevel,
+                                             mCompressionStrategy));
+    }
+
+    if (mParallelLayerEncoding) {
+        JobGroup jobs;
+        foreach (LayerDataEncoder *encoder, encoders)
+            jobs.start(encoder);
+        jobs.wait();
+    } else {
+        foreach (LayerDataEncoder *encoder, encoders)
+            encoder->run();
+    }
+
+    foreach (LayerDataEncoder *encoder, encoders) {
+        mEncodedLayerData.insert(encoder->mTileLayer, encoder->mEncodedData);
+        if (mLayerDataCache)
+            mLayerDataCache->insert(encoder->mTileLayer, encoder->mEncodedData);
+    }
+
+    qDeleteAll(encoders);
+
+    // Forget about layers that were changed or removed since the last save
+    if (mLayerDataCache)
+        mLayerDataCache->removeUnused();
+}
+
+/**
+ * Returns a key describing everything besides the cells that affects the
+ * encoded layer data: the format, the compression settings and the first
+ * global IDs of the tilesets.
+ */
+QByteArray MapWriterPrivate::layerDataCacheKey(const Map *map) const
+{
+    QByteArray key;
+    key += QByteArray::number(mLayerDataFormat);
+    key += ',';
+    key += QByteArray::number(mCompressionLevel);
+    key += ',';
+    key += QByteArray::number(mCompressionStrategy);
+
+    unsigned firstGid = 1;
+    foreach (const Tileset *tileset, map->tilesets()) {
+        key += ';';
+        key += QByteArray::number(quintptr(tileset));
+        key += ':';
+        key += QByteArray::number(firstGid);
+        firstGid += tileset->tileCount();
+    }
+
+    return key;
+}
+
 static QString makeTerrainAttribute(const Tile *tile)
 {
     QString terrain;
@@ -358,8 +724,10 @@ void MapWriterPrivate::writeTileset(QXmlStreamWriter &w, const Tileset *tileset,
                     w.writeAttribute(QLatin1String("encoding"),
                                      QLatin1String("base64"));
 
+                    // Written from the QImage, since pixmaps can only be
+                    // used on the GUI thread
                     QBuffer buffer;
-                    tile->image().save(&buffer, "png");
+                    tile->imageData().save(&buffer, "png");
                     w.writeCharacters(QString::fromLatin1(buffer.data().toBase64()));
                     w.writeEndElement(); // </data>
                 } else {
@@ -403,16 +771,17 @@ void MapWriterPrivate::writeTileLayer(QXmlStreamWriter &w,
     QString encoding;
     QString compression;
 
-    if (mLayerDataFormat == Map::Base64
-            || mLayerDataFormat == Map::Base64Gzip
-            || mLayerDataFormat == Map::Base64Zlib) {
-
+    if (mLayerDataFormat == Map::Base64 || isCompressed(mLayerDataFormat)) {
         encoding = QLatin1String("base64");
 
         if (mLayerDataFormat == Map::Base64Gzip)
             compression = QLatin1String("gzip");
         else if (mLayerDataFormat == Map::Base64Zlib)
             compression = QLatin1String("zlib");
+        else if (mLayerDataFormat == Map::Base64Zstandard)
+            compression = QLatin1String("zstd");
+        else if (mLayerDataFormat == Map::Base64Lz4)
+            compression = QLatin1String("lz4");
 
     } else if (mLayerDataFormat == Map::CSV)
         encoding = QLatin1String("csv");
@@ -423,57 +792,105 @@ void MapWriterPrivate::writeTileLayer(QXmlStreamWriter &w,
     if (!compression.isEmpty())
         w.writeAttribute(QLatin1String("compression"), compression);
 
-    if (mLayerDataFormat == Map::XML) {
-        for (int y = 0; y < tileLayer->height(); ++y) {
-            for (int x = 0; x < tileLayer->width(); ++x) {
-                const unsigned gid = mGidMapper.cellToGid(tileLayer->cellAt(x, y));
-                w.writeStartElement(QLatin1String("tile"));
-                w.writeAttribute(QLatin1String("gid"), QString::number(gid));
-                w.writeEndElement();
-            }
+    if (tileLayer->map() && tileLayer->map()->isInfinite()) {
+        // Only the chunks that contain tiles are saved
+        foreach (const QRect &rect, tileLayer->chunkRects()) {
+            w.writeStartElement(QLatin1String("chunk"));
+            w.writeAttribute(QLatin1String("x"), QString::number(rect.x()));
+            w.writeAttribute(QLatin1String("y"), QString::number(rect.y()));
+            w.writeAttribute(QLatin1String("width"),
+                             QString::number(rect.width()));
+            w.writeAttribute(QLatin1String("height"),
+                             QString::number(rect.height()));
+
+            const QScopedPointer<TileLayer> chunk(tileLayer->copy(rect));
+            writeTileLayerData(w, chunk.data());
+
+            w.writeEndElement(); // </chunk>
         }
-    } else if (mLayerDataFormat == Map::CSV) {
-        QString tileData;
+    } else {
+        writeTileLayerData(w, tileLayer);
+    }
+
+    w.writeEndElement(); // </data>
+    w.writeEndElement(); // </layer>
+}
+
+/**
+ * Uses the data of the \a tileLayer as it was read when its cells have not
+ * been loaded yet, and the data is in the format in which it is written.
+ * Returns whether the data was reused.
+ */
+bool MapWriterPrivate::reuseEncodedData(const TileLayer *tileLayer)
+{
+    if (tileLayer->isLoaded() || mLayerDataFormat == Map::XML)
+        return false;
+
+    const QString data = tileLayer->loader()->encodedData(mLayerDataFormat,
+                                                          mGidMapper);
+    if (data.isNull())
+        return false;
+
+    mEncodedLayerData.insert(tileLayer, data);
+    return true;
+}
+
+/**
+ * Writes the cells of the \a tileLayer in the current layer data format.
+ */
+void MapWriterPrivate::writeTileLayerData(QXmlStreamWriter &w,
+                                          const TileLayer *tileLayer)
+{
+    if (!mEncodedLayerData.contains(tileLayer))
+        reuseEncodedData(tileLayer);
+
+    QIODevice *device = w.device();
+    const bool precomputed = mEncodedLayerData.contains(tileLayer);
+
+    if (device && !precomputed &&
+            (mLayerDataFormat == Map::XML || mLayerDataFormat == Map::CSV)) {
+        // Write the rows straight to the device. Writing the characters
+        // first makes sure the <data> start tag has been finished.
+        const bool csv = mLayerDataFormat == Map::CSV;
+        w.writeCharacters(csv ? QLatin1String("\n") : QLatin1String(""));
 
         for (int y = 0; y < tileLayer->height(); ++y) {
-            for (int x = 0; x < tileLayer->width(); ++x) {
-                const unsigned gid = mGidMapper.cellToGid(tileLayer->cellAt(x, y));
-                tileData.append(QString::number(gid));
-                if (x != tileLayer->width() - 1
-                    || y != tileLayer->height() - 1)
-                    tileData.append(QLatin1String(","));
-            }
-            tileData.append(QLatin1String("\n"));
+            const int length = csv
+                    ? formatCSVRow(mRowBuffer, tileLayer, mGidMapper, y)
+                    : formatXMLRow(mRowBuffer, tileLayer, mGidMapper, y);
+            device->write(mRowBuffer.constData(), length);
         }
 
-        w.writeCharacters(QLatin1String("\n"));
-        w.writeCharacters(tileData);
-    } else {
-        QByteArray tileData;
-        tileData.reserve(tileLayer->height() * tileLayer->width() * 4);
-
+        if (!csv)
+            w.writeCharacters(QLatin1String("\n  "));
+    } else if (mLayerDataFormat == Map::XML) {
         for (int y = 0; y < tileLayer->height(); ++y) {
             for (int x = 0; x < tileLayer->width(); ++x) {
                 const unsigned gid = mGidMapper.cellToGid(tileLayer->cellAt(x, y));
-                tileData.append((char) (gid));
-                tileData.append((char) (gid >> 8));
-                tileData.append((char) (gid >> 16));
-                tileData.append((char) (gid >> 24));
+                w.writeStartElement(QLatin1String("tile"));
+                w.writeAttribute(QLatin1String("gid"), QString::number(gid));
+                w.writeEndElement();
             }
         }
-
-        if (mLayerDataFormat == Map::Base64Gzip)
-            tileData = compress(tileData, Gzip);
-        else if (mLayerDataFormat == Map::Base64Zlib)
-            tileData = compress(tileData, Zlib);
-
-        w.writeCharacters(QLatin1String("\n   "));
-        w.writeCharacters(QString::fromLatin1(tileData.toBase64()));
-        w.writeCharacters(QLatin1String("\n  "));
+    } else {
+        QHash<const TileLayer*, QString>::const_iterator it =
+                mEncodedLayerData.constFind(tileLayer);
+
+        const QString tileData = it != mEncodedLayerData.constEnd()
+                ? it.value()
+                : ::encodeLayerData(tileLayer, mGidMapper, mLayerDataFormat,
+                                    mCompressor, mCompressionLevel,
+                                    mCompressionStrategy);
+
+        if (mLayerDataFormat == Map::CSV) {
+            w.writeCharacters(QLatin1String("\n"));
+            w.writeCharacters(tileData);
+        } else {
+            w.writeCharacters(QLatin1String("\n   "));
+            w.writeCharacters(tileData);
+            w.writeCharacters(QLatin1String("\n  "));
+        }
     }
-
-    w.writeEndElement(); // </data>
-    w.writeEndElement(); // </layer>
 }
 
 void MapWriterPrivate::writeLayerAttributes(QXmlStreamWriter &w,
@@ -545,17 +962,17 @@ void MapWriterPrivate::writeObject(QXmlStreamWriter &w,
     QPointF pos = QPointF(mapObject->x(), mapObject->y());
     QPointF size = QPointF(mapObject->width(), mapObject->height());
 
-    w.writeAttribute(QLatin1String("x"), QString::number(pos.x()));
-    w.writeAttribute(QLatin1String("y"), QString::number(pos.y()));
+    w.writeAttribute(QLatin1String("x"), number(pos.x()));
+    w.writeAttribute(QLatin1String("y"), number(pos.y()));
 
     if (size.x() != 0)
-        w.writeAttribute(QLatin1String("width"), QString::number(size.x()));
+        w.writeAttribute(QLatin1String("width"), number(size.x()));
     if (size.y() != 0)
-        w.writeAttribute(QLatin1String("height"), QString::number(size.y()));
+        w.writeAttribute(QLatin1String("height"), number(size.y()));
 
     const qreal rotation = mapObject->rotation();
     if (rotation != 0.0)
-        w.writeAttribute(QLatin1String("rotation"), QString::number(rotation));
+        w.writeAttribute(QLatin1String("rotation"), number(rotation));
 
     if (!mapObject->isVisible())
         w.writeAttribute(QLatin1String("visible"), QLatin1String("0"));
@@ -569,15 +986,15 @@ void MapWriterPrivate::writeObject(QXmlStreamWriter &w,
         else
             w.writeStartElement(QLatin1String("polyline"));
 
-        QString points;
+        mPoints.resize(0);
         foreach (const QPointF &point, polygon) {
-            points.append(QString::number(point.x()));
-            points.append(QLatin1Char(','));
-            points.append(QString::number(point.y()));
-            points.append(QLatin1Char(' '));
+            appendNumber(mPoints, point.x());
+            mPoints.append(QLatin1Char(','));
+            appendNumber(mPoints, point.y());
+            mPoints.append(QLatin1Char(' '));
         }
-        points.chop(1);
-        w.writeAttribute(QLatin1String("points"), points);
+        mPoints.chop(1);
+        w.writeAttribute(QLatin1String("points"), mPoints);
         w.writeEndElement();
     }
 
@@ -587,6 +1004,17 @@ void MapWriterPrivate::writeObject(QXmlStreamWriter &w,
     w.writeEndElement();
 }
 
+/**
+ * Returns the text of \a value, as QString::number() would. The string is
+ * reused, so it is only valid until the next call.
+ */
+const QString &MapWriterPrivate::number(qreal value)
+{
+    mNumber.resize(0);
+    appendNumber(mNumber, value);
+    return mNumber;
+}
+
 void MapWriterPrivate::writeImageLayer(QXmlStreamWriter &w,
                                         const ImageLayer *imageLayer)
 {
@@ -659,6 +1087,13 @@ void MapWriter::writeMap(const Map *map, QIODevice *device,
 
 bool MapWriter::writeMap(const Map *map, const QString &fileName)
 {
+    if (!isLayerDataFormatSupported(map->layerDataFormat())) {
+        d->mError = MapWriterPrivate::tr("The tile layer format of this map "
+                                         "uses a compression method that is "
+                                         "not supported by this build.");
+        return false;
+    }
+
 #ifdef HAS_QSAVEFILE_SUPPORT
     QSaveFile file(fileName);
 #else
@@ -669,6 +1104,13 @@ bool MapWriter::writeMap(const Map *map, const QString &fileName)
 
     writeMap(map, &file, QFileInfo(fileName).absolutePath());
 
+    if (d->mCanceled) {
+#ifdef HAS_QSAVEFILE_SUPPORT
+        file.cancelWriting();
+#endif
+        return false;
+    }
+
     if (file.error() != QFile::NoError) {
         d->mError = file.errorString();
         return false;
@@ -679,8 +1121,13 @@ bool MapWriter::writeMap(const Map *map, const QString &fileName)
         d->mError = file.errorString();
         return false;
     }
+#else
+    file.close();
 #endif
 
+    // Lets the map be opened again without decoding its layers
+    MapCellCache::write(fileName, map);
+
     return true;
 }
 
@@ -720,3 +1167,53 @@ bool MapWriter::isDtdEnabled() const
 {
     return d->mDtdEnabled;
 }
+
+void MapWriter::setParallelLayerEncoding(bool enabled)
+{
+    d->mParallelLayerEncoding = enabled;
+}
+
+bool MapWriter::parallelLayerEncoding() const
+{
+    return d->mParallelLayerEncoding;
+}
+
+void MapWriter::setCompressionLevel(int level)
+{
+    d->mCompressionLevel = level;
+}
+
+int MapWriter::compressionLevel() const
+{
+    return d->mCompressionLevel;
+}
+
+void MapWriter::setCompressionStrategy(CompressionStrategy strategy)
+{
+    d->mCompressionStrategy = strategy;
+}
+
+CompressionStrategy MapWriter::compressionStrategy() const
+{
+    return d->mCompressionStrategy;
+}
+
+void MapWriter::setLayerDataCache(LayerDataCache *cache)
+{
+    d->mLayerDataCache = cache;
+}
+
+LayerDataCache *MapWriter::layerDataCache() const
+{
+    return d->mLayerDataCache;
+}
+
+void MapWriter::setProgressContext(ProgressContext *progress)
+{
+    d->mProgress = progress;
+}
+
+ProgressContext *MapWriter::progressContext() const
+{
+    return d->mProgress;
+}
@@ -30,6 +30,7 @@
 #ifndef MAPWRITER_H
 #define MAPWRITER_H
 
+#include "compression.h"
 #include "map.h"
 #include "tiled_global.h"
 
@@ -39,7 +40,9 @@ class QIODevice;
 
 namespace Tiled {
 
+class LayerDataCache;
 class Map;
+class ProgressContext;
 class Tileset;
 
 namespace Internal {
@@ -104,6 +107,48 @@ public:
     void setDtdEnabled(bool enabled);
     bool isDtdEnabled() const;
 
+    /**
+     * Sets whether the data of tile layers is encoded on multiple threads.
+     * When enabled, all tile layers are encoded and compressed up front,
+     * using one task per layer, before the map is written out in order.
+     *
+     * The written map is the same either way. Disabled by default.
+     */
+    void setParallelLayerEncoding(bool enabled);
+    bool parallelLayerEncoding() const;
+
+    /**
+     * Sets the compression level used for the compressed layer data formats,
+     * from 0 (fastest) to 9 (smallest). Defaults to DefaultCompressionLevel.
+     */
+    void setCompressionLevel(int level);
+    int compressionLevel() const;
+
+    /**
+     * Sets the compression strategy used for the compressed layer data
+     * formats.
+     */
+    void setCompressionStrategy(CompressionStrategy strategy);
+    CompressionStrategy compressionStrategy() const;
+
+    /**
+     * Sets the cache used to remember the encoded data of tile layers
+     * between writes, so that unchanged layers don't need to be encoded
+     * again. Only used for the CSV and Base64 layer data formats. The cache
+     * is not owned by the writer. Defaults to none.
+     */
+    void setLayerDataCache(LayerDataCache *cache);
+    LayerDataCache *layerDataCache() const;
+
+    /**
+     * Sets the context to report the progress of writing a map to, as the
+     * number of layers written. When the context gets canceled, writing
+     * stops after the current layer and writeMap() fails. When writing to
+     * a file, the existing file is then left untouched where supported.
+     */
+    void setProgressContext(ProgressContext *progress);
+    ProgressContext *progressContext() const;
+
 private:
     Internal::MapWriterPrivate *d;
 };
@@ -37,6 +37,7 @@ class QString;
 namespace Tiled {
 
 class Map;
+class ProgressContext;
 
 /**
  * An interface to be implemented by map writers. A map writer implements
@@ -53,10 +54,14 @@ public:
     /**
      * Writes the given map to the given file name.
      *
+     * When a \a progress context is given, the writer may report its
+     * progress to it and should fail when it gets canceled.
+     *
      * @return <code>true</code> on success, <code>false</code> when an error
      *         occurred. The error can be retrieved by errorString().
      */
-    virtual bool write(const Map *map, const QString &fileName) = 0;
+    virtual bool write(const Map *map, const QString &fileName,
+                       ProgressContext *progress = 0) = 0;
 
     /**
      * Returns name filters of this map writer, for multiple formats.
@@ -83,7 +88,9 @@ protected:
 
 } // namespace Tiled
 
+// Bump the version whenever the virtual functions change, so that plugins
+// built against an older interface are rejected
 Q_DECLARE_INTERFACE(Tiled::MapWriterInterface,
-                    "org.mapeditor.MapWriterInterface")
+                    "org.mapeditor.MapWriterInterface/2")
 
 #endif // MAPWRITERINTERFACE_H
@@ -0,0 +1,84 @@
+/*
+ * memoryusage.h
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MEMORYUSAGE_H
+#define MEMORYUSAGE_H
+
+#include "properties.h"
+
+#include <QPainterPath>
+#include <QPixmap>
+#include <QPolygonF>
+#include <QString>
+
+namespace Tiled {
+
+/*
+ * Helpers for estimating the memory used by the data of a map, in bytes.
+ * Implicitly shared data is counted for each of its users, so these numbers
+ * tell where memory would go if nothing was shared.
+ */
+
+// The bookkeeping of each entry of a QMap or QHash, roughly
+static const int ContainerNodeSize = 3 * sizeof(void*);
+
+inline qint64 stringMemoryUsage(const QString &string)
+{
+    return qint64(string.capacity()) * sizeof(QChar);
+}
+
+inline qint64 propertiesMemoryUsage(const Properties &properties)
+{
+    qint64 usage = qint64(properties.size()) * ContainerNodeSize;
+
+    Properties::const_iterator it = properties.constBegin();
+    Properties::const_iterator end = properties.constEnd();
+    for (; it != end; ++it)
+        usage += stringMemoryUsage(it.key()) + stringMemoryUsage(it.value());
+
+    return usage;
+}
+
+inline qint64 pixmapMemoryUsage(const QPixmap &pixmap)
+{
+    return qint64(pixmap.width()) * pixmap.height() * pixmap.depth() / 8;
+}
+
+inline qint64 polygonMemoryUsage(const QPolygonF &polygon)
+{
+    return qint64(polygon.capacity()) * sizeof(QPointF);
+}
+
+inline qint64 pathMemoryUsage(const QPainterPath &path)
+{
+    return qint64(path.elementCount()) * sizeof(QPainterPath::Element);
+}
+
+} // namespace Tiled
+
+#endif // MEMORYUSAGE_H
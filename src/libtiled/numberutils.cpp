@@ -0,0 +1,155 @@
+/*
+ * numberutils.cpp
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "numberutils.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace Tiled {
+
+static const double powersOfTen[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+    1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19
+};
+
+/**
+ * The fast path finds the fewest decimals \a k for which value * 10^k is a
+ * whole number m, within a relative tolerance. The text of m / 10^k is then
+ * what the generic conversion produces, as long as m has at most
+ * \a precision digits and value * 10^k, including the error of the
+ * multiplication, is closer to m than half a unit in its last significant
+ * digit. That half unit is at least 0.5 * 10^-precision relative to the
+ * value, so the tolerance is kept well below that. From a precision of 15
+ * only exact whole numbers qualify, and beyond that the multiplication is
+ * not accurate enough.
+ */
+static bool formatDecimal(double value, char *buffer, int precision,
+                          int *length)
+{
+    if (precision < 1 || precision > 15)
+        return false;
+
+    const bool negative = value < 0;
+    const double magnitude = negative ? -value : value;
+
+    // Smaller numbers are written with an exponent
+    if (!(magnitude >= 1e-4 && magnitude < powersOfTen[precision]))
+        return false;
+
+    const double tolerance = precision < 15 ? 0.1 / powersOfTen[precision] : 0;
+    const double limit = powersOfTen[precision];
+
+    for (int k = 0; k <= precision + 3; ++k) {
+        const double scaled = magnitude * powersOfTen[k];
+        if (scaled >= limit)
+            return false;
+
+        const double rounded = std::floor(scaled + 0.5);
+        if (rounded >= limit)
+            return false;
+        if (std::fabs(scaled - rounded) > scaled * tolerance)
+            continue;
+
+        quint64 m = quint64(rounded);
+
+        // Near the tolerance, a match may only be found at a higher k
+        int decimals = k;
+        while (decimals > 0 && m % 10 == 0) {
+            m /= 10;
+            --decimals;
+        }
+
+        char digits[24];
+        int count = 0;
+        do {
+            digits[count++] = char('0' + m % 10);
+            m /= 10;
+        } while (m > 0);
+
+        // Leading zeros for numbers below 1
+        while (count <= decimals)
+            digits[count++] = '0';
+
+        char *out = buffer;
+        if (negative)
+            *out++ = '-';
+        while (count > decimals)
+            *out++ = digits[--count];
+        if (decimals > 0) {
+            *out++ = '.';
+            while (count > 0)
+                *out++ = digits[--count];
+        }
+
+        *length = int(out - buffer);
+        return true;
+    }
+
+    return false;
+}
+
+int formatNumber(double value, char *buffer, int precision)
+{
+    // Zero is common, but negative zero is left to the generic conversion
+    quint64 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    if (bits == 0) {
+        buffer[0] = '0';
+        return 1;
+    }
+
+    int length;
+    if (formatDecimal(value, buffer, precision, &length))
+        return length;
+
+    const QByteArray text = QByteArray::number(value, 'g', precision);
+    length = qMin(text.size(), MaxNumberLength);
+    std::memcpy(buffer, text.constData(), length);
+    return length;
+}
+
+void appendNumber(QString &text, double value, int precision)
+{
+    char buffer[MaxNumberLength];
+    const int length = formatNumber(value, buffer, precision);
+
+    const int size = text.size();
+    text.resize(size + length);
+    QChar *out = text.data() + size;
+    for (int i = 0; i < length; ++i)
+        out[i] = QLatin1Char(buffer[i]);
+}
+
+void appendNumber(QByteArray &data, double value, int precision)
+{
+    char buffer[MaxNumberLength];
+    data.append(buffer, formatNumber(value, buffer, precision));
+}
+
+} // namespace Tiled
@@ -0,0 +1,70 @@
+/*
+ * numberutils.h
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef NUMBERUTILS_H
+#define NUMBERUTILS_H
+
+#include "tiled_global.h"
+
+#include <QByteArray>
+#include <QString>
+
+namespace Tiled {
+
+/**
+ * The maximum number of characters written by formatNumber().
+ */
+const int MaxNumberLength = 32;
+
+/**
+ * Writes \a value to \a buffer as QString::number(value, 'g', precision)
+ * would, and returns the number of characters written. The buffer needs
+ * room for MaxNumberLength characters and is not null-terminated.
+ *
+ * Values that are a whole number, or have few decimals, are formatted
+ * without going through the generic conversion, which makes writing maps
+ * with many objects and polygon points a lot faster.
+ */
+TILEDSHARED_EXPORT int formatNumber(double value, char *buffer,
+                                    int precision = 6);
+
+/**
+ * Appends \a value to \a text, formatted by formatNumber().
+ */
+TILEDSHARED_EXPORT void appendNumber(QString &text, double value,
+                                     int precision = 6);
+
+/**
+ * Appends \a value to \a data, formatted by formatNumber().
+ */
+TILEDSHARED_EXPORT void appendNumber(QByteArray &data, double value,
+                                     int precision = 6);
+
+} // namespace Tiled
+
+#endif // NUMBERUTILS_H
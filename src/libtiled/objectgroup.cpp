@@ -33,6 +33,8 @@
 #include "layer.h"
 #include "map.h"
 #include "mapobject.h"
+#include "memoryusage.h"
+#include "objectindex.h"
 #include "tile.h"
 #include "tileset.h"
 
@@ -43,6 +45,8 @@ using namespace Tiled;
 ObjectGroup::ObjectGroup()
     : Layer(ObjectGroupType, QString(), 0, 0, 0, 0)
     , mDrawOrder(TopDownOrder)
+    , mIndex(0)
+    , mBoundingRectDirty(false)
 {
 }
 
@@ -50,18 +54,26 @@ ObjectGroup::ObjectGroup(const QString &name,
                          int x, int y, int width, int height)
     : Layer(ObjectGroupType, name, x, y, width, height)
     , mDrawOrder(TopDownOrder)
+    , mIndex(0)
+    , mBoundingRectDirty(false)
 {
 }
 
 ObjectGroup::~ObjectGroup()
 {
     qDeleteAll(mObjects);
+    delete mIndex;
 }
 
 void ObjectGroup::addObject(MapObject *object)
 {
     mObjects.append(object);
     object->setObjectGroup(this);
+    if (mIndex)
+        mIndex->insert(object);
+    if (!mBoundingRectDirty)
+        mBoundingRect = mBoundingRect.united(object->bounds());
+    mObjectOrder.clear();
     if (mMap && object->id() == 0)
         object->setId(mMap->takeNextObjectId());
 }
@@ -70,6 +82,11 @@ void ObjectGroup::insertObject(int index, MapObject *object)
 {
     mObjects.insert(index, object);
     object->setObjectGroup(this);
+    if (mIndex)
+        mIndex->insert(object);
+    if (!mBoundingRectDirty)
+        mBoundingRect = mBoundingRect.united(object->bounds());
+    mObjectOrder.clear();
     if (mMap && object->id() == 0)
         object->setId(mMap->takeNextObjectId());
 }
@@ -81,6 +98,10 @@ int ObjectGroup::removeObject(MapObject *object)
 
     mObjects.removeAt(index);
     object->setObjectGroup(0);
+    if (mIndex)
+        mIndex->remove(object);
+    objectBoundsRemoved(object->bounds());
+    mObjectOrder.clear();
     return index;
 }
 
@@ -88,6 +109,10 @@ void ObjectGroup::removeObjectAt(int index)
 {
     MapObject *object = mObjects.takeAt(index);
     object->setObjectGroup(0);
+    if (mIndex)
+        mIndex->remove(object);
+    objectBoundsRemoved(object->bounds());
+    mObjectOrder.clear();
 }
 
 void ObjectGroup::moveObjects(int from, int to, int count)
@@ -110,14 +135,105 @@ void ObjectGroup::moveObjects(int from, int to, int count)
 
     for (int i = 0; i < count; ++i)
         mObjects.insert(to + i, movingObjects.at(i));
+
+    mObjectOrder.clear();
+}
+
+int ObjectGroup::objectIndex(const MapObject *object) const
+{
+    if (object->objectGroup() != this)
+        return -1;
+
+    return objectOrder().value(object, -1);
+}
+
+const QHash<const MapObject*, int> &ObjectGroup::objectOrder() const
+{
+    if (mObjectOrder.isEmpty() && !mObjects.isEmpty()) {
+        mObjectOrder.reserve(mObjects.size());
+        for (int i = 0; i < mObjects.size(); ++i)
+            mObjectOrder.insert(mObjects.at(i), i);
+    }
+    return mObjectOrder;
+}
+
+namespace {
+
+struct ObjectOrderLessThan
+{
+    explicit ObjectOrderLessThan(const QHash<const MapObject*, int> &order)
+        : mOrder(order)
+    {}
+
+    bool operator()(const MapObject *a, const MapObject *b) const
+    { return mOrder.value(a) < mOrder.value(b); }
+
+    const QHash<const MapObject*, int> &mOrder;
+};
+
+} // anonymous namespace
+
+QList<MapObject*> ObjectGroup::objectsIn(const QRectF &rect) const
+{
+    if (!mIndex) {
+        mIndex = new ObjectIndex;
+        foreach (MapObject *object, mObjects)
+            mIndex->insert(object);
+    }
+
+    QVector<MapObject*> found = mIndex->query(rect);
+
+    if (found.size() > 1)
+        qSort(found.begin(), found.end(), ObjectOrderLessThan(objectOrder()));
+
+    return found.toList();
+}
+
+/**
+ * Keeps the cached bounding rect up to date while objects are moved or
+ * resized, so that it doesn't need to be recalculated from all objects.
+ */
+void ObjectGroup::objectGeometryChanged(MapObject *object,
+                                        const QRectF &oldBounds)
+{
+    if (mIndex)
+        mIndex->markDirty(object);
+
+    const QRectF bounds = object->bounds();
+    if (bounds == oldBounds)
+        return;
+
+    objectBoundsRemoved(oldBounds);
+    if (!mBoundingRectDirty)
+        mBoundingRect = mBoundingRect.united(bounds);
+}
+
+/**
+ * Only objects touching the edge of the cached bounding rect can make it
+ * shrink, so the rect is only recalculated when such an object goes away.
+ */
+void ObjectGroup::objectBoundsRemoved(const QRectF &bounds)
+{
+    if (mBoundingRectDirty)
+        return;
+
+    if (bounds.left() <= mBoundingRect.left() ||
+            bounds.top() <= mBoundingRect.top() ||
+            bounds.right() >= mBoundingRect.right() ||
+            bounds.bottom() >= mBoundingRect.bottom())
+        mBoundingRectDirty = true;
 }
 
 QRectF ObjectGroup::objectsBoundingRect() const
 {
-    QRectF boundingRect;
-    foreach (const MapObject *object, mObjects)
-        boundingRect = boundingRect.united(object->bounds());
-    return boundingRect;
+    if (mBoundingRectDirty) {
+        QRectF boundingRect;
+        foreach (const MapObject *object, mObjects)
+            boundingRect = boundingRect.united(object->bounds());
+        mBoundingRect = boundingRect;
+        mBoundingRectDirty = false;
+    }
+    return mBoundingRect;
 }
 
 bool ObjectGroup::isEmpty() const
@@ -212,6 +328,20 @@ Layer *ObjectGroup::clone() const
     return initializeClone(new ObjectGroup(mName, mX, mY, mWidth, mHeight));
 }
 
+qint64 ObjectGroup::memoryUsage() const
+{
+    qint64 usage = sizeof(ObjectGroup);
+    usage += stringMemoryUsage(mName);
+    usage += propertiesMemoryUsage(properties());
+    usage += qint64(mObjects.size()) * sizeof(MapObject*);
+    usage += qint64(mObjectOrder.size()) * ContainerNodeSize;
+
+    foreach (const MapObject *object, mObjects)
+        usage += object->memoryUsage();
+
+    return usage;
+}
+
 ObjectGroup *ObjectGroup::initializeClone(ObjectGroup *clone) const
 {
     Layer::initializeClone(clone);
@@ -36,12 +36,14 @@
 #include "layer.h"
 
 #include <QColor>
+#include <QHash>
 #include <QList>
 #include <QMetaType>
 
 namespace Tiled {
 
 class MapObject;
+class ObjectIndex;
 
 /**
  * A group of objects on a map.
@@ -91,6 +93,15 @@ public:
      */
     MapObject *objectAt(int index) const { return mObjects.at(index); }
 
+    /**
+     * Returns the index of the given object, or -1 when it is not part of
+     * this object group.
+     *
+     * The indexes are cached until the objects are changed, so looking up
+     * many objects doesn't need to search the list for each of them.
+     */
+    int objectIndex(const MapObject *object) const;
+
     /**
      * Adds an object to this object group.
      */
@@ -129,8 +140,22 @@ public:
      */
     void moveObjects(int from, int to, int count);
 
+    /**
+     * Returns the objects overlapping the given \a rect, in pixel
+     * coordinates, in the order they have in this group. The bounds of an
+     * object take into account its rotation, but not the offset or size of
+     * the tile image of tile objects.
+     *
+     * A spatial index is built on the first call, so that later calls
+     * don't need to check each object. Once built, the index may be queried
+     * from multiple threads as long as the objects don't change.
+     */
+    QList<MapObject*> objectsIn(const QRectF &rect) const;
+
     /**
      * Returns the bounding rect around all objects in this object group.
+     * The rect is cached, and only recalculated after objects have changed
+     * or when an object at its edge was removed.
      */
     QRectF objectsBoundingRect() const;
 
@@ -178,13 +203,27 @@ public:
 
     Layer *clone() const;
 
+    qint64 memoryUsage() const;
+
 protected:
     ObjectGroup *initializeClone(ObjectGroup *clone) const;
 
 private:
+    friend class MapObject;
+    void objectGeometryChanged(MapObject *object, const QRectF &oldBounds);
+    void objectBoundsRemoved(const QRectF &bounds);
+    const QHash<const MapObject*, int> &objectOrder() const;
+
     QList<MapObject*> mObjects;
     QColor mColor;
     DrawOrder mDrawOrder;
+
+    mutable ObjectIndex *mIndex;
+    mutable QHash<const MapObject*, int> mObjectOrder;
+    mutable QRectF mBoundingRect;
+    mutable bool mBoundingRectDirty;
+
+    Q_DISABLE_COPY(ObjectGroup)
 };
 
 
@@ -0,0 +1,205 @@
+/*
+ * objectindex.cpp
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "objectindex.h"
+
+#include "mapobject.h"
+
+#include <QTransform>
+#include <QtCore/qmath.h>
+
+using namespace Tiled;
+
+namespace {
+
+// The width and height of a grid cell, in pixels
+const qreal CellSize = 256;
+
+// Objects overlapping more cells than this are not stored in the grid
+const int MaxCellsPerObject = 64;
+
+inline quint64 cellKey(int x, int y)
+{
+    return (quint64(quint32(y)) << 32) | quint32(x);
+}
+
+// Unlike QRectF::intersects, this also matches rectangles without area
+inline bool overlaps(const QRectF &a, const QRectF &b)
+{
+    return a.left() <= b.right() && b.left() <= a.right() &&
+            a.top() <= b.bottom() && b.top() <= a.bottom();
+}
+
+} // anonymous namespace
+
+void ObjectIndex::insert(MapObject *object)
+{
+    mDirty.remove(object);
+    add(object);
+}
+
+void ObjectIndex::remove(MapObject *object)
+{
+    mDirty.remove(object);
+    take(object);
+}
+
+QVector<MapObject*> ObjectIndex::query(const QRectF &queryRect)
+{
+    const QRectF rect = queryRect.normalized();
+
+    // Without changed objects the index is only read, which allows it to be
+    // queried from multiple threads
+    if (!mDirty.isEmpty()) {
+        foreach (MapObject *object, mDirty) {
+            take(object);
+            add(object);
+        }
+        mDirty.clear();
+    }
+
+    QSet<MapObject*> candidates;
+    const QRect range = cellRange(rect);
+
+    if (qint64(range.width()) * range.height() > mCells.size()) {
+        // Visiting the occupied cells is cheaper than visiting the range
+        QHash<quint64, QVector<MapObject*> >::const_iterator it = mCells.constBegin();
+        for (; it != mCells.constEnd(); ++it) {
+            const int x = int(quint32(it.key()));
+            const int y = int(quint32(it.key() >> 32));
+            if (range.contains(x, y))
+                foreach (MapObject *object, it.value())
+                    candidates.insert(object);
+        }
+    } else {
+        for (int y = range.top(); y <= range.bottom(); ++y) {
+            for (int x = range.left(); x <= range.right(); ++x) {
+                QHash<quint64, QVector<MapObject*> >::const_iterator it =
+                        mCells.constFind(cellKey(x, y));
+                if (it != mCells.constEnd())
+                    foreach (MapObject *object, it.value())
+                        candidates.insert(object);
+            }
+        }
+    }
+
+    candidates.unite(mLargeObjects);
+
+    QVector<MapObject*> result;
+    foreach (MapObject *object, candidates)
+        if (overlaps(objectBounds(object), rect))
+            result.append(object);
+
+    return result;
+}
+
+QRectF ObjectIndex::objectBounds(const MapObject *object)
+{
+    const QPointF &pos = object->position();
+    QRectF bounds;
+
+    if (!object->cell().isEmpty()) {
+        // Tile objects are aligned bottom-left, or bottom-center on
+        // isometric maps, so cover both
+        const QSizeF &size = object->size();
+        bounds = QRectF(pos.x() - size.width() / 2, pos.y() - size.height(),
+                        size.width() * 1.5, size.height());
+        bounds |= object->boundsUseTile();
+    } else if (object->shape() == MapObject::Polygon ||
+               object->shape() == MapObject::Polyline) {
+        bounds = object->polygon().boundingRect().translated(pos);
+    } else {
+        bounds = object->bounds();
+    }
+
+    if (object->rotation() != 0) {
+        QTransform transform;
+        transform.translate(pos.x(), pos.y());
+        transform.rotate(object->rotation());
+        transform.translate(-pos.x(), -pos.y());
+        bounds = transform.mapRect(bounds);
+    }
+
+    return bounds;
+}
+
+QRect ObjectIndex::cellRange(const QRectF &rect) const
+{
+    return QRect(QPoint(qFloor(rect.left() / CellSize),
+                        qFloor(rect.top() / CellSize)),
+                 QPoint(qFloor(rect.right() / CellSize),
+                        qFloor(rect.bottom() / CellSize)));
+}
+
+void ObjectIndex::add(MapObject *object)
+{
+    const QRect range = cellRange(objectBounds(object));
+
+    if (qint64(range.width()) * range.height() > MaxCellsPerObject) {
+        mLargeObjects.insert(object);
+        mCellRanges.insert(object, QRect());
+        return;
+    }
+
+    for (int y = range.top(); y <= range.bottom(); ++y)
+        for (int x = range.left(); x <= range.right(); ++x)
+            mCells[cellKey(x, y)].append(object);
+
+    mCellRanges.insert(object, range);
+}
+
+void ObjectIndex::take(MapObject *object)
+{
+    QHash<MapObject*, QRect>::iterator rangeIt = mCellRanges.find(object);
+    if (rangeIt == mCellRanges.end())
+        return;
+
+    const QRect range = rangeIt.value();
+    mCellRanges.erase(rangeIt);
+
+    if (range.isNull()) {
+        mLargeObjects.remove(object);
+        return;
+    }
+
+    for (int y = range.top(); y <= range.bottom(); ++y) {
+        for (int x = range.left(); x <= range.right(); ++x) {
+            QHash<quint64, QVector<MapObject*> >::iterator it =
+                    mCells.find(cellKey(x, y));
+            if (it == mCells.end())
+                continue;
+
+            QVector<MapObject*> &objects = it.value();
+            const int index = objects.indexOf(object);
+            if (index != -1)
+                objects.remove(index);
+            if (objects.isEmpty())
+                mCells.erase(it);
+        }
+    }
+}
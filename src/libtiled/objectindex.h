@@ -0,0 +1,87 @@
+/*
+ * objectindex.h
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef OBJECTINDEX_H
+#define OBJECTINDEX_H
+
+#include <QHash>
+#include <QRect>
+#include <QRectF>
+#include <QSet>
+#include <QVector>
+
+namespace Tiled {
+
+class MapObject;
+
+/**
+ * A spatial index of map objects, used by ObjectGroup to find the objects
+ * within an area without checking each of them.
+ *
+ * Objects are stored in each cell of a uniform grid that their bounds
+ * overlap. Objects covering a large number of cells are kept in a separate
+ * list instead, which is always checked. Changed objects are only moved to
+ * their new cells on the next query.
+ */
+class ObjectIndex
+{
+public:
+    void insert(MapObject *object);
+    void remove(MapObject *object);
+
+    /**
+     * Marks the geometry of the given \a object as changed.
+     */
+    void markDirty(MapObject *object) { mDirty.insert(object); }
+
+    /**
+     * Returns the objects whose bounds overlap \a rect, in no particular
+     * order.
+     */
+    QVector<MapObject*> query(const QRectF &rect);
+
+    /**
+     * Returns the area covered by the given object, in pixels, taking into
+     * account its rotation.
+     */
+    static QRectF objectBounds(const MapObject *object);
+
+private:
+    QRect cellRange(const QRectF &rect) const;
+    void add(MapObject *object);
+    void take(MapObject *object);
+
+    QHash<quint64, QVector<MapObject*> > mCells;
+    QHash<MapObject*, QRect> mCellRanges;
+    QSet<MapObject*> mLargeObjects;
+    QSet<MapObject*> mDirty;
+};
+
+} // namespace Tiled
+
+#endif // OBJECTINDEX_H
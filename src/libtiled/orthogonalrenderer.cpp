@@ -33,11 +33,69 @@
 #include "tile.h"
 #include "tilelayer.h"
 #include "tileset.h"
+#include "trace.h"
 
+#include <QVarLengthArray>
 #include <QtCore/qmath.h>
 
 using namespace Tiled;
 
+namespace {
+
+/**
+ * A part of a row of cells that is stored contiguously.
+ */
+struct CellSpan
+{
+    int x;
+    int count;
+    const Cell *cells;
+};
+
+/**
+ * Draws the cells of row \a y from \a startX up to and including \a endX,
+ * going over the cell storage directly. The direction is a template
+ * parameter, so that the loops for each render order are compiled
+ * separately.
+ */
+template<bool LeftToRight>
+void drawCellRow(CellRenderer &renderer, const TileLayer *layer,
+                 int startX, int endX, int y,
+                 int tileWidth, qreal bottom)
+{
+    QVarLengthArray<CellSpan, 16> spans;
+
+    for (int x = startX; x <= endX;) {
+        CellSpan span;
+        span.x = x;
+        span.cells = layer->cellRow(x, y, &span.count);
+        span.count = qMin(span.count, endX - x + 1);
+        x += span.count;
+
+        // Skip the parts of the row where no tiles have been placed
+        if (span.cells)
+            spans.append(span);
+    }
+
+    for (int s = 0; s < spans.size(); ++s) {
+        const CellSpan &span = spans.at(LeftToRight ? s : spans.size() - 1 - s);
+
+        for (int i = 0; i < span.count; ++i) {
+            const int index = LeftToRight ? i : span.count - 1 - i;
+            const Cell &cell = span.cells[index];
+            if (cell.isEmpty())
+                continue;
+
+            renderer.render(cell,
+                            QPointF((span.x + index) * tileWidth, bottom),
+                            QSizeF(0, 0),
+                            CellRenderer::BottomLeft);
+        }
+    }
+}
+
+} // anonymous namespace
+
 QSize OrthogonalRenderer::mapSize() const
 {
     return QSize(map()->width() * map()->tileWidth(),
@@ -57,14 +115,16 @@ QRect OrthogonalRenderer::boundingRect(const QRect &rect) const
 
 QRectF OrthogonalRenderer::boundingRect(const MapObject *object) const
 {
-    const QRectF bounds = object->bounds();
-
     QRectF boundingRect;
+    if (cachedBoundingRect(object, boundingRect))
+        return boundingRect;
+
+    const QRectF bounds = object->bounds();
 
     if (!object->cell().isEmpty()) {
         const QPointF bottomLeft = bounds.topLeft();
         const Tile *tile = object->cell().tile;
-        const QSize imgSize = tile->image().size();
+        const QSize imgSize = tile->size();
         const QPoint tileOffset = tile->tileset()->tileOffset();
         const QSizeF objectSize = object->size();
         const QSizeF scale(objectSize.width() / imgSize.width(), objectSize.height() / imgSize.height());
@@ -106,12 +166,15 @@ QRectF OrthogonalRenderer::boundingRect(const MapObject *object) const
         }
     }
 
+    cacheBoundingRect(object, boundingRect);
     return boundingRect;
 }
 
 QPainterPath OrthogonalRenderer::shape(const MapObject *object) const
 {
     QPainterPath path;
+    if (cachedShape(object, path))
+        return path;
 
     if (!object->cell().isEmpty()) {
         path.addRect(boundingRect(object));
@@ -156,6 +219,7 @@ QPainterPath OrthogonalRenderer::shape(const MapObject *object) const
         }
     }
 
+    cacheShape(object, path);
     return path;
 }
 
@@ -196,10 +260,33 @@ void OrthogonalRenderer::drawGrid(QPainter *painter, const QRectF &rect,
     }
 }
 
+/**
+ * Returns the cells that may draw into the \a exposed area, which is in
+ * layer-local pixels, given the \a drawMargins that apply to them.
+ */
+static QRect exposedCells(QMargins drawMargins, const QRectF &exposed,
+                          int tileWidth, int tileHeight)
+{
+    drawMargins.setTop(drawMargins.top() - tileHeight);
+    drawMargins.setRight(drawMargins.right() - tileWidth);
+
+    const QRectF rect = exposed.adjusted(-drawMargins.right(),
+                                         -drawMargins.bottom(),
+                                         drawMargins.left(),
+                                         drawMargins.top());
+
+    return QRect(QPoint(qFloor(rect.x() / tileWidth),
+                        qFloor(rect.y() / tileHeight)),
+                 QPoint(qCeil(rect.right()) / tileWidth,
+                        qCeil(rect.bottom()) / tileHeight));
+}
+
 void OrthogonalRenderer::drawTileLayer(QPainter *painter,
                                        const TileLayer *layer,
                                        const QRectF &exposed) const
 {
+    TILED_TRACE_SCOPE_DETAIL("MapRenderer::drawTileLayer", layer->name());
+
     const QTransform savedTransform = painter->transform();
 
     const int tileWidth = map()->tileWidth();
@@ -209,72 +296,51 @@ void OrthogonalRenderer::drawTileLayer(QPainter *painter,
 
     painter->translate(layerPos);
 
-    int startX = 0;
-    int startY = 0;
-    int endX = layer->width() - 1;
-    int endY = layer->height() - 1;
+    // Empty borders of the layer are skipped
+    const QRect content = layer->contentBounds();
+    int startX = content.left();
+    int startY = content.top();
+    int endX = content.right();
+    int endY = content.bottom();
 
     if (!exposed.isNull()) {
-        QMargins drawMargins = layer->drawMargins();
-        drawMargins.setTop(drawMargins.top() - tileHeight);
-        drawMargins.setRight(drawMargins.right() - tileWidth);
-
-        QRectF rect = exposed.adjusted(-drawMargins.right(),
-                                       -drawMargins.bottom(),
-                                       drawMargins.left(),
-                                       drawMargins.top());
-
-        rect.translate(-layerPos);
-
-        startX = qMax(qFloor(rect.x() / tileWidth), 0);
-        startY = qMax(qFloor(rect.y() / tileHeight), 0);
-        endX = qMin(qCeil(rect.right()) / tileWidth, endX);
-        endY = qMin(qCeil(rect.bottom()) / tileHeight, endY);
+        // Cull using the margins of the whole layer first, and then again
+        // using only the margins of the chunks found in that area, so that a
+        // few large tiles elsewhere don't widen the area that is visited.
+        const QRectF rect = exposed.translated(-layerPos);
+        QRect cells = exposedCells(layer->drawMargins(), rect,
+                                   tileWidth, tileHeight);
+        cells &= exposedCells(layer->drawMargins(cells), rect,
+                              tileWidth, tileHeight);
+
+        startX = qMax(cells.left(), startX);
+        startY = qMax(cells.top(), startY);
+        endX = qMin(cells.right(), endX);
+        endY = qMin(cells.bottom(), endY);
     }
 
     // Return immediately when there is nothing to draw
-    if (startX > endX || startY > endY)
+    if (startX > endX || startY > endY) {
+        painter->setTransform(savedTransform);
         return;
+    }
 
     CellRenderer renderer(painter);
 
-    Map::RenderOrder renderOrder = map()->renderOrder();
-
-    int incX = 1, incY = 1;
-    switch (renderOrder) {
-    case Map::RightUp:
-        std::swap(startY, endY);
-        incY = -1;
-        break;
-    case Map::LeftDown:
-        std::swap(startX, endX);
-        incX = -1;
-        break;
-    case Map::LeftUp:
-        std::swap(startX, endX);
-        std::swap(startY, endY);
-        incX = -1;
-        incY = -1;
-        break;
-    case Map::RightDown:
-    default:
-        break;
-    }
+    const Map::RenderOrder renderOrder = map()->renderOrder();
+    const bool leftToRight = renderOrder == Map::RightDown ||
+            renderOrder == Map::RightUp;
+    const bool topToBottom = renderOrder == Map::RightDown ||
+            renderOrder == Map::LeftDown;
 
-    endX += incX;
-    endY += incY;
+    for (int row = startY; row <= endY; ++row) {
+        const int y = topToBottom ? row : startY + endY - row;
+        const qreal bottom = (y + 1) * tileHeight;
 
-    for (int y = startY; y != endY; y += incY) {
-        for (int x = startX; x != endX; x += incX) {
-            const Cell &cell = layer->cellAt(x, y);
-            if (cell.isEmpty())
-                continue;
-
-            renderer.render(cell,
-                            QPointF(x * tileWidth, (y + 1) * tileHeight),
-                            QSizeF(0, 0),
-                            CellRenderer::BottomLeft);
-        }
+        if (leftToRight)
+            drawCellRow<true>(renderer, layer, startX, endX, y, tileWidth, bottom);
+        else
+            drawCellRow<false>(renderer, layer, startX, endX, y, tileWidth, bottom);
     }
 
     renderer.flush();
@@ -447,3 +513,13 @@ QPointF OrthogonalRenderer::pixelToScreenCoords(qreal x, qreal y) const
 {
     return QPointF(x, y);
 }
+
+void OrthogonalRenderer::screenToPixelCoords(QPointF *, int) const
+{
+    // Screen and pixel coordinates are the same
+}
+
+void OrthogonalRenderer::pixelToScreenCoords(QPointF *, int) const
+{
+    // Screen and pixel coordinates are the same
+}
@@ -78,9 +78,11 @@ public:
     
     using MapRenderer::screenToPixelCoords;
     QPointF screenToPixelCoords(qreal x, qreal y) const;
+    void screenToPixelCoords(QPointF *points, int count) const;
 
     using MapRenderer::pixelToScreenCoords;
     QPointF pixelToScreenCoords(qreal x, qreal y) const;
+    void pixelToScreenCoords(QPointF *points, int count) const;
 };
 
 } // namespace Tiled
@@ -0,0 +1,101 @@
+/*
+ * packedcell.cpp
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "packedcell.h"
+
+#include "tile.h"
+#include "tileset.h"
+
+using namespace Tiled;
+
+CellPacker::CellPacker()
+{
+}
+
+CellPacker::CellPacker(const QList<Tileset *> &tilesets)
+{
+    foreach (Tileset *tileset, tilesets) {
+        mTilesetIndexes.insert(tileset, mTilesets.size());
+        mTilesets.append(tileset);
+    }
+}
+
+bool CellPacker::pack(const Cell &cell, PackedCell &packed)
+{
+    quint32 value = 0;
+
+    if (cell.flippedHorizontally)
+        value |= PackedCell::FlippedHorizontallyBit;
+    if (cell.flippedVertically)
+        value |= PackedCell::FlippedVerticallyBit;
+    if (cell.flippedAntiDiagonally)
+        value |= PackedCell::FlippedAntiDiagonallyBit;
+
+    if (const Tile *tile = cell.tile) {
+        if (tile->id() > PackedCell::MaxTileId)
+            return false;
+
+        Tileset *tileset = tile->tileset();
+        QHash<Tileset*, int>::const_iterator it = mTilesetIndexes.find(tileset);
+        int index;
+
+        if (it != mTilesetIndexes.end()) {
+            index = it.value();
+        } else {
+            index = mTilesets.size();
+            if (index > PackedCell::MaxTilesetIndex)
+                return false;
+
+            mTilesetIndexes.insert(tileset, index);
+            mTilesets.append(tileset);
+        }
+
+        // The index is stored off by one, since 0 is used for empty cells
+        value |= quint32(index + 1) << PackedCell::TileIdBits;
+        value |= quint32(tile->id());
+    }
+
+    packed.mValue = value;
+    return true;
+}
+
+Cell CellPacker::unpack(PackedCell cell) const
+{
+    Cell result(tileAt(cell));
+    result.flippedHorizontally = cell.flippedHorizontally();
+    result.flippedVertically = cell.flippedVertically();
+    result.flippedAntiDiagonally = cell.flippedAntiDiagonally();
+    return result;
+}
+
+Tile *CellPacker::tileAt(int tilesetIndex, int tileId) const
+{
+    if (tilesetIndex < 0 || tilesetIndex >= mTilesets.size())
+        return 0;
+    return mTilesets.at(tilesetIndex)->tileAt(tileId);
+}
@@ -0,0 +1,154 @@
+/*
+ * packedcell.h
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TILED_PACKEDCELL_H
+#define TILED_PACKEDCELL_H
+
+#include "tilelayer.h"
+
+#include <QHash>
+#include <QList>
+#include <QVector>
+
+namespace Tiled {
+
+/**
+ * A cell packed into a single 32-bit value. The three highest bits store
+ * the flip flags, followed by the index of the tileset and the local ID of
+ * the tile within that tileset.
+ *
+ * A packed cell refers to its tileset by index, so it can only be resolved
+ * using the CellPacker that created it.
+ */
+class PackedCell
+{
+public:
+    enum {
+        FlippedHorizontallyBit   = 0x80000000,
+        FlippedVerticallyBit     = 0x40000000,
+        FlippedAntiDiagonallyBit = 0x20000000,
+        FlipMask                 = 0xE0000000
+    };
+
+    enum {
+        TileIdBits = 19,
+        TileIdMask = (1 << TileIdBits) - 1,
+        TilesetBits = 10,
+        TilesetMask = ((1 << TilesetBits) - 1) << TileIdBits,
+        MaxTileId = TileIdMask,
+        MaxTilesetIndex = (1 << TilesetBits) - 2
+    };
+
+    PackedCell() : mValue(0) {}
+    explicit PackedCell(quint32 value) : mValue(value) {}
+
+    /**
+     * Returns the raw 32-bit value of this packed cell.
+     */
+    quint32 value() const { return mValue; }
+
+    bool isEmpty() const { return (mValue & TilesetMask) == 0; }
+
+    /**
+     * Returns the index of the tileset, or -1 for an empty cell.
+     */
+    int tilesetIndex() const
+    { return int((mValue & TilesetMask) >> TileIdBits) - 1; }
+
+    int tileId() const { return mValue & TileIdMask; }
+
+    bool flippedHorizontally() const { return mValue & FlippedHorizontallyBit; }
+    bool flippedVertically() const { return mValue & FlippedVerticallyBit; }
+    bool flippedAntiDiagonally() const { return mValue & FlippedAntiDiagonallyBit; }
+
+    bool operator == (PackedCell other) const { return mValue == other.mValue; }
+    bool operator != (PackedCell other) const { return mValue != other.mValue; }
+
+private:
+    friend class CellPacker;
+
+    quint32 mValue;
+};
+
+/**
+ * Converts cells to their packed 32-bit representation and back. The packer
+ * keeps a table of the tilesets encountered while packing, which is used to
+ * resolve the packed cells again.
+ */
+class TILEDSHARED_EXPORT CellPacker
+{
+public:
+    /**
+     * Default constructor. Tilesets are added as they are encountered.
+     */
+    CellPacker();
+
+    /**
+     * Constructor that initializes the tileset table with the given
+     * \a tilesets, usually Map::tilesets().
+     */
+    explicit CellPacker(const QList<Tileset*> &tilesets);
+
+    /**
+     * Returns the tilesets known to this packer, in the order of their index.
+     */
+    const QVector<Tileset*> &tilesets() const { return mTilesets; }
+
+    /**
+     * Packs the given \a cell into \a packed. Returns false when the cell
+     * can't be represented, because its tile ID or the number of tilesets
+     * is too large.
+     */
+    bool pack(const Cell &cell, PackedCell &packed);
+
+    /**
+     * Returns the tile referred to by the given packed \a cell, or 0 when it
+     * is empty.
+     */
+    Tile *tileAt(PackedCell cell) const
+    {
+        if (cell.isEmpty())
+            return 0;
+        return tileAt(cell.tilesetIndex(), cell.tileId());
+    }
+
+    /**
+     * Unpacks the given packed \a cell.
+     */
+    Cell unpack(PackedCell cell) const;
+
+private:
+    Tile *tileAt(int tilesetIndex, int tileId) const;
+
+    QVector<Tileset*> mTilesets;
+    QHash<Tileset*, int> mTilesetIndexes;
+};
+
+} // namespace Tiled
+
+#endif // TILED_PACKEDCELL_H
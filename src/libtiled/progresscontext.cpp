@@ -0,0 +1,85 @@
+/*
+ * progresscontext.cpp
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "progresscontext.h"
+
+#include <QMutexLocker>
+
+using namespace Tiled;
+
+ProgressContext::ProgressContext()
+    : mDone(0)
+    , mTotal(0)
+    , mCanceled(false)
+{
+}
+
+ProgressContext::~ProgressContext()
+{
+}
+
+void ProgressContext::setProgress(int done, int total)
+{
+    {
+        QMutexLocker locker(&mMutex);
+        mDone = done;
+        mTotal = total;
+    }
+
+    progressChanged(done, total);
+}
+
+int ProgressContext::done() const
+{
+    QMutexLocker locker(&mMutex);
+    return mDone;
+}
+
+int ProgressContext::total() const
+{
+    QMutexLocker locker(&mMutex);
+    return mTotal;
+}
+
+void ProgressContext::cancel()
+{
+    QMutexLocker locker(&mMutex);
+    mCanceled = true;
+}
+
+bool ProgressContext::isCanceled() const
+{
+    QMutexLocker locker(&mMutex);
+    return mCanceled;
+}
+
+void ProgressContext::progressChanged(int done, int total)
+{
+    Q_UNUSED(done)
+    Q_UNUSED(total)
+}
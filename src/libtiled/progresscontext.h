@@ -0,0 +1,104 @@
+/*
+ * progresscontext.h
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PROGRESSCONTEXT_H
+#define PROGRESSCONTEXT_H
+
+#include "tiled_global.h"
+
+#include <QMutex>
+
+namespace Tiled {
+
+/**
+ * Passed to map readers and writers, to report how far along a load or save
+ * is and to ask them to stop early. Readers and writers check isCanceled()
+ * regularly, for example after each layer, and fail with an error when it
+ * returns true.
+ *
+ * The progress is reported from the thread doing the work, while cancel()
+ * may be called from any thread.
+ */
+class TILEDSHARED_EXPORT ProgressContext
+{
+public:
+    ProgressContext();
+    virtual ~ProgressContext();
+
+    /**
+     * Reports that \a done out of \a total steps have been completed. What a
+     * step is depends on the reader or writer, for example a layer or a
+     * byte. A \a total of 0 means the number of steps is unknown.
+     */
+    void setProgress(int done, int total);
+
+    int done() const;
+    int total() const;
+
+    /**
+     * Asks the reader or writer using this context to stop.
+     */
+    void cancel();
+    bool isCanceled() const;
+
+protected:
+    /**
+     * Called by setProgress(), on the thread reporting the progress. Does
+     * nothing by default.
+     */
+    virtual void progressChanged(int done, int total);
+
+private:
+    Q_DISABLE_COPY(ProgressContext)
+
+    mutable QMutex mMutex;
+    int mDone;
+    int mTotal;
+    bool mCanceled;
+};
+
+/**
+ * Reports progress to \a context when it isn't 0.
+ */
+inline void reportProgress(ProgressContext *context, int done, int total)
+{
+    if (context)
+        context->setProgress(done, total);
+}
+
+/**
+ * Returns whether \a context is set and has been canceled.
+ */
+inline bool isCanceled(const ProgressContext *context)
+{
+    return context && context->isCanceled();
+}
+
+} // namespace Tiled
+
+#endif // PROGRESSCONTEXT_H
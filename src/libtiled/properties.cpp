@@ -28,8 +28,28 @@
 
 #include "properties.h"
 
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSet>
+
 using namespace Tiled;
 
+namespace {
+
+// Beyond this amount of names the names are unlikely to be shared much, so
+// new names are no longer added
+const int MaxInternedNames = 4096;
+
+struct InternedNames
+{
+    QMutex mutex;
+    QSet<QString> names;
+};
+
+} // anonymous namespace
+
+Q_GLOBAL_STATIC(InternedNames, internedNames)
+
 void Properties::merge(const Properties &other)
 {
     // Based on QMap::unite, but using insert instead of insertMulti
@@ -40,3 +60,18 @@ void Properties::merge(const Properties &other)
         insert(it.key(), it.value());
     }
 }
+
+QString Properties::internedName(const QString &name)
+{
+    InternedNames *data = internedNames();
+    QMutexLocker locker(&data->mutex);
+
+    QSet<QString>::const_iterator it = data->names.constFind(name);
+    if (it != data->names.constEnd())
+        return *it;
+
+    if (data->names.size() < MaxInternedNames)
+        data->names.insert(name);
+
+    return name;
+}
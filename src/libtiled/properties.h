@@ -40,6 +40,17 @@ class TILEDSHARED_EXPORT Properties : public QMap<QString,QString>
 {
 public:
     void merge(const Properties &other);
+
+    /**
+     * Returns a string equal to \a name that shares its data with all other
+     * property names interned this way. Since many objects tend to use the
+     * same few property names, readers should intern the names they read to
+     * avoid storing a copy of each name for every object. The same goes
+     * for object types.
+     *
+     * This function is thread-safe.
+     */
+    static QString internedName(const QString &name);
 };
 
 } // namespace Tiled
@@ -0,0 +1,161 @@
+/*
+ * randompicker.h
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TILED_RANDOMPICKER_H
+#define TILED_RANDOMPICKER_H
+
+#include <QVector>
+
+#include <cstdlib>
+
+namespace Tiled {
+
+/**
+ * Picks values at random, each with a chance proportional to the
+ * probability it was added with.
+ *
+ * Uses Walker's alias method, so that picking a value takes constant time
+ * regardless of the number of values. The tables this needs are built on the
+ * first pick after the values have changed.
+ */
+template<typename T>
+class RandomPicker
+{
+public:
+    RandomPicker()
+        : mSum(0.0)
+        , mDirty(false)
+    {}
+
+    /**
+     * Adds \a value with the given relative \a probability. Values with a
+     * probability that is not positive are never picked.
+     */
+    void add(const T &value, qreal probability = 1.0)
+    {
+        if (probability <= 0.0)
+            return;
+
+        mValues.append(value);
+        mProbabilities.append(probability);
+        mSum += probability;
+        mDirty = true;
+    }
+
+    bool isEmpty() const { return mValues.isEmpty(); }
+    int size() const { return mValues.size(); }
+
+    const QVector<T> &values() const { return mValues; }
+
+    void clear()
+    {
+        mValues.clear();
+        mProbabilities.clear();
+        mAliases.clear();
+        mSum = 0.0;
+        mDirty = false;
+    }
+
+    /**
+     * Returns a random value. May only be called when the picker is not
+     * empty.
+     */
+    const T &pick() const
+    {
+        Q_ASSERT(!isEmpty());
+
+        if (mDirty)
+            buildTables();
+
+        const int index = rand() % mValues.size();
+        const qreal random = qreal(rand()) / (qreal(RAND_MAX) + 1.0);
+
+        if (random < mThresholds.at(index))
+            return mValues.at(index);
+        return mValues.at(mAliases.at(index));
+    }
+
+private:
+    void buildTables() const
+    {
+        const int count = mValues.size();
+
+        mThresholds.resize(count);
+        mAliases.resize(count);
+
+        // Scale the probabilities so that they average to 1, and sort the
+        // values in those that are picked less and more often than average
+        QVector<int> small;
+        QVector<int> large;
+
+        for (int i = 0; i < count; ++i) {
+            mThresholds[i] = mProbabilities.at(i) * count / mSum;
+            mAliases[i] = i;
+
+            if (mThresholds.at(i) < 1.0)
+                small.append(i);
+            else
+                large.append(i);
+        }
+
+        // Fill up the slot of each less likely value with a more likely one
+        while (!small.isEmpty() && !large.isEmpty()) {
+            const int less = small.last();
+            small.pop_back();
+            const int more = large.last();
+
+            mAliases[less] = more;
+            mThresholds[more] -= 1.0 - mThresholds.at(less);
+
+            if (mThresholds.at(more) < 1.0) {
+                large.pop_back();
+                small.append(more);
+            }
+        }
+
+        // What remains is only off from 1 due to rounding errors
+        foreach (int i, small)
+            mThresholds[i] = 1.0;
+        foreach (int i, large)
+            mThresholds[i] = 1.0;
+
+        mDirty = false;
+    }
+
+    QVector<T> mValues;
+    QVector<qreal> mProbabilities;
+    qreal mSum;
+
+    mutable QVector<qreal> mThresholds;
+    mutable QVector<int> mAliases;
+    mutable bool mDirty;
+};
+
+} // namespace Tiled
+
+#endif // TILED_RANDOMPICKER_H
@@ -0,0 +1,140 @@
+/*
+ * regionbuilder.h
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TILED_REGIONBUILDER_H
+#define TILED_REGIONBUILDER_H
+
+#include <QRegion>
+#include <QVector>
+
+namespace Tiled {
+
+/**
+ * Builds a QRegion out of horizontal runs of cells, without the cost of
+ * uniting the region with every single run.
+ *
+ * The runs have to be added row by row, from top to bottom, and from left
+ * to right within each row. Runs within a row may not overlap or touch.
+ * Consecutive rows with identical runs are merged, so that the resulting
+ * rectangles are in the same form QRegion itself would produce.
+ */
+class RegionBuilder
+{
+public:
+    RegionBuilder()
+        : mBandStart(0)
+        , mRowStart(0)
+        , mRowY(0)
+    {}
+
+    /**
+     * Adds a run of \a width cells starting at (\a x, \a y).
+     */
+    void addRun(int x, int y, int width)
+    {
+        Q_ASSERT(width > 0);
+        addRect(QRect(x, y, width, 1));
+    }
+
+    /**
+     * Adds a \a rect that may span several rows. This allows copying a
+     * subset of the rectangles of another region. The rectangles that are
+     * added for the same top row need to have the same height.
+     */
+    void addRect(const QRect &rect)
+    {
+        Q_ASSERT(!rect.isEmpty());
+
+        if (mRects.size() > mRowStart && rect.top() != mRowY) {
+            Q_ASSERT(rect.top() > mRowY);
+            finishRow();
+        }
+
+        Q_ASSERT(mRects.size() == mRowStart ||
+                 mRects.last().bottom() == rect.bottom());
+
+        mRowY = rect.top();
+        mRects.append(rect);
+    }
+
+    /**
+     * Returns the region made up of the runs added so far.
+     */
+    QRegion region()
+    {
+        if (mRects.size() > mRowStart)
+            finishRow();
+
+        QRegion region;
+        region.setRects(mRects.constData(), mRects.size());
+        return region;
+    }
+
+private:
+    void finishRow();
+
+    QVector<QRect> mRects;
+    int mBandStart;     // index of the first rect of the previous band
+    int mRowStart;      // index of the first rect in the current row
+    int mRowY;          // top of the current row
+};
+
+/**
+ * Merges the current row into the previous band when it has the same runs
+ * and directly follows it, otherwise the current row starts a new band.
+ */
+inline void RegionBuilder::finishRow()
+{
+    const int rowSize = mRects.size() - mRowStart;
+    const int bandSize = mRowStart - mBandStart;
+
+    bool merge = bandSize == rowSize &&
+            mRects.at(mBandStart).bottom() == mRowY - 1;
+
+    for (int i = 0; merge && i < rowSize; ++i) {
+        const QRect &bandRect = mRects.at(mBandStart + i);
+        const QRect &rowRect = mRects.at(mRowStart + i);
+        merge = bandRect.left() == rowRect.left() &&
+                bandRect.right() == rowRect.right();
+    }
+
+    if (merge) {
+        const int bottom = mRects.last().bottom();
+        for (int i = mBandStart; i < mRowStart; ++i)
+            mRects[i].setBottom(bottom);
+        mRects.resize(mRowStart);
+    } else {
+        mBandStart = mRowStart;
+    }
+
+    mRowStart = mRects.size();
+}
+
+} // namespace Tiled
+
+#endif // TILED_REGIONBUILDER_H
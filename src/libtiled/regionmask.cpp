@@ -0,0 +1,362 @@
+/*
+ * regionmask.cpp
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "regionmask.h"
+
+#include "regionbuilder.h"
+
+#include <QVector>
+#include <QtAlgorithms>
+
+#include <cstring>
+
+using namespace Tiled;
+
+/**
+ * Returns the bits from \a first up to and including \a last.
+ */
+static inline quint32 bitRange(int first, int last)
+{
+    const quint32 upTo = last == 31 ? ~0u : (1u << (last + 1)) - 1;
+    return upTo & ~((1u << first) - 1);
+}
+
+RegionMask::Chunk::Chunk()
+{
+    std::memset(rows, 0, sizeof(rows));
+}
+
+bool RegionMask::Chunk::isEmpty() const
+{
+    for (int i = 0; i < ChunkSize; ++i)
+        if (rows[i])
+            return false;
+    return true;
+}
+
+RegionMask::RegionMask(const QRegion &region)
+{
+    add(region);
+}
+
+bool RegionMask::contains(int x, int y) const
+{
+    Chunks::const_iterator it = mChunks.constFind(chunkKey(x, y));
+    if (it == mChunks.constEnd())
+        return false;
+
+    return it.value().rows[y & ChunkMask] & (1u << (x & ChunkMask));
+}
+
+void RegionMask::add(const QRect &rect)
+{
+    if (rect.isEmpty())
+        return;
+
+    const ChunkKey first = chunkKey(rect.left(), rect.top());
+    const ChunkKey last = chunkKey(rect.right(), rect.bottom());
+
+    for (int cy = first.first; cy <= last.first; ++cy) {
+        const int top = qMax(rect.top(), cy * ChunkSize);
+        const int bottom = qMin(rect.bottom(), ((cy + 1) * ChunkSize) - 1);
+
+        for (int cx = first.second; cx <= last.second; ++cx) {
+            const int left = qMax(rect.left(), cx * ChunkSize);
+            const int right = qMin(rect.right(), ((cx + 1) * ChunkSize) - 1);
+            const quint32 bits = bitRange(left & ChunkMask, right & ChunkMask);
+
+            Chunk &chunk = mChunks[ChunkKey(cy, cx)];
+            for (int y = top; y <= bottom; ++y)
+                chunk.rows[y & ChunkMask] |= bits;
+        }
+    }
+}
+
+void RegionMask::add(const QRegion &region)
+{
+    foreach (const QRect &rect, region.rects())
+        add(rect);
+}
+
+void RegionMask::remove(const QRect &rect)
+{
+    if (rect.isEmpty())
+        return;
+
+    const ChunkKey first = chunkKey(rect.left(), rect.top());
+    const ChunkKey last = chunkKey(rect.right(), rect.bottom());
+
+    for (int cy = first.first; cy <= last.first; ++cy) {
+        const int top = qMax(rect.top(), cy * ChunkSize);
+        const int bottom = qMin(rect.bottom(), ((cy + 1) * ChunkSize) - 1);
+
+        for (int cx = first.second; cx <= last.second; ++cx) {
+            Chunks::iterator it = mChunks.find(ChunkKey(cy, cx));
+            if (it == mChunks.end())
+                continue;
+
+            const int left = qMax(rect.left(), cx * ChunkSize);
+            const int right = qMin(rect.right(), ((cx + 1) * ChunkSize) - 1);
+            const quint32 bits = bitRange(left & ChunkMask, right & ChunkMask);
+
+            Chunk &chunk = it.value();
+            for (int y = top; y <= bottom; ++y)
+                chunk.rows[y & ChunkMask] &= ~bits;
+
+            if (chunk.isEmpty())
+                mChunks.erase(it);
+        }
+    }
+}
+
+void RegionMask::remove(const QRegion &region)
+{
+    foreach (const QRect &rect, region.rects())
+        remove(rect);
+}
+
+RegionMask &RegionMask::operator|=(const RegionMask &other)
+{
+    Chunks::const_iterator it = other.mChunks.constBegin();
+    Chunks::const_iterator end = other.mChunks.constEnd();
+    for (; it != end; ++it) {
+        Chunk &chunk = mChunks[it.key()];
+        for (int i = 0; i < ChunkSize; ++i)
+            chunk.rows[i] |= it.value().rows[i];
+    }
+    return *this;
+}
+
+RegionMask &RegionMask::operator&=(const RegionMask &other)
+{
+    Chunks::iterator it = mChunks.begin();
+    while (it != mChunks.end()) {
+        Chunks::const_iterator otherIt = other.mChunks.constFind(it.key());
+        if (otherIt == other.mChunks.constEnd()) {
+            it = mChunks.erase(it);
+            continue;
+        }
+
+        Chunk &chunk = it.value();
+        for (int i = 0; i < ChunkSize; ++i)
+            chunk.rows[i] &= otherIt.value().rows[i];
+
+        if (chunk.isEmpty())
+            it = mChunks.erase(it);
+        else
+            ++it;
+    }
+    return *this;
+}
+
+RegionMask &RegionMask::operator-=(const RegionMask &other)
+{
+    Chunks::const_iterator it = other.mChunks.constBegin();
+    Chunks::const_iterator end = other.mChunks.constEnd();
+    for (; it != end; ++it) {
+        Chunks::iterator chunkIt = mChunks.find(it.key());
+        if (chunkIt == mChunks.end())
+            continue;
+
+        Chunk &chunk = chunkIt.value();
+        for (int i = 0; i < ChunkSize; ++i)
+            chunk.rows[i] &= ~it.value().rows[i];
+
+        if (chunk.isEmpty())
+            mChunks.erase(chunkIt);
+    }
+    return *this;
+}
+
+QRegion RegionMask::intersected(const QRegion &region) const
+{
+    RegionMask mask(region);
+    mask &= *this;
+    return mask.toRegion();
+}
+
+/**
+ * Unites \a rect with the cells that are set in \a bits, for a row of a chunk
+ * starting at (\a x, \a y).
+ */
+static void uniteRowBounds(QRect &rect, quint32 bits, int x, int y)
+{
+    int first = 0;
+    while (!(bits & (1u << first)))
+        ++first;
+
+    int last = 31;
+    while (!(bits & (1u << last)))
+        --last;
+
+    rect |= QRect(x + first, y, last - first + 1, 1);
+}
+
+QRect RegionMask::differenceBoundingRect(const RegionMask &other) const
+{
+    QRect bounds;
+
+    Chunks::const_iterator it = mChunks.constBegin();
+    Chunks::const_iterator end = mChunks.constEnd();
+    for (; it != end; ++it) {
+        Chunks::const_iterator otherIt = other.mChunks.constFind(it.key());
+        const bool inOther = otherIt != other.mChunks.constEnd();
+
+        for (int i = 0; i < ChunkSize; ++i) {
+            quint32 bits = it.value().rows[i];
+            if (inOther)
+                bits ^= otherIt.value().rows[i];
+            if (bits) {
+                uniteRowBounds(bounds, bits,
+                               it.key().second * ChunkSize,
+                               it.key().first * ChunkSize + i);
+            }
+        }
+    }
+
+    // The chunks that are only in the other mask
+    it = other.mChunks.constBegin();
+    end = other.mChunks.constEnd();
+    for (; it != end; ++it) {
+        if (mChunks.contains(it.key()))
+            continue;
+
+        for (int i = 0; i < ChunkSize; ++i) {
+            if (const quint32 bits = it.value().rows[i]) {
+                uniteRowBounds(bounds, bits,
+                               it.key().second * ChunkSize,
+                               it.key().first * ChunkSize + i);
+            }
+        }
+    }
+
+    return bounds;
+}
+
+QVector<QRect> RegionMask::differenceChunks(const RegionMask &other) const
+{
+    QVector<QRect> chunks;
+
+    Chunks::const_iterator it = mChunks.constBegin();
+    Chunks::const_iterator end = mChunks.constEnd();
+    for (; it != end; ++it) {
+        Chunks::const_iterator otherIt = other.mChunks.constFind(it.key());
+        if (otherIt != other.mChunks.constEnd() &&
+                std::memcmp(it.value().rows, otherIt.value().rows,
+                            sizeof(it.value().rows)) == 0)
+            continue;
+
+        chunks.append(QRect(it.key().second * ChunkSize,
+                            it.key().first * ChunkSize,
+                            ChunkSize, ChunkSize));
+    }
+
+    // The chunks that are only in the other mask
+    it = other.mChunks.constBegin();
+    end = other.mChunks.constEnd();
+    for (; it != end; ++it) {
+        if (mChunks.contains(it.key()))
+            continue;
+
+        chunks.append(QRect(it.key().second * ChunkSize,
+                            it.key().first * ChunkSize,
+                            ChunkSize, ChunkSize));
+    }
+
+    return chunks;
+}
+
+/**
+ * Builds the region row by row. Within a row, the runs of set bits are
+ * followed across the chunks next to each other.
+ */
+QRegion RegionMask::toRegion() const
+{
+    QList<ChunkKey> keys = mChunks.keys();
+    qSort(keys);
+
+    QVector<const Chunk*> chunks;
+    chunks.reserve(keys.size());
+    foreach (const ChunkKey &key, keys)
+        chunks.append(&mChunks.constFind(key).value());
+
+    RegionBuilder builder;
+
+    int bandStart = 0;
+    while (bandStart < keys.size()) {
+        const int chunkRow = keys.at(bandStart).first;
+
+        int bandEnd = bandStart + 1;
+        while (bandEnd < keys.size() && keys.at(bandEnd).first == chunkRow)
+            ++bandEnd;
+
+        for (int row = 0; row < ChunkSize; ++row) {
+            const int y = chunkRow * ChunkSize + row;
+            bool inRun = false;
+            int runStart = 0;
+            int runEnd = 0;
+
+            for (int k = bandStart; k < bandEnd; ++k) {
+                const quint32 bits = chunks.at(k)->rows[row];
+                if (!bits)
+                    continue;
+
+                const int chunkX = keys.at(k).second * ChunkSize;
+
+                int bit = 0;
+                while (bit < ChunkSize) {
+                    if (!(bits & (1u << bit))) {
+                        ++bit;
+                        continue;
+                    }
+
+                    const int start = bit;
+                    while (bit < ChunkSize && (bits & (1u << bit)))
+                        ++bit;
+
+                    if (inRun && chunkX + start == runEnd) {
+                        runEnd = chunkX + bit;
+                    } else {
+                        if (inRun)
+                            builder.addRun(runStart, y, runEnd - runStart);
+                        inRun = true;
+                        runStart = chunkX + start;
+                        runEnd = chunkX + bit;
+                    }
+                }
+            }
+
+            if (inRun)
+                builder.addRun(runStart, y, runEnd - runStart);
+        }
+
+        bandStart = bandEnd;
+    }
+
+    return builder.region();
+}
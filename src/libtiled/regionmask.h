@@ -0,0 +1,123 @@
+/*
+ * regionmask.h
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TILED_REGIONMASK_H
+#define TILED_REGIONMASK_H
+
+#include "tiled_global.h"
+
+#include <QHash>
+#include <QPair>
+#include <QPoint>
+#include <QRegion>
+#include <QVector>
+
+namespace Tiled {
+
+/**
+ * A set of cells stored as a bitmap, split up in chunks so that only the
+ * areas that contain cells take up memory.
+ *
+ * Unlike a QRegion, the cost of checking whether a cell is contained or of
+ * combining two masks doesn't depend on how fragmented the area is. This
+ * makes it suitable for large, noisy areas like magic wand selections.
+ * A mask can be converted to a QRegion where one is needed.
+ */
+class TILEDSHARED_EXPORT RegionMask
+{
+public:
+    RegionMask() {}
+    explicit RegionMask(const QRegion &region);
+
+    bool isEmpty() const { return mChunks.isEmpty(); }
+
+    bool contains(int x, int y) const;
+    bool contains(const QPoint &point) const
+    { return contains(point.x(), point.y()); }
+
+    void add(const QRect &rect);
+    void add(const QRegion &region);
+    void remove(const QRect &rect);
+    void remove(const QRegion &region);
+
+    RegionMask &operator|=(const RegionMask &other);
+    RegionMask &operator&=(const RegionMask &other);
+    RegionMask &operator-=(const RegionMask &other);
+
+    /**
+     * Returns the part of \a region that is contained in this mask.
+     */
+    QRegion intersected(const QRegion &region) const;
+
+    /**
+     * Returns the bounding rectangle of the cells that are contained in
+     * either this mask or the \a other mask, but not in both.
+     */
+    QRect differenceBoundingRect(const RegionMask &other) const;
+
+    /**
+     * Returns the areas of the chunks in which this mask and the \a other
+     * mask are different. The areas are aligned to chunkSize(). This allows
+     * data derived from a mask to be kept per chunk and updated in parts.
+     */
+    QVector<QRect> differenceChunks(const RegionMask &other) const;
+
+    static int chunkSize() { return ChunkSize; }
+
+    QRegion toRegion() const;
+
+private:
+    enum {
+        ChunkBits = 5,
+        ChunkSize = 1 << ChunkBits,
+        ChunkMask = ChunkSize - 1
+    };
+
+    /**
+     * A chunk stores one bit for each of its cells, one row per word.
+     */
+    struct Chunk
+    {
+        Chunk();
+        bool isEmpty() const;
+
+        quint32 rows[ChunkSize];
+    };
+
+    typedef QPair<int, int> ChunkKey;   // chunk row, chunk column
+    typedef QHash<ChunkKey, Chunk> Chunks;
+
+    static ChunkKey chunkKey(int x, int y)
+    { return ChunkKey(y >> ChunkBits, x >> ChunkBits); }
+
+    Chunks mChunks;
+};
+
+} // namespace Tiled
+
+#endif // TILED_REGIONMASK_H
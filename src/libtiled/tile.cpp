@@ -28,6 +28,7 @@
 
 #include "tile.h"
 
+#include "memoryusage.h"
 #include "objectgroup.h"
 #include "tileset.h"
 
@@ -38,6 +39,8 @@ Tile::Tile(const QPixmap &image, int id, Tileset *tileset):
     mId(id),
     mTileset(tileset),
     mImage(image),
+    mImageFromTileset(false),
+    mImageData(image.toImage()),
     mTerrain(-1),
     mTerrainProbability(1.f),
     mObjectGroup(0),
@@ -51,6 +54,8 @@ Tile::Tile(const QPixmap &image, const QString &imageSource,
     mId(id),
     mTileset(tileset),
     mImage(image),
+    mImageFromTileset(false),
+    mImageData(image.toImage()),
     mImageSource(imageSource),
     mTerrain(-1),
     mTerrainProbability(1.f),
@@ -64,17 +69,71 @@ Tile::~Tile()
     delete mObjectGroup;
 }
 
+const QPixmap &Tile::image() const
+{
+    if (mImageFromTileset) {
+        mImage = mTileset->image().copy(mTileset->imageRect(mId));
+        mImageFromTileset = false;
+    }
+    return mImage;
+}
+
+void Tile::setImage(const QPixmap &image)
+{
+    mImage = image;
+    mImageFromTileset = false;
+    mImageData = image.toImage();
+    mImageSize = QSize();
+}
+
+void Tile::setImageData(const QImage &image)
+{
+    mImage = QPixmap();
+    mImageFromTileset = false;
+    mImageData = image;
+    mImageSize = image.size();
+}
+
+QSize Tile::size() const
+{
+    if (mImageFromTileset)
+        return mTileset->tileSize();
+    if (mImage.isNull() && mImageSize.isValid())
+        return mImageSize;
+    return mImage.size();
+}
+
+/**
+ * Makes this tile refer to its area of the tileset image, without creating
+ * its own pixmap until image() is called.
+ */
+void Tile::setImageFromTileset()
+{
+    mImage = QPixmap();
+    mImageFromTileset = true;
+    mImageData = QImage();
+}
+
 /**
  * Returns the image for rendering this tile, taking into account tile
  * animations.
  */
 const QPixmap &Tile::currentFrameImage() const
+{
+    return currentFrameTile()->image();
+}
+
+/**
+ * Returns the tile displayed for the current frame of the animation, or this
+ * tile when it isn't animated.
+ */
+const Tile *Tile::currentFrameTile() const
 {
     if (isAnimated()) {
         const Frame &frame = mFrames.at(mCurrentFrameIndex);
-        return mTileset->tileAt(frame.tileId)->image();
+        return mTileset->tileAt(frame.tileId);
     } else {
-        return mImage;
+        return this;
     }
 }
 
@@ -92,6 +151,15 @@ void Tile::setTerrain(unsigned terrain)
     mTileset->markTerrainDistancesDirty();
 }
 
+void Tile::setTerrainProbability(float probability)
+{
+    if (mTerrainProbability == probability)
+        return;
+
+    mTerrainProbability = probability;
+    mTileset->markTerrainDistancesDirty();
+}
+
 /**
  * Sets \a objectGroup to be the group of objects associated with this tile.
  * The Tile takes ownership over the ObjectGroup and it can't also be part of
@@ -131,6 +199,19 @@ void Tile::setFrames(const QVector<Frame> &frames)
     mFrames = frames;
     mCurrentFrameIndex = 0;
     mUnusedTime = 0;
+    mTileset->updateAnimatedTile(this);
+}
+
+/**
+ * Returns the time in milliseconds since the animation of this tile last
+ * started over at its first frame.
+ */
+int Tile::animationTime() const
+{
+    int time = mUnusedTime;
+    for (int i = 0; i < mCurrentFrameIndex; ++i)
+        time += mFrames.at(i).duration;
+    return time;
 }
 
 /**
@@ -156,3 +237,17 @@ bool Tile::advanceAnimation(int ms)
 
     return previousTileId != frame.tileId;
 }
+
+qint64 Tile::memoryUsage() const
+{
+    qint64 usage = sizeof(Tile);
+    usage += stringMemoryUsage(mImageSource);
+    usage += propertiesMemoryUsage(properties());
+    usage += pixmapMemoryUsage(mImage);
+    usage += qint64(mFrames.capacity()) * sizeof(Frame);
+
+    if (mObjectGroup)
+        usage += mObjectGroup->memoryUsage();
+
+    return usage;
+}
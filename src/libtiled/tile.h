@@ -32,6 +32,7 @@
 
 #include "object.h"
 
+#include <QImage>
 #include <QPixmap>
 
 namespace Tiled {
@@ -79,16 +80,39 @@ public:
     Tileset *tileset() const { return mTileset; }
 
     /**
-     * Returns the image of this tile.
+     * Returns the image of this tile. For tiles that were cut from a tileset
+     * image, the pixmap is only created when it is first requested.
      */
-    const QPixmap &image() const { return mImage; }
+    const QPixmap &image() const;
 
     const QPixmap &currentFrameImage() const;
+    const Tile *currentFrameTile() const;
+
+    /**
+     * Returns the image of this tile as a QImage, which unlike the pixmap
+     * can be drawn outside of the GUI thread. Returns a null image for tiles
+     * that were cut from a tileset image, which are drawn from
+     * Tileset::imageData() instead.
+     */
+    const QImage &imageData() const { return mImageData; }
 
     /**
      * Sets the image of this tile.
      */
-    void setImage(const QPixmap &image) { mImage = image; }
+    void setImage(const QPixmap &image);
+
+    /**
+     * Sets only the image data of this tile, leaving its pixmap empty. Used
+     * when loading images outside of the GUI thread, where pixmaps can't be
+     * created.
+     */
+    void setImageData(const QImage &image);
+
+    /**
+     * Sets the size of this tile while it has no image, for when a map is
+     * read without loading its images. Reset by setImage().
+     */
+    void setImageSize(const QSize &size) { mImageSize = size; }
 
     /**
      * Returns the file name of the external image that represents this tile.
@@ -103,17 +127,17 @@ public:
     /**
      * Returns the width of this tile.
      */
-    int width() const { return mImage.width(); }
+    int width() const { return size().width(); }
 
     /**
      * Returns the height of this tile.
      */
-    int height() const { return mImage.height(); }
+    int height() const { return size().height(); }
 
     /**
      * Returns the size of this tile.
      */
-    QSize size() const { return mImage.size(); }
+    QSize size() const;
 
     /**
      * Returns the Terrain of a given corner.
@@ -149,7 +173,7 @@ public:
     /**
      * Set the probability of this terrain type appearing while painting (0-100%).
      */
-    void setTerrainProbability(float probability) { mTerrainProbability = probability; }
+    void setTerrainProbability(float probability);
 
     ObjectGroup *objectGroup() const;
     void setObjectGroup(ObjectGroup *objectGroup);
@@ -159,12 +183,23 @@ public:
     void setFrames(const QVector<Frame> &frames);
     bool isAnimated() const;
     int currentFrameIndex() const;
+    int animationTime() const;
     bool advanceAnimation(int ms);
 
+    /**
+     * Returns an estimate of the memory used by this tile, in bytes.
+     */
+    qint64 memoryUsage() const;
+
 private:
+    void setImageFromTileset();
+
     int mId;
     Tileset *mTileset;
-    QPixmap mImage;
+    mutable QPixmap mImage;
+    mutable bool mImageFromTileset;
+    QImage mImageData;
+    QSize mImageSize;
     QString mImageSource;
     unsigned mTerrain;
     float mTerrainProbability;
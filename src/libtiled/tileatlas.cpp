@@ -0,0 +1,184 @@
+/*
+ * tileatlas.cpp
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "tileatlas.h"
+
+#include "tile.h"
+
+#include <QPainter>
+#include <QtAlgorithms>
+
+using namespace Tiled;
+
+namespace {
+
+struct Shelf
+{
+    int y;
+    int height;
+    int width;      // The part that is used so far
+};
+
+struct Page
+{
+    QList<Shelf> shelves;
+    int height;     // The part that is taken by shelves
+    int width;      // The widest shelf
+};
+
+bool higherThan(const Tile *a, const Tile *b)
+{
+    if (a->height() != b->height())
+        return a->height() > b->height();
+    return a->width() > b->width();
+}
+
+int nextPowerOfTwo(int value)
+{
+    int power = 1;
+    while (power < value)
+        power *= 2;
+    return power;
+}
+
+} // anonymous namespace
+
+TileAtlas::TileAtlas(int maximumPageSize, int padding)
+    : mMaximumPageSize(maximumPageSize)
+    , mPadding(padding)
+{
+}
+
+void TileAtlas::addTile(const Tile *tile)
+{
+    if (tile->image().isNull() || mTiles.contains(tile))
+        return;
+
+    mTiles.append(tile);
+}
+
+bool TileAtlas::pack()
+{
+    mPlacements.clear();
+    mPageSizes.clear();
+
+    QList<const Tile*> tiles = mTiles;
+    qStableSort(tiles.begin(), tiles.end(), higherThan);
+
+    QList<Page> pages;
+
+    foreach (const Tile *tile, tiles) {
+        const int width = tile->width();
+        const int height = tile->height();
+
+        if (width > mMaximumPageSize || height > mMaximumPageSize) {
+            mPlacements.clear();
+            return false;
+        }
+
+        Placement placement;
+        placement.tile = tile;
+        placement.page = -1;
+
+        // Try the existing shelves first, and then starting a new shelf
+        for (int p = 0; p < pages.size() && placement.page == -1; ++p) {
+            Page &page = pages[p];
+
+            for (int s = 0; s < page.shelves.size(); ++s) {
+                Shelf &shelf = page.shelves[s];
+                if (shelf.height < height ||
+                        shelf.width + width > mMaximumPageSize)
+                    continue;
+
+                placement.page = p;
+                placement.rect = QRect(shelf.width, shelf.y, width, height);
+                shelf.width += width + mPadding;
+                break;
+            }
+
+            if (placement.page == -1 &&
+                    page.height + height <= mMaximumPageSize) {
+                Shelf shelf = { page.height, height, width + mPadding };
+                page.shelves.append(shelf);
+                page.height += height + mPadding;
+
+                placement.page = p;
+                placement.rect = QRect(0, shelf.y, width, height);
+            }
+
+            if (placement.page == p)
+                page.width = qMax(page.width, placement.rect.right() + 1);
+        }
+
+        if (placement.page == -1) {
+            Page page;
+            Shelf shelf = { 0, height, width + mPadding };
+            page.shelves.append(shelf);
+            page.height = height + mPadding;
+            page.width = width;
+            pages.append(page);
+
+            placement.page = pages.size() - 1;
+            placement.rect = QRect(0, 0, width, height);
+        }
+
+        mPlacements.append(placement);
+    }
+
+    foreach (const Page &page, pages) {
+        const int usedHeight = page.height - mPadding;
+        mPageSizes.append(QSize(nextPowerOfTwo(page.width),
+                                nextPowerOfTwo(usedHeight)));
+    }
+
+    // Keep the placements of each page together
+    QList<Placement> ordered;
+    for (int p = 0; p < pages.size(); ++p)
+        foreach (const Placement &placement, mPlacements)
+            if (placement.page == p)
+                ordered.append(placement);
+    mPlacements = ordered;
+
+    return true;
+}
+
+QImage TileAtlas::renderPage(int page) const
+{
+    QImage image(mPageSizes.at(page), QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+
+    QPainter painter(&image);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+
+    foreach (const Placement &placement, mPlacements)
+        if (placement.page == page)
+            painter.drawPixmap(placement.rect.topLeft(),
+                               placement.tile->image());
+
+    return image;
+}
@@ -0,0 +1,106 @@
+/*
+ * tileatlas.h
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TILED_TILEATLAS_H
+#define TILED_TILEATLAS_H
+
+#include "tiled_global.h"
+
+#include <QImage>
+#include <QList>
+#include <QRect>
+#include <QSize>
+
+namespace Tiled {
+
+class Tile;
+
+/**
+ * Packs the images of a set of tiles into as few atlas pages as possible,
+ * so that a game can draw them without switching textures. Mostly useful
+ * for image collection tilesets, where each tile has its own image.
+ *
+ * The pages have power-of-two sizes. The tiles are placed on shelves, from
+ * the highest to the lowest tile, which wastes little space when many tiles
+ * have similar heights.
+ */
+class TILEDSHARED_EXPORT TileAtlas
+{
+public:
+    /**
+     * The location of a tile within the atlas.
+     */
+    struct Placement
+    {
+        const Tile *tile;
+        int page;
+        QRect rect;
+    };
+
+    /**
+     * Constructor. The pages are at most \a maximumPageSize pixels wide and
+     * high, and \a padding pixels are left in between the tiles.
+     */
+    explicit TileAtlas(int maximumPageSize = 2048, int padding = 1);
+
+    /**
+     * Adds a tile to be packed. Tiles without an image and tiles that were
+     * already added are ignored.
+     */
+    void addTile(const Tile *tile);
+
+    /**
+     * Packs the added tiles. Returns false when a tile does not fit on a
+     * page, in which case nothing is packed.
+     */
+    bool pack();
+
+    int pageCount() const { return mPageSizes.size(); }
+    QSize pageSize(int page) const { return mPageSizes.at(page); }
+
+    /**
+     * Returns where each of the tiles was placed, ordered by page.
+     */
+    const QList<Placement> &placements() const { return mPlacements; }
+
+    /**
+     * Draws the tiles placed on the given \a page.
+     */
+    QImage renderPage(int page) const;
+
+private:
+    int mMaximumPageSize;
+    int mPadding;
+    QList<const Tile*> mTiles;
+    QList<Placement> mPlacements;
+    QList<QSize> mPageSizes;
+};
+
+} // namespace Tiled
+
+#endif // TILED_TILEATLAS_H
@@ -30,18 +30,309 @@
 #include "tilelayer.h"
 
 #include "map.h"
+#include "memoryusage.h"
 #include "tile.h"
 #include "tileset.h"
 
+#include <QAtomicInt>
+#include <QSet>
+#include <QtAlgorithms>
+
+#include <algorithm>
+
 using namespace Tiled;
 
+const Cell Chunk::mEmptyCell;
+
+// Constants and steps of the 64-bit xxHash algorithm
+static const quint64 HashPrime1 = Q_UINT64_C(11400714785074694791);
+static const quint64 HashPrime2 = Q_UINT64_C(14029467366897019727);
+static const quint64 HashPrime3 = Q_UINT64_C(1609587929392839161);
+static const quint64 HashPrime5 = Q_UINT64_C(2870177450012600261);
+
+static inline quint64 hashRound(quint64 acc, quint64 input)
+{
+    acc += input * HashPrime2;
+    acc = (acc << 31) | (acc >> 33);
+    return acc * HashPrime1;
+}
+
+static inline quint64 hashAvalanche(quint64 hash)
+{
+    hash ^= hash >> 33;
+    hash *= HashPrime2;
+    hash ^= hash >> 29;
+    hash *= HashPrime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+/**
+ * Packs a non-empty cell at \a index within its chunk into 64 bits. The
+ * address of the tile takes up the lower 48 bits.
+ */
+static inline quint64 packCellForHash(const Cell &cell, int index)
+{
+    const quint64 flags = (cell.flippedHorizontally ? 1 : 0) |
+                          (cell.flippedVertically ? 2 : 0) |
+                          (cell.flippedAntiDiagonally ? 4 : 0);
+
+    return quint64(quintptr(cell.tile)) ^
+            (quint64(index) << 48) ^
+            (flags << 56);
+}
+
+/**
+ * Returns the size at which the tile of \a cell is drawn.
+ */
+static QSize cellTileSize(const Cell &cell)
+{
+    if (!cell.tile)
+        return QSize(0, 0);
+
+    QSize size = cell.tile->size();
+    if (cell.flippedAntiDiagonally)
+        size.transpose();
+    return size;
+}
+
+void Chunk::setCell(int x, int y, const Cell &cell)
+{
+    Q_ASSERT(x >= 0 && y >= 0 && x < CHUNK_SIZE && y < CHUNK_SIZE);
+
+    if (!isAllocated()) {
+        if (cell.isEmpty())
+            return;
+
+        mGrid.resize(CHUNK_SIZE * CHUNK_SIZE);
+    }
+
+    mGrid[x + y * CHUNK_SIZE] = cell;
+    mHashValid = false;
+    expandMaxTileSize(cellTileSize(cell));
+}
+
+/**
+ * Only the non-empty cells are hashed, so that it doesn't matter whether
+ * the chunk is allocated.
+ */
+quint64 Chunk::contentHash() const
+{
+    if (mHashValid)
+        return mHash;
+
+    quint64 acc = HashPrime5;
+    for (int i = 0, i_end = mGrid.size(); i < i_end; ++i) {
+        const Cell &cell = mGrid.at(i);
+        if (!cell.isEmpty())
+            acc = hashRound(acc, packCellForHash(cell, i));
+    }
+
+    mHash = hashAvalanche(acc);
+    mHashValid = true;
+    return mHash;
+}
+
+void Chunk::copyCells(const Chunk &source, int sourceX, int sourceY,
+                      int x, int y, int count, bool skipEmpty)
+{
+    Q_ASSERT(count >= 0);
+    Q_ASSERT(sourceX >= 0 && sourceX + count <= CHUNK_SIZE);
+    Q_ASSERT(x >= 0 && x + count <= CHUNK_SIZE);
+
+    if (!source.isAllocated()) {
+        // Copying only empty cells
+        if (skipEmpty || !isAllocated())
+            return;
+
+        Cell *to = mGrid.data() + x + y * CHUNK_SIZE;
+        std::fill(to, to + count, Cell());
+        mHashValid = false;
+        return;
+    }
+
+    if (!isAllocated())
+        mGrid.resize(CHUNK_SIZE * CHUNK_SIZE);
+
+    mHashValid = false;
+
+    // Not all copied cells need to be the largest, but this avoids checking
+    expandMaxTileSize(source.mMaxTileSize);
+
+    const Cell *from = source.mGrid.constData() + sourceX + sourceY * CHUNK_SIZE;
+    Cell *to = mGrid.data() + x + y * CHUNK_SIZE;
+
+    if (skipEmpty) {
+        for (const Cell *end = from + count; from != end; ++from, ++to)
+            if (!from->isEmpty())
+                *to = *from;
+    } else {
+        std::copy(from, from + count, to);
+    }
+}
+
+bool Chunk::isEmpty() const
+{
+    for (int i = 0, i_end = mGrid.size(); i < i_end; ++i)
+        if (!mGrid.at(i).isEmpty())
+            return false;
+
+    return true;
+}
+
+
 TileLayer::TileLayer(const QString &name, int x, int y, int width, int height):
     Layer(TileLayerType, name, x, y, width, height),
     mMaxTileSize(0, 0),
-    mGrid(width * height)
+    mChunkOffsetX(0),
+    mChunkOffsetY(0),
+    mChunkColumns(0),
+    mChunkRows(0),
+    mRevision(0),
+    mTileIndexRevision(0),
+    mContentBoundsRevision(0),
+    mLoader(0)
 {
     Q_ASSERT(width >= 0);
     Q_ASSERT(height >= 0);
+
+    resetChunks(width, height);
+}
+
+TileLayer::~TileLayer()
+{
+    delete mLoader;
+}
+
+void TileLayer::setLoader(TileLayerLoader *loader)
+{
+    delete mLoader;
+    mLoader = loader;
+}
+
+/**
+ * Lets the loader set the cells. The loader is taken out of the layer
+ * first, since setting the cells goes through the functions that would
+ * otherwise load the layer again.
+ */
+void TileLayer::loadCells() const
+{
+    TileLayerLoader *loader = mLoader;
+    mLoader = 0;
+
+    loader->load(const_cast<TileLayer*>(this));
+    mRevision = 0;
+
+    delete loader;
+}
+
+static QAtomicInt nextRevision(1);
+
+unsigned TileLayer::revision() const
+{
+    // Revisions are handed out on demand, so that modifying cells only
+    // needs to reset the revision
+    while (mRevision == 0)
+        mRevision = unsigned(nextRevision.fetchAndAddRelaxed(1));
+
+    return mRevision;
+}
+
+/**
+ * Replaces the chunks with a set of unallocated chunks that covers an area
+ * of the given size.
+ *
+ * The chunk offset determines where the cell at (0, 0) is located within
+ * the first chunk. It allows the chunks of this layer to be aligned with
+ * those of another layer, so that they can be shared.
+ */
+void TileLayer::resetChunks(int width, int height, int offsetX, int offsetY)
+{
+    Q_ASSERT(offsetX >= 0 && offsetX < CHUNK_SIZE);
+    Q_ASSERT(offsetY >= 0 && offsetY < CHUNK_SIZE);
+
+    mChunkOffsetX = offsetX;
+    mChunkOffsetY = offsetY;
+    mChunkColumns = (width + offsetX + CHUNK_MASK) >> CHUNK_BITS;
+    mChunkRows = (height + offsetY + CHUNK_MASK) >> CHUNK_BITS;
+    mChunks = QVector<Chunk>(mChunkColumns * mChunkRows);
+    mUsedTilesets.clear();
+    mTransposedCells.clear();
+    mRevision = 0;
+}
+
+/**
+ * Sets the cell at the given local coordinates, keeping the tileset
+ * reference counts up to date but without adjusting the draw margins.
+ */
+void TileLayer::setChunkCell(int x, int y, const Cell &cell)
+{
+    // Checked before getting the chunk, since that resets the revision
+    const bool indexed = hasTileIndex();
+
+    Chunk &chunk = chunkAt(x, y);
+    const int localX = (x + mChunkOffsetX) & CHUNK_MASK;
+    const int localY = (y + mChunkOffsetY) & CHUNK_MASK;
+    Tile *oldTile = chunk.cellAt(localX, localY).tile;
+
+    countTileset(chunk.cellAt(localX, localY), -1);
+    countTileset(cell, 1);
+    chunk.setCell(localX, localY, cell);
+
+    // Keep the tile index up to date rather than having it rebuilt
+    if (indexed && oldTile != cell.tile) {
+        const int index = chunkIndex(x, y);
+        indexTile(oldTile, index, -1);
+        indexTile(cell.tile, index, 1);
+    }
+    if (indexed)
+        mTileIndexRevision = revision();
+}
+
+/**
+ * Adjusts the number of cells referring to the tileset of the given
+ * \a cell by \a delta.
+ */
+void TileLayer::countTileset(const Cell &cell, int delta)
+{
+    const Tile *tile = cell.tile;
+    if (!tile)
+        return;
+
+    Tileset *tileset = tile->tileset();
+    QHash<Tileset*, int>::iterator it = mUsedTilesets.find(tileset);
+    if (it == mUsedTilesets.end())
+        it = mUsedTilesets.insert(tileset, 0);
+
+    it.value() += delta;
+    Q_ASSERT(it.value() >= 0);
+
+    if (it.value() == 0)
+        mUsedTilesets.erase(it);
+
+    if (cell.flippedAntiDiagonally) {
+        int &transposed = mTransposedCells[tileset];
+        transposed += delta;
+        Q_ASSERT(transposed >= 0);
+
+        if (transposed == 0)
+            mTransposedCells.remove(tileset);
+    }
+}
+
+/**
+ * Adjusts the tileset reference counts by \a delta for every cell in the
+ * given \a chunk.
+ */
+void TileLayer::countTilesets(const Chunk &chunk, int delta)
+{
+    if (!chunk.isAllocated())
+        return;
+
+    for (QVector<Cell>::const_iterator it = chunk.begin(),
+         it_end = chunk.end(); it != it_end; ++it) {
+        countTileset(*it, delta);
+    }
 }
 
 static QSize maxSize(const QSize &a,
@@ -64,30 +355,40 @@ static QMargins maxMargins(const QMargins &a,
  * Recomputes the draw margins. Needed after the tile offset of a tileset
  * has changed for example.
  *
+ * The margins are derived from the maximum tile size and the tile offset of
+ * each used tileset, which are known from the tileset reference counts. This
+ * doesn't need to look at the cells.
+ *
  * Generally you want to call Map::recomputeDrawMargins instead.
  */
 void TileLayer::recomputeDrawMargins()
 {
+    load();
+
     QSize maxTileSize(0, 0);
     QMargins offsetMargins;
 
-    for (int i = 0, i_end = mGrid.size(); i < i_end; ++i) {
-        const Cell &cell = mGrid.at(i);
-        if (const Tile *tile = cell.tile) {
-            QSize size = tile->size();
-
-            if (cell.flippedAntiDiagonally)
-                size.transpose();
-
-            const QPoint offset = tile->tileset()->tileOffset();
+    QHash<Tileset*, int>::const_iterator it = mUsedTilesets.constBegin();
+    QHash<Tileset*, int>::const_iterator it_end = mUsedTilesets.constEnd();
+    for (; it != it_end; ++it) {
+        const Tileset *tileset = it.key();
+        const QSize size(tileset->tileWidth(), tileset->tileHeight());
+        const int transposed = mTransposedCells.value(it.key());
 
+        if (transposed < it.value())
             maxTileSize = maxSize(size, maxTileSize);
-            offsetMargins = maxMargins(QMargins(-offset.x(),
-                                                 -offset.y(),
-                                                 offset.x(),
-                                                 offset.y()),
-                                        offsetMargins);
+        if (transposed > 0) {
+            QSize transposedSize = size;
+            transposedSize.transpose();
+            maxTileSize = maxSize(transposedSize, maxTileSize);
         }
+
+        const QPoint offset = tileset->tileOffset();
+        offsetMargins = maxMargins(QMargins(-offset.x(),
+                                            -offset.y(),
+                                            offset.x(),
+                                            offset.y()),
+                                   offsetMargins);
     }
 
     mMaxTileSize = maxTileSize;
@@ -97,16 +398,42 @@ void TileLayer::recomputeDrawMargins()
         mMap->adjustDrawMargins(drawMargins());
 }
 
+/**
+ * Returns the draw margins of the cells within \a area, in local coordinates.
+ * Only the chunks overlapping the area are looked at, so unlike drawMargins()
+ * these are not widened by large tiles elsewhere in the layer.
+ */
+QMargins TileLayer::drawMargins(const QRect &area) const
+{
+    load();
+
+    const QRect bounded = area & QRect(0, 0, mWidth, mHeight);
+    if (bounded.isEmpty())
+        return mOffsetMargins;
+
+    const int firstChunkX = (bounded.left() + mChunkOffsetX) >> CHUNK_BITS;
+    const int firstChunkY = (bounded.top() + mChunkOffsetY) >> CHUNK_BITS;
+    const int lastChunkX = (bounded.right() + mChunkOffsetX) >> CHUNK_BITS;
+    const int lastChunkY = (bounded.bottom() + mChunkOffsetY) >> CHUNK_BITS;
+
+    QSize maxTileSize(0, 0);
+    for (int chunkY = firstChunkY; chunkY <= lastChunkY; ++chunkY)
+        for (int chunkX = firstChunkX; chunkX <= lastChunkX; ++chunkX)
+            maxTileSize = maxTileSize.expandedTo(
+                        mChunks.at(chunkX + chunkY * mChunkColumns).maxTileSize());
+
+    return QMargins(mOffsetMargins.left(),
+                    mOffsetMargins.top() + maxTileSize.height(),
+                    mOffsetMargins.right() + maxTileSize.width(),
+                    mOffsetMargins.bottom());
+}
+
 void TileLayer::setCell(int x, int y, const Cell &cell)
 {
     Q_ASSERT(contains(x, y));
 
     if (cell.tile) {
-        QSize size = cell.tile->size();
-
-        if (cell.flippedAntiDiagonally)
-            size.transpose();
-
+        const QSize size = cellTileSize(cell);
         const QPoint offset = cell.tile->tileset()->tileOffset();
 
         mMaxTileSize = maxSize(size, mMaxTileSize);
@@ -120,50 +447,271 @@ void TileLayer::setCell(int x, int y, const Cell &cell)
             mMap->adjustDrawMargins(drawMargins());
     }
 
-    mGrid[x + y * mWidth] = cell;
+    setChunkCell(x, y, cell);
+}
+
+/**
+ * Returns whether the given \a region fully contains \a rect.
+ */
+static bool regionContains(const QRegion &region, const QRect &rect)
+{
+    if (region.rectCount() == 1)
+        return region.boundingRect().contains(rect);
+
+    return QRegion(rect).subtracted(region).isEmpty();
+}
+
+/**
+ * Returns the rectangle covered by the given chunk, in local coordinates and
+ * clipped to the bounds of this layer.
+ */
+QRect TileLayer::emptyChunkAt(int x, int y) const
+{
+    Q_ASSERT(contains(x, y));
+
+    if (chunkAt(x, y).isAllocated())
+        return QRect();
+
+    return chunkRect((x + mChunkOffsetX) >> CHUNK_BITS,
+                     (y + mChunkOffsetY) >> CHUNK_BITS);
+}
+
+const Cell *TileLayer::cellRow(int x, int y, int *count) const
+{
+    Q_ASSERT(contains(x, y));
+
+    const int localX = (x + mChunkOffsetX) & CHUNK_MASK;
+    const int localY = (y + mChunkOffsetY) & CHUNK_MASK;
+    *count = qMin(CHUNK_SIZE - localX, mWidth - x);
+
+    const Chunk &chunk = chunkAt(x, y);
+    if (!chunk.isAllocated())
+        return 0;
+
+    return &chunk.cellAt(localX, localY);
+}
+
+QVector<QRect> TileLayer::chunkRects() const
+{
+    load();
+
+    QVector<QRect> rects;
+
+    for (int chunkY = 0; chunkY < mChunkRows; ++chunkY) {
+        for (int chunkX = 0; chunkX < mChunkColumns; ++chunkX) {
+            const Chunk &chunk = mChunks.at(chunkX + chunkY * mChunkColumns);
+            if (chunk.isAllocated() && !chunk.isEmpty())
+                rects.append(chunkRect(chunkX, chunkY));
+        }
+    }
+
+    return rects;
+}
+
+quint64 TileLayer::chunkHash(int x, int y) const
+{
+    Q_ASSERT(contains(x, y));
+    return chunkAt(x, y).contentHash();
+}
+
+quint64 TileLayer::contentHash() const
+{
+    load();
+
+    quint64 acc = hashRound(HashPrime5, (quint64(quint32(mWidth)) << 32) |
+                                        quint32(mHeight));
+    acc = hashRound(acc, (quint64(quint32(mChunkOffsetX)) << 32) |
+                         quint32(mChunkOffsetY));
+
+    foreach (const Chunk &chunk, mChunks)
+        acc = hashRound(acc, chunk.contentHash());
+
+    return hashAvalanche(acc);
+}
+
+int TileLayer::shareEqualChunks()
+{
+    load();
+
+    QHash<quint64, int> chunkWithHash;
+    int shared = 0;
+
+    for (int i = 0, i_end = mChunks.size(); i < i_end; ++i) {
+        const Chunk &chunk = mChunks.at(i);
+        if (!chunk.isAllocated())
+            continue;
+
+        const quint64 hash = chunk.contentHash();
+        QHash<quint64, int>::const_iterator it = chunkWithHash.constFind(hash);
+        if (it == chunkWithHash.constEnd()) {
+            chunkWithHash.insert(hash, i);
+            continue;
+        }
+
+        const Chunk &other = mChunks.at(it.value());
+        if (chunk.sharesCellsWith(other)) {
+            ++shared;
+            continue;
+        }
+
+        // The hash only tells which chunk to compare with
+        if (!std::equal(chunk.begin(), chunk.end(), other.begin()))
+            continue;
+
+        Chunk &target = mChunks[i];
+        const QSize maxTileSize = target.maxTileSize();
+        target = mChunks.at(it.value());
+        target.expandMaxTileSize(maxTileSize);
+        ++shared;
+    }
+
+    return shared;
+}
+
+QRect TileLayer::chunkRect(int chunkX, int chunkY) const
+{
+    const QRect rect((chunkX << CHUNK_BITS) - mChunkOffsetX,
+                     (chunkY << CHUNK_BITS) - mChunkOffsetY,
+                     CHUNK_SIZE, CHUNK_SIZE);
+
+    return rect & QRect(0, 0, mWidth, mHeight);
 }
 
 TileLayer *TileLayer::copy(const QRegion &region) const
 {
+    load();
+
     const QRegion area = region.intersected(QRect(0, 0, width(), height()));
     const QRect bounds = region.boundingRect();
     const QRect areaBounds = area.boundingRect();
     const int offsetX = qMax(0, areaBounds.x() - bounds.x());
     const int offsetY = qMax(0, areaBounds.y() - bounds.y());
 
+    // The translation from local coordinates to those of the copy
+    const int dx = areaBounds.x() - offsetX;
+    const int dy = areaBounds.y() - offsetY;
+
     TileLayer *copied = new TileLayer(QString(),
                                       0, 0,
                                       bounds.width(), bounds.height());
 
-    foreach (const QRect &rect, area.rects())
-        for (int x = rect.left(); x <= rect.right(); ++x)
-            for (int y = rect.top(); y <= rect.bottom(); ++y)
-                copied->setCell(x - areaBounds.x() + offsetX,
-                                y - areaBounds.y() + offsetY,
-                                cellAt(x, y));
+    if (area.isEmpty())
+        return copied;
+
+    // Align the chunks of the copy with ours, so that the chunks that are
+    // entirely within the copied area can be shared rather than copied.
+    copied->resetChunks(bounds.width(), bounds.height(),
+                        (mChunkOffsetX + dx) & CHUNK_MASK,
+                        (mChunkOffsetY + dy) & CHUNK_MASK);
+
+    const int chunkShiftX = (dx + mChunkOffsetX - copied->mChunkOffsetX) / CHUNK_SIZE;
+    const int chunkShiftY = (dy + mChunkOffsetY - copied->mChunkOffsetY) / CHUNK_SIZE;
+
+    const int firstChunkX = (areaBounds.left() + mChunkOffsetX) >> CHUNK_BITS;
+    const int firstChunkY = (areaBounds.top() + mChunkOffsetY) >> CHUNK_BITS;
+    const int lastChunkX = (areaBounds.right() + mChunkOffsetX) >> CHUNK_BITS;
+    const int lastChunkY = (areaBounds.bottom() + mChunkOffsetY) >> CHUNK_BITS;
+
+    for (int chunkY = firstChunkY; chunkY <= lastChunkY; ++chunkY) {
+        for (int chunkX = firstChunkX; chunkX <= lastChunkX; ++chunkX) {
+            const Chunk &chunk = mChunks.at(chunkX + chunkY * mChunkColumns);
+            if (!chunk.isAllocated())
+                continue;
+
+            const QRect rect = chunkRect(chunkX, chunkY);
 
+            if (regionContains(area, rect)) {
+                const int index = (chunkX - chunkShiftX) +
+                        (chunkY - chunkShiftY) * copied->mChunkColumns;
+                copied->mChunks[index] = chunk;
+                copied->countTilesets(chunk, 1);
+                continue;
+            }
+
+            foreach (const QRect &part, area.intersected(rect).rects())
+                for (int y = part.top(); y <= part.bottom(); ++y)
+                    copied->copyRow(this, part.left(), y,
+                                    part.left() - dx, y - dy,
+                                    part.width(), false);
+        }
+    }
+
+    copied->recomputeDrawMargins();
     return copied;
 }
 
+/**
+ * Copies a row of \a width cells from (\a sourceX, \a sourceY) in the
+ * \a source layer to (\a x, \a y) in this layer, one chunk span at a time.
+ * Both rows need to be within their respective layers.
+ *
+ * This does not adjust the draw margins.
+ */
+void TileLayer::copyRow(const TileLayer *source, int sourceX, int sourceY,
+                        int x, int y, int width, bool skipEmpty)
+{
+    Q_ASSERT(source->contains(sourceX, sourceY));
+    Q_ASSERT(source->contains(sourceX + width - 1, sourceY));
+    Q_ASSERT(contains(x, y));
+    Q_ASSERT(contains(x + width - 1, y));
+
+    const int localY = (y + mChunkOffsetY) & CHUNK_MASK;
+    const int sourceLocalY = (sourceY + source->mChunkOffsetY) & CHUNK_MASK;
+
+    while (width > 0) {
+        const int localX = (x + mChunkOffsetX) & CHUNK_MASK;
+        const int sourceLocalX = (sourceX + source->mChunkOffsetX) & CHUNK_MASK;
+        const int count = qMin(width, CHUNK_SIZE - qMax(localX, sourceLocalX));
+
+        Chunk &chunk = chunkAt(x, y);
+        const Chunk &sourceChunk = source->chunkAt(sourceX, sourceY);
+
+        for (int i = 0; i < count; ++i)
+            countTileset(chunk.cellAt(localX + i, localY), -1);
+
+        chunk.copyCells(sourceChunk,
+                        sourceLocalX, sourceLocalY,
+                        localX, localY,
+                        count, skipEmpty);
+
+        for (int i = 0; i < count; ++i)
+            countTileset(chunk.cellAt(localX + i, localY), 1);
+
+        x += count;
+        sourceX += count;
+        width -= count;
+    }
+}
+
 void TileLayer::merge(const QPoint &pos, const TileLayer *layer)
 {
+    load();
+    layer->load();
+
     // Determine the overlapping area
     QRect area = QRect(pos, QSize(layer->width(), layer->height()));
     area &= QRect(0, 0, width(), height());
 
-    for (int y = area.top(); y <= area.bottom(); ++y) {
-        for (int x = area.left(); x <= area.right(); ++x) {
-            const Cell &cell = layer->cellAt(x - area.left(),
-                                             y - area.top());
-            if (!cell.isEmpty())
-                setCell(x, y, cell);
-        }
-    }
+    if (area.isEmpty())
+        return;
+
+    for (int y = area.top(); y <= area.bottom(); ++y)
+        copyRow(layer, area.left() - pos.x(), y - pos.y(),
+                area.left(), y, area.width(), true);
+
+    mMaxTileSize = maxSize(layer->mMaxTileSize, mMaxTileSize);
+    mOffsetMargins = maxMargins(layer->mOffsetMargins, mOffsetMargins);
+
+    if (mMap)
+        mMap->adjustDrawMargins(drawMargins());
 }
 
 void TileLayer::setCells(int x, int y, TileLayer *layer,
                          const QRegion &mask)
 {
+    load();
+    layer->load();
+
     // Determine the overlapping area
     QRegion area = QRect(x, y, layer->width(), layer->height());
     area &= QRect(0, 0, width(), height());
@@ -171,196 +719,803 @@ void TileLayer::setCells(int x, int y, TileLayer *layer,
     if (!mask.isEmpty())
         area &= mask;
 
+    if (area.isEmpty())
+        return;
+
+    // When the chunks of both layers line up, chunks that are entirely
+    // covered by the area can be shared instead of copied cell by cell.
+    const int alignX = x + mChunkOffsetX - layer->mChunkOffsetX;
+    const int alignY = y + mChunkOffsetY - layer->mChunkOffsetY;
+
+    if ((alignX & CHUNK_MASK) == 0 && (alignY & CHUNK_MASK) == 0) {
+        const int chunkShiftX = alignX / CHUNK_SIZE;
+        const int chunkShiftY = alignY / CHUNK_SIZE;
+        const QRect layerRect(x, y, layer->width(), layer->height());
+        const QRect areaBounds = area.boundingRect();
+
+        const int firstChunkX = (areaBounds.left() + mChunkOffsetX) >> CHUNK_BITS;
+        const int firstChunkY = (areaBounds.top() + mChunkOffsetY) >> CHUNK_BITS;
+        const int lastChunkX = (areaBounds.right() + mChunkOffsetX) >> CHUNK_BITS;
+        const int lastChunkY = (areaBounds.bottom() + mChunkOffsetY) >> CHUNK_BITS;
+
+        QRegion shared;
+
+        for (int chunkY = firstChunkY; chunkY <= lastChunkY; ++chunkY) {
+            for (int chunkX = firstChunkX; chunkX <= lastChunkX; ++chunkX) {
+                const QRect square((chunkX << CHUNK_BITS) - mChunkOffsetX,
+                                   (chunkY << CHUNK_BITS) - mChunkOffsetY,
+                                   CHUNK_SIZE, CHUNK_SIZE);
+
+                // Both the part of the chunk within this layer and the part
+                // within the other layer need to be replaced entirely
+                const QRect rect = chunkRect(chunkX, chunkY);
+                if (!regionContains(area, rect) ||
+                        !regionContains(area, square & layerRect))
+                    continue;
+
+                const int sourceX = chunkX - chunkShiftX;
+                const int sourceY = chunkY - chunkShiftY;
+                const Chunk &source =
+                        layer->mChunks.at(sourceX + sourceY * layer->mChunkColumns);
+                Chunk &chunk = mChunks[chunkX + chunkY * mChunkColumns];
+
+                countTilesets(chunk, -1);
+                const QSize maxTileSize = chunk.maxTileSize();
+                chunk = source;
+                chunk.expandMaxTileSize(maxTileSize);
+                mRevision = 0;
+                countTilesets(chunk, 1);
+
+                shared += rect;
+            }
+        }
+
+        area -= shared;
+    }
+
     foreach (const QRect &rect, area.rects())
-        for (int _x = rect.left(); _x <= rect.right(); ++_x)
-            for (int _y = rect.top(); _y <= rect.bottom(); ++_y)
-                setCell(_x, _y, layer->cellAt(_x - x, _y - y));
+        for (int _y = rect.top(); _y <= rect.bottom(); ++_y)
+            copyRow(layer, rect.left() - x, _y - y,
+                    rect.left(), _y, rect.width(), false);
+
+    mMaxTileSize = maxSize(layer->mMaxTileSize, mMaxTileSize);
+    mOffsetMargins = maxMargins(layer->mOffsetMargins, mOffsetMargins);
+
+    if (mMap)
+        mMap->adjustDrawMargins(drawMargins());
 }
 
-void TileLayer::erase(const QRegion &area)
+void TileLayer::erase(const QRegion &region)
 {
+    load();
+
+    const QRegion area = region.intersected(QRect(0, 0, width(), height()));
+    if (area.isEmpty())
+        return;
+
+    const QRect areaBounds = area.boundingRect();
+    const int firstChunkX = (areaBounds.left() + mChunkOffsetX) >> CHUNK_BITS;
+    const int firstChunkY = (areaBounds.top() + mChunkOffsetY) >> CHUNK_BITS;
+    const int lastChunkX = (areaBounds.right() + mChunkOffsetX) >> CHUNK_BITS;
+    const int lastChunkY = (areaBounds.bottom() + mChunkOffsetY) >> CHUNK_BITS;
+
     const Cell emptyCell;
-    foreach (const QRect &rect, area.rects())
-        for (int x = rect.left(); x <= rect.right(); ++x)
-            for (int y = rect.top(); y <= rect.bottom(); ++y)
-                setCell(x, y, emptyCell);
+
+    for (int chunkY = firstChunkY; chunkY <= lastChunkY; ++chunkY) {
+        for (int chunkX = firstChunkX; chunkX <= lastChunkX; ++chunkX) {
+            Chunk &chunk = mChunks[chunkX + chunkY * mChunkColumns];
+            if (!chunk.isAllocated())
+                continue;
+
+            // Release chunks that are erased entirely
+            const QRect rect = chunkRect(chunkX, chunkY);
+            if (regionContains(area, rect)) {
+                countTilesets(chunk, -1);
+                chunk.clear();
+                mRevision = 0;
+                continue;
+            }
+
+            foreach (const QRect &part, area.intersected(rect).rects())
+                for (int y = part.top(); y <= part.bottom(); ++y)
+                    for (int x = part.left(); x <= part.right(); ++x)
+                        setChunkCell(x, y, emptyCell);
+        }
+    }
+}
+
+/**
+ * Returns the chunk offset that makes the chunks line up again after the
+ * cells along an axis of the given \a size have been mirrored.
+ */
+static int mirroredChunkOffset(int size, int offset)
+{
+    return -(size + offset) & CHUNK_MASK;
 }
 
 void TileLayer::flip(FlipDirection direction)
 {
-    QVector<Cell> newGrid(mWidth * mHeight);
+    load();
 
     Q_ASSERT(direction == FlipHorizontally || direction == FlipVertically);
 
-    for (int y = 0; y < mHeight; ++y) {
-        for (int x = 0; x < mWidth; ++x) {
-            Cell &dest = newGrid[x + y * mWidth];
+    const QVector<Chunk> oldChunks = mChunks;
+    const QHash<Tileset*, int> usedTilesets = mUsedTilesets;
+    const QHash<Tileset*, int> transposedCells = mTransposedCells;
+    const int columns = mChunkColumns;
+    const int rows = mChunkRows;
+
+    // Choose the new chunk offset such that each chunk maps onto exactly one
+    // chunk, which avoids any cache-unfriendly access across chunks
+    if (direction == FlipHorizontally)
+        resetChunks(mWidth, mHeight,
+                    mirroredChunkOffset(mWidth, mChunkOffsetX), mChunkOffsetY);
+    else
+        resetChunks(mWidth, mHeight,
+                    mChunkOffsetX, mirroredChunkOffset(mHeight, mChunkOffsetY));
+
+    Q_ASSERT(columns == mChunkColumns && rows == mChunkRows);
+    mUsedTilesets = usedTilesets;   // flipping doesn't change the cells
+    mTransposedCells = transposedCells;
+
+    for (int chunkY = 0; chunkY < rows; ++chunkY) {
+        for (int chunkX = 0; chunkX < columns; ++chunkX) {
+            const Chunk &source = oldChunks.at(chunkX + chunkY * columns);
+            if (!source.isAllocated())
+                continue;
+
             if (direction == FlipHorizontally) {
-                const Cell &source = cellAt(mWidth - x - 1, y);
-                dest = source;
-                dest.flippedHorizontally = !source.flippedHorizontally;
-            } else if (direction == FlipVertically) {
-                const Cell &source = cellAt(x, mHeight - y - 1);
-                dest = source;
-                dest.flippedVertically = !source.flippedVertically;
+                Chunk &dest = mChunks[(columns - chunkX - 1) + chunkY * columns];
+
+                for (int y = 0; y < CHUNK_SIZE; ++y) {
+                    for (int x = 0; x < CHUNK_SIZE; ++x) {
+                        Cell cell = source.cellAt(x, y);
+                        if (cell.isEmpty())
+                            continue;
+
+                        cell.flippedHorizontally = !cell.flippedHorizontally;
+                        dest.setCell(CHUNK_MASK - x, y, cell);
+                    }
+                }
+            } else {
+                Chunk &dest = mChunks[chunkX + (rows - chunkY - 1) * columns];
+
+                for (int y = 0; y < CHUNK_SIZE; ++y) {
+                    for (int x = 0; x < CHUNK_SIZE; ++x) {
+                        Cell cell = source.cellAt(x, y);
+                        if (cell.isEmpty())
+                            continue;
+
+                        cell.flippedVertically = !cell.flippedVertically;
+                        dest.setCell(x, CHUNK_MASK - y, cell);
+                    }
+                }
             }
         }
     }
-
-    mGrid = newGrid;
 }
 
 void TileLayer::rotate(RotateDirection direction)
 {
+    load();
+
     static const char rotateRightMask[8] = { 5, 4, 1, 0, 7, 6, 3, 2 };
     static const char rotateLeftMask[8]  = { 3, 2, 7, 6, 1, 0, 5, 4 };
 
     const char (&rotateMask)[8] =
             (direction == RotateRight) ? rotateRightMask : rotateLeftMask;
 
-    int newWidth = mHeight;
-    int newHeight = mWidth;
-    QVector<Cell> newGrid(newWidth * newHeight);
+    const int oldWidth = mWidth;
+    const int oldHeight = mHeight;
+    const int oldColumns = mChunkColumns;
+    const int oldRows = mChunkRows;
+    const QVector<Chunk> oldChunks = mChunks;
+    const QHash<Tileset*, int> usedTilesets = mUsedTilesets;
+    const QHash<Tileset*, int> transposedCells = mTransposedCells;
+
+    // Choose the new chunk offset such that each chunk is rotated onto
+    // exactly one chunk, so that the transpose happens block by block
+    mWidth = oldHeight;
+    mHeight = oldWidth;
+
+    if (direction == RotateRight)
+        resetChunks(mWidth, mHeight,
+                    mirroredChunkOffset(oldHeight, mChunkOffsetY), mChunkOffsetX);
+    else
+        resetChunks(mWidth, mHeight,
+                    mChunkOffsetY, mirroredChunkOffset(oldWidth, mChunkOffsetX));
+
+    Q_ASSERT(mChunkColumns == oldRows && mChunkRows == oldColumns);
+    mUsedTilesets = usedTilesets;   // rotating doesn't change the cells
+
+    // Rotating toggles the anti-diagonal flip of every cell
+    QHash<Tileset*, int>::const_iterator it = usedTilesets.constBegin();
+    for (; it != usedTilesets.constEnd(); ++it) {
+        const int transposed = it.value() - transposedCells.value(it.key());
+        if (transposed > 0)
+            mTransposedCells.insert(it.key(), transposed);
+    }
+
+    for (int chunkY = 0; chunkY < oldRows; ++chunkY) {
+        for (int chunkX = 0; chunkX < oldColumns; ++chunkX) {
+            const Chunk &source = oldChunks.at(chunkX + chunkY * oldColumns);
+            if (!source.isAllocated())
+                continue;
 
-    for (int y = 0; y < mHeight; ++y) {
-        for (int x = 0; x < mWidth; ++x) {
-            const Cell &source = cellAt(x, y);
-            Cell dest = source;
+            Chunk &destChunk = (direction == RotateRight)
+                    ? mChunks[(oldRows - chunkY - 1) + chunkX * mChunkColumns]
+                    : mChunks[chunkY + (oldColumns - chunkX - 1) * mChunkColumns];
 
-            unsigned char mask =
-                    (dest.flippedHorizontally << 2) |
-                    (dest.flippedVertically << 1) |
-                    (dest.flippedAntiDiagonally << 0);
+            for (int y = 0; y < CHUNK_SIZE; ++y) {
+                for (int x = 0; x < CHUNK_SIZE; ++x) {
+                    Cell dest = source.cellAt(x, y);
+                    if (dest.isEmpty())
+                        continue;
 
-            mask = rotateMask[mask];
+                    unsigned char mask =
+                            (dest.flippedHorizontally << 2) |
+                            (dest.flippedVertically << 1) |
+                            (dest.flippedAntiDiagonally << 0);
 
-            dest.flippedHorizontally = (mask & 4) != 0;
-            dest.flippedVertically = (mask & 2) != 0;
-            dest.flippedAntiDiagonally = (mask & 1) != 0;
+                    mask = rotateMask[mask];
 
-            if (direction == RotateRight)
-                newGrid[x * newWidth + (mHeight - y - 1)] = dest;
-            else
-                newGrid[(mWidth - x - 1) * newWidth + y] = dest;
+                    dest.flippedHorizontally = (mask & 4) != 0;
+                    dest.flippedVertically = (mask & 2) != 0;
+                    dest.flippedAntiDiagonally = (mask & 1) != 0;
+
+                    if (direction == RotateRight)
+                        destChunk.setCell(CHUNK_MASK - y, x, dest);
+                    else
+                        destChunk.setCell(y, CHUNK_MASK - x, dest);
+                }
+            }
         }
     }
 
     std::swap(mMaxTileSize.rwidth(),
               mMaxTileSize.rheight());
-
-    mWidth = newWidth;
-    mHeight = newHeight;
-    mGrid = newGrid;
 }
 
 
 QSet<Tileset*> TileLayer::usedTilesets() const
 {
+    load();
+
     QSet<Tileset*> tilesets;
+    tilesets.reserve(mUsedTilesets.size());
 
-    for (int i = 0, i_end = mGrid.size(); i < i_end; ++i)
-        if (const Tile *tile = mGrid.at(i).tile)
-            tilesets.insert(tile->tileset());
+    QHash<Tileset*, int>::const_iterator it = mUsedTilesets.begin();
+    QHash<Tileset*, int>::const_iterator it_end = mUsedTilesets.end();
+    for (; it != it_end; ++it)
+        tilesets.insert(it.key());
 
     return tilesets;
 }
 
-bool TileLayer::referencesTileset(const Tileset *tileset) const
+QHash<Tileset*, int> TileLayer::tilesetUsage() const
 {
-    for (int i = 0, i_end = mGrid.size(); i < i_end; ++i) {
-        const Tile *tile = mGrid.at(i).tile;
+    load();
+    return mUsedTilesets;
+}
+
+QHash<Tile*, int> TileLayer::tileUsage() const
+{
+    buildTileIndex();
+
+    QHash<Tile*, int> usage;
+    usage.reserve(mTileIndex.size());
+
+    QHash<Tile*, ChunkCounts>::const_iterator it = mTileIndex.begin();
+    QHash<Tile*, ChunkCounts>::const_iterator it_end = mTileIndex.end();
+    for (; it != it_end; ++it) {
+        int count = 0;
+        foreach (int chunkCount, it.value())
+            count += chunkCount;
+        usage.insert(it.key(), count);
+    }
+
+    return usage;
+}
+
+int TileLayer::usedCellCount() const
+{
+    load();
+
+    int count = 0;
+    foreach (int tilesetCount, mUsedTilesets)
+        count += tilesetCount;
+    return count;
+}
+
+/**
+ * Returns whether the tile index is up to date with the cells.
+ */
+bool TileLayer::hasTileIndex() const
+{
+    return mTileIndexRevision != 0 && mTileIndexRevision == mRevision;
+}
+
+void TileLayer::buildTileIndex() const
+{
+    load();
+
+    if (hasTileIndex())
+        return;
+
+    mTileIndex.clear();
+
+    for (int i = 0, i_end = mChunks.size(); i < i_end; ++i) {
+        const Chunk &chunk = mChunks.at(i);
+        if (!chunk.isAllocated())
+            continue;
+
+        for (QVector<Cell>::const_iterator it = chunk.begin(),
+             it_end = chunk.end(); it != it_end; ++it) {
+            if (it->tile)
+                ++mTileIndex[it->tile][i];
+        }
+    }
+
+    mTileIndexRevision = revision();
+}
+
+/**
+ * Adjusts the number of cells showing \a tile in the chunk at
+ * \a chunkIndex by \a delta.
+ */
+void TileLayer::indexTile(Tile *tile, int chunkIndex, int delta) const
+{
+    if (!tile)
+        return;
+
+    ChunkCounts &counts = mTileIndex[tile];
+    const int count = counts.value(chunkIndex) + delta;
+    Q_ASSERT(count >= 0);
+
+    if (count > 0) {
+        counts.insert(chunkIndex, count);
+    } else {
+        counts.remove(chunkIndex);
+        if (counts.isEmpty())
+            mTileIndex.remove(tile);
+    }
+}
+
+bool TileLayer::referencesAnyTile(const QList<Tile*> &tiles) const
+{
+    buildTileIndex();
+
+    foreach (Tile *tile, tiles)
+        if (mTileIndex.contains(tile))
+            return true;
+
+    return false;
+}
+
+QRegion TileLayer::tileRegion(const QList<Tile*> &tiles) const
+{
+    buildTileIndex();
+
+    QSet<int> chunkSet;
+    foreach (Tile *tile, tiles) {
+        QHash<Tile*, ChunkCounts>::const_iterator it = mTileIndex.find(tile);
+        if (it == mTileIndex.end())
+            continue;
+
+        ChunkCounts::const_iterator countIt = it.value().begin();
+        ChunkCounts::const_iterator countEnd = it.value().end();
+        for (; countIt != countEnd; ++countIt)
+            chunkSet.insert(countIt.key());
+    }
+
+    QList<int> chunkIndexes = chunkSet.toList();
+    qSort(chunkIndexes);
+
+    const QSet<Tile*> tileSet = tiles.toSet();
+    RegionBuilder builder;
+
+    // The chunks are handled a row of chunks at a time, so that the runs
+    // of cells can be added from top to bottom
+    int rowStart = 0;
+    while (rowStart < chunkIndexes.size()) {
+        const int chunkY = chunkIndexes.at(rowStart) / mChunkColumns;
+
+        int rowEnd = rowStart + 1;
+        while (rowEnd < chunkIndexes.size() &&
+               chunkIndexes.at(rowEnd) / mChunkColumns == chunkY)
+            ++rowEnd;
+
+        const int chunkStartY = (chunkY << CHUNK_BITS) - mChunkOffsetY;
+        const int startY = qMax(0, chunkStartY);
+        const int endY = qMin(chunkStartY + CHUNK_SIZE, mHeight);
+
+        for (int y = startY; y < endY; ++y) {
+            const int localY = y - chunkStartY;
+            int rangeStart = -1;
+            int rangeEnd = -1;
+
+            for (int c = rowStart; c < rowEnd; ++c) {
+                const int index = chunkIndexes.at(c);
+                const Chunk &chunk = mChunks.at(index);
+                const int chunkStartX = ((index % mChunkColumns) << CHUNK_BITS)
+                        - mChunkOffsetX;
+                const int startX = qMax(0, chunkStartX);
+                const int endX = qMin(chunkStartX + CHUNK_SIZE, mWidth);
+
+                for (int x = startX; x < endX; ++x) {
+                    if (!tileSet.contains(chunk.cellAt(x - chunkStartX, localY).tile))
+                        continue;
+
+                    if (rangeStart != -1 && x != rangeEnd) {
+                        builder.addRun(rangeStart + mX, y + mY,
+                                       rangeEnd - rangeStart);
+                        rangeStart = -1;
+                    }
+                    if (rangeStart == -1)
+                        rangeStart = x;
+                    rangeEnd = x + 1;
+                }
+            }
+
+            if (rangeStart != -1)
+                builder.addRun(rangeStart + mX, y + mY, rangeEnd - rangeStart);
+        }
+
+        rowStart = rowEnd;
+    }
+
+    return builder.region();
+}
+
+static bool chunkReferencesTileset(const Chunk &chunk, const Tileset *tileset)
+{
+    for (QVector<Cell>::const_iterator it = chunk.begin(),
+         it_end = chunk.end(); it != it_end; ++it) {
+        const Tile *tile = it->tile;
         if (tile && tile->tileset() == tileset)
             return true;
     }
     return false;
 }
 
+/**
+ * Returns whether the chunk at \a index may contain tiles from \a tileset.
+ * When the tile index is up to date, \a indexedChunks contains the chunks
+ * using the tileset according to that index.
+ */
+bool TileLayer::chunkMayReferenceTileset(int index, const Tileset *tileset,
+                                         const QSet<int> *indexedChunks) const
+{
+    if (indexedChunks)
+        return indexedChunks->contains(index);
+    return chunkReferencesTileset(mChunks.at(index), tileset);
+}
+
+/**
+ * Returns the chunks using tiles from \a tileset according to the tile
+ * index, which needs to be up to date.
+ */
+QSet<int> TileLayer::indexedChunks(const Tileset *tileset) const
+{
+    Q_ASSERT(hasTileIndex());
+
+    QSet<int> chunks;
+    QHash<Tile*, ChunkCounts>::const_iterator it = mTileIndex.begin();
+    QHash<Tile*, ChunkCounts>::const_iterator it_end = mTileIndex.end();
+    for (; it != it_end; ++it) {
+        if (it.key()->tileset() != tileset)
+            continue;
+
+        ChunkCounts::const_iterator countIt = it.value().begin();
+        ChunkCounts::const_iterator countEnd = it.value().end();
+        for (; countIt != countEnd; ++countIt)
+            chunks.insert(countIt.key());
+    }
+    return chunks;
+}
+
+bool TileLayer::referencesTileset(const Tileset *tileset) const
+{
+    load();
+    return mUsedTilesets.contains(const_cast<Tileset*>(tileset));
+}
+
 void TileLayer::removeReferencesToTileset(Tileset *tileset)
 {
-    for (int i = 0, i_end = mGrid.size(); i < i_end; ++i) {
-        const Tile *tile = mGrid.at(i).tile;
-        if (tile && tile->tileset() == tileset)
-            mGrid.replace(i, Cell());
+    if (!referencesTileset(tileset))
+        return;
+
+    // When the tile index is up to date, only the chunks it lists are used
+    QSet<int> chunks;
+    if (hasTileIndex())
+        chunks = indexedChunks(tileset);
+    const QSet<int> *indexed = hasTileIndex() ? &chunks : 0;
+
+    for (int i = 0, i_end = mChunks.size(); i < i_end; ++i) {
+        // Avoid detaching chunks that don't need to change
+        if (!chunkMayReferenceTileset(i, tileset, indexed))
+            continue;
+
+        Chunk &chunk = mChunks[i];
+        for (QVector<Cell>::iterator it = chunk.begin(),
+             it_end = chunk.end(); it != it_end; ++it) {
+            const Tile *tile = it->tile;
+            if (tile && tile->tileset() == tileset)
+                *it = Cell();
+        }
+
+        if (chunk.isEmpty())
+            chunk.clear();
     }
+
+    mUsedTilesets.remove(tileset);
+    mTransposedCells.remove(tileset);
+    mRevision = 0;
 }
 
 void TileLayer::replaceReferencesToTileset(Tileset *oldTileset,
                                            Tileset *newTileset)
 {
-    for (int i = 0, i_end = mGrid.size(); i < i_end; ++i) {
-        const Tile *tile = mGrid.at(i).tile;
-        if (tile && tile->tileset() == oldTileset)
-            mGrid[i].tile = newTileset->tileAt(tile->id());
+    if (oldTileset == newTileset || !referencesTileset(oldTileset))
+        return;
+
+    // When the tile index is up to date, only the chunks it lists are used
+    QSet<int> chunks;
+    if (hasTileIndex())
+        chunks = indexedChunks(oldTileset);
+    const QSet<int> *indexed = hasTileIndex() ? &chunks : 0;
+
+    for (int i = 0, i_end = mChunks.size(); i < i_end; ++i) {
+        // Avoid detaching chunks that don't need to change
+        if (!chunkMayReferenceTileset(i, oldTileset, indexed))
+            continue;
+
+        Chunk &chunk = mChunks[i];
+        for (QVector<Cell>::iterator it = chunk.begin(),
+             it_end = chunk.end(); it != it_end; ++it) {
+            const Tile *tile = it->tile;
+            if (tile && tile->tileset() == oldTileset) {
+                it->tile = newTileset->tileAt(tile->id());
+                countTileset(*it, 1);
+                chunk.expandMaxTileSize(cellTileSize(*it));
+            }
+        }
     }
+
+    mUsedTilesets.remove(oldTileset);
+    mTransposedCells.remove(oldTileset);
+    mRevision = 0;
 }
 
 void TileLayer::resize(const QSize &size, const QPoint &offset)
 {
+    load();
+
     if (this->size() == size && offset.isNull())
         return;
 
-    QVector<Cell> newGrid(size.width() * size.height());
+    const int oldWidth = mWidth;
+    const int oldHeight = mHeight;
+    const int oldColumns = mChunkColumns;
+    const int oldRows = mChunkRows;
+    const int oldOffsetX = mChunkOffsetX;
+    const int oldOffsetY = mChunkOffsetY;
+    const QVector<Chunk> oldChunks = mChunks;
+
+    // Align the new chunks with the old ones, so that the chunks that are
+    // preserved entirely can be shared instead of copied cell by cell
+    setSize(size);
+    resetChunks(mWidth, mHeight,
+                (oldOffsetX - offset.x()) & CHUNK_MASK,
+                (oldOffsetY - offset.y()) & CHUNK_MASK);
 
     // Copy over the preserved part
     const int startX = qMax(0, -offset.x());
     const int startY = qMax(0, -offset.y());
-    const int endX = qMin(mWidth, size.width() - offset.x());
-    const int endY = qMin(mHeight, size.height() - offset.y());
+    const int endX = qMin(oldWidth, size.width() - offset.x());
+    const int endY = qMin(oldHeight, size.height() - offset.y());
+
+    for (int chunkY = 0; chunkY < oldRows; ++chunkY) {
+        for (int chunkX = 0; chunkX < oldColumns; ++chunkX) {
+            const Chunk &chunk = oldChunks.at(chunkX + chunkY * oldColumns);
+            if (!chunk.isAllocated())
+                continue;
+
+            const int chunkStartX = (chunkX << CHUNK_BITS) - oldOffsetX;
+            const int chunkStartY = (chunkY << CHUNK_BITS) - oldOffsetY;
+
+            const int fromX = qMax(startX, chunkStartX);
+            const int fromY = qMax(startY, chunkStartY);
+            const int toX = qMin(endX, chunkStartX + CHUNK_SIZE);
+            const int toY = qMin(endY, chunkStartY + CHUNK_SIZE);
 
-    for (int y = startY; y < endY; ++y) {
-        for (int x = startX; x < endX; ++x) {
-            const int index = x + offset.x() + (y + offset.y()) * size.width();
-            newGrid[index] = cellAt(x, y);
+            if (fromX == chunkStartX && toX == chunkStartX + CHUNK_SIZE &&
+                    fromY == chunkStartY && toY == chunkStartY + CHUNK_SIZE) {
+                chunkAt(chunkStartX + offset.x(), chunkStartY + offset.y()) = chunk;
+                countTilesets(chunk, 1);
+                continue;
+            }
+
+            for (int y = fromY; y < toY; ++y) {
+                for (int x = fromX; x < toX; ++x) {
+                    const Cell &cell = chunk.cellAt(x - chunkStartX,
+                                                    y - chunkStartY);
+                    if (cell.isEmpty())
+                        continue;
+
+                    const int newX = x + offset.x();
+                    const int newY = y + offset.y();
+                    setChunkCell(newX, newY, cell);
+                }
+            }
         }
     }
+}
 
-    mGrid = newGrid;
-    setSize(size);
+namespace {
+
+/**
+ * A range of cells along one axis that is moved by the same amount when
+ * offsetting a layer.
+ */
+struct OffsetSpan
+{
+    OffsetSpan(int first, int last, int shift)
+        : first(first), last(last), shift(shift)
+    {}
+
+    int first;
+    int last;
+    int shift;
+};
+
+/**
+ * Returns the spans into which the range from \a start of the given
+ * \a size is split when offsetting it by \a offset. Without wrapping the
+ * whole range is moved, otherwise the part that wraps around is moved back
+ * by the size of the range.
+ */
+QVector<OffsetSpan> offsetSpans(int offset, int start, int size, bool wrap)
+{
+    QVector<OffsetSpan> spans;
+
+    if (!wrap || size <= 0) {
+        spans.append(OffsetSpan(start, start + size - 1, offset));
+        return spans;
+    }
+
+    const int shift = ((offset % size) + size) % size;
+    spans.append(OffsetSpan(start + shift, start + size - 1, shift));
+    if (shift > 0)
+        spans.append(OffsetSpan(start, start + shift - 1, shift - size));
+
+    return spans;
 }
 
+} // anonymous namespace
+
+/**
+ * The cells within \a bounds are moved a chunk span at a time. When a piece
+ * is moved by a multiple of the chunk size, the chunks it covers entirely are
+ * shared with the original rather than copied.
+ */
 void TileLayer::offset(const QPoint &offset,
                        const QRect &bounds,
                        bool wrapX, bool wrapY)
 {
-    QVector<Cell> newGrid(mWidth * mHeight);
+    load();
 
-    for (int y = 0; y < mHeight; ++y) {
-        for (int x = 0; x < mWidth; ++x) {
-            // Skip out of bounds tiles
-            if (!bounds.contains(x, y)) {
-                newGrid[x + y * mWidth] = cellAt(x, y);
-                continue;
-            }
+    const QRect area = bounds & QRect(0, 0, mWidth, mHeight);
+    if (area.isEmpty())
+        return;
 
-            // Get position to pull tile value from
-            int oldX = x - offset.x();
-            int oldY = y - offset.y();
+    // Keep the original cells around to read from, sharing the chunks
+    TileLayer source(QString(), 0, 0, mWidth, mHeight);
+    source.mChunks = mChunks;
+    source.mChunkColumns = mChunkColumns;
+    source.mChunkRows = mChunkRows;
+    source.mChunkOffsetX = mChunkOffsetX;
+    source.mChunkOffsetY = mChunkOffsetY;
+
+    clearArea(area);
+
+    const QVector<OffsetSpan> spansX = offsetSpans(offset.x(), bounds.x(),
+                                                   bounds.width(), wrapX);
+    const QVector<OffsetSpan> spansY = offsetSpans(offset.y(), bounds.y(),
+                                                   bounds.height(), wrapY);
+
+    foreach (const OffsetSpan &spanY, spansY) {
+        foreach (const OffsetSpan &spanX, spansX) {
+            const QPoint shift(spanX.shift, spanY.shift);
+            const QRect target = QRect(QPoint(spanX.first, spanY.first),
+                                       QPoint(spanX.last, spanY.last))
+                    & area & area.translated(shift);
+
+            if (!target.isEmpty())
+                moveArea(&source, target, shift);
+        }
+    }
+}
 
-            // Wrap x value that will be pulled from
-            if (wrapX && bounds.width() > 0) {
-                while (oldX < bounds.left())
-                    oldX += bounds.width();
-                while (oldX > bounds.right())
-                    oldX -= bounds.width();
+/**
+ * Clears the cells within \a area, dropping the chunks it entirely covers.
+ */
+void TileLayer::clearArea(const QRect &area)
+{
+    // Dropping chunks bypasses the tile index, so it is invalidated up front
+    mRevision = 0;
+
+    const int firstChunkX = (area.left() + mChunkOffsetX) >> CHUNK_BITS;
+    const int firstChunkY = (area.top() + mChunkOffsetY) >> CHUNK_BITS;
+    const int lastChunkX = (area.right() + mChunkOffsetX) >> CHUNK_BITS;
+    const int lastChunkY = (area.bottom() + mChunkOffsetY) >> CHUNK_BITS;
+
+    for (int chunkY = firstChunkY; chunkY <= lastChunkY; ++chunkY) {
+        for (int chunkX = firstChunkX; chunkX <= lastChunkX; ++chunkX) {
+            Chunk &chunk = mChunks[chunkX + chunkY * mChunkColumns];
+            if (!chunk.isAllocated())
+                continue;
+
+            const QRect rect = chunkRect(chunkX, chunkY);
+            if (area.contains(rect)) {
+                countTilesets(chunk, -1);
+                chunk.clear();
+                continue;
             }
 
-            // Wrap y value that will be pulled from
-            if (wrapY && bounds.height() > 0) {
-                while (oldY < bounds.top())
-                    oldY += bounds.height();
-                while (oldY > bounds.bottom())
-                    oldY -= bounds.height();
+            const QRect part = area & rect;
+            for (int y = part.top(); y <= part.bottom(); ++y)
+                for (int x = part.left(); x <= part.right(); ++x)
+                    if (!chunk.cellAt((x + mChunkOffsetX) & CHUNK_MASK,
+                                      (y + mChunkOffsetY) & CHUNK_MASK).isEmpty())
+                        setChunkCell(x, y, Cell());
+        }
+    }
+}
+
+/**
+ * Copies the non-empty cells of \a source that end up in \a target when
+ * moved by \a shift. The target area needs to be empty.
+ */
+void TileLayer::moveArea(const TileLayer *source, const QRect &target,
+                         const QPoint &shift)
+{
+    const bool aligned = !(shift.x() & CHUNK_MASK) && !(shift.y() & CHUNK_MASK);
+    const int chunkShiftX = shift.x() >> CHUNK_BITS;
+    const int chunkShiftY = shift.y() >> CHUNK_BITS;
+
+    const int firstChunkX = (target.left() + mChunkOffsetX) >> CHUNK_BITS;
+    const int firstChunkY = (target.top() + mChunkOffsetY) >> CHUNK_BITS;
+    const int lastChunkX = (target.right() + mChunkOffsetX) >> CHUNK_BITS;
+    const int lastChunkY = (target.bottom() + mChunkOffsetY) >> CHUNK_BITS;
+
+    for (int chunkY = firstChunkY; chunkY <= lastChunkY; ++chunkY) {
+        for (int chunkX = firstChunkX; chunkX <= lastChunkX; ++chunkX) {
+            const QRect rect = chunkRect(chunkX, chunkY);
+
+            // Chunks that are covered entirely only need to be moved
+            if (aligned && rect.width() == CHUNK_SIZE &&
+                    rect.height() == CHUNK_SIZE && target.contains(rect)) {
+                const Chunk &chunk = source->mChunks.at(
+                            (chunkX - chunkShiftX) +
+                            (chunkY - chunkShiftY) * source->mChunkColumns);
+                // Keep the maximum tile size of the cells being replaced
+                Chunk &dest = mChunks[chunkX + chunkY * mChunkColumns];
+                const QSize maxTileSize = dest.maxTileSize();
+                dest = chunk;
+                dest.expandMaxTileSize(maxTileSize);
+                countTilesets(chunk, 1);
+                continue;
             }
 
-            // Set the new tile
-            if (contains(oldX, oldY) && bounds.contains(oldX, oldY))
-                newGrid[x + y * mWidth] = cellAt(oldX, oldY);
-            else
-                newGrid[x + y * mWidth] = Cell();
+            const QRect part = target & rect;
+            for (int y = part.top(); y <= part.bottom(); ++y)
+                copyRow(source, part.left() - shift.x(), y - shift.y(),
+                        part.left(), y, part.width(), true);
         }
     }
 
-    mGrid = newGrid;
+    mRevision = 0;
 }
 
 bool TileLayer::canMergeWith(Layer *other) const
@@ -382,39 +1537,124 @@ Layer *TileLayer::mergedWith(Layer *other) const
     return merged;
 }
 
-QRegion TileLayer::computeDiffRegion(const TileLayer *other) const
+QRegion TileLayer::computeDiffRegion(const TileLayer *other,
+                                     bool compareHashes) const
 {
-    QRegion ret;
+    load();
+    other->load();
+
+    RegionBuilder builder;
 
     const int dx = other->x() - mX;
     const int dy = other->y() - mY;
     QRect r = QRect(0, 0, width(), height());
     r &= QRect(dx, dy, other->width(), other->height());
 
+    if (r.isEmpty())
+        return QRegion();
+
+    // When the chunks of both layers line up, shared chunks can be skipped
+    const int alignX = mChunkOffsetX + dx - other->mChunkOffsetX;
+    const int alignY = mChunkOffsetY + dy - other->mChunkOffsetY;
+    const bool aligned = (alignX & CHUNK_MASK) == 0 &&
+            (alignY & CHUNK_MASK) == 0;
+
     for (int y = r.top(); y <= r.bottom(); ++y) {
-        for (int x = r.left(); x <= r.right(); ++x) {
-            if (cellAt(x, y) != other->cellAt(x - dx, y - dy)) {
-                const int rangeStart = x;
-                while (x <= r.right() &&
-                       cellAt(x, y) != other->cellAt(x - dx, y - dy)) {
-                    ++x;
+        int rangeStart = -1;
+        int x = r.left();
+
+        while (x <= r.right()) {
+            const int nextChunkX =
+                    ((x + mChunkOffsetX) | CHUNK_MASK) + 1 - mChunkOffsetX;
+            const int chunkEnd = qMin(r.right() + 1, nextChunkX);
+
+            const Chunk &chunk = chunkAt(x, y);
+            const Chunk &otherChunk = other->chunkAt(x - dx, y - dy);
+
+            const bool equalChunks = aligned &&
+                    (chunk.sharesCellsWith(otherChunk) ||
+                     (compareHashes &&
+                      chunk.contentHash() == otherChunk.contentHash()));
+
+            if (equalChunks) {
+                if (rangeStart != -1) {
+                    builder.addRun(rangeStart, y, x - rangeStart);
+                    rangeStart = -1;
+                }
+                x = chunkEnd;
+                continue;
+            }
+
+            for (; x < chunkEnd; ++x) {
+                if (cellAt(x, y) != other->cellAt(x - dx, y - dy)) {
+                    if (rangeStart == -1)
+                        rangeStart = x;
+                } else if (rangeStart != -1) {
+                    builder.addRun(rangeStart, y, x - rangeStart);
+                    rangeStart = -1;
                 }
-                const int rangeEnd = x;
-                ret += QRect(rangeStart, y, rangeEnd - rangeStart, 1);
             }
         }
+
+        if (rangeStart != -1)
+            builder.addRun(rangeStart, y, r.right() + 1 - rangeStart);
     }
 
-    return ret;
+    return builder.region();
 }
 
 bool TileLayer::isEmpty() const
 {
-    for (int i = 0, i_end = mGrid.size(); i < i_end; ++i)
-        if (!mGrid.at(i).isEmpty())
-            return false;
+    load();
 
-    return true;
+    // Every non-empty cell is counted as a reference to its tileset
+    return mUsedTilesets.isEmpty();
+}
+
+QRect TileLayer::contentBounds() const
+{
+    load();
+
+    if (mContentBoundsRevision != 0 && mContentBoundsRevision == mRevision)
+        return mContentBounds;
+
+    QRect bounds;
+
+    if (!isEmpty()) {
+        for (int chunkY = 0; chunkY < mChunkRows; ++chunkY) {
+            for (int chunkX = 0; chunkX < mChunkColumns; ++chunkX) {
+                const Chunk &chunk = mChunks.at(chunkX + chunkY * mChunkColumns);
+                if (!chunk.isAllocated())
+                    continue;
+
+                // Chunks within the bounds found so far can't extend them
+                const QRect rect = chunkRect(chunkX, chunkY);
+                if (bounds.contains(rect))
+                    continue;
+
+                for (int y = rect.top(); y <= rect.bottom(); ++y) {
+                    const int localY = (y + mChunkOffsetY) & CHUNK_MASK;
+
+                    int first = rect.right() + 1;
+                    int last = rect.left() - 1;
+                    for (int x = rect.left(); x <= rect.right(); ++x) {
+                        if (!chunk.cellAt((x + mChunkOffsetX) & CHUNK_MASK,
+                                          localY).isEmpty()) {
+                            first = qMin(first, x);
+                            last = x;
+                        }
+                    }
+
+                    if (first <= last)
+                        bounds |= QRect(first, y, last - first + 1, 1);
+                }
+            }
+        }
+    }
+
+    mContentBounds = bounds;
+    mContentBoundsRevision = revision();
+    return bounds;
 }
 
 /**
@@ -427,11 +1667,57 @@ Layer *TileLayer::clone() const
     return initializeClone(new TileLayer(mName, mX, mY, mWidth, mHeight));
 }
 
+qint64 TileLayer::memoryUsage() const
+{
+    qint64 usage = sizeof(TileLayer);
+    usage += stringMemoryUsage(mName);
+    usage += propertiesMemoryUsage(properties());
+
+    // Not loading the cells just to find out how much memory they take
+    if (mLoader)
+        usage += mLoader->memoryUsage();
+
+    usage += qint64(mChunks.capacity()) * sizeof(Chunk);
+    usage += qint64(mUsedTilesets.size()) * ContainerNodeSize;
+    usage += qint64(mTransposedCells.size()) * ContainerNodeSize;
+
+    QSet<const Cell*> countedCells;
+    foreach (const Chunk &chunk, mChunks) {
+        if (chunk.isAllocated() && !countedCells.contains(&chunk.cellAt(0, 0))) {
+            countedCells.insert(&chunk.cellAt(0, 0));
+            usage += CHUNK_SIZE * CHUNK_SIZE * sizeof(Cell);
+        }
+    }
+
+    foreach (const ChunkCounts &counts, mTileIndex)
+        usage += qint64(1 + counts.size()) * ContainerNodeSize;
+
+    return usage;
+}
+
 TileLayer *TileLayer::initializeClone(TileLayer *clone) const
 {
     Layer::initializeClone(clone);
-    clone->mGrid = mGrid;
+
+    // Cloning doesn't need to load the cells
+    if (mLoader) {
+        clone->setLoader(mLoader->clone());
+        return clone;
+    }
+
+    clone->mChunkOffsetX = mChunkOffsetX;
+    clone->mChunkOffsetY = mChunkOffsetY;
+    clone->mChunkColumns = mChunkColumns;
+    clone->mChunkRows = mChunkRows;
+    clone->mChunks = mChunks;
+    clone->mUsedTilesets = mUsedTilesets;
+    clone->mTransposedCells = mTransposedCells;
     clone->mMaxTileSize = mMaxTileSize;
     clone->mOffsetMargins = mOffsetMargins;
+    clone->mRevision = mRevision;   // the clone has the same cells
+    clone->mTileIndex = mTileIndex;
+    clone->mTileIndexRevision = mTileIndexRevision;
+    clone->mContentBounds = mContentBounds;
+    clone->mContentBoundsRevision = mContentBoundsRevision;
     return clone;
 }
@@ -33,15 +33,21 @@
 #include "tiled_global.h"
 
 #include "layer.h"
+#include "map.h"
+#include "regionbuilder.h"
 #include "tiled.h"
 
+#include <QHash>
 #include <QMargins>
+#include <QSize>
 #include <QString>
 #include <QVector>
 
 namespace Tiled {
 
+class GidMapper;
 class Tile;
+class TileLayer;
 class Tileset;
 
 /**
@@ -88,10 +94,147 @@ public:
     bool flippedAntiDiagonally;
 };
 
+static const int CHUNK_BITS = 4;
+static const int CHUNK_SIZE = 1 << CHUNK_BITS;
+static const int CHUNK_MASK = CHUNK_SIZE - 1;
+
+/**
+ * A square block of CHUNK_SIZE x CHUNK_SIZE cells. Tile layers store their
+ * cells in chunks, so that empty areas of a layer take up no memory.
+ *
+ * The storage for the cells of a chunk is only allocated once a non-empty
+ * cell is set on it. Chunks are implicitly shared, so copying a chunk is
+ * cheap and its cells are only copied when either copy is modified.
+ */
+class TILEDSHARED_EXPORT Chunk
+{
+public:
+    Chunk() : mMaxTileSize(0, 0), mHash(0), mHashValid(false) {}
+
+    /**
+     * Returns whether storage has been allocated for the cells of this
+     * chunk. An unallocated chunk only contains empty cells.
+     */
+    bool isAllocated() const { return !mGrid.isEmpty(); }
+
+    /**
+     * Returns the cell at the given chunk-local coordinates.
+     */
+    const Cell &cellAt(int x, int y) const
+    {
+        Q_ASSERT(x >= 0 && y >= 0 && x < CHUNK_SIZE && y < CHUNK_SIZE);
+        return isAllocated() ? mGrid.at(x + y * CHUNK_SIZE) : mEmptyCell;
+    }
+
+    void setCell(int x, int y, const Cell &cell);
+
+    /**
+     * Returns a 64-bit hash of the cells of this chunk. Chunks with the same
+     * cells have the same hash, also when one of them is not allocated. The
+     * hash is computed when first needed and kept until a cell is changed.
+     *
+     * Tiles are hashed by their address, so the hash can be used as a key
+     * within a session but should not be stored.
+     */
+    quint64 contentHash() const;
+
+    /**
+     * Copies a row of \a count cells starting at (\a sourceX, \a sourceY)
+     * in the \a source chunk to this chunk, starting at (\a x, \a y). When
+     * \a skipEmpty is true, empty cells in the source are not copied.
+     */
+    void copyCells(const Chunk &source, int sourceX, int sourceY,
+                   int x, int y, int count, bool skipEmpty);
+
+    /**
+     * Returns true if all cells in this chunk are empty.
+     */
+    bool isEmpty() const;
+
+    /**
+     * Returns whether this chunk shares its cells with the \a other chunk,
+     * in which case the two are known to be equal without comparing them.
+     */
+    bool sharesCellsWith(const Chunk &other) const
+    { return mGrid.constData() == other.mGrid.constData(); }
+
+    /**
+     * Releases the storage of this chunk, making all its cells empty. The
+     * maximum tile size is kept, see maxTileSize().
+     */
+    void clear() { mGrid.clear(); mHashValid = false; }
+
+    /**
+     * Returns the size of the largest tile set on this chunk, transposed for
+     * cells flipped anti-diagonally. It only grows, also when cells are
+     * cleared, so that the area covered by removed tiles is still known when
+     * repainting.
+     */
+    QSize maxTileSize() const { return mMaxTileSize; }
+
+    /**
+     * Grows the maximum tile size of this chunk to include \a size.
+     */
+    void expandMaxTileSize(const QSize &size)
+    { mMaxTileSize = mMaxTileSize.expandedTo(size); }
+
+    // The cells may be changed through the iterators
+    QVector<Cell>::iterator begin()
+    { mHashValid = false; return mGrid.begin(); }
+    QVector<Cell>::iterator end()
+    { mHashValid = false; return mGrid.end(); }
+    QVector<Cell>::const_iterator begin() const { return mGrid.begin(); }
+    QVector<Cell>::const_iterator end() const { return mGrid.end(); }
+
+    static const Cell mEmptyCell;
+
+private:
+    QVector<Cell> mGrid;
+    QSize mMaxTileSize;
+    mutable quint64 mHash;
+    mutable bool mHashValid;
+};
+
+/**
+ * Provides the cells of a tile layer that are only decoded once they are
+ * needed. See TileLayer::setLoader().
+ */
+class TILEDSHARED_EXPORT TileLayerLoader
+{
+public:
+    virtual ~TileLayerLoader() {}
+
+    /**
+     * Sets the cells of the given \a tileLayer.
+     */
+    virtual void load(TileLayer *tileLayer) = 0;
+
+    /**
+     * Returns a loader providing the same cells, for a clone of the layer.
+     */
+    virtual TileLayerLoader *clone() const = 0;
+
+    /**
+     * Returns the data of the layer in the given \a format, as it would be
+     * written using the given \a gidMapper, when it can be provided without
+     * decoding the cells. Returns a null string otherwise.
+     */
+    virtual QString encodedData(Map::LayerDataFormat format,
+                                const GidMapper &gidMapper) const = 0;
+
+    /**
+     * Returns an estimate of the memory used by this loader, in bytes.
+     */
+    virtual qint64 memoryUsage() const = 0;
+};
+
 /**
  * A tile layer is a grid of cells. Each cell refers to a specific tile, and
  * stores how the tile is flipped.
  *
+ * The cells are stored in chunks of CHUNK_SIZE x CHUNK_SIZE, which are only
+ * allocated when a tile is placed in them.
+ *
  * Coordinates and regions passed to function parameters are in local
  * coordinates and do not take into account the position of the layer.
  */
@@ -103,6 +246,38 @@ public:
      */
     TileLayer(const QString &name, int x, int y, int width, int height);
 
+    /**
+     * Destructor.
+     */
+    ~TileLayer();
+
+    /**
+     * Makes the \a loader provide the cells of this layer the first time
+     * they are accessed, which also happens when the layer is changed. The
+     * layer takes ownership of the loader. Clones of the layer get their
+     * own loader until they are loaded.
+     *
+     * Loading is not thread-safe, so a layer should be loaded before its
+     * cells are accessed from multiple threads.
+     */
+    void setLoader(TileLayerLoader *loader);
+
+    /**
+     * Returns the loader that will provide the cells of this layer, or 0
+     * when the cells have already been loaded.
+     */
+    TileLayerLoader *loader() const { return mLoader; }
+
+    /**
+     * Returns whether the cells of this layer have been loaded.
+     */
+    bool isLoaded() const { return !mLoader; }
+
+    /**
+     * Loads the cells of this layer when they are provided by a loader.
+     */
+    void load() const { if (mLoader) loadCells(); }
+
     /**
      * Returns the maximum tile size of this layer.
      */
@@ -121,6 +296,8 @@ public:
                         mOffsetMargins.bottom());
     }
 
+    QMargins drawMargins(const QRect &area) const;
+
     void recomputeDrawMargins();
 
     /**
@@ -153,6 +330,58 @@ public:
 
     const Cell &cellAt(const QPoint &point) const;
 
+    /**
+     * Returns the area of the chunk containing the cell at the given
+     * coordinates when no tiles have been placed in that chunk, or a null
+     * rect otherwise. Renderers use this to skip over the empty parts of
+     * sparse layers without looking at each of their cells.
+     */
+    QRect emptyChunkAt(int x, int y) const;
+
+    /**
+     * Returns the cells of row \a y starting at column \a x, up to the end of
+     * the chunk containing them or of the layer. Their number is stored in
+     * \a count. Returns 0 when no tiles have been placed in that part of the
+     * row. Renderers use this to iterate over the cells of a row directly.
+     */
+    const Cell *cellRow(int x, int y, int *count) const;
+
+    /**
+     * Returns the areas of the chunks in which tiles have been placed, row
+     * by row. Chunks along the edges are clipped to the layer.
+     */
+    QVector<QRect> chunkRects() const;
+
+    /**
+     * Returns the hash of the cells of the chunk containing the cell at the
+     * given coordinates, see Chunk::contentHash(). Can be used to find out
+     * cheaply whether the cells of a chunk changed, or to key data derived
+     * from them.
+     */
+    quint64 chunkHash(int x, int y) const;
+
+    /**
+     * Returns a hash of all cells of this layer, combined from the hashes of
+     * its chunks. Only the chunks that changed since the last call are
+     * hashed again.
+     *
+     * The hash depends on how the cells are divided into chunks, so it is
+     * meant for recognizing changes to a layer and its copies rather than
+     * for comparing unrelated layers.
+     */
+    quint64 contentHash() const;
+
+    /**
+     * Makes chunks with equal cells share them, so that content repeated
+     * across the layer, for example a stamp placed many times at the same
+     * alignment, is only stored once per chunk. Chunks are found by their
+     * content hash and compared before they are shared. Changing a shared
+     * chunk later on copies its cells again.
+     *
+     * Returns the number of chunks that share the cells of an earlier chunk.
+     */
+    int shareEqualChunks();
+
     /**
      * Sets the cell at the given coordinates.
      */
@@ -161,6 +390,8 @@ public:
     /**
      * Returns a copy of the area specified by the given \a region. The
      * caller is responsible for the returned tile layer.
+     *
+     * Chunks that are entirely within the region are shared with the copy.
      */
     TileLayer *copy(const QRegion &region) const;
 
@@ -204,10 +435,31 @@ public:
     void rotate(RotateDirection direction);
 
     /**
-     * Computes and returns the set of tilesets used by this tile layer.
+     * Returns the set of tilesets used by this tile layer. The tile layer
+     * keeps track of the number of cells referring to each tileset, so this
+     * doesn't need to look at the cells.
      */
     QSet<Tileset*> usedTilesets() const;
 
+    /**
+     * Returns the number of cells referring to each of the tilesets used by
+     * this tile layer. Like usedTilesets(), this comes from the reference
+     * counts and doesn't need to look at the cells.
+     */
+    QHash<Tileset*, int> tilesetUsage() const;
+
+    /**
+     * Returns the number of cells showing each of the tiles used by this
+     * tile layer. This sums up the tile index (see referencesAnyTile()), so
+     * after the index has been built only the used tiles are looked at.
+     */
+    QHash<Tile*, int> tileUsage() const;
+
+    /**
+     * Returns the number of non-empty cells in this tile layer.
+     */
+    int usedCellCount() const;
+
     /**
      * Returns whether this tile layer has any cell for which the given
      * \a condition returns true.
@@ -220,6 +472,22 @@ public:
      */
     bool referencesTileset(const Tileset *tileset) const;
 
+    /**
+     * Returns whether any of the cells of this layer shows one of the given
+     * \a tiles.
+     *
+     * This and tileRegion() use an index of the chunks in which each tile is
+     * used, which is built the first time either is called. The index is
+     * kept up to date by setCell() and is rebuilt after other changes.
+     */
+    bool referencesAnyTile(const QList<Tile*> &tiles) const;
+
+    /**
+     * Returns the region of cells showing any of the given \a tiles. Only
+     * the chunks in which these tiles are used are looked at.
+     */
+    QRegion tileRegion(const QList<Tile*> &tiles) const;
+
     /**
      * Removes all references to the given tileset. This sets all tiles on this
      * layer that are from the given tileset to null.
@@ -233,7 +501,8 @@ public:
 
     /**
      * Resizes this tile layer to \a size, while shifting all tiles by
-     * \a offset.
+     * \a offset. The chunks that are preserved entirely are shared rather
+     * than copied, so growing a large layer is cheap.
      */
     void resize(const QSize &size, const QPoint &offset);
 
@@ -254,56 +523,185 @@ public:
      * Returns the region where this tile layer and the given tile layer
      * are different. The relative positions of the layers are taken into
      * account. The returned region is relative to this tile layer.
+     *
+     * Chunks that line up are skipped when they share their cells. When
+     * \a compareHashes is true, they are also skipped when their content
+     * hashes are equal, see Chunk::contentHash(). This makes comparing
+     * layers that were loaded separately much faster, at the cost of a tiny
+     * chance of missing a change to a chunk with the same hash.
      */
-    QRegion computeDiffRegion(const TileLayer *other) const;
+    QRegion computeDiffRegion(const TileLayer *other,
+                              bool compareHashes = false) const;
 
     /**
      * Returns true if all tiles in the layer are empty.
      */
     bool isEmpty() const;
 
+    /**
+     * Returns the bounding rect of the non-empty cells, in local coordinates.
+     * An empty rect is returned when the layer is empty. The bounds are
+     * cached until the cells change.
+     */
+    QRect contentBounds() const;
+
+    /**
+     * Returns a number identifying the current cells of this layer. A new
+     * revision is assigned after the cells have changed, and clones share
+     * the revision of their original until either of them is changed. This
+     * allows data derived from the cells to be cached.
+     */
+    unsigned revision() const;
+
     virtual Layer *clone() const;
 
+    /**
+     * Returns an estimate of the memory used by this layer, in bytes. Chunks
+     * shared with clones of this layer are counted as well, while chunks
+     * shared within the layer are counted once.
+     */
+    qint64 memoryUsage() const;
+
 protected:
     TileLayer *initializeClone(TileLayer *clone) const;
 
 private:
+    int chunkIndex(int x, int y) const
+    {
+        return ((x + mChunkOffsetX) >> CHUNK_BITS) +
+                ((y + mChunkOffsetY) >> CHUNK_BITS) * mChunkColumns;
+    }
+
+    const Chunk &chunkAt(int x, int y) const
+    { load(); return mChunks.at(chunkIndex(x, y)); }
+
+    Chunk &chunkAt(int x, int y)
+    { load(); mRevision = 0; return mChunks[chunkIndex(x, y)]; }
+
+    void loadCells() const;
+
+    void copyRow(const TileLayer *source, int sourceX, int sourceY,
+                 int x, int y, int width, bool skipEmpty);
+    void clearArea(const QRect &area);
+    void moveArea(const TileLayer *source, const QRect &target,
+                  const QPoint &shift);
+
+    void setChunkCell(int x, int y, const Cell &cell);
+
+    void countTileset(const Cell &cell, int delta);
+    void countTilesets(const Chunk &chunk, int delta);
+
+    bool hasTileIndex() const;
+    void buildTileIndex() const;
+    void indexTile(Tile *tile, int chunkIndex, int delta) const;
+    QSet<int> indexedChunks(const Tileset *tileset) const;
+    bool chunkMayReferenceTileset(int index, const Tileset *tileset,
+                                  const QSet<int> *indexedChunks) const;
+
+    void resetChunks(int width, int height, int offsetX = 0, int offsetY = 0);
+    QRect chunkRect(int chunkX, int chunkY) const;
+
     QSize mMaxTileSize;
     QMargins mOffsetMargins;
-    QVector<Cell> mGrid;
+    int mChunkOffsetX;
+    int mChunkOffsetY;
+    int mChunkColumns;
+    int mChunkRows;
+    QVector<Chunk> mChunks;
+    QHash<Tileset*, int> mUsedTilesets;    // number of cells per tileset
+    QHash<Tileset*, int> mTransposedCells; // of those, flipped anti-diagonally
+    mutable unsigned mRevision;             // 0 when not yet assigned
+
+    // For each tile, the number of cells showing it per chunk index. Only
+    // valid while its revision matches the revision of this layer.
+    typedef QHash<int, int> ChunkCounts;
+    mutable QHash<Tile*, ChunkCounts> mTileIndex;
+    mutable unsigned mTileIndexRevision;    // 0 when not built
+    mutable QRect mContentBounds;
+    mutable unsigned mContentBoundsRevision; // 0 when not computed
+    mutable TileLayerLoader *mLoader;
 };
 
 
 template<typename Condition>
 QRegion TileLayer::region(Condition condition) const
 {
-    QRegion region;
+    load();
+
+    RegionBuilder builder;
+
+    // Unallocated chunks only contain empty cells
+    const bool emptyMatches = condition(Chunk::mEmptyCell);
 
     for (int y = 0; y < mHeight; ++y) {
-        for (int x = 0; x < mWidth; ++x) {
-            if (condition(cellAt(x, y))) {
-                const int rangeStart = x;
-                for (++x; x <= mWidth; ++x) {
-                    if (x == mWidth || !condition(cellAt(x, y))) {
-                        const int rangeEnd = x;
-                        region += QRect(rangeStart + mX, y + mY,
-                                        rangeEnd - rangeStart, 1);
-                        break;
-                    }
+        const int localY = (y + mChunkOffsetY) & CHUNK_MASK;
+        const Chunk *chunkRow = mChunks.constData() +
+                ((y + mChunkOffsetY) >> CHUNK_BITS) * mChunkColumns;
+        int rangeStart = -1;
+
+        for (int chunkX = 0; chunkX < mChunkColumns; ++chunkX) {
+            const Chunk &chunk = chunkRow[chunkX];
+            const int chunkStartX = (chunkX << CHUNK_BITS) - mChunkOffsetX;
+            const int startX = qMax(0, chunkStartX);
+            const int endX = qMin(chunkStartX + CHUNK_SIZE, mWidth);
+
+            if (!chunk.isAllocated()) {
+                if (emptyMatches) {
+                    if (rangeStart == -1)
+                        rangeStart = startX;
+                } else if (rangeStart != -1) {
+                    builder.addRun(rangeStart + mX, y + mY,
+                                   startX - rangeStart);
+                    rangeStart = -1;
+                }
+                continue;
+            }
+
+            for (int x = startX; x < endX; ++x) {
+                if (condition(chunk.cellAt(x - chunkStartX, localY))) {
+                    if (rangeStart == -1)
+                        rangeStart = x;
+                } else if (rangeStart != -1) {
+                    builder.addRun(rangeStart + mX, y + mY,
+                                   x - rangeStart);
+                    rangeStart = -1;
                 }
             }
         }
+
+        if (rangeStart != -1)
+            builder.addRun(rangeStart + mX, y + mY, mWidth - rangeStart);
     }
 
-    return region;
+    return builder.region();
 }
 
 template<typename Condition>
 bool TileLayer::hasCell(Condition condition) const
 {
-    for (int i = 0, i_end = mGrid.size(); i < i_end; ++i)
-        if (condition(mGrid.at(i)))
-            return true;
+    load();
+
+    // When empty cells match, the chunks can't simply be skipped
+    if (condition(Chunk::mEmptyCell)) {
+        for (int y = 0; y < mHeight; ++y)
+            for (int x = 0; x < mWidth; ++x)
+                if (condition(cellAt(x, y)))
+                    return true;
+
+        return false;
+    }
+
+    for (int i = 0, i_end = mChunks.size(); i < i_end; ++i) {
+        const Chunk &chunk = mChunks.at(i);
+        if (!chunk.isAllocated())
+            continue;
+
+        for (QVector<Cell>::const_iterator it = chunk.begin(),
+             it_end = chunk.end(); it != it_end; ++it) {
+            if (condition(*it))
+                return true;
+        }
+    }
 
     return false;
 }
@@ -319,7 +717,8 @@ inline QRegion TileLayer::region() const
 inline const Cell &TileLayer::cellAt(int x, int y) const
 {
     Q_ASSERT(contains(x, y));
-    return mGrid.at(x + y * mWidth);
+    return chunkAt(x, y).cellAt((x + mChunkOffsetX) & CHUNK_MASK,
+                                (y + mChunkOffsetY) & CHUNK_MASK);
 }
 
 inline const Cell &TileLayer::cellAt(const QPoint &point) const
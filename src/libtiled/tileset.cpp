@@ -28,13 +28,116 @@
  */
 
 #include "tileset.h"
+#include "imagecache.h"
+#include "imageutils.h"
+#include "maprenderer.h"
+#include "memoryusage.h"
 #include "tile.h"
 #include "terrain.h"
 
-#include <QBitmap>
+#include <QCache>
+#include <QCoreApplication>
+#include <QPair>
+
+#include <climits>
 
 using namespace Tiled;
 
+namespace {
+
+/**
+ * The pixmaps made out of a tileset image. They are shared by all tilesets
+ * loaded from the same image with the same transparent color, for example
+ * when several open maps embed the same tileset.
+ */
+struct TilesetPixmaps
+{
+    QPixmap image;
+    QImage imageData;
+    QVector<QPixmap> mipmaps;
+};
+
+/**
+ * Identifies the image data by its cache key, along with the transparent
+ * color, or 0 when no transparent color is used.
+ */
+typedef QPair<qint64, quint64> TilesetPixmapsKey;
+
+// The amount of pixmap memory kept around for tilesets that were loaded
+// before, in KB. Pixmaps in use by a tileset are shared regardless.
+const int MaxPixmapsCost = 64 * 1024;
+
+// Only accessed from the GUI thread, since it holds pixmaps. Tilesets loaded
+// on other threads don't use it (see Tileset::loadFromImage).
+struct PixmapCacheData
+{
+    PixmapCacheData() : pixmaps(MaxPixmapsCost) {}
+
+    QCache<TilesetPixmapsKey, TilesetPixmaps> pixmaps;
+};
+
+} // anonymous namespace
+
+Q_GLOBAL_STATIC(PixmapCacheData, pixmapCache)
+
+/**
+ * Pixmaps may not outlive the application object.
+ */
+static void clearPixmapCache()
+{
+    pixmapCache()->pixmaps.clear();
+}
+
+/**
+ * Returns the pixmaps for the given tileset \a image, creating them when
+ * they aren't cached yet.
+ */
+static TilesetPixmaps pixmapsForImage(const QImage &image,
+                                      const QColor &transparentColor,
+                                      int mipmapLevels)
+{
+    const TilesetPixmapsKey key(image.cacheKey(),
+                                transparentColor.isValid() ?
+                                    (Q_UINT64_C(1) << 32) | transparentColor.rgba() :
+                                    0);
+
+    PixmapCacheData *data = pixmapCache();
+    if (const TilesetPixmaps *cached = data->pixmaps.object(key))
+        return *cached;
+
+    // The image with the transparent color masked out, in the format that
+    // is drawn fastest, also for drawing outside of the GUI thread
+    TilesetPixmaps pixmaps;
+    pixmaps.imageData = premultipliedImage(image, transparentColor);
+    pixmaps.image = QPixmap::fromImage(pixmaps.imageData);
+
+    // Prepare downscaled versions for drawing the tiles zoomed out
+    QImage mipmap = pixmaps.imageData;
+    for (int level = 1; level <= mipmapLevels; ++level) {
+        const int width = mipmap.width() / 2;
+        const int height = mipmap.height() / 2;
+        if (width < 1 || height < 1)
+            break;
+
+        mipmap = mipmap.scaled(width, height,
+                               Qt::IgnoreAspectRatio,
+                               Qt::SmoothTransformation);
+        pixmaps.mipmaps.append(QPixmap::fromImage(mipmap));
+    }
+
+    static bool postRoutineAdded = false;
+    if (!postRoutineAdded) {
+        qAddPostRoutine(clearPixmapCache);
+        postRoutineAdded = true;
+    }
+
+    // Mipmaps add up to a third of the image size
+    const int cost = image.width() * image.height() * 4 / 1024 * 4 / 3;
+    data->pixmaps.insert(key, new TilesetPixmaps(pixmaps), qMax(cost, 1));
+
+    return pixmaps;
+}
+
 Tileset::~Tileset()
 {
     qDeleteAll(mTiles);
@@ -59,26 +162,36 @@ bool Tileset::loadFromImage(const QImage &image, const QString &fileName)
     int oldTilesetSize = mTiles.size();
     int tileNum = 0;
 
+    if (CellRenderer::isGuiThread()) {
+        // Tilesets loaded from the same image share their pixmaps
+        const TilesetPixmaps pixmaps = pixmapsForImage(image, mTransparentColor,
+                                                       MipmapLevels);
+        mImage = pixmaps.image;
+        mImageData = pixmaps.imageData;
+        mMipmaps = pixmaps.mipmaps;
+    } else {
+        // Pixmaps can't be created outside of the GUI thread, so only the
+        // image data is prepared, which is what the CellRenderer draws from
+        // on other threads
+        mImage = QPixmap();
+        mImageData = premultipliedImage(image, mTransparentColor);
+        mMipmaps.clear();
+    }
+
+    // The tile pixmaps are only cut from the tileset image when needed
     for (int y = mMargin; y <= stopHeight; y += mTileHeight + mTileSpacing) {
         for (int x = mMargin; x <= stopWidth; x += mTileWidth + mTileSpacing) {
-            const QImage tileImage = image.copy(x, y, mTileWidth, mTileHeight);
-            QPixmap tilePixmap = QPixmap::fromImage(tileImage);
-
-            if (mTransparentColor.isValid()) {
-                const QImage mask =
-                        tileImage.createMaskFromColor(mTransparentColor.rgb());
-                tilePixmap.setMask(QBitmap::fromImage(mask));
-            }
+            if (tileNum >= oldTilesetSize)
+                mTiles.append(new Tile(QPixmap(), tileNum, this));
 
-            if (tileNum < oldTilesetSize) {
-                mTiles.at(tileNum)->setImage(tilePixmap);
-            } else {
-                mTiles.append(new Tile(tilePixmap, tileNum, this));
-            }
+            mTiles.at(tileNum)->setImageFromTileset();
             ++tileNum;
         }
     }
 
+    mImageTileCount = tileNum;
+    mTerrainDistancesDirty = true;
+
     // Blank out any remaining tiles to avoid confusion
     while (tileNum < oldTilesetSize) {
         QPixmap tilePixmap = QPixmap(mTileWidth, mTileHeight);
@@ -96,24 +209,96 @@ bool Tileset::loadFromImage(const QImage &image, const QString &fileName)
 
 bool Tileset::loadFromImage(const QString &fileName)
 {
-    return loadFromImage(QImage(fileName), fileName);
+    return loadFromImage(ImageCache::loadImage(fileName), fileName);
+}
+
+bool Tileset::prepareFromImage(const QImage &image, const QString &fileName)
+{
+    if (image.isNull())
+        return false;
+
+    return prepareFromImage(image.size(), fileName);
+}
+
+bool Tileset::prepareFromImage(const QSize &size, const QString &fileName)
+{
+    Q_ASSERT(mTileWidth > 0 && mTileHeight > 0);
+
+    if (size.isEmpty())
+        return false;
+
+    const int columns = qMax(0, columnCountForWidth(size.width()));
+    const int rows = qMax(0, (size.height() - mMargin + mTileSpacing) /
+                             (mTileHeight + mTileSpacing));
+
+    for (int tileNum = mTiles.size(); tileNum < columns * rows; ++tileNum)
+        mTiles.append(new Tile(QPixmap(), tileNum, this));
+    mTerrainDistancesDirty = true;
+
+    mImageWidth = size.width();
+    mImageHeight = size.height();
+    mColumnCount = columns;
+    mImageSource = fileName;
+    return true;
+}
+
+QRect Tileset::imageRect(int id) const
+{
+    if (id < 0 || id >= mImageTileCount || mColumnCount <= 0)
+        return QRect();
+
+    const int column = id % mColumnCount;
+    const int row = id / mColumnCount;
+
+    return QRect(mMargin + column * (mTileWidth + mTileSpacing),
+                 mMargin + row * (mTileHeight + mTileSpacing),
+                 mTileWidth, mTileHeight);
+}
+
+const QPixmap &Tileset::mipmap(int level) const
+{
+    if (level <= 0 || mMipmaps.isEmpty())
+        return mImage;
+
+    return mMipmaps.at(qMin(level, mMipmaps.size()) - 1);
 }
 
 Tileset *Tileset::findSimilarTileset(const QList<Tileset*> &tilesets) const
 {
-    foreach (Tileset *candidate, tilesets) {
-        if (candidate != this
-            && candidate->imageSource() == imageSource()
-            && candidate->tileWidth() == tileWidth()
-            && candidate->tileHeight() == tileHeight()
-            && candidate->tileSpacing() == tileSpacing()
-            && candidate->margin() == margin()) {
-                return candidate;
-        }
-    }
+    const TilesetKey key = similarityKey();
+
+    foreach (Tileset *candidate, tilesets)
+        if (candidate != this && candidate->similarityKey() == key)
+            return candidate;
+
     return 0;
 }
 
+TilesetKey Tileset::similarityKey() const
+{
+    TilesetKey key;
+    key.imageSource = mImageSource;
+    key.tileWidth = mTileWidth;
+    key.tileHeight = mTileHeight;
+    key.tileSpacing = mTileSpacing;
+    key.margin = mMargin;
+    return key;
+}
+
+QHash<TilesetKey, Tileset*> Tileset::similarityIndex(const QList<Tileset*> &tilesets)
+{
+    QHash<TilesetKey, Tileset*> index;
+    index.reserve(tilesets.size());
+
+    foreach (Tileset *tileset, tilesets) {
+        const TilesetKey key = tileset->similarityKey();
+        if (!index.contains(key))
+            index.insert(key, tileset);
+    }
+
+    return index;
+}
+
 int Tileset::columnCountForWidth(int width) const
 {
     Q_ASSERT(mTileWidth > 0);
@@ -175,10 +360,7 @@ Terrain *Tileset::takeTerrainAt(int index)
 
 int Tileset::terrainTransitionPenalty(int terrainType0, int terrainType1)
 {
-    if (mTerrainDistancesDirty) {
-        recalculateTerrainDistances();
-        mTerrainDistancesDirty = false;
-    }
+    updateTerrainDistances();
 
     terrainType0 = terrainType0 == 255 ? -1 : terrainType0;
     terrainType1 = terrainType1 == 255 ? -1 : terrainType1;
@@ -191,6 +373,60 @@ int Tileset::terrainTransitionPenalty(int terrainType0, int terrainType1)
     return mTerrainTypes.at(terrainType0)->transitionDistance(terrainType1);
 }
 
+const TerrainMatches &Tileset::terrainMatches(unsigned terrain,
+                                              unsigned considerationMask)
+{
+    updateTerrainDistances();
+
+    const quint64 key = quint64(terrain) << 32 | considerationMask;
+    QHash<quint64, TerrainMatches>::const_iterator it = mTerrainMatches.constFind(key);
+    if (it != mTerrainMatches.constEnd())
+        return it.value();
+
+    QList<Tile*> candidates;
+    int penalty = INT_MAX;
+
+    foreach (Tile *t, mTiles) {
+        if ((t->terrain() & considerationMask) != (terrain & considerationMask))
+            continue;
+
+        // calculate the tile transition penalty based on shortest distance to target terrain type
+        int tr = terrainTransitionPenalty(t->terrain() >> 24, terrain >> 24);
+        int tl = terrainTransitionPenalty((t->terrain() >> 16) & 0xFF, (terrain >> 16) & 0xFF);
+        int br = terrainTransitionPenalty((t->terrain() >> 8) & 0xFF, (terrain >> 8) & 0xFF);
+        int bl = terrainTransitionPenalty(t->terrain() & 0xFF, terrain & 0xFF);
+
+        // if there is no path to the destination terrain, this isn't a useful transition
+        if (tr < 0 || tl < 0 || br < 0 || bl < 0)
+            continue;
+
+        // add tile to the candidate list
+        int transitionPenalty = tr + tl + br + bl;
+        if (transitionPenalty <= penalty) {
+            if (transitionPenalty < penalty)
+                candidates.clear();
+            penalty = transitionPenalty;
+
+            candidates.append(t);
+        }
+    }
+
+    TerrainMatches matches;
+    foreach (Tile *t, candidates)
+        matches.add(t, t->terrainProbability());
+
+    return mTerrainMatches.insert(key, matches).value();
+}
+
+void Tileset::updateTerrainDistances()
+{
+    if (mTerrainDistancesDirty) {
+        mTerrainDistancesDirty = false;
+        mTerrainMatches.clear();
+        recalculateTerrainDistances();
+    }
+}
+
 void Tileset::recalculateTerrainDistances()
 {
     // some fancy macros which can search for a value in each byte of a word simultaneously
@@ -280,6 +516,7 @@ Tile *Tileset::addTile(const QPixmap &image, const QString &source)
 {
     Tile *newTile = new Tile(image, source, tileCount(), this);
     mTiles.append(newTile);
+    mTerrainDistancesDirty = true;
     if (mTileHeight < image.height())
         mTileHeight = image.height();
     if (mTileWidth < image.width())
@@ -290,18 +527,26 @@ Tile *Tileset::addTile(const QPixmap &image, const QString &source)
 void Tileset::insertTiles(int index, const QList<Tile *> &tiles)
 {
     const int count = tiles.count();
-    for (int i = 0; i < count; ++i)
-        mTiles.insert(index + i, tiles.at(i));
+    for (int i = 0; i < count; ++i) {
+        Tile *tile = tiles.at(i);
+        mTiles.insert(index + i, tile);
+        if (tile->isAnimated() && !mAnimatedTiles.contains(tile))
+            mAnimatedTiles.append(tile);
+    }
 
     // Adjust the tile IDs of the remaining tiles
     for (int i = index + count; i < mTiles.size(); ++i)
         mTiles.at(i)->mId += count;
 
+    mTerrainDistancesDirty = true;
     updateTileSize();
 }
 
 void Tileset::removeTiles(int index, int count)
 {
+    for (int i = index; i < index + count; ++i)
+        mAnimatedTiles.removeOne(mTiles.at(i));
+
     const QList<Tile*>::iterator first = mTiles.begin() + index;
 
     QList<Tile*>::iterator last = first + count;
@@ -311,9 +556,49 @@ void Tileset::removeTiles(int index, int count)
     for (; last != mTiles.end(); ++last)
         (*last)->mId -= count;
 
+    mTerrainDistancesDirty = true;
     updateTileSize();
 }
 
+void Tileset::updateAnimatedTile(Tile *tile)
+{
+    // Tiles that are not part of this tileset yet are picked up when they
+    // get inserted
+    if (tileAt(tile->id()) != tile)
+        return;
+
+    if (tile->isAnimated()) {
+        if (!mAnimatedTiles.contains(tile))
+            mAnimatedTiles.append(tile);
+    } else {
+        mAnimatedTiles.removeOne(tile);
+    }
+}
+
+qint64 Tileset::memoryUsage() const
+{
+    qint64 usage = sizeof(Tileset);
+    usage += stringMemoryUsage(mName);
+    usage += stringMemoryUsage(mFileName);
+    usage += stringMemoryUsage(mImageSource);
+    usage += propertiesMemoryUsage(properties());
+    usage += pixmapMemoryUsage(mImage);
+
+    foreach (const QPixmap &mipmap, mMipmaps)
+        usage += pixmapMemoryUsage(mipmap);
+
+    foreach (const Tile *tile, mTiles)
+        usage += sizeof(Tile*) + tile->memoryUsage();
+
+    foreach (const Terrain *terrain, mTerrainTypes)
+        usage += sizeof(Terrain) + stringMemoryUsage(terrain->name());
+
+    usage += qint64(mTerrainMatches.size()) *
+            (ContainerNodeSize + sizeof(TerrainMatches));
+
+    return usage;
+}
+
 void Tileset::setTileImage(int id, const QPixmap &image,
                            const QString &source)
 {
@@ -325,25 +610,53 @@ void Tileset::setTileImage(int id, const QPixmap &image,
     if (!tile)
         return;
 
-    const QSize previousImageSize = tile->image().size();
-    const QSize newImageSize = image.size();
+    const QSize previousImageSize = tile->size();
 
     tile->setImage(image);
     tile->setImageSource(source);
 
-    if (previousImageSize != newImageSize) {
-        // Update our max. tile size
-        if (previousImageSize.height() == mTileHeight ||
-                previousImageSize.width() == mTileWidth) {
-            // This used to be the max image; we have to recompute
-            updateTileSize();
-        } else {
-            // Check if we have a new maximum
-            if (mTileHeight < newImageSize.height())
-                mTileHeight = newImageSize.height();
-            if (mTileWidth < newImageSize.width())
-                mTileWidth = newImageSize.width();
-        }
+    tileImageSizeChanged(previousImageSize, image.size());
+}
+
+void Tileset::setTileImageSize(int id, const QSize &size,
+                               const QString &source)
+{
+    Q_ASSERT(mImageSource.isEmpty());
+
+    Tile *tile = tileAt(id);
+    if (!tile)
+        return;
+
+    const QSize previousImageSize = tile->size();
+
+    tile->setImage(QPixmap());
+    tile->setImageSize(size);
+    tile->setImageSource(source);
+
+    tileImageSizeChanged(previousImageSize, size);
+}
+
+/**
+ * Updates the maximum tile size after the image of a tile changed from
+ * \a previousSize to \a newSize.
+ */
+void Tileset::tileImageSizeChanged(const QSize &previousSize,
+                                   const QSize &newSize)
+{
+    if (previousSize == newSize)
+        return;
+
+    // Update our max. tile size
+    if (previousSize.height() == mTileHeight ||
+            previousSize.width() == mTileWidth) {
+        // This used to be the max image; we have to recompute
+        updateTileSize();
+    } else {
+        // Check if we have a new maximum
+        if (mTileHeight < newSize.height())
+            mTileHeight = newSize.height();
+        if (mTileWidth < newSize.width())
+            mTileWidth = newSize.width();
     }
 }
 
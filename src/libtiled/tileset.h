@@ -31,8 +31,11 @@
 #define TILESET_H
 
 #include "object.h"
+#include "randompicker.h"
 
 #include <QColor>
+#include <QHash>
+#include <QImage>
 #include <QList>
 #include <QVector>
 #include <QPoint>
@@ -46,6 +49,44 @@ namespace Tiled {
 class Tile;
 class Terrain;
 
+/**
+ * The tiles that best match a certain terrain, to be picked according to
+ * their terrain probabilities.
+ */
+typedef RandomPicker<Tile*> TerrainMatches;
+
+/**
+ * The properties by which tilesets are compared to find out whether they are
+ * similar. Used as a hash key, so that similar tilesets can be found without
+ * comparing each pair of tilesets.
+ *
+ * \sa Tileset::findSimilarTileset()
+ */
+struct TilesetKey
+{
+    QString imageSource;
+    int tileWidth;
+    int tileHeight;
+    int tileSpacing;
+    int margin;
+
+    bool operator==(const TilesetKey &other) const
+    {
+        return imageSource == other.imageSource &&
+                tileWidth == other.tileWidth &&
+                tileHeight == other.tileHeight &&
+                tileSpacing == other.tileSpacing &&
+                margin == other.margin;
+    }
+};
+
+inline uint qHash(const TilesetKey &key)
+{
+    return qHash(key.imageSource) ^
+            uint(key.tileWidth) ^ (uint(key.tileHeight) << 8) ^
+            (uint(key.tileSpacing) << 16) ^ (uint(key.margin) << 24);
+}
+
 /**
  * A tileset, representing a set of tiles.
  *
@@ -77,6 +118,7 @@ public:
         mImageWidth(0),
         mImageHeight(0),
         mColumnCount(0),
+        mImageTileCount(0),
         mTerrainDistancesDirty(false)
     {
         Q_ASSERT(tileSpacing >= 0);
@@ -182,6 +224,38 @@ public:
      */
     int imageHeight() const { return mImageHeight; }
 
+    /**
+     * Returns the tileset image the tiles were cut from, or a null pixmap
+     * when this tileset is not based on a single image. Renderers draw from
+     * it to render many different tiles in a single call.
+     */
+    const QPixmap &image() const { return mImage; }
+
+    /**
+     * Returns the tileset image as a QImage, which unlike the pixmap can be
+     * drawn outside of the GUI thread.
+     */
+    const QImage &imageData() const { return mImageData; }
+
+    /**
+     * The number of downscaled versions of the tileset image that are kept
+     * for drawing at small scales.
+     */
+    enum { MipmapLevels = 3 };
+
+    /**
+     * Returns the tileset image downscaled by a factor of two to the power
+     * of \a level. Level 0 is the image() itself. When the requested level
+     * is not available, the smallest available version is returned.
+     */
+    const QPixmap &mipmap(int level) const;
+
+    /**
+     * Returns the area of image() covered by the tile with the given \a id,
+     * or a null rect when that tile is not part of the image.
+     */
+    QRect imageRect(int id) const;
+
     /**
      * Returns the transparent color, or an invalid color if no transparent
      * color is used.
@@ -202,6 +276,9 @@ public:
      *
      * The tile width and height of this tileset must be higher than 0.
      *
+     * When called outside of the GUI thread, only the imageData() is set up
+     * and image() remains null, since pixmaps can't be used there.
+     *
      * @param image    the image to load the tiles from
      * @param fileName the file name of the image, which will be remembered
      *                 as the image source of this tileset.
@@ -215,12 +292,45 @@ public:
      */
     bool loadFromImage(const QString &fileName);
 
+    /**
+     * Sets up the tiles for the given tileset \a image like loadFromImage(),
+     * but without creating their pixmaps. Pixmaps may only be created on
+     * the GUI thread, so this is used when loading a map on a worker thread.
+     * The tiles get their pixmaps once loadFromImage() is called with the
+     * same image on the GUI thread.
+     *
+     * @return <code>true</code> if the image was valid, otherwise
+     *         returns <code>false</code>
+     */
+    bool prepareFromImage(const QImage &image, const QString &fileName);
+
+    /**
+     * Sets up the tiles for a tileset image of the given \a size. Used when
+     * the image is still being decoded.
+     *
+     * \overload
+     */
+    bool prepareFromImage(const QSize &size, const QString &fileName);
+
     /**
      * This checks if there is a similar tileset in the given list.
      * It is needed for replacing this tileset by its similar copy.
      */
     Tileset *findSimilarTileset(const QList<Tileset*> &tilesets) const;
 
+    /**
+     * Returns the key by which this tileset is compared to other tilesets
+     * when looking for a similar tileset.
+     */
+    TilesetKey similarityKey() const;
+
+    /**
+     * Indexes the given \a tilesets by their similarity key. When several of
+     * them are similar, the first one is indexed, like findSimilarTileset()
+     * would find it.
+     */
+    static QHash<TilesetKey, Tileset*> similarityIndex(const QList<Tileset*> &tilesets);
+
     /**
      * Returns the file name of the external image that contains the tiles in
      * this tileset. Is an empty string when this tileset doesn't have a
@@ -282,6 +392,17 @@ public:
      */
     int terrainTransitionPenalty(int terrainType0, int terrainType1);
 
+    /**
+     * Returns the tiles matching \a terrain on the corners that are set in
+     * \a considerationMask, that have the lowest transition penalty to
+     * \a terrain on all of their corners.
+     *
+     * The matches are cached until the terrain information of this tileset
+     * changes, so that painting terrain doesn't need to look at every tile.
+     */
+    const TerrainMatches &terrainMatches(unsigned terrain,
+                                         unsigned considerationMask);
+
     /**
      * Adds a new tile to the end of the tileset.
      */
@@ -297,21 +418,51 @@ public:
                       const QString &source = QString());
 
     /**
-     * Used by the Tile class when its terrain information changes.
+     * Gives the tile with the given \a id the \a size and \a source of its
+     * image, without loading the image. The tile has no pixmap afterwards.
+     */
+    void setTileImageSize(int id, const QSize &size, const QString &source);
+
+    /**
+     * Used by the Tile class when its terrain information or terrain
+     * probability changes.
      */
     void markTerrainDistancesDirty() { mTerrainDistancesDirty = true; }
 
+    /**
+     * Returns the tiles in this tileset that have animation frames.
+     */
+    const QList<Tile*> &animatedTiles() const { return mAnimatedTiles; }
+
+    /**
+     * Used by the Tile class when its animation frames change.
+     */
+    void updateAnimatedTile(Tile *tile);
+
+    /**
+     * Returns an estimate of the memory used by this tileset, in bytes,
+     * including its image and the images and collision shapes of its tiles.
+     */
+    qint64 memoryUsage() const;
+
 private:
     /**
      * Sets tile size to the maximum size.
      */
     void updateTileSize();
+    void tileImageSizeChanged(const QSize &previousSize, const QSize &newSize);
 
     /**
      * Calculates the transition distance matrix for all terrain types.
      */
     void recalculateTerrainDistances();
 
+    /**
+     * Recalculates the terrain distances and drops the cached terrain
+     * matches when the terrain information changed.
+     */
+    void updateTerrainDistances();
+
     QString mName;
     QString mFileName;
     QString mImageSource;
@@ -324,9 +475,15 @@ private:
     int mImageWidth;
     int mImageHeight;
     int mColumnCount;
+    QPixmap mImage;
+    QImage mImageData;
+    QVector<QPixmap> mMipmaps;
+    int mImageTileCount;
     QList<Tile*> mTiles;
+    QList<Tile*> mAnimatedTiles;
     QList<Terrain*> mTerrainTypes;
     bool mTerrainDistancesDirty;
+    QHash<quint64, TerrainMatches> mTerrainMatches;
 };
 
 } // namespace Tiled
@@ -0,0 +1,229 @@
+/*
+ * trace.cpp
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "trace.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QVector>
+
+using namespace Tiled;
+
+namespace {
+
+struct TraceEvent
+{
+    const char *name;
+    char phase;
+    int thread;
+    qint64 timestamp;
+    qint64 value;       // The duration of scopes, in microseconds
+    QString detail;
+};
+
+// Keeps a long trace from taking all memory. A million events make a file
+// of about 100 MB.
+const int MaxEvents = 1 << 20;
+
+// Accessed only while holding the mutex, except for the members that are
+// set up by the constructor
+struct TraceData
+{
+    TraceData()
+        : fileName(QFile::decodeName(qgetenv("TILED_TRACE")))
+        , enabled(!fileName.isEmpty())
+        , droppedEvents(0)
+    {
+        timer.start();
+    }
+
+    ~TraceData()
+    {
+        write();
+    }
+
+    int threadId();
+    void add(const TraceEvent &event);
+    void write();
+
+    const QString fileName;
+    const bool enabled;
+    QElapsedTimer timer;
+
+    QMutex mutex;
+    QVector<TraceEvent> events;
+    QHash<Qt::HANDLE, int> threadIds;
+    int droppedEvents;
+};
+
+int TraceData::threadId()
+{
+    const Qt::HANDLE handle = QThread::currentThreadId();
+    QHash<Qt::HANDLE, int>::iterator it = threadIds.find(handle);
+    if (it == threadIds.end())
+        it = threadIds.insert(handle, threadIds.size() + 1);
+    return it.value();
+}
+
+void TraceData::add(const TraceEvent &event)
+{
+    QMutexLocker locker(&mutex);
+
+    if (events.size() == MaxEvents) {
+        ++droppedEvents;
+        return;
+    }
+
+    events.append(event);
+    events.last().thread = threadId();
+}
+
+QByteArray escaped(const QString &string)
+{
+    QByteArray result;
+    foreach (const QChar c, string) {
+        const ushort u = c.unicode();
+        if (u == '"' || u == '\\') {
+            result += '\\';
+            result += char(u);
+        } else if (u < 0x20 || u >= 0x7F) {
+            result += "\\u";
+            result += QByteArray::number(u, 16).rightJustified(4, '0');
+        } else {
+            result += char(u);
+        }
+    }
+    return result;
+}
+
+void TraceData::write()
+{
+    QMutexLocker locker(&mutex);
+
+    if (!enabled || events.isEmpty())
+        return;
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning("Failed to write trace to %s: %s",
+                 qPrintable(fileName), qPrintable(file.errorString()));
+        return;
+    }
+
+    const QByteArray pid = QByteArray::number(QCoreApplication::applicationPid());
+
+    file.write("{\"traceEvents\":[\n");
+
+    for (int i = 0; i < events.size(); ++i) {
+        const TraceEvent &event = events.at(i);
+
+        QByteArray line = "{\"name\":\"";
+        line += event.name;
+        line += "\",\"ph\":\"";
+        line += event.phase;
+        line += "\",\"pid\":";
+        line += pid;
+        line += ",\"tid\":";
+        line += QByteArray::number(event.thread);
+        line += ",\"ts\":";
+        line += QByteArray::number(event.timestamp);
+
+        if (event.phase == 'X') {
+            line += ",\"dur\":";
+            line += QByteArray::number(event.value);
+            if (!event.detail.isEmpty()) {
+                line += ",\"args\":{\"detail\":\"";
+                line += escaped(event.detail);
+                line += "\"}";
+            }
+        } else {
+            line += ",\"args\":{\"value\":";
+            line += QByteArray::number(event.value);
+            line += '}';
+        }
+
+        line += i + 1 < events.size() ? "},\n" : "}\n";
+        file.write(line);
+    }
+
+    file.write("]}\n");
+
+    if (droppedEvents > 0)
+        qWarning("Trace was limited to %d events, %d more were dropped",
+                 MaxEvents, droppedEvents);
+}
+
+} // anonymous namespace
+
+Q_GLOBAL_STATIC(TraceData, traceData)
+
+bool Tracer::isEnabled()
+{
+    TraceData *data = traceData();
+    return data && data->enabled;
+}
+
+qint64 Tracer::timestamp()
+{
+    return traceData()->timer.nsecsElapsed() / 1000;
+}
+
+void Tracer::addScope(const char *name, qint64 start, qint64 duration,
+                      const QString &detail)
+{
+    TraceEvent event;
+    event.name = name;
+    event.phase = 'X';
+    event.thread = 0;
+    event.timestamp = start;
+    event.value = duration;
+    event.detail = detail;
+    traceData()->add(event);
+}
+
+void Tracer::setCounter(const char *name, qint64 value)
+{
+    TraceEvent event;
+    event.name = name;
+    event.phase = 'C';
+    event.thread = 0;
+    event.timestamp = timestamp();
+    event.value = value;
+    traceData()->add(event);
+}
+
+void Tracer::flush()
+{
+    if (TraceData *data = traceData())
+        data->write();
+}
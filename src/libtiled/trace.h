@@ -0,0 +1,137 @@
+/*
+ * trace.h
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "tiled_global.h"
+
+#include <QString>
+
+namespace Tiled {
+
+/**
+ * Records a trace of where time is spent, in the Chrome trace event format.
+ * The resulting file can be opened in chrome://tracing or the Perfetto UI.
+ *
+ * Tracing is enabled by setting the TILED_TRACE environment variable to the
+ * name of the file to write. The trace is written when the application
+ * quits, or when flush() is called. Tracing can be compiled out completely
+ * by defining TILED_NO_TRACING.
+ *
+ * Use the TILED_TRACE_SCOPE and TILED_TRACE_COUNTER macros rather than this
+ * class directly, so that the calls are removed when tracing is compiled
+ * out. The names passed to these functions are expected to be string
+ * literals. It is safe to trace from multiple threads.
+ */
+class TILEDSHARED_EXPORT Tracer
+{
+public:
+    /**
+     * Returns whether a trace is being recorded.
+     */
+    static bool isEnabled();
+
+    /**
+     * Returns the time since tracing was started, in microseconds.
+     */
+    static qint64 timestamp();
+
+    /**
+     * Records the scope \a name, which started at \a start and took
+     * \a duration microseconds. The optional \a detail is shown with the
+     * scope, for example the name of the layer that was loaded.
+     */
+    static void addScope(const char *name, qint64 start, qint64 duration,
+                         const QString &detail = QString());
+
+    /**
+     * Records that the counter \a name changed to \a value.
+     */
+    static void setCounter(const char *name, qint64 value);
+
+    /**
+     * Writes the recorded trace to the file given by TILED_TRACE.
+     */
+    static void flush();
+};
+
+/**
+ * Records the time from its construction until its destruction as a scope
+ * of the trace, when tracing is enabled.
+ */
+class TILEDSHARED_EXPORT TraceScope
+{
+public:
+    explicit TraceScope(const char *name)
+        : mName(name)
+        , mStart(Tracer::isEnabled() ? Tracer::timestamp() : -1)
+    {}
+
+    TraceScope(const char *name, const QString &detail)
+        : mName(name)
+        , mStart(Tracer::isEnabled() ? Tracer::timestamp() : -1)
+    {
+        if (mStart != -1)
+            mDetail = detail;
+    }
+
+    ~TraceScope()
+    {
+        if (mStart != -1)
+            Tracer::addScope(mName, mStart, Tracer::timestamp() - mStart,
+                             mDetail);
+    }
+
+private:
+    Q_DISABLE_COPY(TraceScope)
+
+    const char *mName;
+    const qint64 mStart;
+    QString mDetail;
+};
+
+} // namespace Tiled
+
+#ifndef TILED_NO_TRACING
+#define TILED_TRACE_SCOPE(name) \
+    Tiled::TraceScope tiledTraceScope(name)
+#define TILED_TRACE_SCOPE_DETAIL(name, detail) \
+    Tiled::TraceScope tiledTraceScope(name, detail)
+#define TILED_TRACE_COUNTER(name, value) \
+    do { \
+        if (Tiled::Tracer::isEnabled()) \
+            Tiled::Tracer::setCounter(name, value); \
+    } while (0)
+#else
+#define TILED_TRACE_SCOPE(name) do {} while (0)
+#define TILED_TRACE_SCOPE_DETAIL(name, detail) do {} while (0)
+#define TILED_TRACE_COUNTER(name, value) do {} while (0)
+#endif
+
+#endif // TRACE_H
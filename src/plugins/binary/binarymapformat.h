@@ -0,0 +1,199 @@
+/*
+ * Binary Tiled Plugin
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BINARYMAPFORMAT_H
+#define BINARYMAPFORMAT_H
+
+#include "compression.h"
+
+#include <QtGlobal>
+
+/**
+ * The binary map format is meant to be loaded by memory mapping the file,
+ * after which all information can be read in place. All values are stored
+ * little endian. Floating point values are 32-bit IEEE 754.
+ *
+ * The file starts with a header, followed by the sections listed in the
+ * header's section table. Each section starts at a 16 byte aligned offset
+ * and is an array of fixed size records:
+ *
+ *   Tilesets    TilesetRecord for each tileset, in first gid order
+ *   Layers      LayerRecord for each layer, from bottom to top
+ *   Objects     ObjectRecord for each object, grouped by object layer
+ *   Points      Two floats for each polygon or polyline point
+ *   Properties  Two string references (name, value) for each property
+ *   Strings     The string table
+ *   Data        The tile layer data
+ *
+ * Records refer to strings by their byte offset in the string table, with
+ * NoString used for null strings. Each string is stored as a 32-bit length
+ * followed by the UTF-8 encoded characters and a terminating zero, padded
+ * to a multiple of 4 bytes.
+ *
+ * Records refer to their properties, objects and points by the index of the
+ * first entry and the number of entries in the respective section.
+ *
+ * The data of each tile layer starts at a 16 byte aligned offset relative to
+ * the data section. Uncompressed data is an array of 32-bit gids in row-major
+ * order, which can be used directly. Compressed data decompresses to the
+ * same array. The gids use the same flags for flipping as the TMX format.
+ *
+ * The offsets and sizes of all fields are given by the enums below.
+ */
+namespace Binary {
+
+const char Magic[4] = { 'T', 'M', 'B', 'F' };
+const quint16 FormatVersion = 1;
+const quint32 NoString = 0xFFFFFFFF;
+const int SectionAlignment = 16;
+
+enum Section {
+    TilesetSection,
+    LayerSection,
+    ObjectSection,
+    PointSection,
+    PropertySection,
+    StringSection,
+    DataSection,
+    SectionCount
+};
+
+/**
+ * The header. The section table contains an offset from the start of the
+ * file and a count for each section, where the count is the number of
+ * records, or the size in bytes for the string and data sections.
+ */
+enum HeaderLayout {
+    HeaderMagic             = 0,    // char[4]
+    HeaderVersion           = 4,    // u16
+    HeaderFlags             = 6,    // u16, currently always 0
+    HeaderOrientation       = 8,    // u8, Tiled::Map::Orientation
+    HeaderRenderOrder       = 9,    // u8, Tiled::Map::RenderOrder
+    HeaderStaggerAxis       = 10,   // u8, Tiled::Map::StaggerAxis
+    HeaderStaggerIndex      = 11,   // u8, Tiled::Map::StaggerIndex
+    HeaderWidth             = 12,   // i32
+    HeaderHeight            = 16,   // i32
+    HeaderTileWidth         = 20,   // i32
+    HeaderTileHeight        = 24,   // i32
+    HeaderHexSideLength     = 28,   // i32
+    HeaderBackgroundColor   = 32,   // u32, ARGB, 0 when not set
+    HeaderNextObjectId      = 36,   // u32
+    HeaderPropertiesIndex   = 40,   // u32
+    HeaderPropertyCount     = 44,   // u32
+    HeaderSectionTable      = 48,   // {u32 offset, u32 count}[SectionCount]
+    HeaderSize              = HeaderSectionTable + SectionCount * 8
+};
+
+enum TilesetLayout {
+    TilesetFirstGid         = 0,    // u32
+    TilesetName             = 4,    // string
+    TilesetFileName         = 8,    // string, the external tileset, if any
+    TilesetImageSource      = 12,   // string, NoString for image collections
+    TilesetTileWidth        = 16,   // i32
+    TilesetTileHeight       = 20,   // i32
+    TilesetSpacing          = 24,   // i32
+    TilesetMargin           = 28,   // i32
+    TilesetTileCount        = 32,   // i32
+    TilesetColumnCount      = 36,   // i32
+    TilesetTileOffsetX      = 40,   // i32
+    TilesetTileOffsetY      = 44,   // i32
+    TilesetDocument         = 48,   // string, the TSX of embedded tilesets
+    TilesetReserved         = 52,   // u32
+    TilesetRecordSize       = 56
+};
+
+enum LayerRecordType {
+    TileLayerRecord,
+    ObjectGroupRecord,
+    ImageLayerRecord
+};
+
+enum CompressionType {
+    NoCompression,
+    ZlibCompression,
+    GzipCompression,
+    ZstandardCompression,
+    Lz4Compression
+};
+
+enum LayerLayout {
+    LayerType               = 0,    // u8, LayerRecordType
+    LayerVisible            = 1,    // u8
+    LayerCompression        = 2,    // u8, CompressionType
+    LayerDrawOrder          = 3,    // u8, Tiled::ObjectGroup::DrawOrder
+    LayerName               = 4,    // string
+    LayerX                  = 8,    // i32
+    LayerY                  = 12,   // i32
+    LayerWidth              = 16,   // i32
+    LayerHeight             = 20,   // i32
+    LayerOpacity            = 24,   // f32
+    LayerPropertiesIndex    = 28,   // u32
+    LayerPropertyCount      = 32,   // u32
+    LayerDataOffset         = 36,   // u32, relative to the data section
+    LayerDataSize           = 40,   // u32, the stored size in bytes
+    LayerObjectsIndex       = 44,   // u32
+    LayerObjectCount        = 48,   // u32
+    LayerColor              = 52,   // u32, ARGB, color of object layers or
+                                    // transparent color of image layers
+    LayerImageSource        = 56,   // string
+    LayerReserved           = 60,   // u32
+    LayerRecordSize         = 64
+};
+
+enum ObjectLayout {
+    ObjectId                = 0,    // u32
+    ObjectName              = 4,    // string
+    ObjectType              = 8,    // string
+    ObjectX                 = 12,   // f32
+    ObjectY                 = 16,   // f32
+    ObjectWidth             = 20,   // f32
+    ObjectHeight            = 24,   // f32
+    ObjectRotation          = 28,   // f32
+    ObjectGid               = 32,   // u32, 0 when not a tile object
+    ObjectShape             = 36,   // u8, Tiled::MapObject::Shape
+    ObjectVisible           = 37,   // u8
+    ObjectReserved          = 38,   // u16
+    ObjectPointsIndex       = 40,   // u32
+    ObjectPointCount        = 44,   // u32
+    ObjectPropertiesIndex   = 48,   // u32
+    ObjectPropertyCount     = 52,   // u32
+    ObjectReserved2         = 56,   // u32[2]
+    ObjectRecordSize        = 64
+};
+
+const int PointRecordSize = 8;
+const int PropertyRecordSize = 8;
+
+/**
+ * Returns the compression method used for the given compressed \a type.
+ */
+inline Tiled::CompressionMethod compressionMethod(CompressionType type)
+{
+    switch (type) {
+    case GzipCompression:       return Tiled::Gzip;
+    case ZstandardCompression:  return Tiled::Zstandard;
+    case Lz4Compression:        return Tiled::Lz4;
+    default:                    return Tiled::Zlib;
+    }
+}
+
+} // namespace Binary
+
+#endif // BINARYMAPFORMAT_H
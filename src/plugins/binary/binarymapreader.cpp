@@ -0,0 +1,527 @@
+/*
+ * Binary Tiled Plugin
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "binarymapreader.h"
+
+#include "compression.h"
+#include "imagelayer.h"
+#include "map.h"
+#include "mapobject.h"
+#include "mapreader.h"
+#include "objectgroup.h"
+#include "tilelayer.h"
+#include "tileset.h"
+
+#include <QBuffer>
+#include <QImage>
+#include <QScopedPointer>
+#include <QtEndian>
+
+#include <cstring>
+
+using namespace Binary;
+using namespace Tiled;
+
+namespace {
+
+const int RecordSizes[SectionCount] = {
+    TilesetRecordSize,
+    LayerRecordSize,
+    ObjectRecordSize,
+    PointRecordSize,
+    PropertyRecordSize,
+    1,  // the string section is sized in bytes
+    1   // the data section is sized in bytes
+};
+
+quint8 getU8(const uchar *record, int offset)
+{
+    return record[offset];
+}
+
+quint16 getU16(const uchar *record, int offset)
+{
+    return qFromLittleEndian<quint16>(record + offset);
+}
+
+quint32 getU32(const uchar *record, int offset)
+{
+    return qFromLittleEndian<quint32>(record + offset);
+}
+
+qint32 getI32(const uchar *record, int offset)
+{
+    return qint32(getU32(record, offset));
+}
+
+float getFloat(const uchar *record, int offset)
+{
+    const quint32 bits = getU32(record, offset);
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+Map::LayerDataFormat layerDataFormat(CompressionType compression)
+{
+    switch (compression) {
+    case ZlibCompression:       return Map::Base64Zlib;
+    case GzipCompression:       return Map::Base64Gzip;
+    case ZstandardCompression:  return Map::Base64Zstandard;
+    case Lz4Compression:        return Map::Base64Lz4;
+    default:                    return Map::Base64;
+    }
+}
+
+} // anonymous namespace
+
+BinaryMapReader::BinaryMapReader()
+    : mData(0)
+    , mSize(0)
+{
+}
+
+Map *BinaryMapReader::read(const uchar *data, qint64 size, const QDir &mapDir)
+{
+    mData = data;
+    mSize = size;
+    mMapDir = mapDir;
+    mError.clear();
+    mGidMapper.clear();
+
+    if (!readHeader())
+        return 0;
+
+    const Map::Orientation orientation =
+            static_cast<Map::Orientation>(getU8(mData, HeaderOrientation));
+
+    QScopedPointer<Map> map(new Map(orientation,
+                                    getI32(mData, HeaderWidth),
+                                    getI32(mData, HeaderHeight),
+                                    getI32(mData, HeaderTileWidth),
+                                    getI32(mData, HeaderTileHeight)));
+
+    map->setRenderOrder(static_cast<Map::RenderOrder>(
+                            getU8(mData, HeaderRenderOrder)));
+    map->setStaggerAxis(static_cast<Map::StaggerAxis>(
+                            getU8(mData, HeaderStaggerAxis)));
+    map->setStaggerIndex(static_cast<Map::StaggerIndex>(
+                             getU8(mData, HeaderStaggerIndex)));
+    map->setHexSideLength(getI32(mData, HeaderHexSideLength));
+    map->setNextObjectId(getU32(mData, HeaderNextObjectId));
+
+    if (const quint32 argb = getU32(mData, HeaderBackgroundColor))
+        map->setBackgroundColor(QColor::fromRgba(argb));
+
+    Properties properties;
+    if (!readProperties(getU32(mData, HeaderPropertiesIndex),
+                        getU32(mData, HeaderPropertyCount),
+                        properties))
+        return 0;
+    map->setProperties(properties);
+
+    if (!readTilesets(map.data())) {
+        // The tilesets are not owned by the map
+        qDeleteAll(map->tilesets());
+        return 0;
+    }
+
+    for (quint32 i = 0; i < mSectionCounts[LayerSection]; ++i) {
+        const uchar *layerRecord = record(LayerSection, i);
+        Layer *layer = readLayer(layerRecord);
+        if (!layer) {
+            qDeleteAll(map->tilesets());
+            return 0;
+        }
+
+        const CompressionType compression = static_cast<CompressionType>(
+                    getU8(layerRecord, LayerCompression));
+        if (layer->isTileLayer() && compression != NoCompression)
+            map->setLayerDataFormat(layerDataFormat(compression));
+
+        map->addLayer(layer);
+    }
+
+    return map.take();
+}
+
+bool BinaryMapReader::readHeader()
+{
+    if (mSize < HeaderSize
+            || std::memcmp(mData + HeaderMagic, Magic, sizeof(Magic)) != 0) {
+        mError = tr("Not a binary map file.");
+        return false;
+    }
+
+    const quint16 version = getU16(mData, HeaderVersion);
+    if (version != FormatVersion) {
+        mError = tr("Unsupported binary map format version: %1").arg(version);
+        return false;
+    }
+
+    for (int i = 0; i < SectionCount; ++i) {
+        const int entry = HeaderSectionTable + i * 8;
+        mSectionOffsets[i] = getU32(mData, entry);
+        mSectionCounts[i] = getU32(mData, entry + 4);
+
+        const qint64 end = qint64(mSectionOffsets[i])
+                + qint64(mSectionCounts[i]) * RecordSizes[i];
+
+        if (mSectionOffsets[i] < quint32(HeaderSize) || end > mSize) {
+            mError = tr("Corrupt file: section %1 is out of bounds.").arg(i);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool BinaryMapReader::readTilesets(Map *map)
+{
+    for (quint32 i = 0; i < mSectionCounts[TilesetSection]; ++i) {
+        const uchar *tilesetRecord = record(TilesetSection, i);
+
+        QString name;
+        QString fileName;
+        QString document;
+        QString imageSource;
+        if (!readString(getU32(tilesetRecord, TilesetName), name) ||
+                !readString(getU32(tilesetRecord, TilesetFileName), fileName) ||
+                !readString(getU32(tilesetRecord, TilesetDocument), document) ||
+                !readString(getU32(tilesetRecord, TilesetImageSource), imageSource))
+            return false;
+
+        const unsigned firstGid = getU32(tilesetRecord, TilesetFirstGid);
+        Tileset *tileset = 0;
+
+        if (!fileName.isNull()) {
+            const QString path = resolvePath(fileName);
+            MapReader reader;
+            tileset = reader.readTileset(path);
+            if (!tileset) {
+                mError = tr("Error while loading tileset '%1': %2")
+                        .arg(path, reader.errorString());
+                return false;
+            }
+        } else if (!document.isNull()) {
+            QByteArray bytes = document.toUtf8();
+            QBuffer buffer(&bytes);
+            buffer.open(QIODevice::ReadOnly);
+
+            MapReader reader;
+            tileset = reader.readTileset(&buffer, mMapDir.path());
+            if (!tileset) {
+                mError = tr("Error while reading tileset '%1': %2")
+                        .arg(name, reader.errorString());
+                return false;
+            }
+        } else {
+            // Files written by other tools may leave out the TSX document,
+            // in which case the tileset is created from its image
+            const int tileWidth = getI32(tilesetRecord, TilesetTileWidth);
+            const int tileHeight = getI32(tilesetRecord, TilesetTileHeight);
+            const int spacing = getI32(tilesetRecord, TilesetSpacing);
+            const int margin = getI32(tilesetRecord, TilesetMargin);
+
+            if (tileWidth <= 0 || tileHeight <= 0 || spacing < 0 || margin < 0) {
+                mError = tr("Invalid tileset parameters for tileset '%1'")
+                        .arg(name);
+                return false;
+            }
+
+            tileset = new Tileset(name, tileWidth, tileHeight, spacing, margin);
+            tileset->setTileOffset(QPoint(getI32(tilesetRecord, TilesetTileOffsetX),
+                                          getI32(tilesetRecord, TilesetTileOffsetY)));
+
+            if (!imageSource.isNull()) {
+                const QString source = resolvePath(imageSource);
+                tileset->loadFromImage(QImage(source), source);
+            }
+        }
+
+        mGidMapper.insert(firstGid, tileset);
+        map->addTileset(tileset);
+    }
+
+    return true;
+}
+
+Layer *BinaryMapReader::readLayer(const uchar *layerRecord)
+{
+    QString name;
+    QString imageSource;
+    Properties properties;
+    if (!readString(getU32(layerRecord, LayerName), name) ||
+            !readString(getU32(layerRecord, LayerImageSource), imageSource) ||
+            !readProperties(getU32(layerRecord, LayerPropertiesIndex),
+                            getU32(layerRecord, LayerPropertyCount),
+                            properties))
+        return 0;
+
+    const int x = getI32(layerRecord, LayerX);
+    const int y = getI32(layerRecord, LayerY);
+    const int width = getI32(layerRecord, LayerWidth);
+    const int height = getI32(layerRecord, LayerHeight);
+
+    if (width < 0 || height < 0) {
+        mError = tr("Corrupt file: invalid size for layer '%1'.").arg(name);
+        return 0;
+    }
+
+    const quint32 argb = getU32(layerRecord, LayerColor);
+    QScopedPointer<Layer> layer;
+
+    switch (getU8(layerRecord, LayerType)) {
+    case TileLayerRecord: {
+        TileLayer *tileLayer = new TileLayer(name, x, y, width, height);
+        layer.reset(tileLayer);
+
+        const quint8 compression = getU8(layerRecord, LayerCompression);
+        const quint32 dataOffset = getU32(layerRecord, LayerDataOffset);
+        const quint32 dataSize = getU32(layerRecord, LayerDataSize);
+        const qint64 expectedSize = qint64(width) * height * 4;
+
+        if (compression > Lz4Compression ||
+                qint64(dataOffset) + dataSize > mSectionCounts[DataSection]) {
+            mError = tr("Corrupt layer data for layer '%1'").arg(name);
+            return 0;
+        }
+
+        const uchar *gids = mData + mSectionOffsets[DataSection] + dataOffset;
+        qint64 size = dataSize;
+
+        // Uncompressed data is used in place
+        QByteArray decompressed;
+        if (compression != NoCompression) {
+            const CompressionMethod method =
+                    compressionMethod(static_cast<CompressionType>(compression));
+
+            if (!isCompressionMethodSupported(method)) {
+                mError = tr("Compression method used by layer '%1' is not "
+                            "supported").arg(name);
+                return 0;
+            }
+
+            const QByteArray compressed =
+                    QByteArray::fromRawData(reinterpret_cast<const char*>(gids),
+                                            dataSize);
+            decompressed = decompress(compressed, expectedSize, method);
+            gids = reinterpret_cast<const uchar*>(decompressed.constData());
+            size = decompressed.size();
+        }
+
+        if (size != expectedSize) {
+            mError = tr("Corrupt layer data for layer '%1'").arg(name);
+            return 0;
+        }
+
+        for (int cellY = 0; cellY < height; ++cellY) {
+            for (int cellX = 0; cellX < width; ++cellX) {
+                const unsigned gid = qFromLittleEndian<quint32>(gids);
+                gids += 4;
+
+                bool ok;
+                const Cell cell = mGidMapper.gidToCell(gid, ok);
+                if (!ok) {
+                    mError = tr("Invalid tile: %1").arg(gid);
+                    return 0;
+                }
+
+                if (!cell.isEmpty())
+                    tileLayer->setCell(cellX, cellY, cell);
+            }
+        }
+        break;
+    }
+    case ObjectGroupRecord: {
+        ObjectGroup *objectGroup = new ObjectGroup(name, x, y, width, height);
+        layer.reset(objectGroup);
+
+        objectGroup->setDrawOrder(static_cast<ObjectGroup::DrawOrder>(
+                                      qint8(getU8(layerRecord, LayerDrawOrder))));
+        if (argb)
+            objectGroup->setColor(QColor::fromRgba(argb));
+
+        const quint32 objectsIndex = getU32(layerRecord, LayerObjectsIndex);
+        const quint32 objectCount = getU32(layerRecord, LayerObjectCount);
+
+        for (quint32 i = 0; i < objectCount; ++i) {
+            const uchar *objectRecord = record(ObjectSection, objectsIndex + i);
+            if (!objectRecord || objectsIndex + i < objectsIndex) {
+                mError = tr("Corrupt file: invalid objects for layer '%1'.")
+                        .arg(name);
+                return 0;
+            }
+
+            MapObject *mapObject = readObject(objectRecord);
+            if (!mapObject)
+                return 0;
+
+            objectGroup->addObject(mapObject);
+        }
+        break;
+    }
+    case ImageLayerRecord: {
+        ImageLayer *imageLayer = new ImageLayer(name, x, y, width, height);
+        layer.reset(imageLayer);
+
+        if (argb)
+            imageLayer->setTransparentColor(QColor::fromRgba(argb));
+
+        if (!imageSource.isNull()) {
+            const QString source = resolvePath(imageSource);
+            if (!imageLayer->loadFromImage(QImage(source), source)) {
+                mError = tr("Error loading image layer image:\n'%1'").arg(source);
+                return 0;
+            }
+        }
+        break;
+    }
+    default:
+        mError = tr("Corrupt file: unknown type for layer '%1'.").arg(name);
+        return 0;
+    }
+
+    layer->setVisible(getU8(layerRecord, LayerVisible));
+    layer->setOpacity(getFloat(layerRecord, LayerOpacity));
+    layer->setProperties(properties);
+
+    return layer.take();
+}
+
+MapObject *BinaryMapReader::readObject(const uchar *objectRecord)
+{
+    QString name;
+    QString type;
+    Properties properties;
+    if (!readString(getU32(objectRecord, ObjectName), name) ||
+            !readString(getU32(objectRecord, ObjectType), type) ||
+            !readProperties(getU32(objectRecord, ObjectPropertiesIndex),
+                            getU32(objectRecord, ObjectPropertyCount),
+                            properties))
+        return 0;
+
+    QPolygonF polygon;
+    const quint32 pointsIndex = getU32(objectRecord, ObjectPointsIndex);
+    const quint32 pointCount = getU32(objectRecord, ObjectPointCount);
+    if (pointCount > 0) {
+        const uchar *points = record(PointSection, pointsIndex);
+        const uchar *last = record(PointSection, pointsIndex + pointCount - 1);
+        if (!points || !last || pointsIndex + pointCount < pointsIndex) {
+            mError = tr("Corrupt file: invalid points for object '%1'.")
+                    .arg(name);
+            return 0;
+        }
+
+        polygon.reserve(pointCount);
+        for (quint32 i = 0; i < pointCount; ++i) {
+            polygon.append(QPointF(getFloat(points, 0), getFloat(points, 4)));
+            points += PointRecordSize;
+        }
+    }
+
+    Cell cell;
+    if (const unsigned gid = getU32(objectRecord, ObjectGid)) {
+        bool ok;
+        cell = mGidMapper.gidToCell(gid, ok);
+        if (!ok) {
+            mError = tr("Invalid tile: %1").arg(gid);
+            return 0;
+        }
+    }
+
+    const QPointF pos(getFloat(objectRecord, ObjectX),
+                      getFloat(objectRecord, ObjectY));
+    const QSizeF size(getFloat(objectRecord, ObjectWidth),
+                      getFloat(objectRecord, ObjectHeight));
+
+    MapObject *mapObject = new MapObject(name, type, pos, size);
+    mapObject->setId(getU32(objectRecord, ObjectId));
+    mapObject->setRotation(getFloat(objectRecord, ObjectRotation));
+    mapObject->setShape(static_cast<MapObject::Shape>(
+                            getU8(objectRecord, ObjectShape)));
+    mapObject->setVisible(getU8(objectRecord, ObjectVisible));
+    mapObject->setPolygon(polygon);
+    mapObject->setCell(cell);
+    mapObject->setProperties(properties);
+
+    return mapObject;
+}
+
+const uchar *BinaryMapReader::record(Section section, quint32 index) const
+{
+    if (index >= mSectionCounts[section])
+        return 0;
+
+    return mData + mSectionOffsets[section]
+            + qint64(index) * RecordSizes[section];
+}
+
+bool BinaryMapReader::readString(quint32 ref, QString &string)
+{
+    if (ref == NoString) {
+        string = QString();
+        return true;
+    }
+
+    const qint64 tableSize = mSectionCounts[StringSection];
+    const uchar *table = mData + mSectionOffsets[StringSection];
+
+    if (qint64(ref) + 4 <= tableSize) {
+        const quint32 length = getU32(table, ref);
+        if (qint64(ref) + 4 + length < tableSize) {
+            const char *utf8 = reinterpret_cast<const char*>(table + ref + 4);
+            string = QString::fromUtf8(utf8, length);
+            return true;
+        }
+    }
+
+    mError = tr("Corrupt file: invalid string reference %1.").arg(ref);
+    return false;
+}
+
+bool BinaryMapReader::readProperties(quint32 index, quint32 count,
+                                     Properties &properties)
+{
+    for (quint32 i = 0; i < count; ++i) {
+        const uchar *propertyRecord = record(PropertySection, index + i);
+        if (!propertyRecord || index + i < index) {
+            mError = tr("Corrupt file: invalid property index %1.").arg(index);
+            return false;
+        }
+
+        QString name;
+        QString value;
+        if (!readString(getU32(propertyRecord, 0), name) ||
+                !readString(getU32(propertyRecord, 4), value))
+            return false;
+
+        properties.insert(name, value);
+    }
+
+    return true;
+}
+
+QString BinaryMapReader::resolvePath(const QString &fileName) const
+{
+    if (QDir::isRelativePath(fileName))
+        return QDir::cleanPath(mMapDir.absoluteFilePath(fileName));
+    return fileName;
+}
@@ -0,0 +1,87 @@
+/*
+ * Binary Tiled Plugin
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BINARYMAPREADER_H
+#define BINARYMAPREADER_H
+
+#include "binarymapformat.h"
+
+#include "gidmapper.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QString>
+
+namespace Tiled {
+class Layer;
+class Map;
+class MapObject;
+class Properties;
+}
+
+namespace Binary {
+
+/**
+ * Reads maps stored in the binary map format described in binarymapformat.h.
+ *
+ * The data is read in place, so it is suitable for use on a memory mapped
+ * file. All offsets are validated before being used.
+ */
+class BinaryMapReader
+{
+    Q_DECLARE_TR_FUNCTIONS(BinaryMapReader)
+
+public:
+    BinaryMapReader();
+
+    /**
+     * Reads the map from the \a size bytes at \a data. References to external
+     * files are resolved relative to \a mapDir. Returns 0 and sets the
+     * errorString() when the data is not a valid binary map.
+     */
+    Tiled::Map *read(const uchar *data, qint64 size, const QDir &mapDir);
+
+    QString errorString() const { return mError; }
+
+private:
+    bool readHeader();
+    bool readTilesets(Tiled::Map *map);
+    Tiled::Layer *readLayer(const uchar *record);
+    Tiled::MapObject *readObject(const uchar *record);
+
+    const uchar *record(Section section, quint32 index) const;
+    bool readString(quint32 ref, QString &string);
+    bool readProperties(quint32 index, quint32 count,
+                        Tiled::Properties &properties);
+    QString resolvePath(const QString &fileName) const;
+
+    const uchar *mData;
+    qint64 mSize;
+    QDir mMapDir;
+    QString mError;
+    Tiled::GidMapper mGidMapper;
+
+    quint32 mSectionOffsets[SectionCount];
+    quint32 mSectionCounts[SectionCount];
+};
+
+} // namespace Binary
+
+#endif // BINARYMAPREADER_H
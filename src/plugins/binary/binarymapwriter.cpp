@@ -0,0 +1,368 @@
+/*
+ * Binary Tiled Plugin
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "binarymapwriter.h"
+
+#include "imagelayer.h"
+#include "map.h"
+#include "mapobject.h"
+#include "mapwriter.h"
+#include "objectgroup.h"
+#include "tilelayer.h"
+#include "tileset.h"
+
+#include <QBuffer>
+#include <QtEndian>
+
+#include <cstring>
+
+using namespace Binary;
+using namespace Tiled;
+
+namespace {
+
+void putU8(QByteArray &record, int offset, quint8 value)
+{
+    record[offset] = char(value);
+}
+
+void putU16(QByteArray &record, int offset, quint16 value)
+{
+    qToLittleEndian(value, reinterpret_cast<uchar*>(record.data() + offset));
+}
+
+void putU32(QByteArray &record, int offset, quint32 value)
+{
+    qToLittleEndian(value, reinterpret_cast<uchar*>(record.data() + offset));
+}
+
+void putI32(QByteArray &record, int offset, qint32 value)
+{
+    putU32(record, offset, quint32(value));
+}
+
+void putFloat(QByteArray &record, int offset, float value)
+{
+    quint32 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    putU32(record, offset, bits);
+}
+
+quint32 colorToArgb(const QColor &color)
+{
+    return color.isValid() ? quint32(color.rgba()) : 0;
+}
+
+void pad(QByteArray &data, int alignment)
+{
+    const int remainder = data.size() % alignment;
+    if (remainder)
+        data.append(QByteArray(alignment - remainder, '\0'));
+}
+
+} // anonymous namespace
+
+BinaryMapWriter::BinaryMapWriter()
+    : mCompression(NoCompression)
+{
+}
+
+QByteArray BinaryMapWriter::toByteArray(const Map *map, const QDir &mapDir)
+{
+    mMapDir = mapDir;
+    mError.clear();
+    mGidMapper.clear();
+    mStringOffsets.clear();
+    for (int i = 0; i < SectionCount; ++i) {
+        mSections[i].clear();
+        mCounts[i] = 0;
+    }
+
+    switch (map->layerDataFormat()) {
+    case Map::Base64Gzip:
+        mCompression = GzipCompression;
+        break;
+    case Map::Base64Zlib:
+        mCompression = ZlibCompression;
+        break;
+    case Map::Base64Zstandard:
+        mCompression = isCompressionMethodSupported(Zstandard)
+                ? ZstandardCompression : ZlibCompression;
+        break;
+    case Map::Base64Lz4:
+        mCompression = isCompressionMethodSupported(Lz4)
+                ? Lz4Compression : ZlibCompression;
+        break;
+    default:
+        mCompression = NoCompression;
+        break;
+    }
+
+    unsigned firstGid = 1;
+    foreach (const Tileset *tileset, map->tilesets()) {
+        writeTileset(tileset, firstGid);
+        mGidMapper.insert(firstGid, const_cast<Tileset*>(tileset));
+        firstGid += tileset->tileCount();
+    }
+
+    foreach (const Layer *layer, map->layers()) {
+        QByteArray record(LayerRecordSize, '\0');
+        putU8(record, LayerVisible, layer->isVisible());
+        putU32(record, LayerName, addString(layer->name()));
+        putI32(record, LayerX, layer->x());
+        putI32(record, LayerY, layer->y());
+        putI32(record, LayerWidth, layer->width());
+        putI32(record, LayerHeight, layer->height());
+        putFloat(record, LayerOpacity, layer->opacity());
+        putU32(record, LayerPropertiesIndex, addProperties(layer->properties()));
+        putU32(record, LayerPropertyCount, layer->properties().size());
+        putU32(record, LayerImageSource, NoString);
+
+        switch (layer->layerType()) {
+        case Layer::TileLayerType:
+            writeTileLayer(record, static_cast<const TileLayer*>(layer));
+            break;
+        case Layer::ObjectGroupType:
+            writeObjectGroup(record, static_cast<const ObjectGroup*>(layer));
+            break;
+        case Layer::ImageLayerType:
+            writeImageLayer(record, static_cast<const ImageLayer*>(layer));
+            break;
+        }
+
+        mSections[LayerSection].append(record);
+        ++mCounts[LayerSection];
+    }
+
+    if (!mError.isEmpty())
+        return QByteArray();
+
+    QByteArray result(HeaderSize, '\0');
+    std::memcpy(result.data() + HeaderMagic, Magic, sizeof(Magic));
+    putU16(result, HeaderVersion, FormatVersion);
+    putU16(result, HeaderFlags, 0);
+    putU8(result, HeaderOrientation, map->orientation());
+    putU8(result, HeaderRenderOrder, map->renderOrder());
+    putU8(result, HeaderStaggerAxis, map->staggerAxis());
+    putU8(result, HeaderStaggerIndex, map->staggerIndex());
+    putI32(result, HeaderWidth, map->width());
+    putI32(result, HeaderHeight, map->height());
+    putI32(result, HeaderTileWidth, map->tileWidth());
+    putI32(result, HeaderTileHeight, map->tileHeight());
+    putI32(result, HeaderHexSideLength, map->hexSideLength());
+    putU32(result, HeaderBackgroundColor, colorToArgb(map->backgroundColor()));
+    putU32(result, HeaderNextObjectId, map->nextObjectId());
+    putU32(result, HeaderPropertiesIndex, addProperties(map->properties()));
+    putU32(result, HeaderPropertyCount, map->properties().size());
+
+    for (int i = 0; i < SectionCount; ++i) {
+        pad(result, SectionAlignment);
+
+        const bool sizedInBytes = i == StringSection || i == DataSection;
+        const int entry = HeaderSectionTable + i * 8;
+        putU32(result, entry, result.size());
+        putU32(result, entry + 4, sizedInBytes ? mSections[i].size()
+                                               : mCounts[i]);
+
+        result.append(mSections[i]);
+    }
+
+    return result;
+}
+
+void BinaryMapWriter::writeTileset(const Tileset *tileset, unsigned firstGid)
+{
+    QByteArray record(TilesetRecordSize, '\0');
+    putU32(record, TilesetFirstGid, firstGid);
+    putU32(record, TilesetName, addString(tileset->name()));
+
+    if (!tileset->fileName().isEmpty()) {
+        const QString fileName = mMapDir.relativeFilePath(tileset->fileName());
+        putU32(record, TilesetFileName, addString(fileName));
+        putU32(record, TilesetDocument, NoString);
+    } else {
+        // Embedded tilesets are stored as TSX, so that the tile properties,
+        // terrains and animations don't need their own sections
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+        MapWriter writer;
+        writer.writeTileset(tileset, &buffer, mMapDir.path());
+
+        putU32(record, TilesetFileName, NoString);
+        putU32(record, TilesetDocument,
+               addString(QString::fromUtf8(buffer.data())));
+    }
+
+    const QString &imageSource = tileset->imageSource();
+    putU32(record, TilesetImageSource,
+           imageSource.isEmpty() ? NoString
+                                 : addString(mMapDir.relativeFilePath(imageSource)));
+    putI32(record, TilesetTileWidth, tileset->tileWidth());
+    putI32(record, TilesetTileHeight, tileset->tileHeight());
+    putI32(record, TilesetSpacing, tileset->tileSpacing());
+    putI32(record, TilesetMargin, tileset->margin());
+    putI32(record, TilesetTileCount, tileset->tileCount());
+    putI32(record, TilesetColumnCount, tileset->columnCount());
+    putI32(record, TilesetTileOffsetX, tileset->tileOffset().x());
+    putI32(record, TilesetTileOffsetY, tileset->tileOffset().y());
+
+    mSections[TilesetSection].append(record);
+    ++mCounts[TilesetSection];
+}
+
+void BinaryMapWriter::writeTileLayer(QByteArray &record,
+                                     const TileLayer *tileLayer)
+{
+    putU8(record, LayerType, TileLayerRecord);
+
+    const int width = tileLayer->width();
+    const int height = tileLayer->height();
+
+    QByteArray gids(width * height * 4, '\0');
+    uchar *out = reinterpret_cast<uchar*>(gids.data());
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            qToLittleEndian<quint32>(mGidMapper.cellToGid(tileLayer->cellAt(x, y)),
+                                     out);
+            out += 4;
+        }
+    }
+
+    if (mCompression != NoCompression) {
+        CompressionType type = static_cast<CompressionType>(mCompression);
+        gids = compress(gids, compressionMethod(type));
+        if (gids.isNull()) {
+            mError = tr("Failed to compress the data of layer '%1'.")
+                    .arg(tileLayer->name());
+            return;
+        }
+    }
+
+    QByteArray &data = mSections[DataSection];
+    pad(data, SectionAlignment);
+
+    putU8(record, LayerCompression, mCompression);
+    putU32(record, LayerDataOffset, data.size());
+    putU32(record, LayerDataSize, gids.size());
+
+    data.append(gids);
+}
+
+void BinaryMapWriter::writeObjectGroup(QByteArray &record,
+                                       const ObjectGroup *objectGroup)
+{
+    putU8(record, LayerType, ObjectGroupRecord);
+    putU8(record, LayerDrawOrder, quint8(objectGroup->drawOrder()));
+    putU32(record, LayerColor, colorToArgb(objectGroup->color()));
+    putU32(record, LayerObjectsIndex, mCounts[ObjectSection]);
+    putU32(record, LayerObjectCount, objectGroup->objectCount());
+
+    foreach (const MapObject *mapObject, objectGroup->objects())
+        writeObject(mapObject);
+}
+
+void BinaryMapWriter::writeImageLayer(QByteArray &record,
+                                      const ImageLayer *imageLayer)
+{
+    putU8(record, LayerType, ImageLayerRecord);
+    putU32(record, LayerColor, colorToArgb(imageLayer->transparentColor()));
+
+    const QString &imageSource = imageLayer->imageSource();
+    if (!imageSource.isEmpty()) {
+        putU32(record, LayerImageSource,
+               addString(mMapDir.relativeFilePath(imageSource)));
+    }
+}
+
+void BinaryMapWriter::writeObject(const MapObject *mapObject)
+{
+    QByteArray record(ObjectRecordSize, '\0');
+    putU32(record, ObjectId, mapObject->id());
+    putU32(record, ObjectName, addString(mapObject->name()));
+    putU32(record, ObjectType, addString(mapObject->type()));
+    putFloat(record, ObjectX, mapObject->x());
+    putFloat(record, ObjectY, mapObject->y());
+    putFloat(record, ObjectWidth, mapObject->width());
+    putFloat(record, ObjectHeight, mapObject->height());
+    putFloat(record, ObjectRotation, mapObject->rotation());
+    putU32(record, ObjectGid, mapObject->cell().isEmpty()
+           ? 0 : mGidMapper.cellToGid(mapObject->cell()));
+    putU8(record, ObjectShape, mapObject->shape());
+    putU8(record, ObjectVisible, mapObject->isVisible());
+
+    const QPolygonF &polygon = mapObject->polygon();
+    putU32(record, ObjectPointsIndex, mCounts[PointSection]);
+    putU32(record, ObjectPointCount, polygon.size());
+
+    QByteArray point(PointRecordSize, '\0');
+    foreach (const QPointF &p, polygon) {
+        putFloat(point, 0, p.x());
+        putFloat(point, 4, p.y());
+        mSections[PointSection].append(point);
+        ++mCounts[PointSection];
+    }
+
+    putU32(record, ObjectPropertiesIndex,
+           addProperties(mapObject->properties()));
+    putU32(record, ObjectPropertyCount, mapObject->properties().size());
+
+    mSections[ObjectSection].append(record);
+    ++mCounts[ObjectSection];
+}
+
+quint32 BinaryMapWriter::addString(const QString &string)
+{
+    if (string.isNull())
+        return NoString;
+
+    QHash<QString, quint32>::const_iterator it = mStringOffsets.constFind(string);
+    if (it != mStringOffsets.constEnd())
+        return it.value();
+
+    QByteArray &strings = mSections[StringSection];
+    const quint32 offset = strings.size();
+    const QByteArray utf8 = string.toUtf8();
+
+    QByteArray length(4, '\0');
+    putU32(length, 0, utf8.size());
+    strings.append(length);
+    strings.append(utf8);
+    strings.append('\0');
+    pad(strings, 4);
+
+    mStringOffsets.insert(string, offset);
+    return offset;
+}
+
+quint32 BinaryMapWriter::addProperties(const Properties &properties)
+{
+    const quint32 index = mCounts[PropertySection];
+
+    QByteArray record(PropertyRecordSize, '\0');
+    Properties::const_iterator it = properties.constBegin();
+    for (; it != properties.constEnd(); ++it) {
+        putU32(record, 0, addString(it.key()));
+        putU32(record, 4, addString(it.value()));
+        mSections[PropertySection].append(record);
+        ++mCounts[PropertySection];
+    }
+
+    return index;
+}
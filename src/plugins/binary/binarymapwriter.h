@@ -0,0 +1,89 @@
+/*
+ * Binary Tiled Plugin
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BINARYMAPWRITER_H
+#define BINARYMAPWRITER_H
+
+#include "binarymapformat.h"
+
+#include "gidmapper.h"
+
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QDir>
+#include <QHash>
+#include <QString>
+
+namespace Tiled {
+class ImageLayer;
+class Map;
+class MapObject;
+class ObjectGroup;
+class Properties;
+class TileLayer;
+class Tileset;
+}
+
+namespace Binary {
+
+/**
+ * Serializes a map to the binary map format described in binarymapformat.h.
+ */
+class BinaryMapWriter
+{
+    Q_DECLARE_TR_FUNCTIONS(BinaryMapWriter)
+
+public:
+    BinaryMapWriter();
+
+    /**
+     * Returns the binary representation of the given \a map, or a null
+     * QByteArray when an error occurred. References to external files are
+     * made relative to \a mapDir.
+     */
+    QByteArray toByteArray(const Tiled::Map *map, const QDir &mapDir);
+
+    QString errorString() const { return mError; }
+
+private:
+    void writeTileset(const Tiled::Tileset *tileset, unsigned firstGid);
+    void writeTileLayer(QByteArray &record, const Tiled::TileLayer *tileLayer);
+    void writeObjectGroup(QByteArray &record,
+                          const Tiled::ObjectGroup *objectGroup);
+    void writeImageLayer(QByteArray &record,
+                         const Tiled::ImageLayer *imageLayer);
+    void writeObject(const Tiled::MapObject *mapObject);
+
+    quint32 addString(const QString &string);
+    quint32 addProperties(const Tiled::Properties &properties);
+
+    QDir mMapDir;
+    QString mError;
+    Tiled::GidMapper mGidMapper;
+    int mCompression;
+
+    QByteArray mSections[SectionCount];
+    quint32 mCounts[SectionCount];
+    QHash<QString, quint32> mStringOffsets;
+};
+
+} // namespace Binary
+
+#endif // BINARYMAPWRITER_H
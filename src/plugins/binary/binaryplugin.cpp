@@ -0,0 +1,136 @@
+/*
+ * Binary Tiled Plugin
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "binaryplugin.h"
+
+#include "binarymapreader.h"
+#include "binarymapwriter.h"
+
+#include "map.h"
+
+#include <QFile>
+#include <QFileInfo>
+
+#if QT_VERSION >= 0x050100
+#define HAS_QSAVEFILE_SUPPORT
+#endif
+
+#ifdef HAS_QSAVEFILE_SUPPORT
+#include <QSaveFile>
+#endif
+
+using namespace Binary;
+
+BinaryPlugin::BinaryPlugin()
+{
+}
+
+Tiled::Map *BinaryPlugin::read(const QString &fileName,
+                               Tiled::ProgressContext *progress)
+{
+    Q_UNUSED(progress)
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        mError = tr("Could not open file for reading.");
+        return 0;
+    }
+
+    // The format is designed to be read in place from a memory mapping. When
+    // mapping is not possible, the file is read into memory instead.
+    QByteArray contents;
+    const uchar *data = file.map(0, file.size());
+    const bool mapped = data != 0;
+    if (!mapped) {
+        contents = file.readAll();
+        data = reinterpret_cast<const uchar*>(contents.constData());
+    }
+
+    BinaryMapReader reader;
+    Tiled::Map *map = reader.read(data, file.size(), QFileInfo(fileName).dir());
+
+    if (mapped)
+        file.unmap(const_cast<uchar*>(data));
+
+    if (!map)
+        mError = reader.errorString();
+
+    return map;
+}
+
+bool BinaryPlugin::supportsFile(const QString &fileName) const
+{
+    return fileName.endsWith(QLatin1String(".tmb"), Qt::CaseInsensitive);
+}
+
+bool BinaryPlugin::write(const Tiled::Map *map, const QString &fileName,
+                         Tiled::ProgressContext *progress)
+{
+    Q_UNUSED(progress)
+
+    BinaryMapWriter writer;
+    const QByteArray data = writer.toByteArray(map, QFileInfo(fileName).dir());
+    if (data.isNull()) {
+        mError = writer.errorString();
+        return false;
+    }
+
+#ifdef HAS_QSAVEFILE_SUPPORT
+    QSaveFile file(fileName);
+#else
+    QFile file(fileName);
+#endif
+    if (!file.open(QIODevice::WriteOnly)) {
+        mError = tr("Could not open file for writing.");
+        return false;
+    }
+
+    file.write(data);
+
+    if (file.error() != QFile::NoError) {
+        mError = file.errorString();
+        return false;
+    }
+
+#ifdef HAS_QSAVEFILE_SUPPORT
+    if (!file.commit()) {
+        mError = file.errorString();
+        return false;
+    }
+#endif
+
+    return true;
+}
+
+QStringList BinaryPlugin::nameFilters() const
+{
+    QStringList filters;
+    filters.append(tr("Tiled binary map files (*.tmb)"));
+    return filters;
+}
+
+QString BinaryPlugin::errorString() const
+{
+    return mError;
+}
+
+#if QT_VERSION < 0x050000
+Q_EXPORT_PLUGIN2(Binary, BinaryPlugin)
+#endif
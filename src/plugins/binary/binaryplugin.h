@@ -0,0 +1,76 @@
+/*
+ * Binary Tiled Plugin
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BINARYPLUGIN_H
+#define BINARYPLUGIN_H
+
+#include "binary_global.h"
+
+#include "mapwriterinterface.h"
+#include "mapreaderinterface.h"
+
+#include <QObject>
+
+namespace Tiled {
+class Map;
+}
+
+namespace Binary {
+
+/**
+ * Reads and writes maps in a binary format that can be memory mapped and
+ * used without parsing. See binarymapformat.h for the layout.
+ */
+class BINARYSHARED_EXPORT BinaryPlugin
+        : public QObject
+        , public Tiled::MapReaderInterface
+        , public Tiled::MapWriterInterface
+{
+    Q_OBJECT
+    Q_INTERFACES(Tiled::MapReaderInterface)
+    Q_INTERFACES(Tiled::MapWriterInterface)
+#if QT_VERSION >= 0x050000
+    Q_PLUGIN_METADATA(IID "org.mapeditor.MapWriterInterface/2" FILE "plugin.json")
+    Q_PLUGIN_METADATA(IID "org.mapeditor.MapReaderInterface/2" FILE "plugin.json")
+#endif
+
+public:
+    BinaryPlugin();
+
+    // MapReaderInterface
+    Tiled::Map *read(const QString &fileName,
+                     Tiled::ProgressContext *progress = 0);
+    bool supportsFile(const QString &fileName) const;
+
+    // MapWriterInterface
+    bool write(const Tiled::Map *map, const QString &fileName,
+               Tiled::ProgressContext *progress = 0);
+
+    // Both interfaces
+    QStringList nameFilters() const;
+    QString errorString() const;
+
+private:
+    QString mError;
+};
+
+} // namespace Binary
+
+#endif // BINARYPLUGIN_H
@@ -23,8 +23,13 @@
 #include "map.h"
 #include "tile.h"
 #include "tilelayer.h"
+#include "tileset.h"
 
+#include <QDir>
 #include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QVector>
 
 #if QT_VERSION >= 0x050100
 #define HAS_QSAVEFILE_SUPPORT
@@ -37,11 +42,145 @@
 using namespace Tiled;
 using namespace Csv;
 
+namespace {
+
+/**
+ * Writes the CSV data through a buffer, so that the file is only written to
+ * in large blocks.
+ */
+class BufferedWriter
+{
+public:
+    explicit BufferedWriter(QIODevice *device)
+        : mDevice(device)
+    {
+        mBuffer.reserve(BufferSize + 1024);
+    }
+
+    ~BufferedWriter() { flush(); }
+
+    void write(const QByteArray &data)
+    {
+        mBuffer.append(data);
+        if (mBuffer.size() >= BufferSize)
+            flush();
+    }
+
+    void write(char c)
+    {
+        mBuffer.append(c);
+    }
+
+    void flush()
+    {
+        if (!mBuffer.isEmpty()) {
+            mDevice->write(mBuffer);
+            mBuffer.resize(0);  // keeps the reserved capacity
+        }
+    }
+
+private:
+    enum { BufferSize = 64 * 1024 };
+
+    QIODevice *mDevice;
+    QByteArray mBuffer;
+};
+
+} // anonymous namespace
+
+namespace Csv {
+
+/**
+ * Caches the value written for each tile, which is either its "name"
+ * property or its ID.
+ */
+class TileValues
+{
+public:
+    TileValues()
+        : mEmpty("-1")
+    {}
+
+    const QByteArray &value(const Tile *tile)
+    {
+        if (!tile)
+            return mEmpty;
+
+        QVector<QByteArray> &values = mValues[tile->tileset()];
+        if (values.isEmpty())
+            values = tilesetValues(tile->tileset());
+
+        return values.at(tile->id());
+    }
+
+private:
+    static QVector<QByteArray> tilesetValues(const Tileset *tileset)
+    {
+        const QLatin1String name("name");
+
+        QVector<QByteArray> values;
+        values.reserve(tileset->tileCount());
+        foreach (const Tile *tile, tileset->tiles()) {
+            if (tile->hasProperty(name))
+                values.append(tile->property(name).toUtf8());
+            else
+                values.append(QByteArray::number(tile->id()));
+        }
+        return values;
+    }
+
+    const QByteArray mEmpty;
+    QHash<const Tileset*, QVector<QByteArray> > mValues;
+};
+
+} // namespace Csv
+
 CsvPlugin::CsvPlugin()
 {
 }
 
-bool CsvPlugin::write(const Map *map, const QString &fileName)
+bool CsvPlugin::write(const Map *map, const QString &fileName,
+                      Tiled::ProgressContext *progress)
+{
+    Q_UNUSED(progress)
+
+    QList<const TileLayer*> tileLayers;
+    foreach (const Layer *layer, map->layers())
+        if (layer->layerType() == Layer::TileLayerType)
+            tileLayers.append(static_cast<const TileLayer*>(layer));
+
+    if (tileLayers.isEmpty()) {
+        mError = tr("No tile layer found.");
+        return false;
+    }
+
+    // Shared between the layers, since they usually use the same tilesets
+    TileValues values;
+
+    // A single tile layer is written to the chosen file, otherwise each layer
+    // gets its own file named after the layer.
+    if (tileLayers.size() == 1)
+        return writeLayer(tileLayers.first(), fileName, values);
+
+    const QFileInfo fileInfo(fileName);
+    const QString base = fileInfo.dir().filePath(fileInfo.completeBaseName());
+    const QString suffix = fileInfo.suffix();
+
+    foreach (const TileLayer *tileLayer, tileLayers) {
+        QString layerFileName = base + QLatin1Char('_') + tileLayer->name();
+        if (!suffix.isEmpty())
+            layerFileName += QLatin1Char('.') + suffix;
+
+        if (!writeLayer(tileLayer, layerFileName, values))
+            return false;
+    }
+
+    return true;
+}
+
+bool CsvPlugin::writeLayer(const TileLayer *tileLayer,
+                           const QString &fileName,
+                           TileValues &values)
 {
 #ifdef HAS_QSAVEFILE_SUPPORT
     QSaveFile file(fileName);
@@ -53,38 +192,20 @@ bool CsvPlugin::write(const Map *map, const QString &fileName)
         return false;
     }
 
-    const TileLayer *tileLayer = 0;
+    // Write out tiles either by ID or their name, if given. -1 is "empty"
+    {
+        BufferedWriter writer(&file);
 
-    // Take the first tile layer
-    foreach (const Layer *layer, map->layers()) {
-        if (layer->layerType() == Layer::TileLayerType) {
-            tileLayer = static_cast<const TileLayer*>(layer);
-            break;
-        }
-    }
+        for (int y = 0; y < tileLayer->height(); ++y) {
+            for (int x = 0; x < tileLayer->width(); ++x) {
+                if (x > 0)
+                    writer.write(',');
 
-    if (!tileLayer) {
-        mError = tr("No tile layer found.");
-        return false;
-    }
-
-    // Write out tiles either by ID or their name, if given. -1 is "empty"
-    for (int y = 0; y < tileLayer->height(); ++y) {
-        for (int x = 0; x < tileLayer->width(); ++x) {
-            if (x > 0)
-                file.write(",", 1);
-
-            const Cell &cell = tileLayer->cellAt(x, y);
-            const Tile *tile = cell.tile;
-            if (tile && tile->hasProperty(QLatin1String("name"))) {
-                file.write(tile->property(QLatin1String("name")).toUtf8());
-            } else {
-                const int id = tile ? tile->id() : -1;
-                file.write(QByteArray::number(id));
+                writer.write(values.value(tileLayer->cellAt(x, y).tile));
             }
-        }
 
-        file.write("\n", 1);
+            writer.write('\n');
+        }
     }
 
     if (file.error() != QFile::NoError) {
@@ -25,26 +25,37 @@
 
 #include "csv_global.h"
 
+namespace Tiled {
+class TileLayer;
+}
+
 namespace Csv {
 
+class TileValues;
+
 class CSVSHARED_EXPORT CsvPlugin : public QObject,
                                    public Tiled::MapWriterInterface
 {
     Q_OBJECT
     Q_INTERFACES(Tiled::MapWriterInterface)
 #if QT_VERSION >= 0x050000
-    Q_PLUGIN_METADATA(IID "org.mapeditor.MapWriterInterface" FILE "plugin.json")
+    Q_PLUGIN_METADATA(IID "org.mapeditor.MapWriterInterface/2" FILE "plugin.json")
 #endif
 
 public:
     CsvPlugin();
 
     // MapWriterInterface
-    bool write(const Tiled::Map *map, const QString &fileName);
+    bool write(const Tiled::Map *map, const QString &fileName,
+               Tiled::ProgressContext *progress = 0);
     QString nameFilter() const;
     QString errorString() const;
 
 private:
+    bool writeLayer(const Tiled::TileLayer *tileLayer,
+                    const QString &fileName,
+                    TileValues &values);
+
     QString mError;
 };
 
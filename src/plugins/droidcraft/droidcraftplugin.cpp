@@ -36,8 +36,11 @@ DroidcraftPlugin::DroidcraftPlugin()
 }
 
 // Reader
-Tiled::Map *DroidcraftPlugin::read(const QString &fileName)
+Tiled::Map *DroidcraftPlugin::read(const QString &fileName,
+                                   Tiled::ProgressContext *progress)
 {
+    Q_UNUSED(progress)
+
     using namespace Tiled;
 
     QByteArray uncompressed;
@@ -91,8 +94,11 @@ bool DroidcraftPlugin::supportsFile(const QString &fileName) const
 }
 
 // Writer
-bool DroidcraftPlugin::write(const Tiled::Map *map, const QString &fileName)
+bool DroidcraftPlugin::write(const Tiled::Map *map, const QString &fileName,
+                             Tiled::ProgressContext *progress)
 {
+    Q_UNUSED(progress)
+
     using namespace Tiled;
 
     // Check layer count and type
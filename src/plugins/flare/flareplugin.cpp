@@ -38,6 +38,8 @@
 #include <QStringList>
 #include <QTextStream>
 
+#include <climits>
+
 using namespace Flare;
 using namespace Tiled;
 
@@ -45,8 +47,135 @@ FlarePlugin::FlarePlugin()
 {
 }
 
-Tiled::Map *FlarePlugin::read(const QString &fileName)
+namespace {
+
+/**
+ * Reads lines from a buffer holding the whole file. Like
+ * QTextStream::readLine, the line ending is not included.
+ */
+class LineReader
+{
+public:
+    explicit LineReader(const QByteArray &data)
+        : mPos(data.constData())
+        , mEnd(data.constData() + data.size())
+    {}
+
+    bool atEnd() const { return mPos == mEnd; }
+
+    /**
+     * Returns the next line as a range of bytes. Returns an empty range at
+     * the end of the buffer.
+     */
+    void readLine(const char *&begin, const char *&end)
+    {
+        begin = mPos;
+        while (mPos != mEnd && *mPos != '\n')
+            ++mPos;
+
+        end = mPos;
+        if (end != begin && *(end - 1) == '\r')
+            --end;
+
+        if (mPos != mEnd)
+            ++mPos;
+    }
+
+    QString readLine()
+    {
+        const char *begin;
+        const char *end;
+        readLine(begin, end);
+        return QString::fromUtf8(begin, end - begin);
+    }
+
+private:
+    const char *mPos;
+    const char *mEnd;
+};
+
+inline int digitValue(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return 99;
+}
+
+/**
+ * Parses the comma-separated tile IDs from \a begin to \a end and calls
+ * \a setCell for up to \a width of them. Like QString::toInt, values that
+ * can't be parsed are read as 0, meaning an empty cell.
+ */
+bool readLayerRow(const char *begin, const char *end, int base,
+                  const GidMapper &gidMapper,
+                  TileLayer *tileLayer, int y, int width,
+                  QString &error)
+{
+    const char *p = begin;
+
+    for (int x = 0; x < width && p != end; ++x) {
+        while (p != end && (*p == ' ' || *p == '\t'))
+            ++p;
+
+        bool negative = false;
+        if (p != end && (*p == '-' || *p == '+')) {
+            negative = *p == '-';
+            ++p;
+        }
+        if (base == 16 && end - p > 1 && p[0] == '0' &&
+                (p[1] == 'x' || p[1] == 'X'))
+            p += 2;
+
+        const char *digits = p;
+        qint64 value = 0;
+        int digit;
+        while (p != end && (digit = digitValue(*p)) < base) {
+            value = value * base + digit;
+            if (value > INT_MAX)
+                break;
+            ++p;
+        }
+        const bool valid = p != digits && value <= INT_MAX;
+
+        while (p != end && (*p == ' ' || *p == '\t'))
+            ++p;
+
+        int tileId = 0;
+        if (valid && (p == end || *p == ','))
+            tileId = negative ? -int(value) : int(value);
+
+        // Move on to the next value
+        while (p != end && *p != ',')
+            ++p;
+        if (p != end)
+            ++p;
+
+        if (tileId == 0)
+            continue;   // The layer starts out empty
+
+        bool ok;
+        const Cell cell = gidMapper.gidToCell(tileId, ok);
+        if (!ok) {
+            error += FlarePlugin::tr("Error mapping tile id %1.").arg(tileId);
+            return false;
+        }
+        tileLayer->setCell(x, y, cell);
+    }
+
+    return true;
+}
+
+} // anonymous namespace
+
+Tiled::Map *FlarePlugin::read(const QString &fileName,
+                              Tiled::ProgressContext *progress)
 {
+    Q_UNUSED(progress)
+
     QFile file(fileName);
     if (!file.open (QIODevice::ReadOnly)) {
         mError = tr("Could not open file for reading.");
@@ -56,7 +185,10 @@ Tiled::Map *FlarePlugin::read(const QString &fileName)
     // default to values of the original flare alpha game.
     Map *map = new Map(Map::Isometric, 256, 256, 64, 32);
 
-    QTextStream stream (&file);
+    // Reading the whole file at once allows parsing the layer data directly
+    // from the bytes
+    const QByteArray data = file.readAll();
+    LineReader stream(data);
     QString line;
     QString sectionName;
     bool newsection = false;
@@ -168,19 +300,15 @@ Tiled::Map *FlarePlugin::read(const QString &fileName)
                         base = 16;
                     }
                 } else if (key == QLatin1String("data")) {
-                    for (int y=0; y < map->height(); y++) {
-                        line = stream.readLine();
-                        QStringList l = line.split(QChar(','));
-                        for (int x=0; x < qMin(map->width(), l.size()); x++) {
-                            bool ok;
-                            int tileid = l[x].toInt(0, base);
-                            Cell c = gidMapper.gidToCell(tileid, ok);
-                            if (!ok) {
-                                mError += tr("Error mapping tile id %1.").arg(tileid);
-                                delete map;
-                                return 0;
-                            }
-                            tilelayer->setCell(x, y, c);
+                    for (int y = 0; y < map->height(); ++y) {
+                        const char *begin;
+                        const char *end;
+                        stream.readLine(begin, end);
+                        if (!readLayerRow(begin, end, base, gidMapper,
+                                          tilelayer, y, map->width(),
+                                          mError)) {
+                            delete map;
+                            return 0;
                         }
                     }
                 } else {
@@ -272,8 +400,11 @@ QString FlarePlugin::errorString() const
     return mError;
 }
 
-bool FlarePlugin::write(const Tiled::Map *map, const QString &fileName)
+bool FlarePlugin::write(const Tiled::Map *map, const QString &fileName,
+                        Tiled::ProgressContext *progress)
 {
+    Q_UNUSED(progress)
+
     QFile file(fileName);
     if (!file.open(QFile::WriteOnly | QFile::Text)) {
         mError = tr("Could not open file for writing.");
@@ -324,21 +455,29 @@ bool FlarePlugin::write(const Tiled::Map *map, const QString &fileName)
             out << "[layer]\n";
             out << "type=" << layer->name() << "\n";
             out << "data=\n";
+
+            // The layer data is written to the file directly, which is much
+            // faster than streaming each value as text
+            QByteArray data;
+            data.reserve(mapWidth * mapHeight * 4);
             for (int y = 0; y < mapHeight; ++y) {
                 for (int x = 0; x < mapWidth; ++x) {
-                    Cell t = tileLayer->cellAt(x, y);
-                    int id = 0;
+                    const Cell &t = tileLayer->cellAt(x, y);
                     if (t.tile)
-                        id = gidMapper.cellToGid(t);
-                    out << id;
+                        data.append(QByteArray::number(gidMapper.cellToGid(t)));
+                    else
+                        data.append('0');
                     if (x < mapWidth - 1)
-                        out << ",";
+                        data.append(',');
                 }
                 if (y < mapHeight - 1)
-                    out << ",";
-                out << "\n";
+                    data.append(',');
+                data.append('\n');
             }
-            out << "\n";
+            data.append('\n');
+
+            out.flush();
+            file.write(data);
         }
         if (ObjectGroup *group = layer->asObjectGroup()) {
             foreach (const MapObject *o, group->objects()) {
@@ -22,6 +22,7 @@
 #include "jsonplugin.h"
 
 #include "maptovariantconverter.h"
+#include "progresscontext.h"
 #include "varianttomapconverter.h"
 
 #include "qjsonparser/json.h"
@@ -44,7 +45,8 @@ JsonPlugin::JsonPlugin()
 {
 }
 
-Tiled::Map *JsonPlugin::read(const QString &fileName)
+Tiled::Map *JsonPlugin::read(const QString &fileName,
+                             Tiled::ProgressContext *progress)
 {
     QFile file(fileName);
     if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
@@ -73,16 +75,26 @@ Tiled::Map *JsonPlugin::read(const QString &fileName)
         return 0;
     }
 
+    // Parsing and converting are the two steps that take time
+    Tiled::reportProgress(progress, 1, 2);
+    if (Tiled::isCanceled(progress)) {
+        mError = tr("Reading the map was canceled.");
+        return 0;
+    }
+
     VariantToMapConverter converter;
     Tiled::Map *map = converter.toMap(variant, QFileInfo(fileName).dir());
 
     if (!map)
         mError = converter.errorString();
+    else
+        Tiled::reportProgress(progress, 2, 2);
 
     return map;
 }
 
-bool JsonPlugin::write(const Tiled::Map *map, const QString &fileName)
+bool JsonPlugin::write(const Tiled::Map *map, const QString &fileName,
+                       Tiled::ProgressContext *progress)
 {
 #ifdef HAS_QSAVEFILE_SUPPORT
     QSaveFile file(fileName);
@@ -97,6 +109,12 @@ bool JsonPlugin::write(const Tiled::Map *map, const QString &fileName)
     MapToVariantConverter converter;
     QVariant variant = converter.toVariant(map, QFileInfo(fileName).dir());
 
+    Tiled::reportProgress(progress, 1, 3);
+    if (Tiled::isCanceled(progress)) {
+        mError = tr("Saving the map was canceled.");
+        return false;
+    }
+
     JsonWriter writer;
     writer.setAutoFormatting(true);
 
@@ -106,6 +124,12 @@ bool JsonPlugin::write(const Tiled::Map *map, const QString &fileName)
         return false;
     }
 
+    Tiled::reportProgress(progress, 2, 3);
+    if (Tiled::isCanceled(progress)) {
+        mError = tr("Saving the map was canceled.");
+        return false;
+    }
+
     QTextStream out(&file);
     bool isJsFile = fileName.endsWith(".js");
     if (isJsFile) {
@@ -138,6 +162,7 @@ bool JsonPlugin::write(const Tiled::Map *map, const QString &fileName)
     }
 #endif
 
+    Tiled::reportProgress(progress, 3, 3);
     return true;
 }
 
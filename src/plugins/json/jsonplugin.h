@@ -44,19 +44,21 @@ class JSONSHARED_EXPORT JsonPlugin
     Q_INTERFACES(Tiled::MapReaderInterface)
     Q_INTERFACES(Tiled::MapWriterInterface)
 #if QT_VERSION >= 0x050000
-    Q_PLUGIN_METADATA(IID "org.mapeditor.MapWriterInterface" FILE "plugin.json")
-    Q_PLUGIN_METADATA(IID "org.mapeditor.MapReaderInterface" FILE "plugin.json")
+    Q_PLUGIN_METADATA(IID "org.mapeditor.MapWriterInterface/2" FILE "plugin.json")
+    Q_PLUGIN_METADATA(IID "org.mapeditor.MapReaderInterface/2" FILE "plugin.json")
 #endif
 
 public:
     JsonPlugin();
 
     // MapReaderInterface
-    Tiled::Map *read(const QString &fileName);
+    Tiled::Map *read(const QString &fileName,
+                     Tiled::ProgressContext *progress = 0);
     bool supportsFile(const QString &fileName) const;
 
     // MapWriterInterface
-    bool write(const Tiled::Map *map, const QString &fileName);
+    bool write(const Tiled::Map *map, const QString &fileName,
+               Tiled::ProgressContext *progress = 0);
 
     // Both interfaces
     QStringList nameFilters() const;
@@ -21,7 +21,9 @@
 
 #include "maptovariantconverter.h"
 
+#include "compression.h"
 #include "imagelayer.h"
+#include "layerexportcache.h"
 #include "map.h"
 #include "mapobject.h"
 #include "objectgroup.h"
@@ -31,6 +33,8 @@
 #include "tileset.h"
 #include "terrain.h"
 
+#include "qjsonparser/json.h"
+
 using namespace Tiled;
 using namespace Json;
 
@@ -38,6 +42,7 @@ QVariant MapToVariantConverter::toVariant(const Map *map, const QDir &mapDir)
 {
     mMapDir = mapDir;
     mGidMapper.clear();
+    mLayerDataFormat = map->layerDataFormat();
 
     QVariantMap mapVariant;
 
@@ -210,12 +215,72 @@ QVariant MapToVariantConverter::toVariant(const TileLayer *tileLayer) const
 
     addLayerAttributes(tileLayerVariant, tileLayer);
 
-    QVariantList tileVariants;
-    for (int y = 0; y < tileLayer->height(); ++y)
-        for (int x = 0; x < tileLayer->width(); ++x)
-            tileVariants << mGidMapper.cellToGid(tileLayer->cellAt(x, y));
+    bool base64 = true;
+    bool compressed = true;
+    CompressionMethod method = Zlib;
+
+    switch (mLayerDataFormat) {
+    case Map::Base64:
+        compressed = false;
+        break;
+    case Map::Base64Gzip:
+        method = Gzip;
+        break;
+    case Map::Base64Zlib:
+        method = Zlib;
+        break;
+    case Map::Base64Zstandard:
+        method = Zstandard;
+        break;
+    case Map::Base64Lz4:
+        method = Lz4;
+        break;
+    case Map::XML:
+    case Map::CSV:
+        base64 = false;
+        break;
+    }
+
+    // Fall back to an array of gids when the compression method isn't
+    // available in this build
+    if (compressed && !isCompressionMethodSupported(method))
+        base64 = false;
+
+    if (base64) {
+        QByteArray tileData;
+
+        if (compressed) {
+            tileData = LayerExportCache::compressedGids(tileLayer, mGidMapper,
+                                                        method);
+
+            QString compression;
+            switch (method) {
+            case Gzip:      compression = QLatin1String("gzip"); break;
+            case Zlib:      compression = QLatin1String("zlib"); break;
+            case Zstandard: compression = QLatin1String("zstd"); break;
+            case Lz4:       compression = QLatin1String("lz4"); break;
+            }
+            tileLayerVariant["compression"] = compression;
+        } else {
+            tileData = LayerExportCache::gids(tileLayer, mGidMapper);
+        }
+
+        tileLayerVariant["encoding"] = "base64";
+        tileLayerVariant["data"] = QString::fromLatin1(tileData.toBase64());
+        return tileLayerVariant;
+    }
+
+    // The gids are stored in a single array rather than a list with a variant
+    // for each tile, which JsonWriter writes out directly
+    const QByteArray tileData = LayerExportCache::gids(tileLayer, mGidMapper);
+    const int count = tileLayer->width() * tileLayer->height();
+
+    JsonUIntArray gids;
+    gids.values.reserve(count);
+    for (int i = 0; i < count; ++i)
+        gids.values.append(LayerExportCache::gidAt(tileData, i));
 
-    tileLayerVariant["data"] = tileVariants;
+    tileLayerVariant["data"] = QVariant::fromValue(gids);
     return tileLayerVariant;
 }
 
@@ -26,6 +26,7 @@
 #include <QVariant>
 
 #include "gidmapper.h"
+#include "map.h"
 
 namespace Json {
 
@@ -36,7 +37,7 @@ namespace Json {
 class MapToVariantConverter
 {
 public:
-    MapToVariantConverter() {}
+    MapToVariantConverter() : mLayerDataFormat(Tiled::Map::XML) {}
 
     /**
      * Converts the given \s map to a QVariant. The \a mapDir is used to
@@ -56,6 +57,7 @@ private:
 
     QDir mMapDir;
     Tiled::GidMapper mGidMapper;
+    Tiled::Map::LayerDataFormat mLayerDataFormat;
 };
 
 } // namespace Json
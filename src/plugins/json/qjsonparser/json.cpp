@@ -10,6 +10,8 @@
 #include "json.h"
 #include "jsonparser.cpp"
 
+#include "numberutils.h"
+
 #include <QTextCodec>
 #include <qnumeric.h>
 
@@ -293,6 +295,22 @@ static QString escape(const QVariant &variant)
     return res;
 }
 
+/*! \internal
+  Appends the decimal representation of \a value to \a result.
+ */
+static inline void appendNumber(QString &result, uint value)
+{
+    QChar digits[10];
+    int i = 10;
+    do {
+        digits[--i] = QLatin1Char('0' + value % 10);
+        value /= 10;
+    } while (value);
+
+    while (i < 10)
+        result += digits[i++];
+}
+
 /*! \internal
   Stringifies \a variant.
  */
@@ -310,6 +328,19 @@ void JsonWriter::stringify(const QVariant &variant, int depth)
             stringify(list[i], depth+1);
         }
         m_result += QLatin1Char(']');
+    } else if (variant.userType() == qMetaTypeId<JsonUIntArray>()) {
+        const QVector<uint> values = variant.value<JsonUIntArray>().values;
+        m_result.reserve(m_result.size() + values.size() * 4 + 2);
+        m_result += QLatin1Char('[');
+        for (int i = 0; i < values.size(); i++) {
+            if (i != 0) {
+                m_result += QLatin1Char(',');
+                if (m_autoFormatting)
+                    m_result += QLatin1Char(' ');
+            }
+            appendNumber(m_result, values.at(i));
+        }
+        m_result += QLatin1Char(']');
     } else if (variant.type() == QVariant::Map) {
         QString indent = m_autoFormattingIndent.repeated(depth);
         QVariantMap map = variant.toMap();
@@ -341,7 +372,7 @@ void JsonWriter::stringify(const QVariant &variant, int depth)
     } else if (variant.type() == QVariant::Double || (int)variant.type() == (int)QMetaType::Float) {
         double d = variant.toDouble();
         if (qIsFinite(d))
-            m_result += QString::number(variant.toDouble(), 'g', 15);
+            Tiled::appendNumber(m_result, d, 15);
         else
             m_result += QLatin1String("null");
     } else if (variant.type() == QVariant::Bool) {
@@ -387,6 +418,9 @@ void JsonWriter::stringify(const QVariant &variant, int depth)
   \o QVariant::List, QVariant::StringList
   \o JSON array []
   \row
+  \o JsonUIntArray
+  \o JSON array [] of numbers
+  \row
   \o QVariant::Map
   \o JSON object {}
   \row
@@ -12,6 +12,18 @@
 
 #include <QByteArray>
 #include <QVariant>
+#include <QVector>
+
+/**
+ * An array of unsigned integers. When stored in a QVariant, JsonWriter writes
+ * it as a JSON array of numbers, without requiring a QVariant per element.
+ */
+struct JsonUIntArray
+{
+    QVector<uint> values;
+};
+
+Q_DECLARE_METATYPE(JsonUIntArray)
 
 class JsonReader
 {
@@ -21,6 +21,7 @@
 
 #include "varianttomapconverter.h"
 
+#include "compression.h"
 #include "imagelayer.h"
 #include "map.h"
 #include "mapobject.h"
@@ -123,7 +124,7 @@ Properties VariantToMapConverter::toProperties(const QVariant &variant)
     QVariantMap::const_iterator it = variantMap.constBegin();
     QVariantMap::const_iterator it_end = variantMap.constEnd();
     for (; it != it_end; ++it)
-        properties[it.key()] = it.value().toString();
+        properties[Properties::internedName(it.key())] = it.value().toString();
 
     return properties;
 }
@@ -276,12 +277,6 @@ TileLayer *VariantToMapConverter::toTileLayer(const QVariantMap &variantMap)
     const QString name = variantMap["name"].toString();
     const int width = variantMap["width"].toInt();
     const int height = variantMap["height"].toInt();
-    const QVariantList dataVariantList = variantMap["data"].toList();
-
-    if (dataVariantList.size() != width * height) {
-        mError = tr("Corrupt layer data for layer '%1'").arg(name);
-        return 0;
-    }
 
     typedef QScopedPointer<TileLayer> TileLayerPtr;
     TileLayerPtr tileLayer(new TileLayer(name,
@@ -295,6 +290,93 @@ TileLayer *VariantToMapConverter::toTileLayer(const QVariantMap &variantMap)
     tileLayer->setOpacity(opacity);
     tileLayer->setVisible(visible);
 
+    if (!readTileLayerData(tileLayer.data(), variantMap))
+        return 0;
+
+    return tileLayer.take();
+}
+
+bool VariantToMapConverter::readTileLayerData(TileLayer *tileLayer,
+                                              const QVariantMap &variantMap)
+{
+    const QString encoding = variantMap["encoding"].toString();
+    const QString compression = variantMap["compression"].toString();
+    const int size = tileLayer->width() * tileLayer->height();
+
+    if (encoding == "base64") {
+        QByteArray tileData =
+                QByteArray::fromBase64(variantMap["data"].toString().toLatin1());
+
+        if (compression.isEmpty())
+            mMap->setLayerDataFormat(Map::Base64);
+
+        if (!compression.isEmpty()) {
+            CompressionMethod method = Zlib;
+            bool known = true;
+
+            if (compression == "gzip")
+                method = Gzip;
+            else if (compression == "zstd")
+                method = Zstandard;
+            else if (compression == "lz4")
+                method = Lz4;
+            else if (compression != "zlib")
+                known = false;
+
+            if (!known || !isCompressionMethodSupported(method)) {
+                mError = tr("Compression method '%1' not supported")
+                        .arg(compression);
+                return false;
+            }
+
+            switch (method) {
+            case Gzip:      mMap->setLayerDataFormat(Map::Base64Gzip); break;
+            case Zlib:      mMap->setLayerDataFormat(Map::Base64Zlib); break;
+            case Zstandard: mMap->setLayerDataFormat(Map::Base64Zstandard); break;
+            case Lz4:       mMap->setLayerDataFormat(Map::Base64Lz4); break;
+            }
+
+            tileData = decompress(tileData, size * 4, method);
+        }
+
+        if (tileData.size() != size * 4) {
+            mError = tr("Corrupt layer data for layer '%1'")
+                    .arg(tileLayer->name());
+            return false;
+        }
+
+        const unsigned char *data =
+                reinterpret_cast<const unsigned char*>(tileData.constData());
+
+        for (int i = 0; i < size; ++i) {
+            const unsigned gid = data[i * 4] |
+                                 data[i * 4 + 1] << 8 |
+                                 data[i * 4 + 2] << 16 |
+                                 data[i * 4 + 3] << 24;
+            bool ok;
+            const Cell cell = mGidMapper.gidToCell(gid, ok);
+            tileLayer->setCell(i % tileLayer->width(),
+                               i / tileLayer->width(),
+                               cell);
+        }
+
+        return true;
+    } else if (!encoding.isEmpty() && encoding != "csv") {
+        mError = tr("Unknown encoding: %1").arg(encoding);
+        return false;
+    }
+
+    // Keep writing an array of gids when the map is saved again
+    mMap->setLayerDataFormat(Map::CSV);
+
+    const QVariantList dataVariantList = variantMap["data"].toList();
+
+    if (dataVariantList.size() != size) {
+        mError = tr("Corrupt layer data for layer '%1'")
+                .arg(tileLayer->name());
+        return false;
+    }
+
     int x = 0;
     int y = 0;
     bool ok;
@@ -304,7 +386,7 @@ TileLayer *VariantToMapConverter::toTileLayer(const QVariantMap &variantMap)
         if (!ok) {
             mError = tr("Unable to parse tile at (%1,%2) on layer '%3'")
                     .arg(x).arg(y).arg(tileLayer->name());
-            return 0;
+            return false;
         }
 
         const Cell cell = mGidMapper.gidToCell(gid, ok);
@@ -318,7 +400,7 @@ TileLayer *VariantToMapConverter::toTileLayer(const QVariantMap &variantMap)
         }
     }
 
-    return tileLayer.take();
+    return true;
 }
 
 ObjectGroup *VariantToMapConverter::toObjectGroup(const QVariantMap &variantMap)
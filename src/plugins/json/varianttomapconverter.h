@@ -69,6 +69,8 @@ private:
     Tiled::Tileset *toTileset(const QVariant &variant);
     Tiled::Layer *toLayer(const QVariant &variant);
     Tiled::TileLayer *toTileLayer(const QVariantMap &variantMap);
+    bool readTileLayerData(Tiled::TileLayer *tileLayer,
+                           const QVariantMap &variantMap);
     Tiled::ObjectGroup *toObjectGroup(const QVariantMap &variantMap);
     Tiled::ImageLayer *toImageLayer(const QVariantMap &variantMap);
 
@@ -22,10 +22,13 @@
 
 #include "luatablewriter.h"
 
+#include "compression.h"
 #include "imagelayer.h"
+#include "layerexportcache.h"
 #include "map.h"
 #include "mapobject.h"
 #include "objectgroup.h"
+#include "progresscontext.h"
 #include "properties.h"
 #include "terrain.h"
 #include "tile.h"
@@ -34,6 +37,7 @@
 
 #include <QFile>
 #include <QCoreApplication>
+#include <QVector>
 
 #if QT_VERSION >= 0x050100
 #define HAS_QSAVEFILE_SUPPORT
@@ -55,10 +59,12 @@ using namespace Lua;
 using namespace Tiled;
 
 LuaPlugin::LuaPlugin()
+    : mProgress(0)
 {
 }
 
-bool LuaPlugin::write(const Map *map, const QString &fileName)
+bool LuaPlugin::write(const Map *map, const QString &fileName,
+                      Tiled::ProgressContext *progress)
 {
 #ifdef HAS_QSAVEFILE_SUPPORT
     QSaveFile file(fileName);
@@ -71,12 +77,20 @@ bool LuaPlugin::write(const Map *map, const QString &fileName)
     }
 
     mMapDir = QFileInfo(fileName).path();
+    mProgress = progress;
 
     LuaTableWriter writer(&file);
     writer.writeStartDocument();
     writeMap(writer, map);
     writer.writeEndDocument();
 
+    mProgress = 0;
+
+    if (isCanceled(progress)) {
+        mError = tr("Saving the map was canceled.");
+        return false;
+    }
+
     if (file.error() != QFile::NoError) {
         mError = file.errorString();
         return false;
@@ -157,7 +171,12 @@ void LuaPlugin::writeMap(LuaTableWriter &writer, const Map *map)
     writer.writeEndTable();
 
     writer.writeStartTable("layers");
-    foreach (const Layer *layer, map->layers()) {
+    const int layerCount = map->layerCount();
+    for (int i = 0; i < layerCount; ++i) {
+        if (isCanceled(mProgress))
+            break;
+
+        const Layer *layer = map->layerAt(i);
         switch (layer->layerType()) {
         case Layer::TileLayerType:
             writeTileLayer(writer, static_cast<const TileLayer*>(layer));
@@ -169,6 +188,8 @@ void LuaPlugin::writeMap(LuaTableWriter &writer, const Map *map)
             writeImageLayer(writer, static_cast<const ImageLayer*>(layer));
             break;
         }
+
+        reportProgress(mProgress, i + 1, layerCount);
     }
     writer.writeEndTable();
 
@@ -336,16 +357,55 @@ void LuaPlugin::writeTileLayer(LuaTableWriter &writer,
     writer.writeKeyAndValue("opacity", tileLayer->opacity());
     writeProperties(writer, tileLayer->properties());
 
-    writer.writeKeyAndValue("encoding", "lua");
-    writer.writeStartTable("data");
-    for (int y = 0; y < tileLayer->height(); ++y) {
-        if (y > 0)
-            writer.prepareNewLine();
+    const Map::LayerDataFormat format = tileLayer->map()->layerDataFormat();
+    bool compressed = true;
+    CompressionMethod method = Zlib;
+
+    switch (format) {
+    case Map::Base64:
+        compressed = false;
+        break;
+    case Map::Base64Gzip:
+        method = Gzip;
+        break;
+    default:
+        // The Zstandard and LZ4 formats are not supported by the common Lua
+        // runtimes, so these are written as zlib compressed data instead
+        break;
+    }
+
+    if (format == Map::XML || format == Map::CSV) {
+        writer.writeKeyAndValue("encoding", "lua");
+        writer.writeStartTable("data");
+
+        const QByteArray tileData = LayerExportCache::gids(tileLayer, mGidMapper);
+        const int width = tileLayer->width();
+
+        QVector<unsigned> gids(width);
+        for (int y = 0; y < tileLayer->height(); ++y) {
+            if (y > 0)
+                writer.prepareNewLine();
+
+            for (int x = 0; x < width; ++x)
+                gids[x] = LayerExportCache::gidAt(tileData, x + y * width);
 
-        for (int x = 0; x < tileLayer->width(); ++x)
-            writer.writeValue(mGidMapper.cellToGid(tileLayer->cellAt(x, y)));
+            writer.writeValues(gids.constData(), gids.size());
+        }
+        writer.writeEndTable();
+    } else {
+        QByteArray tileData;
+
+        writer.writeKeyAndValue("encoding", "base64");
+        if (compressed) {
+            tileData = LayerExportCache::compressedGids(tileLayer, mGidMapper,
+                                                        method);
+            writer.writeKeyAndValue("compression",
+                                    method == Gzip ? "gzip" : "zlib");
+        } else {
+            tileData = LayerExportCache::gids(tileLayer, mGidMapper);
+        }
+        writer.writeKeyAndValue("data", tileData.toBase64());
     }
-    writer.writeEndTable();
 
     writer.writeEndTable();
 }
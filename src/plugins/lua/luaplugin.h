@@ -50,14 +50,15 @@ class LUASHARED_EXPORT LuaPlugin : public QObject,
     Q_OBJECT
     Q_INTERFACES(Tiled::MapWriterInterface)
 #if QT_VERSION >= 0x050000
-    Q_PLUGIN_METADATA(IID "org.mapeditor.MapReaderInterface" FILE "plugin.json")
+    Q_PLUGIN_METADATA(IID "org.mapeditor.MapReaderInterface/2" FILE "plugin.json")
 #endif
 
 public:
     LuaPlugin();
 
     // MapWriterInterface
-    bool write(const Tiled::Map *map, const QString &fileName);
+    bool write(const Tiled::Map *map, const QString &fileName,
+               Tiled::ProgressContext *progress = 0);
     QString nameFilter() const;
     QString errorString() const;
 
@@ -73,6 +74,7 @@ private:
 
     QString mError;
     QDir mMapDir;     // The directory in which the map is being saved
+    Tiled::ProgressContext *mProgress;
     Tiled::GidMapper mGidMapper;
 };
 
@@ -20,12 +20,17 @@
 
 #include "luatablewriter.h"
 
+#include "numberutils.h"
+
 #include <QIODevice>
 
+#include <cstring>
+
 namespace Lua {
 
 LuaTableWriter::LuaTableWriter(QIODevice *device)
     : m_device(device)
+    , m_bufferSize(0)
     , m_indent(0)
     , m_valueSeparator(',')
     , m_suppressNewlines(false)
@@ -44,6 +49,7 @@ void LuaTableWriter::writeEndDocument()
 {
     Q_ASSERT(m_indent == 0);
     write('\n');
+    flush();
 }
 
 void LuaTableWriter::writeStartTable()
@@ -83,6 +89,49 @@ void LuaTableWriter::writeEndTable()
     m_valueWritten = true;
 }
 
+void LuaTableWriter::writeValue(int value)
+{
+    prepareNewValue();
+    if (value < 0) {
+        write('-');
+        writeNumber(0u - unsigned(value));
+    } else {
+        writeNumber(value);
+    }
+    m_newLine = false;
+    m_valueWritten = true;
+}
+
+void LuaTableWriter::writeValue(unsigned value)
+{
+    prepareNewValue();
+    writeNumber(value);
+    m_newLine = false;
+    m_valueWritten = true;
+}
+
+/**
+ * Writes \a count unsigned values in one go. This is used for writing out
+ * layer data, where it avoids the overhead of writing each value separately.
+ */
+void LuaTableWriter::writeValues(const unsigned *values, int count)
+{
+    if (count <= 0)
+        return;
+
+    prepareNewValue();
+    writeNumber(values[0]);
+
+    for (int i = 1; i < count; ++i) {
+        const char separator[2] = { m_valueSeparator, ' ' };
+        write(separator, 2);
+        writeNumber(values[i]);
+    }
+
+    m_newLine = false;
+    m_valueWritten = true;
+}
+
 void LuaTableWriter::writeValue(const QByteArray &value)
 {
     prepareNewValue();
@@ -137,6 +186,19 @@ void LuaTableWriter::writeQuotedKeyAndValue(const QString &key,
     m_valueWritten = true;
 }
 
+void LuaTableWriter::writeKeyAndValue(const QByteArray &key, double value)
+{
+    char number[Tiled::MaxNumberLength];
+    const int length = Tiled::formatNumber(value, number);
+
+    prepareNewLine();
+    write(key);
+    write(" = ");
+    write(number, length);
+    m_newLine = false;
+    m_valueWritten = true;
+}
+
 void LuaTableWriter::writeKeyAndUnquotedValue(const QByteArray &key,
                                               const QByteArray &value)
 {
@@ -208,10 +270,49 @@ void LuaTableWriter::writeNewline()
     }
 }
 
-void LuaTableWriter::write(const char *bytes, unsigned length)
+/**
+ * Writes the decimal representation of \a value, without allocating.
+ */
+void LuaTableWriter::writeNumber(unsigned value)
 {
-    if (m_device->write(bytes, length) != length)
+    char digits[10];
+    int i = sizeof(digits);
+    do {
+        digits[--i] = '0' + value % 10;
+        value /= 10;
+    } while (value);
+
+    write(digits + i, sizeof(digits) - i);
+}
+
+/**
+ * Writes the buffered output to the device. This is done automatically when
+ * the buffer is full and at the end of the document.
+ */
+void LuaTableWriter::flush()
+{
+    if (m_bufferSize == 0)
+        return;
+
+    if (m_device->write(m_buffer, m_bufferSize) != m_bufferSize)
         m_error = true;
+
+    m_bufferSize = 0;
+}
+
+void LuaTableWriter::write(const char *bytes, unsigned length)
+{
+    if (m_bufferSize + length > BufferSize)
+        flush();
+
+    if (length > BufferSize) {
+        if (m_device->write(bytes, length) != length)
+            m_error = true;
+        return;
+    }
+
+    std::memcpy(m_buffer + m_bufferSize, bytes, length);
+    m_bufferSize += length;
 }
 
 } // namespace Lua
@@ -46,6 +46,7 @@ public:
 
     void writeValue(int value);
     void writeValue(unsigned value);
+    void writeValues(const unsigned *values, int count);
     void writeValue(const QByteArray &value);
     void writeValue(const QString &value);
 
@@ -68,6 +69,8 @@ public:
 
     void prepareNewLine();
 
+    void flush();
+
     bool hasError() const { return m_error; }
 
     static QString quote(const QString &str);
@@ -77,12 +80,17 @@ private:
     void writeIndent();
 
     void writeNewline();
+    void writeNumber(unsigned value);
     void write(const char *bytes, unsigned length);
     void write(const char *bytes);
     void write(const QByteArray &bytes);
     void write(char c);
 
+    enum { BufferSize = 8192 };
+
     QIODevice *m_device;
+    char m_buffer[BufferSize];
+    unsigned m_bufferSize;
     int m_indent;
     char m_valueSeparator;
     bool m_suppressNewlines;
@@ -91,12 +99,6 @@ private:
     bool m_error;
 };
 
-inline void LuaTableWriter::writeValue(int value)
-{ writeUnquotedValue(QByteArray::number(value)); }
-
-inline void LuaTableWriter::writeValue(unsigned value)
-{ writeUnquotedValue(QByteArray::number(value)); }
-
 inline void LuaTableWriter::writeValue(const QString &value)
 { writeUnquotedValue(quote(value).toUtf8()); }
 
@@ -106,9 +108,6 @@ inline void LuaTableWriter::writeKeyAndValue(const QByteArray &key, int value)
 inline void LuaTableWriter::writeKeyAndValue(const QByteArray &key, unsigned value)
 { writeKeyAndUnquotedValue(key, QByteArray::number(value)); }
 
-inline void LuaTableWriter::writeKeyAndValue(const QByteArray &key, double value)
-{ writeKeyAndUnquotedValue(key, QByteArray::number(value)); }
-
 inline void LuaTableWriter::writeKeyAndValue(const QByteArray &key, bool value)
 { writeKeyAndUnquotedValue(key, value ? "true" : "false"); }
 
@@ -84,6 +84,7 @@ typedef enum _PyBindGenWrapperFlags {
 #include "tilelayer.h"
 #include "objectgroup.h"
 #include "tileset.h"
+#include "gidmapper.h"
 #include <QImage>
 #include <QFileDialog>
 #include <QWidget>
@@ -4672,11 +4673,99 @@ _wrap_PyTiledTileLayer_cellAt(PyTiledTileLayer *self, PyObject *args, PyObject *
     return py_retval;
 }
 
+
+PyObject *
+_wrap_PyTiledTileLayer_gids(PyTiledTileLayer *self)
+{
+    Tiled::TileLayer *layer = self->obj;
+    if (!layer->map()) {
+        PyErr_SetString(PyExc_ValueError, "the layer is not part of a map");
+        return NULL;
+    }
+
+    const Tiled::GidMapper mapper(layer->map()->tilesets());
+    const int width = layer->width();
+    const int height = layer->height();
+
+    PyObject *py_retval = PyByteArray_FromStringAndSize(NULL,
+            (Py_ssize_t) width * height * sizeof(quint32));
+    if (!py_retval)
+        return NULL;
+
+    char *gids = PyByteArray_AS_STRING(py_retval);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            const quint32 gid = mapper.cellToGid(layer->cellAt(x, y));
+            memcpy(gids, &gid, sizeof(quint32));
+            gids += sizeof(quint32);
+        }
+    }
+
+    return py_retval;
+}
+
+
+PyObject *
+_wrap_PyTiledTileLayer_setGids(PyTiledTileLayer *self, PyObject *args, PyObject *kwargs)
+{
+    Py_buffer buffer;
+    const char *keywords[] = {"gids", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, (char *) "s*", (char **) keywords, &buffer)) {
+        return NULL;
+    }
+
+    Tiled::TileLayer *layer = self->obj;
+    const int width = layer->width();
+    const int height = layer->height();
+
+    if (!layer->map()) {
+        PyBuffer_Release(&buffer);
+        PyErr_SetString(PyExc_ValueError, "the layer is not part of a map");
+        return NULL;
+    }
+    if (buffer.len != (Py_ssize_t) width * height * (Py_ssize_t) sizeof(quint32)) {
+        PyBuffer_Release(&buffer);
+        PyErr_SetString(PyExc_ValueError, "expected one 32-bit gid per cell");
+        return NULL;
+    }
+
+    // Map all gids before changing the layer, so that it is left untouched
+    // when one of them is invalid
+    const Tiled::GidMapper mapper(layer->map()->tilesets());
+    const char *gids = (const char *) buffer.buf;
+    QVector<Tiled::Cell> cells(width * height);
+
+    for (int i = 0; i < cells.size(); ++i) {
+        quint32 gid;
+        memcpy(&gid, gids + i * sizeof(quint32), sizeof(quint32));
+
+        bool ok;
+        cells[i] = mapper.gidToCell(gid, ok);
+        if (!ok) {
+            PyBuffer_Release(&buffer);
+            PyErr_Format(PyExc_ValueError, "invalid gid %u at index %d", gid, i);
+            return NULL;
+        }
+    }
+
+    PyBuffer_Release(&buffer);
+
+    for (int y = 0; y < height; ++y)
+        for (int x = 0; x < width; ++x)
+            layer->setCell(x, y, cells.at(y * width + x));
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
 static PyMethodDef PyTiledTileLayer_methods[] = {
     {(char *) "referencesTileset", (PyCFunction) _wrap_PyTiledTileLayer_referencesTileset, METH_KEYWORDS|METH_VARARGS, NULL },
     {(char *) "setCell", (PyCFunction) _wrap_PyTiledTileLayer_setCell, METH_KEYWORDS|METH_VARARGS, NULL },
     {(char *) "isEmpty", (PyCFunction) _wrap_PyTiledTileLayer_isEmpty, METH_NOARGS, NULL },
     {(char *) "cellAt", (PyCFunction) _wrap_PyTiledTileLayer_cellAt, METH_KEYWORDS|METH_VARARGS, NULL },
+    {(char *) "gids", (PyCFunction) _wrap_PyTiledTileLayer_gids, METH_NOARGS, NULL },
+    {(char *) "setGids", (PyCFunction) _wrap_PyTiledTileLayer_setGids, METH_KEYWORDS|METH_VARARGS, NULL },
     {NULL, NULL, 0, NULL}
 };
 
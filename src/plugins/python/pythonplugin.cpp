@@ -20,6 +20,7 @@
 
 #include "pythonplugin.h"
 #include "map.h"
+#include "progresscontext.h"
 
 #include <stdlib.h>
 #include <Python.h>
@@ -51,6 +52,7 @@ PythonPlugin::~PythonPlugin()
 PythonPlugin::PythonPlugin()
     : mScriptDir(QDir::homePath() + "/.tiled")
     , pTiledCls(0)
+    , mLastReload(0)
 {
     if (!Py_IsInitialized()) {
         // PEP370
@@ -203,31 +205,41 @@ bool PythonPlugin::checkFileSupport(PyObject *cls, char *file) const
 }
 
 /**
- * (Re)load modules in the script directory
+ * (Re)load modules in the script directory. Only the scripts that are new or
+ * that were modified since they were last loaded are imported again.
  */
 void PythonPlugin::reloadModules()
 {
-    // try to avoid unnecessary reloading
-    // TODO: mLastReload not initialized
-    if (QDateTime::currentDateTime().toTime_t() - mLastReload < 10)
+    // try to avoid unnecessary rescanning of the script directory
+    const uint now = QDateTime::currentDateTime().toTime_t();
+    if (now - mLastReload < 10)
         return;
 
-    mLastReload = QDateTime::currentDateTime().toTime_t();
+    mLastReload = now;
 
     QStringList pyfilter("*.py");
     QDirIterator iter(mScriptDir, pyfilter, QDir::Files | QDir::Readable);
+    QStringList foundModules;
 
     while (iter.hasNext()) {
         iter.next();
         QString name = iter.fileInfo().baseName();
+        const QDateTime lastModified = iter.fileInfo().lastModified();
+        foundModules.append(name);
+
+        if (mKnownExtModified.contains(name) &&
+                mKnownExtModified.value(name) == lastModified)
+            continue;
+
+        mKnownExtModified.insert(name, lastModified);
+
         PyObject *pmod;
         PyObject *knownModule = mKnownExtModules.take(name);
+        PyObject *moduleClass = mKnownExtClasses.take(name);
+        Py_XDECREF(moduleClass);
 
         if (knownModule) {
             PySys_WriteStdout("-- Reloading %s\n", name.toUtf8().data());
-            PyObject *moduleClass = mKnownExtClasses.take(name);
-            Py_XDECREF(moduleClass);
-
             pmod = PyImport_ReloadModule(knownModule);
             Py_DECREF(knownModule);
         } else {
@@ -255,12 +267,27 @@ void PythonPlugin::reloadModules()
 
         mKnownExtClasses.insert(name, pcls);
     }
+
+    // Forget about the scripts that were removed
+    foreach (const QString &name, mKnownExtModified.keys()) {
+        if (foundModules.contains(name))
+            continue;
+
+        PySys_WriteStdout("-- Unloading %s\n", name.toUtf8().data());
+        mKnownExtModified.remove(name);
+
+        PyObject *moduleClass = mKnownExtClasses.take(name);
+        PyObject *knownModule = mKnownExtModules.take(name);
+        Py_XDECREF(moduleClass);
+        Py_XDECREF(knownModule);
+    }
 }
 
 /**
  * Implements Tiled::MapReaderInterface
  */
-Tiled::Map *PythonPlugin::read(const QString &fileName)
+Tiled::Map *PythonPlugin::read(const QString &fileName,
+                               Tiled::ProgressContext *progress)
 {
     reloadModules();
 
@@ -276,6 +303,10 @@ Tiled::Map *PythonPlugin::read(const QString &fileName)
                     "has @classmethod read(cls, filename)";
             return NULL;
         }
+        if (Tiled::isCanceled(progress)) {
+            mError = "Reading the map was canceled.";
+            return NULL;
+        }
         PyObject *pinst = PyObject_CallMethod(it.value(), (char *)"read",
                                               (char *)"(s)", fileName.toUtf8().data());
 
@@ -288,8 +319,11 @@ Tiled::Map *PythonPlugin::read(const QString &fileName)
         }
         handleError();
 
-        if (ret)
+        if (ret) {
             ret->setProperty("__script__", it.key());
+            // A script can't be interrupted, so it's all or nothing
+            Tiled::reportProgress(progress, 1, 1);
+        }
         return ret;
     }
     return NULL;
@@ -298,7 +332,8 @@ Tiled::Map *PythonPlugin::read(const QString &fileName)
 /**
  * Implements Tiled::MapWriterInterface
  */
-bool PythonPlugin::write(const Tiled::Map *map, const QString &fileName)
+bool PythonPlugin::write(const Tiled::Map *map, const QString &fileName,
+                         Tiled::ProgressContext *progress)
 {
     reloadModules();
     mError = "";
@@ -317,6 +352,11 @@ bool PythonPlugin::write(const Tiled::Map *map, const QString &fileName)
                     "@classmethod write(cls, map, filename)";
             return false;
         }
+        if (Tiled::isCanceled(progress)) {
+            Py_DECREF(pmap);
+            mError = "Saving the map was canceled.";
+            return false;
+        }
         PyObject *pinst = PyObject_CallMethod(it.value(), (char *)"write",
                                               (char *)"(Ns)", pmap, fileName.toUtf8().data());
 
@@ -327,6 +367,7 @@ bool PythonPlugin::write(const Tiled::Map *map, const QString &fileName)
             bool ret = PyObject_IsTrue(pinst);
             Py_DECREF(pinst);
             if (!ret) mError = "Script returned false. Please check console.";
+            else Tiled::reportProgress(progress, 1, 1);
             return ret;
         }
         handleError();
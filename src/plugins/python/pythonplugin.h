@@ -28,6 +28,7 @@
 #include "mapreaderinterface.h"
 #include "logginginterface.h"
 
+#include <QDateTime>
 #include <QMap>
 #include <QObject>
 
@@ -46,8 +47,8 @@ class Q_DECL_EXPORT PythonPlugin
     Q_OBJECT
     Q_INTERFACES(Tiled::MapReaderInterface Tiled::MapWriterInterface Tiled::LoggingInterface)
 #if QT_VERSION >= 0x050000
-    Q_PLUGIN_METADATA(IID "org.mapeditor.MapWriterInterface" FILE "plugin.json")
-    Q_PLUGIN_METADATA(IID "org.mapeditor.MapReaderInterface" FILE "plugin.json")
+    Q_PLUGIN_METADATA(IID "org.mapeditor.MapWriterInterface/2" FILE "plugin.json")
+    Q_PLUGIN_METADATA(IID "org.mapeditor.MapReaderInterface/2" FILE "plugin.json")
     Q_PLUGIN_METADATA(IID "org.mapeditor.LoggingInterface" FILE "plugin.json")
 #endif
 
@@ -64,11 +65,13 @@ public:
     void init_catcher(void);
 
     // MapReaderInterface
-    Tiled::Map *read(const QString &fileName);
+    Tiled::Map *read(const QString &fileName,
+                     Tiled::ProgressContext *progress = 0);
     bool supportsFile(const QString &fileName) const;
 
     // MapWriterInterface
-    bool write(const Tiled::Map *map, const QString &fileName);
+    bool write(const Tiled::Map *map, const QString &fileName,
+               Tiled::ProgressContext *progress = 0);
 
     // Both interfaces
     QStringList nameFilters() const;
@@ -84,6 +87,7 @@ private:
     QString mScriptDir;
     QMap<QString,PyObject*> mKnownExtModules;
     QMap<QString,PyObject*> mKnownExtClasses;
+    QMap<QString,QDateTime> mKnownExtModified;
     PyObject *pTiledCls;
 
     QString mError;
@@ -30,6 +30,7 @@ mod.add_include('"imagelayer.h"')
 mod.add_include('"tilelayer.h"')
 mod.add_include('"objectgroup.h"')
 mod.add_include('"tileset.h"')
+mod.add_include('"gidmapper.h"')
 
 mod.header.writeln('#pragma GCC diagnostic ignored "-Wmissing-field-initializers"')
 
@@ -142,6 +143,104 @@ cls_tilelayer.add_method('referencesTileset', 'bool',
     [param('Tileset*','ts',transfer_ownership=False)])
 cls_tilelayer.add_method('isEmpty', 'bool', [])
 
+"""
+ Bulk access to the cells as global tile IDs, which are stored in a
+ bytearray as one native endian 32-bit unsigned integer per cell, row by row.
+ It can be wrapped without copying, for example with
+ array.array('I', layer.gids()) or numpy.frombuffer(gids, numpy.uint32).
+ setGids accepts any object supporting the buffer protocol.
+"""
+cls_tilelayer.add_custom_method_wrapper('gids',
+    '_wrap_PyTiledTileLayer_gids', flags=['METH_NOARGS'],
+    wrapper_body="""
+PyObject *
+_wrap_PyTiledTileLayer_gids(PyTiledTileLayer *self)
+{
+    Tiled::TileLayer *layer = self->obj;
+    if (!layer->map()) {
+        PyErr_SetString(PyExc_ValueError, "the layer is not part of a map");
+        return NULL;
+    }
+
+    const Tiled::GidMapper mapper(layer->map()->tilesets());
+    const int width = layer->width();
+    const int height = layer->height();
+
+    PyObject *py_retval = PyByteArray_FromStringAndSize(NULL,
+            (Py_ssize_t) width * height * sizeof(quint32));
+    if (!py_retval)
+        return NULL;
+
+    char *gids = PyByteArray_AS_STRING(py_retval);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            const quint32 gid = mapper.cellToGid(layer->cellAt(x, y));
+            memcpy(gids, &gid, sizeof(quint32));
+            gids += sizeof(quint32);
+        }
+    }
+
+    return py_retval;
+}
+""")
+cls_tilelayer.add_custom_method_wrapper('setGids',
+    '_wrap_PyTiledTileLayer_setGids',
+    wrapper_body="""
+PyObject *
+_wrap_PyTiledTileLayer_setGids(PyTiledTileLayer *self, PyObject *args, PyObject *kwargs)
+{
+    Py_buffer buffer;
+    const char *keywords[] = {"gids", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, (char *) "s*", (char **) keywords, &buffer)) {
+        return NULL;
+    }
+
+    Tiled::TileLayer *layer = self->obj;
+    const int width = layer->width();
+    const int height = layer->height();
+
+    if (!layer->map()) {
+        PyBuffer_Release(&buffer);
+        PyErr_SetString(PyExc_ValueError, "the layer is not part of a map");
+        return NULL;
+    }
+    if (buffer.len != (Py_ssize_t) width * height * (Py_ssize_t) sizeof(quint32)) {
+        PyBuffer_Release(&buffer);
+        PyErr_SetString(PyExc_ValueError, "expected one 32-bit gid per cell");
+        return NULL;
+    }
+
+    // Map all gids before changing the layer, so that it is left untouched
+    // when one of them is invalid
+    const Tiled::GidMapper mapper(layer->map()->tilesets());
+    const char *gids = (const char *) buffer.buf;
+    QVector<Tiled::Cell> cells(width * height);
+
+    for (int i = 0; i < cells.size(); ++i) {
+        quint32 gid;
+        memcpy(&gid, gids + i * sizeof(quint32), sizeof(quint32));
+
+        bool ok;
+        cells[i] = mapper.gidToCell(gid, ok);
+        if (!ok) {
+            PyBuffer_Release(&buffer);
+            PyErr_Format(PyExc_ValueError, "invalid gid %u at index %d", gid, i);
+            return NULL;
+        }
+    }
+
+    PyBuffer_Release(&buffer);
+
+    for (int y = 0; y < height; ++y)
+        for (int x = 0; x < width; ++x)
+            layer->setCell(x, y, cells.at(y * width + x));
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+""")
+
 cls_imagelayer = tiled.add_class('ImageLayer')
 cls_imagelayer.add_constructor([('QString','name'), ('int','x'), ('int','y'),
     ('int','w'), ('int','h')])
@@ -30,6 +30,7 @@
 #include <QtEndian>
 #include <QFile>
 #include <QFileInfo>
+#include <QMutexLocker>
 #include <QTemporaryFile>
 
 using namespace ReplicaIsland;
@@ -38,8 +39,11 @@ ReplicaIslandPlugin::ReplicaIslandPlugin()
 {
 }
 
-Tiled::Map *ReplicaIslandPlugin::read(const QString &fileName)
+Tiled::Map *ReplicaIslandPlugin::read(const QString &fileName,
+                                      Tiled::ProgressContext *progress)
 {
+    Q_UNUSED(progress)
+
     using namespace Tiled;
 
     // Read data.
@@ -113,15 +117,21 @@ Tiled::Map *ReplicaIslandPlugin::read(const QString &fileName)
             mError = tr("File ended in middle of layer!");
             return 0;            
         }
-        quint8 *tp = reinterpret_cast<quint8 *>(tileData.data());
+        const quint8 *tp = reinterpret_cast<const quint8 *>(tileData.constData());
+
+        // Look up the tile for each possible id only once. Id 255 means
+        // there is no tile.
+        Tile *tiles[255];
+        for (int id = 0; id < 255; ++id)
+            tiles[id] = tileset->tileAt(id);
 
         // Add the tiles to our layer.
         for (int y = 0; y < height; y++) {
             for (int x = 0; x < width; x++) {
-                quint8 tile_id = *tp++;
+                const quint8 tile_id = *tp++;
                 if (tile_id != 255) {
-                    Tile *tile = tileset->tileAt(tile_id);
-                    layer->setCell(x, y, Cell(tile));
+                    if (Tile *tile = tiles[tile_id])
+                        layer->setCell(x, y, Cell(tile));
                 }
             }
         }
@@ -166,8 +176,22 @@ ReplicaIslandPlugin::loadTilesetFromResource(const QString &name)
 {
     using namespace Tiled;
 
+    // The tilesets are created for each map, but their images are decoded
+    // only once.
+    QImage image;
+    {
+        QMutexLocker locker(&mResourceImagesMutex);
+        QHash<QString, QImage>::const_iterator it = mResourceImages.constFind(name);
+        if (it != mResourceImages.constEnd()) {
+            image = it.value();
+        } else {
+            image = QImage(":/" + name + ".png");
+            mResourceImages.insert(name, image);
+        }
+    }
+
     Tileset *tileset = new Tileset(name, 32, 32);
-    tileset->loadFromImage(QImage(":/" + name + ".png"), name + ".png");
+    tileset->loadFromImage(image, name + ".png");
     return tileset;
 }
 
@@ -230,8 +254,11 @@ QString ReplicaIslandPlugin::errorString() const
 }
 
 // Writer
-bool ReplicaIslandPlugin::write(const Tiled::Map *map, const QString &fileName)
+bool ReplicaIslandPlugin::write(const Tiled::Map *map, const QString &fileName,
+                                Tiled::ProgressContext *progress)
 {
+    Q_UNUSED(progress)
+
     using namespace Tiled;
 
     // Open up a temporary file for saving the level.
@@ -307,15 +334,16 @@ bool ReplicaIslandPlugin::writeLayer(QDataStream &out, Tiled::TileLayer *layer)
 
     // Write out the raw tile data.  We assume that the user has used the
     // correct tileset for this layer.
+    QByteArray tileData(layer->width() * layer->height(), '\xff');
+    char *tp = tileData.data();
     for (int y = 0; y < layer->height(); y++) {
         for (int x = 0; x < layer->width(); x++) {
-            Tile *tile = layer->cellAt(x, y).tile;
-            if (tile)
-                out << static_cast<quint8>(tile->id());
-            else
-                out << static_cast<quint8>(255);
+            if (Tile *tile = layer->cellAt(x, y).tile)
+                *tp = static_cast<char>(tile->id());
+            ++tp;
         }
     }
+    out.writeRawData(tileData.constData(), tileData.size());
 
     return true;
 }
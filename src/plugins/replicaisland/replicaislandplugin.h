@@ -28,6 +28,9 @@
 #include "mapwriterinterface.h"
 #include "mapreaderinterface.h"
 
+#include <QHash>
+#include <QImage>
+#include <QMutex>
 #include <QObject>
 
 namespace Tiled {
@@ -51,8 +54,8 @@ class REPLICAISLANDSHARED_EXPORT ReplicaIslandPlugin :
     Q_INTERFACES(Tiled::MapReaderInterface)
     Q_INTERFACES(Tiled::MapWriterInterface)
 #if QT_VERSION >= 0x050000
-    Q_PLUGIN_METADATA(IID "org.mapeditor.MapReaderInterface" FILE "plugin.json")
-    Q_PLUGIN_METADATA(IID "org.mapeditor.MapWriterInterface" FILE "plugin.json")
+    Q_PLUGIN_METADATA(IID "org.mapeditor.MapReaderInterface/2" FILE "plugin.json")
+    Q_PLUGIN_METADATA(IID "org.mapeditor.MapWriterInterface/2" FILE "plugin.json")
 #endif
 
 public:
@@ -62,17 +65,23 @@ public:
     ReplicaIslandPlugin();
 
     // MapReaderInterface
-    Tiled::Map *read(const QString &fileName);
+    Tiled::Map *read(const QString &fileName,
+                     Tiled::ProgressContext *progress = 0);
     QString nameFilter() const;
     bool supportsFile(const QString &fileName) const;
     QString errorString() const;
 
     // MapWriterInterface
-    bool write(const Tiled::Map *map, const QString &fileName);
+    bool write(const Tiled::Map *map, const QString &fileName,
+               Tiled::ProgressContext *progress = 0);
 
 private:
     QString mError;
 
+    // The decoded resource images, shared by the tilesets of all read maps.
+    QHash<QString, QImage> mResourceImages;
+    QMutex mResourceImagesMutex;
+
     // MapReaderInterface support.
     void loadTilesetsFromResources(Tiled::Map *map,
                                    QList<Tiled::Tileset *> &typeTilesets,
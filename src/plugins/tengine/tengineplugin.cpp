@@ -40,8 +40,11 @@ TenginePlugin::TenginePlugin()
 {
 }
 
-bool TenginePlugin::write(const Tiled::Map *map, const QString &fileName)
+bool TenginePlugin::write(const Tiled::Map *map, const QString &fileName,
+                          Tiled::ProgressContext *progress)
 {
+    Q_UNUSED(progress)
+
     using namespace Tiled;
 
     QFile file(fileName);
@@ -54,7 +57,7 @@ bool TenginePlugin::write(const Tiled::Map *map, const QString &fileName)
     // Write the header
     QString header = map->property("header");
     foreach (const QString &line, header.split("\\n")) {
-        out << line << endl;
+        out << line << '\n';
     }
 
     const int width = map->width();
@@ -79,32 +82,47 @@ bool TenginePlugin::write(const Tiled::Map *map, const QString &fileName)
     Properties emptyTile;
     emptyTile["display"] = "?";
     cachedTiles["?"] = emptyTile;
+    // Maps the properties of a cached tile, leaving out its display string,
+    // to the display string it was cached with first
+    QHash<QString, QString> displayByProperties;
+    displayByProperties.insert(propertiesKey(emptyTile, "display"), "?");
+
+    // Find the layers that provide one of the tile properties up front
+    QList<Layer*> keyedLayers;
+    QList<QString> layerKeys;
+    foreach (Layer *layer, map->layers()) {
+        // If the layer name does not start with one of the tile properties, skip it
+        foreach (const QString &property, propertyOrder) {
+            if (layer->name().startsWith(property, Qt::CaseInsensitive)) {
+                keyedLayers.append(layer);
+                layerKeys.append(property);
+                break;
+            }
+        }
+    }
+
+    // The display and value properties are looked up only once for each tile
+    QHash<const Tile*, QPair<QString, QString> > tileValues;
+
     // Process the map, collecting used display strings as we go
     for (int y = 0; y < height; ++y) {
         for (int x = 0; x < width; ++x) {
-            Properties currentTile = cachedTiles["?"];
-            foreach (Layer *layer, map->layers()) {
-                // If the layer name does not start with one of the tile properties, skip it
-                QString layerKey;
-                QListIterator<QString> propertyIterator = propertyOrder;
-                while (propertyIterator.hasNext()) {
-                    QString currentProperty = propertyIterator.next();
-                    if (layer->name().startsWith(currentProperty, Qt::CaseInsensitive)) {
-                        layerKey = currentProperty;
-                        break;
-                    }
-                }
-                if (layerKey.isEmpty()) {
-                    continue;
-                }
-                TileLayer *tileLayer = layer->asTileLayer();
-                ObjectGroup *objectLayer = layer->asObjectGroup();
+            Properties currentTile = emptyTile;
+            for (int l = 0; l < keyedLayers.size(); ++l) {
+                const QString &layerKey = layerKeys.at(l);
+                TileLayer *tileLayer = keyedLayers.at(l)->asTileLayer();
+                ObjectGroup *objectLayer = keyedLayers.at(l)->asObjectGroup();
                 // Process the Tile Layer
                 if (tileLayer) {
-                    Tile *tile = tileLayer->cellAt(x, y).tile;
+                    const Tile *tile = tileLayer->cellAt(x, y).tile;
                     if (tile) {
-                        currentTile["display"] = tile->property("display");
-                        currentTile[layerKey] = tile->property("value");
+                        QHash<const Tile*, QPair<QString, QString> >::iterator values = tileValues.find(tile);
+                        if (values == tileValues.end()) {
+                            values = tileValues.insert(tile, qMakePair(tile->property("display"),
+                                                                       tile->property("value")));
+                        }
+                        currentTile["display"] = values.value().first;
+                        currentTile[layerKey] = values.value().second;
                     }
                 // Process the Object Layer
                 } else if (objectLayer) {
@@ -127,26 +145,26 @@ bool TenginePlugin::write(const Tiled::Map *map, const QString &fileName)
                     }
                 }
             }
+            QString displayString = currentTile.value("display");
+            i = cachedTiles.constFind(displayString);
             // If the currentTile does not exist in the cache, add it
-            if (!cachedTiles.contains(currentTile["display"])) {
-                cachedTiles[currentTile["display"]] = currentTile;
+            if (i == cachedTiles.constEnd()) {
+                cachedTiles.insert(displayString, currentTile);
+                const QString key = propertiesKey(currentTile, "display");
+                if (!displayByProperties.contains(key))
+                    displayByProperties.insert(key, displayString);
             // Otherwise check that it EXACTLY matches the cached one
             // and if not...
-            } else if (currentTile != cachedTiles[currentTile["display"]]) {
-                // Search the cached tiles for a match
-                bool foundInCache = false;
-                QString displayString;
-                for (i = cachedTiles.constBegin(); i != cachedTiles.constEnd(); ++i) {
-                    displayString = i.key();
+            } else if (currentTile != i.value()) {
+                // Look for a cached tile with the same properties
+                const QString key = propertiesKey(currentTile, "display");
+                QHash<QString, QString>::const_iterator match = displayByProperties.constFind(key);
+                if (match != displayByProperties.constEnd()) {
+                    displayString = match.value();
                     currentTile["display"] = displayString;
-                    if (currentTile == i.value()) {
-                        foundInCache = true;
-                        break;
-                    }
-                }
                 // If we haven't found a match then find a random display string
                 // and cache it
-                if (!foundInCache) {
+                } else {
                     while (true) {
                         // First try to use the ASCII characters
                         if (asciiDisplay < ASCII_MAX) {
@@ -157,18 +175,17 @@ bool TenginePlugin::write(const Tiled::Map *map, const QString &fileName)
                             displayString = QString::number(overflowDisplay);
                             overflowDisplay++;
                         }
-                        currentTile["display"] = displayString;
                         if (!cachedTiles.contains(displayString)) {
-                            cachedTiles[displayString] = currentTile;
-                            break;
-                        } else if (currentTile == cachedTiles[currentTile["display"]]) {
+                            currentTile["display"] = displayString;
+                            cachedTiles.insert(displayString, currentTile);
+                            displayByProperties.insert(key, displayString);
                             break;
                         }
                     }
                 }
             }
             // Check the output type
-            if (currentTile["display"].length() > 1) {
+            if (displayString.length() > 1) {
                 outputLists = true;
             }
             // Check if we are still the emptyTile
@@ -176,11 +193,11 @@ bool TenginePlugin::write(const Tiled::Map *map, const QString &fileName)
                 numEmptyTiles++;
             }
             // Finally add the character to the asciiMap
-            asciiMap.append(currentTile["display"]);
+            asciiMap.append(displayString);
         }
     }
     // Write the definitions to the file
-    out << "-- defineTile section" << endl;
+    out << "-- defineTile section" << '\n';
     for (i = cachedTiles.constBegin(); i != cachedTiles.constEnd(); ++i) {
         QString displayString = i.key();
         // Only print the emptyTile definition if there were empty tiles
@@ -190,15 +207,19 @@ bool TenginePlugin::write(const Tiled::Map *map, const QString &fileName)
         // Need to escape " and \ characters
         displayString.replace(QLatin1Char('\\'), "\\\\");
         displayString.replace(QLatin1Char('"'), "\\\"");
-        QString args = constructArgs(i.value(), propertyOrder);
+        const QString args = constructArgs(i.value(), propertyOrder);
+        out << "defineTile(\"" << displayString << '"';
         if (!args.isEmpty()) {
-            args = QString(", %1").arg(args);
+            out << ", " << args;
         }
-        out << QString("defineTile(\"%1\"%2)").arg(displayString, args) << endl;
+        out << ')' << '\n';
     }
 
+    // Objects with the same properties share their arguments
+    QHash<QString, QString> objectArgs;
+
     // Check for an ObjectGroup named AddSpot
-    out << endl << "-- addSpot section" << endl;
+    out << "\n-- addSpot section" << '\n';
     foreach (Layer *layer, map->layers()) {
         ObjectGroup *objectLayer = layer->asObjectGroup();
         if (objectLayer && objectLayer->name().startsWith("addspot", Qt::CaseInsensitive)) {
@@ -207,13 +228,10 @@ bool TenginePlugin::write(const Tiled::Map *map, const QString &fileName)
                 propertyOrder.append("type");
                 propertyOrder.append("subtype");
                 propertyOrder.append("additional");
-                QString args = constructArgs(obj->properties(), propertyOrder);
-                if (!args.isEmpty()) {
-                    args = QString(", %1").arg(args);
-                }
+                const QString args = cachedArgs(obj->properties(), propertyOrder, objectArgs);
                 for (int y = floor(obj->y()); y <= floor(obj->y() + obj->height()); ++y) {
                     for (int x = floor(obj->x()); x <= floor(obj->x() + obj->width()); ++x) {
-                        out << QString("addSpot({%1, %2}%3)").arg(x).arg(y).arg(args) << endl;
+                        out << "addSpot({" << x << ", " << y << '}' << args << ")\n";
                     }
                 }
             }
@@ -221,7 +239,7 @@ bool TenginePlugin::write(const Tiled::Map *map, const QString &fileName)
     }
 
     // Check for an ObjectGroup named AddZone
-    out << endl << "-- addZone section" << endl;
+    out << "\n-- addZone section" << '\n';
     foreach (Layer *layer, map->layers()) {
         ObjectGroup *objectLayer = layer->asObjectGroup();
         if (objectLayer && objectLayer->name().startsWith("addzone", Qt::CaseInsensitive)) {
@@ -230,15 +248,13 @@ bool TenginePlugin::write(const Tiled::Map *map, const QString &fileName)
                 propertyOrder.append("type");
                 propertyOrder.append("subtype");
                 propertyOrder.append("additional");
-                QString args = constructArgs(obj->properties(), propertyOrder);
-                if (!args.isEmpty()) {
-                    args = QString(", %1").arg(args);
-                }
+                const QString args = cachedArgs(obj->properties(), propertyOrder, objectArgs);
                 int top_left_x = floor(obj->x());
                 int top_left_y = floor(obj->y());
                 int bottom_right_x = floor(obj->x() + obj->width());
                 int bottom_right_y = floor(obj->y() + obj->height());
-                out << QString("addZone({%1, %2, %3, %4}%5)").arg(top_left_x).arg(top_left_y).arg(bottom_right_x).arg(bottom_right_y).arg(args) << endl;
+                out << "addZone({" << top_left_x << ", " << top_left_y << ", "
+                    << bottom_right_x << ", " << bottom_right_y << '}' << args << ")\n";
             }
         }
     }
@@ -268,21 +284,30 @@ bool TenginePlugin::write(const Tiled::Map *map, const QString &fileName)
         itemStop = "";
         seperator = "";
     }
-    out << endl << "-- ASCII map section" << endl;
-    out << "return " << returnStart << endl;
+    out << "\n-- ASCII map section" << '\n';
+    out << "return " << returnStart << '\n';
+    // Each row is built separately and written in one go
+    QString row;
     for (int y = 0; y < height; ++y) {
-        out << lineStart;
+        row.clear();
+        row += lineStart;
         for (int x = 0; x < width; ++x) {
-            out << itemStart << asciiMap[x + (y * width)] << itemStop << seperator;
+            row += itemStart;
+            row += asciiMap.at(x + (y * width));
+            row += itemStop;
+            row += seperator;
         }
+        row += lineStop;
         if (y == height - 1) {
-            out << lineStop << returnStop;
+            row += returnStop;
         } else {
-            out << lineStop << endl;
+            row += QLatin1Char('\n');
         }
+        out << row;
     }
 
     // And close the file
+    out.flush();
     file.close();
     return true;
 }
@@ -297,7 +322,49 @@ QString TenginePlugin::errorString() const
     return mError;
 }
 
-QString TenginePlugin::constructArgs(Tiled::Properties props, QList<QString> propOrder) const
+/**
+ * Returns a string identifying the given \a properties, leaving out the
+ * property named \a skip.
+ */
+static QString propertiesKey(const Tiled::Properties &properties,
+                             const QString &skip = QString())
+{
+    QString key;
+    Tiled::Properties::const_iterator it = properties.constBegin();
+    Tiled::Properties::const_iterator it_end = properties.constEnd();
+    for (; it != it_end; ++it) {
+        if (it.key() == skip)
+            continue;
+        key += it.key();
+        key += QChar(0);
+        key += it.value();
+        key += QChar(0);
+    }
+    return key;
+}
+
+/**
+ * Returns the arguments for \a props prefixed with a comma, or an empty string
+ * when there are none. The arguments are constructed only once for each
+ * distinct set of properties.
+ */
+QString TenginePlugin::cachedArgs(const Tiled::Properties &props,
+                                  const QList<QString> &propOrder,
+                                  QHash<QString, QString> &cache) const
+{
+    const QString key = propertiesKey(props);
+    QHash<QString, QString>::const_iterator it = cache.constFind(key);
+    if (it != cache.constEnd())
+        return it.value();
+
+    QString args = constructArgs(props, propOrder);
+    if (!args.isEmpty())
+        args.prepend(QLatin1String(", "));
+    cache.insert(key, args);
+    return args;
+}
+
+QString TenginePlugin::constructArgs(const Tiled::Properties &props, const QList<QString> &propOrder) const
 {
     QString argString;
     // We work backwards so we don't have to include a bunch of nils
@@ -320,7 +387,7 @@ QString TenginePlugin::constructArgs(Tiled::Properties props, QList<QString> pro
 }
 
 // Finds unhandled properties and bundles them into a Lua table
-QString TenginePlugin::constructAdditionalTable(Tiled::Properties props, QList<QString> propOrder) const
+QString TenginePlugin::constructAdditionalTable(const Tiled::Properties &props, const QList<QString> &propOrder) const
 {
     QString tableString;
     QMap<QString, QString> unhandledProps = QMap<QString, QString>(props);
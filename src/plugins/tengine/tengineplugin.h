@@ -26,6 +26,7 @@
 #include "mapwriterinterface.h"
 #include "properties.h"
 
+#include <QHash>
 #include <QObject>
 
 namespace Tengine {
@@ -39,21 +40,25 @@ class TENGINESHARED_EXPORT TenginePlugin : public QObject,
     Q_OBJECT
     Q_INTERFACES(Tiled::MapWriterInterface)
 #if QT_VERSION >= 0x050000
-    Q_PLUGIN_METADATA(IID "org.mapeditor.MapWriterInterface" FILE "plugin.json")
+    Q_PLUGIN_METADATA(IID "org.mapeditor.MapWriterInterface/2" FILE "plugin.json")
 #endif
 
 public:
     TenginePlugin();
 
     // MapWriterInterface
-    bool write(const Tiled::Map *map, const QString &fileName);
+    bool write(const Tiled::Map *map, const QString &fileName,
+               Tiled::ProgressContext *progress = 0);
     QString nameFilter() const;
     QString errorString() const;
 
 private:
     QString mError;
-    QString constructArgs(Tiled::Properties props, QList<QString> propOrder) const;
-    QString constructAdditionalTable(Tiled::Properties props, QList<QString> propOrder) const;
+    QString cachedArgs(const Tiled::Properties &props,
+                       const QList<QString> &propOrder,
+                       QHash<QString, QString> &cache) const;
+    QString constructArgs(const Tiled::Properties &props, const QList<QString> &propOrder) const;
+    QString constructAdditionalTable(const Tiled::Properties &props, const QList<QString> &propOrder) const;
 };
 
 } // namespace Tengine
@@ -33,8 +33,11 @@ TmwPlugin::TmwPlugin()
 {
 }
 
-bool TmwPlugin::write(const Tiled::Map *map, const QString &fileName)
+bool TmwPlugin::write(const Tiled::Map *map, const QString &fileName,
+                      Tiled::ProgressContext *progress)
 {
+    Q_UNUSED(progress)
+
     using namespace Tiled;
 
     TileLayer *collisionLayer = 0;
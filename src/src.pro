@@ -4,4 +4,6 @@ CONFIG   += ordered
 SUBDIRS = libtiled tiled plugins \
     tmxviewer \
     tmxrasterizer \
+    tmxdiff \
+    tmxlint \
     automappingconverter
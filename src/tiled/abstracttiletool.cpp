@@ -27,6 +27,7 @@
 #include "mapscene.h"
 #include "tile.h"
 #include "tilelayer.h"
+#include "tilesetmanager.h"
 
 #include <cmath>
 
@@ -45,6 +46,9 @@ AbstractTileTool::AbstractTileTool(const QString &name,
 {
     mBrushItem->setVisible(false);
     mBrushItem->setZValue(10000);
+
+    connect(TilesetManager::instance(), SIGNAL(tilesetChanged(Tileset*)),
+            this, SLOT(invalidateBrushCache()));
 }
 
 AbstractTileTool::~AbstractTileTool()
@@ -96,8 +100,26 @@ void AbstractTileTool::mouseMoved(const QPointF &pos, Qt::KeyboardModifiers)
 void AbstractTileTool::mapDocumentChanged(MapDocument *oldDocument,
                                           MapDocument *newDocument)
 {
-    Q_UNUSED(oldDocument)
+    if (oldDocument)
+        oldDocument->disconnect(this, SLOT(invalidateBrushCache()));
+
     mBrushItem->setMapDocument(newDocument);
+
+    // The brush preview needs to be rendered again when the tiles in it may
+    // look different
+    if (newDocument) {
+        connect(newDocument, SIGNAL(mapChanged()),
+                this, SLOT(invalidateBrushCache()));
+        connect(newDocument, SIGNAL(tilesetChanged(Tileset*)),
+                this, SLOT(invalidateBrushCache()));
+        connect(newDocument, SIGNAL(tilesetTileOffsetChanged(Tileset*)),
+                this, SLOT(invalidateBrushCache()));
+    }
+}
+
+void AbstractTileTool::invalidateBrushCache()
+{
+    mBrushItem->invalidateCache();
 }
 
 void AbstractTileTool::updateEnabledState()
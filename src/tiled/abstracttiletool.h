@@ -115,6 +115,9 @@ protected:
      */
     TileLayer *currentTileLayer() const;
 
+private slots:
+    void invalidateBrushCache();
+
 private:
     void setBrushVisible(bool visible);
     void updateBrushVisibility();
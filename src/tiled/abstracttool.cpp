@@ -72,6 +72,8 @@ void AbstractTool::setMapDocument(MapDocument *mapDocument)
     if (mMapDocument) {
         disconnect(mMapDocument, SIGNAL(layerChanged(int)),
                    this, SLOT(updateEnabledState()));
+        disconnect(mMapDocument, SIGNAL(layersChanged(QList<int>)),
+                   this, SLOT(updateEnabledState()));
         disconnect(mMapDocument, SIGNAL(currentLayerIndexChanged(int)),
                    this, SLOT(updateEnabledState()));
     }
@@ -83,6 +85,8 @@ void AbstractTool::setMapDocument(MapDocument *mapDocument)
     if (mMapDocument) {
         connect(mMapDocument, SIGNAL(layerChanged(int)),
                 this, SLOT(updateEnabledState()));
+        connect(mMapDocument, SIGNAL(layersChanged(QList<int>)),
+                this, SLOT(updateEnabledState()));
         connect(mMapDocument, SIGNAL(currentLayerIndexChanged(int)),
                 this, SLOT(updateEnabledState()));
     }
@@ -21,6 +21,7 @@
 #include "addremovetiles.h"
 
 #include "mapdocument.h"
+#include "mapsaver.h"
 #include "tile.h"
 #include "tileset.h"
 
@@ -49,6 +50,7 @@ AddRemoveTiles::~AddRemoveTiles()
 
 void AddRemoveTiles::addTiles()
 {
+    MapSaver::waitForSaves(mTileset);
     mTileset->insertTiles(mIndex, mTiles);
     mTiles.clear();
     mMapDocument->emitTilesetChanged(mTileset);
@@ -56,6 +58,7 @@ void AddRemoveTiles::addTiles()
 
 void AddRemoveTiles::removeTiles()
 {
+    MapSaver::waitForSaves(mTileset);
     mTiles = mTileset->tiles().mid(mIndex, mCount);
     mTileset->removeTiles(mIndex, mCount);
     mMapDocument->emitTilesetChanged(mTileset);
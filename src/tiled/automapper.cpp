@@ -33,12 +33,18 @@
 #include "maprenderer.h"
 #include "object.h"
 #include "objectgroup.h"
+#include "regionbuilder.h"
 #include "tile.h"
 #include "tilelayer.h"
 #include "tileset.h"
 #include "tilesetmanager.h"
+#include "trace.h"
 
 #include <QDebug>
+#include <QHash>
+#include <QRunnable>
+
+#include <algorithm>
 
 using namespace Tiled;
 using namespace Tiled::Internal;
@@ -62,6 +68,8 @@ AutoMapper::AutoMapper(MapDocument *workingDocument, Map *rules,
     , mDeleteTiles(false)
     , mAutoMappingRadius(0)
     , mNoOverlappingRules(false)
+    , mParallelMatching(false)
+    , mCompiledRules(0)
 {
     Q_ASSERT(mMapRules);
 
@@ -80,6 +88,15 @@ AutoMapper::~AutoMapper()
     cleanUpRulesMap();
 }
 
+void AutoMapper::setMapDocument(MapDocument *workingDocument)
+{
+    Q_ASSERT(mAddedTilesets.isEmpty());
+    Q_ASSERT(mAddedTileLayers.isEmpty());
+
+    mMapDocument = workingDocument;
+    mMapWork = workingDocument ? workingDocument->map() : 0;
+}
+
 QSet<QString> AutoMapper::getTouchedTileLayers() const
 {
     return mTouchedTileLayers;
@@ -271,13 +288,66 @@ bool AutoMapper::setupRuleMapTileLayers()
     return true;
 }
 
-static bool compareRuleRegion(const QRegion &r1, const QRegion &r2)
+namespace {
+
+/**
+ * The input and output regions of a single rule, along with the top-left
+ * corner of the area covered by both, by which the rules are sorted.
+ */
+struct RuleRegions
 {
-    const QPoint &p1 = r1.boundingRect().topLeft();
-    const QPoint &p2 = r2.boundingRect().topLeft();
+    QPoint topLeft;
+    RegionBuilder input;
+    RegionBuilder output;
+};
+
+} // anonymous namespace
+
+static bool compareRuleRegions(const RuleRegions *r1, const RuleRegions *r2)
+{
+    const QPoint &p1 = r1->topLeft;
+    const QPoint &p2 = r2->topLeft;
     return p1.y() < p2.y() || (p1.y() == p2.y() && p1.x() < p2.x());
 }
 
+/**
+ * Returns the index of the rectangle in \a rects that contains \a point,
+ * where \a rects are sorted in y-x bands like the rectangles of a QRegion,
+ * or -1 when there is no such rectangle.
+ */
+static int indexOfRectAt(const QVector<QRect> &rects, const QPoint &point)
+{
+    // Find the last band starting at or above the point
+    int first = 0;
+    int last = rects.size();
+    while (first < last) {
+        const int middle = (first + last) / 2;
+        if (rects.at(middle).top() <= point.y())
+            first = middle + 1;
+        else
+            last = middle;
+    }
+    if (first == 0)
+        return -1;
+
+    // Within that band, find the last rectangle starting at or left of it
+    const int top = rects.at(first - 1).top();
+    last = first;
+    first = 0;
+    while (first < last) {
+        const int middle = (first + last) / 2;
+        const QRect &rect = rects.at(middle);
+        if (rect.top() < top || rect.left() <= point.x())
+            first = middle + 1;
+        else
+            last = middle;
+    }
+    if (first == 0 || !rects.at(first - 1).contains(point))
+        return -1;
+
+    return first - 1;
+}
+
 bool AutoMapper::setupRuleList()
 {
     Q_ASSERT(mRulesInput.isEmpty());
@@ -285,38 +355,46 @@ bool AutoMapper::setupRuleList()
     Q_ASSERT(mLayerInputRegions);
     Q_ASSERT(mLayerOutputRegions);
 
-    QList<QRegion> combinedRegions = coherentRegions(
-            mLayerInputRegions->region() +
-            mLayerOutputRegions->region());
-
-    qSort(combinedRegions.begin(), combinedRegions.end(), compareRuleRegion);
+    const QRegion inputRegion = mLayerInputRegions->region();
+    const QRegion outputRegion = mLayerOutputRegions->region();
+    const QVector<QRect> combinedRects = (inputRegion + outputRegion).rects();
 
-    QList<QRegion> rulesInput = coherentRegions(
-            mLayerInputRegions->region());
+    // Each coherent part of the input and output regions is a rule
+    int ruleCount;
+    const QVector<int> ruleIndices = coherentRegionIndices(combinedRects,
+                                                           &ruleCount);
 
-    QList<QRegion> rulesOutput = coherentRegions(
-            mLayerOutputRegions->region());
-
-    for (int i = 0; i < combinedRegions.size(); ++i) {
-        mRulesInput.append(QRegion());
-        mRulesOutput.append(QRegion());
+    QVector<RuleRegions> rules(ruleCount);
+    QVector<QRect> bounds(ruleCount);
+    for (int i = 0; i < combinedRects.size(); ++i) {
+        QRect &rect = bounds[ruleIndices.at(i)];
+        rect = rect.united(combinedRects.at(i));
+    }
+    for (int i = 0; i < ruleCount; ++i)
+        rules[i].topLeft = bounds.at(i).topLeft();
+
+    // Every rectangle of the input and output regions lies within one rule
+    foreach (const QRect &rect, inputRegion.rects()) {
+        const int index = indexOfRectAt(combinedRects, rect.topLeft());
+        Q_ASSERT(index != -1);
+        rules[ruleIndices.at(index)].input.addRect(rect);
+    }
+    foreach (const QRect &rect, outputRegion.rects()) {
+        const int index = indexOfRectAt(combinedRects, rect.topLeft());
+        Q_ASSERT(index != -1);
+        rules[ruleIndices.at(index)].output.addRect(rect);
     }
 
-    foreach(QRegion reg, rulesInput)
-        for (int i = 0; i < combinedRegions.size(); ++i) {
-            if (reg.intersects(combinedRegions[i])) {
-                mRulesInput[i] += reg;
-                break;
-            }
-        }
+    QVector<RuleRegions*> sortedRules(ruleCount);
+    for (int i = 0; i < ruleCount; ++i)
+        sortedRules[i] = &rules[i];
 
-    foreach(QRegion reg, rulesOutput)
-        for (int i = 0; i < combinedRegions.size(); ++i) {
-            if (reg.intersects(combinedRegions[i])) {
-                mRulesOutput[i] += reg;
-                break;
-            }
-        }
+    qStableSort(sortedRules.begin(), sortedRules.end(), compareRuleRegions);
+
+    foreach (RuleRegions *rule, sortedRules) {
+        mRulesInput.append(rule->input.region());
+        mRulesOutput.append(rule->output.region());
+    }
 
     Q_ASSERT(mRulesInput.size() == mRulesOutput.size());
     for (int i = 0; i < mRulesInput.size(); ++i) {
@@ -404,7 +482,9 @@ bool AutoMapper::setupCorrectIndexes()
 // because here mAddedTileset is modified.
 bool AutoMapper::setupTilesets(Map *src, Map *dst)
 {
-    QList<Tileset*> existingTilesets = dst->tilesets();
+    const QSet<Tileset*> existingTilesets = dst->tilesets().toSet();
+    const QHash<TilesetKey, Tileset*> similarTilesets =
+            Tileset::similarityIndex(dst->tilesets());
     TilesetManager *tilesetManager = TilesetManager::instance();
 
     // Add tilesets that are not yet part of dst map
@@ -414,7 +494,7 @@ bool AutoMapper::setupTilesets(Map *src, Map *dst)
 
         QUndoStack *undoStack = mMapDocument->undoStack();
 
-        Tileset *replacement = tileset->findSimilarTileset(existingTilesets);
+        Tileset *replacement = similarTilesets.value(tileset->similarityKey());
         if (!replacement) {
             mAddedTilesets.append(tileset);
             undoStack->push(new AddTileset(mMapDocument, tileset));
@@ -442,8 +522,601 @@ bool AutoMapper::setupTilesets(Map *src, Map *dst)
     return true;
 }
 
+/**
+ * Returns a list of all cells which can be found within all tile layers
+ * within the given region.
+ */
+static QVector<Cell> cellsInRegion(const QVector<TileLayer*> &list,
+                                   const QRegion &r)
+{
+    QVector<Cell> cells;
+    foreach (const TileLayer *tilelayer, list) {
+        foreach (const QRect &rect, r.rects()) {
+            for (int x = rect.left(); x <= rect.right(); ++x) {
+                for (int y = rect.top(); y <= rect.bottom(); ++y) {
+                    const Cell &cell = tilelayer->cellAt(x, y);
+                    if (!cells.contains(cell))
+                        cells.append(cell);
+                }
+            }
+        }
+    }
+    return cells;
+}
+
+namespace {
+
+// Rules are only matched in parallel in areas with at least this many
+// positions, below which starting the threads isn't worth it
+const int MinParallelPositions = 4096;
+
+/**
+ * The cells given by the listYes and listNo layers at one position of the
+ * input region of a rule. Only the non-empty cells are stored.
+ */
+struct PositionPattern
+{
+    QPoint position;
+    QVector<Cell> listYes;
+    QVector<Cell> listNo;
+};
+
+/**
+ * The comparison of a set layer of the working map to its listYes and
+ * listNo layers within the input region of a rule. The cells of the rule
+ * layers are collected once, so that matching only needs to look up the
+ * cells of the set layer.
+ */
+class LayerPattern
+{
+public:
+    LayerPattern()
+        : mSetLayer(0)
+        , mHasListYes(false)
+        , mHasListNo(false)
+        , mNeverMatches(true)
+    {}
+
+    LayerPattern(const TileLayer *setLayer,
+                 const InputIndexName &ruleLayers,
+                 const QRegion &ruleRegion);
+
+    bool matches(const QPoint &offset) const;
+
+    bool neverMatches() const { return mNeverMatches; }
+    bool hasListYes() const { return mHasListYes; }
+    const TileLayer *setLayer() const { return mSetLayer; }
+    const QVector<PositionPattern> &positions() const { return mPositions; }
+
+private:
+    const TileLayer *mSetLayer;
+    bool mHasListYes;
+    bool mHasListNo;
+    bool mNeverMatches;
+    QVector<PositionPattern> mPositions;
+
+    // All cells in the layers of the only list, for the exception below
+    QVector<Cell> mCells;
+};
+
+LayerPattern::LayerPattern(const TileLayer *setLayer,
+                           const InputIndexName &ruleLayers,
+                           const QRegion &ruleRegion)
+    : mSetLayer(setLayer)
+    , mHasListYes(!ruleLayers.listYes.isEmpty())
+    , mHasListNo(!ruleLayers.listNo.isEmpty())
+    , mNeverMatches(false)
+{
+    const QVector<TileLayer*> &listYes = ruleLayers.listYes;
+    const QVector<TileLayer*> &listNo = ruleLayers.listNo;
+
+    if (!mSetLayer || (!mHasListYes && !mHasListNo)) {
+        mNeverMatches = true;
+        return;
+    }
+
+    if (!mHasListYes)
+        mCells = cellsInRegion(listNo, ruleRegion);
+    if (!mHasListNo)
+        mCells = cellsInRegion(listYes, ruleRegion);
+
+    foreach (const QRect &rect, ruleRegion.rects()) {
+        for (int x = rect.left(); x <= rect.right(); ++x) {
+            for (int y = rect.top(); y <= rect.bottom(); ++y) {
+                PositionPattern pattern;
+                pattern.position = QPoint(x, y);
+
+                foreach (const TileLayer *comparedTileLayer, listYes) {
+                    if (!comparedTileLayer->contains(x, y)) {
+                        mNeverMatches = true;
+                        return;
+                    }
+                    const Cell &cell = comparedTileLayer->cellAt(x, y);
+                    if (!cell.isEmpty() && !pattern.listYes.contains(cell))
+                        pattern.listYes.append(cell);
+                }
+                foreach (const TileLayer *comparedTileLayer, listNo) {
+                    if (!comparedTileLayer->contains(x, y)) {
+                        mNeverMatches = true;
+                        return;
+                    }
+                    const Cell &cell = comparedTileLayer->cellAt(x, y);
+                    if (!cell.isEmpty() && !pattern.listNo.contains(cell))
+                        pattern.listNo.append(cell);
+                }
+
+                mPositions.append(pattern);
+            }
+        }
+    }
+}
+
+/**
+ * This function is one of the core functions for understanding the
+ * automapping.
+ * In this function a certain region (of the set layer) is compared to
+ * several other layers (ruleSet and ruleNotSet).
+ * This comparision will determine if a rule of automapping matches,
+ * so if this rule is applied at this region given
+ * by a QRegion and Offset given by a QPoint.
+ *
+ * This compares the tile layer setLayer to several others given
+ * in the QList listYes (ruleSet) and OList listNo (ruleNotSet).
+ * The tile layer setLayer is examined at QRegion ruleRegion + offset
+ * The tile layers within listYes and listNo are examined at QRegion ruleRegion.
+ *
+ * Basically all matches between setLayer and a layer of listYes are considered
+ * good, while all matches between setLayer and listNo are considered bad and
+ * lead to canceling the comparison, returning false.
+ *
+ * The comparison is done for each position within the QRegion ruleRegion.
+ * If all positions of the region are considered "good" return true.
+ *
+ * Now there are several cases to distinguish:
+ *  - both listYes and listNo are empty:
+ *      This should not happen, because with that configuration, absolutely
+ *      no condition is given.
+ *      return false, assuming this is an errornous rule being applied
+ *
+ *  - both listYes and listNo are not empty:
+ *      When comparing a tile at a certain position of tile layer setLayer
+ *      to all available tiles in listYes, there must be at least
+ *      one layer, in which there is a match of tiles of setLayer and
+ *      listYes to consider this position good.
+ *      In listNo there must not be a match to consider this position
+ *      good.
+ *      If there are no tiles within all available tiles within all layers
+ *      of one list, all tiles in setLayer are considered good,
+ *      while inspecting this list.
+ *      All available tiles are all tiles within the whole rule region in
+ *      all tile layers of the list.
+ *
+ *  - either of both lists are not empty
+ *      When comparing a certain position of tile layer setLayer
+ *      to all Tiles at the corresponding position this can happen:
+ *      A tile of setLayer matches a tile of a layer in the list. Then this
+ *      is considered as good, if the layer is from the listYes.
+ *      Otherwise it is considered bad.
+ *
+ *      Exception, when having only the listYes:
+ *      if at the examined position there are no tiles within all Layers
+ *      of the listYes, all tiles except all used tiles within
+ *      the layers of that list are considered good.
+ *
+ *      This exception was added to have a better functionality
+ *      (need of less layers.)
+ *      It was not added to the case, when having only listNo layers to
+ *      avoid total symmetrie between those lists.
+ *
+ * If all positions are considered good, return true.
+ * return false otherwise.
+ *
+ * @return bool, if the tile layer matches the given list of layers.
+ */
+bool LayerPattern::matches(const QPoint &offset) const
+{
+    if (mNeverMatches)
+        return false;
+
+    foreach (const PositionPattern &pattern, mPositions) {
+        const int x = pattern.position.x() + offset.x();
+        const int y = pattern.position.y() + offset.y();
+
+        if (!mSetLayer->contains(x, y))
+            return false;
+
+        const Cell &c1 = mSetLayer->cellAt(x, y);
+
+        // ruleDefined will be set when there is a tile in at least
+        // one layer. if there is a tile in at least one layer, only
+        // the given tiles in the different listYes layers are valid.
+        // if there is given no tile at all in the listYes layers,
+        // consider all tiles valid.
+        const bool ruleDefinedListYes = !pattern.listYes.isEmpty();
+
+        const bool matchListYes = pattern.listYes.contains(c1);
+        const bool matchListNo = pattern.listNo.contains(c1);
+
+        // when there are only layers in the listNo
+        // check only if these layers are unmatched
+        // no need to check explicitly the exception in this case.
+        if (!mHasListYes) {
+            if (matchListNo)
+                return false;
+            else
+                continue;
+        }
+        // when there are only layers in the listYes
+        // check if these layers are matched, or if the exception works
+        if (!mHasListNo) {
+            if (matchListYes)
+                continue;
+            if (!ruleDefinedListYes && !mCells.contains(c1))
+                continue;
+            return false;
+        }
+
+        // there are layers in both lists:
+        // no need to consider ruleDefinedListXXX
+        if ((matchListYes || !ruleDefinedListYes) && !matchListNo)
+            continue;
+        else
+            return false;
+    }
+    return true;
+}
+
+/**
+ * A set layer of the working map along with the rule layers it is
+ * compared to. The set layer is 0 when it doesn't exist in the map.
+ */
+struct InputCondition
+{
+    const TileLayer *setLayer;
+    const InputIndexName *ruleLayers;
+};
+
+// The conditions of one input index, which all need to match
+typedef QVector<InputCondition> InputConditions;
+
+// The compiled conditions of one input index of a rule
+typedef QVector<LayerPattern> IndexPattern;
+
+// The compiled input of a rule, which matches when any of its indexes does
+typedef QVector<IndexPattern> RulePattern;
+
+/**
+ * A position in the input of a rule, where an input index requires the set
+ * layer to contain one of a few cells. The index can only match at offsets
+ * where the set layer has one of these cells at the anchor position, which
+ * is much quicker to check than the whole input of the rule.
+ */
+struct Anchor
+{
+    enum Kind {
+        None,   // The index doesn't require any particular cell
+        Never,  // The index can't match anywhere
+        Cells
+    };
+
+    Anchor() : kind(None), setLayer(0) {}
+
+    bool matches(const QPoint &offset) const
+    {
+        if (kind != Cells)
+            return kind == None;
+
+        const int x = position.x() + offset.x();
+        const int y = position.y() + offset.y();
+        return setLayer->contains(x, y) && cells.contains(setLayer->cellAt(x, y));
+    }
+
+    Kind kind;
+    const TileLayer *setLayer;
+    QPoint position;
+    QVector<Cell> cells;
+};
+
+// The anchors of a rule, one for each input index
+typedef QVector<Anchor> Anchors;
+
+/**
+ * Picks the most selective anchor for an input index from its compiled
+ * \a conditions.
+ */
+Anchor findAnchor(const IndexPattern &conditions)
+{
+    Anchor anchor;
+
+    foreach (const LayerPattern &condition, conditions) {
+        if (condition.neverMatches()) {
+            anchor.kind = Anchor::Never;
+            return anchor;
+        }
+
+        if (!condition.hasListYes())
+            continue;
+
+        // Where any of the listYes layers has a tile, the set layer needs
+        // to have one of those tiles
+        foreach (const PositionPattern &pattern, condition.positions()) {
+            if (pattern.listYes.isEmpty())
+                continue;
+            if (anchor.kind == Anchor::Cells &&
+                    pattern.listYes.size() >= anchor.cells.size())
+                continue;
+
+            anchor.kind = Anchor::Cells;
+            anchor.setLayer = condition.setLayer();
+            anchor.position = pattern.position;
+            anchor.cells = pattern.listYes;
+        }
+    }
+
+    return anchor;
+}
+
+/**
+ * Returns whether any of the input indexes of the rule \a pattern matches
+ * the working map at the given \a offset. The \a anchors of the rule are
+ * checked first.
+ */
+bool ruleMatches(const RulePattern &pattern,
+                 const Anchors &anchors,
+                 const QPoint &offset)
+{
+    for (int i = 0; i < pattern.size(); ++i) {
+        if (!anchors.at(i).matches(offset))
+            continue;
+
+        bool allLayerNamesMatch = true;
+        foreach (const LayerPattern &condition, pattern.at(i)) {
+            if (!condition.matches(offset)) {
+                allLayerNamesMatch = false;
+                break;
+            }
+        }
+        if (allLayerNamesMatch)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * Returns the offsets at which a rule with the bounding rect \a rbr needs
+ * to be tried, for it to overlap \a where.
+ */
+QRect rulePositions(const QRect &rbr, const QRect &where)
+{
+    // Since the rule itself is translated, we need to adjust the borders of
+    // the loops. Decrease the size at all sides by one: There must be at
+    // least one tile overlap to the rule.
+    const int minX = where.left() - rbr.left() - rbr.width() + 1;
+    const int minY = where.top() - rbr.top() - rbr.height() + 1;
+
+    const int maxX = where.right() - rbr.left() + rbr.width() - 1;
+    const int maxY = where.bottom() - rbr.top() + rbr.height() - 1;
+
+    return QRect(QPoint(minX, minY), QPoint(maxX, maxY));
+}
+
+bool lessInScanOrder(const QPoint &a, const QPoint &b)
+{
+    return a.y() < b.y() || (a.y() == b.y() && a.x() < b.x());
+}
+
+/**
+ * Finds out for a band of rows of the \a positions whether the rule
+ * matches there. This only reads from the maps.
+ */
+class RuleMatchTask : public QRunnable
+{
+public:
+    RuleMatchTask(const RulePattern &pattern,
+                  const Anchors &anchors,
+                  const QRect &positions,
+                  int top, int bottom,
+                  QVector<char> *matches)
+        : mPattern(pattern)
+        , mAnchors(anchors)
+        , mPositions(positions)
+        , mTop(top)
+        , mBottom(bottom)
+        , mMatches(matches->data())
+    {}
+
+    void run()
+    {
+        for (int y = mTop; y <= mBottom; ++y) {
+            char *row = mMatches + (y - mPositions.top()) * mPositions.width();
+            for (int x = mPositions.left(); x <= mPositions.right(); ++x)
+                row[x - mPositions.left()] = ruleMatches(mPattern, mAnchors,
+                                                         QPoint(x, y));
+        }
+    }
+
+private:
+    const RulePattern mPattern;
+    const Anchors mAnchors;
+    const QRect mPositions;
+    const int mTop;
+    const int mBottom;
+    char *mMatches;
+};
+
+} // anonymous namespace
+
+/**
+ * The input of all rules, compiled against the set layers of the working
+ * map, with an anchor picked for each of the input indexes of each rule.
+ *
+ * When the rules can't match on their own output, the set layers don't
+ * change while automapping. In that case the rules are also indexed by the
+ * tiles they are anchored on, so that a single pass over the set layers
+ * finds the few positions where each rule could match.
+ */
+struct AutoMapper::CompiledRules
+{
+    struct AnchorRef {
+        int rule;
+        int index;
+    };
+
+    void compile(const InputLayers &inputRules,
+                 const Map *mapWork,
+                 const QList<QRegion> &rulesInput,
+                 bool indexed);
+
+    void findCandidates(const QRect &where,
+                        const QList<QRegion> &rulesInput);
+
+    /**
+     * Returns the offsets where the given rule could match within the area
+     * passed to findCandidates(), or 0 when the rule needs to be tried at
+     * every position.
+     */
+    const QVector<QPoint> *candidates(int ruleIndex) const
+    {
+        if (!indexed || !anchored.at(ruleIndex))
+            return 0;
+        return &candidatesPerRule.at(ruleIndex);
+    }
+
+    QVector<RulePattern> patterns;          // per rule
+    QVector<Anchors> anchors;               // per rule
+    QVector<bool> anchored;                 // whether all indexes of a rule have an anchor
+    bool indexed;
+    QHash<Tile*, QVector<AnchorRef> > rulesByTile;
+    QVector<QVector<QPoint> > candidatesPerRule;
+};
+
+void AutoMapper::CompiledRules::compile(const InputLayers &inputRules,
+                                        const Map *mapWork,
+                                        const QList<QRegion> &rulesInput,
+                                        bool indexed)
+{
+    // Look up the set layers only once, rather than for every rule
+    QVector<InputConditions> indexes;
+    foreach (const QString &index, inputRules.indexes) {
+        const InputIndex &ii = inputRules.constFind(index).value();
+
+        InputConditions conditions;
+        foreach (const QString &name, ii.names) {
+            const int i = mapWork->indexOfLayer(name, Layer::TileLayerType);
+
+            InputCondition condition;
+            condition.setLayer = i == -1 ? 0 : mapWork->layerAt(i)->asTileLayer();
+            condition.ruleLayers = &ii.constFind(name).value();
+            conditions.append(condition);
+        }
+        indexes.append(conditions);
+    }
+
+    this->indexed = indexed;
+    patterns.resize(rulesInput.size());
+    anchors.resize(rulesInput.size());
+    anchored.fill(true, rulesInput.size());
+    candidatesPerRule.resize(rulesInput.size());
+
+    for (int rule = 0; rule < rulesInput.size(); ++rule) {
+        for (int index = 0; index < indexes.size(); ++index) {
+            IndexPattern indexPattern;
+            foreach (const InputCondition &condition, indexes.at(index)) {
+                indexPattern.append(LayerPattern(condition.setLayer,
+                                                 *condition.ruleLayers,
+                                                 rulesInput.at(rule)));
+            }
+            patterns[rule].append(indexPattern);
+
+            const Anchor anchor = findAnchor(indexPattern);
+            anchors[rule].append(anchor);
+
+            if (anchor.kind == Anchor::None)
+                anchored[rule] = false;
+            if (!indexed || anchor.kind != Anchor::Cells)
+                continue;
+
+            AnchorRef ref;
+            ref.rule = rule;
+            ref.index = index;
+
+            QSet<Tile*> tiles;
+            foreach (const Cell &cell, anchor.cells)
+                tiles.insert(cell.tile);
+            foreach (Tile *tile, tiles)
+                rulesByTile[tile].append(ref);
+        }
+    }
+}
+
+void AutoMapper::CompiledRules::findCandidates(const QRect &where,
+                                               const QList<QRegion> &rulesInput)
+{
+    if (!indexed)
+        return;
+
+    QVector<QRect> positions(rulesInput.size());
+    QHash<const TileLayer*, QRect> scanAreas;
+
+    for (int rule = 0; rule < rulesInput.size(); ++rule) {
+        candidatesPerRule[rule].clear();
+        if (!anchored.at(rule))
+            continue;
+
+        positions[rule] = rulePositions(rulesInput.at(rule).boundingRect(),
+                                        where);
+
+        foreach (const Anchor &anchor, anchors.at(rule)) {
+            if (anchor.kind != Anchor::Cells)
+                continue;
+            QRect &area = scanAreas[anchor.setLayer];
+            area |= positions.at(rule).translated(anchor.position);
+        }
+    }
+
+    QHash<const TileLayer*, QRect>::const_iterator it = scanAreas.constBegin();
+    for (; it != scanAreas.constEnd(); ++it) {
+        const TileLayer *setLayer = it.key();
+        const QRect area = it.value() & setLayer->bounds();
+
+        for (int y = area.top(); y <= area.bottom(); ++y) {
+            for (int x = area.left(); x <= area.right(); ++x) {
+                const Cell &cell = setLayer->cellAt(x, y);
+                if (cell.isEmpty())
+                    continue;
+
+                const QHash<Tile*, QVector<AnchorRef> >::const_iterator refs =
+                        rulesByTile.constFind(cell.tile);
+                if (refs == rulesByTile.constEnd())
+                    continue;
+
+                foreach (const AnchorRef &ref, refs.value()) {
+                    const Anchor &anchor = anchors.at(ref.rule).at(ref.index);
+                    if (anchor.setLayer != setLayer || !anchor.cells.contains(cell))
+                        continue;
+
+                    const QPoint offset = QPoint(x, y) - anchor.position;
+                    if (positions.at(ref.rule).contains(offset))
+                        candidatesPerRule[ref.rule].append(offset);
+                }
+            }
+        }
+    }
+
+    // The rules are applied in the same order as when trying all positions,
+    // and only once at positions where several anchors match
+    for (int rule = 0; rule < candidatesPerRule.size(); ++rule) {
+        QVector<QPoint> &candidates = candidatesPerRule[rule];
+        qSort(candidates.begin(), candidates.end(), lessInScanOrder);
+        candidates.erase(std::unique(candidates.begin(), candidates.end()),
+                         candidates.end());
+    }
+}
+
 void AutoMapper::autoMap(QRegion *where)
 {
+    TILED_TRACE_SCOPE("AutoMapper::autoMap");
+
     Q_ASSERT(mRulesInput.size() == mRulesOutput.size());
     // first resize the active area
     if (mAutoMappingRadius) {
@@ -477,18 +1150,48 @@ void AutoMapper::autoMap(QRegion *where)
         }
     }
 
+    // The rules are applied one after another, since each rule may depend
+    // on the output of the previous ones. Only finding the positions where
+    // a rule matches is done in parallel, when possible.
+    const bool staticInput = !outputAffectsInput();
+    mParallelMatching = mThreadPool.maxThreadCount() > 1 && staticInput;
+
+    // Layers are not loaded in a thread-safe way, so the hidden layers that
+    // were not needed so far are loaded before matching on several threads
+    if (mParallelMatching) {
+        foreach (Layer *layer, mMapWork->layers())
+            if (TileLayer *tileLayer = layer->asTileLayer())
+                tileLayer->load();
+    }
+
+    CompiledRules compiledRules;
+    compiledRules.compile(mInputRules, mMapWork, mRulesInput, staticInput);
+    mCompiledRules = &compiledRules;
+
     // Increase the given region where the next automapper should work.
     // This needs to be done, so you can rely on the order of the rules at all
     // locations
     QRegion ret;
-    foreach (const QRect &rect, where->rects())
-        for (int i = 0; i < mRulesInput.size(); ++i) {
-            // at the moment the parallel execution does not work yet
-            // TODO: make multithreading available!
-            // either by dividing the rules or the region to multiple threads
+    foreach (const QRect &rect, where->rects()) {
+        compiledRules.findCandidates(rect, mRulesInput);
+        for (int i = 0; i < mRulesInput.size(); ++i)
             ret = ret.united(applyRule(i, rect));
-        }
+    }
     *where = where->united(ret);
+
+    mCompiledRules = 0;
+}
+
+bool AutoMapper::outputAffectsInput() const
+{
+    foreach (const RuleOutput *translationTable, mLayerList) {
+        foreach (int index, translationTable->values()) {
+            const Layer *layer = mMapWork->layerAt(index);
+            if (layer->isTileLayer() && mInputRules.names.contains(layer->name()))
+                return true;
+        }
+    }
+    return false;
 }
 
 const QRegion AutoMapper::getSetLayersRegion()
@@ -504,13 +1207,10 @@ const QRegion AutoMapper::getSetLayersRegion()
     return result;
 }
 
-static bool compareLayerTo(const TileLayer *setLayer,
-                           const QVector<TileLayer*> &listYes,
-                           const QVector<TileLayer*> &listNo,
-                           const QRegion &ruleRegion, const QPoint &offset);
-
 QRect AutoMapper::applyRule(const int ruleIndex, const QRect &where)
 {
+    TILED_TRACE_SCOPE("AutoMapper::applyRule");
+
     QRect ret;
 
     if (mLayerList.isEmpty())
@@ -520,15 +1220,6 @@ QRect AutoMapper::applyRule(const int ruleIndex, const QRect &where)
     const QRegion ruleOutput = mRulesOutput.at(ruleIndex);
     QRect rbr = ruleInput.boundingRect();
 
-    // Since the rule itself is translated, we need to adjust the borders of the
-    // loops. Decrease the size at all sides by one: There must be at least one
-    // tile overlap to the rule.
-    const int minX = where.left() - rbr.left() - rbr.width() + 1;
-    const int minY = where.top() - rbr.top() - rbr.height() + 1;
-
-    const int maxX = where.right() - rbr.left() + rbr.width() - 1;
-    const int maxY = where.bottom() - rbr.top() + rbr.height() - 1;
-
     // In this list of regions it is stored which parts or the map have already
     // been altered by exactly this rule. We store all the altered parts to
     // make sure there are no overlaps of the same rule applied to
@@ -538,32 +1229,51 @@ QRect AutoMapper::applyRule(const int ruleIndex, const QRect &where)
         for (int i = 0; i < mMapWork->layerCount(); i++)
             appliedRegions.append(QRegion());
 
-    for (int y = minY; y <= maxY; ++y)
-    for (int x = minX; x <= maxX; ++x) {
-        bool anymatch = false;
-        foreach (const QString &index, mInputRules.indexes) {
-            const InputIndex &ii = mInputRules[index];
-
-            bool allLayerNamesMatch = true;
-            foreach (const QString &name, ii.names) {
-                const int i = mMapWork->indexOfLayer(name, Layer::TileLayerType);
-                if (i == -1) {
-                    allLayerNamesMatch = false;
-                } else {
-                    const TileLayer *setLayer = mMapWork->layerAt(i)->asTileLayer();
-                    allLayerNamesMatch &= compareLayerTo(setLayer,
-                                                         ii[name].listYes,
-                                                         ii[name].listNo,
-                                                         ruleInput,
-                                                         QPoint(x, y));
-                }
-            }
-            if (allLayerNamesMatch) {
-                anymatch = true;
-                break;
-            }
+    const RulePattern &pattern = mCompiledRules->patterns.at(ruleIndex);
+    const Anchors &anchors = mCompiledRules->anchors.at(ruleIndex);
+    const QVector<QPoint> *candidates = mCompiledRules->candidates(ruleIndex);
+    const QRect positions = rulePositions(rbr, where);
+
+    // When the output of the rule can't affect where it matches, find all
+    // matching positions in parallel first. The rule is then applied in the
+    // same order as when matching one position after another. This is not
+    // needed when only a few candidate positions were found.
+    QVector<char> matches;
+
+    if (!candidates && mParallelMatching && !positions.isEmpty() &&
+            positions.width() * positions.height() >= MinParallelPositions) {
+        matches.resize(positions.width() * positions.height());
+
+        const int bandCount = mThreadPool.maxThreadCount() * 4;
+        const int bandHeight = qMax(1, (positions.height() + bandCount - 1) / bandCount);
+
+        for (int top = positions.top(); top <= positions.bottom(); top += bandHeight) {
+            const int bottom = qMin(positions.bottom(), top + bandHeight - 1);
+            mThreadPool.start(new RuleMatchTask(pattern, anchors, positions,
+                                                top, bottom, &matches));
         }
 
+        mThreadPool.waitForDone();
+    }
+
+    int count = 0;
+    if (candidates)
+        count = candidates->size();
+    else if (!positions.isEmpty())
+        count = positions.width() * positions.height();
+
+    for (int n = 0; n < count; ++n) {
+        const QPoint offset = candidates
+                ? candidates->at(n)
+                : QPoint(positions.left() + n % positions.width(),
+                         positions.top() + n / positions.width());
+        const int x = offset.x();
+        const int y = offset.y();
+
+        const bool anymatch = matches.isEmpty()
+                ? ruleMatches(pattern, anchors, offset)
+                : matches.at(n);
+
         if (anymatch) {
             int r = 0;
             // choose by chance which group of rule_layers should be used:
@@ -614,180 +1324,6 @@ QRect AutoMapper::applyRule(const int ruleIndex, const QRect &where)
     return ret;
 }
 
-/**
- * Returns a list of all cells which can be found within all tile layers
- * within the given region.
- */
-static QVector<Cell> cellsInRegion(const QVector<TileLayer*> &list,
-                                   const QRegion &r)
-{
-    QVector<Cell> cells;
-    foreach (const TileLayer *tilelayer, list) {
-        foreach (const QRect &rect, r.rects()) {
-            for (int x = rect.left(); x <= rect.right(); ++x) {
-                for (int y = rect.top(); y <= rect.bottom(); ++y) {
-                    const Cell &cell = tilelayer->cellAt(x, y);
-                    if (!cells.contains(cell))
-                        cells.append(cell);
-                }
-            }
-        }
-    }
-    return cells;
-}
-
-/**
- * This function is one of the core functions for understanding the
- * automapping.
- * In this function a certain region (of the set layer) is compared to
- * several other layers (ruleSet and ruleNotSet).
- * This comparision will determine if a rule of automapping matches,
- * so if this rule is applied at this region given
- * by a QRegion and Offset given by a QPoint.
- *
- * This compares the tile layer setLayer to several others given
- * in the QList listYes (ruleSet) and OList listNo (ruleNotSet).
- * The tile layer setLayer is examined at QRegion ruleRegion + offset
- * The tile layers within listYes and listNo are examined at QRegion ruleRegion.
- *
- * Basically all matches between setLayer and a layer of listYes are considered
- * good, while all matches between setLayer and listNo are considered bad and
- * lead to canceling the comparison, returning false.
- *
- * The comparison is done for each position within the QRegion ruleRegion.
- * If all positions of the region are considered "good" return true.
- *
- * Now there are several cases to distinguish:
- *  - both listYes and listNo are empty:
- *      This should not happen, because with that configuration, absolutely
- *      no condition is given.
- *      return false, assuming this is an errornous rule being applied
- *
- *  - both listYes and listNo are not empty:
- *      When comparing a tile at a certain position of tile layer setLayer
- *      to all available tiles in listYes, there must be at least
- *      one layer, in which there is a match of tiles of setLayer and
- *      listYes to consider this position good.
- *      In listNo there must not be a match to consider this position
- *      good.
- *      If there are no tiles within all available tiles within all layers
- *      of one list, all tiles in setLayer are considered good,
- *      while inspecting this list.
- *      All available tiles are all tiles within the whole rule region in
- *      all tile layers of the list.
- *
- *  - either of both lists are not empty
- *      When comparing a certain position of tile layer setLayer
- *      to all Tiles at the corresponding position this can happen:
- *      A tile of setLayer matches a tile of a layer in the list. Then this
- *      is considered as good, if the layer is from the listYes.
- *      Otherwise it is considered bad.
- *
- *      Exception, when having only the listYes:
- *      if at the examined position there are no tiles within all Layers
- *      of the listYes, all tiles except all used tiles within
- *      the layers of that list are considered good.
- *
- *      This exception was added to have a better functionality
- *      (need of less layers.)
- *      It was not added to the case, when having only listNo layers to
- *      avoid total symmetrie between those lists.
- *
- * If all positions are considered good, return true.
- * return false otherwise.
- *
- * @return bool, if the tile layer matches the given list of layers.
- */
-static bool compareLayerTo(const TileLayer *setLayer,
-                           const QVector<TileLayer*> &listYes,
-                           const QVector<TileLayer*> &listNo,
-                           const QRegion &ruleRegion, const QPoint &offset)
-{
-    if (listYes.isEmpty() && listNo.isEmpty())
-        return false;
-
-    QVector<Cell> cells;
-    if (listYes.isEmpty())
-        cells = cellsInRegion(listNo, ruleRegion);
-    if (listNo.isEmpty())
-        cells = cellsInRegion(listYes, ruleRegion);
-
-    foreach (const QRect &rect, ruleRegion.rects()) {
-        for (int x = rect.left(); x <= rect.right(); ++x) {
-            for (int y = rect.top(); y <= rect.bottom(); ++y) {
-                // this is only used in the case where only one list has layers
-                // it is needed for the exception mentioned above
-                bool ruleDefinedListYes = false;
-
-                bool matchListYes = false;
-                bool matchListNo  = false;
-
-                if (!setLayer->contains(x + offset.x(), y + offset.y()))
-                    return false;
-
-                const Cell &c1 = setLayer->cellAt(x + offset.x(),
-                                                  y + offset.y());
-
-                // ruleDefined will be set when there is a tile in at least
-                // one layer. if there is a tile in at least one layer, only
-                // the given tiles in the different listYes layers are valid.
-                // if there is given no tile at all in the listYes layers,
-                // consider all tiles valid.
-
-                foreach (const TileLayer *comparedTileLayer, listYes) {
-
-                    if (!comparedTileLayer->contains(x, y))
-                        return false;
-
-                    const Cell &c2 = comparedTileLayer->cellAt(x, y);
-                    if (!c2.isEmpty())
-                        ruleDefinedListYes = true;
-
-                    if (!c2.isEmpty() && c1 == c2)
-                        matchListYes = true;
-                }
-                foreach (const TileLayer *comparedTileLayer, listNo) {
-
-                    if (!comparedTileLayer->contains(x, y))
-                        return false;
-
-                    const Cell &c2 = comparedTileLayer->cellAt(x, y);
-
-                    if (!c2.isEmpty() && c1 == c2)
-                        matchListNo = true;
-                }
-
-                // when there are only layers in the listNo
-                // check only if these layers are unmatched
-                // no need to check explicitly the exception in this case.
-                if (listYes.isEmpty()) {
-                    if (matchListNo)
-                        return false;
-                    else
-                        continue;
-                }
-                // when there are only layers in the listYes
-                // check if these layers are matched, or if the exception works
-                if (listNo.isEmpty()) {
-                    if (matchListYes)
-                        continue;
-                    if (!ruleDefinedListYes && !cells.contains(c1))
-                        continue;
-                    return false;
-                }
-
-                // there are layers in both lists:
-                // no need to consider ruleDefinedListXXX
-                if ((matchListYes || !ruleDefinedListYes) && !matchListNo)
-                    continue;
-                else
-                    return false;
-            }
-        }
-    }
-    return true;
-}
-
 void AutoMapper::copyMapRegion(const QRegion &region, QPoint offset,
                                const RuleOutput *layerTranslation)
 {
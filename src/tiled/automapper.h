@@ -28,6 +28,7 @@
 
 #include <QSet>
 #include <QString>
+#include <QThreadPool>
 #include <QVector>
 
 namespace Tiled {
@@ -96,6 +97,13 @@ public:
                const QString &rulePath);
     ~AutoMapper();
 
+    /**
+     * Sets the map document to work on. The data structures that depend on
+     * the working map are set up again by prepareAutoMap(), so an AutoMapper
+     * can be reused for another map document.
+     */
+    void setMapDocument(MapDocument *workingDocument);
+
     /**
      * Checks if the passed \a ruleLayerName is used in this instance 
      * of Automapper.
@@ -142,6 +150,8 @@ public:
     QString warningString() const { return mWarning; }
 
 private:
+    struct CompiledRules;
+
     /**
      * Reads the map properties of the rulesmap.
      * @return returns true when anything is ok, false when errors occured.
@@ -237,6 +247,13 @@ private:
      */
     QRect applyRule(const int ruleIndex, const QRect &where);
 
+    /**
+     * Returns whether any of the layers written by the rules is also used
+     * as an input layer. In that case a rule may match on its own output,
+     * and the positions need to be matched one after another.
+     */
+    bool outputAffectsInput() const;
+
     /**
      * Cleans up the data structes filled by setupRuleMapLayers(),
      * so the next rule can be processed.
@@ -354,6 +371,21 @@ private:
      */
     bool mNoOverlappingRules;
 
+    /**
+     * Determines whether the positions a rule matches at are found by
+     * multiple threads, before the rule is applied at those positions.
+     * Only possible when the output of the rules doesn't affect their
+     * input. Set up by autoMap().
+     */
+    bool mParallelMatching;
+    QThreadPool mThreadPool;
+
+    /**
+     * The input of the rules in a form that is quicker to match, along with
+     * the positions where each rule could match. Only valid during autoMap().
+     */
+    CompiledRules *mCompiledRules;
+
     QSet<QString> mTouchedTileLayers;
 
     QSet<QString> mTouchedObjectGroups;
@@ -25,12 +25,15 @@
 #include "tile.h"
 #include "tilelayer.h"
 
+#include <QHash>
+
 using namespace Tiled;
 using namespace Tiled::Internal;
 
 AutoMapperWrapper::AutoMapperWrapper(MapDocument *mapDocument,
                                      QVector<AutoMapper*> autoMapper,
-                                     QRegion *where)
+                                     QRegion *where,
+                                     const QString &touchedLayerName)
 {
     mMapDocument = mapDocument;
     Map *map = mMapDocument->map();
@@ -52,8 +55,30 @@ AutoMapperWrapper::AutoMapperWrapper(MapDocument *mapDocument,
         mLayersBefore << static_cast<TileLayer*>(map->layerAt(layerindex)->clone());
     }
 
-    foreach (AutoMapper *a, autoMapper)
-        a->autoMap(where);
+    if (touchedLayerName.isEmpty()) {
+        foreach (AutoMapper *a, autoMapper)
+            a->autoMap(where);
+    } else {
+        QHash<QString, QRegion> changedRegions;
+        changedRegions.insert(touchedLayerName, *where);
+
+        foreach (AutoMapper *a, autoMapper) {
+            QRegion region;
+            QHash<QString, QRegion>::const_iterator it = changedRegions.constBegin();
+            for (; it != changedRegions.constEnd(); ++it)
+                if (a->ruleLayerNameUsed(it.key()))
+                    region |= it.value();
+
+            if (region.isEmpty())
+                continue;
+
+            a->autoMap(&region);
+
+            foreach (const QString &layerName, a->getTouchedTileLayers())
+                changedRegions[layerName] |= region;
+            *where |= region;
+        }
+    }
 
     foreach (const QString &layerName, touchedLayers) {
         const int layerindex = map->indexOfLayer(layerName);
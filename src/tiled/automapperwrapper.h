@@ -42,8 +42,17 @@ class MapDocument;
 class AutoMapperWrapper : public QUndoCommand
 {
 public:
+    /**
+     * Applies the \a autoMapper in order to the region \a where, which is
+     * extended by the regions the automappers worked on.
+     *
+     * When \a touchedLayerName is given, only that layer was edited. Each
+     * automapper then only works on the changed parts of the layers it reads,
+     * changed either by the edit or by the automappers before it.
+     */
     AutoMapperWrapper(MapDocument *mapDocument, QVector<AutoMapper*> autoMapper,
-                      QRegion *where);
+                      QRegion *where,
+                      const QString &touchedLayerName = QString());
     ~AutoMapperWrapper();
 
     void undo();
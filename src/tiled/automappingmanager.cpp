@@ -44,6 +44,9 @@ AutomappingManager::AutomappingManager(QObject *parent)
 AutomappingManager::~AutomappingManager()
 {
     cleanUp();
+
+    foreach (const CachedAutoMapper &cached, mAutoMapperCache)
+        delete cached.autoMapper;
 }
 
 void AutomappingManager::autoMap()
@@ -55,6 +58,11 @@ void AutomappingManager::autoMap()
     int w = map->width();
     int h = map->height();
 
+    // Look at the rules again, to pick up any changes to them. Rule maps
+    // that didn't change are not loaded again.
+    cleanUp();
+    mLoaded = false;
+
     autoMapInternal(QRect(0, 0, w, h), 0);
 }
 
@@ -75,8 +83,11 @@ void AutomappingManager::autoMapInternal(const QRegion &where,
     const bool automatic = touchedLayer != 0;
 
     if (!mLoaded) {
-        const QString mapPath = QFileInfo(mMapDocument->fileName()).path();
-        const QString rulesFileName = mapPath + QLatin1String("/rules.txt");
+        QString rulesFileName = mRulesFile;
+        if (rulesFileName.isEmpty()) {
+            const QString mapPath = QFileInfo(mMapDocument->fileName()).path();
+            rulesFileName = mapPath + QLatin1String("/rules.txt");
+        }
         if (loadFile(rulesFileName)) {
             mLoaded = true;
         } else {
@@ -89,11 +100,28 @@ void AutomappingManager::autoMapInternal(const QRegion &where,
     // following automappers do see the impact
     QRegion *passedRegion = new QRegion(where);
 
+    // When a layer was edited, only the automappers reading that layer are
+    // used, along with those reading the output of the used automappers.
     QVector<AutoMapper*> passedAutoMappers;
+    QString touchedLayerName;
     if (touchedLayer) {
+        touchedLayerName = touchedLayer->name();
+
+        QSet<QString> changedLayers;
+        changedLayers.insert(touchedLayerName);
+
         foreach (AutoMapper *a, mAutoMappers) {
-            if (a->ruleLayerNameUsed(touchedLayer->name()))
+            bool readsChangedLayer = false;
+            foreach (const QString &layerName, changedLayers) {
+                if (a->ruleLayerNameUsed(layerName)) {
+                    readsChangedLayer = true;
+                    break;
+                }
+            }
+            if (readsChangedLayer) {
                 passedAutoMappers.append(a);
+                changedLayers |= a->getTouchedTileLayers();
+            }
         }
     } else {
         passedAutoMappers = mAutoMappers;
@@ -101,7 +129,8 @@ void AutomappingManager::autoMapInternal(const QRegion &where,
     if (!passedAutoMappers.isEmpty()) {
         QUndoStack *undoStack = mMapDocument->undoStack();
         undoStack->beginMacro(tr("Apply AutoMap rules"));
-        AutoMapperWrapper *aw = new AutoMapperWrapper(mMapDocument, passedAutoMappers, passedRegion);
+        AutoMapperWrapper *aw = new AutoMapperWrapper(mMapDocument, passedAutoMappers,
+                                                      passedRegion, touchedLayerName);
         undoStack->push(aw);
         undoStack->endMacro();
     }
@@ -156,31 +185,10 @@ bool AutomappingManager::loadFile(const QString &filePath)
             continue;
         }
         if (rulePath.endsWith(QLatin1String(".tmx"), Qt::CaseInsensitive)) {
-            TmxMapReader mapReader;
-
-            Map *rules = mapReader.read(rulePath);
-
-            if (!rules) {
-                mError += tr("Opening rules map failed:\n%1").arg(
-                        mapReader.errorString()) + QLatin1Char('\n');
-                ret = false;
-                continue;
-            }
-
-            TilesetManager *tilesetManager = TilesetManager::instance();
-            tilesetManager->addReferences(rules->tilesets());
-
-            AutoMapper *autoMapper;
-            autoMapper = new AutoMapper(mMapDocument, rules, rulePath);
-
-            mWarning += autoMapper->warningString();
-            const QString error = autoMapper->errorString(); 
-            if (error.isEmpty()) {
+            if (AutoMapper *autoMapper = autoMapperForRuleMap(rulePath))
                 mAutoMappers.append(autoMapper);
-            } else {
-                mError += error;
-                delete autoMapper;
-            }
+            else
+                ret = false;
         }
         if (rulePath.endsWith(QLatin1String(".txt"), Qt::CaseInsensitive)) {
             if (!loadFile(rulePath))
@@ -190,6 +198,68 @@ bool AutomappingManager::loadFile(const QString &filePath)
     return ret;
 }
 
+AutoMapper *AutomappingManager::autoMapperForRuleMap(const QString &rulePath)
+{
+    const QFileInfo fileInfo(rulePath);
+    const QString key = fileInfo.canonicalFilePath();
+    const QDateTime lastModified = fileInfo.lastModified();
+
+    QHash<QString, CachedAutoMapper>::iterator it = mAutoMapperCache.find(key);
+    if (it != mAutoMapperCache.end()) {
+        if (it->lastModified == lastModified && !mAutoMappers.contains(it->autoMapper)) {
+            it->autoMapper->setMapDocument(mMapDocument);
+            mWarning += it->warning;
+            return it->autoMapper;
+        }
+
+        // Rule maps that changed are loaded again. Rule maps used more than
+        // once need their own AutoMapper, which is not cached.
+        if (it->lastModified != lastModified) {
+            if (mAutoMappers.contains(it->autoMapper))
+                mUncachedAutoMappers.append(it->autoMapper);
+            else
+                delete it->autoMapper;
+            mAutoMapperCache.erase(it);
+        }
+    }
+
+    TmxMapReader mapReader;
+
+    Map *rules = mapReader.read(rulePath);
+
+    if (!rules) {
+        mError += tr("Opening rules map failed:\n%1").arg(
+                mapReader.errorString()) + QLatin1Char('\n');
+        return 0;
+    }
+
+    TilesetManager *tilesetManager = TilesetManager::instance();
+    tilesetManager->addReferences(rules->tilesets());
+
+    AutoMapper *autoMapper;
+    autoMapper = new AutoMapper(mMapDocument, rules, rulePath);
+
+    mWarning += autoMapper->warningString();
+    const QString error = autoMapper->errorString();
+    if (!error.isEmpty()) {
+        mError += error;
+        delete autoMapper;
+        return 0;
+    }
+
+    if (!mAutoMapperCache.contains(key)) {
+        CachedAutoMapper cached;
+        cached.lastModified = lastModified;
+        cached.autoMapper = autoMapper;
+        cached.warning = autoMapper->warningString();
+        mAutoMapperCache.insert(key, cached);
+    } else {
+        mUncachedAutoMappers.append(autoMapper);
+    }
+
+    return autoMapper;
+}
+
 void AutomappingManager::setMapDocument(MapDocument *mapDocument)
 {
     cleanUp();
@@ -208,6 +278,8 @@ void AutomappingManager::setMapDocument(MapDocument *mapDocument)
 
 void AutomappingManager::cleanUp()
 {
-    qDeleteAll(mAutoMappers);
+    // The cached AutoMappers are kept for later use
     mAutoMappers.clear();
+    qDeleteAll(mUncachedAutoMappers);
+    mUncachedAutoMappers.clear();
 }
@@ -21,6 +21,8 @@
 #ifndef AUTOMAPPINGMANAGER_H
 #define AUTOMAPPINGMANAGER_H
 
+#include <QDateTime>
+#include <QHash>
 #include <QObject>
 #include <QRegion>
 #include <QString>
@@ -53,6 +55,12 @@ public:
 
     void setMapDocument(MapDocument *mapDocument);
 
+    /**
+     * Sets the rules file to use. By default, the rules.txt file next to the
+     * map of the current map document is used.
+     */
+    void setRulesFile(const QString &fileName) { mRulesFile = fileName; }
+
     QString errorString() const { return mError; }
 
     QString warningString() const { return mWarning; }
@@ -101,6 +109,14 @@ private:
      */
     void autoMapInternal(const QRegion &where, Layer *touchedLayer);
 
+    /**
+     * Returns the AutoMapper for the rule map at \a rulePath, set up to work
+     * on the current map document. The AutoMapper is reused when the rule
+     * map was loaded before and its file didn't change since then. Returns 0
+     * when the rule map could not be loaded.
+     */
+    AutoMapper *autoMapperForRuleMap(const QString &rulePath);
+
     /**
      * deletes all its data structures
      */
@@ -117,6 +133,35 @@ private:
      */
     QVector<AutoMapper*> mAutoMappers;
 
+    /**
+     * An AutoMapper set up for a rule map, along with the time the file of
+     * the rule map was last modified and the warnings raised while loading.
+     */
+    struct CachedAutoMapper
+    {
+        QDateTime lastModified;
+        AutoMapper *autoMapper;
+        QString warning;
+    };
+
+    /**
+     * The AutoMappers of all rule maps loaded so far, by file path. Setting
+     * up an AutoMapper means reading the rule map and scanning its layers,
+     * which is avoided when switching map documents or reloading the rules.
+     */
+    QHash<QString, CachedAutoMapper> mAutoMapperCache;
+
+    /**
+     * AutoMappers for rule maps that are used more than once, which are
+     * owned by this list instead of the cache.
+     */
+    QVector<AutoMapper*> mUncachedAutoMappers;
+
+    /**
+     * The rules file set with setRulesFile(), if any.
+     */
+    QString mRulesFile;
+
     /**
      * This tells you if the rules for the current map document were already
      * loaded.
@@ -79,7 +79,7 @@ const QList<MapObject*> objectsInRegion(ObjectGroup *layer,
                                         const QRegion &where)
 {
     QList<MapObject*> ret;
-    foreach (MapObject *obj, layer->objects()) {
+    foreach (MapObject *obj, layer->objectsIn(where.boundingRect())) {
         // TODO: we are checking bounds, which is only correct for rectangles and
         // tile objects. polygons and polylines are not covered correctly by this
         // erase method (we are in fact deleting too many objects)
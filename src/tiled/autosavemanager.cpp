@@ -0,0 +1,178 @@
+/*
+ * maploader.cpp
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "autosavemanager.h"
+
+#include "documentmanager.h"
+#include "mapdocument.h"
+#include "preferences.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QTimer>
+#include <QUndoStack>
+
+#if QT_VERSION >= 0x050000
+#include <QStandardPaths>
+#else
+#include <QDesktopServices>
+#endif
+
+using namespace Tiled;
+using namespace Tiled::Internal;
+
+AutosaveManager::AutosaveManager(QObject *parent)
+    : QObject(parent)
+    , mTimer(new QTimer(this))
+{
+    connect(mTimer, SIGNAL(timeout()), SLOT(autosave()));
+
+    Preferences *prefs = Preferences::instance();
+    setInterval(prefs->autosaveInterval());
+    connect(prefs, SIGNAL(autosaveIntervalChanged(int)),
+            SLOT(setInterval(int)));
+
+    connect(DocumentManager::instance(),
+            SIGNAL(documentAboutToClose(MapDocument*)),
+            SLOT(documentAboutToClose(MapDocument*)));
+}
+
+QString AutosaveManager::recoveryDirectory()
+{
+#if QT_VERSION >= 0x050000
+    const QString dataLocation =
+            QStandardPaths::writableLocation(QStandardPaths::DataLocation);
+#else
+    const QString dataLocation =
+            QDesktopServices::storageLocation(QDesktopServices::DataLocation);
+#endif
+
+    if (dataLocation.isEmpty())
+        return QString();
+
+    return dataLocation + QLatin1String("/recovery");
+}
+
+QStringList AutosaveManager::recoveryFiles()
+{
+    const QString directory = recoveryDirectory();
+    if (directory.isEmpty())
+        return QStringList();
+
+    QStringList fileNames;
+    const QDir dir(directory);
+    const QStringList filters(QLatin1String("*.tmx"));
+    foreach (const QString &name, dir.entryList(filters, QDir::Files))
+        fileNames.append(dir.filePath(name));
+    return fileNames;
+}
+
+void AutosaveManager::removeRecoveryFiles(const QStringList &fileNames)
+{
+    foreach (const QString &fileName, fileNames)
+        QFile::remove(fileName);
+}
+
+void AutosaveManager::setInterval(int minutes)
+{
+    if (minutes > 0)
+        mTimer->start(minutes * 60 * 1000);
+    else
+        mTimer->stop();
+}
+
+void AutosaveManager::autosave()
+{
+    const QString directory = recoveryDirectory();
+    if (directory.isEmpty() || !QDir().mkpath(directory))
+        return;
+
+    foreach (MapDocument *mapDocument, DocumentManager::instance()->documents()) {
+        // Once saved, the autosaved copy is no longer needed
+        if (!mapDocument->isModified()) {
+            removeRecoveryFile(mapDocument);
+            continue;
+        }
+
+        if (mapDocument->isSaving())
+            continue;
+
+        const QUndoStack *undoStack = mapDocument->undoStack();
+        const int index = undoStack->index();
+        const QUndoCommand *command = index > 0 ? undoStack->command(index - 1)
+                                                : 0;
+
+        // Skip the maps that didn't change since their last autosave
+        State &state = mStates[mapDocument];
+        if (state.undoIndex == index && state.command == command)
+            continue;
+
+        state.fileName = recoveryFileName(mapDocument);
+        state.undoIndex = index;
+        state.command = command;
+
+        mapDocument->autosave(state.fileName);
+    }
+}
+
+void AutosaveManager::documentAboutToClose(MapDocument *mapDocument)
+{
+    // Make sure a running autosave doesn't write the file again afterwards
+    mapDocument->finishBackgroundSave();
+    removeRecoveryFile(mapDocument);
+
+    // A recovered map is no longer needed once its document was closed
+    const QString fileName = mapDocument->fileName();
+    if (!fileName.isEmpty() && QFileInfo(fileName).absolutePath() ==
+            QDir(recoveryDirectory()).absolutePath())
+        QFile::remove(fileName);
+}
+
+/**
+ * Returns the file the given map is autosaved to. It is named after the file
+ * of the map, which is made unique by a hash of its full path.
+ */
+QString AutosaveManager::recoveryFileName(const MapDocument *mapDocument) const
+{
+    const QString &fileName = mapDocument->fileName();
+
+    QString name;
+    if (fileName.isEmpty()) {
+        name = QLatin1String("untitled-") +
+                QString::number(quintptr(mapDocument), 16);
+    } else {
+        name = QFileInfo(fileName).completeBaseName() + QLatin1Char('-') +
+                QString::number(qHash(fileName), 16);
+    }
+
+    return recoveryDirectory() + QLatin1Char('/') + name + QLatin1String(".tmx");
+}
+
+void AutosaveManager::removeRecoveryFile(MapDocument *mapDocument)
+{
+    QHash<MapDocument*, State>::iterator it = mStates.find(mapDocument);
+    if (it == mStates.end())
+        return;
+
+    if (!it.value().fileName.isEmpty())
+        QFile::remove(it.value().fileName);
+
+    mStates.erase(it);
+}
@@ -0,0 +1,91 @@
+/*
+ * autosavemanager.h
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef AUTOSAVEMANAGER_H
+#define AUTOSAVEMANAGER_H
+
+#include <QHash>
+#include <QObject>
+#include <QStringList>
+
+class QTimer;
+class QUndoCommand;
+
+namespace Tiled {
+namespace Internal {
+
+class MapDocument;
+
+/**
+ * Periodically saves a copy of the modified maps to a recovery directory, so
+ * that they can be restored when Tiled did not shut down properly. The
+ * copies are written in the background and removed again once a map is
+ * saved or closed.
+ *
+ * A map is only autosaved again when it was changed since its last autosave.
+ */
+class AutosaveManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit AutosaveManager(QObject *parent = 0);
+
+    /**
+     * Returns the directory the autosaved maps are written to.
+     */
+    static QString recoveryDirectory();
+
+    /**
+     * Returns the autosaved maps that were left behind, for example by a
+     * crash.
+     */
+    static QStringList recoveryFiles();
+
+    /**
+     * Removes the given autosaved maps.
+     */
+    static void removeRecoveryFiles(const QStringList &fileNames);
+
+private slots:
+    void setInterval(int minutes);
+    void autosave();
+    void documentAboutToClose(MapDocument *mapDocument);
+
+private:
+    struct State {
+        State() : undoIndex(-1), command(0) {}
+
+        QString fileName;
+        int undoIndex;
+        const QUndoCommand *command;
+    };
+
+    QString recoveryFileName(const MapDocument *mapDocument) const;
+    void removeRecoveryFile(MapDocument *mapDocument);
+
+    QTimer *mTimer;
+    QHash<MapDocument*, State> mStates;
+};
+
+} // namespace Internal
+} // namespace Tiled
+
+#endif // AUTOSAVEMANAGER_H
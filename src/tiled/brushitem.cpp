@@ -31,13 +31,21 @@
 #include <QPainter>
 #include <QStyleOptionGraphicsItem>
 #include <QUndoStack>
+#include <QtCore/qmath.h>
 
 using namespace Tiled;
 using namespace Tiled::Internal;
 
+// Previews that would be larger than this, in pixels, are not cached. When
+// zoomed in this far only part of the brush is visible and drawing it
+// directly is cheaper.
+static const int MaxPreviewPixels = 4096;
+
 BrushItem::BrushItem():
     mMapDocument(0),
-    mTileLayer(0)
+    mTileLayer(0),
+    mPreviewScale(0),
+    mPreviewRevision(0)
 {
     setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
 }
@@ -57,6 +65,7 @@ void BrushItem::setMapDocument(MapDocument *mapDocument)
 void BrushItem::setTileLayer(const TileLayer *tileLayer)
 {
     delete mTileLayer;
+    mStamp = TileStamp();
 
     if (tileLayer) {
         mTileLayer = static_cast<TileLayer*>(tileLayer->clone());
@@ -65,6 +74,30 @@ void BrushItem::setTileLayer(const TileLayer *tileLayer)
         mTileLayer = 0;
         mRegion = QRegion();
     }
+    clearPreviews();
+    updateBoundingRect();
+    update();
+}
+
+void BrushItem::setTileStamp(const TileStamp &stamp)
+{
+    if (stamp.isNull()) {
+        setTileLayer(0);
+        return;
+    }
+
+    if (mTileLayer && mStamp == stamp)
+        return;
+
+    delete mTileLayer;
+    mStamp = stamp;
+
+    // Cloning is cheap since the chunks of cells are shared. The clone is
+    // needed because the brush moves its tile layer around.
+    mTileLayer = static_cast<TileLayer*>(stamp.tileLayer()->clone());
+    mRegion = stamp.region();
+
+    clearPreviews();
     updateBoundingRect();
     update();
 }
@@ -93,6 +126,12 @@ void BrushItem::setTileRegion(const QRegion &region)
     updateBoundingRect();
 }
 
+void BrushItem::invalidateCache()
+{
+    clearPreviews();
+    update();
+}
+
 QRectF BrushItem::boundingRect() const
 {
     return mBoundingRect;
@@ -116,7 +155,8 @@ void BrushItem::paint(QPainter *painter,
     if (mTileLayer) {
         const qreal opacity = painter->opacity();
         painter->setOpacity(0.75);
-        renderer->drawTileLayer(painter, mTileLayer, option->exposedRect);
+        if (!drawCachedPreview(painter, option))
+            renderer->drawTileLayer(painter, mTileLayer, option->exposedRect);
         painter->setOpacity(opacity);
     }
 
@@ -156,3 +196,103 @@ void BrushItem::updateBoundingRect()
                              qMax(0, drawMargins.bottom()));
     }
 }
+
+/**
+ * Draws the tile layer from its cached preview, rendering the preview first
+ * when needed. Returns false when the preview can't be used at the current
+ * transformation and the tile layer should be drawn directly.
+ */
+bool BrushItem::drawCachedPreview(QPainter *painter,
+                                  const QStyleOptionGraphicsItem *option)
+{
+    if (painter->worldTransform().type() > QTransform::TxScale)
+        return false;
+
+    // Changes made directly to the tile layer invalidate the previews
+    if (mPreviewRevision != mTileLayer->revision()) {
+        mPreviewRevision = mTileLayer->revision();
+        clearPreviews();
+    }
+
+    const qreal scale =
+            option->levelOfDetailFromTransform(painter->worldTransform());
+
+    if (scale != mPreviewScale) {
+        clearPreviews();
+        mPreviewScale = scale;
+    }
+
+    const MapRenderer *renderer = mMapDocument->renderer();
+    const QPoint position = mTileLayer->position();
+    Preview &preview = mPreviews[previewIndex()];
+
+    if (preview.pixmap.isNull()) {
+        const QRectF rect = previewRect();
+        if (rect.isEmpty())
+            return true;
+
+        if (rect.width() * scale > MaxPreviewPixels ||
+                rect.height() * scale > MaxPreviewPixels)
+            return false;
+
+        QPixmap pixmap(qCeil(rect.width() * scale),
+                       qCeil(rect.height() * scale));
+        pixmap.fill(Qt::transparent);
+
+        QPainter pixmapPainter(&pixmap);
+        pixmapPainter.setRenderHints(painter->renderHints());
+        pixmapPainter.scale(pixmap.width() / rect.width(),
+                            pixmap.height() / rect.height());
+        pixmapPainter.translate(-rect.topLeft());
+        renderer->drawTileLayer(&pixmapPainter, mTileLayer, rect);
+        pixmapPainter.end();
+
+        preview.pixmap = pixmap;
+        preview.position = position;
+        preview.rect = rect;
+    }
+
+    // Moving the layer by whole tiles moves its rendering along
+    const QPointF offset = renderer->tileToScreenCoords(position) -
+            renderer->tileToScreenCoords(preview.position);
+
+    painter->drawPixmap(preview.rect.translated(offset), preview.pixmap,
+                        QRectF(preview.pixmap.rect()));
+    return true;
+}
+
+void BrushItem::clearPreviews()
+{
+    for (int i = 0; i < PreviewCount; ++i)
+        mPreviews[i].pixmap = QPixmap();
+}
+
+/**
+ * Returns the index of the preview that applies to the current position of
+ * the tile layer.
+ */
+int BrushItem::previewIndex() const
+{
+    const Map::Orientation orientation = mMapDocument->map()->orientation();
+    if (orientation != Map::Staggered && orientation != Map::Hexagonal)
+        return 0;
+
+    return (mTileLayer->x() & 1) | ((mTileLayer->y() & 1) << 1);
+}
+
+/**
+ * Returns the area in which the tiles of the tile layer are drawn, including
+ * the parts of the tiles extending beyond their cells.
+ */
+QRectF BrushItem::previewRect() const
+{
+    const MapRenderer *renderer = mMapDocument->renderer();
+    const QMargins margins = mTileLayer->drawMargins();
+    const Map *map = mMapDocument->map();
+
+    return renderer->boundingRect(mTileLayer->bounds()).adjusted(
+                -margins.left(),
+                -(margins.top() - map->tileHeight()),
+                margins.right() - map->tileWidth(),
+                margins.bottom());
+}
@@ -22,7 +22,10 @@
 #ifndef BRUSHITEM_H
 #define BRUSHITEM_H
 
+#include "tilestamp.h"
+
 #include <QGraphicsItem>
+#include <QPixmap>
 
 namespace Tiled {
 
@@ -58,6 +61,14 @@ public:
      */
     void setTileLayer(const TileLayer *tileLayer);
 
+    /**
+     * Sets the tile layer of the given \a stamp as the tile layer of this
+     * brush. Unlike setTileLayer, this doesn't need to look at the cells of
+     * the stamp, and setting the stamp that is already set keeps the cached
+     * previews.
+     */
+    void setTileStamp(const TileStamp &stamp);
+
     /**
      * Returns the current tile layer.
      */
@@ -79,6 +90,12 @@ public:
      */
     QRegion tileRegion() const { return mRegion; }
 
+    /**
+     * Drops the cached preview of the tile layer. Should be called when the
+     * tiles used by the brush may look different.
+     */
+    void invalidateCache();
+
     // QGraphicsItem
     QRectF boundingRect() const;
     void paint(QPainter *painter,
@@ -87,11 +104,35 @@ public:
 
 private:
     void updateBoundingRect();
+    bool drawCachedPreview(QPainter *painter,
+                           const QStyleOptionGraphicsItem *option);
+    void clearPreviews();
+    int previewIndex() const;
+    QRectF previewRect() const;
 
     MapDocument *mMapDocument;
     TileLayer *mTileLayer;
+    TileStamp mStamp;       // the stamp mTileLayer was cloned from, if any
     QRegion mRegion;
     QRectF mBoundingRect;
+
+    /**
+     * A rendering of the tile layer at the scale of the last paint, which is
+     * moved along with the brush. On staggered and hexagonal maps the tiles
+     * are placed differently depending on whether the row or column is odd
+     * or even, so a rendering is kept for each combination.
+     */
+    struct Preview
+    {
+        QPixmap pixmap;
+        QPoint position;    // position of the tile layer when rendered
+        QRectF rect;        // area of the rendering at that position
+    };
+
+    enum { PreviewCount = 4 };
+    Preview mPreviews[PreviewCount];
+    qreal mPreviewScale;
+    unsigned mPreviewRevision;
 };
 
 } // namespace Internal
@@ -0,0 +1,196 @@
+/*
+ * cachemanager.cpp
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cachemanager.h"
+
+#include "documentmanager.h"
+#include "preferences.h"
+
+#include <QTimer>
+
+using namespace Tiled;
+using namespace Tiled::Internal;
+
+CacheManager *CacheManager::mInstance = 0;
+
+CacheManager::CacheManager()
+    : mBudget(0)
+    , mEnforceBudgetPending(false)
+{
+    for (int i = 0; i < CacheTypeCount; ++i)
+        mMemoryUsage[i] = 0;
+
+    Preferences *prefs = Preferences::instance();
+    setBudget(prefs->cacheMemoryBudget());
+    connect(prefs, SIGNAL(cacheMemoryBudgetChanged(int)),
+            SLOT(setBudget(int)));
+}
+
+CacheManager *CacheManager::instance()
+{
+    if (!mInstance)
+        mInstance = new CacheManager;
+    return mInstance;
+}
+
+void CacheManager::deleteInstance()
+{
+    delete mInstance;
+    mInstance = 0;
+}
+
+QString CacheManager::cacheTypeName(CacheType type)
+{
+    switch (type) {
+    case TileLayerChunks:
+        return tr("Tile layers");
+    case LayerCompositeChunks:
+        return tr("Flattened layers");
+    case ImageLayerTiles:
+        return tr("Image layers");
+    case GridChunks:
+        return tr("Grid");
+    case CacheTypeCount:
+        break;
+    }
+    return QString();
+}
+
+qint64 CacheManager::totalMemoryUsage() const
+{
+    qint64 total = 0;
+    for (int i = 0; i < CacheTypeCount; ++i)
+        total += mMemoryUsage[i];
+    return total;
+}
+
+void CacheManager::setBudget(int megabytes)
+{
+    mBudget = qint64(megabytes) * 1024 * 1024;
+    scheduleEnforceBudget();
+}
+
+/**
+ * Drops the caches of the documents in the background, least recently used
+ * first, until the caches fit within the budget. When they still don't fit,
+ * the caches of the current document are trimmed, again starting with the
+ * least recently used one.
+ */
+void CacheManager::enforceBudget()
+{
+    mEnforceBudgetPending = false;
+
+    qint64 total = 0;
+    foreach (const CacheClient *client, mClients)
+        total += client->cacheMemoryUsage();
+
+    if (total > mBudget) {
+        MapDocument *current = DocumentManager::instance()->currentDocument();
+
+        foreach (CacheClient *client, mClients) {
+            if (total <= mBudget)
+                break;
+            if (client->cacheDocument() == current)
+                continue;
+
+            total -= client->cacheMemoryUsage();
+            client->trimCache(0);
+            total += client->cacheMemoryUsage();
+        }
+
+        foreach (CacheClient *client, mClients) {
+            if (total <= mBudget)
+                break;
+
+            total -= client->cacheMemoryUsage();
+            client->trimCache(qMax(qint64(0), mBudget - total));
+            total += client->cacheMemoryUsage();
+        }
+    }
+
+    for (int i = 0; i < CacheTypeCount; ++i)
+        mMemoryUsage[i] = 0;
+    foreach (const CacheClient *client, mClients)
+        mMemoryUsage[client->cacheType()] += client->cacheMemoryUsage();
+
+    emit memoryUsageChanged();
+}
+
+void CacheManager::add(CacheClient *client)
+{
+    mClients.append(client);
+}
+
+void CacheManager::remove(CacheClient *client)
+{
+    // The instance may already be gone while the application shuts down
+    if (!mInstance)
+        return;
+
+    mInstance->mClients.removeOne(client);
+    mInstance->scheduleEnforceBudget();
+}
+
+void CacheManager::touch(CacheClient *client)
+{
+    if (mClients.last() != client) {
+        mClients.removeOne(client);
+        mClients.append(client);
+    }
+
+    scheduleEnforceBudget();
+}
+
+/**
+ * The budget is enforced from the event loop, so that entries are not
+ * evicted while a cache is still being painted from.
+ */
+void CacheManager::scheduleEnforceBudget()
+{
+    if (mEnforceBudgetPending)
+        return;
+
+    mEnforceBudgetPending = true;
+    QTimer::singleShot(0, this, SLOT(enforceBudget()));
+}
+
+
+CacheClient::CacheClient(CacheManager::CacheType type,
+                         MapDocument *mapDocument)
+    : mCacheType(type)
+    , mCacheDocument(mapDocument)
+{
+    CacheManager::instance()->add(this);
+}
+
+CacheClient::~CacheClient()
+{
+    CacheManager::remove(this);
+}
+
+void CacheClient::setCacheDocument(MapDocument *mapDocument)
+{
+    mCacheDocument = mapDocument;
+}
+
+void CacheClient::cacheGrown()
+{
+    CacheManager::instance()->touch(this);
+}
@@ -0,0 +1,196 @@
+/*
+ * cachemanager.h
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CACHEMANAGER_H
+#define CACHEMANAGER_H
+
+#include <QCache>
+#include <QList>
+#include <QObject>
+
+namespace Tiled {
+namespace Internal {
+
+class CacheClient;
+class MapDocument;
+
+/**
+ * Keeps track of the memory used by the rendering caches of all map
+ * documents. When this exceeds the cache memory budget set in the
+ * preferences, the caches of the documents in the background are dropped
+ * first. When that is not enough, the least recently used entries of the
+ * caches of the current document are evicted.
+ */
+class CacheManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum CacheType {
+        TileLayerChunks,
+        LayerCompositeChunks,
+        ImageLayerTiles,
+        GridChunks,
+        CacheTypeCount
+    };
+
+    /**
+     * Returns the cache manager instance. Creates the instance when it
+     * doesn't exist yet.
+     */
+    static CacheManager *instance();
+
+    /**
+     * Deletes the cache manager instance if it exists.
+     */
+    static void deleteInstance();
+
+    /**
+     * Returns a translated name for the given cache \a type.
+     */
+    static QString cacheTypeName(CacheType type);
+
+    /**
+     * Returns the number of bytes the caches may use together.
+     */
+    qint64 budget() const { return mBudget; }
+
+    /**
+     * Returns the number of bytes used by the caches of the given \a type,
+     * as of the last time the budget was enforced.
+     */
+    qint64 memoryUsage(CacheType type) const { return mMemoryUsage[type]; }
+
+    /**
+     * Returns the number of bytes used by all caches.
+     */
+    qint64 totalMemoryUsage() const;
+
+signals:
+    void memoryUsageChanged();
+
+private slots:
+    void setBudget(int megabytes);
+    void enforceBudget();
+
+private:
+    friend class CacheClient;
+
+    CacheManager();
+
+    void add(CacheClient *client);
+    static void remove(CacheClient *client);
+    void touch(CacheClient *client);
+    void scheduleEnforceBudget();
+
+    QList<CacheClient*> mClients;       // least recently used first
+    qint64 mBudget;
+    qint64 mMemoryUsage[CacheTypeCount];
+    bool mEnforceBudgetPending;
+
+    static CacheManager *mInstance;
+};
+
+/**
+ * A cache whose memory usage is managed by the CacheManager. Registers
+ * itself on construction.
+ */
+class CacheClient
+{
+public:
+    CacheClient(CacheManager::CacheType type, MapDocument *mapDocument);
+    virtual ~CacheClient();
+
+    CacheManager::CacheType cacheType() const { return mCacheType; }
+
+    /**
+     * Returns the map document this cache belongs to. Caches of documents
+     * other than the current one are dropped first.
+     */
+    MapDocument *cacheDocument() const { return mCacheDocument; }
+    void setCacheDocument(MapDocument *mapDocument);
+
+    /**
+     * Returns the number of bytes used by this cache.
+     */
+    virtual qint64 cacheMemoryUsage() const = 0;
+
+    /**
+     * Evicts the least recently used entries until this cache uses at most
+     * \a bytes.
+     */
+    virtual void trimCache(qint64 bytes) = 0;
+
+protected:
+    /**
+     * Should be called when entries were added to the cache.
+     */
+    void cacheGrown();
+
+private:
+    CacheManager::CacheType mCacheType;
+    MapDocument *mCacheDocument;
+};
+
+/**
+ * A QCache that is managed by the CacheManager. The costs of its entries
+ * are multiplied by \a bytesPerCost to get their memory usage.
+ */
+template<class Key, class T>
+class ManagedCache : public QCache<Key, T>, public CacheClient
+{
+public:
+    ManagedCache(CacheManager::CacheType type, MapDocument *mapDocument,
+                 int maxCost, int bytesPerCost = 1)
+        : QCache<Key, T>(maxCost)
+        , CacheClient(type, mapDocument)
+        , mBytesPerCost(bytesPerCost)
+    {}
+
+    bool insert(const Key &key, T *object, int cost = 1)
+    {
+        const bool inserted = QCache<Key, T>::insert(key, object, cost);
+        if (inserted)
+            cacheGrown();
+        return inserted;
+    }
+
+    qint64 cacheMemoryUsage() const
+    {
+        return qint64(this->totalCost()) * mBytesPerCost;
+    }
+
+    void trimCache(qint64 bytes)
+    {
+        // Lowering the maximum cost makes QCache drop the least recently
+        // used entries
+        const int maxCost = this->maxCost();
+        this->setMaxCost(int(bytes / mBytesPerCost));
+        this->setMaxCost(maxCost);
+    }
+
+private:
+    const int mBytesPerCost;
+};
+
+} // namespace Internal
+} // namespace Tiled
+
+#endif // CACHEMANAGER_H
@@ -0,0 +1,286 @@
+/*
+ * changedcells.cpp
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "changedcells.h"
+
+#include "regionbuilder.h"
+#include "undomemorymanager.h"
+
+#include <QtAlgorithms>
+
+#include <cstring>
+
+using namespace Tiled;
+using namespace Tiled::Internal;
+
+static bool positionLessThan(const QPoint &a, const QPoint &b)
+{
+    return a.y() < b.y() || (a.y() == b.y() && a.x() < b.x());
+}
+
+static bool changeLessThan(const ChangedCells::Change &a,
+                           const ChangedCells::Change &b)
+{
+    return positionLessThan(a.position, b.position);
+}
+
+namespace {
+
+/**
+ * A change with its cells packed, which takes 16 bytes instead of 40.
+ */
+struct PackedChange
+{
+    qint32 x;
+    qint32 y;
+    quint32 before;
+    quint32 after;
+};
+
+} // anonymous namespace
+
+/**
+ * Packs \a cell into \a packed. Fails unless the cell can be resolved again,
+ * which isn't the case for tiles that were removed from their tileset.
+ */
+static bool packCell(CellPacker &packer, const Cell &cell, PackedCell &packed)
+{
+    return packer.pack(cell, packed) && packer.tileAt(packed) == cell.tile;
+}
+
+/**
+ * Packs the \a changes into \a packed. Returns false when one of the cells
+ * can't be packed.
+ */
+static bool packChanges(const QVector<ChangedCells::Change> &changes,
+                        CellPacker &packer,
+                        QVector<PackedChange> &packed)
+{
+    packed.resize(changes.size());
+
+    for (int i = 0; i < changes.size(); ++i) {
+        const ChangedCells::Change &change = changes.at(i);
+        PackedCell before;
+        PackedCell after;
+
+        if (!packCell(packer, change.before, before) ||
+                !packCell(packer, change.after, after))
+            return false;
+
+        PackedChange &packedChange = packed[i];
+        packedChange.x = change.position.x();
+        packedChange.y = change.position.y();
+        packedChange.before = before.value();
+        packedChange.after = after.value();
+    }
+
+    return true;
+}
+
+ChangedCells::ChangedCells()
+    : mCompressedPacked(false)
+    , mCompressedCount(0)
+    , mPreparedCount(0)
+    , mSorted(true)
+{
+    UndoMemoryManager::instance()->add(this);
+}
+
+ChangedCells::~ChangedCells()
+{
+    UndoMemoryManager::remove(this);
+}
+
+void ChangedCells::append(const QPoint &position,
+                          const Cell &before, const Cell &after)
+{
+    if (before == after)
+        return;
+
+    decompress();
+
+    if (mSorted && !mChanges.isEmpty())
+        mSorted = positionLessThan(mChanges.last().position, position);
+
+    mChanges.append(Change(position, before, after));
+}
+
+const QVector<ChangedCells::Change> &ChangedCells::changes() const
+{
+    prepare();
+    UndoMemoryManager::instance()->touch(this);
+    return mChanges;
+}
+
+QRegion ChangedCells::region() const
+{
+    prepare();
+    UndoMemoryManager::instance()->touch(this);
+
+    RegionBuilder builder;
+
+    // Group the positions into horizontal runs
+    int i = 0;
+    while (i < mChanges.size()) {
+        const QPoint &start = mChanges.at(i).position;
+        int width = 1;
+
+        while (i + width < mChanges.size()) {
+            const QPoint &next = mChanges.at(i + width).position;
+            if (next.y() != start.y() || next.x() != start.x() + width)
+                break;
+            ++width;
+        }
+
+        builder.addRun(start.x(), start.y(), width);
+        i += width;
+    }
+
+    return builder.region();
+}
+
+/**
+ * The changes of \a other are appended, so that merging the commands of a
+ * long stroke one by one doesn't get slower as the stroke grows. Positions
+ * changed by both lists are combined by prepare(), which is done here as
+ * well once the list has doubled in size, to bound the memory used.
+ */
+void ChangedCells::merge(const ChangedCells &other)
+{
+    const QVector<Change> &otherChanges = other.changes();
+    if (otherChanges.isEmpty())
+        return;
+
+    decompress();
+
+    if (mSorted && !mChanges.isEmpty())
+        mSorted = positionLessThan(mChanges.last().position,
+                                   otherChanges.first().position);
+
+    mChanges += otherChanges;
+
+    if (mChanges.size() > 2 * qMax(mPreparedCount, MinPreparedCount))
+        prepare();
+}
+
+void ChangedCells::compress()
+{
+    if (isCompressed() || mChanges.isEmpty())
+        return;
+
+    prepare();
+
+    // Compression favors speed, since it happens while the user is editing
+    CellPacker packer;
+    QVector<PackedChange> packed;
+
+    if (packChanges(mChanges, packer, packed)) {
+        const int bytes = packed.size() * sizeof(PackedChange);
+        mCompressed = qCompress(reinterpret_cast<const uchar*>(packed.constData()),
+                                bytes, 1);
+        mPacker = packer;
+        mCompressedPacked = true;
+    } else {
+        // The changes only refer to tiles that are kept alive by the undo
+        // history, so their memory can be compressed as is
+        const int bytes = mChanges.size() * sizeof(Change);
+        mCompressed = qCompress(reinterpret_cast<const uchar*>(mChanges.constData()),
+                                bytes, 1);
+        mCompressedPacked = false;
+    }
+
+    mCompressedCount = mChanges.size();
+    mChanges = QVector<Change>();
+}
+
+/**
+ * Makes sure the changes are decompressed and sorted, with a single change
+ * for each position.
+ */
+void ChangedCells::prepare() const
+{
+    decompress();
+
+    if (!mSorted) {
+        // Keeps the changes of each position in the order they were made
+        qStableSort(mChanges.begin(), mChanges.end(), changeLessThan);
+        combineChanges();
+        mSorted = true;
+    }
+
+    mPreparedCount = mChanges.size();
+}
+
+/**
+ * Combines the changes of positions that were changed more than once, which
+ * happens after merging. The first cell before and the last cell after are
+ * kept, and positions that ended up unchanged are dropped.
+ */
+void ChangedCells::combineChanges() const
+{
+    Change *changes = mChanges.data();
+    const int count = mChanges.size();
+    int combined = 0;
+
+    int i = 0;
+    while (i < count) {
+        Change change = changes[i++];
+        while (i < count && changes[i].position == change.position)
+            change.after = changes[i++].after;
+
+        if (change.before != change.after)
+            changes[combined++] = change;
+    }
+
+    mChanges.resize(combined);
+}
+
+void ChangedCells::decompress() const
+{
+    if (!isCompressed())
+        return;
+
+    const QByteArray data = qUncompress(mCompressed);
+    mChanges.resize(mCompressedCount);
+
+    if (mCompressedPacked) {
+        Q_ASSERT(data.size() == int(mCompressedCount * sizeof(PackedChange)));
+
+        const PackedChange *packed =
+                reinterpret_cast<const PackedChange*>(data.constData());
+
+        for (int i = 0; i < mCompressedCount; ++i) {
+            Change &change = mChanges[i];
+            change.position = QPoint(packed[i].x, packed[i].y);
+            change.before = mPacker.unpack(PackedCell(packed[i].before));
+            change.after = mPacker.unpack(PackedCell(packed[i].after));
+        }
+
+        mPacker = CellPacker();
+    } else {
+        Q_ASSERT(data.size() == int(mCompressedCount * sizeof(Change)));
+        std::memcpy(mChanges.data(), data.constData(), data.size());
+    }
+
+    mCompressed.clear();
+    mCompressedPacked = false;
+    mCompressedCount = 0;
+}
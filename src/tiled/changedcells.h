@@ -0,0 +1,136 @@
+/*
+ * changedcells.h
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef CHANGEDCELLS_H
+#define CHANGEDCELLS_H
+
+#include "packedcell.h"
+#include "tilelayer.h"
+
+#include <QByteArray>
+#include <QPoint>
+#include <QRegion>
+#include <QVector>
+
+namespace Tiled {
+namespace Internal {
+
+/**
+ * A sparse list of changed cells, storing for each changed position the cell
+ * before and after the change. Used by the undo commands that edit tile
+ * layers, so that their memory use depends on the number of cells they
+ * change rather than on the area these cells span.
+ *
+ * Positions are in map coordinates. The changes are registered with the
+ * UndoMemoryManager, which compresses them when they haven't been used for
+ * a while and the undo history uses too much memory. The cells are packed
+ * into 32-bit values before being compressed, when possible.
+ */
+class ChangedCells
+{
+public:
+    struct Change
+    {
+        Change() {}
+        Change(const QPoint &position, const Cell &before, const Cell &after)
+            : position(position)
+            , before(before)
+            , after(after)
+        {}
+
+        QPoint position;
+        Cell before;
+        Cell after;
+    };
+
+    ChangedCells();
+    ~ChangedCells();
+
+    /**
+     * Adds a change at \a position from \a before to \a after. Each position
+     * may only be added once. Nothing is added when the cells are equal.
+     */
+    void append(const QPoint &position, const Cell &before, const Cell &after);
+
+    bool isEmpty() const
+    { return mChanges.isEmpty() && mCompressed.isEmpty(); }
+
+    /**
+     * Returns the changes, sorted by row and then by column.
+     */
+    const QVector<Change> &changes() const;
+
+    /**
+     * Returns the region covered by the changed positions.
+     */
+    QRegion region() const;
+
+    /**
+     * Merges the changes in \a other into this list. Where both change the
+     * same position, the cell before is taken from this list and the cell
+     * after is taken from \a other, as if \a other was applied afterwards.
+     *
+     * Takes time in proportion to the size of \a other, not of this list.
+     */
+    void merge(const ChangedCells &other);
+
+    /**
+     * Returns the number of bytes used by the uncompressed changes.
+     */
+    qint64 memoryUsage() const
+    { return qint64(mChanges.capacity()) * sizeof(Change); }
+
+    /**
+     * Returns the number of bytes used by the changes while compressed.
+     */
+    qint64 compressedSize() const { return mCompressed.size(); }
+
+    bool isCompressed() const { return !mCompressed.isEmpty(); }
+
+    /**
+     * Compresses the changes. They are decompressed again as soon as they
+     * are needed.
+     */
+    void compress();
+
+private:
+    Q_DISABLE_COPY(ChangedCells)
+
+    void prepare() const;
+    void combineChanges() const;
+    void decompress() const;
+
+    // Merging combines the changes once there are this many of them at least
+    static const int MinPreparedCount = 1024;
+
+    mutable QVector<Change> mChanges;
+    mutable QByteArray mCompressed;
+    mutable CellPacker mPacker;     // Resolves the packed compressed cells
+    mutable bool mCompressedPacked;
+    mutable int mCompressedCount;
+    mutable int mPreparedCount;     // The number of changes after prepare()
+    mutable bool mSorted;           // Also means there are no duplicates
+};
+
+} // namespace Internal
+} // namespace Tiled
+
+#endif // CHANGEDCELLS_H
@@ -54,6 +54,39 @@ void SetLayerVisible::swap()
 }
 
 
+SetLayersVisible::SetLayersVisible(MapDocument *mapDocument,
+                                   const QList<int> &layerIndexes,
+                                   bool visible)
+    : mMapDocument(mapDocument)
+    , mLayerIndexes(layerIndexes)
+{
+    for (int i = 0; i < layerIndexes.size(); ++i)
+        mVisible.append(visible);
+
+    if (visible)
+        setText(QCoreApplication::translate("Undo Commands",
+                                            "Show Layers"));
+    else
+        setText(QCoreApplication::translate("Undo Commands",
+                                            "Hide Layers"));
+}
+
+void SetLayersVisible::swap()
+{
+    LayerModel *layerModel = mMapDocument->layerModel();
+    const Map *map = mMapDocument->map();
+
+    layerModel->beginLayerChanges();
+    for (int i = 0; i < mLayerIndexes.size(); ++i) {
+        const int layerIndex = mLayerIndexes.at(i);
+        const bool previousVisible = map->layerAt(layerIndex)->isVisible();
+        layerModel->setLayerVisible(layerIndex, mVisible.at(i));
+        mVisible[i] = previousVisible;
+    }
+    layerModel->endLayerChanges();
+}
+
+
 SetLayerOpacity::SetLayerOpacity(MapDocument *mapDocument,
                                  int layerIndex,
                                  float opacity)
@@ -23,6 +23,7 @@
 
 #include "undocommands.h"
 
+#include <QList>
 #include <QUndoCommand>
 
 namespace Tiled {
@@ -51,6 +52,28 @@ private:
     bool mVisible;
 };
 
+/**
+ * Used for changing the visibility of several layers at once. The views are
+ * updated only once for all of them.
+ */
+class SetLayersVisible : public QUndoCommand
+{
+public:
+    SetLayersVisible(MapDocument *mapDocument,
+                     const QList<int> &layerIndexes,
+                     bool visible);
+
+    void undo() { swap(); }
+    void redo() { swap(); }
+
+private:
+    void swap();
+
+    MapDocument *mMapDocument;
+    QList<int> mLayerIndexes;
+    QList<bool> mVisible;
+};
+
 /**
  * Used for changing layer opacity.
  */
@@ -21,6 +21,7 @@
 #include "changeselectedarea.h"
 
 #include "mapdocument.h"
+#include "regionmask.h"
 
 #include <QCoreApplication>
 
@@ -31,23 +32,25 @@ ChangeSelectedArea::ChangeSelectedArea(MapDocument *mapDocument,
     : QUndoCommand(QCoreApplication::translate("Undo Commands",
                                                "Change Selection"))
     , mMapDocument(mapDocument)
-    , mSelection(newSelection)
 {
+    const RegionMask &oldMask = mapDocument->selectionMask();
+    const RegionMask newMask(newSelection);
+
+    RegionMask added = newMask;
+    added -= oldMask;
+    RegionMask removed = oldMask;
+    removed -= newMask;
+
+    mAdded = added.toRegion();
+    mRemoved = removed.toRegion();
 }
 
 void ChangeSelectedArea::undo()
 {
-    swapSelection();
+    mMapDocument->changeSelectedArea(mRemoved, mAdded);
 }
 
 void ChangeSelectedArea::redo()
 {
-    swapSelection();
-}
-
-void ChangeSelectedArea::swapSelection()
-{
-    const QRegion oldSelection = mMapDocument->selectedArea();
-    mMapDocument->setSelectedArea(mSelection);
-    mSelection = oldSelection;
+    mMapDocument->changeSelectedArea(mAdded, mRemoved);
 }
@@ -29,6 +29,11 @@ namespace Internal {
 
 class MapDocument;
 
+/**
+ * Changes the selected area of tiles. Only the cells that are added to and
+ * removed from the selection are stored, since these are usually small
+ * compared to the selection itself.
+ */
 class ChangeSelectedArea: public QUndoCommand
 {
 public:
@@ -43,10 +48,9 @@ public:
     void redo();
 
 private:
-    void swapSelection();
-
     MapDocument *mMapDocument;
-    QRegion mSelection;
+    QRegion mAdded;
+    QRegion mRemoved;
 };
 
 } // namespace Internal
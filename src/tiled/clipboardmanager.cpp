@@ -32,6 +32,7 @@
 #include "tmxmapwriter.h"
 #include "tile.h"
 #include "tilelayer.h"
+#include "tilesetmanager.h"
 
 #include <QApplication>
 #include <QClipboard>
@@ -44,6 +45,55 @@ static const char * const TMX_MIMETYPE = "text/tmx";
 using namespace Tiled;
 using namespace Tiled::Internal;
 
+namespace {
+
+/**
+ * Keeps a copy of a map on the clipboard. Pasting within Tiled uses the copy
+ * directly, while the TMX data is only written once another application asks
+ * for it.
+ */
+class MapMimeData : public QMimeData
+{
+public:
+    explicit MapMimeData(const Map *map)
+        : mMap(new Map(*map))
+    {
+        // Keep the tilesets alive for as long as the map is on the clipboard
+        TilesetManager::instance()->addReferences(mMap->tilesets());
+    }
+
+    ~MapMimeData()
+    {
+        TilesetManager::instance()->removeReferences(mMap->tilesets());
+        delete mMap;
+    }
+
+    const Map *map() const { return mMap; }
+
+    QStringList formats() const
+    { return QStringList(QLatin1String(TMX_MIMETYPE)); }
+
+protected:
+    QVariant retrieveData(const QString &mimeType, QVariant::Type type) const
+    {
+        if (mimeType != QLatin1String(TMX_MIMETYPE))
+            return QMimeData::retrieveData(mimeType, type);
+
+        if (mData.isNull()) {
+            TmxMapWriter mapWriter;
+            mData = mapWriter.toByteArray(mMap);
+        }
+
+        return mData;
+    }
+
+private:
+    Map *mMap;
+    mutable QByteArray mData;
+};
+
+} // anonymous namespace
+
 ClipboardManager *ClipboardManager::mInstance = 0;
 
 ClipboardManager::ClipboardManager() :
@@ -55,6 +105,21 @@ ClipboardManager::ClipboardManager() :
     updateHasMap();
 }
 
+ClipboardManager::~ClipboardManager()
+{
+    // Leave only the TMX data on the clipboard, since the copied map holds
+    // references to tilesets
+    const MapMimeData *mapData =
+            dynamic_cast<const MapMimeData*>(mClipboard->mimeData());
+
+    if (mapData) {
+        QMimeData *mimeData = new QMimeData;
+        mimeData->setData(QLatin1String(TMX_MIMETYPE),
+                          mapData->data(QLatin1String(TMX_MIMETYPE)));
+        mClipboard->setMimeData(mimeData);
+    }
+}
+
 ClipboardManager *ClipboardManager::instance()
 {
     if (!mInstance)
@@ -71,6 +136,13 @@ void ClipboardManager::deleteInstance()
 Map *ClipboardManager::map() const
 {
     const QMimeData *mimeData = mClipboard->mimeData();
+    if (!mimeData)
+        return 0;
+
+    // A map copied within Tiled doesn't need to be read back
+    if (const MapMimeData *mapData = dynamic_cast<const MapMimeData*>(mimeData))
+        return new Map(*mapData->map());
+
     const QByteArray data = mimeData->data(QLatin1String(TMX_MIMETYPE));
     if (data.isEmpty())
         return 0;
@@ -81,12 +153,7 @@ Map *ClipboardManager::map() const
 
 void ClipboardManager::setMap(const Map *map)
 {
-    TmxMapWriter mapWriter;
-
-    QMimeData *mimeData = new QMimeData;
-    mimeData->setData(QLatin1String(TMX_MIMETYPE), mapWriter.toByteArray(map));
-
-    mClipboard->setMimeData(mimeData);
+    mClipboard->setMimeData(new MapMimeData(map));
 }
 
 void ClipboardManager::copySelection(const MapDocument *mapDocument)
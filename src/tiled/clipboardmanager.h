@@ -62,11 +62,15 @@ public:
     /**
      * Retrieves the map from the clipboard. Returns 0 when there was no map or
      * loading failed.
+     *
+     * The tilesets of the returned map may be shared with other maps, so they
+     * should be released through the TilesetManager rather than deleted.
      */
     Map *map() const;
 
     /**
-     * Sets the given map on the clipboard.
+     * Sets a copy of the given map on the clipboard. The map is only written
+     * as TMX when another application asks for it.
      */
     void setMap(const Map *map);
 
@@ -101,6 +105,7 @@ private slots:
 
 private:
     ClipboardManager();
+    ~ClipboardManager();
 
     Q_DISABLE_COPY(ClipboardManager)
 
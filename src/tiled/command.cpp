@@ -22,6 +22,7 @@
 #include "documentmanager.h"
 #include "mapdocument.h"
 
+#include <QCoreApplication>
 #include <QMessageBox>
 #include <QSettings>
 
@@ -45,17 +46,23 @@ QString Command::finalCommand() const
 
 void Command::execute(bool inTerminal) const
 {
-    // Save if save option is unset or true
+    // Save if save option is unset or true. This happens in the background,
+    // and the command is started once the map has been written.
+    bool waitForSave = false;
+
     QSettings settings;
     QVariant variant = settings.value(QLatin1String("saveBeforeExecute"), true);
     if (variant.toBool()) {
         MapDocument *document = DocumentManager::instance()->currentDocument();
-        if (document)
-            document->save();
+        if (document && !document->fileName().isEmpty()) {
+            if (!document->saveInBackground(document->fileName()))
+                return;
+            waitForSave = true;
+        }
     }
 
     // Start the process
-    new CommandProcess(*this, inTerminal);
+    new CommandProcess(*this, inTerminal, waitForSave);
 }
 
 QVariant Command::toQVariant() const
@@ -86,14 +93,52 @@ Command Command::fromQVariant(const QVariant &variant)
     return command;
 }
 
-CommandProcess::CommandProcess(const Command &command, bool inTerminal)
+CommandManager *CommandManager::mInstance;
+
+CommandManager *CommandManager::instance()
+{
+    if (!mInstance)
+        mInstance = new CommandManager;
+    return mInstance;
+}
+
+CommandManager::CommandManager()
+    : QObject(QCoreApplication::instance())
+{
+}
+
+void CommandManager::cancelAll()
+{
+    foreach (CommandProcess *process, mProcesses)
+        process->cancel();
+}
+
+void CommandManager::addProcess(CommandProcess *process)
+{
+    mProcesses.append(process);
+    if (mProcesses.size() == 1)
+        emit runningCommandsChanged(true);
+}
+
+void CommandManager::removeProcess(CommandProcess *process)
+{
+    mProcesses.removeOne(process);
+    if (mProcesses.isEmpty())
+        emit runningCommandsChanged(false);
+}
+
+CommandProcess::CommandProcess(const Command &command, bool inTerminal,
+                               bool waitForSave)
     : QProcess(DocumentManager::instance())
     , mName(command.name)
     , mFinalCommand(command.finalCommand())
+    , mCanceled(false)
 #ifdef Q_OS_MAC
     , mFile(QLatin1String("tiledXXXXXX.command"))
 #endif
 {
+    CommandManager::instance()->addProcess(this);
+
     // Give an error if the command is empty or just whitespace
     if (mFinalCommand.trimmed().isEmpty()) {
         handleError(QProcess::FailedToStart);
@@ -146,13 +191,96 @@ CommandProcess::CommandProcess(const Command &command, bool inTerminal)
     connect(this, SIGNAL(error(QProcess::ProcessError)),
             SLOT(handleError(QProcess::ProcessError)));
 
-    connect(this, SIGNAL(finished(int)), SLOT(deleteLater()));
+    // The output is forwarded to the console as it comes in
+    setProcessChannelMode(QProcess::MergedChannels);
+    connect(this, SIGNAL(readyReadStandardOutput()), SLOT(readOutput()));
+
+    connect(this, SIGNAL(finished(int)), SLOT(commandFinished(int)));
+
+    // Wait for the map to be written before running the command on it
+    MapDocument *document = DocumentManager::instance()->currentDocument();
+    if (waitForSave && document && document->isSaving()) {
+        connect(document, SIGNAL(saved()), SLOT(startCommand()));
+        connect(document, SIGNAL(saveFailed(QString)),
+                SLOT(handleError(QString)));
+        connect(document, SIGNAL(destroyed()), SLOT(deleteLater()));
+        return;
+    }
+
+    startCommand();
+}
+
+CommandProcess::~CommandProcess()
+{
+    CommandManager::instance()->removeProcess(this);
+}
+
+void CommandProcess::cancel()
+{
+    mCanceled = true;
 
+    if (state() == QProcess::NotRunning)
+        deleteLater();
+    else
+        kill();
+}
+
+void CommandProcess::startCommand()
+{
+    // Only run once, even when the map gets saved again in the meantime
+    if (QObject *document = sender())
+        document->disconnect(this);
+
+    if (mCanceled)
+        return;
+
+    emit CommandManager::instance()->output(tr("Executing: %1")
+                                            .arg(mFinalCommand));
     start(mFinalCommand);
 }
 
+/**
+ * Only complete lines are forwarded, so that the output of a command can be
+ * shown line by line.
+ */
+void CommandProcess::readOutput()
+{
+    mPendingOutput.append(readAllStandardOutput());
+
+    const int end = mPendingOutput.lastIndexOf('\n');
+    if (end == -1)
+        return;
+
+    const QString lines = QString::fromLocal8Bit(mPendingOutput.constData(),
+                                                 end);
+    mPendingOutput.remove(0, end + 1);
+
+    emit CommandManager::instance()->output(lines);
+}
+
+void CommandProcess::commandFinished(int exitCode)
+{
+    readOutput();
+    if (!mPendingOutput.isEmpty())
+        emit CommandManager::instance()->output(
+                QString::fromLocal8Bit(mPendingOutput));
+
+    if (mCanceled)
+        emit CommandManager::instance()->output(tr("%1 was canceled")
+                                                .arg(mName));
+    else
+        emit CommandManager::instance()->output(tr("%1 finished with exit code %2")
+                                                .arg(mName).arg(exitCode));
+
+    deleteLater();
+}
+
 void CommandProcess::handleError(QProcess::ProcessError error)
 {
+    // Killing a canceled command is reported as a crash
+    if (mCanceled)
+        return;
+
     QString errorStr;
     switch (error) {
     case QProcess::FailedToStart:
@@ -21,6 +21,7 @@
 #ifndef COMMAND_H
 #define COMMAND_H
 
+#include <QList>
 #include <QString>
 #include <QProcess>
 #include <QVariant>
@@ -67,21 +68,81 @@ struct Command
     static Command fromQVariant(const QVariant &variant);
 };
 
+class CommandProcess;
+
+/**
+ * Keeps track of the running commands and forwards their output, so that it
+ * can be shown in the console.
+ */
+class CommandManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    static CommandManager *instance();
+
+    /**
+     * Returns whether any command is still running or waiting to be started.
+     */
+    bool hasRunningCommands() const { return !mProcesses.isEmpty(); }
+
+public slots:
+    /**
+     * Stops all running commands.
+     */
+    void cancelAll();
+
+signals:
+    /**
+     * Emitted for each batch of complete lines written by a command.
+     */
+    void output(const QString &lines);
+
+    /**
+     * Emitted when a command has been started or has ended.
+     */
+    void runningCommandsChanged(bool running);
+
+private:
+    friend class CommandProcess;
+
+    CommandManager();
+
+    void addProcess(CommandProcess *process);
+    void removeProcess(CommandProcess *process);
+
+    QList<CommandProcess*> mProcesses;
+
+    static CommandManager *mInstance;
+};
+
 class CommandProcess : public QProcess
 {
     Q_OBJECT
 
 public:
-    CommandProcess(const Command &command, bool inTerminal = false);
+    CommandProcess(const Command &command, bool inTerminal = false,
+                   bool waitForSave = false);
+    ~CommandProcess();
+
+    /**
+     * Stops the command, or makes sure it is never started when it is still
+     * waiting for the map to be saved.
+     */
+    void cancel();
 
 private slots:
+    void startCommand();
+    void readOutput();
+    void commandFinished(int exitCode);
     void handleError(QProcess::ProcessError);
-
-private:
     void handleError(const QString &);
 
+private:
     QString mName;
     QString mFinalCommand;
+    QByteArray mPendingOutput;
+    bool mCanceled;
 
 #ifdef Q_OS_MAC
     QTemporaryFile mFile;
@@ -19,6 +19,7 @@
  */
 
 #include "commandbutton.h"
+#include "command.h"
 #include "commanddatamodel.h"
 #include "commanddialog.h"
 #include "utils.h"
@@ -107,6 +108,13 @@ void CommandButton::populateMenu()
     if (!mMenu->isEmpty())
         mMenu->addSeparator();
 
+    // Add "Cancel Running Commands" action
+    CommandManager *commandManager = CommandManager::instance();
+    QAction *cancelAction = mMenu->addAction(tr("Cancel Running Commands"));
+    cancelAction->setEnabled(commandManager->hasRunningCommands());
+    connect(cancelAction, SIGNAL(triggered()),
+            commandManager, SLOT(cancelAll()));
+
     // Add "Edit Commands..." action
     QAction *action = mMenu->addAction(tr("Edit Commands..."));
     connect(action, SIGNAL(triggered()), SLOT(showDialog()));
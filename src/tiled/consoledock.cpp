@@ -19,13 +19,24 @@
  */
 
 #include "consoledock.h"
+#include "command.h"
 #include "pluginmanager.h"
+#include "preferences.h"
 
+#include <QScrollBar>
+#include <QTextCursor>
+#include <QTextDocument>
 #include <QVBoxLayout>
 
 using namespace Tiled;
 using namespace Tiled::Internal;
 
+/**
+ * The time in milliseconds during which incoming lines are collected before
+ * they are added to the console at once.
+ */
+static const int FlushInterval = 50;
+
 ConsoleDock::ConsoleDock(QWidget *parent)
     : QDockWidget(parent)
 {
@@ -40,6 +51,21 @@ ConsoleDock::ConsoleDock(QWidget *parent)
     plainTextEdit = new QPlainTextEdit;
     plainTextEdit->setReadOnly(true);
 
+    QFont font(QLatin1String("Monospace"));
+    font.setStyleHint(QFont::TypeWriter);
+    plainTextEdit->setFont(font);
+
+    // Older lines are dropped, so that the console keeps up with plugins
+    // and commands that write a lot of output
+    Preferences *prefs = Preferences::instance();
+    setLineLimit(prefs->consoleLineLimit());
+    connect(prefs, SIGNAL(consoleLineLimitChanged(int)),
+            this, SLOT(setLineLimit(int)));
+
+    mFlushTimer.setInterval(FlushInterval);
+    mFlushTimer.setSingleShot(true);
+    connect(&mFlushTimer, SIGNAL(timeout()), this, SLOT(flush()));
+
     plainTextEdit->setStyleSheet(QString::fromUtf8(
                             "QAbstractScrollArea {"
                             " background-color: black;"
@@ -61,21 +87,77 @@ ConsoleDock::ConsoleDock(QWidget *parent)
 
     }
 
+    connect(CommandManager::instance(), SIGNAL(output(QString)),
+            this, SLOT(appendOutput(QString)));
+
     setWidget(widget);
 }
 
 void ConsoleDock::appendInfo(QString str)
 {
-    plainTextEdit->appendHtml(str
-                    .prepend(QString::fromUtf8("<pre>"))
-                    .append(QString::fromUtf8("</pre>")));
+    queue(str, false);
 }
 
 void ConsoleDock::appendError(QString str)
 {
-    plainTextEdit->appendHtml(str
-                    .prepend(QString::fromUtf8("<pre style='color:red'>"))
-                    .append(QString::fromUtf8("</pre>")));
+    queue(str, true);
+}
+
+void ConsoleDock::appendOutput(const QString &lines)
+{
+    foreach (const QString &line, lines.split(QLatin1Char('\n')))
+        queue(line, false);
+}
+
+void ConsoleDock::setLineLimit(int lines)
+{
+    mLineLimit = lines;
+    plainTextEdit->setMaximumBlockCount(lines);
+}
+
+/**
+ * Lines are collected and added in batches, since laying out the text after
+ * each line would make the console a bottleneck. Lines that would be dropped
+ * right away are not kept.
+ */
+void ConsoleDock::queue(const QString &text, bool isError)
+{
+    mPendingLines.append(Line(text, isError));
+    while (mPendingLines.size() > mLineLimit)
+        mPendingLines.removeFirst();
+
+    if (!mFlushTimer.isActive())
+        mFlushTimer.start();
+}
+
+void ConsoleDock::flush()
+{
+    QScrollBar *scrollBar = plainTextEdit->verticalScrollBar();
+    const bool atBottom = scrollBar->value() == scrollBar->maximum();
+
+    QTextCharFormat infoFormat;
+    QTextCharFormat errorFormat;
+    errorFormat.setForeground(Qt::red);
+
+    QTextDocument *document = plainTextEdit->document();
+    QTextCursor cursor(document);
+    cursor.movePosition(QTextCursor::End);
+    cursor.beginEditBlock();
+
+    bool empty = document->isEmpty();
+    foreach (const Line &line, mPendingLines) {
+        if (!empty)
+            cursor.insertBlock();
+        empty = false;
+
+        cursor.insertText(line.text, line.isError ? errorFormat : infoFormat);
+    }
+
+    cursor.endEditBlock();
+    mPendingLines.clear();
+
+    if (atBottom)
+        scrollBar->setValue(scrollBar->maximum());
 }
 
 ConsoleDock::~ConsoleDock()
@@ -22,7 +22,9 @@
 #define CONSOLEDOCK_H
 
 #include <QDockWidget>
+#include <QList>
 #include <QPlainTextEdit>
+#include <QTimer>
 #include "logginginterface.h"
 
 class ConsoleDock : public QDockWidget
@@ -36,9 +38,29 @@ public:
 protected slots:
     void appendInfo(QString str);
     void appendError(QString str);
+    void appendOutput(const QString &lines);
+
+private slots:
+    void setLineLimit(int lines);
+    void flush();
 
 private:
+    struct Line
+    {
+        Line(const QString &text, bool isError)
+            : text(text), isError(isError)
+        {}
+
+        QString text;
+        bool isError;
+    };
+
+    void queue(const QString &text, bool isError);
+
     QPlainTextEdit *plainTextEdit;
+    QList<Line> mPendingLines;
+    QTimer mFlushTimer;
+    int mLineLimit;
 };
 
 #endif // CONSOLEDOCK_H
@@ -52,7 +52,10 @@ void CreateMultipointObjectTool::mouseMovedWhileCreatingObject(const QPointF &po
     const MapRenderer *renderer = mapDocument()->renderer();
     QPointF pixelCoords = renderer->screenToPixelCoords(pos);
 
-    SnapHelper(renderer, modifiers).snap(pixelCoords);
+    // Snapping to the points of the new object itself allows closing it
+    SnapHelper snapHelper(renderer, modifiers);
+    snapHelper.setSnapObjects(mapDocument()->map());
+    snapHelper.snap(pixelCoords);
 
     pixelCoords -= mNewMapObjectItem->mapObject()->position();
 
@@ -133,7 +133,9 @@ void CreateObjectTool::mousePressed(QGraphicsSceneMouseEvent *event)
         pixelCoords = renderer->screenToPixelCoords(event->scenePos());
     }
 
-    SnapHelper(renderer, event->modifiers()).snap(pixelCoords);
+    SnapHelper snapHelper(renderer, event->modifiers());
+    snapHelper.setSnapObjects(mapDocument()->map());
+    snapHelper.snap(pixelCoords);
 
     startNewMapObject(pixelCoords, objectGroup);
 }
@@ -46,7 +46,12 @@ void CreateTileObjectTool::mouseMovedWhileCreatingObject(const QPointF &pos, Qt:
     const QPointF diff(-imgSize.width() / 2, imgSize.height() / 2);
     QPointF pixelCoords = renderer->screenToPixelCoords(pos + diff);
 
-    SnapHelper(renderer, modifiers).snap(pixelCoords);
+    QSet<MapObject*> ignored;
+    ignored.insert(mNewMapObjectItem->mapObject());
+
+    SnapHelper snapHelper(renderer, modifiers);
+    snapHelper.setSnapObjects(mapDocument()->map(), ignored);
+    snapHelper.snap(pixelCoords);
 
     mNewMapObjectItem->mapObject()->setPosition(pixelCoords);
     mNewMapObjectItem->syncWithMapObject();
@@ -25,6 +25,7 @@
 #include "filesystemwatcher.h"
 #include "map.h"
 #include "mapdocument.h"
+#include "maploader.h"
 #include "maprenderer.h"
 #include "mapscene.h"
 #include "mapview.h"
@@ -40,6 +41,7 @@
 #include <QHBoxLayout>
 #include <QLabel>
 #include <QDialogButtonBox>
+#include <QProgressBar>
 #include <QScrollBar>
 
 using namespace Tiled;
@@ -82,6 +84,48 @@ private:
     QDialogButtonBox *mButtons;
 };
 
+class MapLoadingIndicator : public QWidget
+{
+    Q_OBJECT
+
+public:
+    MapLoadingIndicator(MapLoader *loader, QWidget *parent = 0)
+        : QWidget(parent)
+        , mLoader(loader)
+        , mLabel(new QLabel(this))
+        , mProgressBar(new QProgressBar(this))
+        , mButtons(new QDialogButtonBox(QDialogButtonBox::Cancel,
+                                        Qt::Horizontal,
+                                        this))
+    {
+        const QString fileName = QFileInfo(loader->fileName()).fileName();
+        mLabel->setText(tr("Loading %1...").arg(fileName));
+
+        // The amount of work is not known up front
+        mProgressBar->setRange(0, 0);
+        mProgressBar->setTextVisible(false);
+
+        QHBoxLayout *layout = new QHBoxLayout;
+        layout->addWidget(mLabel);
+        layout->addWidget(mProgressBar, 1);
+        layout->addWidget(mButtons);
+        setLayout(layout);
+
+        connect(mButtons, SIGNAL(rejected()), SIGNAL(cancel()));
+    }
+
+    MapLoader *loader() const { return mLoader; }
+
+signals:
+    void cancel();
+
+private:
+    MapLoader *mLoader;
+    QLabel *mLabel;
+    QProgressBar *mProgressBar;
+    QDialogButtonBox *mButtons;
+};
+
 class MapViewContainer : public QWidget
 {
     Q_OBJECT
@@ -138,6 +182,8 @@ void DocumentManager::deleteInstance()
 
 DocumentManager::DocumentManager(QObject *parent)
     : QObject(parent)
+    , mWidget(new QWidget)
+    , mLoadingIndicatorLayout(new QVBoxLayout)
     , mTabWidget(new MovableTabWidget)
     , mUndoGroup(new QUndoGroup(this))
     , mSelectedTool(0)
@@ -147,6 +193,16 @@ DocumentManager::DocumentManager(QObject *parent)
     mTabWidget->setDocumentMode(true);
     mTabWidget->setTabsClosable(true);
 
+    mLoadingIndicatorLayout->setMargin(0);
+    mLoadingIndicatorLayout->setSpacing(0);
+
+    QVBoxLayout *layout = new QVBoxLayout;
+    layout->setMargin(0);
+    layout->setSpacing(0);
+    layout->addWidget(mTabWidget);
+    layout->addLayout(mLoadingIndicatorLayout);
+    mWidget->setLayout(layout);
+
     connect(mTabWidget, SIGNAL(currentChanged(int)),
             SLOT(currentIndexChanged()));
     connect(mTabWidget, SIGNAL(tabCloseRequested(int)),
@@ -162,12 +218,12 @@ DocumentManager::~DocumentManager()
 {
     // All documents should be closed gracefully beforehand
     Q_ASSERT(mDocuments.isEmpty());
-    delete mTabWidget;
+    delete mWidget;
 }
 
 QWidget *DocumentManager::widget() const
 {
-    return mTabWidget;
+    return mWidget;
 }
 
 MapDocument *DocumentManager::currentDocument() const
@@ -277,6 +333,8 @@ void DocumentManager::addDocument(MapDocument *mapDocument)
             SLOT(fileNameChanged(QString,QString)));
     connect(mapDocument, SIGNAL(modifiedChanged()), SLOT(updateDocumentTab()));
     connect(mapDocument, SIGNAL(saved()), SLOT(documentSaved()));
+    connect(mapDocument, SIGNAL(saveFailed(QString)),
+            SLOT(documentSaveFailed(QString)));
 
     connect(container, SIGNAL(reload()), SLOT(reloadRequested()));
 
@@ -284,6 +342,24 @@ void DocumentManager::addDocument(MapDocument *mapDocument)
     centerViewOn(0, 0);
 }
 
+void DocumentManager::loadDocumentInBackground(const QString &fileName)
+{
+    // Don't load the same map twice at the same time
+    foreach (MapLoader *loader, mLoadingIndicators.keys())
+        if (loader->fileName() == fileName)
+            return;
+
+    MapLoader *loader = new MapLoader(fileName, this);
+    MapLoadingIndicator *indicator = new MapLoadingIndicator(loader);
+    mLoadingIndicatorLayout->addWidget(indicator);
+    mLoadingIndicators.insert(loader, indicator);
+
+    connect(loader, SIGNAL(finished()), SLOT(mapLoaderFinished()));
+    connect(indicator, SIGNAL(cancel()), SLOT(cancelLoading()));
+
+    loader->start();
+}
+
 void DocumentManager::closeCurrentDocument()
 {
     const int index = mTabWidget->currentIndex();
@@ -441,6 +517,12 @@ void DocumentManager::documentSaved()
     container->setFileChangedWarningVisible(false);
 }
 
+void DocumentManager::documentSaveFailed(const QString &error)
+{
+    MapDocument *document = static_cast<MapDocument*>(sender());
+    emit saveError(tr("%1:\n\n%2").arg(document->fileName(), error));
+}
+
 void DocumentManager::documentTabMoved(int from, int to)
 {
     mDocuments.move(from, to);
@@ -457,7 +539,8 @@ void DocumentManager::fileChanged(const QString &fileName)
     MapDocument *document = mDocuments.at(index);
 
     // Ignore change event when it seems to be our own save
-    if (QFileInfo(fileName).lastModified() == document->lastSaved())
+    if (document->isSaving() ||
+            QFileInfo(fileName).lastModified() == document->lastSaved())
         return;
 
     // Automatically reload when there are no unsaved changes
@@ -478,6 +561,42 @@ void DocumentManager::reloadRequested()
     reloadDocumentAt(index);
 }
 
+void DocumentManager::mapLoaderFinished()
+{
+    MapLoader *loader = static_cast<MapLoader*>(sender());
+
+    // Canceled loaders no longer have an indicator
+    if (MapLoadingIndicator *indicator = mLoadingIndicators.take(loader)) {
+        delete indicator;
+
+        if (MapDocument *mapDocument = loader->takeMapDocument()) {
+            // The map may have been opened in another way in the meantime
+            const int documentIndex = findDocument(loader->fileName());
+            if (documentIndex != -1) {
+                delete mapDocument;
+                switchToDocument(documentIndex);
+            } else {
+                addDocument(mapDocument);
+                emit documentLoaded(mapDocument);
+            }
+        } else {
+            emit documentLoadFailed(loader->fileName(), loader->errorString());
+        }
+    }
+
+    loader->deleteLater();
+}
+
+void DocumentManager::cancelLoading()
+{
+    MapLoadingIndicator *indicator =
+            static_cast<MapLoadingIndicator*>(sender());
+
+    // The loader can't be interrupted, its result is discarded instead
+    mLoadingIndicators.remove(indicator->loader());
+    indicator->deleteLater();
+}
+
 void DocumentManager::centerViewOn(qreal x, qreal y)
 {
     MapView *view = currentMapView();
@@ -23,11 +23,13 @@
 #define DOCUMENT_MANAGER_H
 
 #include <QList>
+#include <QMap>
 #include <QObject>
 #include <QPair>
 #include <QPointF>
 
 class QUndoGroup;
+class QVBoxLayout;
 
 namespace Tiled {
 
@@ -38,6 +40,8 @@ namespace Internal {
 class AbstractTool;
 class FileSystemWatcher;
 class MapDocument;
+class MapLoader;
+class MapLoadingIndicator;
 class MapScene;
 class MapView;
 class MovableTabWidget;
@@ -110,6 +114,15 @@ public:
      */
     void addDocument(MapDocument *mapDocument);
 
+    /**
+     * Loads the TMX map with the given \a fileName on a worker thread and
+     * adds it as a new document once it has been loaded. In the meantime a
+     * progress indicator is shown, which allows the user to cancel loading.
+     *
+     * Emits documentLoaded() or documentLoadFailed() when done.
+     */
+    void loadDocumentInBackground(const QString &fileName);
+
     /**
      * Closes the current map document. Will not ask the user whether to save
      * any changes!
@@ -177,6 +190,22 @@ signals:
      */
     void reloadError(const QString &error);
 
+    /**
+     * Emitted when an error occurred while saving a map in the background.
+     */
+    void saveError(const QString &error);
+
+    /**
+     * Emitted when a map loaded in the background has been added as a new
+     * document.
+     */
+    void documentLoaded(MapDocument *mapDocument);
+
+    /**
+     * Emitted when loading a map in the background failed.
+     */
+    void documentLoadFailed(const QString &fileName, const QString &error);
+
 public slots:
     void switchToLeftDocument();
     void switchToRightDocument();
@@ -189,18 +218,25 @@ private slots:
                          const QString &oldFileName);
     void updateDocumentTab();
     void documentSaved();
+    void documentSaveFailed(const QString &error);
     void documentTabMoved(int from, int to);
 
     void fileChanged(const QString &fileName);
 
     void reloadRequested();
 
+    void mapLoaderFinished();
+    void cancelLoading();
+
 private:
     DocumentManager(QObject *parent = 0);
     ~DocumentManager();
 
     QList<MapDocument*> mDocuments;
 
+    QWidget *mWidget;
+    QVBoxLayout *mLoadingIndicatorLayout;
+    QMap<MapLoader*, MapLoadingIndicator*> mLoadingIndicators;
     MovableTabWidget *mTabWidget;
     QUndoGroup *mUndoGroup;
     AbstractTool *mSelectedTool;
@@ -37,6 +37,7 @@
 #include <QApplication>
 #include <QGraphicsItem>
 #include <QGraphicsView>
+#include <QHash>
 #include <QMenu>
 #include <QPainter>
 #include <QPalette>
@@ -74,8 +75,6 @@ public:
 
     int pointIndex() const { return mPointIndex; }
 
-    void setPointPosition(const QPointF &pos);
-
     // These hide the QGraphicsItem members
     void setSelected(bool selected) { mSelected = selected; update(); }
     bool isSelected() const { return mSelected; }
@@ -94,16 +93,6 @@ private:
 } // namespace Internal
 } // namespace Tiled
 
-void PointHandle::setPointPosition(const QPointF &pos)
-{
-    // TODO: It could be faster to update the polygon only once when changing
-    // multiple points of the same polygon.
-    MapObject *mapObject = mMapObjectItem->mapObject();
-    QPolygonF polygon = mapObject->polygon();
-    polygon[mPointIndex] = pos - mapObject->position();
-    mMapObjectItem->setPolygon(polygon);
-}
-
 QRectF PointHandle::boundingRect() const
 {
     return QRectF(-5, -5, 10 + 1, 10 + 1);
@@ -402,10 +391,9 @@ void EditPolygonTool::updateHandles()
         }
 
         // Update the position of all handles
+        const QPolygonF screenPolygon = renderer->pixelToScreenCoords(polygon);
         for (int i = 0; i < pointHandles.size(); ++i) {
-            const QPointF &point = polygon.at(i);
-            const QPointF handlePos = renderer->pixelToScreenCoords(point);
-            const QPointF internalHandlePos = handlePos - item->pos();
+            const QPointF internalHandlePos = screenPolygon.at(i) - item->pos();
             pointHandles.at(i)->setPos(item->mapToScene(internalHandlePos));
         }
 
@@ -520,6 +508,8 @@ void EditPolygonTool::updateMovingItems(const QPointF &pos,
     QPointF diff = pos - mStart;
 
     SnapHelper snapHelper(renderer, modifiers);
+    snapHelper.setSnapObjects(mapDocument()->map(),
+                              QSet<MapObject*>::fromList(mOldPolygons.keys()));
 
     if (snapHelper.snaps()) {
         const QPointF alignScreenPos = renderer->pixelToScreenCoords(mAlignPosition);
@@ -531,16 +521,33 @@ void EditPolygonTool::updateMovingItems(const QPointF &pos,
         diff = renderer->pixelToScreenCoords(newAlignPixelPos) - alignScreenPos;
     }
 
+    // The points are collected per object, so that each polygon is only
+    // updated once rather than once for each of its moved points
+    QHash<MapObjectItem*, QPolygonF> newPolygons;
+
     int i = 0;
     foreach (PointHandle *handle, mSelectedHandles) {
-        const MapObjectItem *item = handle->mapObjectItem();
+        MapObjectItem *item = handle->mapObjectItem();
+        const MapObject *mapObject = item->mapObject();
         const QPointF newPixelPos = mOldHandlePositions.at(i) + diff;
         const QPointF newInternalPos = item->mapFromScene(newPixelPos);
         const QPointF newScenePos = item->pos() + newInternalPos;
         handle->setPos(newPixelPos);
-        handle->setPointPosition(renderer->screenToPixelCoords(newScenePos));
+
+        QHash<MapObjectItem*, QPolygonF>::iterator it = newPolygons.find(item);
+        if (it == newPolygons.end())
+            it = newPolygons.insert(item, mapObject->polygon());
+
+        it.value()[handle->pointIndex()] =
+                renderer->screenToPixelCoords(newScenePos) - mapObject->position();
         ++i;
     }
+
+    QHashIterator<MapObjectItem*, QPolygonF> it(newPolygons);
+    while (it.hasNext()) {
+        it.next();
+        it.key()->setPolygon(it.value());
+    }
 }
 
 void EditPolygonTool::finishMoving(const QPointF &pos)
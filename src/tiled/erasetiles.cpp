@@ -33,32 +33,35 @@ EraseTiles::EraseTiles(MapDocument *mapDocument,
                        const QRegion &region)
     : mMapDocument(mapDocument)
     , mTileLayer(tileLayer)
-    , mRegion(region)
     , mMergeable(false)
 {
     setText(QCoreApplication::translate("Undo Commands", "Erase"));
 
     // Store the tiles that are to be erased
-    const QRegion r = mRegion.translated(-mTileLayer->x(), -mTileLayer->y());
-    mErasedCells = mTileLayer->copy(r);
-}
-
-EraseTiles::~EraseTiles()
-{
-    delete mErasedCells;
+    const QRegion r = region.intersected(mTileLayer->bounds());
+    foreach (const QRect &rect, r.rects()) {
+        for (int y = rect.top(); y <= rect.bottom(); ++y) {
+            for (int x = rect.left(); x <= rect.right(); ++x) {
+                const QPoint position(x, y);
+                const QPoint layerPosition = position - mTileLayer->position();
+                mErasedCells.append(position,
+                                    mTileLayer->cellAt(layerPosition),
+                                    Cell());
+            }
+        }
+    }
 }
 
 void EraseTiles::undo()
 {
-    const QRect bounds = mRegion.boundingRect();
     TilePainter painter(mMapDocument, mTileLayer);
-    painter.drawCells(bounds.x(), bounds.y(), mErasedCells);
+    painter.applyChanges(mErasedCells, true);
 }
 
 void EraseTiles::redo()
 {
     TilePainter painter(mMapDocument, mTileLayer);
-    painter.erase(mRegion);
+    painter.applyChanges(mErasedCells);
 }
 
 bool EraseTiles::mergeWith(const QUndoCommand *other)
@@ -69,24 +72,6 @@ bool EraseTiles::mergeWith(const QUndoCommand *other)
           o->mMergeable))
         return false;
 
-    const QRegion combinedRegion = mRegion.united(o->mRegion);
-    if (mRegion != combinedRegion) {
-        const QRect bounds = mRegion.boundingRect();
-        const QRect combinedBounds = combinedRegion.boundingRect();
-
-        // Resize the erased tiles layer when necessary
-        if (bounds != combinedBounds) {
-            const QPoint shift = bounds.topLeft() - combinedBounds.topLeft();
-            mErasedCells->resize(combinedBounds.size(), shift);
-        }
-
-        // Copy the newly erased tiles over
-        const QRect otherBounds = o->mRegion.boundingRect();
-        const QPoint pos = otherBounds.topLeft() - combinedBounds.topLeft();
-        mErasedCells->merge(pos, o->mErasedCells);
-
-        mRegion = combinedRegion;
-    }
-
+    mErasedCells.merge(o->mErasedCells);
     return true;
 }
@@ -21,6 +21,7 @@
 #ifndef ERASETILES_H
 #define ERASETILES_H
 
+#include "changedcells.h"
 #include "undocommands.h"
 
 #include <QRegion>
@@ -41,7 +42,6 @@ public:
     EraseTiles(MapDocument *mapDocument,
                TileLayer *tileLayer,
                const QRegion &region);
-    ~EraseTiles();
 
     /**
      * Sets whether this undo command can be merged with an existing command.
@@ -58,8 +58,7 @@ public:
 private:
     MapDocument *mMapDocument;
     TileLayer *mTileLayer;
-    TileLayer *mErasedCells;
-    QRegion mRegion;
+    ChangedCells mErasedCells;
     bool mMergeable;
 };
 
@@ -21,21 +21,31 @@
 #include "exportasimagedialog.h"
 #include "ui_exportasimagedialog.h"
 
+#include "hexagonalrenderer.h"
+#include "imagelayer.h"
+#include "isometricrenderer.h"
 #include "map.h"
 #include "mapdocument.h"
 #include "mapobject.h"
 #include "mapobjectitem.h"
 #include "maprenderer.h"
-#include "imagelayer.h"
 #include "objectgroup.h"
+#include "orthogonalrenderer.h"
 #include "preferences.h"
+#include "staggeredrenderer.h"
 #include "tilelayer.h"
+#include "tilesetmanager.h"
 #include "utils.h"
 
+#include <QAtomicInt>
+#include <QCoreApplication>
 #include <QFileDialog>
+#include <QHash>
 #include <QMessageBox>
 #include <QImageWriter>
+#include <QProgressDialog>
 #include <QSettings>
+#include <QThread>
 
 static const char * const VISIBLE_ONLY_KEY = "SaveAsImage/VisibleLayersOnly";
 static const char * const CURRENT_SCALE_KEY = "SaveAsImage/CurrentScale";
@@ -124,6 +134,200 @@ static bool smoothTransform(qreal scale)
     return scale != qreal(1) && scale < qreal(2);
 }
 
+namespace {
+
+// The number of image rows rendered between progress updates
+const int BandHeight = 256;
+
+/**
+ * Renders a copy of the map to an image and saves it, so that it can be
+ * done on a worker thread while the editor stays responsive. The image is
+ * rendered in bands of rows, reporting the progress after each band and
+ * stopping early when cancelled.
+ */
+class ExportImageThread : public QThread
+{
+public:
+    ExportImageThread(MapDocument *mapDocument,
+                      const QImage &image,
+                      const QString &fileName,
+                      qreal scale,
+                      bool visibleLayersOnly,
+                      bool drawTileGrid)
+        : mMap(new Map(*mapDocument->map()))
+        , mImage(image)
+        , mFileName(fileName)
+        , mScale(scale)
+        , mVisibleLayersOnly(visibleLayersOnly)
+        , mDrawTileGrid(drawTileGrid)
+        , mRenderFlags(mapDocument->renderer()->flags())
+        , mGridColor(Preferences::instance()->gridColor())
+        , mRowsDone(0)
+        , mCancelled(0)
+        , mSaved(false)
+    {
+        // Keep the tilesets alive while the copy is being rendered
+        TilesetManager::instance()->addReferences(mMap->tilesets());
+
+        foreach (Layer *layer, mMap->layers())
+            if (ObjectGroup *objectGroup = layer->asObjectGroup())
+                foreach (const MapObject *object, objectGroup->objects())
+                    mObjectColors.insert(object,
+                                         MapObjectItem::objectColor(object));
+    }
+
+    ~ExportImageThread()
+    {
+        wait();
+        TilesetManager::instance()->removeReferences(mMap->tilesets());
+        delete mMap;
+    }
+
+    int rowsDone() const
+    {
+#if QT_VERSION >= 0x050000
+        return mRowsDone.load();
+#else
+        return int(mRowsDone);
+#endif
+    }
+
+    void cancel() { mCancelled.ref(); }
+
+    bool isCancelled() const
+    {
+#if QT_VERSION >= 0x050000
+        return mCancelled.load() != 0;
+#else
+        return int(mCancelled) != 0;
+#endif
+    }
+
+    bool isSaved() const { return mSaved; }
+
+    void render()
+    {
+        MapRenderer *renderer;
+        switch (mMap->orientation()) {
+        case Map::Isometric:
+            renderer = new IsometricRenderer(mMap);
+            break;
+        case Map::Staggered:
+            renderer = new StaggeredRenderer(mMap);
+            break;
+        case Map::Hexagonal:
+            renderer = new HexagonalRenderer(mMap);
+            break;
+        default:
+            renderer = new OrthogonalRenderer(mMap);
+            break;
+        }
+        renderer->setFlags(mRenderFlags);
+        renderer->setFlag(ShowTileObjectOutlines, false);
+        renderer->setPainterScale(mScale);
+
+        const QTransform transform = QTransform::fromScale(mScale, mScale);
+        const QTransform inverted = transform.inverted();
+
+        QPainter painter(&mImage);
+        if (smoothTransform(mScale)) {
+            painter.setRenderHints(QPainter::SmoothPixmapTransform |
+                                   QPainter::HighQualityAntialiasing);
+        }
+
+        for (int top = 0; top < mImage.height(); top += BandHeight) {
+            if (isCancelled())
+                break;
+
+            const QRect band(0, top, mImage.width(),
+                             qMin(BandHeight, mImage.height() - top));
+
+            painter.resetTransform();
+            painter.setClipRect(band);
+            painter.setTransform(transform);
+
+            drawBand(&painter, renderer, inverted.mapRect(QRectF(band)));
+
+            mRowsDone.fetchAndAddRelaxed(band.height());
+        }
+
+        painter.end();
+        delete renderer;
+
+        if (!isCancelled())
+            mSaved = mImage.save(mFileName);
+    }
+
+protected:
+    void run()
+    {
+        render();
+    }
+
+private:
+    void drawBand(QPainter *painter, MapRenderer *renderer,
+                  const QRectF &exposed)
+    {
+        foreach (const Layer *layer, mMap->layers()) {
+            if (mVisibleLayersOnly && !layer->isVisible())
+                continue;
+
+            painter->setOpacity(layer->opacity());
+
+            const TileLayer *tileLayer = dynamic_cast<const TileLayer*>(layer);
+            const ObjectGroup *objGroup = dynamic_cast<const ObjectGroup*>(layer);
+            const ImageLayer *imageLayer = dynamic_cast<const ImageLayer*>(layer);
+
+            if (tileLayer) {
+                renderer->drawTileLayer(painter, tileLayer, exposed);
+            } else if (objGroup) {
+                QList<MapObject*> objects = objGroup->objects();
+
+                if (objGroup->drawOrder() == ObjectGroup::TopDownOrder)
+                    qStableSort(objects.begin(), objects.end(), objectLessThan);
+
+                foreach (const MapObject *object, objects) {
+                    if (object->isVisible()) {
+                        if (object->rotation() != qreal(0)) {
+                            QPointF origin = renderer->pixelToScreenCoords(object->position());
+                            painter->save();
+                            painter->translate(origin);
+                            painter->rotate(object->rotation());
+                            painter->translate(-origin);
+                        }
+
+                        renderer->drawMapObject(painter, object,
+                                                mObjectColors.value(object));
+
+                        if (object->rotation() != qreal(0))
+                            painter->restore();
+                    }
+                }
+            } else if (imageLayer) {
+                renderer->drawImageLayer(painter, imageLayer, exposed);
+            }
+        }
+
+        if (mDrawTileGrid)
+            renderer->drawGrid(painter, exposed, mGridColor);
+    }
+
+    Map *mMap;
+    QImage mImage;
+    const QString mFileName;
+    const qreal mScale;
+    const bool mVisibleLayersOnly;
+    const bool mDrawTileGrid;
+    const RenderFlags mRenderFlags;
+    const QColor mGridColor;
+    QHash<const MapObject*, QColor> mObjectColors;
+    QAtomicInt mRowsDone;
+    QAtomicInt mCancelled;
+    bool mSaved;
+};
+
+} // anonymous namespace
+
 void ExportAsImageDialog::accept()
 {
     const QString fileName = mUi->fileNameEdit->text();
@@ -151,14 +355,8 @@ void ExportAsImageDialog::accept()
 
     MapRenderer *renderer = mMapDocument->renderer();
 
-    // Remember the current render flags
-    const Tiled::RenderFlags renderFlags = renderer->flags();
-
-    renderer->setFlag(ShowTileObjectOutlines, false);
-
-    QSize mapSize = renderer->mapSize();
-    if (useCurrentScale)
-        mapSize *= mCurrentScale;
+    const qreal scale = useCurrentScale ? mCurrentScale : qreal(1);
+    const QSize mapSize = renderer->mapSize() * scale;
 
     QImage image;
 
@@ -196,70 +394,46 @@ void ExportAsImageDialog::accept()
         return;
     }
 
-    QPainter painter(&image);
-
-    if (useCurrentScale) {
-        if (smoothTransform(mCurrentScale)) {
-            painter.setRenderHints(QPainter::SmoothPixmapTransform |
-                                   QPainter::HighQualityAntialiasing);
-        }
-        painter.setTransform(QTransform::fromScale(mCurrentScale,
-                                                   mCurrentScale));
-        renderer->setPainterScale(mCurrentScale);
-    } else {
-        renderer->setPainterScale(1);
-    }
-
-    foreach (const Layer *layer, mMapDocument->map()->layers()) {
-        if (visibleLayersOnly && !layer->isVisible())
-            continue;
+    ExportImageThread thread(mMapDocument, image, fileName, scale,
+                             visibleLayersOnly, drawTileGrid);
 
-        painter.setOpacity(layer->opacity());
+    // Release our reference, so that the thread draws on the image directly
+    image = QImage();
 
-        const TileLayer *tileLayer = dynamic_cast<const TileLayer*>(layer);
-        const ObjectGroup *objGroup = dynamic_cast<const ObjectGroup*>(layer);
-        const ImageLayer *imageLayer = dynamic_cast<const ImageLayer*>(layer);
+#if QT_VERSION >= 0x050000
+    // Drawing happens on a worker thread, which uses the QImage copies of
+    // the tileset and image layer images rather than their pixmaps
+    QProgressDialog progress(tr("Exporting map as image..."), tr("Cancel"),
+                             0, mapSize.height(), this);
+    progress.setWindowModality(Qt::WindowModal);
+    progress.setMinimumDuration(500);
 
-        if (tileLayer) {
-            renderer->drawTileLayer(&painter, tileLayer);
-        } else if (objGroup) {
-            QList<MapObject*> objects = objGroup->objects();
+    thread.start();
 
-            if (objGroup->drawOrder() == ObjectGroup::TopDownOrder)
-                qStableSort(objects.begin(), objects.end(), objectLessThan);
+    while (!thread.wait(50)) {
+        progress.setValue(thread.rowsDone());
+        QCoreApplication::processEvents();
 
-            foreach (const MapObject *object, objects) {
-                if (object->isVisible()) {
-                    if (object->rotation() != qreal(0)) {
-                        QPointF origin = renderer->pixelToScreenCoords(object->position());
-                        painter.save();
-                        painter.translate(origin);
-                        painter.rotate(object->rotation());
-                        painter.translate(-origin);
-                    }
+        if (progress.wasCanceled() && !thread.isCancelled())
+            thread.cancel();
+    }
 
-                    const QColor color = MapObjectItem::objectColor(object);
-                    renderer->drawMapObject(&painter, object, color);
+    progress.reset();
+#else
+    thread.render();
+#endif
 
-                    if (object->rotation() != qreal(0))
-                        painter.restore();
-                }
-            }
-        } else if (imageLayer) {
-            renderer->drawImageLayer(&painter, imageLayer);
-        }
-    }
+    if (!thread.isSaved()) {
+        if (thread.isCancelled())
+            return;
 
-    if (drawTileGrid) {
-        Preferences *prefs = Preferences::instance();
-        renderer->drawGrid(&painter, QRectF(QPointF(), renderer->mapSize()),
-                           prefs->gridColor());
+        QMessageBox::critical(this,
+                              tr("Export as Image"),
+                              tr("Error while writing %1.")
+                              .arg(QFileInfo(fileName).fileName()));
+        return;
     }
 
-    // Restore the previous render flags
-    renderer->setFlags(renderFlags);
-
-    image.save(fileName);
     mPath = QFileInfo(fileName).path();
 
     // Store settings for next time
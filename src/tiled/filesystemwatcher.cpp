@@ -27,6 +27,12 @@
 
 using namespace Tiled::Internal;
 
+/**
+ * The time in milliseconds without further changes after which the changes
+ * are reported.
+ */
+static const int SettleTime = 500;
+
 FileSystemWatcher::FileSystemWatcher(QObject *parent) :
     QObject(parent),
     mWatcher(new QFileSystemWatcher(this))
@@ -35,6 +41,10 @@ FileSystemWatcher::FileSystemWatcher(QObject *parent) :
             SLOT(onFileChanged(QString)));
     connect(mWatcher, SIGNAL(directoryChanged(QString)),
             SLOT(onDirectoryChanged(QString)));
+
+    mSettleTimer.setInterval(SettleTime);
+    mSettleTimer.setSingleShot(true);
+    connect(&mSettleTimer, SIGNAL(timeout()), SLOT(changesSettled()));
 }
 
 void FileSystemWatcher::addPath(const QString &path)
@@ -68,6 +78,8 @@ void FileSystemWatcher::removePath(const QString &path)
     if (entry.value() == 0) {
         mWatchCount.erase(entry);
         mWatcher->removePath(path);
+        mChangedFiles.remove(path);
+        mChangedDirectories.remove(path);
     }
 }
 
@@ -80,10 +92,34 @@ void FileSystemWatcher::onFileChanged(const QString &path)
         if (QFile::exists(path))
             mWatcher->addPath(path);
 
-    emit fileChanged(path);
+    mChangedFiles.insert(path);
+    mSettleTimer.start();
 }
 
 void FileSystemWatcher::onDirectoryChanged(const QString &path)
 {
-    emit directoryChanged(path);
+    mChangedDirectories.insert(path);
+    mSettleTimer.start();
+}
+
+void FileSystemWatcher::changesSettled()
+{
+    const QStringList files = mChangedFiles.toList();
+    const QStringList directories = mChangedDirectories.toList();
+    mChangedFiles.clear();
+    mChangedDirectories.clear();
+
+    // Files that were still missing when they changed may be back by now
+    foreach (const QString &path, files)
+        if (mWatchCount.contains(path) && !mWatcher->files().contains(path))
+            if (QFile::exists(path))
+                mWatcher->addPath(path);
+
+    if (!files.isEmpty())
+        emit filesChanged(files);
+
+    foreach (const QString &path, files)
+        emit fileChanged(path);
+    foreach (const QString &path, directories)
+        emit directoryChanged(path);
 }
@@ -23,6 +23,9 @@
 
 #include <QMap>
 #include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
 
 class QFileSystemWatcher;
 
@@ -34,6 +37,12 @@ namespace Internal {
  * watched multiple times. It also doesn't start complaining when a file
  * doesn't exist.
  *
+ * Changes are coalesced: the changed paths are collected until no further
+ * changes have come in for a moment, and are then reported once each, as a
+ * single batch. This avoids reacting to every intermediate write of an
+ * application that saves a file in several steps, or of a tool that
+ * exports many files at once.
+ *
  * It's meant to be used as drop-in replacement for QFileSystemWatcher.
  */
 class FileSystemWatcher : public QObject
@@ -50,13 +59,24 @@ signals:
     void fileChanged(const QString &path);
     void directoryChanged(const QString &path);
 
+    /**
+     * Emitted once the changes have settled, with each of the files that
+     * changed in the meantime. Emitted before the individual fileChanged
+     * signals.
+     */
+    void filesChanged(const QStringList &paths);
+
 private slots:
     void onFileChanged(const QString &path);
     void onDirectoryChanged(const QString &path);
+    void changesSettled();
 
 private:
     QFileSystemWatcher *mWatcher;
     QMap<QString, int> mWatchCount;
+    QSet<QString> mChangedFiles;
+    QSet<QString> mChangedDirectories;
+    QTimer mSettleTimer;
 };
 
 } // namespace Internal
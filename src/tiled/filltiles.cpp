@@ -21,6 +21,7 @@
 
 #include "filltiles.h"
 
+#include "mapdocument.h"
 #include "tilelayer.h"
 #include "tilepainter.h"
 
@@ -36,30 +37,48 @@ FillTiles::FillTiles(MapDocument *mapDocument,
     : QUndoCommand(QCoreApplication::translate("Undo Commands", "Fill Area"))
     , mMapDocument(mapDocument)
     , mTileLayer(tileLayer)
-    , mFillRegion(fillRegion)
-    , mOriginalCells(tileLayer->copy(mFillRegion))
-    , mFillStamp(static_cast<TileLayer*>(fillStamp->clone()))
 {
-}
+    const int w = fillStamp->width();
+    const int h = fillStamp->height();
+    if (w == 0 || h == 0)
+        return;
 
-FillTiles::~FillTiles()
-{
-    delete mOriginalCells;
-    delete mFillStamp;
+    // Repeat the stamp over the paintable part of the fill region, the same
+    // way as TilePainter::drawStamp does
+    QRegion region = fillRegion.intersected(mTileLayer->bounds());
+    const QRegion &selection = mMapDocument->selectedArea();
+    if (!selection.isEmpty())
+        region = mMapDocument->selectionMask().intersected(region);
+
+    const QRect regionBounds = region.boundingRect();
+
+    foreach (const QRect &rect, region.rects()) {
+        for (int y = rect.top(); y <= rect.bottom(); ++y) {
+            for (int x = rect.left(); x <= rect.right(); ++x) {
+                const int stampX = (x - regionBounds.left()) % w;
+                const int stampY = (y - regionBounds.top()) % h;
+                const Cell &cell = fillStamp->cellAt(stampX, stampY);
+                if (cell.isEmpty())
+                    continue;
+
+                const QPoint position(x, y);
+                const QPoint layerPosition = position - mTileLayer->position();
+                mChanges.append(position,
+                                mTileLayer->cellAt(layerPosition),
+                                cell);
+            }
+        }
+    }
 }
 
 void FillTiles::undo()
 {
-    const QRect boundingRect = mFillRegion.boundingRect();
     TilePainter painter(mMapDocument, mTileLayer);
-    painter.setCells(boundingRect.x(),
-                     boundingRect.y(),
-                     mOriginalCells,
-                     mFillRegion);
+    painter.applyChanges(mChanges, true);
 }
 
 void FillTiles::redo()
 {
     TilePainter painter(mMapDocument, mTileLayer);
-    painter.drawStamp(mFillStamp, mFillRegion);
+    painter.applyChanges(mChanges);
 }
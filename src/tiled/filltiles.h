@@ -21,6 +21,7 @@
 #ifndef FILLTILES_H
 #define FILLTILES_H
 
+#include "changedcells.h"
 #include "undocommands.h"
 
 #include <QRegion>
@@ -47,7 +48,6 @@ public:
               TileLayer *tileLayer,
               const QRegion &fillRegion,
               const TileLayer *fillStamp);
-    ~FillTiles();
 
     void undo();
     void redo();
@@ -55,9 +55,7 @@ public:
 private:
     MapDocument *mMapDocument;
     TileLayer *mTileLayer;
-    QRegion mFillRegion;
-    TileLayer *mOriginalCells;
-    TileLayer *mFillStamp;
+    ChangedCells mChanges;
 };
 
 } // namespace Internal
@@ -20,6 +20,8 @@
 
 #include "geometry.h"
 
+#include "regionbuilder.h"
+
 namespace Tiled {
 
 /**
@@ -143,22 +145,101 @@ QVector<QPoint> pointsOnLine(int x0, int y0, int x1, int y1)
 }
 
 /**
- * Checks if a given rectangle \a rect is coherent to another given \a region.
- * 'coherent' means that either the rectangle is overlapping the region or
- * the rectangle contains at least one tile, which is a direct neighbour
- * to a tile, which belongs to the region.
+ * Returns the root of the set that \a i belongs to, while making the path
+ * to it shorter for the next lookup.
  */
-static bool isCoherentTo(const QRect &rect, const QRegion &region)
+static int findRoot(QVector<int> &parents, int i)
 {
-    // check if the region is coherent at top or bottom
-    if (region.intersects(rect.adjusted(0, -1, 0, 1)))
-        return true;
+    while (parents.at(i) != i) {
+        parents[i] = parents.at(parents.at(i));
+        i = parents.at(i);
+    }
+    return i;
+}
 
-    // check if the region is coherent at left or right side
-    if (region.intersects(rect.adjusted(-1, 0, 1, 0)))
-        return true;
+static void unite(QVector<int> &parents, int a, int b)
+{
+    a = findRoot(parents, a);
+    b = findRoot(parents, b);
 
-    return false;
+    // Keep the lowest index as the root, so that the regions are numbered in
+    // the order of their first rectangle
+    if (a < b)
+        parents[b] = a;
+    else if (b < a)
+        parents[a] = b;
+}
+
+/**
+ * Determines the coherent regions formed by the given \a rects, which need
+ * to be sorted in y-x bands like the rectangles of a QRegion. Two
+ * rectangles are coherent when they overlap or when a tile of one is a
+ * direct neighbour of a tile of the other.
+ *
+ * Returns for each rectangle the index of the region it belongs to. The
+ * regions are numbered in the order of their first rectangle, and their
+ * amount is stored in \a regionCount.
+ *
+ * Only rectangles within the same band and within bands directly following
+ * each other are compared, so this runs in near-linear time.
+ */
+QVector<int> coherentRegionIndices(const QVector<QRect> &rects,
+                                   int *regionCount)
+{
+    const int count = rects.size();
+
+    QVector<int> parents(count);
+    for (int i = 0; i < count; ++i)
+        parents[i] = i;
+
+    int previousBand = 0;
+    int bandStart = 0;
+    while (bandStart < count) {
+        const int top = rects.at(bandStart).top();
+        int bandEnd = bandStart + 1;
+        while (bandEnd < count && rects.at(bandEnd).top() == top)
+            ++bandEnd;
+
+        // Rectangles touching each other within the band
+        for (int i = bandStart + 1; i < bandEnd; ++i)
+            if (rects.at(i - 1).right() + 1 >= rects.at(i).left())
+                unite(parents, i - 1, i);
+
+        // Rectangles touching the band above, if it directly precedes
+        if (bandStart > 0 && rects.at(previousBand).bottom() + 1 == top) {
+            int a = previousBand;
+            int b = bandStart;
+            while (a < bandStart && b < bandEnd) {
+                const QRect &above = rects.at(a);
+                const QRect &below = rects.at(b);
+
+                if (above.left() <= below.right() &&
+                        below.left() <= above.right())
+                    unite(parents, a, b);
+
+                if (above.right() < below.right())
+                    ++a;
+                else
+                    ++b;
+            }
+        }
+
+        previousBand = bandStart;
+        bandStart = bandEnd;
+    }
+
+    // Number the regions by the order of their roots
+    QVector<int> indices(count);
+    int regions = 0;
+    for (int i = 0; i < count; ++i) {
+        const int root = findRoot(parents, i);
+        indices[i] = root == i ? regions++ : indices.at(root);
+    }
+
+    if (regionCount)
+        *regionCount = regions;
+
+    return indices;
 }
 
 /**
@@ -167,28 +248,19 @@ static bool isCoherentTo(const QRect &rect, const QRegion &region)
  */
 QList<QRegion> coherentRegions(const QRegion &region)
 {
+    const QVector<QRect> rects = region.rects();
+
+    int regionCount;
+    const QVector<int> indices = coherentRegionIndices(rects, &regionCount);
+
+    // Each region gets its rectangles in the same banded order
+    QVector<RegionBuilder> builders(regionCount);
+    for (int i = 0; i < rects.size(); ++i)
+        builders[indices.at(i)].addRect(rects.at(i));
+
     QList<QRegion> result;
-    QVector<QRect> rects = region.rects();
-
-    while (!rects.isEmpty()) {
-        QRegion newCoherentRegion = rects.last();
-        rects.pop_back();
-
-        // Add up all coherent rects until there is no rect left which is
-        // coherent to the newly created region.
-        bool foundRect = true;
-        while (foundRect) {
-            foundRect = false;
-            for (int i = rects.size() - 1; i >= 0; --i) {
-                if (isCoherentTo(rects.at(i), newCoherentRegion)) {
-                    newCoherentRegion += rects.at(i);
-                    rects.remove(i);
-                    foundRect = true;
-                }
-            }
-        }
-        result += newCoherentRegion;
-    }
+    for (int i = 0; i < regionCount; ++i)
+        result.append(builders[i].region());
     return result;
 }
 
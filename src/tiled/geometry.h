@@ -33,6 +33,8 @@ QVector<QPoint> pointsOnLine(int x0, int y0, int x1, int y1);
 inline QVector<QPoint> pointsOnLine(QPoint a, QPoint b)
 { return pointsOnLine(a.x(), a.y(), b.x(), b.y()); }
 
+QVector<int> coherentRegionIndices(const QVector<QRect> &rects,
+                                   int *regionCount);
 QList<QRegion> coherentRegions(const QRegion &region);
 
 } // namespace Tiled
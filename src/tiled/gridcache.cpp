@@ -0,0 +1,186 @@
+/*
+ * gridcache.cpp
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gridcache.h"
+
+#include "map.h"
+#include "maprenderer.h"
+
+#include <QPainter>
+#include <QPicture>
+#include <QtCore/qmath.h>
+
+using namespace Tiled;
+using namespace Tiled::Internal;
+
+// The size in pixels of the chunks in which the grid is recorded
+static const int chunkSize = 512;
+
+// The maximum amount of memory used by the recorded chunks
+static const int maxChunksCost = 16 * 1024 * 1024;
+
+// The smallest size of a tile in device pixels for which a pattern is used
+static const int minPatternTileSize = 2;
+
+static bool isWhole(qreal value)
+{
+    return qFuzzyCompare(value, qreal(qRound(value)));
+}
+
+GridCache::GridCache()
+    : mRenderer(0)
+    , mPatternScale(0)
+    , mChunks(CacheManager::GridChunks, 0, maxChunksCost)
+{
+}
+
+GridCache::~GridCache()
+{
+}
+
+void GridCache::draw(QPainter *painter,
+                     const MapRenderer *renderer,
+                     const QRectF &rect,
+                     const QColor &color)
+{
+    if (renderer != mRenderer || color != mColor) {
+        clear();
+        mRenderer = renderer;
+        mColor = color;
+    }
+
+    if (renderer->map()->orientation() == Map::Orthogonal) {
+        if (!drawPattern(painter, rect))
+            renderer->drawGrid(painter, rect, color);
+    } else {
+        drawChunks(painter, rect);
+    }
+}
+
+void GridCache::clear()
+{
+    mPattern = QPixmap();
+    mPatternScale = 0;
+    mChunks.clear();
+}
+
+/**
+ * Fills the exposed part of the map with a pattern containing the grid of a
+ * single tile. Returns false when the pattern would not line up with the
+ * tiles at the current transformation.
+ */
+bool GridCache::drawPattern(QPainter *painter, const QRectF &rect)
+{
+    const Map *map = mRenderer->map();
+    const QTransform transform = painter->worldTransform();
+
+    if (transform.type() > QTransform::TxScale)
+        return false;
+
+    const qreal scale = transform.m11();
+    if (scale <= 0 || !qFuzzyCompare(scale, transform.m22()))
+        return false;
+
+    const qreal tileWidth = map->tileWidth() * scale;
+    const qreal tileHeight = map->tileHeight() * scale;
+    if (!isWhole(tileWidth) || !isWhole(tileHeight) ||
+            !isWhole(transform.dx()) || !isWhole(transform.dy()))
+        return false;
+
+    const int patternWidth = qRound(tileWidth);
+    const int patternHeight = qRound(tileHeight);
+    if (patternWidth < minPatternTileSize || patternHeight < minPatternTileSize)
+        return false;
+
+    if (mPattern.isNull() || scale != mPatternScale) {
+        mPattern = QPixmap(patternWidth, patternHeight);
+        mPattern.fill(Qt::transparent);
+
+        QColor gridColor = mColor;
+        gridColor.setAlpha(128);
+
+        QPen gridPen(gridColor);
+        gridPen.setCosmetic(true);
+        gridPen.setDashPattern(QVector<qreal>() << 2 << 2);
+
+        QPainter patternPainter(&mPattern);
+        patternPainter.setPen(gridPen);
+        patternPainter.drawLine(0, 0, 0, patternHeight - 1);
+        patternPainter.drawLine(0, 0, patternWidth - 1, 0);
+        patternPainter.end();
+
+        mPatternScale = scale;
+    }
+
+    // The grid includes the lines along the right and bottom edges of the map
+    const QPoint origin(qRound(transform.dx()), qRound(transform.dy()));
+    const QRect mapRect(origin, QSize(map->width() * patternWidth + 1,
+                                      map->height() * patternHeight + 1));
+    const QRect exposed = transform.mapRect(rect).toAlignedRect() & mapRect;
+    if (exposed.isEmpty())
+        return true;
+
+    painter->save();
+    painter->resetTransform();
+    painter->setBrushOrigin(origin);
+    painter->fillRect(exposed, QBrush(mPattern));
+    painter->restore();
+
+    return true;
+}
+
+/**
+ * Replays the recorded grid of the chunks overlapping \a rect, recording
+ * those that are not in the cache yet. Each chunk is clipped to its own area,
+ * since the grid lines of the tiles along its edges extend beyond it.
+ */
+void GridCache::drawChunks(QPainter *painter, const QRectF &rect)
+{
+    const int startX = qFloor(rect.left() / chunkSize);
+    const int startY = qFloor(rect.top() / chunkSize);
+    const int endX = qFloor(rect.right() / chunkSize);
+    const int endY = qFloor(rect.bottom() / chunkSize);
+
+    for (int y = startY; y <= endY; ++y) {
+        for (int x = startX; x <= endX; ++x) {
+            const QRect chunkRect(x * chunkSize, y * chunkSize,
+                                  chunkSize, chunkSize);
+            const ChunkKey key(x, y);
+
+            QPicture *picture = mChunks.object(key);
+            const bool cached = picture != 0;
+            if (!cached) {
+                picture = new QPicture;
+                QPainter picturePainter(picture);
+                mRenderer->drawGrid(&picturePainter, chunkRect, mColor);
+                picturePainter.end();
+            }
+
+            painter->save();
+            painter->setClipRect(QRectF(chunkRect) & rect, Qt::IntersectClip);
+            painter->drawPicture(0, 0, *picture);
+            painter->restore();
+
+            // Inserted only after drawing, since the cache may delete it
+            if (!cached)
+                mChunks.insert(key, picture, qMax(1, int(picture->size())));
+        }
+    }
+}
@@ -0,0 +1,94 @@
+/*
+ * gridcache.h
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GRIDCACHE_H
+#define GRIDCACHE_H
+
+#include "cachemanager.h"
+
+#include <QColor>
+#include <QPair>
+#include <QPixmap>
+
+class QPainter;
+class QPicture;
+class QRectF;
+
+namespace Tiled {
+
+class MapRenderer;
+
+namespace Internal {
+
+/**
+ * Caches the tile grid of a map, so that it does not need to be computed
+ * again for each repaint.
+ *
+ * For orthogonal maps, the grid of a single tile is rendered to a pixmap
+ * that is used as a tiling pattern. Since this pattern is in device pixels,
+ * it is rendered again when the zoom level changes. For the other
+ * orientations, the grid is recorded in chunks that are replayed while
+ * painting.
+ */
+class GridCache
+{
+public:
+    GridCache();
+    ~GridCache();
+
+    /**
+     * Draws the grid of the map rendered by \a renderer within \a rect.
+     */
+    void draw(QPainter *painter,
+              const MapRenderer *renderer,
+              const QRectF &rect,
+              const QColor &color);
+
+    /**
+     * Clears the cache. Needs to be called when the size, orientation or
+     * tile size of the map changed.
+     */
+    void clear();
+
+    /**
+     * Sets the map document whose grid is cached, so that the cache can be
+     * dropped first while the document is in the background.
+     */
+    void setMapDocument(MapDocument *mapDocument)
+    { mChunks.setCacheDocument(mapDocument); }
+
+private:
+    bool drawPattern(QPainter *painter, const QRectF &rect);
+    void drawChunks(QPainter *painter, const QRectF &rect);
+
+    const MapRenderer *mRenderer;
+    QColor mColor;
+
+    QPixmap mPattern;
+    qreal mPatternScale;
+
+    typedef QPair<int, int> ChunkKey;
+    ManagedCache<ChunkKey, QPicture> mChunks;
+};
+
+} // namespace Internal
+} // namespace Tiled
+
+#endif // GRIDCACHE_H
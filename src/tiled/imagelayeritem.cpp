@@ -24,16 +24,40 @@
 #include "imagelayer.h"
 #include "mapdocument.h"
 #include "maprenderer.h"
+#include "paintstatistics.h"
 
 #include <QPainter>
 #include <QStyleOptionGraphicsItem>
+#include <QtCore/qmath.h>
 
 using namespace Tiled;
 using namespace Tiled::Internal;
 
+namespace {
+
+// The width and height of a cached tile, in pixels of its level
+const int TileSize = 512;
+
+// Images up to this size, in pixels, are drawn directly
+const int MaxDirectPixels = 2048;
+
+// The amount of pixmap memory each layer may use for its cache, in KB
+const int MaxCacheCost = 64 * 1024;
+
+inline quint64 tileKey(int level, int x, int y)
+{
+    return (quint64(level) << 48) |
+            (quint64(quint32(y) & 0xFFFFFF) << 24) |
+            (quint32(x) & 0xFFFFFF);
+}
+
+} // anonymous namespace
+
 ImageLayerItem::ImageLayerItem(ImageLayer *layer, MapDocument *mapDocument)
     : mLayer(layer)
     , mMapDocument(mapDocument)
+    , mTiles(CacheManager::ImageLayerTiles, mapDocument, MaxCacheCost, 1024)
+    , mSourceKey(0)
 {
     setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
 
@@ -45,6 +69,7 @@ void ImageLayerItem::syncWithImageLayer()
 {
     prepareGeometryChange();
     mBoundingRect = mMapDocument->renderer()->boundingRect(mLayer);
+    invalidateCache();
 }
 
 QRectF ImageLayerItem::boundingRect() const
@@ -57,6 +82,117 @@ void ImageLayerItem::paint(QPainter *painter,
                            QWidget *)
 {
     // TODO: Display a border around the layer when selected
+    LayerPaintTimer paintTimer(mLayer);
+
+    if (drawTiles(painter, option))
+        return;
+
     MapRenderer *renderer = mMapDocument->renderer();
     renderer->drawImageLayer(painter, mLayer, option->exposedRect);
 }
+
+/**
+ * Draws the exposed part of a large image from the tile cache. Returns false
+ * when the image is small enough to be drawn directly, or when the painter
+ * is rotated or sheared.
+ */
+bool ImageLayerItem::drawTiles(QPainter *painter,
+                               const QStyleOptionGraphicsItem *option)
+{
+    const QPixmap &image = mLayer->image();
+    if (image.width() <= MaxDirectPixels && image.height() <= MaxDirectPixels)
+        return false;
+    if (painter->worldTransform().type() > QTransform::TxScale)
+        return false;
+
+    // The image may have been replaced without the item being synced
+    if (image.cacheKey() != mSourceKey)
+        invalidateCache();
+
+    const QRectF exposed = option->exposedRect & mBoundingRect;
+    if (exposed.isEmpty())
+        return true;
+
+    // Use the smallest level that still has at least one pixel per pixel on
+    // the screen
+    const qreal scale =
+            option->levelOfDetailFromTransform(painter->worldTransform());
+    int level = 0;
+    while (level < 16 && scale * (2 << level) <= 1 &&
+           (image.width() >> (level + 1)) > 0 &&
+           (image.height() >> (level + 1)) > 0)
+        ++level;
+
+    const QPointF origin = mBoundingRect.topLeft();
+    const QRectF area = exposed.translated(-origin);
+    const int span = TileSize << level;     // tile size in image pixels
+
+    const int startX = qMax(0, qFloor(area.left() / span));
+    const int startY = qMax(0, qFloor(area.top() / span));
+    const int endX = qMin((image.width() - 1) / span, qFloor(area.right() / span));
+    const int endY = qMin((image.height() - 1) / span, qFloor(area.bottom() / span));
+
+    for (int y = startY; y <= endY; ++y) {
+        for (int x = startX; x <= endX; ++x) {
+            const QPixmap *pixmap = tile(level, x, y);
+            if (!pixmap)
+                continue;
+
+            const QRect source = QRect(x * span, y * span, span, span) &
+                    image.rect();
+            painter->drawPixmap(QRectF(source).translated(origin), *pixmap,
+                                QRectF(pixmap->rect()));
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Returns the tile at \a x, \a y of the given \a level, creating it when
+ * it isn't cached yet.
+ */
+const QPixmap *ImageLayerItem::tile(int level, int x, int y)
+{
+    const quint64 key = tileKey(level, x, y);
+    if (const QPixmap *pixmap = mTiles.object(key))
+        return pixmap;
+
+    if (mSource.isNull()) {
+        mSource = mLayer->imageData();
+        if (mSource.depth() != 32)
+            mSource = mSource.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    }
+
+    const int span = TileSize << level;
+    const QRect source = QRect(x * span, y * span, span, span) & mSource.rect();
+    if (source.isEmpty())
+        return 0;
+
+    // Refer to the part of the image without copying it
+    const QImage part(mSource.constScanLine(source.top()) + source.left() * 4,
+                      source.width(), source.height(),
+                      mSource.bytesPerLine(), mSource.format());
+
+    const QSize size(qMax(1, source.width() >> level),
+                     qMax(1, source.height() >> level));
+
+    QPixmap *pixmap;
+    if (level == 0)
+        pixmap = new QPixmap(QPixmap::fromImage(part.copy()));
+    else
+        pixmap = new QPixmap(QPixmap::fromImage(part.scaled(size,
+                                                            Qt::IgnoreAspectRatio,
+                                                            Qt::SmoothTransformation)));
+
+    const int cost = pixmap->width() * pixmap->height() * 4 / 1024;
+    mTiles.insert(key, pixmap, qMax(cost, 1));
+    return mTiles.object(key);
+}
+
+void ImageLayerItem::invalidateCache()
+{
+    mTiles.clear();
+    mSource = QImage();
+    mSourceKey = mLayer->image().cacheKey();
+}
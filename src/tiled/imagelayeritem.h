@@ -22,7 +22,11 @@
 #ifndef IMAGELAYERITEM_H
 #define IMAGELAYERITEM_H
 
+#include "cachemanager.h"
+
 #include <QGraphicsItem>
+#include <QImage>
+#include <QPixmap>
 
 namespace Tiled {
 
@@ -63,9 +67,24 @@ public:
                QWidget *widget = 0);
 
 private:
+    bool drawTiles(QPainter *painter,
+                   const QStyleOptionGraphicsItem *option);
+    const QPixmap *tile(int level, int x, int y);
+    void invalidateCache();
+
     ImageLayer *mLayer;
     MapDocument *mMapDocument;
     QRectF mBoundingRect;
+
+    /**
+     * The image is cached in tiles of a fixed size, at the power of two
+     * downscaled level that fits the scale of the painter. Only the tiles
+     * that have been visible are kept, so that zooming out of a huge image
+     * doesn't require scaling or uploading all of it.
+     */
+    ManagedCache<quint64, QPixmap> mTiles;
+    QImage mSource;
+    qint64 mSourceKey;
 };
 
 } // namespace Internal
@@ -123,6 +123,8 @@ void LayerDock::setMapDocument(MapDocument *mapDocument)
                 this, SLOT(updateOpacitySlider()));
         connect(mMapDocument, SIGNAL(layerChanged(int)),
                 this, SLOT(layerChanged(int)));
+        connect(mMapDocument, SIGNAL(layersChanged(QList<int>)),
+                this, SLOT(layersChanged(QList<int>)));
         connect(mMapDocument, SIGNAL(editLayerNameRequested()),
                 this, SLOT(editLayerName()));
     }
@@ -173,6 +175,12 @@ void LayerDock::layerChanged(int index)
     updateOpacitySlider();
 }
 
+void LayerDock::layersChanged(const QList<int> &indexes)
+{
+    if (indexes.contains(mMapDocument->currentLayerIndex()))
+        layerChanged(mMapDocument->currentLayerIndex());
+}
+
 void LayerDock::editLayerName()
 {
     if (!isVisible())
@@ -62,6 +62,7 @@ protected:
 private slots:
     void updateOpacitySlider();
     void layerChanged(int index);
+    void layersChanged(const QList<int> &indexes);
     void editLayerName();
     void sliderValueChanged(int opacity);
 
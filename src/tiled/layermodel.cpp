@@ -27,6 +27,8 @@
 #include "renamelayer.h"
 #include "tilelayer.h"
 
+#include <QtAlgorithms>
+
 using namespace Tiled;
 using namespace Tiled::Internal;
 
@@ -34,6 +36,7 @@ LayerModel::LayerModel(QObject *parent):
     QAbstractListModel(parent),
     mMapDocument(0),
     mMap(0),
+    mLayerChangesDepth(0),
     mTileLayerIcon(QLatin1String(":/images/16x16/layer-tile.png")),
     mObjectGroupIcon(QLatin1String(":/images/16x16/layer-object.png")),
     mImageLayerIcon(QLatin1String(":/images/16x16/layer-image.png"))
@@ -185,18 +188,16 @@ Layer *LayerModel::takeLayerAt(int index)
 
 void LayerModel::setLayerVisible(int layerIndex, bool visible)
 {
-    const QModelIndex modelIndex = index(layerIndexToRow(layerIndex), 0);
     Layer *layer = mMap->layerAt(layerIndex);
     layer->setVisible(visible);
-    emit dataChanged(modelIndex, modelIndex);
-    emit layerChanged(layerIndex);
+    emitLayerChanged(layerIndex);
 }
 
 void LayerModel::setLayerOpacity(int layerIndex, float opacity)
 {
     Layer *layer = mMap->layerAt(layerIndex);
     layer->setOpacity(opacity);
-    emit layerChanged(layerIndex);
+    emitLayerChanged(layerIndex);
 }
 
 void LayerModel::renameLayer(int layerIndex, const QString &name)
@@ -227,19 +228,56 @@ void LayerModel::toggleOtherLayers(int layerIndex)
         }
     }
 
-    QUndoStack *undoStack = mMapDocument->undoStack();
-    if (visibility)
-        undoStack->beginMacro(tr("Show Other Layers"));
-    else
-        undoStack->beginMacro(tr("Hide Other Layers"));
-
+    QList<int> layerIndexes;
     for (int i = 0; i < mMap->layerCount(); i++) {
         if (i == layerIndex)
             continue;
 
         if (visibility != mMap->layerAt(i)->isVisible())
-            undoStack->push(new SetLayerVisible(mMapDocument, i, visibility));
+            layerIndexes.append(i);
     }
 
-    undoStack->endMacro();
+    // A single command, so that the views are updated only once
+    SetLayersVisible *command = new SetLayersVisible(mMapDocument,
+                                                     layerIndexes,
+                                                     visibility);
+    if (visibility)
+        command->setText(tr("Show Other Layers"));
+    else
+        command->setText(tr("Hide Other Layers"));
+
+    mMapDocument->undoStack()->push(command);
+}
+
+void LayerModel::beginLayerChanges()
+{
+    ++mLayerChangesDepth;
+}
+
+void LayerModel::endLayerChanges()
+{
+    Q_ASSERT(mLayerChangesDepth > 0);
+    if (--mLayerChangesDepth > 0 || mChangedLayers.isEmpty())
+        return;
+
+    QList<int> indexes = mChangedLayers.toList();
+    mChangedLayers.clear();
+    qSort(indexes);
+
+    // The rows are in reverse order of the layers
+    emit dataChanged(index(layerIndexToRow(indexes.last()), 0),
+                     index(layerIndexToRow(indexes.first()), 0));
+    emit layersChanged(indexes);
+}
+
+void LayerModel::emitLayerChanged(int layerIndex)
+{
+    if (mLayerChangesDepth > 0) {
+        mChangedLayers.insert(layerIndex);
+        return;
+    }
+
+    const QModelIndex modelIndex = index(layerIndexToRow(layerIndex), 0);
+    emit dataChanged(modelIndex, modelIndex);
+    emit layerChanged(layerIndex);
 }
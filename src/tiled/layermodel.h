@@ -23,6 +23,7 @@
 
 #include <QAbstractListModel>
 #include <QIcon>
+#include <QSet>
 
 namespace Tiled {
 
@@ -139,6 +140,20 @@ public:
       */
     void toggleOtherLayers(int layerIndex);
 
+    /**
+     * Starts a set of changes to the visibility or opacity of several
+     * layers. Until the matching endLayerChanges(), the changed layers are
+     * only recorded. Calls may be nested.
+     */
+    void beginLayerChanges();
+
+    /**
+     * Ends a set of layer changes started with beginLayerChanges(). Emits a
+     * single dataChanged signal covering the changed rows, followed by a
+     * single layersChanged signal.
+     */
+    void endLayerChanges();
+
 signals:
     void layerAdded(int index);
     void layerAboutToBeRemoved(int index);
@@ -147,9 +162,20 @@ signals:
     void layerRenamed(int index);
     void layerChanged(int index);
 
+    /**
+     * Emitted at the end of a set of layer changes, with the sorted indexes
+     * of the layers that changed. No layerChanged signal is emitted for
+     * these layers.
+     */
+    void layersChanged(const QList<int> &indexes);
+
 private:
+    void emitLayerChanged(int layerIndex);
+
     MapDocument *mMapDocument;
     Map *mMap;
+    int mLayerChangesDepth;
+    QSet<int> mChangedLayers;
 
     QIcon mTileLayerIcon;
     QIcon mObjectGroupIcon;
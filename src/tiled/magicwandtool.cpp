@@ -66,16 +66,27 @@ void MagicWandTool::mousePressed(QGraphicsSceneMouseEvent *event)
 
     MapDocument *document = mapDocument();
 
-    QRegion selection = document->selectedArea();
-
-    if (modifiers == Qt::ShiftModifier)
-        selection += mSelectedRegion;
-    else if (modifiers == Qt::ControlModifier)
-        selection -= mSelectedRegion;
-    else if (modifiers == (Qt::ControlModifier | Qt::ShiftModifier))
-        selection &= mSelectedRegion;
-    else
+    // Combining the regions is done using masks, since the noisy regions
+    // selected by the magic wand can consist of a great many rectangles
+    QRegion selection;
+
+    if (modifiers == Qt::NoModifier) {
         selection = mSelectedRegion;
+    } else {
+        RegionMask mask = document->selectionMask();
+        const RegionMask selectedMask(mSelectedRegion);
+
+        if (modifiers == Qt::ShiftModifier)
+            mask |= selectedMask;
+        else if (modifiers == Qt::ControlModifier)
+            mask -= selectedMask;
+        else if (modifiers == (Qt::ControlModifier | Qt::ShiftModifier))
+            mask &= selectedMask;
+        else
+            mask = selectedMask;
+
+        selection = mask.toRegion();
+    }
 
     if (selection != document->selectedArea()) {
         QUndoCommand *cmd = new ChangeSelectedArea(document, selection);
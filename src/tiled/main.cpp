@@ -20,23 +20,53 @@
  * this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "automappingmanager.h"
+#include "collisionmerger.h"
 #include "commandlineparser.h"
+#include "documentmanager.h"
+#include "imagecache.h"
 #include "mainwindow.h"
 #include "languagemanager.h"
+#include "layer.h"
+#include "layerexportcache.h"
 #include "pluginmanager.h"
+#include "map.h"
+#include "mapcellcache.h"
 #include "mapdocument.h"
 #include "mapreader.h"
+#include "mapobject.h"
 #include "mapwriterinterface.h"
+#include "objectgroup.h"
+#include "paintstatistics.h"
 #include "preferences.h"
+#include "tileatlas.h"
 #include "tiledapplication.h"
+#include "tilelayer.h"
 #include "tileset.h"
+#include "trace.h"
 
 #include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
 #include <QFileInfo>
+#include <QHash>
+#include <QSet>
+#include <QTextStream>
+#include <QVector>
 #include <QtPlugin>
+#include <QtCore/qmath.h>
 #include <QStyle>
 #include <QStyleFactory>
 
+#include <cstdio>
+
+#if QT_VERSION >= 0x050000
+#include <QStandardPaths>
+#else
+#include <QDesktopServices>
+#endif
+
 #ifdef STATIC_BUILD
 Q_IMPORT_PLUGIN(qgif)
 Q_IMPORT_PLUGIN(qjpeg)
@@ -59,12 +89,32 @@ public:
     bool showedVersion;
     bool disableOpenGL;
     bool exportMap;
+    bool stripUnusedTilesets;
+    bool packAtlas;
+    bool mergeCollisions;
+    bool cropToContent;
+    bool autoMap;
+    bool paintStatistics;
+    bool startupStatistics;
+    bool memoryUsage;
+    bool tileStatistics;
+    bool benchmarkStartup;
 
 private:
     void showVersion();
     void justQuit();
     void setDisableOpenGL();
     void setExportMap();
+    void setStripUnusedTilesets();
+    void setPackAtlas();
+    void setMergeCollisions();
+    void setCropToContent();
+    void setAutoMap();
+    void setPaintStatistics();
+    void setStartupStatistics();
+    void setMemoryUsage();
+    void setTileStatistics();
+    void setBenchmarkStartup();
 
     // Convenience wrapper around registerOption
     template <void (CommandLineHandler::*memberFunction)()>
@@ -87,6 +137,16 @@ CommandLineHandler::CommandLineHandler()
     , showedVersion(false)
     , disableOpenGL(false)
     , exportMap(false)
+    , stripUnusedTilesets(false)
+    , packAtlas(false)
+    , mergeCollisions(false)
+    , cropToContent(false)
+    , autoMap(false)
+    , paintStatistics(false)
+    , startupStatistics(false)
+    , memoryUsage(false)
+    , benchmarkStartup(false)
+    , tileStatistics(false)
 {
     option<&CommandLineHandler::showVersion>(
                 QLatin1Char('v'),
@@ -106,7 +166,57 @@ CommandLineHandler::CommandLineHandler()
     option<&CommandLineHandler::setExportMap>(
                 QChar(),
                 QLatin1String("--export-map"),
-                QLatin1String("Export the specified tmx file to target"));
+                QLatin1String("Export the specified tmx files to their targets"));
+
+    option<&CommandLineHandler::setStripUnusedTilesets>(
+                QChar(),
+                QLatin1String("--strip-unused-tilesets"),
+                QLatin1String("Leave out the tilesets that are not used when exporting"));
+
+    option<&CommandLineHandler::setPackAtlas>(
+                QChar(),
+                QLatin1String("--pack-atlas"),
+                QLatin1String("Also pack the used tiles of image collection tilesets into an atlas when exporting"));
+
+    option<&CommandLineHandler::setMergeCollisions>(
+                QChar(),
+                QLatin1String("--merge-collisions"),
+                QLatin1String("Add an object layer with the merged tile collision shapes of each tile layer when exporting"));
+
+    option<&CommandLineHandler::setCropToContent>(
+                QChar(),
+                QLatin1String("--crop-to-content"),
+                QLatin1String("Crop the maps to the area used by their tiles and objects when exporting"));
+
+    option<&CommandLineHandler::setAutoMap>(
+                QChar(),
+                QLatin1String("--automap"),
+                QLatin1String("Apply the rules file to each tmx file and save it to its target"));
+
+    option<&CommandLineHandler::setPaintStatistics>(
+                QChar(),
+                QLatin1String("--paint-statistics"),
+                QLatin1String("Show and log how long it takes to paint the map"));
+
+    option<&CommandLineHandler::setStartupStatistics>(
+                QChar(),
+                QLatin1String("--startup-statistics"),
+                QLatin1String("Log how long the stages of starting up take"));
+
+    option<&CommandLineHandler::setMemoryUsage>(
+                QChar(),
+                QLatin1String("--memory-usage"),
+                QLatin1String("Log the memory used by each layer and tileset of the maps"));
+
+    option<&CommandLineHandler::setTileStatistics>(
+                QChar(),
+                QLatin1String("--tile-statistics"),
+                QLatin1String("Log how often each tileset and tile is used and how full each tile layer is"));
+
+    option<&CommandLineHandler::setBenchmarkStartup>(
+                QChar(),
+                QLatin1String("--benchmark-startup"),
+                QLatin1String("Print how long starting up and opening each map takes as JSON, and quit"));
 }
 
 void CommandLineHandler::showVersion()
@@ -134,6 +244,841 @@ void CommandLineHandler::setExportMap()
     exportMap = true;
 }
 
+void CommandLineHandler::setStripUnusedTilesets()
+{
+    stripUnusedTilesets = true;
+}
+
+void CommandLineHandler::setPackAtlas()
+{
+    packAtlas = true;
+}
+
+void CommandLineHandler::setMergeCollisions()
+{
+    mergeCollisions = true;
+}
+
+void CommandLineHandler::setCropToContent()
+{
+    cropToContent = true;
+}
+
+void CommandLineHandler::setAutoMap()
+{
+    autoMap = true;
+}
+
+void CommandLineHandler::setPaintStatistics()
+{
+    paintStatistics = true;
+}
+
+void CommandLineHandler::setStartupStatistics()
+{
+    startupStatistics = true;
+}
+
+void CommandLineHandler::setMemoryUsage()
+{
+    memoryUsage = true;
+}
+
+void CommandLineHandler::setTileStatistics()
+{
+    tileStatistics = true;
+}
+
+void CommandLineHandler::setBenchmarkStartup()
+{
+    benchmarkStartup = true;
+}
+
+static QElapsedTimer startupTimer;
+static bool logStartup = false;
+
+/**
+ * Logs the time since the application started, when enabled with
+ * --startup-statistics.
+ */
+static void logStartupTime(const char *stage)
+{
+    if (logStartup)
+        qWarning("Startup: %s after %lld ms", stage, startupTimer.elapsed());
+}
+
+namespace {
+
+/**
+ * Times the consecutive phases of starting up and opening maps, for
+ * --benchmark-startup. The phases are also added to the trace when one is
+ * being recorded, so that they can be seen around the scopes they contain.
+ */
+class StartupBenchmark
+{
+public:
+    StartupBenchmark()
+        : mTraceStart(-1)
+    {}
+
+    /**
+     * Starts timing the next phase.
+     */
+    void start()
+    {
+        mTimer.start();
+#ifndef TILED_NO_TRACING
+        mTraceStart = Tiled::Tracer::isEnabled() ? Tiled::Tracer::timestamp() : -1;
+#endif
+    }
+
+    /**
+     * Records the phase \a name, which took the time since the last phase,
+     * and starts timing the next one. The \a fileName is given for the
+     * phases of opening a map.
+     */
+    void finish(const char *name,
+                const QString &fileName = QString(),
+                bool success = true)
+    {
+        Phase phase;
+        phase.name = name;
+        phase.fileName = fileName;
+        phase.nsecs = mTimer.nsecsElapsed();
+        phase.success = success;
+        mPhases.append(phase);
+
+#ifndef TILED_NO_TRACING
+        if (mTraceStart != -1)
+            Tiled::Tracer::addScope(name, mTraceStart,
+                                    Tiled::Tracer::timestamp() - mTraceStart,
+                                    fileName);
+#endif
+
+        start();
+    }
+
+    QByteArray toJson(const QString &version) const;
+
+private:
+    struct Phase {
+        const char *name;
+        QString fileName;
+        qint64 nsecs;
+        bool success;
+    };
+
+    QElapsedTimer mTimer;
+    qint64 mTraceStart;
+    QVector<Phase> mPhases;
+};
+
+} // anonymous namespace
+
+static QString jsonString(const QString &string)
+{
+    QString result = QLatin1String("\"");
+
+    foreach (const QChar c, string) {
+        if (c == QLatin1Char('"') || c == QLatin1Char('\\')) {
+            result += QLatin1Char('\\');
+            result += c;
+        } else if (c.unicode() < 0x20) {
+            result += QString(QLatin1String("\\u%1")).arg(c.unicode(), 4, 16,
+                                                           QLatin1Char('0'));
+        } else {
+            result += c;
+        }
+    }
+
+    result += QLatin1Char('"');
+    return result;
+}
+
+static QString milliseconds(qint64 nsecs)
+{
+    return QString::number(nsecs / 1000000.0, 'f', 3);
+}
+
+/**
+ * Returns the recorded phases and their total, in milliseconds.
+ */
+QByteArray StartupBenchmark::toJson(const QString &version) const
+{
+    QString json;
+    QTextStream out(&json);
+    qint64 total = 0;
+
+    out << "{\n";
+    out << "    \"version\": " << jsonString(version) << ",\n";
+    out << "    \"phases\": [";
+
+    for (int i = 0; i < mPhases.size(); ++i) {
+        const Phase &phase = mPhases.at(i);
+        total += phase.nsecs;
+
+        out << (i == 0 ? "\n" : ",\n");
+        out << "        { \"name\": " << jsonString(QLatin1String(phase.name));
+        if (!phase.fileName.isEmpty())
+            out << ", \"file\": " << jsonString(phase.fileName);
+        out << ", \"ms\": " << milliseconds(phase.nsecs);
+        if (!phase.success)
+            out << ", \"success\": false";
+        out << " }";
+    }
+
+    out << "\n    ],\n";
+    out << "    \"totalMs\": " << milliseconds(total) << "\n";
+    out << "}\n";
+    out.flush();
+
+    return json.toUtf8();
+}
+
+/**
+ * Opens each of the maps in \a files in the main window, timing the
+ * loading of each map separately from adding it to the editor. The maps are
+ * loaded on this thread and are not added to the recent files. Returns the
+ * exit code.
+ */
+static int benchmarkOpeningFiles(const QStringList &files,
+                                 StartupBenchmark &benchmark)
+{
+    DocumentManager *documentManager = DocumentManager::instance();
+    bool success = true;
+
+    foreach (const QString &fileName, files) {
+        benchmark.start();
+
+        QString error;
+        MapDocument *mapDocument = MapDocument::load(fileName, 0, &error);
+        benchmark.finish("MapDocument::load", fileName, mapDocument != 0);
+
+        if (!mapDocument) {
+            qWarning().nospace() << qPrintable(fileName) << ": "
+                                 << qPrintable(error);
+            success = false;
+            continue;
+        }
+
+        documentManager->addDocument(mapDocument);
+
+        // Includes laying out and painting the new map view
+        QApplication::processEvents();
+        benchmark.finish("DocumentManager::addDocument", fileName);
+    }
+
+    return success ? 0 : 1;
+}
+
+namespace {
+
+/**
+ * A map reader that keeps the external tilesets it has loaded, so that they
+ * are only loaded once when exporting several maps that share them.
+ */
+class ExportMapReader : public Tiled::MapReader
+{
+public:
+    ExportMapReader()
+    {
+        setParallelLayerDecoding(true);
+        setParallelImageDecoding(true);
+    }
+
+    ~ExportMapReader()
+    {
+        qDeleteAll(mTilesets);
+    }
+
+    /**
+     * Deletes the \a map along with its tilesets, except for the ones that
+     * are kept by this reader.
+     */
+    void deleteMap(Tiled::Map *map)
+    {
+        foreach (Tiled::Tileset *tileset, map->tilesets())
+            if (mTilesets.value(tileset->fileName()) != tileset)
+                delete tileset;
+
+        delete map;
+    }
+
+protected:
+    Tiled::Tileset *readExternalTileset(const QString &source, QString *error)
+    {
+        if (Tiled::Tileset *tileset = mTilesets.value(source))
+            return tileset;
+
+        // Loaded with a separate reader, since the tilesets created by this
+        // reader are deleted when reading a map fails
+        Tiled::MapReader reader;
+        reader.setImageLoading(isImageLoadingEnabled());
+        Tiled::Tileset *tileset = reader.readTileset(source);
+        if (tileset)
+            mTilesets.insert(source, tileset);
+        else
+            *error = reader.errorString();
+
+        return tileset;
+    }
+
+private:
+    QHash<QString, Tiled::Tileset*> mTilesets;
+};
+
+} // anonymous namespace
+
+static bool logMemory = false;
+
+/**
+ * Keeps the decoded tileset images and the cells of the maps on disk, so
+ * that they don't need to be decoded again when the editor is started the
+ * next time.
+ */
+static void setupDiskCaches()
+{
+#if QT_VERSION >= 0x050000
+    const QString cacheLocation =
+            QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+#else
+    const QString cacheLocation =
+            QDesktopServices::storageLocation(QDesktopServices::CacheLocation);
+#endif
+
+    if (cacheLocation.isEmpty())
+        return;
+
+    Tiled::ImageCache::setDiskCacheDirectory(cacheLocation +
+                                             QLatin1String("/images"));
+    Tiled::MapCellCache::setDirectory(cacheLocation +
+                                      QLatin1String("/mapcells"));
+}
+
+static QString formatSize(qint64 bytes)
+{
+    return QString::number(bytes / 1024.0, 'f', 1) + QLatin1String(" kB");
+}
+
+/**
+ * Logs the memory used by the \a map loaded from \a fileName, broken down by
+ * layer and by tileset, when enabled with --memory-usage.
+ */
+static void logMemoryUsage(const QString &fileName, const Tiled::Map *map)
+{
+    if (!logMemory)
+        return;
+
+    qint64 total = map->memoryUsage();
+    foreach (const Tiled::Tileset *tileset, map->tilesets())
+        total += tileset->memoryUsage();
+
+    qWarning("%s: %s", qPrintable(fileName), qPrintable(formatSize(total)));
+
+    foreach (const Tiled::Layer *layer, map->layers()) {
+        const char *type = "image layer";
+        if (layer->isTileLayer())
+            type = "tile layer";
+        else if (layer->isObjectGroup())
+            type = "object layer";
+
+        qWarning("    %s \"%s\": %s", type, qPrintable(layer->name()),
+                 qPrintable(formatSize(layer->memoryUsage())));
+    }
+
+    foreach (const Tiled::Tileset *tileset, map->tilesets()) {
+        qWarning("    tileset \"%s\": %s", qPrintable(tileset->name()),
+                 qPrintable(formatSize(tileset->memoryUsage())));
+    }
+}
+
+/**
+ * Logs the memory used by each of the maps in \a files. Returns the exit
+ * code.
+ */
+static int reportMemoryUsage(const QStringList &files)
+{
+    ExportMapReader reader;
+    bool success = true;
+
+    foreach (const QString &fileName, files) {
+        Tiled::Map *map = reader.readMap(fileName);
+        if (!map) {
+            qWarning().nospace() << qPrintable(fileName) << ": "
+                                 << qPrintable(reader.errorString());
+            success = false;
+            continue;
+        }
+
+        logMemoryUsage(fileName, map);
+        reader.deleteMap(map);
+    }
+
+    return success ? 0 : 1;
+}
+
+/**
+ * Logs how full each tile layer of the \a map loaded from \a fileName is,
+ * and how many cells use each of its tilesets and tiles. This uses the usage
+ * counts kept by the tile layers, like the Tile Statistics dock.
+ */
+static void logTileStatistics(const QString &fileName, const Tiled::Map *map)
+{
+    using namespace Tiled;
+
+    qWarning("%s:", qPrintable(fileName));
+
+    QHash<Tileset*, int> tilesetCounts;
+    QHash<Tile*, int> tileCounts;
+
+    foreach (const TileLayer *tileLayer, map->tileLayers()) {
+        const int count = tileLayer->usedCellCount();
+        const qint64 cells = qint64(tileLayer->width()) * tileLayer->height();
+
+        qWarning("    tile layer \"%s\": %d of %lld cells (%.1f%%)",
+                 qPrintable(tileLayer->name()), count, cells,
+                 cells > 0 ? 100.0 * count / cells : 0.0);
+
+        const QHash<Tileset*, int> tilesets = tileLayer->tilesetUsage();
+        QHash<Tileset*, int>::const_iterator it = tilesets.begin();
+        for (; it != tilesets.end(); ++it)
+            tilesetCounts[it.key()] += it.value();
+
+        const QHash<Tile*, int> tiles = tileLayer->tileUsage();
+        QHash<Tile*, int>::const_iterator tileIt = tiles.begin();
+        for (; tileIt != tiles.end(); ++tileIt)
+            tileCounts[tileIt.key()] += tileIt.value();
+    }
+
+    foreach (Tileset *tileset, map->tilesets()) {
+        qWarning("    tileset \"%s\": %d cells",
+                 qPrintable(tileset->name()), tilesetCounts.value(tileset));
+
+        for (int id = 0; id < tileset->tileCount(); ++id) {
+            const int count = tileCounts.value(tileset->tileAt(id));
+            if (count > 0)
+                qWarning("        tile %d: %d cells", id, count);
+        }
+    }
+}
+
+/**
+ * Logs the tile statistics of each of the maps in \a files. Returns the exit
+ * code.
+ */
+static int reportTileStatistics(const QStringList &files)
+{
+    ExportMapReader reader;
+    bool success = true;
+
+    foreach (const QString &fileName, files) {
+        Tiled::Map *map = reader.readMap(fileName);
+        if (!map) {
+            qWarning().nospace() << qPrintable(fileName) << ": "
+                                 << qPrintable(reader.errorString());
+            success = false;
+            continue;
+        }
+
+        logTileStatistics(fileName, map);
+        reader.deleteMap(map);
+    }
+
+    return success ? 0 : 1;
+}
+
+/**
+ * Adds the tile of \a cell to \a tiles when it is part of an image
+ * collection tileset and wasn't added before.
+ */
+static void addCollectionTile(const Tiled::Cell &cell,
+                              QList<const Tiled::Tile*> &tiles,
+                              QSet<const Tiled::Tile*> &seen)
+{
+    const Tiled::Tile *tile = cell.tile;
+    if (!tile || !tile->tileset()->imageSource().isEmpty() || seen.contains(tile))
+        return;
+
+    seen.insert(tile);
+    tiles.append(tile);
+}
+
+/**
+ * Returns the tiles from image collection tilesets that are used by the
+ * layers of \a map, in the order in which they are first used.
+ */
+static QList<const Tiled::Tile*> usedCollectionTiles(const Tiled::Map *map)
+{
+    QList<const Tiled::Tile*> tiles;
+    QSet<const Tiled::Tile*> seen;
+
+    foreach (const Tiled::Layer *layer, map->layers()) {
+        if (layer->isTileLayer()) {
+            const Tiled::TileLayer *tileLayer =
+                    static_cast<const Tiled::TileLayer*>(layer);
+            for (int y = 0; y < tileLayer->height(); ++y)
+                for (int x = 0; x < tileLayer->width(); ++x)
+                    addCollectionTile(tileLayer->cellAt(x, y), tiles, seen);
+        } else if (layer->isObjectGroup()) {
+            const Tiled::ObjectGroup *objectGroup =
+                    static_cast<const Tiled::ObjectGroup*>(layer);
+            foreach (const Tiled::MapObject *object, objectGroup->objects())
+                addCollectionTile(object->cell(), tiles, seen);
+        }
+    }
+
+    return tiles;
+}
+
+/**
+ * Packs the tiles of image collection tilesets used by \a map into atlas
+ * pages, which are written next to \a targetFile. Their layout is written
+ * to a text file named like the target file with an ".atlas" suffix, with
+ * a line for each page and each tile:
+ *
+ *   page <page> <width> <height> <image file>
+ *   tile <page> <x> <y> <width> <height> <tile id> <tileset name>
+ *
+ * Does nothing when the map does not use any such tiles. Returns whether
+ * the atlas could be written.
+ */
+static bool writeTileAtlas(const Tiled::Map *map, const QString &targetFile)
+{
+    const QList<const Tiled::Tile*> tiles = usedCollectionTiles(map);
+    if (tiles.isEmpty())
+        return true;
+
+    Tiled::TileAtlas atlas;
+    foreach (const Tiled::Tile *tile, tiles)
+        atlas.addTile(tile);
+
+    if (!atlas.pack())
+        return false;
+
+    const QFileInfo targetInfo(targetFile);
+    QFile file(targetFile + QLatin1String(".atlas"));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+        return false;
+
+    QTextStream out(&file);
+    out.setCodec("UTF-8");
+
+    for (int page = 0; page < atlas.pageCount(); ++page) {
+        const QString imageName = QString(QLatin1String("%1.atlas%2.png"))
+                .arg(targetInfo.fileName()).arg(page);
+        const QString imagePath = targetInfo.dir().filePath(imageName);
+
+        if (!atlas.renderPage(page).save(imagePath, "PNG"))
+            return false;
+
+        const QSize size = atlas.pageSize(page);
+        out << "page " << page << ' ' << size.width() << ' ' << size.height()
+            << ' ' << imageName << '\n';
+    }
+
+    foreach (const Tiled::TileAtlas::Placement &placement, atlas.placements()) {
+        const QRect &rect = placement.rect;
+        out << "tile " << placement.page << ' '
+            << rect.x() << ' ' << rect.y() << ' '
+            << rect.width() << ' ' << rect.height() << ' '
+            << placement.tile->id() << ' '
+            << placement.tile->tileset()->name() << '\n';
+    }
+
+    return out.status() == QTextStream::Ok;
+}
+
+/**
+ * Adds an object layer with the merged collision shapes of the placed tiles
+ * above each tile layer of \a map. Only supported for orthogonal maps.
+ */
+static bool addMergedCollisions(Tiled::Map *map)
+{
+    if (map->orientation() != Tiled::Map::Orthogonal)
+        return false;
+
+    const QSize tileSize(map->tileWidth(), map->tileHeight());
+    const QList<Tiled::Layer*> layers = map->layers();
+
+    for (int i = layers.size() - 1; i >= 0; --i) {
+        if (!layers.at(i)->isTileLayer())
+            continue;
+
+        const Tiled::TileLayer *tileLayer =
+                static_cast<const Tiled::TileLayer*>(layers.at(i));
+        Tiled::ObjectGroup *collisions =
+                Tiled::mergeCollisionShapes(tileLayer, tileSize);
+
+        if (collisions->isEmpty()) {
+            delete collisions;
+            continue;
+        }
+
+        collisions->setName(tileLayer->name() + QLatin1String(" Collisions"));
+        map->insertLayer(i + 1, collisions);
+    }
+
+    return true;
+}
+
+/**
+ * Crops \a map to the area used by the tiles of its tile layers and by its
+ * objects. Maps without any tiles or objects are left as is. Only supported
+ * for orthogonal maps.
+ */
+static bool cropToContent(Tiled::Map *map)
+{
+    if (map->orientation() != Tiled::Map::Orthogonal)
+        return false;
+
+    const int tileWidth = map->tileWidth();
+    const int tileHeight = map->tileHeight();
+
+    QRect content;
+    foreach (Tiled::Layer *layer, map->layers()) {
+        if (const Tiled::TileLayer *tileLayer = layer->asTileLayer()) {
+            const QRect bounds = tileLayer->contentBounds();
+            if (!bounds.isEmpty())
+                content |= bounds.translated(tileLayer->position());
+        } else if (const Tiled::ObjectGroup *objectGroup = layer->asObjectGroup()) {
+            if (objectGroup->isEmpty())
+                continue;
+
+            const QRectF bounds = objectGroup->objectsBoundingRect();
+            content |= QRect(QPoint(qFloor(bounds.left() / tileWidth),
+                                    qFloor(bounds.top() / tileHeight)),
+                             QPoint(qCeil(bounds.right() / tileWidth) - 1,
+                                    qCeil(bounds.bottom() / tileHeight) - 1));
+        }
+    }
+
+    content &= QRect(0, 0, map->width(), map->height());
+    if (content.isEmpty() || content == QRect(0, 0, map->width(), map->height()))
+        return true;
+
+    const QPoint offset = -content.topLeft();
+    const QPointF pixelOffset(offset.x() * tileWidth, offset.y() * tileHeight);
+
+    foreach (Tiled::Layer *layer, map->layers()) {
+        if (Tiled::TileLayer *tileLayer = layer->asTileLayer()) {
+            tileLayer->resize(content.size(), offset);
+        } else if (Tiled::ObjectGroup *objectGroup = layer->asObjectGroup()) {
+            foreach (Tiled::MapObject *object, objectGroup->objects())
+                object->setPosition(object->position() + pixelOffset);
+        }
+    }
+
+    map->setWidth(content.width());
+    map->setHeight(content.height());
+    return true;
+}
+
+/**
+ * Returns the map writer to use for the \a targetFile, which is the one
+ * matching the name \a filter when given. Otherwise it is determined by the
+ * extension of the file. Returns 0 and prints a warning when no single
+ * writer can be found.
+ */
+static Tiled::MapWriterInterface *chooseWriter(const QList<Tiled::MapWriterInterface*> &writers,
+                                               const QString *filter,
+                                               const QString &targetFile)
+{
+    Tiled::MapWriterInterface *chosenWriter = 0;
+    bool unique = true;
+    QString suffix = QFileInfo(targetFile).completeSuffix();
+    foreach (Tiled::MapWriterInterface *writer, writers) {
+        if (filter) {
+            if (writer->nameFilters().contains(*filter, Qt::CaseInsensitive)) {
+                chosenWriter = writer;
+            }
+        }
+        else if (!writer->nameFilters().filter(suffix, Qt::CaseInsensitive).isEmpty()) {
+            if (chosenWriter)
+                unique = false;
+            chosenWriter = writer;
+        }
+    }
+    if (!unique) {
+        qWarning().nospace() << qPrintable(targetFile) << ": "
+                             << qPrintable(QCoreApplication::translate("Command line",
+                                                                       "Non-unique file extension. Can't determine correct export format."));
+        return 0;
+    }
+    if (!chosenWriter) {
+        qWarning().nospace() << qPrintable(targetFile) << ": "
+                             << qPrintable(QCoreApplication::translate("Command line",
+                                                                       "No exporter found for target file."));
+    }
+    return chosenWriter;
+}
+
+/**
+ * Exports each of the pairs of source and target \a files. When the number
+ * of files is odd, the first one is the name filter of the format to use.
+ * Otherwise the format is determined by the extension of each target file.
+ * The plugins and the external tilesets are only loaded once for all maps.
+ * Consecutive pairs with the same source file export that map to several
+ * targets, for which the map is only loaded once and the gids and
+ * compressed data of its tile layers are shared between the formats.
+ * When \a stripUnusedTilesets is set, the tilesets that are not used by a
+ * map are left out of its export. When \a packAtlas is set, an atlas of the
+ * used tiles from image collection tilesets is written along with each map.
+ * When \a mergeCollisions is set, the merged collision shapes of each tile
+ * layer are exported as an additional object layer. When \a cropToContent is
+ * set, each map is cropped to the area used by its tiles and objects.
+ * The tileset images are only loaded when they are needed for the atlas.
+ * Returns the exit code.
+ */
+static int exportMaps(const QStringList &files, bool stripUnusedTilesets,
+                      bool packAtlas, bool mergeCollisions, bool cropToContent)
+{
+    if (files.size() < 2) {
+        qWarning() << qPrintable(QCoreApplication::translate("Command line",
+                                                             "Export syntax is --export-map [format] <tmx file> <target file> [<tmx file> <target file> ...]"));
+        return 1;
+    }
+
+    int index = 0;
+    const QString *filter = files.size() % 2 == 1 ? &files.at(index++) : 0;
+
+    const QList<Tiled::MapWriterInterface*> writers =
+            PluginManager::instance()->interfaces<Tiled::MapWriterInterface>();
+
+    // The images are only needed for writing the atlas, the map formats
+    // only refer to them
+    ExportMapReader reader;
+    reader.setImageLoading(packAtlas);
+    bool success = true;
+
+    while (index < files.size()) {
+        const QString &sourceFile = files.at(index);
+
+        QStringList targetFiles;
+        while (index < files.size() && files.at(index) == sourceFile) {
+            targetFiles.append(files.at(index + 1));
+            index += 2;
+        }
+
+        // Load the source file
+        Tiled::Map *map = reader.readMap(sourceFile);
+        if (!map) {
+            qWarning().nospace() << qPrintable(sourceFile) << ": "
+                                 << qPrintable(QCoreApplication::translate("Command line",
+                                                                           "Failed to load source map."));
+            success = false;
+            continue;
+        }
+
+        logMemoryUsage(sourceFile, map);
+
+        // The changes are made to a copy, which shares the cells with the
+        // map, so that all tilesets are still deleted along with the map
+        Tiled::Map *exportedMap = map;
+        if (stripUnusedTilesets || mergeCollisions || cropToContent)
+            exportedMap = new Tiled::Map(*map);
+        if (stripUnusedTilesets)
+            exportedMap->removeUnusedTilesets();
+        if (mergeCollisions && !addMergedCollisions(exportedMap)) {
+            qWarning().nospace() << qPrintable(sourceFile) << ": "
+                                 << qPrintable(QCoreApplication::translate("Command line",
+                                                                           "Collision shapes can only be merged for orthogonal maps."));
+        }
+        if (cropToContent && !::cropToContent(exportedMap)) {
+            qWarning().nospace() << qPrintable(sourceFile) << ": "
+                                 << qPrintable(QCoreApplication::translate("Command line",
+                                                                           "Only orthogonal maps can be cropped to their content."));
+        }
+
+        // Shared by the writers of all targets of this map
+        Tiled::LayerExportCache layerExportCache;
+
+        foreach (const QString &targetFile, targetFiles) {
+            Tiled::MapWriterInterface *writer = chooseWriter(writers, filter,
+                                                             targetFile);
+            if (!writer) {
+                success = false;
+                continue;
+            }
+
+            // Write out the file
+            if (!writer->write(exportedMap, targetFile)) {
+                qWarning().nospace() << qPrintable(targetFile) << ": "
+                                     << qPrintable(QCoreApplication::translate("Command line",
+                                                                               "Failed to export map to target file."));
+                success = false;
+            } else if (packAtlas && !writeTileAtlas(exportedMap, targetFile)) {
+                qWarning().nospace() << qPrintable(targetFile) << ": "
+                                     << qPrintable(QCoreApplication::translate("Command line",
+                                                                               "Failed to write the tile atlas."));
+                success = false;
+            }
+        }
+
+        if (exportedMap != map)
+            delete exportedMap;
+        reader.deleteMap(map);
+    }
+
+    return success ? 0 : 1;
+}
+
+/**
+ * Applies the automapping rules file given as the first of the \a files to
+ * each of the following pairs of source and target files. The rule maps are
+ * only loaded once for all maps. Returns the exit code.
+ */
+static int autoMapFiles(const QStringList &files)
+{
+    if (files.size() < 3 || files.size() % 2 == 0) {
+        qWarning() << qPrintable(QCoreApplication::translate("Command line",
+                                                             "Automap syntax is --automap <rules file> <tmx file> <target file> [<tmx file> <target file> ...]"));
+        return 1;
+    }
+
+    AutomappingManager automappingManager;
+    automappingManager.setRulesFile(files.at(0));
+
+    bool success = true;
+
+    for (int i = 1; i < files.size(); i += 2) {
+        const QString &sourceFile = files.at(i);
+        const QString &targetFile = files.at(i + 1);
+
+        QString error;
+        MapDocument *mapDocument = MapDocument::load(sourceFile, 0, &error);
+        if (!mapDocument) {
+            qWarning().nospace() << qPrintable(sourceFile) << ": "
+                                 << qPrintable(error);
+            success = false;
+            continue;
+        }
+
+        automappingManager.setMapDocument(mapDocument);
+        automappingManager.autoMap();
+        automappingManager.setMapDocument(0);
+
+        const QString warning = automappingManager.warningString();
+        if (!warning.isEmpty())
+            qWarning().nospace() << qPrintable(sourceFile) << ": "
+                                 << qPrintable(warning.trimmed());
+
+        error = automappingManager.errorString();
+        if (!error.isEmpty()) {
+            qWarning().nospace() << qPrintable(sourceFile) << ": "
+                                 << qPrintable(error.trimmed());
+            success = false;
+        } else if (!mapDocument->save(targetFile, &error)) {
+            qWarning().nospace() << qPrintable(targetFile) << ": "
+                                 << qPrintable(error);
+            success = false;
+        }
+
+        delete mapDocument;
+    }
+
+    return success ? 0 : 1;
+}
+
 int main(int argc, char *argv[])
 {
     /*
@@ -145,6 +1090,11 @@ int main(int argc, char *argv[])
     QApplication::setGraphicsSystem(QLatin1String("raster"));
 #endif
 
+    startupTimer.start();
+
+    StartupBenchmark benchmark;
+    benchmark.start();
+
     TiledApplication a(argc, argv);
 
     a.setOrganizationDomain(QLatin1String("mapeditor.org"));
@@ -193,71 +1143,60 @@ int main(int argc, char *argv[])
         return 0;
     if (commandLine.disableOpenGL)
         Preferences::instance()->setUseOpenGL(false);
+    if (commandLine.paintStatistics)
+        PaintStatistics::setEnabled(true);
+    if (commandLine.startupStatistics)
+        logStartup = true;
+    if (commandLine.memoryUsage)
+        logMemory = true;
+
+    logStartupTime("application initialized");
+    benchmark.finish("TiledApplication");
 
     PluginManager::instance()->loadPlugins();
 
-    if (commandLine.exportMap) {
-        // Get the path to the source file and target file
-        if (commandLine.filesToOpen().length() < 2) {
-            qWarning() << qPrintable(QCoreApplication::translate("Command line",
-                                                                 "Export syntax is --export-map [format] <tmx file> <target file>"));
-            return 1;
-        }
-        int index = 0;
-        const QString *filter = commandLine.filesToOpen().length() > 2 ? &commandLine.filesToOpen().at(index++) : 0;
-        const QString &sourceFile = commandLine.filesToOpen().at(index++);
-        const QString &targetFile = commandLine.filesToOpen().at(index++);
-
-        // Find the map writer interface for the target file
-        Tiled::MapWriterInterface *chosenWriter = 0;
-        QString suffix = QFileInfo(targetFile).completeSuffix();
-        QList<Tiled::MapWriterInterface*> writers = PluginManager::instance()->interfaces<Tiled::MapWriterInterface>();
-        foreach (Tiled::MapWriterInterface *writer, writers) {
-            if (filter) {
-                if (writer->nameFilters().contains(*filter, Qt::CaseInsensitive)) {
-                    chosenWriter = writer;
-                }
-            }
-            else if (!writer->nameFilters().filter(suffix, Qt::CaseInsensitive).isEmpty()) {
-                if (chosenWriter) {
-                    qWarning() << qPrintable(QCoreApplication::translate("Command line",
-                                                                         "Non-unique file extension. Can't determine correct export format."));
-                    return 1;
-                }
-                chosenWriter = writer;
-            }
-        }
-        if (!chosenWriter) {
-            qWarning() << qPrintable(QCoreApplication::translate("Command line",
-                                                                 "No exporter found for target file."));
-            return 1;
-        }
+    logStartupTime("plugins found");
+    benchmark.finish("PluginManager::loadPlugins");
 
-        // Load the source file
-        Tiled::MapReader reader;
-        Tiled::Map *map = reader.readMap(sourceFile);
-        if (!map) {
-            qWarning() << qPrintable(QCoreApplication::translate("Command line",
-                                                                 "Failed to load source map."));
-            return 1;
-        }
+    if (commandLine.exportMap)
+        return exportMaps(commandLine.filesToOpen(),
+                          commandLine.stripUnusedTilesets,
+                          commandLine.packAtlas,
+                          commandLine.mergeCollisions,
+                          commandLine.cropToContent);
 
-        // Write out the file
-        bool success = chosenWriter->write(map, targetFile);
+    if (commandLine.autoMap)
+        return autoMapFiles(commandLine.filesToOpen());
 
-        qDeleteAll(map->tilesets());
-        delete map;
+    if (commandLine.memoryUsage)
+        return reportMemoryUsage(commandLine.filesToOpen());
 
-        if (!success) {
-            qWarning() << qPrintable(QCoreApplication::translate("Command line",
-                                                                 "Failed to export map to target file."));
-            return 1;
-        }
-        return 0;
-    }
+    if (commandLine.tileStatistics)
+        return reportTileStatistics(commandLine.filesToOpen());
+
+    setupDiskCaches();
+
+    benchmark.start();
 
     MainWindow w;
+    logStartupTime("main window created");
+    benchmark.finish("MainWindow");
+
     w.show();
+    logStartupTime("main window shown");
+
+    if (commandLine.benchmarkStartup) {
+        QApplication::processEvents();
+        benchmark.finish("MainWindow::show");
+
+        const int exitCode = benchmarkOpeningFiles(commandLine.filesToOpen(),
+                                                   benchmark);
+
+        const QByteArray json = benchmark.toJson(a.applicationVersion());
+        std::fwrite(json.constData(), 1, json.size(), stdout);
+        std::fflush(stdout);
+        return exitCode;
+    }
 
     QObject::connect(&a, SIGNAL(fileOpenRequest(QString)),
                      &w, SLOT(openFile(QString)));
@@ -269,5 +1208,9 @@ int main(int argc, char *argv[])
         w.openLastFiles();
     }
 
+    w.recoverAutosavedMaps();
+
+    logStartupTime("files opened");
+
     return a.exec();
 }
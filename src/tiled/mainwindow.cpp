@@ -30,7 +30,9 @@
 #include "aboutdialog.h"
 #include "addremovemapobject.h"
 #include "automappingmanager.h"
+#include "autosavemanager.h"
 #include "addremovetileset.h"
+#include "cachemanager.h"
 #include "clipboardmanager.h"
 #include "createobjecttool.h"
 #include "createrectangleobjecttool.h"
@@ -76,12 +78,17 @@
 #include "tileset.h"
 #include "tilesetdock.h"
 #include "tilesetmanager.h"
+#include "tilestamp.h"
+#include "tilestatisticsdock.h"
 #include "terraindock.h"
 #include "toolmanager.h"
 #include "tmxmapreader.h"
 #include "tmxmapwriter.h"
 #include "undodock.h"
+#include "undomemorymanager.h"
 #include "utils.h"
+#include "world.h"
+#include "worldview.h"
 #include "zoomable.h"
 #include "commandbutton.h"
 #include "objectsdock.h"
@@ -129,13 +136,15 @@ MainWindow::MainWindow(QWidget *parent, Qt::WindowFlags flags)
     , mTerrainDock(new TerrainDock(this))
     , mMiniMapDock(new MiniMapDock(this))
     , mConsoleDock(new ConsoleDock(this))
-    , mTileAnimationEditor(new TileAnimationEditor(this))
-    , mTileCollisionEditor(new TileCollisionEditor(this))
+    , mTileStatisticsDock(new TileStatisticsDock(this))
+    , mTileAnimationEditor(0)
+    , mTileCollisionEditor(0)
     , mCurrentLayerLabel(new QLabel)
     , mZoomable(0)
     , mZoomComboBox(new QComboBox)
     , mStatusInfoLabel(new QLabel)
     , mAutomappingManager(new AutomappingManager(this))
+    , mAutosaveManager(new AutosaveManager(this))
     , mDocumentManager(DocumentManager::instance())
     , mQuickStampManager(new QuickStampManager(this))
     , mToolManager(new ToolManager(this))
@@ -195,17 +204,20 @@ MainWindow::MainWindow(QWidget *parent, Qt::WindowFlags flags)
     addDockWidget(Qt::RightDockWidgetArea, mTilesetDock);
     addDockWidget(Qt::RightDockWidgetArea, propertiesDock);
     addDockWidget(Qt::RightDockWidgetArea, mConsoleDock);
+    addDockWidget(Qt::RightDockWidgetArea, mTileStatisticsDock);
 
     tabifyDockWidget(mMiniMapDock, mObjectsDock);
     tabifyDockWidget(mObjectsDock, mLayerDock);
     tabifyDockWidget(mTerrainDock, mTilesetDock);
     tabifyDockWidget(undoDock, mMapsDock);
+    tabifyDockWidget(mConsoleDock, mTileStatisticsDock);
 
     // These dock widgets may not be immediately useful to many people, so
     // they are hidden by default.
     undoDock->setVisible(false);
     mMapsDock->setVisible(false);
     mConsoleDock->setVisible(false);
+    mTileStatisticsDock->setVisible(false);
 
     statusBar()->addPermanentWidget(mZoomComboBox);
 
@@ -227,6 +239,7 @@ MainWindow::MainWindow(QWidget *parent, Qt::WindowFlags flags)
     mUi->actionShowTileAnimations->setChecked(preferences->showTileAnimations());
     mUi->actionSnapToGrid->setChecked(preferences->snapToGrid());
     mUi->actionSnapToFineGrid->setChecked(preferences->snapToFineGrid());
+    mUi->actionSnapToObjects->setChecked(preferences->snapToObjects());
     mUi->actionHighlightCurrentLayer->setChecked(preferences->highlightCurrentLayer());
 
     QShortcut *reloadTilesetsShortcut = new QShortcut(QKeySequence(tr("Ctrl+T")), this);
@@ -289,9 +302,10 @@ MainWindow::MainWindow(QWidget *parent, Qt::WindowFlags flags)
 
     connect(mUi->actionNew, SIGNAL(triggered()), SLOT(newMap()));
     connect(mUi->actionOpen, SIGNAL(triggered()), SLOT(openFile()));
+    connect(mUi->actionOpenWorld, SIGNAL(triggered()), SLOT(openWorld()));
     connect(mUi->actionClearRecentFiles, SIGNAL(triggered()),
             SLOT(clearRecentFiles()));
-    connect(mUi->actionSave, SIGNAL(triggered()), SLOT(saveFile()));
+    connect(mUi->actionSave, SIGNAL(triggered()), SLOT(saveFileInBackground()));
     connect(mUi->actionSaveAs, SIGNAL(triggered()), SLOT(saveFileAs()));
     connect(mUi->actionExportAsImage, SIGNAL(triggered()), SLOT(exportAsImage()));
     connect(mUi->actionExport, SIGNAL(triggered()), SLOT(export_()));
@@ -318,6 +332,8 @@ MainWindow::MainWindow(QWidget *parent, Qt::WindowFlags flags)
             preferences, SLOT(setSnapToGrid(bool)));
     connect(mUi->actionSnapToFineGrid, SIGNAL(toggled(bool)),
             preferences, SLOT(setSnapToFineGrid(bool)));
+    connect(mUi->actionSnapToObjects, SIGNAL(toggled(bool)),
+            preferences, SLOT(setSnapToObjects(bool)));
     connect(mUi->actionHighlightCurrentLayer, SIGNAL(toggled(bool)),
             preferences, SLOT(setHighlightCurrentLayer(bool)));
     connect(mUi->actionZoomIn, SIGNAL(triggered()), SLOT(zoomIn()));
@@ -390,10 +406,6 @@ MainWindow::MainWindow(QWidget *parent, Qt::WindowFlags flags)
 
     connect(mTilesetDock, SIGNAL(currentTileChanged(Tile*)),
             tileObjectsTool, SLOT(setTile(Tile*)));
-    connect(mTilesetDock, SIGNAL(currentTileChanged(Tile*)),
-            mTileAnimationEditor, SLOT(setTile(Tile*)));
-    connect(mTilesetDock, SIGNAL(currentTileChanged(Tile*)),
-            mTileCollisionEditor, SLOT(setTile(Tile*)));
     connect(mTilesetDock, SIGNAL(newTileset()),
             this, SLOT(newTileset()));
 
@@ -447,13 +459,11 @@ MainWindow::MainWindow(QWidget *parent, Qt::WindowFlags flags)
     mUi->menuView->insertAction(mUi->actionShowGrid, mShowTileCollisionEditor);
     mUi->menuView->insertSeparator(mUi->actionShowGrid);
 
+    // The tile animation and collision editors are created when first shown
     connect(mShowTileAnimationEditor, SIGNAL(toggled(bool)),
-            mTileAnimationEditor, SLOT(setVisible(bool)));
-    connect(mTileAnimationEditor, SIGNAL(closed()), SLOT(onAnimationEditorClosed()));
-
+            SLOT(setTileAnimationEditorVisible(bool)));
     connect(mShowTileCollisionEditor, SIGNAL(toggled(bool)),
-            mTileCollisionEditor, SLOT(setVisible(bool)));
-    connect(mTileCollisionEditor, SIGNAL(closed()), SLOT(onCollisionEditorClosed()));
+            SLOT(setTileCollisionEditorVisible(bool)));
 
     connect(ClipboardManager::instance(), SIGNAL(hasMapChanged()), SLOT(updateActions()));
 
@@ -463,6 +473,12 @@ MainWindow::MainWindow(QWidget *parent, Qt::WindowFlags flags)
             this, SLOT(closeMapDocument(int)));
     connect(mDocumentManager, SIGNAL(reloadError(QString)),
             this, SLOT(reloadError(QString)));
+    connect(mDocumentManager, SIGNAL(saveError(QString)),
+            this, SLOT(saveError(QString)));
+    connect(mDocumentManager, SIGNAL(documentLoaded(MapDocument*)),
+            this, SLOT(documentLoaded(MapDocument*)));
+    connect(mDocumentManager, SIGNAL(documentLoadFailed(QString,QString)),
+            this, SLOT(documentLoadFailed(QString,QString)));
 
     QShortcut *switchToLeftDocument = new QShortcut(tr("Alt+Left"), this);
     connect(switchToLeftDocument, SIGNAL(activated()),
@@ -511,19 +527,27 @@ MainWindow::~MainWindow()
 
     // This needs to happen before deleting the TilesetManager otherwise it may
     // hold references to tilesets.
-    mTileAnimationEditor->setTile(0);
-    mTileAnimationEditor->writeSettings();
-    mTileCollisionEditor->setTile(0);
-    mTileCollisionEditor->writeSettings();
+    if (mTileAnimationEditor) {
+        mTileAnimationEditor->setTile(0);
+        mTileAnimationEditor->writeSettings();
+    }
+    if (mTileCollisionEditor) {
+        mTileCollisionEditor->setTile(0);
+        mTileCollisionEditor->writeSettings();
+    }
 
     delete mQuickStampManager;
 
+    // The clipboard may hold references to tilesets as well
+    ClipboardManager::deleteInstance();
+
     TilesetManager::deleteInstance();
     DocumentManager::deleteInstance();
     Preferences::deleteInstance();
     LanguageManager::deleteInstance();
     PluginManager::deleteInstance();
-    ClipboardManager::deleteInstance();
+    UndoMemoryManager::deleteInstance();
+    CacheManager::deleteInstance();
 
     delete mUi;
 }
@@ -625,9 +649,39 @@ bool MainWindow::openFile(const QString &fileName,
 
 bool MainWindow::openFile(const QString &fileName)
 {
+    // Maps in other formats are read by plugins, which may not be able to
+    // read on a worker thread
+    if (TmxMapReader().supportsFile(fileName) &&
+            mDocumentManager->findDocument(fileName) == -1) {
+        mDocumentManager->loadDocumentInBackground(fileName);
+        return true;
+    }
+
     return openFile(fileName, 0);
 }
 
+void MainWindow::recoverAutosavedMaps()
+{
+    const QStringList fileNames = AutosaveManager::recoveryFiles();
+    if (fileNames.isEmpty())
+        return;
+
+    const QMessageBox::StandardButton answer = QMessageBox::question(
+                this, tr("Recover Maps"),
+                tr("Tiled did not shut down properly. Do you want to open "
+                   "the %n autosaved map(s)?", "", fileNames.size()),
+                QMessageBox::Yes | QMessageBox::No, QMessageBox::Yes);
+
+    if (answer != QMessageBox::Yes) {
+        AutosaveManager::removeRecoveryFiles(fileNames);
+        return;
+    }
+
+    // The recovered files are removed once their documents are closed
+    foreach (const QString &fileName, fileNames)
+        openFile(fileName);
+}
+
 void MainWindow::openLastFiles()
 {
     mSettings.beginGroup(QLatin1String("recentFiles"));
@@ -666,7 +720,8 @@ void MainWindow::openLastFiles()
         if (!(i < selectedLayer.size()))
             continue;
 
-        if (openFile(lastOpenFiles.at(i))) {
+        // Opened right away, since the view is restored below
+        if (openFile(lastOpenFiles.at(i), 0)) {
             MapView *mapView = mDocumentManager->currentMapView();
 
             // Restore camera to the previous position
@@ -729,8 +784,40 @@ void MainWindow::openFile()
     }
 
     mSettings.setValue(QLatin1String("lastUsedOpenFilter"), selectedFilter);
-    foreach (const QString &fileName, fileNames)
-        openFile(fileName, mapReader);
+    foreach (const QString &fileName, fileNames) {
+        if (mapReader)
+            openFile(fileName, mapReader);
+        else
+            openFile(fileName);
+    }
+}
+
+/**
+ * Shows the maps of a world file next to each other in a separate window.
+ * Double-clicking a map opens it.
+ */
+void MainWindow::openWorld()
+{
+    const QString fileName =
+            QFileDialog::getOpenFileName(this, tr("Open World"),
+                                         fileDialogStartLocation(),
+                                         tr("World files (*.world)"));
+    if (fileName.isEmpty())
+        return;
+
+    QString error;
+    World *world = World::read(fileName, &error);
+    if (!world) {
+        QMessageBox::critical(this, tr("Error Opening World"), error);
+        return;
+    }
+
+    WorldView *worldView = new WorldView(world, this);
+    worldView->setWindowFlags(Qt::Window);
+    worldView->setAttribute(Qt::WA_DeleteOnClose);
+    worldView->resize(size() * 3 / 4);
+    connect(worldView, SIGNAL(mapActivated(QString)), SLOT(openFile(QString)));
+    worldView->show();
 }
 
 bool MainWindow::saveFile(const QString &fileName)
@@ -764,6 +851,24 @@ bool MainWindow::saveFile()
     return true;
 }
 
+/**
+ * Saves the current map to its file on a worker thread, so that editing can
+ * continue. Errors are reported once the save has finished.
+ */
+void MainWindow::saveFileInBackground()
+{
+    if (!mMapDocument)
+        return;
+
+    const QString currentFileName = mMapDocument->fileName();
+    if (currentFileName.isEmpty()) {
+        saveFileAs();
+        return;
+    }
+
+    mMapDocument->saveInBackground(currentFileName);
+}
+
 bool MainWindow::saveFileAs()
 {
     const QString tmxfilter = tr("Tiled map files (*.tmx)");
@@ -847,6 +952,23 @@ bool MainWindow::confirmAllSave()
     return true;
 }
 
+/**
+ * Writes the \a map to \a fileName with the given \a writer. When enabled
+ * in the preferences, the tilesets that are not used are left out.
+ */
+static bool writeExportedMap(MapWriterInterface *writer,
+                             const Map *map,
+                             const QString &fileName)
+{
+    if (!Preferences::instance()->stripUnusedTilesets())
+        return writer->write(map, fileName);
+
+    // The copy shares its cells with the map
+    Map exportedMap(*map);
+    exportedMap.removeUnusedTilesets();
+    return writer->write(&exportedMap, fileName);
+}
+
 void MainWindow::export_()
 {
     if (!mMapDocument)
@@ -868,7 +990,7 @@ void MainWindow::export_()
         }
 
         if (writer) {
-            if (writer->write(mMapDocument->map(), exportFileName)) {
+            if (writeExportedMap(writer, mMapDocument->map(), exportFileName)) {
                 statusBar()->showMessage(tr("Exported to %1").arg(exportFileName),
                                          3000);
                 return;
@@ -972,7 +1094,7 @@ void MainWindow::exportAs()
 
     mSettings.setValue(QLatin1String("lastUsedExportFilter"), selectedFilter);
 
-    if (!chosenWriter->write(mMapDocument->map(), fileName)) {
+    if (!writeExportedMap(chosenWriter, mMapDocument->map(), fileName)) {
         QMessageBox::critical(this, tr("Error Exporting Map"),
                               chosenWriter->errorString());
     } else {
@@ -1068,16 +1190,17 @@ void MainWindow::paste()
     if (!map)
         return;
 
+    // The tilesets may be shared with the map on the clipboard
+    TilesetManager *tilesetManager = TilesetManager::instance();
+    tilesetManager->addReferences(map->tilesets());
+
     // We can currently only handle maps with a single layer
     if (map->layerCount() != 1) {
-        // Need to clean up the tilesets since they didn't get an owner
-        qDeleteAll(map->tilesets());
+        // Cleans up the tilesets that didn't get an owner
+        tilesetManager->removeReferences(map->tilesets());
         return;
     }
 
-    TilesetManager *tilesetManager = TilesetManager::instance();
-    tilesetManager->addReferences(map->tilesets());
-
     mMapDocument->unifyTilesets(map.data());
     Layer *layer = map->layerAt(0);
 
@@ -1309,6 +1432,40 @@ void MainWindow::autoMappingWarning(bool automatic)
     }
 }
 
+void MainWindow::setTileAnimationEditorVisible(bool visible)
+{
+    if (visible && !mTileAnimationEditor) {
+        mTileAnimationEditor = new TileAnimationEditor(this);
+        mTileAnimationEditor->setMapDocument(mMapDocument);
+        mTileAnimationEditor->setTile(mTilesetDock->currentTile());
+
+        connect(mTilesetDock, SIGNAL(currentTileChanged(Tile*)),
+                mTileAnimationEditor, SLOT(setTile(Tile*)));
+        connect(mTileAnimationEditor, SIGNAL(closed()),
+                SLOT(onAnimationEditorClosed()));
+    }
+
+    if (mTileAnimationEditor)
+        mTileAnimationEditor->setVisible(visible);
+}
+
+void MainWindow::setTileCollisionEditorVisible(bool visible)
+{
+    if (visible && !mTileCollisionEditor) {
+        mTileCollisionEditor = new TileCollisionEditor(this);
+        mTileCollisionEditor->setMapDocument(mMapDocument);
+        mTileCollisionEditor->setTile(mTilesetDock->currentTile());
+
+        connect(mTilesetDock, SIGNAL(currentTileChanged(Tile*)),
+                mTileCollisionEditor, SLOT(setTile(Tile*)));
+        connect(mTileCollisionEditor, SIGNAL(closed()),
+                SLOT(onCollisionEditorClosed()));
+    }
+
+    if (mTileCollisionEditor)
+        mTileCollisionEditor->setVisible(visible);
+}
+
 void MainWindow::onAnimationEditorClosed()
 {
     mShowTileAnimationEditor->setChecked(false);
@@ -1460,10 +1617,10 @@ void MainWindow::updateZoomLabel()
 void MainWindow::flip(FlipDirection direction)
 {
     if (mStampBrush->isEnabled()) {
-        if (TileLayer *stamp = mStampBrush->stamp()) {
-            stamp = static_cast<TileLayer*>(stamp->clone());
-            stamp->flip(direction);
-            setStampBrush(stamp);
+        if (const TileLayer *stamp = mStampBrush->stamp().tileLayer()) {
+            TileLayer *flipped = static_cast<TileLayer*>(stamp->clone());
+            flipped->flip(direction);
+            setStamp(TileStamp(flipped));
         }
     } else if (mMapDocument) {
         mMapDocument->flipSelectedObjects(direction);
@@ -1473,10 +1630,10 @@ void MainWindow::flip(FlipDirection direction)
 void MainWindow::rotate(RotateDirection direction)
 {
     if (mStampBrush->isEnabled()) {
-        if (TileLayer *stamp = mStampBrush->stamp()) {
-            stamp = static_cast<TileLayer*>(stamp->clone());
-            stamp->rotate(direction);
-            setStampBrush(stamp);
+        if (const TileLayer *stamp = mStampBrush->stamp().tileLayer()) {
+            TileLayer *rotated = static_cast<TileLayer*>(stamp->clone());
+            rotated->rotate(direction);
+            setStamp(TileStamp(rotated));
         }
     } else if (mMapDocument) {
         mMapDocument->rotateSelectedObjects(direction);
@@ -1492,8 +1649,20 @@ void MainWindow::setStampBrush(const TileLayer *tiles)
     if (!tiles)
         return;
 
-    mStampBrush->setStamp(static_cast<TileLayer*>(tiles->clone()));
-    mBucketFillTool->setStamp(static_cast<TileLayer*>(tiles->clone()));
+    setStamp(TileStamp(static_cast<TileLayer*>(tiles->clone())));
+}
+
+/**
+ * Sets the given \a stamp on both the stamp brush and the bucket fill tool.
+ * The stamp is shared, so this doesn't copy its tiles.
+ */
+void MainWindow::setStamp(const TileStamp &stamp)
+{
+    if (stamp.isNull())
+        return;
+
+    mStampBrush->setStamp(stamp);
+    mBucketFillTool->setStamp(stamp);
 
     // When selecting a new stamp, it makes sense to switch to a stamp tool
     AbstractTool *selectedTool = mToolManager->selectedTool();
@@ -1634,8 +1803,11 @@ void MainWindow::mapDocumentChanged(MapDocument *mapDocument)
     mTilesetDock->setMapDocument(mapDocument);
     mTerrainDock->setMapDocument(mapDocument);
     mMiniMapDock->setMapDocument(mapDocument);
-    mTileAnimationEditor->setMapDocument(mapDocument);
-    mTileCollisionEditor->setMapDocument(mapDocument);
+    mTileStatisticsDock->setMapDocument(mapDocument);
+    if (mTileAnimationEditor)
+        mTileAnimationEditor->setMapDocument(mapDocument);
+    if (mTileCollisionEditor)
+        mTileCollisionEditor->setMapDocument(mapDocument);
     mToolManager->setMapDocument(mapDocument);
     mAutomappingManager->setMapDocument(mapDocument);
     mQuickStampManager->setMapDocument(mapDocument);
@@ -1689,8 +1861,8 @@ void MainWindow::setupQuickStamps()
     connect(saveMapper, SIGNAL(mapped(int)),
             this, SLOT(saveQuickStamp(int)));
 
-    connect(mQuickStampManager, SIGNAL(setStampBrush(const TileLayer*)),
-            this, SLOT(setStampBrush(const TileLayer*)));
+    connect(mQuickStampManager, SIGNAL(setStamp(TileStamp)),
+            this, SLOT(setStamp(TileStamp)));
 }
 
 void MainWindow::closeMapDocument(int index)
@@ -1703,3 +1875,20 @@ void MainWindow::reloadError(const QString &error)
 {
     QMessageBox::critical(this, tr("Error Reloading Map"), error);
 }
+
+void MainWindow::saveError(const QString &error)
+{
+    QMessageBox::critical(this, tr("Error Saving Map"), error);
+}
+
+void MainWindow::documentLoaded(MapDocument *mapDocument)
+{
+    setRecentFile(mapDocument->fileName());
+}
+
+void MainWindow::documentLoadFailed(const QString &fileName,
+                                    const QString &error)
+{
+    Q_UNUSED(fileName)
+    QMessageBox::critical(this, tr("Error Opening Map"), error);
+}
@@ -48,6 +48,7 @@ class MapReaderInterface;
 namespace Internal {
 
 class AutomappingManager;
+class AutosaveManager;
 class BucketFillTool;
 class CommandButton;
 class DocumentManager;
@@ -66,6 +67,8 @@ class TerrainDock;
 class TileAnimationEditor;
 class TileCollisionEditor;
 class TilesetDock;
+class TileStamp;
+class TileStatisticsDock;
 class ToolManager;
 class Zoomable;
 
@@ -102,7 +105,17 @@ public:
      */
     void openLastFiles();
 
+    /**
+     * Offers to open the maps that were autosaved but not cleaned up, which
+     * happens when Tiled did not shut down properly.
+     */
+    void recoverAutosavedMaps();
+
 public slots:
+    /**
+     * Opens the given file. TMX maps are loaded in the background, in
+     * which case this returns true once loading has started.
+     */
     bool openFile(const QString &fileName);
 
 protected:
@@ -118,7 +131,9 @@ protected:
 public slots:
     void newMap();
     void openFile();
+    void openWorld();
     bool saveFile();
+    void saveFileInBackground();
     bool saveFileAs();
     void export_();
     void exportAs();
@@ -162,6 +177,7 @@ public slots:
     void rotate(RotateDirection direction);
 
     void setStampBrush(const TileLayer *tiles);
+    void setStamp(const TileStamp &stamp);
     void setTerrainBrush(const Terrain *terrain);
     void saveQuickStamp(int index);
     void updateStatusInfoLabel(const QString &statusInfo);
@@ -170,9 +186,14 @@ public slots:
     void closeMapDocument(int index);
 
     void reloadError(const QString &error);
+    void saveError(const QString &error);
+    void documentLoaded(MapDocument *mapDocument);
+    void documentLoadFailed(const QString &fileName, const QString &error);
     void autoMappingError(bool automatic);
     void autoMappingWarning(bool automatic);
 
+    void setTileAnimationEditorVisible(bool visible);
+    void setTileCollisionEditorVisible(bool visible);
     void onAnimationEditorClosed();
     void onCollisionEditorClosed();
 
@@ -225,6 +246,7 @@ private:
     TerrainDock *mTerrainDock;
     MiniMapDock* mMiniMapDock;
     ConsoleDock *mConsoleDock;
+    TileStatisticsDock *mTileStatisticsDock;
     TileAnimationEditor *mTileAnimationEditor;
     TileCollisionEditor *mTileCollisionEditor;
     QLabel *mCurrentLayerLabel;
@@ -250,6 +272,7 @@ private:
     void setupQuickStamps();
 
     AutomappingManager *mAutomappingManager;
+    AutosaveManager *mAutosaveManager;
     DocumentManager *mDocumentManager;
     QuickStampManager *mQuickStampManager;
     ToolManager *mToolManager;
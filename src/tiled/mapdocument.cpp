@@ -24,6 +24,7 @@
 #include "addremovelayer.h"
 #include "addremovemapobject.h"
 #include "addremovetileset.h"
+#include "changemapproperty.h"
 #include "changeproperties.h"
 #include "changeselectedarea.h"
 #include "flipmapobjects.h"
@@ -34,17 +35,18 @@
 #include "mapobjectmodel.h"
 #include "map.h"
 #include "mapobject.h"
+#include "mapsaver.h"
 #include "movelayer.h"
-#include "movemapobject.h"
 #include "movemapobjecttogroup.h"
 #include "objectgroup.h"
+#include "objectsearchindex.h"
 #include "offsetlayer.h"
 #include "orthogonalrenderer.h"
 #include "painttilelayer.h"
 #include "pluginmanager.h"
+#include "preferences.h"
 #include "resizemap.h"
 #include "resizetilelayer.h"
-#include "rotatemapobject.h"
 #include "staggeredrenderer.h"
 #include "terrain.h"
 #include "terrainmodel.h"
@@ -54,6 +56,7 @@
 #include "tileset.h"
 #include "tmxmapreader.h"
 #include "tmxmapwriter.h"
+#include "transformmapobjects.h"
 
 #include <QFileInfo>
 #include <QRect>
@@ -70,7 +73,11 @@ MapDocument::MapDocument(Map *map, const QString &fileName):
     mRenderer(0),
     mMapObjectModel(new MapObjectModel(this)),
     mTerrainModel(new TerrainModel(this, this)),
-    mUndoStack(new QUndoStack(this))
+    mObjectSearchIndex(new ObjectSearchIndex(this)),
+    mUndoStack(new QUndoStack(this)),
+    mSaver(0),
+    mSaveUndoIndex(0),
+    mSaveCommand(0)
 {
     createRenderer();
 
@@ -83,6 +90,8 @@ MapDocument::MapDocument(Map *map, const QString &fileName):
             SLOT(onLayerAboutToBeRemoved(int)));
     connect(mLayerModel, SIGNAL(layerRemoved(int)), SLOT(onLayerRemoved(int)));
     connect(mLayerModel, SIGNAL(layerChanged(int)), SIGNAL(layerChanged(int)));
+    connect(mLayerModel, SIGNAL(layersChanged(QList<int>)),
+            SIGNAL(layersChanged(QList<int>)));
 
     // Forward signals emitted from the map object model
     mMapObjectModel->setMapDocument(this);
@@ -112,6 +121,9 @@ MapDocument::MapDocument(Map *map, const QString &fileName):
 
 MapDocument::~MapDocument()
 {
+    // Waits for a running save, which uses the layer data cache
+    delete mSaver;
+
     // Unregister tileset references
     TilesetManager *tilesetManager = TilesetManager::instance();
     tilesetManager->removeReferences(mMap->tilesets());
@@ -127,6 +139,8 @@ bool MapDocument::save(QString *error)
 
 bool MapDocument::save(const QString &fileName, QString *error)
 {
+    finishBackgroundSave();
+
     PluginManager *pm = PluginManager::instance();
 
     MapWriterInterface *chosenWriter = 0;
@@ -134,8 +148,11 @@ bool MapDocument::save(const QString &fileName, QString *error)
         chosenWriter = qobject_cast<MapWriterInterface*>(plugin->instance);
 
     TmxMapWriter mapWriter;
-    if (!chosenWriter)
+    mapWriter.setLayerDataCache(&mLayerDataCache);
+    if (!chosenWriter) {
         chosenWriter = &mapWriter;
+        upgradeXmlLayerData();
+    }
 
     if (!chosenWriter->write(map(), fileName)) {
         if (error)
@@ -151,6 +168,126 @@ bool MapDocument::save(const QString &fileName, QString *error)
     return true;
 }
 
+bool MapDocument::saveInBackground(const QString &fileName)
+{
+    finishBackgroundSave();
+
+    if (!MapSaver::canSave(this, MapSaver::Save)) {
+        QString error;
+        if (!save(fileName, &error)) {
+            emit saveFailed(error);
+            return false;
+        }
+        return true;
+    }
+
+    // Plugins don't use the layer data format
+    if (!PluginManager::instance()->pluginByFileName(mWriterPluginFileName))
+        upgradeXmlLayerData();
+
+    const int index = mUndoStack->index();
+    mSaveUndoIndex = index;
+    mSaveCommand = index > 0 ? mUndoStack->command(index - 1) : 0;
+
+    mSaver = new MapSaver(this, fileName, MapSaver::Save, this);
+    connect(mSaver, SIGNAL(finished()), SLOT(saverFinished()));
+    mSaver->start();
+    return true;
+}
+
+/**
+ * Switches a map using the XML layer data format, which is slow to load, to
+ * the layer data format for new maps when this is enabled in the
+ * preferences. The change is pushed on the undo stack, so the save leaves
+ * the document unmodified while the upgrade can still be undone.
+ */
+void MapDocument::upgradeXmlLayerData()
+{
+    if (mMap->layerDataFormat() != Map::XML)
+        return;
+
+    const Preferences *prefs = Preferences::instance();
+    if (!prefs->upgradeXmlLayerData())
+        return;
+
+    Map::LayerDataFormat format = prefs->layerDataFormat();
+    if (format == Map::XML)
+        format = Map::Base64Zlib;
+
+    mUndoStack->push(new ChangeMapProperty(this, format));
+}
+
+void MapDocument::autosave(const QString &fileName)
+{
+    if (mSaver)
+        return;
+
+    if (!MapSaver::canSave(this, MapSaver::Autosave)) {
+        TmxMapWriter mapWriter;
+        mapWriter.setLayerDataCache(&mLayerDataCache);
+        if (mapWriter.write(mMap, fileName)) {
+            emit autosaved(fileName);
+        } else {
+            qWarning("Autosave to %s failed: %s",
+                     qPrintable(fileName),
+                     qPrintable(mapWriter.errorString()));
+        }
+        return;
+    }
+
+    mSaver = new MapSaver(this, fileName, MapSaver::Autosave, this);
+    connect(mSaver, SIGNAL(finished()), SLOT(saverFinished()));
+    mSaver->start();
+}
+
+void MapDocument::finishBackgroundSave()
+{
+    if (!mSaver)
+        return;
+
+    mSaver->wait();
+    saverFinished();
+}
+
+void MapDocument::saverFinished()
+{
+    // May already have been handled by finishBackgroundSave()
+    if (!mSaver || !mSaver->isFinished())
+        return;
+
+    MapSaver *saver = mSaver;
+    mSaver = 0;
+    saver->disconnect(this);
+    saver->deleteLater();
+
+    if (saver->mode() == MapSaver::Autosave) {
+        if (saver->isSaved()) {
+            emit autosaved(saver->fileName());
+        } else {
+            qWarning("Autosave to %s failed: %s",
+                     qPrintable(saver->fileName()),
+                     qPrintable(saver->errorString()));
+        }
+        return;
+    }
+
+    if (!saver->isSaved()) {
+        emit saveFailed(saver->errorString());
+        return;
+    }
+
+    // Only mark as clean when nothing was changed while saving
+    const int index = mUndoStack->index();
+    const QUndoCommand *command = index > 0 ? mUndoStack->command(index - 1) : 0;
+    if (index == mSaveUndoIndex && command == mSaveCommand)
+        mUndoStack->setClean();
+
+    setFileName(saver->fileName());
+    mLastSaved = QFileInfo(saver->fileName()).lastModified();
+
+    emit saved();
+}
+
 MapDocument *MapDocument::load(const QString &fileName,
                                MapReaderInterface *mapReader,
                                QString *error)
@@ -317,17 +454,27 @@ void MapDocument::resizeMap(const QSize &size, const QPoint &offset)
         }
         case Layer::ObjectGroupType: {
             ObjectGroup *objectGroup = static_cast<ObjectGroup*>(layer);
+            QList<MapObject*> movedObjects;
+            QVector<TransformState> oldStates;
 
             // Remove objects that will fall outside of the map
             foreach (MapObject *o, objectGroup->objects()) {
                 if (!visibleIn(visibleArea, o, mRenderer)) {
                     mUndoStack->push(new RemoveMapObject(this, o));
                 } else {
-                    QPointF oldPos = o->position();
-                    o->setPosition(oldPos + pixelOffset);
-                    mUndoStack->push(new MoveMapObject(this, o, oldPos));
+                    movedObjects.append(o);
+                    oldStates.append(TransformState(o));
+                    o->setPosition(o->position() + pixelOffset);
                 }
             }
+
+            // Move the remaining objects at once, so that the views only
+            // need to update them once
+            if (!movedObjects.isEmpty()) {
+                mUndoStack->push(new TransformMapObjects(this, movedObjects, oldStates,
+                                                         tr("Move %n Object(s)", "",
+                                                            movedObjects.size())));
+            }
             break;
         }
         case Layer::ImageLayerType:
@@ -383,11 +530,11 @@ void MapDocument::rotateSelectedObjects(RotateDirection direction)
     if (mSelectedObjects.isEmpty())
         return;
 
-    mUndoStack->beginMacro(tr("Rotate %n Object(s)", "",
-                              mSelectedObjects.size()));
-
     // TODO: Rotate them properly as a group
+    QVector<TransformState> oldStates;
     foreach (MapObject *mapObject, mSelectedObjects) {
+        oldStates.append(TransformState(mapObject));
+
         const qreal oldRotation = mapObject->rotation();
         qreal newRotation = oldRotation;
 
@@ -402,9 +549,11 @@ void MapDocument::rotateSelectedObjects(RotateDirection direction)
         }
 
         mapObject->setRotation(newRotation);
-        mUndoStack->push(new RotateMapObject(this, mapObject, oldRotation));
     }
-    mUndoStack->endMacro();
+
+    mUndoStack->push(new TransformMapObjects(this, mSelectedObjects, oldStates,
+                                             tr("Rotate %n Object(s)", "",
+                                                mSelectedObjects.size())));
 }
 
 /**
@@ -474,6 +623,23 @@ void MapDocument::mergeLayerDown()
     if (!lowerLayer->canMergeWith(upperLayer))
         return;
 
+    // When the lower tile layer does not need to grow, the upper layer is
+    // painted onto it, which only remembers the cells that get replaced
+    if (lowerLayer->isTileLayer() &&
+            lowerLayer->bounds().contains(upperLayer->bounds())) {
+        TileLayer *upperTileLayer = static_cast<TileLayer*>(upperLayer);
+
+        mUndoStack->beginMacro(tr("Merge Layer Down"));
+        mUndoStack->push(new PaintTileLayer(this,
+                                            lowerLayer->asTileLayer(),
+                                            upperLayer->x(),
+                                            upperLayer->y(),
+                                            upperTileLayer));
+        mUndoStack->push(new RemoveLayer(this, mCurrentLayerIndex));
+        mUndoStack->endMacro();
+        return;
+    }
+
     Layer *merged = lowerLayer->mergedWith(upperLayer);
 
     mUndoStack->beginMacro(tr("Merge Layer Down"));
@@ -593,11 +759,37 @@ void MapDocument::moveTileset(int from, int to)
 
 void MapDocument::setSelectedArea(const QRegion &selection)
 {
-    if (mSelectedArea != selection) {
-        const QRegion oldSelectedArea = mSelectedArea;
-        mSelectedArea = selection;
-        emit selectedAreaChanged(mSelectedArea, oldSelectedArea);
-    }
+    if (mSelectedArea == selection)
+        return;
+
+    // The masks are compared, since this is much faster than subtracting
+    // the regions
+    const RegionMask selectionMask(selection);
+    RegionMask added = selectionMask;
+    added -= mSelectionMask;
+    RegionMask removed = mSelectionMask;
+    removed -= selectionMask;
+
+    const QRegion oldSelectedArea = mSelectedArea;
+    mSelectedArea = selection;
+    mSelectionMask = selectionMask;
+    emit selectedAreaChanged(mSelectedArea, oldSelectedArea);
+    emit selectedAreaModified(added.toRegion(), removed.toRegion());
+}
+
+void MapDocument::changeSelectedArea(const QRegion &added,
+                                     const QRegion &removed)
+{
+    if (added.isEmpty() && removed.isEmpty())
+        return;
+
+    mSelectionMask.remove(removed);
+    mSelectionMask.add(added);
+
+    const QRegion oldSelectedArea = mSelectedArea;
+    mSelectedArea = mSelectionMask.toRegion();
+    emit selectedAreaChanged(mSelectedArea, oldSelectedArea);
+    emit selectedAreaModified(added, removed);
 }
 
 void MapDocument::setSelectedObjects(const QList<MapObject *> &selectedObjects)
@@ -654,7 +846,9 @@ QList<Object*> MapDocument::currentObjects() const
 void MapDocument::unifyTilesets(Map *map)
 {
     QList<QUndoCommand*> undoCommands;
-    QList<Tileset*> existingTilesets = mMap->tilesets();
+    const QSet<Tileset*> existingTilesets = mMap->tilesets().toSet();
+    const QHash<TilesetKey, Tileset*> similarTilesets =
+            Tileset::similarityIndex(mMap->tilesets());
     TilesetManager *tilesetManager = TilesetManager::instance();
 
     // Add tilesets that are not yet part of this map
@@ -662,7 +856,7 @@ void MapDocument::unifyTilesets(Map *map)
         if (existingTilesets.contains(tileset))
             continue;
 
-        Tileset *replacement = tileset->findSimilarTileset(existingTilesets);
+        Tileset *replacement = similarTilesets.value(tileset->similarityKey());
         if (!replacement) {
             undoCommands.append(new AddTileset(this, tileset));
             continue;
@@ -693,6 +887,17 @@ void MapDocument::unifyTilesets(Map *map)
     }
 }
 
+/**
+ * Emits the map changed signal. This signal should be emitted after changing
+ * the map size or its tile size.
+ */
+void MapDocument::emitMapChanged()
+{
+    // The geometry of objects depends on the tile size and orientation
+    mRenderer->invalidateObjectGeometry();
+    emit mapChanged();
+}
+
 /**
  * Emits the tileset changed signal. This signal is currently used when adding
  * or removing tiles from a tileset.
@@ -817,6 +1022,7 @@ void MapDocument::deselectObjects(const QList<MapObject *> &objects)
 void MapDocument::setTilesetFileName(Tileset *tileset,
                                      const QString &fileName)
 {
+    MapSaver::waitForSaves(tileset);
     tileset->setFileName(fileName);
     emit tilesetFileNameChanged(tileset);
 }
@@ -916,18 +1122,19 @@ void MapDocument::createRenderer()
     if (mRenderer)
         delete mRenderer;
 
-    switch (mMap->orientation()) {
+    mRenderer = createRenderer(mMap);
+}
+
+MapRenderer *MapDocument::createRenderer(const Map *map)
+{
+    switch (map->orientation()) {
     case Map::Isometric:
-        mRenderer = new IsometricRenderer(mMap);
-        break;
+        return new IsometricRenderer(map);
     case Map::Staggered:
-        mRenderer = new StaggeredRenderer(mMap);
-        break;
+        return new StaggeredRenderer(map);
     case Map::Hexagonal:
-        mRenderer = new HexagonalRenderer(mMap);
-        break;
+        return new HexagonalRenderer(map);
     default:
-        mRenderer = new OrthogonalRenderer(mMap);
-        break;
+        return new OrthogonalRenderer(map);
     }
 }
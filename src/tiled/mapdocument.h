@@ -24,8 +24,10 @@
 #define MAPDOCUMENT_H
 
 #include "layer.h"
+#include "layerdatacache.h"
 #include "tiled.h"
 #include "mapobject.h"
+#include "regionmask.h"
 
 #include <QDateTime>
 #include <QList>
@@ -37,6 +39,7 @@ class QModelIndex;
 class QPoint;
 class QRect;
 class QSize;
+class QUndoCommand;
 class QUndoStack;
 
 namespace Tiled {
@@ -53,6 +56,8 @@ namespace Internal {
 
 class LayerModel;
 class MapObjectModel;
+class MapSaver;
+class ObjectSearchIndex;
 class TerrainModel;
 class TileSelectionModel;
 
@@ -100,6 +105,38 @@ public:
      */
     bool save(const QString &fileName, QString *error = 0);
 
+    /**
+     * Starts saving a copy of the map to the file at \a fileName on a worker
+     * thread, so that editing can continue in the meantime. When done, either
+     * saved() or saveFailed() is emitted.
+     *
+     * The document is only marked as unmodified when it wasn't changed while
+     * it was being saved. Any save that is still running is finished first.
+     *
+     * Maps that MapSaver can't save are saved right away instead. Returns
+     * false when that failed.
+     */
+    bool saveInBackground(const QString &fileName);
+
+    /**
+     * Returns whether the map is currently being saved in the background.
+     */
+    bool isSaving() const { return mSaver != 0; }
+
+    /**
+     * Starts saving a TMX copy of the map to \a fileName on a worker thread,
+     * for recovering it after a crash. Unlike saveInBackground(), this does
+     * not affect the file name or the modified state of the document. Does
+     * nothing when a save is already running.
+     */
+    void autosave(const QString &fileName);
+
+    /**
+     * Waits for a running background save or autosave and handles its
+     * result.
+     */
+    void finishBackgroundSave();
+
     /**
      * Loads a map and returns a MapDocument instance on success. Returns 0
      * on error and sets the \a error message.
@@ -128,6 +165,12 @@ public:
 
     QDateTime lastSaved() const { return mLastSaved; }
 
+    /**
+     * Returns the encoded layers of the last save, which are reused by the
+     * next save for the layers that did not change.
+     */
+    LayerDataCache *layerDataCache() { return &mLayerDataCache; }
+
     /**
      * Returns the map instance. Be aware that directly modifying the map will
      * not allow the GUI to update itself appropriately.
@@ -203,6 +246,12 @@ public:
 
     TerrainModel *terrainModel() const { return mTerrainModel; }
 
+    /**
+     * Returns the index used for searching the objects of the map by name,
+     * type and properties.
+     */
+    ObjectSearchIndex *objectSearchIndex() const { return mObjectSearchIndex; }
+
     /**
      * Returns the map renderer.
      */
@@ -214,6 +263,11 @@ public:
      */
     void createRenderer();
 
+    /**
+     * Returns a new renderer matching the orientation of the given \a map.
+     */
+    static MapRenderer *createRenderer(const Map *map);
+
     /**
      * Returns the undo stack of this map document. Should be used to push any
      * commands on that modify the map.
@@ -225,11 +279,28 @@ public:
      */
     const QRegion &selectedArea() const { return mSelectedArea; }
 
+    /**
+     * Returns the selected area of tiles as a mask. Checking whether a cell
+     * is selected and intersecting with the selection is quicker using the
+     * mask, especially for fragmented selections.
+     */
+    const RegionMask &selectionMask() const { return mSelectionMask; }
+
     /**
      * Sets the selected area of tiles.
      */
     void setSelectedArea(const QRegion &selection);
 
+    /**
+     * Changes the selected area of tiles by adding the \a added cells and
+     * removing the \a removed cells. Unlike setSelectedArea, this only needs
+     * to look at the changes rather than at the whole selection.
+     *
+     * The \a added cells should not be selected yet, and the \a removed
+     * cells should all be selected.
+     */
+    void changeSelectedArea(const QRegion &added, const QRegion &removed);
+
     /**
      * Returns the list of selected objects.
      */
@@ -294,6 +365,16 @@ signals:
 
     void saved();
 
+    /**
+     * Emitted when saving the map in the background failed.
+     */
+    void saveFailed(const QString &error);
+
+    /**
+     * Emitted when an autosave has been written to \a fileName.
+     */
+    void autosaved(const QString &fileName);
+
     /**
      * Emitted when the selected tile region changes. Sends the currently
      * selected region and the previously selected region.
@@ -301,6 +382,12 @@ signals:
     void selectedAreaChanged(const QRegion &newSelection,
                               const QRegion &oldSelection);
 
+    /**
+     * Emitted after selectedAreaChanged, with the cells that were \a added to
+     * and \a removed from the selection.
+     */
+    void selectedAreaModified(const QRegion &added, const QRegion &removed);
+
     /**
      * Emitted when the list of selected objects changes.
      */
@@ -324,6 +411,12 @@ signals:
     void layerRemoved(int index);
     void layerChanged(int index);
 
+    /**
+     * Emitted instead of layerChanged when the visibility or opacity of
+     * several layers was changed at once.
+     */
+    void layersChanged(const QList<int> &indexes);
+
     /**
      * Emitted after a new layer was added and the name should be edited.
      * Applies to the current layer.
@@ -396,8 +489,11 @@ private slots:
 
     void onTerrainRemoved(Terrain *terrain);
 
+    void saverFinished();
+
 private:
     void setFileName(const QString &fileName);
+    void upgradeXmlLayerData();
     void deselectObjects(const QList<MapObject*> &objects);
 
     QString mFileName;
@@ -416,6 +512,7 @@ private:
     Map *mMap;
     LayerModel *mLayerModel;
     QRegion mSelectedArea;
+    RegionMask mSelectionMask;
     QList<MapObject*> mSelectedObjects;
     QList<Tile*> mSelectedTiles;
     Object *mCurrentObject;             /**< Current properties object. */
@@ -423,8 +520,13 @@ private:
     int mCurrentLayerIndex;
     MapObjectModel *mMapObjectModel;
     TerrainModel *mTerrainModel;
+    ObjectSearchIndex *mObjectSearchIndex;
     QUndoStack *mUndoStack;
     QDateTime mLastSaved;
+    LayerDataCache mLayerDataCache;     /**< Encoded layers of the last save. */
+    MapSaver *mSaver;                   /**< Running background save, if any. */
+    int mSaveUndoIndex;                 /**< Undo index at the start of it. */
+    const QUndoCommand *mSaveCommand;   /**< Last command at the start of it. */
 };
 
 inline QString MapDocument::lastExportFileName() const
@@ -467,15 +569,6 @@ inline void MapDocument::setExportPluginFileName(const QString &fileName)
     mExportPluginFileName = fileName;
 }
 
-/**
- * Emits the map changed signal. This signal should be emitted after changing
- * the map size or its tile size.
- */
-inline void MapDocument::emitMapChanged()
-{
-    emit mapChanged();
-}
-
 /**
  * Emits the region changed signal for the specified region. The region
  * should be in tile coordinates. This method is used by the TilePainter.
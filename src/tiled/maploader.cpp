@@ -0,0 +1,66 @@
+/*
+ * maploader.cpp
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "maploader.h"
+
+#include "map.h"
+#include "mapdocument.h"
+
+using namespace Tiled;
+using namespace Tiled::Internal;
+
+MapLoader::MapLoader(const QString &fileName, QObject *parent)
+    : QThread(parent)
+    , mFileName(fileName)
+    , mMap(0)
+{
+}
+
+MapLoader::~MapLoader()
+{
+    wait();
+
+    if (mMap) {
+        // The tilesets are not owned by the map
+        qDeleteAll(mMap->tilesets());
+        delete mMap;
+    }
+}
+
+MapDocument *MapLoader::takeMapDocument()
+{
+    Q_ASSERT(isFinished());
+
+    if (!mMap)
+        return 0;
+
+    mReader.finishDeferredRead(mMap);
+
+    MapDocument *mapDocument = new MapDocument(mMap, mFileName);
+    mMap = 0;
+    return mapDocument;
+}
+
+void MapLoader::run()
+{
+    mMap = mReader.readDeferred(mFileName);
+    if (!mMap)
+        mError = mReader.errorString();
+}
@@ -0,0 +1,84 @@
+/*
+ * maploader.h
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MAPLOADER_H
+#define MAPLOADER_H
+
+#include "tmxmapreader.h"
+
+#include <QString>
+#include <QThread>
+
+namespace Tiled {
+
+class Map;
+
+namespace Internal {
+
+class MapDocument;
+
+/**
+ * Loads a TMX map on a worker thread, so that the user interface stays
+ * responsive while large maps are parsed and their images decoded.
+ *
+ * Once finished() has been emitted, takeMapDocument() creates the document
+ * on the GUI thread.
+ */
+class MapLoader : public QThread
+{
+    Q_OBJECT
+
+public:
+    explicit MapLoader(const QString &fileName, QObject *parent = 0);
+
+    /**
+     * Waits for the worker thread and discards the map when it was not
+     * taken.
+     */
+    ~MapLoader();
+
+    const QString &fileName() const { return mFileName; }
+
+    /**
+     * Returns the document for the loaded map, or 0 when loading failed.
+     * The caller takes ownership of the document. Needs to be called on the
+     * GUI thread after loading has finished.
+     */
+    MapDocument *takeMapDocument();
+
+    /**
+     * Returns the error message when loading failed.
+     */
+    QString errorString() const { return mError; }
+
+protected:
+    void run();
+
+private:
+    const QString mFileName;
+    TmxMapReader mReader;
+    Map *mMap;
+    QString mError;
+};
+
+} // namespace Internal
+} // namespace Tiled
+
+#endif // MAPLOADER_H
@@ -30,6 +30,7 @@
 #include "mapview.h"
 #include "objectgroup.h"
 #include "objectgroupitem.h"
+#include "paintstatistics.h"
 #include "preferences.h"
 #include "resizemapobject.h"
 #include "tile.h"
@@ -133,9 +134,27 @@ QPainterPath MapObjectItem::shape() const
 }
 
 void MapObjectItem::paint(QPainter *painter,
-                          const QStyleOptionGraphicsItem *,
+                          const QStyleOptionGraphicsItem *option,
                           QWidget *widget)
 {
+    LayerPaintTimer paintTimer(mObject->objectGroup());
+
+    // At low zoom levels, reduce the object to its bounds or even a single
+    // dot, since the details wouldn't be visible anyway
+    const Preferences *prefs = Preferences::instance();
+    const qreal lod = option->levelOfDetailFromTransform(painter->worldTransform());
+    const qreal screenSize = qMax(mBoundingRect.width(),
+                                  mBoundingRect.height()) * lod;
+
+    if (screenSize < prefs->objectDotSize()) {
+        drawDot(painter, lod);
+        return;
+    }
+    if (screenSize < prefs->objectOutlineSize() && !mObject->cell().tile) {
+        drawOutline(painter);
+        return;
+    }
+
     qreal scale = static_cast<MapView*>(widget->parent())->zoomable()->scale();
     painter->translate(-pos());
     mMapDocument->renderer()->setPainterScale(scale);
@@ -161,6 +180,30 @@ void MapObjectItem::paint(QPainter *painter,
     }
 }
 
+/**
+ * Draws the object as a single dot of its color, centered on its bounds.
+ * Tiny objects that are close together merge into one blob this way.
+ */
+void MapObjectItem::drawDot(QPainter *painter, qreal lod)
+{
+    const qreal size = 1 / lod;
+    QRectF dot(0, 0, size, size);
+    dot.moveCenter(mBoundingRect.center());
+    painter->fillRect(dot, mColor);
+}
+
+/**
+ * Draws just the bounds of the object, without shadow or fill.
+ */
+void MapObjectItem::drawOutline(QPainter *painter)
+{
+    QPen pen(mColor);
+    pen.setCosmetic(true);
+    painter->setPen(pen);
+    painter->setBrush(Qt::NoBrush);
+    painter->drawRect(mBoundingRect);
+}
+
 void MapObjectItem::resizeObject(const QSizeF &size)
 {
     // Not using the MapObjectModel because it is also used during object
@@ -183,9 +226,11 @@ void MapObjectItem::setPolygon(const QPolygonF &polygon)
 QColor MapObjectItem::objectColor(const MapObject *object)
 {
     // See if this object type has a color associated with it
-    foreach (const ObjectType &type, Preferences::instance()->objectTypes()) {
-        if (type.name.compare(object->type(), Qt::CaseInsensitive) == 0)
-            return type.color;
+    if (!object->type().isEmpty()) {
+        const QColor color =
+                Preferences::instance()->objectTypeColor(object->type());
+        if (color.isValid())
+            return color;
     }
 
     // If not, get color from object group
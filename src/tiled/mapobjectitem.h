@@ -106,6 +106,9 @@ public:
     static QColor objectColor(const MapObject *object);
 
 private:
+    void drawDot(QPainter *painter, qreal lod);
+    void drawOutline(QPainter *painter);
+
     MapDocument *mapDocument() const { return mMapDocument; }
     QColor color() const { return mColor; }
 
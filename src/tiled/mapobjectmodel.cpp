@@ -48,7 +48,7 @@ QModelIndex MapObjectModel::index(int row, int column,
 {
     if (!parent.isValid()) {
         if (row < mObjectGroups.count())
-            return createIndex(row, column, mGroups[mObjectGroups.at(row)]);
+            return createIndex(row, column, mGroups.value(mObjectGroups.at(row)));
         return QModelIndex();
     }
 
@@ -58,11 +58,7 @@ QModelIndex MapObjectModel::index(int row, int column,
     if (row >= og->objectCount())
         return QModelIndex();
 
-    // Paranoia: sometimes "fake" objects are in use (see createobjecttool)
-    if (!mObjects.contains(og->objects().at(row)))
-        return QModelIndex();
-
-    return createIndex(row, column, mObjects[og->objects()[row]]);
+    return createIndex(row, column, objectOrGroup(og->objectAt(row)));
 }
 
 QModelIndex MapObjectModel::parent(const QModelIndex &index) const
@@ -216,15 +212,15 @@ QVariant MapObjectModel::headerData(int section, Qt::Orientation orientation,
 QModelIndex MapObjectModel::index(ObjectGroup *og) const
 {
     const int row = mObjectGroups.indexOf(og);
-    Q_ASSERT(mGroups[og]);
-    return createIndex(row, 0, mGroups[og]);
+    Q_ASSERT(mGroups.contains(og));
+    return createIndex(row, 0, mGroups.value(og));
 }
 
 QModelIndex MapObjectModel::index(MapObject *o, int column) const
 {
-    const int row = o->objectGroup()->objects().indexOf(o);
-    Q_ASSERT(mObjects[o]);
-    return createIndex(row, column, mObjects[o]);
+    const int row = o->objectGroup()->objectIndex(o);
+    Q_ASSERT(row != -1);
+    return createIndex(row, column, objectOrGroup(o));
 }
 
 ObjectGroup *MapObjectModel::toObjectGroup(const QModelIndex &index) const
@@ -254,6 +250,31 @@ ObjectGroup *MapObjectModel::toLayer(const QModelIndex &index) const
     return oog->mGroup ? oog->mGroup : oog->mObject->objectGroup();
 }
 
+/**
+ * Returns the entry used as internal pointer for the indexes of the given
+ * object. The entries are only created for the objects that are asked for,
+ * which are usually only those of the expanded groups that are on screen.
+ */
+MapObjectModel::ObjectOrGroup *MapObjectModel::objectOrGroup(MapObject *o) const
+{
+    ObjectOrGroup *&oog = mObjects[o];
+    if (!oog)
+        oog = new ObjectOrGroup(o);
+    return oog;
+}
+
+/**
+ * Deletes the entries of the objects in the given object group.
+ */
+void MapObjectModel::removeObjectOrGroups(ObjectGroup *og)
+{
+    if (mObjects.isEmpty())
+        return;
+
+    foreach (MapObject *o, og->objects())
+        delete mObjects.take(o);
+}
+
 void MapObjectModel::setMapDocument(MapDocument *mapDocument)
 {
     if (mMapDocument == mapDocument)
@@ -279,6 +300,8 @@ void MapObjectModel::setMapDocument(MapDocument *mapDocument)
                 this, SLOT(layerAdded(int)));
         connect(mMapDocument, SIGNAL(layerChanged(int)),
                 this, SLOT(layerChanged(int)));
+        connect(mMapDocument, SIGNAL(layersChanged(QList<int>)),
+                this, SLOT(layersChanged(QList<int>)));
         connect(mMapDocument, SIGNAL(layerAboutToBeRemoved(int)),
                 this, SLOT(layerAboutToBeRemoved(int)));
 
@@ -289,8 +312,6 @@ void MapObjectModel::setMapDocument(MapDocument *mapDocument)
             mObjectGroups.append(og);
 #endif
             mGroups.insert(og, new ObjectOrGroup(og));
-            foreach (MapObject *o, og->objects())
-                mObjects.insert(o, new ObjectOrGroup(o));
         }
     }
 
@@ -315,10 +336,6 @@ void MapObjectModel::layerAdded(int index)
             const int row = mObjectGroups.indexOf(og);
             beginInsertRows(QModelIndex(), row, row);
             mGroups.insert(og, new ObjectOrGroup(og));
-            foreach (MapObject *o, og->objects()) {
-                if (!mObjects.contains(o))
-                    mObjects.insert(o, new ObjectOrGroup(o));
-            }
             endInsertRows();
         }
     }
@@ -333,6 +350,12 @@ void MapObjectModel::layerChanged(int index)
     }
 }
 
+void MapObjectModel::layersChanged(const QList<int> &indexes)
+{
+    foreach (int index, indexes)
+        layerChanged(index);
+}
+
 void MapObjectModel::layerAboutToBeRemoved(int index)
 {
     Layer *layer = mMap->layerAt(index);
@@ -341,9 +364,7 @@ void MapObjectModel::layerAboutToBeRemoved(int index)
         beginRemoveRows(QModelIndex(), row, row);
         mObjectGroups.removeAt(row);
         delete mGroups.take(og);
-        foreach (MapObject *o, og->objects())
-            delete mObjects.take(o);
-
+        removeObjectOrGroups(og);
         endRemoveRows();
     }
 }
@@ -353,7 +374,6 @@ void MapObjectModel::insertObject(ObjectGroup *og, int index, MapObject *o)
     const int row = (index >= 0) ? index : og->objectCount();
     beginInsertRows(this->index(og), row, row);
     og->insertObject(row, o);
-    mObjects.insert(o, new ObjectOrGroup(o));
     endInsertRows();
     emit objectsAdded(QList<MapObject*>() << o);
 }
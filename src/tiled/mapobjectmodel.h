@@ -22,6 +22,7 @@
 #define MAPOBJECTMODEL_H
 
 #include <QAbstractItemModel>
+#include <QHash>
 #include <QIcon>
 
 namespace Tiled {
@@ -110,14 +111,18 @@ signals:
 private slots:
     void layerAdded(int index);
     void layerChanged(int index);
+    void layersChanged(const QList<int> &indexes);
     void layerAboutToBeRemoved(int index);
 
 private:
+    ObjectOrGroup *objectOrGroup(MapObject *o) const;
+    void removeObjectOrGroups(ObjectGroup *og);
+
     MapDocument *mMapDocument;
     Map *mMap;
     QList<ObjectGroup*> mObjectGroups;
-    QMap<MapObject*, ObjectOrGroup*> mObjects;
-    QMap<ObjectGroup*, ObjectOrGroup*> mGroups;
+    mutable QHash<MapObject*, ObjectOrGroup*> mObjects;
+    QHash<ObjectGroup*, ObjectOrGroup*> mGroups;
 
     QIcon mObjectGroupIcon;
 };
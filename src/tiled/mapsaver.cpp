@@ -0,0 +1,91 @@
+/*
+ * mapsaver.cpp
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mapsaver.h"
+
+#include "map.h"
+#include "mapdocument.h"
+#include "pluginmanager.h"
+#include "tileset.h"
+#include "tilesetmanager.h"
+#include "tmxmapwriter.h"
+
+using namespace Tiled;
+using namespace Tiled::Internal;
+
+// The savers that exist, only accessed from the GUI thread
+static QList<MapSaver*> savers;
+
+MapSaver::MapSaver(MapDocument *mapDocument, const QString &fileName,
+                   Mode mode, QObject *parent)
+    : QThread(parent)
+    , mFileName(fileName)
+    , mMode(mode)
+    , mMap(new Map(*mapDocument->map()))
+    , mLayerDataCache(mapDocument->layerDataCache())
+    , mSaved(false)
+{
+    Q_ASSERT(canSave(mapDocument, mode));
+
+    // Keep the tilesets alive while the copy is being saved
+    TilesetManager::instance()->addReferences(mMap->tilesets());
+    savers.append(this);
+}
+
+MapSaver::~MapSaver()
+{
+    wait();
+    savers.removeOne(this);
+
+    TilesetManager::instance()->removeReferences(mMap->tilesets());
+    delete mMap;
+}
+
+bool MapSaver::canSave(const MapDocument *mapDocument, Mode mode)
+{
+    if (mode == Save) {
+        PluginManager *pm = PluginManager::instance();
+        if (pm->pluginByFileName(mapDocument->writerPluginFileName()))
+            return false;
+    }
+
+    foreach (const Tileset *tileset, mapDocument->map()->tilesets())
+        if (tileset->fileName().isEmpty())
+            return false;
+
+    return true;
+}
+
+void MapSaver::waitForSaves(const Tileset *tileset)
+{
+    foreach (MapSaver *saver, savers)
+        if (saver->mMap->tilesets().contains(const_cast<Tileset*>(tileset)))
+            saver->wait();
+}
+
+void MapSaver::run()
+{
+    TmxMapWriter mapWriter;
+    mapWriter.setLayerDataCache(mLayerDataCache);
+
+    mSaved = mapWriter.write(mMap, mFileName);
+    if (!mSaved)
+        mError = mapWriter.errorString();
+}
@@ -0,0 +1,108 @@
+/*
+ * mapsaver.h
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MAPSAVER_H
+#define MAPSAVER_H
+
+#include <QString>
+#include <QThread>
+
+namespace Tiled {
+
+class LayerDataCache;
+class Map;
+class Tileset;
+
+namespace Internal {
+
+class MapDocument;
+
+/**
+ * Saves a copy of the map of a document on a worker thread, so that editing
+ * can continue while a large map is written.
+ *
+ * The copy shares the cells of its tile layers with the map of the document
+ * until either is changed, so taking it is cheap. The tilesets are not
+ * copied. Only maps that use external tilesets alone can be saved this way,
+ * since of those only the file name and the tiles are written, and anything
+ * that changes these waits for the saves using the tileset to finish first.
+ */
+class MapSaver : public QThread
+{
+    Q_OBJECT
+
+public:
+    enum Mode {
+        Save,       /**< Saves in the format of the document. */
+        Autosave    /**< Saves a TMX copy for crash recovery. */
+    };
+
+    MapSaver(MapDocument *mapDocument, const QString &fileName,
+             Mode mode = Save, QObject *parent = 0);
+
+    /**
+     * Waits for the worker thread and deletes the copy of the map.
+     */
+    ~MapSaver();
+
+    /**
+     * Returns whether the map of \a mapDocument can be saved by a MapSaver in
+     * the given \a mode. This is not the case for maps saved by a plugin,
+     * since plugins may not be safe to run on another thread, and for maps
+     * with embedded tilesets, which can be edited while they are written.
+     */
+    static bool canSave(const MapDocument *mapDocument, Mode mode);
+
+    /**
+     * Waits for the running saves that write a map using \a tileset. Needs
+     * to be called before changing the file name or the tiles of a tileset.
+     */
+    static void waitForSaves(const Tileset *tileset);
+
+    const QString &fileName() const { return mFileName; }
+    Mode mode() const { return mMode; }
+
+    /**
+     * Returns whether the map was saved. Only valid once the thread has
+     * finished.
+     */
+    bool isSaved() const { return mSaved; }
+
+    /**
+     * Returns the error message when saving failed.
+     */
+    QString errorString() const { return mError; }
+
+protected:
+    void run();
+
+private:
+    const QString mFileName;
+    const Mode mMode;
+    Map *mMap;
+    LayerDataCache *mLayerDataCache;
+    bool mSaved;
+    QString mError;
+};
+
+} // namespace Internal
+} // namespace Tiled
+
+#endif // MAPSAVER_H
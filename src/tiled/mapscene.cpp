@@ -34,6 +34,7 @@
 #include "preferences.h"
 #include "tile.h"
 #include "tilelayer.h"
+#include "tilelayercompositeitem.h"
 #include "tilelayeritem.h"
 #include "tileselectionitem.h"
 #include "imagelayer.h"
@@ -54,6 +55,12 @@ using namespace Tiled::Internal;
 static const qreal darkeningFactor = 0.6;
 static const qreal opacityFactor = 0.4;
 
+// Changed regions are repainted at most about once per frame
+static const int repaintInterval = 16;
+
+// Dirty regions with more rectangles are repainted as their bounding rect
+static const int maxDirtyRects = 32;
+
 MapScene::MapScene(QObject *parent):
     QGraphicsScene(parent),
     mMapDocument(0),
@@ -66,11 +73,14 @@ MapScene::MapScene(QObject *parent):
 {
     setBackgroundBrush(mDefaultBackgroundColor);
 
+    mRepaintTimer.setSingleShot(true);
+    connect(&mRepaintTimer, SIGNAL(timeout()), SLOT(flushDirtyRegion()));
+
     TilesetManager *tilesetManager = TilesetManager::instance();
     connect(tilesetManager, SIGNAL(tilesetChanged(Tileset*)),
             this, SLOT(tilesetChanged(Tileset*)));
-    connect(tilesetManager, SIGNAL(repaintTileset(Tileset*)),
-            this, SLOT(tilesetChanged(Tileset*)));
+    connect(tilesetManager, SIGNAL(repaintTiles(QSet<Tile*>)),
+            this, SLOT(repaintTiles(QSet<Tile*>)));
 
     Preferences *prefs = Preferences::instance();
     connect(prefs, SIGNAL(showGridChanged(bool)), SLOT(setGridVisible(bool)));
@@ -79,7 +89,12 @@ MapScene::MapScene(QObject *parent):
     connect(prefs, SIGNAL(objectTypesChanged()), SLOT(syncAllObjectItems()));
     connect(prefs, SIGNAL(highlightCurrentLayerChanged(bool)),
             SLOT(setHighlightCurrentLayer(bool)));
+    connect(prefs, SIGNAL(useChunkItemsChanged(bool)),
+            SLOT(setUseChunkItems(bool)));
+    connect(prefs, SIGNAL(flattenLayersChanged(bool)),
+            SLOT(setFlattenLayers(bool)));
     connect(prefs, SIGNAL(gridColorChanged(QColor)), SLOT(update()));
+    connect(prefs, SIGNAL(objectDetailSizesChanged()), SLOT(update()));
     connect(prefs, SIGNAL(objectLineWidthChanged(qreal)),
             SLOT(setObjectLineWidth(qreal)));
 
@@ -92,6 +107,8 @@ MapScene::MapScene(QObject *parent):
     mObjectLineWidth = prefs->objectLineWidth();
     mShowTileObjectOutlines = prefs->showTileObjectOutlines();
     mHighlightCurrentLayer = prefs->highlightCurrentLayer();
+    mUseChunkItems = prefs->useChunkItems();
+    mFlattenLayers = prefs->flattenLayers();
 
     // Install an event filter so that we can get key events on behalf of the
     // active tool without having to have the current focus.
@@ -116,6 +133,10 @@ void MapScene::setMapDocument(MapDocument *mapDocument)
 
     mMapDocument = mapDocument;
 
+    // The whole scene is refreshed anyway
+    mDirtyRegion = QRegion();
+    mRepaintTimer.stop();
+
     if (mMapDocument) {
         MapRenderer *renderer = mMapDocument->renderer();
         renderer->setObjectLineWidth(mObjectLineWidth);
@@ -133,6 +154,8 @@ void MapScene::setMapDocument(MapDocument *mapDocument)
                 this, SLOT(layerRemoved(int)));
         connect(mMapDocument, SIGNAL(layerChanged(int)),
                 this, SLOT(layerChanged(int)));
+        connect(mMapDocument, SIGNAL(layersChanged(QList<int>)),
+                this, SLOT(layersChanged(QList<int>)));
         connect(mMapDocument, SIGNAL(objectGroupChanged(ObjectGroup*)),
                 this, SLOT(objectGroupChanged(ObjectGroup*)));
         connect(mMapDocument, SIGNAL(imageLayerChanged(ImageLayer*)),
@@ -141,6 +164,10 @@ void MapScene::setMapDocument(MapDocument *mapDocument)
                 this, SLOT(currentLayerIndexChanged()));
         connect(mMapDocument, SIGNAL(tilesetTileOffsetChanged(Tileset*)),
                 this, SLOT(tilesetTileOffsetChanged(Tileset*)));
+        connect(mMapDocument, SIGNAL(tilesetChanged(Tileset*)),
+                this, SLOT(tilesetChanged(Tileset*)));
+        connect(mMapDocument, SIGNAL(tileAnimationChanged(Tile*)),
+                this, SLOT(tileAnimationChanged(Tile*)));
         connect(mMapDocument, SIGNAL(objectsInserted(ObjectGroup*,int,int)),
                 this, SLOT(objectsInserted(ObjectGroup*,int,int)));
         connect(mMapDocument, SIGNAL(objectsRemoved(QList<MapObject*>)),
@@ -173,10 +200,22 @@ void MapScene::setSelectedTool(AbstractTool *tool)
     mSelectedTool = tool;
 }
 
+void MapScene::prefetch(const QRectF &rect, qreal scale,
+                        QPainter::RenderHints renderHints)
+{
+    foreach (QGraphicsItem *item, mLayerItems)
+        if (TileLayerItem *tli = dynamic_cast<TileLayerItem*>(item))
+            if (tli->isVisible())
+                tli->prefetch(rect, scale, renderHints);
+}
+
 void MapScene::refreshScene()
 {
     mLayerItems.clear();
+    mLayerComposites.clear();
     mObjectItems.clear();
+    mGridCache.clear();
+    mGridCache.setMapDocument(mMapDocument);
 
     removeItem(mDarkRectangle);
     clear();
@@ -220,7 +259,9 @@ QGraphicsItem *MapScene::createLayerItem(Layer *layer)
     QGraphicsItem *layerItem = 0;
 
     if (TileLayer *tl = layer->asTileLayer()) {
-        layerItem = new TileLayerItem(tl, mMapDocument);
+        TileLayerItem *tlItem = new TileLayerItem(tl, mMapDocument);
+        tlItem->setUseChunkItems(mUseChunkItems);
+        layerItem = tlItem;
     } else if (ObjectGroup *og = layer->asObjectGroup()) {
         const ObjectGroup::DrawOrder drawOrder = og->drawOrder();
         ObjectGroupItem *ogItem = new ObjectGroupItem(og);
@@ -263,6 +304,7 @@ void MapScene::updateCurrentLayerHighlight()
             mLayerItems.at(i)->setOpacity(layer->opacity());
         }
 
+        updateLayerComposites();
         return;
     }
 
@@ -276,14 +318,122 @@ void MapScene::updateCurrentLayerHighlight()
         const qreal multiplier = (currentLayerIndex < i) ? opacityFactor : 1;
         mLayerItems.at(i)->setOpacity(layer->opacity() * multiplier);
     }
+
+    updateLayerComposites();
+}
+
+/**
+ * While highlighting the current layer or when flattening layers, combines
+ * each run of consecutive visible tile layers below or above it into a
+ * composite item. The layers in such a run are displayed from a single
+ * cache, so that repainting while editing the current layer does not need to
+ * draw each of them. Composites that still show the same layers are kept
+ * along with their cache.
+ */
+void MapScene::updateLayerComposites()
+{
+    const Map *map = mMapDocument->map();
+    const int currentLayerIndex = mMapDocument->currentLayerIndex();
+
+    QList<TileLayerCompositeItem*> oldComposites = mLayerComposites;
+    mLayerComposites.clear();
+
+    QSet<QGraphicsItem*> compositedItems;
+
+    if ((mHighlightCurrentLayer || mFlattenLayers) && currentLayerIndex != -1) {
+        QList<TileLayerItem*> run;
+        int runTop = 0;
+
+        for (int i = 0; i <= mLayerItems.size(); ++i) {
+            const Layer *layer = i < mLayerItems.size() ? map->layerAt(i) : 0;
+
+            if (layer && i != currentLayerIndex) {
+                if (!layer->isVisible())
+                    continue;
+
+                if (layer->isTileLayer()) {
+                    run.append(static_cast<TileLayerItem*>(mLayerItems.at(i)));
+                    runTop = i;
+                    continue;
+                }
+            }
+
+            // Compositing a single layer would only cost memory
+            if (run.size() > 1) {
+                TileLayerCompositeItem *composite = 0;
+                for (int j = 0; j < oldComposites.size(); ++j) {
+                    if (oldComposites.at(j)->layerItems() == run) {
+                        composite = oldComposites.takeAt(j);
+                        composite->syncWithLayerItems();
+                        break;
+                    }
+                }
+
+                if (!composite) {
+                    composite = new TileLayerCompositeItem(run);
+                    addItem(composite);
+                }
+
+                composite->setZValue(runTop);
+                if (mHighlightCurrentLayer && runTop > currentLayerIndex)
+                    composite->setOpacity(opacityFactor);
+                else
+                    composite->setOpacity(1);
+                mLayerComposites.append(composite);
+
+                foreach (TileLayerItem *item, run)
+                    compositedItems.insert(item);
+            }
+
+            run.clear();
+        }
+    }
+
+    qDeleteAll(oldComposites);
+
+    for (int i = 0; i < mLayerItems.size(); ++i) {
+        QGraphicsItem *item = mLayerItems.at(i);
+        item->setVisible(map->layerAt(i)->isVisible() &&
+                         !compositedItems.contains(item));
+    }
 }
 
 void MapScene::repaintRegion(const QRegion &region)
 {
+    // The caches are updated right away, since the layers only know which
+    // of them changed until the next change
+    foreach (QGraphicsItem *item, mLayerItems)
+        if (TileLayerItem *tli = dynamic_cast<TileLayerItem*>(item))
+            tli->repaintRegion(region);
+    foreach (TileLayerCompositeItem *composite, mLayerComposites)
+        composite->repaintRegion(region);
+
+    mDirtyRegion |= region;
+    if (!mRepaintTimer.isActive())
+        mRepaintTimer.start(repaintInterval);
+}
+
+/**
+ * Repaints the regions that changed since the last timer tick. Regions made
+ * up of many rectangles are repainted as their bounding rectangle instead.
+ */
+void MapScene::flushDirtyRegion()
+{
+    if (!mMapDocument || mDirtyRegion.isEmpty())
+        return;
+
+    QVector<QRect> rects = mDirtyRegion.rects();
+    if (rects.size() > maxDirtyRects) {
+        rects.clear();
+        rects.append(mDirtyRegion.boundingRect());
+    }
+
+    mDirtyRegion = QRegion();
+
     const MapRenderer *renderer = mMapDocument->renderer();
     const QMargins margins = mMapDocument->map()->drawMargins();
 
-    foreach (const QRect &r, region.rects()) {
+    foreach (const QRect &r, rects) {
         update(renderer->boundingRect(r).adjusted(-margins.left(),
                                                   -margins.top(),
                                                   margins.right(),
@@ -334,11 +484,14 @@ void MapScene::mapChanged()
     const QSize mapSize = mMapDocument->renderer()->mapSize();
     setSceneRect(0, 0, mapSize.width(), mapSize.height());
     mDarkRectangle->setRect(0, 0, mapSize.width(), mapSize.height());
+    mGridCache.clear();
 
     foreach (QGraphicsItem *item, mLayerItems) {
         if (TileLayerItem *tli = dynamic_cast<TileLayerItem*>(item))
             tli->syncWithTileLayer();
     }
+    foreach (TileLayerCompositeItem *composite, mLayerComposites)
+        composite->syncWithLayerItems();
 
     foreach (MapObjectItem *item, mObjectItems)
         item->syncWithMapObject();
@@ -355,8 +508,42 @@ void MapScene::tilesetChanged(Tileset *tileset)
     if (!mMapDocument)
         return;
 
-    if (mMapDocument->map()->tilesets().contains(tileset))
-        update();
+    if (!mMapDocument->map()->tilesets().contains(tileset))
+        return;
+
+    foreach (QGraphicsItem *item, mLayerItems) {
+        if (TileLayerItem *tli = dynamic_cast<TileLayerItem*>(item))
+            if (tli->tileLayer()->referencesTileset(tileset))
+                tli->invalidateCache();
+    }
+
+    update();
+}
+
+void MapScene::tileAnimationChanged(Tile *tile)
+{
+    // The layers need to find out where this tile is used
+    tilesetChanged(tile->tileset());
+}
+
+/**
+ * Repaints the parts of the map showing any of the given animated \a tiles.
+ */
+void MapScene::repaintTiles(const QSet<Tile*> &tiles)
+{
+    if (!mMapDocument)
+        return;
+
+    foreach (QGraphicsItem *item, mLayerItems)
+        if (TileLayerItem *tli = dynamic_cast<TileLayerItem*>(item))
+            tli->repaintTiles(tiles);
+    foreach (TileLayerCompositeItem *composite, mLayerComposites)
+        composite->repaintTiles(tiles);
+
+    foreach (MapObjectItem *item, mObjectItems)
+        if (Tile *tile = item->mapObject()->cell().tile)
+            if (tiles.contains(tile))
+                item->update();
 }
 
 void MapScene::tileLayerDrawMarginsChanged(TileLayer *tileLayer)
@@ -364,6 +551,9 @@ void MapScene::tileLayerDrawMarginsChanged(TileLayer *tileLayer)
     const int index = mMapDocument->map()->layers().indexOf(tileLayer);
     TileLayerItem *item = static_cast<TileLayerItem*>(mLayerItems.at(index));
     item->syncWithTileLayer();
+
+    foreach (TileLayerCompositeItem *composite, mLayerComposites)
+        composite->syncWithLayerItems();
 }
 
 void MapScene::layerAdded(int index)
@@ -376,12 +566,17 @@ void MapScene::layerAdded(int index)
     int z = 0;
     foreach (QGraphicsItem *item, mLayerItems)
         item->setZValue(z++);
+
+    updateLayerComposites();
 }
 
 void MapScene::layerRemoved(int index)
 {
     delete mLayerItems.at(index);
     mLayerItems.remove(index);
+
+    // Composites including the removed layer are dropped
+    updateLayerComposites();
 }
 
 /**
@@ -390,16 +585,31 @@ void MapScene::layerRemoved(int index)
  */
 void MapScene::layerChanged(int index)
 {
-    const Layer *layer = mMapDocument->map()->layerAt(index);
-    QGraphicsItem *layerItem = mLayerItems.at(index);
+    layersChanged(QList<int>() << index);
+}
 
-    layerItem->setVisible(layer->isVisible());
+/**
+ * Several layers have changed at once. The composites are only updated once
+ * for all of them.
+ */
+void MapScene::layersChanged(const QList<int> &indexes)
+{
+    const int currentLayerIndex = mMapDocument->currentLayerIndex();
+
+    foreach (int index, indexes) {
+        const Layer *layer = mMapDocument->map()->layerAt(index);
+        QGraphicsItem *layerItem = mLayerItems.at(index);
+
+        layerItem->setVisible(layer->isVisible());
 
-    qreal multiplier = 1;
-    if (mHighlightCurrentLayer && mMapDocument->currentLayerIndex() < index)
-        multiplier = opacityFactor;
+        qreal multiplier = 1;
+        if (mHighlightCurrentLayer && currentLayerIndex < index)
+            multiplier = opacityFactor;
 
-    layerItem->setOpacity(layer->opacity() * multiplier);
+        layerItem->setOpacity(layer->opacity() * multiplier);
+    }
+
+    updateLayerComposites();
 }
 
 /**
@@ -409,7 +619,16 @@ void MapScene::layerChanged(int index)
 void MapScene::objectGroupChanged(ObjectGroup *objectGroup)
 {
     objectsChanged(objectGroup->objects());
-    objectsIndexChanged(objectGroup, 0, objectGroup->objectCount() - 1);
+
+    // The z values of all objects only need to change with the draw order.
+    // Otherwise they are kept up to date as the objects move.
+    const int index = mMapDocument->map()->layers().indexOf(objectGroup);
+    ObjectGroupItem *ogItem = static_cast<ObjectGroupItem*>(mLayerItems.at(index));
+
+    if (ogItem->drawOrder() != objectGroup->drawOrder()) {
+        ogItem->setDrawOrder(objectGroup->drawOrder());
+        objectsIndexChanged(objectGroup, 0, objectGroup->objectCount() - 1);
+    }
 }
 
 /**
@@ -436,6 +655,8 @@ void MapScene::tilesetTileOffsetChanged(Tileset *tileset)
     foreach (QGraphicsItem *item, mLayerItems)
         if (TileLayerItem *tli = dynamic_cast<TileLayerItem*>(item))
             tli->syncWithTileLayer();
+    foreach (TileLayerCompositeItem *composite, mLayerComposites)
+        composite->syncWithLayerItems();
 
     foreach (MapObjectItem *item, mObjectItems) {
         const Cell &cell = item->mapObject()->cell();
@@ -606,13 +827,35 @@ void MapScene::setHighlightCurrentLayer(bool highlightCurrentLayer)
     updateCurrentLayerHighlight();
 }
 
+void MapScene::setUseChunkItems(bool useChunkItems)
+{
+    if (mUseChunkItems == useChunkItems)
+        return;
+
+    mUseChunkItems = useChunkItems;
+
+    foreach (QGraphicsItem *item, mLayerItems)
+        if (TileLayerItem *tli = dynamic_cast<TileLayerItem*>(item))
+            tli->setUseChunkItems(useChunkItems);
+}
+
+void MapScene::setFlattenLayers(bool flattenLayers)
+{
+    if (mFlattenLayers == flattenLayers)
+        return;
+
+    mFlattenLayers = flattenLayers;
+    if (mMapDocument)
+        updateLayerComposites();
+}
+
 void MapScene::drawForeground(QPainter *painter, const QRectF &rect)
 {
     if (!mMapDocument || !mGridVisible)
         return;
 
     Preferences *prefs = Preferences::instance();
-    mMapDocument->renderer()->drawGrid(painter, rect, prefs->gridColor());
+    mGridCache.draw(painter, mMapDocument->renderer(), rect, prefs->gridColor());
 }
 
 bool MapScene::event(QEvent *event)
@@ -24,10 +24,15 @@
 #ifndef MAPSCENE_H
 #define MAPSCENE_H
 
+#include "gridcache.h"
+
 #include <QColor>
 #include <QGraphicsScene>
 #include <QMap>
+#include <QPainter>
+#include <QRegion>
 #include <QSet>
+#include <QTimer>
 
 namespace Tiled {
 
@@ -35,6 +40,7 @@ class ImageLayer;
 class Layer;
 class MapObject;
 class ObjectGroup;
+class Tile;
 class TileLayer;
 class Tileset;
 
@@ -45,6 +51,7 @@ class MapDocument;
 class MapObjectItem;
 class MapScene;
 class ObjectGroupItem;
+class TileLayerCompositeItem;
 
 /**
  * A graphics scene that represents the contents of a map.
@@ -109,6 +116,14 @@ public:
      */
     void setSelectedTool(AbstractTool *tool);
 
+    /**
+     * Lets the visible tile layers render the chunks within \a rect that
+     * are not cached yet, in the background. Used by the view to prepare
+     * the area it is likely to scroll to.
+     */
+    void prefetch(const QRectF &rect, qreal scale,
+                  QPainter::RenderHints renderHints);
+
 signals:
     void selectedObjectItemsChanged();
 
@@ -140,6 +155,17 @@ private slots:
      */
     void setHighlightCurrentLayer(bool highlightCurrentLayer);
 
+    /**
+     * Sets whether tile layers are displayed by a grid of chunk items.
+     */
+    void setUseChunkItems(bool useChunkItems);
+
+    /**
+     * Sets whether the tile layers other than the current one are flattened
+     * into composites.
+     */
+    void setFlattenLayers(bool flattenLayers);
+
     /**
      * Refreshes the map scene.
      */
@@ -147,18 +173,25 @@ private slots:
 
     /**
      * Repaints the specified region. The region is in tile coordinates.
+     *
+     * The repaint is delayed until the next timer tick, so that the many
+     * small regions changed while drawing are combined.
      */
     void repaintRegion(const QRegion &region);
+    void flushDirtyRegion();
 
     void currentLayerIndexChanged();
 
     void mapChanged();
     void tilesetChanged(Tileset *tileset);
+    void tileAnimationChanged(Tile *tile);
+    void repaintTiles(const QSet<Tile*> &tiles);
     void tileLayerDrawMarginsChanged(TileLayer *tileLayer);
 
     void layerAdded(int index);
     void layerRemoved(int index);
     void layerChanged(int index);
+    void layersChanged(const QList<int> &indexes);
 
     void objectGroupChanged(ObjectGroup *objectGroup);
     void imageLayerChanged(ImageLayer *imageLayer);
@@ -177,6 +210,7 @@ private:
     QGraphicsItem *createLayerItem(Layer *layer);
 
     void updateCurrentLayerHighlight();
+    void updateLayerComposites();
 
     bool eventFilter(QObject *object, QEvent *event);
 
@@ -187,12 +221,18 @@ private:
     qreal mObjectLineWidth;
     bool mShowTileObjectOutlines;
     bool mHighlightCurrentLayer;
+    bool mUseChunkItems;
+    bool mFlattenLayers;
     bool mUnderMouse;
     Qt::KeyboardModifiers mCurrentModifiers;
     QPointF mLastMousePos;
     QVector<QGraphicsItem*> mLayerItems;
+    QList<TileLayerCompositeItem*> mLayerComposites;
     QGraphicsRectItem *mDarkRectangle;
     QColor mDefaultBackgroundColor;
+    QRegion mDirtyRegion;
+    QTimer mRepaintTimer;
+    GridCache mGridCache;
 
     typedef QMap<MapObject*, MapObjectItem*> ObjectItems;
     ObjectItems mObjectItems;
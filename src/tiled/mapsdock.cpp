@@ -22,6 +22,7 @@
 
 #include "mainwindow.h"
 #include "mapreaderinterface.h"
+#include "mapsindexer.h"
 #include "pluginmanager.h"
 #include "preferences.h"
 #include "utils.h"
@@ -119,9 +120,86 @@ void MapsDock::retranslateUi()
 
 ///// ///// ///// ///// /////
 
+MapsModel::MapsModel(QObject *parent)
+    : QFileSystemModel(parent)
+    , mIndexer(new MapsIndexer(this))
+{
+    connect(mIndexer, SIGNAL(mapInfoChanged(QString)),
+            SLOT(mapInfoChanged(QString)));
+}
+
+static QString orientationName(Map::Orientation orientation)
+{
+    switch (orientation) {
+    case Map::Orthogonal:
+        return MapsModel::tr("Orthogonal");
+    case Map::Isometric:
+        return MapsModel::tr("Isometric");
+    case Map::Staggered:
+        return MapsModel::tr("Isometric (Staggered)");
+    case Map::Hexagonal:
+        return MapsModel::tr("Hexagonal (Staggered)");
+    default:
+        return MapsModel::tr("Unknown");
+    }
+}
+
+QVariant MapsModel::data(const QModelIndex &index, int role) const
+{
+    if (index.column() == 0 &&
+            (role == Qt::DecorationRole || role == Qt::ToolTipRole) &&
+            !isDir(index)) {
+        const QFileInfo info = fileInfo(index);
+        const QString fileName = info.filePath();
+
+        // Queues the map for indexing when needed, which is how only the
+        // maps that are on screen get indexed
+        const MapInfo *mapInfo = mIndexer->mapInfo(fileName,
+                                                   info.lastModified());
+
+        if (mapInfo && mapInfo->valid) {
+            if (role == Qt::DecorationRole) {
+                const QPixmap thumbnail = mIndexer->thumbnail(fileName);
+                if (!thumbnail.isNull())
+                    return QIcon(thumbnail);
+            } else {
+                QString toolTip = tr("%1 map, %2 x %3 tiles of %4 x %5 pixels")
+                        .arg(orientationName(mapInfo->orientation))
+                        .arg(mapInfo->width)
+                        .arg(mapInfo->height)
+                        .arg(mapInfo->tileWidth)
+                        .arg(mapInfo->tileHeight);
+
+                toolTip += QLatin1Char('\n');
+                toolTip += tr("%n layer(s)", "", mapInfo->layerCount);
+
+                if (!mapInfo->tilesets.isEmpty()) {
+                    toolTip += QLatin1Char('\n');
+                    toolTip += tr("Tilesets: %1")
+                            .arg(mapInfo->tilesets.join(QLatin1String(", ")));
+                }
+
+                return toolTip;
+            }
+        }
+    }
+
+    return QFileSystemModel::data(index, role);
+}
+
+void MapsModel::mapInfoChanged(const QString &fileName)
+{
+    const QModelIndex index = this->index(fileName);
+    if (index.isValid())
+        emit dataChanged(index, index);
+}
+
+///// ///// ///// ///// /////
+
 MapsView::MapsView(MainWindow *mainWindow, QWidget *parent)
     : QTreeView(parent)
     , mMainWindow(mainWindow)
+    , mFSModel(0)
 {
     setRootIsDecorated(false);
     setHeaderHidden(true);
@@ -129,16 +207,28 @@ MapsView::MapsView(MainWindow *mainWindow, QWidget *parent)
     setUniformRowHeights(true);
     setDragEnabled(true);
     setDefaultDropAction(Qt::MoveAction);
+    setIconSize(QSize(32, 32));
 
     Preferences *prefs = Preferences::instance();
     connect(prefs, SIGNAL(mapsDirectoryChanged()),
             SLOT(onMapsDirectoryChanged()));
 
+    connect(this, SIGNAL(activated(QModelIndex)),
+            SLOT(onActivated(QModelIndex)));
+}
+
+/**
+ * Sets up the file system model. This is delayed until the view is first
+ * shown, since the maps dock is hidden by default.
+ */
+void MapsView::createModel()
+{
+    Preferences *prefs = Preferences::instance();
     QDir mapsDir(prefs->mapsDirectory());
     if (!mapsDir.exists())
         mapsDir.setPath(QDir::currentPath());
 
-    mFSModel = new QFileSystemModel(this);
+    mFSModel = new MapsModel(this);
     mFSModel->setRootPath(mapsDir.absolutePath());
 
     PluginManager *pm = PluginManager::instance();
@@ -174,9 +264,14 @@ MapsView::MapsView(MainWindow *mainWindow, QWidget *parent)
 #else
     header()->setResizeMode(0, QHeaderView::Stretch);
 #endif
+}
 
-    connect(this, SIGNAL(activated(QModelIndex)),
-            SLOT(onActivated(QModelIndex)));
+void MapsView::showEvent(QShowEvent *event)
+{
+    if (!mFSModel)
+        createModel();
+
+    QTreeView::showEvent(event);
 }
 
 QSize MapsView::sizeHint() const
@@ -203,6 +298,9 @@ void MapsView::mousePressEvent(QMouseEvent *event)
 
 void MapsView::onMapsDirectoryChanged()
 {
+    if (!mFSModel)
+        return;
+
     Preferences *prefs = Preferences::instance();
     QDir mapsDir(prefs->mapsDirectory());
     if (!mapsDir.exists())
@@ -22,9 +22,9 @@
 #define MAPSDOCK_H
 
 #include <QDockWidget>
+#include <QFileSystemModel>
 #include <QTreeView>
 
-class QFileSystemModel;
 class QLabel;
 class QLineEdit;
 class QModelIndex;
@@ -34,6 +34,7 @@ namespace Tiled {
 namespace Internal {
 
 class MainWindow;
+class MapsIndexer;
 class MapsView;
 
 class MapsDock : public QDockWidget
@@ -58,6 +59,26 @@ private:
     MapsView *mMapsView;
 };
 
+/**
+ * A file system model that shows a thumbnail and information about the maps
+ * it lists, as provided by the MapsIndexer.
+ */
+class MapsModel : public QFileSystemModel
+{
+    Q_OBJECT
+
+public:
+    MapsModel(QObject *parent = 0);
+
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+
+private slots:
+    void mapInfoChanged(const QString &fileName);
+
+private:
+    MapsIndexer *mIndexer;
+};
+
 /**
  * Shows the list of files and directories.
  */
@@ -77,11 +98,16 @@ public:
 
     QFileSystemModel *model() const { return mFSModel; }
 
+protected:
+    void showEvent(QShowEvent *event);
+
 private slots:
     void onMapsDirectoryChanged();
     void onActivated(const QModelIndex &index);
 
 private:
+    void createModel();
+
     MainWindow *mMainWindow;
     QFileSystemModel *mFSModel;
 };
@@ -0,0 +1,425 @@
+/*
+ * mapsindexer.cpp
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mapsindexer.h"
+
+#include "hexagonalrenderer.h"
+#include "imagelayer.h"
+#include "isometricrenderer.h"
+#include "mapreader.h"
+#include "orthogonalrenderer.h"
+#include "staggeredrenderer.h"
+#include "tilelayer.h"
+#include "tileset.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QPainter>
+#include <QThread>
+#include <QXmlStreamReader>
+
+#if QT_VERSION >= 0x050000
+#include <QStandardPaths>
+#else
+#include <QDesktopServices>
+#endif
+
+using namespace Tiled;
+using namespace Tiled::Internal;
+
+static const int IconSize = 32;
+
+namespace Tiled {
+namespace Internal {
+
+/**
+ * Indexes a single map file on a worker thread.
+ */
+class MapIndexTask : public QThread
+{
+public:
+    MapIndexTask(const QString &fileName,
+                 const QString &cacheDirectory,
+                 QObject *parent)
+        : QThread(parent)
+        , mFileName(fileName)
+        , mCacheDirectory(cacheDirectory)
+    {}
+
+    ~MapIndexTask()
+    {
+        wait();
+    }
+
+    const QString &fileName() const { return mFileName; }
+    const MapInfo &mapInfo() const { return mMapInfo; }
+
+protected:
+    void run();
+
+private:
+    QString cacheFileName() const;
+    bool readCache();
+    void writeCache();
+    void readHeader();
+    void renderThumbnail();
+
+    const QString mFileName;
+    const QString mCacheDirectory;
+    MapInfo mMapInfo;
+};
+
+} // namespace Internal
+} // namespace Tiled
+
+void MapIndexTask::run()
+{
+    mMapInfo.lastModified = QFileInfo(mFileName).lastModified();
+
+    if (readCache())
+        return;
+
+    // Only the TMX format can be read without going through the plugins,
+    // which are not meant to be used from a worker thread
+    if (!mFileName.endsWith(QLatin1String(".tmx"), Qt::CaseInsensitive))
+        return;
+
+    readHeader();
+    if (!mMapInfo.valid)
+        return;
+
+    renderThumbnail();
+    writeCache();
+}
+
+QString MapIndexTask::cacheFileName() const
+{
+    if (mCacheDirectory.isEmpty())
+        return QString();
+
+    const QByteArray hash = QCryptographicHash::hash(mFileName.toUtf8(),
+                                                     QCryptographicHash::Md5);
+
+    return mCacheDirectory + QLatin1Char('/') +
+            QString::fromLatin1(hash.toHex()) + QLatin1String(".png");
+}
+
+/**
+ * Reads the information from the cached thumbnail, when it was written for
+ * the current version of the map file.
+ */
+bool MapIndexTask::readCache()
+{
+    const QString fileName = cacheFileName();
+    if (fileName.isEmpty() || !QFile::exists(fileName))
+        return false;
+
+    QImageReader reader(fileName, "png");
+
+    const uint lastModified = mMapInfo.lastModified.toTime_t();
+    if (reader.text(QLatin1String("Source")) != mFileName ||
+            reader.text(QLatin1String("LastModified")).toUInt() != lastModified)
+        return false;
+
+    const QImage thumbnail = reader.read();
+    if (thumbnail.isNull())
+        return false;
+
+    mMapInfo.valid = true;
+    mMapInfo.orientation = orientationFromString(thumbnail.text(QLatin1String("Orientation")));
+    mMapInfo.width = thumbnail.text(QLatin1String("Width")).toInt();
+    mMapInfo.height = thumbnail.text(QLatin1String("Height")).toInt();
+    mMapInfo.tileWidth = thumbnail.text(QLatin1String("TileWidth")).toInt();
+    mMapInfo.tileHeight = thumbnail.text(QLatin1String("TileHeight")).toInt();
+    mMapInfo.layerCount = thumbnail.text(QLatin1String("Layers")).toInt();
+
+    const QString tilesets = thumbnail.text(QLatin1String("Tilesets"));
+    if (!tilesets.isEmpty())
+        mMapInfo.tilesets = tilesets.split(QLatin1Char('\n'));
+
+    mMapInfo.thumbnail = thumbnail;
+    mMapInfo.thumbnailFileName = fileName;
+    return true;
+}
+
+void MapIndexTask::writeCache()
+{
+    if (mMapInfo.thumbnail.isNull())
+        return;
+
+    const QString fileName = cacheFileName();
+    if (fileName.isEmpty() || !QDir().mkpath(mCacheDirectory))
+        return;
+
+    QImage image = mMapInfo.thumbnail;
+    image.setText(QLatin1String("Source"), mFileName);
+    image.setText(QLatin1String("LastModified"),
+                  QString::number(mMapInfo.lastModified.toTime_t()));
+    image.setText(QLatin1String("Orientation"),
+                  orientationToString(mMapInfo.orientation));
+    image.setText(QLatin1String("Width"), QString::number(mMapInfo.width));
+    image.setText(QLatin1String("Height"), QString::number(mMapInfo.height));
+    image.setText(QLatin1String("TileWidth"), QString::number(mMapInfo.tileWidth));
+    image.setText(QLatin1String("TileHeight"), QString::number(mMapInfo.tileHeight));
+    image.setText(QLatin1String("Layers"), QString::number(mMapInfo.layerCount));
+    image.setText(QLatin1String("Tilesets"),
+                  mMapInfo.tilesets.join(QLatin1String("\n")));
+
+    if (image.save(fileName, "png"))
+        mMapInfo.thumbnailFileName = fileName;
+}
+
+/**
+ * Reads the attributes of the map element and the names of its children,
+ * skipping over their contents.
+ */
+void MapIndexTask::readHeader()
+{
+    QFile file(mFileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+
+    QXmlStreamReader xml(&file);
+    if (!xml.readNextStartElement() || xml.name() != QLatin1String("map"))
+        return;
+
+    const QXmlStreamAttributes atts = xml.attributes();
+    mMapInfo.orientation = orientationFromString(atts.value(QLatin1String("orientation")).toString());
+    mMapInfo.width = atts.value(QLatin1String("width")).toString().toInt();
+    mMapInfo.height = atts.value(QLatin1String("height")).toString().toInt();
+    mMapInfo.tileWidth = atts.value(QLatin1String("tilewidth")).toString().toInt();
+    mMapInfo.tileHeight = atts.value(QLatin1String("tileheight")).toString().toInt();
+
+    while (xml.readNextStartElement()) {
+        if (xml.name() == QLatin1String("tileset")) {
+            const QXmlStreamAttributes tilesetAtts = xml.attributes();
+            QString name = tilesetAtts.value(QLatin1String("name")).toString();
+            if (name.isEmpty()) {
+                const QString source = tilesetAtts.value(QLatin1String("source")).toString();
+                name = QFileInfo(source).completeBaseName();
+            }
+            mMapInfo.tilesets.append(name);
+        } else if (xml.name() == QLatin1String("layer") ||
+                   xml.name() == QLatin1String("objectgroup") ||
+                   xml.name() == QLatin1String("imagelayer")) {
+            ++mMapInfo.layerCount;
+        }
+
+        xml.skipCurrentElement();
+    }
+
+    mMapInfo.valid = !xml.hasError();
+}
+
+/**
+ * Renders the tile and image layers of the map to a small image.
+ *
+ * Pixmaps can't be used outside of the GUI thread, so the images are loaded
+ * as image data only, which is what the renderer draws from on this thread.
+ */
+void MapIndexTask::renderThumbnail()
+{
+    MapReader reader;
+    reader.setDeferredImageLoading(true);
+    Map *map = reader.readMap(mFileName);
+    if (!map)
+        return;
+
+    reader.loadDeferredImages();
+    map->recomputeDrawMargins();
+
+    MapRenderer *renderer;
+    switch (map->orientation()) {
+    case Map::Isometric:
+        renderer = new IsometricRenderer(map);
+        break;
+    case Map::Staggered:
+        renderer = new StaggeredRenderer(map);
+        break;
+    case Map::Hexagonal:
+        renderer = new HexagonalRenderer(map);
+        break;
+    default:
+        renderer = new OrthogonalRenderer(map);
+        break;
+    }
+
+    const QSize mapSize = renderer->mapSize();
+    if (!mapSize.isEmpty()) {
+        const qreal scale = qMin(qreal(1),
+                                 qMin(qreal(MapsIndexer::ThumbnailSize) / mapSize.width(),
+                                      qreal(MapsIndexer::ThumbnailSize) / mapSize.height()));
+        const QSize imageSize = (QSizeF(mapSize) * scale).toSize()
+                .expandedTo(QSize(1, 1));
+
+        renderer->setPainterScale(scale);
+
+        QImage image(imageSize, QImage::Format_ARGB32_Premultiplied);
+        image.fill(Qt::transparent);
+
+        QPainter painter(&image);
+        painter.setRenderHint(QPainter::SmoothPixmapTransform);
+        painter.setTransform(QTransform::fromScale(scale, scale));
+
+        const QRectF exposed(QPointF(), mapSize);
+
+        foreach (const Layer *layer, map->layers()) {
+            if (!layer->isVisible())
+                continue;
+
+            painter.setOpacity(layer->opacity());
+
+            if (const TileLayer *tileLayer = dynamic_cast<const TileLayer*>(layer))
+                renderer->drawTileLayer(&painter, tileLayer, exposed);
+            else if (const ImageLayer *imageLayer = dynamic_cast<const ImageLayer*>(layer))
+                renderer->drawImageLayer(&painter, imageLayer, exposed);
+        }
+
+        painter.end();
+        mMapInfo.thumbnail = image;
+    }
+
+    delete renderer;
+
+    // The tilesets are not owned by the map
+    qDeleteAll(map->tilesets());
+    delete map;
+}
+
+
+MapsIndexer::MapsIndexer(QObject *parent)
+    : QObject(parent)
+{
+#if QT_VERSION >= 0x050000
+    const QString cacheLocation =
+            QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+#else
+    const QString cacheLocation =
+            QDesktopServices::storageLocation(QDesktopServices::CacheLocation);
+#endif
+
+    if (!cacheLocation.isEmpty())
+        mCacheDirectory = cacheLocation + QLatin1String("/mapthumbnails");
+}
+
+MapsIndexer::~MapsIndexer()
+{
+    // Waits for the running tasks
+    qDeleteAll(mTasks);
+}
+
+const MapInfo *MapsIndexer::mapInfo(const QString &fileName,
+                                    const QDateTime &lastModified)
+{
+    QHash<QString, MapInfo>::const_iterator it = mMapInfos.constFind(fileName);
+    const bool found = it != mMapInfos.constEnd();
+
+    if (found && it.value().lastModified >= lastModified)
+        return &it.value();
+
+    if (!mPending.contains(fileName)) {
+        mPending.insert(fileName);
+        mQueue.append(fileName);
+        startTasks();
+    }
+
+    // Outdated information is returned while the file is indexed again
+    return found ? &it.value() : 0;
+}
+
+QPixmap MapsIndexer::thumbnail(const QString &fileName)
+{
+    QHash<QString, QPixmap>::const_iterator it = mThumbnails.constFind(fileName);
+    if (it != mThumbnails.constEnd())
+        return it.value();
+
+    QPixmap pixmap;
+
+    const QImage image = thumbnailImage(fileName);
+    if (!image.isNull()) {
+        pixmap = QPixmap::fromImage(image.scaled(IconSize, IconSize,
+                                                 Qt::KeepAspectRatio,
+                                                 Qt::SmoothTransformation));
+
+        // Only the small version is kept in memory
+        mMapInfos[fileName].thumbnail = QImage();
+    }
+
+    mThumbnails.insert(fileName, pixmap);
+    return pixmap;
+}
+
+QImage MapsIndexer::thumbnailImage(const QString &fileName)
+{
+    QHash<QString, MapInfo>::iterator it = mMapInfos.find(fileName);
+    if (it == mMapInfos.end())
+        return QImage();
+
+    MapInfo &info = it.value();
+    if (!info.thumbnail.isNull()) {
+        const QImage image = info.thumbnail;
+        if (!info.thumbnailFileName.isEmpty())
+            info.thumbnail = QImage();
+        return image;
+    }
+
+    if (info.thumbnailFileName.isEmpty())
+        return QImage();
+
+    return QImage(info.thumbnailFileName, "png");
+}
+
+/**
+ * Starts indexing the queued files, up to one file per core. The most
+ * recently requested files are indexed first, since those are usually the
+ * ones on screen.
+ */
+void MapsIndexer::startTasks()
+{
+    const int maxTasks = qMax(1, QThread::idealThreadCount());
+
+    while (mTasks.size() < maxTasks && !mQueue.isEmpty()) {
+        MapIndexTask *task = new MapIndexTask(mQueue.takeLast(),
+                                              mCacheDirectory,
+                                              this);
+        connect(task, SIGNAL(finished()), SLOT(taskFinished()));
+        mTasks.append(task);
+        task->start(QThread::LowPriority);
+    }
+}
+
+void MapsIndexer::taskFinished()
+{
+    MapIndexTask *task = static_cast<MapIndexTask*>(sender());
+    const QString fileName = task->fileName();
+
+    mTasks.removeOne(task);
+    mPending.remove(fileName);
+    mMapInfos.insert(fileName, task->mapInfo());
+    mThumbnails.remove(fileName);
+    task->deleteLater();
+
+    emit mapInfoChanged(fileName);
+
+    startTasks();
+}
@@ -0,0 +1,131 @@
+/*
+ * mapsindexer.h
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MAPSINDEXER_H
+#define MAPSINDEXER_H
+
+#include "map.h"
+
+#include <QDateTime>
+#include <QHash>
+#include <QImage>
+#include <QList>
+#include <QObject>
+#include <QPixmap>
+#include <QSet>
+#include <QStringList>
+
+namespace Tiled {
+namespace Internal {
+
+class MapIndexTask;
+
+/**
+ * The information gathered about a map file by the MapsIndexer.
+ */
+struct MapInfo
+{
+    MapInfo()
+        : valid(false)
+        , orientation(Map::Unknown)
+        , width(0)
+        , height(0)
+        , tileWidth(0)
+        , tileHeight(0)
+        , layerCount(0)
+    {}
+
+    QDateTime lastModified;
+    bool valid;
+    Map::Orientation orientation;
+    int width;
+    int height;
+    int tileWidth;
+    int tileHeight;
+    int layerCount;
+    QStringList tilesets;
+    QImage thumbnail;
+    QString thumbnailFileName;
+};
+
+/**
+ * Gathers information about map files on worker threads, for showing it in
+ * the maps dock.
+ *
+ * For TMX files, only the map element and the names of its children are
+ * read, which is a lot faster than loading the whole map. With Qt 5, a small
+ * thumbnail of the map is rendered as well. Thumbnails are cached on disk
+ * along with the information, so they only need to be rendered again when
+ * the map file was modified.
+ */
+class MapsIndexer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MapsIndexer(QObject *parent = 0);
+    ~MapsIndexer();
+
+    /**
+     * Returns the information about the given map file, or 0 when it is not
+     * known yet. In that case, or when the information is older than
+     * \a lastModified, the file is queued for indexing and mapInfoChanged()
+     * is emitted once it is done.
+     */
+    const MapInfo *mapInfo(const QString &fileName,
+                           const QDateTime &lastModified);
+
+    /**
+     * Returns the thumbnail of the given map file as a pixmap, or a null
+     * pixmap when there is none.
+     */
+    QPixmap thumbnail(const QString &fileName);
+
+    /**
+     * Returns the thumbnail of the given map file at its full size of up to
+     * ThumbnailSize pixels, or a null image when there is none. Thumbnails
+     * that were written to the disk cache are not kept in memory, but read
+     * back from there when requested again.
+     */
+    QImage thumbnailImage(const QString &fileName);
+
+    static const int ThumbnailSize = 128;
+
+signals:
+    void mapInfoChanged(const QString &fileName);
+
+private slots:
+    void taskFinished();
+
+private:
+    void startTasks();
+
+    QString mCacheDirectory;
+    QHash<QString, MapInfo> mMapInfos;
+    QHash<QString, QPixmap> mThumbnails;
+    QStringList mQueue;
+    QSet<QString> mPending;
+    QList<MapIndexTask*> mTasks;
+};
+
+} // namespace Internal
+} // namespace Tiled
+
+#endif // MAPSINDEXER_H
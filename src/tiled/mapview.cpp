@@ -28,7 +28,11 @@
 #include <QCursor>
 #include <QGesture>
 #include <QGestureEvent>
+#include <QPainter>
+#include <QPaintEvent>
 #include <QPinchGesture>
+#include <QStringList>
+#include <QTimer>
 #include <QWheelEvent>
 #include <QScrollBar>
 
@@ -38,11 +42,33 @@
 
 using namespace Tiled::Internal;
 
+namespace {
+
+// The time after the last scroll or zoom at which chunks are prefetched, in
+// milliseconds
+const int PrefetchDelay = 30;
+
+// How far ahead the scroll velocity is extrapolated, in milliseconds
+const int PrefetchLookAhead = 300;
+
+// Scrolls further apart than this, in milliseconds, don't add up to a
+// velocity
+const int MaxScrollInterval = 200;
+
+// The time after the last zoom step at which the snapshot used while
+// zooming is replaced by a full render, in milliseconds
+const int ZoomSettleDelay = 200;
+
+} // anonymous namespace
+
 MapView::MapView(QWidget *parent, Mode mode)
     : QGraphicsView(parent)
     , mHandScrolling(false)
     , mMode(mode)
     , mZoomable(new Zoomable(this))
+    , mSnapshotZoom(false)
+    , mCollectingFrame(false)
+    , mExposedArea(0)
 {
     setTransformationAnchor(QGraphicsView::AnchorViewCenter);
 #ifdef Q_OS_MAC
@@ -75,6 +101,19 @@ MapView::MapView(QWidget *parent, Mode mode)
     setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOn);
 
     connect(mZoomable, SIGNAL(scaleChanged(qreal)), SLOT(adjustScale(qreal)));
+
+    mPrefetchTimer.setSingleShot(true);
+    mPrefetchTimer.setInterval(PrefetchDelay);
+    connect(&mPrefetchTimer, SIGNAL(timeout()), SLOT(prefetch()));
+
+    Preferences *preferences = Preferences::instance();
+    setSnapshotZoom(preferences->snapshotZoom());
+    connect(preferences, SIGNAL(snapshotZoomChanged(bool)),
+            SLOT(setSnapshotZoom(bool)));
+
+    mZoomSettleTimer.setSingleShot(true);
+    mZoomSettleTimer.setInterval(ZoomSettleDelay);
+    connect(&mZoomSettleTimer, SIGNAL(timeout()), SLOT(zoomSettled()));
 }
 
 MapView::~MapView()
@@ -89,9 +128,19 @@ MapScene *MapView::mapScene() const
 
 void MapView::adjustScale(qreal scale)
 {
+    if (mSnapshotZoom && isVisible()) {
+        if (mZoomSnapshot.isNull())
+            takeZoomSnapshot();
+        mZoomSettleTimer.start();
+    }
+
     setTransform(QTransform::fromScale(scale, scale));
     setRenderHint(QPainter::SmoothPixmapTransform,
                   mZoomable->smoothTransform());
+
+    // The chunks are rendered again at the new scale
+    mScrollVelocity = QPointF();
+    mPrefetchTimer.start();
 }
 
 void MapView::setUseOpenGL(bool useOpenGL)
@@ -118,6 +167,53 @@ void MapView::setUseOpenGL(bool useOpenGL)
 #endif
 }
 
+void MapView::setSnapshotZoom(bool snapshotZoom)
+{
+    mSnapshotZoom = snapshotZoom;
+    if (!snapshotZoom)
+        dropZoomSnapshot();
+}
+
+/**
+ * Grabs the current contents of the viewport, to be scaled while zooming.
+ * Not done for OpenGL viewports, which are fast to repaint at any scale and
+ * can't be grabbed the same way.
+ */
+void MapView::takeZoomSnapshot()
+{
+#ifndef QT_NO_OPENGL
+    if (qobject_cast<QGLWidget*>(viewport()))
+        return;
+#endif
+
+    QWidget *v = viewport();
+    mZoomSnapshotRect = mapToScene(v->rect()).boundingRect();
+#if QT_VERSION >= 0x050000
+    mZoomSnapshot = v->grab();
+#else
+    mZoomSnapshot = QPixmap::grabWidget(v);
+#endif
+}
+
+void MapView::dropZoomSnapshot()
+{
+    mZoomSettleTimer.stop();
+
+    if (!mZoomSnapshot.isNull()) {
+        mZoomSnapshot = QPixmap();
+        viewport()->update();
+    }
+}
+
+/**
+ * Renders the map at full quality once the zoom level stopped changing.
+ */
+void MapView::zoomSettled()
+{
+    dropZoomSnapshot();
+    mPrefetchTimer.start();
+}
+
 void MapView::setHandScrolling(bool handScrolling)
 {
     if (mHandScrolling == handScrolling)
@@ -160,12 +256,160 @@ void MapView::hideEvent(QHideEvent *event)
 {
     // Disable hand scrolling when the view gets hidden in any way
     setHandScrolling(false);
+    dropZoomSnapshot();
     QGraphicsView::hideEvent(event);
 }
 
 /**
  * Override to support zooming in and out using the mouse wheel.
  */
+namespace {
+
+// Frames that take longer than this are logged, in nanoseconds
+const qint64 SlowFrameTime = 20 * 1000000;
+
+// The number of layers listed in the statistics overlay
+const int OverlayLayerCount = 5;
+
+// The area of the viewport covered by the statistics overlay
+const QRect OverlayRect(4, 4, 320, (3 + OverlayLayerCount) * 16 + 8);
+
+} // anonymous namespace
+
+void MapView::paintEvent(QPaintEvent *event)
+{
+    if (!mZoomSnapshot.isNull()) {
+        QWidget *v = viewport();
+        QPainter painter(v);
+        painter.fillRect(event->rect(), v->palette().brush(v->backgroundRole()));
+        painter.setRenderHint(QPainter::SmoothPixmapTransform);
+
+        const QRectF target = mapFromScene(mZoomSnapshotRect).boundingRect();
+        painter.drawPixmap(target, mZoomSnapshot, QRectF(mZoomSnapshot.rect()));
+        return;
+    }
+
+    if (!PaintStatistics::isEnabled()) {
+        QGraphicsView::paintEvent(event);
+        return;
+    }
+
+    // Repaints of only the overlay are not counted as frames
+    const QRegion region = event->region();
+    mCollectingFrame = !OverlayRect.contains(region.boundingRect());
+
+    if (mCollectingFrame) {
+        mExposedArea = 0;
+        foreach (const QRect &rect, region.rects())
+            mExposedArea += qint64(rect.width()) * rect.height();
+
+        PaintStatistics::beginFrame();
+        mFrameTimer.start();
+    }
+
+    QGraphicsView::paintEvent(event);
+}
+
+void MapView::scrollContentsBy(int dx, int dy)
+{
+    QGraphicsView::scrollContentsBy(dx, dy);
+
+    // The contents move opposite to the direction the view is scrolling
+    const QPointF delta(-dx, -dy);
+    const qint64 elapsed = mScrollTimer.isValid() ? mScrollTimer.restart() : 0;
+    if (!mScrollTimer.isValid())
+        mScrollTimer.start();
+
+    if (elapsed <= 0 || elapsed > MaxScrollInterval)
+        mScrollVelocity = QPointF();
+    else
+        mScrollVelocity = (mScrollVelocity + delta / elapsed) / 2;
+
+    mPrefetchTimer.start();
+}
+
+/**
+ * Lets the scene render the chunks around the visible area, extended in the
+ * direction the view is scrolling, while the view is idle.
+ */
+void MapView::prefetch()
+{
+    MapScene *scene = mapScene();
+    if (!scene)
+        return;
+
+    const qreal scale = transform().m11();
+    const QRectF visible = mapToScene(viewport()->rect()).boundingRect();
+    const QPointF ahead = mScrollVelocity * PrefetchLookAhead / scale;
+
+    const qreal marginX = visible.width() / 4;
+    const qreal marginY = visible.height() / 4;
+    const QRectF area = (visible | visible.translated(ahead))
+            .adjusted(-marginX, -marginY, marginX, marginY);
+
+    scene->prefetch(area, scale, renderHints());
+}
+
+void MapView::drawForeground(QPainter *painter, const QRectF &rect)
+{
+    QGraphicsView::drawForeground(painter, rect);
+
+    if (!PaintStatistics::isEnabled())
+        return;
+
+    if (mCollectingFrame) {
+        mCollectingFrame = false;
+        mLastFrame = PaintStatistics::endFrame(mFrameTimer.nsecsElapsed(),
+                                               mExposedArea);
+
+        if (mLastFrame.paintTime > SlowFrameTime)
+            PaintStatistics::log(mLastFrame);
+
+        // The overlay may not have been part of the repainted area
+        QTimer::singleShot(0, this, SLOT(updateStatisticsOverlay()));
+    }
+
+    drawStatisticsOverlay(painter);
+}
+
+void MapView::updateStatisticsOverlay()
+{
+    viewport()->update(OverlayRect);
+}
+
+void MapView::drawStatisticsOverlay(QPainter *painter)
+{
+    QStringList lines;
+    lines.append(QString(QLatin1String("%1 ms, %2 items painted"))
+                 .arg(mLastFrame.paintTime / 1000000.0, 0, 'f', 2)
+                 .arg(mLastFrame.itemsPainted));
+    lines.append(QString(QLatin1String("%1 draw calls, %2 cells"))
+                 .arg(mLastFrame.drawCalls)
+                 .arg(mLastFrame.fragments));
+    lines.append(QString(QLatin1String("%1 pixels exposed"))
+                 .arg(mLastFrame.exposedArea));
+
+    const int layerCount = qMin(OverlayLayerCount, mLastFrame.layers.size());
+    for (int i = 0; i < layerCount; ++i) {
+        const PaintStatistics::LayerStatistics &layer = mLastFrame.layers.at(i);
+        lines.append(QString(QLatin1String("  %1: %2 ms, %3 items"))
+                     .arg(layer.name)
+                     .arg(layer.paintTime / 1000000.0, 0, 'f', 2)
+                     .arg(layer.itemsPainted));
+    }
+
+    painter->save();
+    painter->resetTransform();
+    painter->setOpacity(1);
+    painter->setClipRect(OverlayRect);
+    painter->fillRect(OverlayRect, QColor(0, 0, 0, 160));
+    painter->setPen(Qt::white);
+    painter->drawText(OverlayRect.adjusted(4, 4, -4, -4),
+                      Qt::AlignLeft | Qt::AlignTop,
+                      lines.join(QLatin1String("\n")));
+    painter->restore();
+}
+
 void MapView::wheelEvent(QWheelEvent *event)
 {
     if (event->modifiers() & Qt::ControlModifier
@@ -21,8 +21,13 @@
 #ifndef MAPVIEW_H
 #define MAPVIEW_H
 
+#include "paintstatistics.h"
+
+#include <QElapsedTimer>
 #include <QGraphicsView>
 #include <QPinchGesture>
+#include <QPixmap>
+#include <QTimer>
 
 namespace Tiled {
 namespace Internal {
@@ -70,6 +75,10 @@ protected:
 
     void hideEvent(QHideEvent *);
 
+    void paintEvent(QPaintEvent *event);
+    void scrollContentsBy(int dx, int dy);
+    void drawForeground(QPainter *painter, const QRectF &rect);
+
     void wheelEvent(QWheelEvent *event);
 
     void mousePressEvent(QMouseEvent *event);
@@ -83,13 +92,40 @@ protected:
 private slots:
     void adjustScale(qreal scale);
     void setUseOpenGL(bool useOpenGL);
+    void setSnapshotZoom(bool snapshotZoom);
+    void zoomSettled();
+    void updateStatisticsOverlay();
+    void prefetch();
 
 private:
+    void drawStatisticsOverlay(QPainter *painter);
+    void takeZoomSnapshot();
+    void dropZoomSnapshot();
+
     QPoint mLastMousePos;
     QPointF mLastMouseScenePos;
     bool mHandScrolling;
     Mode mMode;
     Zoomable *mZoomable;
+
+    // The scroll velocity in viewport pixels per millisecond, used to
+    // predict which part of the map needs to be rendered next
+    QPointF mScrollVelocity;
+    QElapsedTimer mScrollTimer;
+    QTimer mPrefetchTimer;
+
+    // While zooming, the view is drawn by scaling a snapshot of the scene
+    // area that was visible when the zoom started
+    bool mSnapshotZoom;
+    QPixmap mZoomSnapshot;
+    QRectF mZoomSnapshotRect;
+    QTimer mZoomSettleTimer;
+
+    // Paint statistics, only used when enabled
+    QElapsedTimer mFrameTimer;
+    bool mCollectingFrame;
+    qint64 mExposedArea;
+    PaintStatistics::Frame mLastFrame;
 };
 
 } // namespace Internal
@@ -22,7 +22,9 @@
 #include "minimap.h"
 
 #include "documentmanager.h"
+#include "hexagonalrenderer.h"
 #include "imagelayer.h"
+#include "isometricrenderer.h"
 #include "map.h"
 #include "mapdocument.h"
 #include "mapobject.h"
@@ -30,14 +32,19 @@
 #include "maprenderer.h"
 #include "mapview.h"
 #include "objectgroup.h"
+#include "orthogonalrenderer.h"
 #include "preferences.h"
+#include "staggeredrenderer.h"
 #include "tilelayer.h"
+#include "tilesetmanager.h"
+#include "trace.h"
 #include "zoomable.h"
 
 #include <QCursor>
 #include <QPainter>
 #include <QResizeEvent>
 #include <QScrollBar>
+#include <QThread>
 #include <QUndoStack>
 
 using namespace Tiled;
@@ -49,6 +56,10 @@ MiniMap::MiniMap(QWidget *parent)
     , mDragging(false)
     , mMouseMoveCursorState(false)
     , mRedrawMapImage(false)
+    , mFullRedraw(true)
+    , mMapImageScale(0)
+    , mRenderThread(0)
+    , mRenderAgain(false)
     , mRenderFlags(DrawTiles | DrawObjects | DrawImages | IgnoreInvisibleLayer)
 {
     setFrameStyle(QFrame::StyledPanel | QFrame::Sunken);
@@ -62,6 +73,11 @@ MiniMap::MiniMap(QWidget *parent)
             SLOT(redrawTimeout()));
 }
 
+MiniMap::~MiniMap()
+{
+    delete mRenderThread;
+}
+
 void MiniMap::setMapDocument(MapDocument *map)
 {
     const DocumentManager *dm = DocumentManager::instance();
@@ -80,6 +96,38 @@ void MiniMap::setMapDocument(MapDocument *map)
 
     if (mMapDocument) {
         connect(mMapDocument->undoStack(), SIGNAL(indexChanged(int)),
+                this, SLOT(undoIndexChanged()));
+        connect(mMapDocument, SIGNAL(regionChanged(QRegion)),
+                this, SLOT(regionChanged(QRegion)));
+
+        // Changes that affect more than a region of tiles
+        connect(mMapDocument, SIGNAL(mapChanged()),
+                this, SLOT(scheduleMapImageUpdate()));
+        connect(mMapDocument, SIGNAL(layerAdded(int)),
+                this, SLOT(scheduleMapImageUpdate()));
+        connect(mMapDocument, SIGNAL(layerRemoved(int)),
+                this, SLOT(scheduleMapImageUpdate()));
+        connect(mMapDocument, SIGNAL(layerChanged(int)),
+                this, SLOT(scheduleMapImageUpdate()));
+        connect(mMapDocument, SIGNAL(layersChanged(QList<int>)),
+                this, SLOT(scheduleMapImageUpdate()));
+        connect(mMapDocument, SIGNAL(objectGroupChanged(ObjectGroup*)),
+                this, SLOT(scheduleMapImageUpdate()));
+        connect(mMapDocument, SIGNAL(imageLayerChanged(ImageLayer*)),
+                this, SLOT(scheduleMapImageUpdate()));
+        connect(mMapDocument, SIGNAL(tilesetChanged(Tileset*)),
+                this, SLOT(scheduleMapImageUpdate()));
+        connect(mMapDocument, SIGNAL(tilesetTileOffsetChanged(Tileset*)),
+                this, SLOT(scheduleMapImageUpdate()));
+        connect(mMapDocument, SIGNAL(tilesetRemoved(Tileset*)),
+                this, SLOT(scheduleMapImageUpdate()));
+        connect(mMapDocument, SIGNAL(objectsInserted(ObjectGroup*,int,int)),
+                this, SLOT(scheduleMapImageUpdate()));
+        connect(mMapDocument, SIGNAL(objectsRemoved(QList<MapObject*>)),
+                this, SLOT(scheduleMapImageUpdate()));
+        connect(mMapDocument, SIGNAL(objectsChanged(QList<MapObject*>)),
+                this, SLOT(scheduleMapImageUpdate()));
+        connect(mMapDocument, SIGNAL(objectsIndexChanged(ObjectGroup*,int,int)),
                 this, SLOT(scheduleMapImageUpdate()));
 
         if (MapView *mapView = dm->viewForDocument(mMapDocument)) {
@@ -99,6 +147,7 @@ QSize MiniMap::sizeHint() const
 
 void MiniMap::scheduleMapImageUpdate()
 {
+    mFullRedraw = true;
     mMapImageUpdateTimer.start(100);
 }
 
@@ -107,7 +156,7 @@ void MiniMap::paintEvent(QPaintEvent *pe)
     QFrame::paintEvent(pe);
 
     if (mRedrawMapImage) {
-        renderMapToImage();
+        updateMapImage();
         mRedrawMapImage = false;
     }
 
@@ -169,65 +218,37 @@ static bool objectLessThan(const MapObject *a, const MapObject *b)
     return a->y() < b->y();
 }
 
-void MiniMap::renderMapToImage()
+/**
+ * Draws the part of the \a map within \a exposed. The colors of the objects
+ * are looked up in \a objectColors, or determined on the spot when it is
+ * empty.
+ */
+static void drawMap(QPainter *painter,
+                    MapRenderer *renderer,
+                    const Map *map,
+                    MiniMap::MiniMapRenderFlags flags,
+                    const QColor &gridColor,
+                    const QHash<const MapObject*, QColor> &objectColors,
+                    const QRectF &exposed)
 {
-    if (!mMapDocument) {
-        mMapImage = QImage();
-        return;
-    }
-
-    MapRenderer *renderer = mMapDocument->renderer();
-    const QRect r = contentsRect();
-    const QSize mapSize = renderer->mapSize();
-
-    if (mapSize.isEmpty()) {
-        mMapImage = QImage();
-        return;
-    }
-
-    // Determine the largest possible scale
-    qreal scale = qMin((qreal) r.width() / mapSize.width(),
-                       (qreal) r.height() / mapSize.height());
+    bool drawObjects = flags.testFlag(MiniMap::DrawObjects);
+    bool drawTiles = flags.testFlag(MiniMap::DrawTiles);
+    bool drawImages = flags.testFlag(MiniMap::DrawImages);
+    bool drawTileGrid = flags.testFlag(MiniMap::DrawGrid);
+    bool visibleLayersOnly = flags.testFlag(MiniMap::IgnoreInvisibleLayer);
 
-    // Allocate a new image when the size changed
-    const QSize imageSize = mapSize * scale;
-    if (mMapImage.size() != imageSize) {
-        mMapImage = QImage(imageSize, QImage::Format_ARGB32_Premultiplied);
-        updateImageRect();
-    }
-
-    if (imageSize.isEmpty())
-        return;
-
-    bool drawObjects = mRenderFlags.testFlag(DrawObjects);
-    bool drawTiles = mRenderFlags.testFlag(DrawTiles);
-    bool drawImages = mRenderFlags.testFlag(DrawImages);
-    bool drawTileGrid = mRenderFlags.testFlag(DrawGrid);
-    bool visibleLayersOnly = mRenderFlags.testFlag(IgnoreInvisibleLayer);
-
-    // Remember the current render flags
-    const Tiled::RenderFlags renderFlags = renderer->flags();
-    renderer->setFlag(ShowTileObjectOutlines, false);
-
-    mMapImage.fill(Qt::transparent);
-    QPainter painter(&mMapImage);
-    painter.setRenderHints(QPainter::SmoothPixmapTransform |
-                           QPainter::HighQualityAntialiasing);
-    painter.setTransform(QTransform::fromScale(scale, scale));
-    renderer->setPainterScale(scale);
-
-    foreach (const Layer *layer, mMapDocument->map()->layers()) {
+    foreach (const Layer *layer, map->layers()) {
         if (visibleLayersOnly && !layer->isVisible())
             continue;
 
-        painter.setOpacity(layer->opacity());
+        painter->setOpacity(layer->opacity());
 
         const TileLayer *tileLayer = dynamic_cast<const TileLayer*>(layer);
         const ObjectGroup *objGroup = dynamic_cast<const ObjectGroup*>(layer);
         const ImageLayer *imageLayer = dynamic_cast<const ImageLayer*>(layer);
 
         if (tileLayer && drawTiles) {
-            renderer->drawTileLayer(&painter, tileLayer);
+            renderer->drawTileLayer(painter, tileLayer, exposed);
         } else if (objGroup && drawObjects) {
             QList<MapObject*> objects = objGroup->objects();
 
@@ -238,31 +259,302 @@ void MiniMap::renderMapToImage()
                 if (object->isVisible()) {
                     if (object->rotation() != qreal(0)) {
                         QPointF origin = renderer->pixelToScreenCoords(object->position());
-                        painter.save();
-                        painter.translate(origin);
-                        painter.rotate(object->rotation());
-                        painter.translate(-origin);
+                        painter->save();
+                        painter->translate(origin);
+                        painter->rotate(object->rotation());
+                        painter->translate(-origin);
                     }
 
-                    const QColor color = MapObjectItem::objectColor(object);
-                    renderer->drawMapObject(&painter, object, color);
+                    const QColor color = objectColors.isEmpty()
+                            ? MapObjectItem::objectColor(object)
+                            : objectColors.value(object);
+                    renderer->drawMapObject(painter, object, color);
 
                     if (object->rotation() != qreal(0))
-                        painter.restore();
+                        painter->restore();
                 }
             }
         } else if (imageLayer && drawImages) {
-            renderer->drawImageLayer(&painter, imageLayer);
+            renderer->drawImageLayer(painter, imageLayer, exposed);
         }
     }
 
-    if (drawTileGrid) {
-        Preferences *prefs = Preferences::instance();
-        renderer->drawGrid(&painter, QRectF(QPointF(), renderer->mapSize()),
-                           prefs->gridColor());
+    if (drawTileGrid)
+        renderer->drawGrid(painter, exposed, gridColor);
+}
+
+namespace Tiled {
+namespace Internal {
+
+/**
+ * Renders a copy of a map to an image, so that it can be done on a worker
+ * thread while the map is being edited.
+ */
+class MiniMapRenderThread : public QThread
+{
+public:
+    MiniMapRenderThread(MapDocument *mapDocument,
+                        const QSize &imageSize,
+                        qreal scale,
+                        MiniMap::MiniMapRenderFlags flags,
+                        QObject *parent)
+        : QThread(parent)
+        , mMapDocument(mapDocument)
+        , mMap(new Map(*mapDocument->map()))
+        , mImageSize(imageSize)
+        , mScale(scale)
+        , mFlags(flags)
+        , mGridColor(Preferences::instance()->gridColor())
+    {
+        // Keep the tilesets alive while the copy is being rendered
+        TilesetManager::instance()->addReferences(mMap->tilesets());
+
+        foreach (Layer *layer, mMap->layers())
+            if (ObjectGroup *objectGroup = layer->asObjectGroup())
+                foreach (const MapObject *object, objectGroup->objects())
+                    mObjectColors.insert(object,
+                                         MapObjectItem::objectColor(object));
+    }
+
+    ~MiniMapRenderThread()
+    {
+        wait();
+        TilesetManager::instance()->removeReferences(mMap->tilesets());
+        delete mMap;
+    }
+
+    MapDocument *mapDocument() const { return mMapDocument; }
+    qreal scale() const { return mScale; }
+    const QImage &image() const { return mImage; }
+
+    void render()
+    {
+        TILED_TRACE_SCOPE("MiniMap::renderMapToImage");
+
+        MapRenderer *renderer;
+        switch (mMap->orientation()) {
+        case Map::Isometric:
+            renderer = new IsometricRenderer(mMap);
+            break;
+        case Map::Staggered:
+            renderer = new StaggeredRenderer(mMap);
+            break;
+        case Map::Hexagonal:
+            renderer = new HexagonalRenderer(mMap);
+            break;
+        default:
+            renderer = new OrthogonalRenderer(mMap);
+            break;
+        }
+        renderer->setFlag(ShowTileObjectOutlines, false);
+        renderer->setPainterScale(mScale);
+
+        mImage = QImage(mImageSize, QImage::Format_ARGB32_Premultiplied);
+        mImage.fill(Qt::transparent);
+
+        QPainter painter(&mImage);
+        painter.setRenderHints(QPainter::SmoothPixmapTransform |
+                               QPainter::HighQualityAntialiasing);
+        painter.setTransform(QTransform::fromScale(mScale, mScale));
+
+        drawMap(&painter, renderer, mMap, mFlags, mGridColor, mObjectColors,
+                QRectF(QPointF(), renderer->mapSize()));
+
+        painter.end();
+        delete renderer;
+    }
+
+protected:
+    void run() { render(); }
+
+private:
+    MapDocument *mMapDocument;
+    Map *mMap;
+    const QSize mImageSize;
+    const qreal mScale;
+    const MiniMap::MiniMapRenderFlags mFlags;
+    const QColor mGridColor;
+    QHash<const MapObject*, QColor> mObjectColors;
+    QImage mImage;
+};
+
+} // namespace Internal
+} // namespace Tiled
+
+/**
+ * Returns the size of the minimap image and the \a scale at which the map
+ * is drawn to it.
+ */
+QSize MiniMap::mapImageSize(qreal *scale) const
+{
+    const QSize mapSize = mMapDocument->renderer()->mapSize();
+    if (mapSize.isEmpty()) {
+        *scale = 0;
+        return QSize();
+    }
+
+    // Determine the largest possible scale
+    const QRect r = contentsRect();
+    *scale = qMin((qreal) r.width() / mapSize.width(),
+                  (qreal) r.height() / mapSize.height());
+
+    return mapSize * *scale;
+}
+
+void MiniMap::updateMapImage()
+{
+    if (!mMapDocument) {
+        mMapImage = QImage();
+        mDirtyRegion = QRegion();
+        mFullRedraw = false;
+        return;
+    }
+
+    qreal scale;
+    const QSize imageSize = mapImageSize(&scale);
+
+    if (mFullRedraw || mMapImage.size() != imageSize) {
+        renderMapToImage();
+        mFullRedraw = false;
+        mDirtyRegion = QRegion();
+    } else if (!mDirtyRegion.isEmpty()) {
+        // A full rendering in progress doesn't include these changes yet
+        if (mRenderThread)
+            mRegionSinceRender += mDirtyRegion;
+
+        renderRegionToImage(mDirtyRegion);
+        mDirtyRegion = QRegion();
+    }
+}
+
+/**
+ * Renders the whole map to the minimap image. When possible, this is done
+ * on a worker thread and the image is replaced once it is done.
+ */
+void MiniMap::renderMapToImage()
+{
+    if (mRenderThread) {
+        mRenderAgain = true;
+        return;
+    }
+
+    qreal scale;
+    const QSize imageSize = mapImageSize(&scale);
+
+    if (imageSize.isEmpty()) {
+        mMapImage = QImage();
+        updateImageRect();
+        return;
     }
 
+    MiniMapRenderThread *thread =
+            new MiniMapRenderThread(mMapDocument, imageSize, scale,
+                                    mRenderFlags, this);
+
+#if QT_VERSION >= 0x050000
+    // The thread draws from the image data of the tilesets and image layers,
+    // since pixmaps can't be used outside of the GUI thread
+    mRenderThread = thread;
+    mRegionSinceRender = QRegion();
+    connect(thread, SIGNAL(finished()), SLOT(renderThreadFinished()));
+    thread->start();
+#else
+    thread->render();
+    mMapImage = thread->image();
+    mMapImageScale = thread->scale();
+    updateImageRect();
+    delete thread;
+#endif
+}
+
+void MiniMap::renderThreadFinished()
+{
+    MiniMapRenderThread *thread = mRenderThread;
+    mRenderThread = 0;
+
+    if (thread->mapDocument() == mMapDocument) {
+        mMapImage = thread->image();
+        mMapImageScale = thread->scale();
+        updateImageRect();
+
+        // Bring the new image up to date with the edits made meanwhile
+        if (!mRenderAgain && !mRegionSinceRender.isEmpty())
+            renderRegionToImage(mRegionSinceRender);
+
+        update();
+    }
+
+    mRegionSinceRender = QRegion();
+    thread->deleteLater();
+
+    if (mRenderAgain) {
+        mRenderAgain = false;
+        if (mMapDocument)
+            renderMapToImage();
+    }
+}
+
+/**
+ * Renders the given \a region, in tile coordinates, to the minimap image.
+ */
+void MiniMap::renderRegionToImage(const QRegion &region)
+{
+    if (mMapImage.isNull())
+        return;
+
+    MapRenderer *renderer = mMapDocument->renderer();
+    const QMargins margins = mMapDocument->map()->drawMargins();
+
+    QRegion pixelRegion;
+    foreach (const QRect &r, region.rects()) {
+        const QRectF bounds = renderer->boundingRect(r).adjusted(-margins.left(),
+                                                                 -margins.top(),
+                                                                 margins.right(),
+                                                                 margins.bottom());
+        pixelRegion += bounds.toAlignedRect();
+    }
+
+    const QRectF exposed = pixelRegion.boundingRect();
+
+    // Remember the current render settings
+    const Tiled::RenderFlags renderFlags = renderer->flags();
+    const qreal painterScale = renderer->painterScale();
+    renderer->setFlag(ShowTileObjectOutlines, false);
+    renderer->setPainterScale(mMapImageScale);
+
+    QPainter painter(&mMapImage);
+    painter.setRenderHints(QPainter::SmoothPixmapTransform |
+                           QPainter::HighQualityAntialiasing);
+    painter.setTransform(QTransform::fromScale(mMapImageScale,
+                                               mMapImageScale));
+    painter.setClipRegion(pixelRegion);
+
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    painter.fillRect(exposed, Qt::transparent);
+    painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+
+    drawMap(&painter, renderer, mMapDocument->map(), mRenderFlags,
+            Preferences::instance()->gridColor(),
+            QHash<const MapObject*, QColor>(), exposed);
+
     renderer->setFlags(renderFlags);
+    renderer->setPainterScale(painterScale);
+}
+
+void MiniMap::regionChanged(const QRegion &region)
+{
+    mDirtyRegion += region;
+    mMapImageUpdateTimer.start(100);
+}
+
+void MiniMap::undoIndexChanged()
+{
+    // Changes limited to a region of tiles were already reported through
+    // regionChanged(), other changes require a full redraw
+    if (mDirtyRegion.isEmpty())
+        mFullRedraw = true;
+
+    mMapImageUpdateTimer.start(100);
 }
 
 void MiniMap::centerViewOnLocalPixel(QPoint centerPos, int delta)
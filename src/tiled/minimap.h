@@ -24,12 +24,14 @@
 
 #include <QFrame>
 #include <QImage>
+#include <QRegion>
 #include <QTimer>
 
 namespace Tiled {
 namespace Internal {
 
 class MapDocument;
+class MiniMapRenderThread;
 
 class MiniMap : public QFrame
 {
@@ -46,6 +48,7 @@ public:
     Q_DECLARE_FLAGS(MiniMapRenderFlags, MiniMapRenderFlag)
 
     MiniMap(QWidget *parent);
+    ~MiniMap();
 
     void setMapDocument(MapDocument *);
 
@@ -68,6 +71,9 @@ protected:
 
 private slots:
     void redrawTimeout();
+    void regionChanged(const QRegion &region);
+    void undoIndexChanged();
+    void renderThreadFinished();
 
 private:
     MapDocument *mMapDocument;
@@ -78,12 +84,21 @@ private:
     QPoint mDragOffset;
     bool mMouseMoveCursorState;
     bool mRedrawMapImage;
+    bool mFullRedraw;
+    QRegion mDirtyRegion;
+    qreal mMapImageScale;
+    MiniMapRenderThread *mRenderThread;
+    QRegion mRegionSinceRender;
+    bool mRenderAgain;
     MiniMapRenderFlags mRenderFlags;
 
     QRect viewportRect() const;
     QPointF mapToScene(QPoint p) const;
     void updateImageRect();
+    QSize mapImageSize(qreal *scale) const;
+    void updateMapImage();
     void renderMapToImage();
+    void renderRegionToImage(const QRegion &region);
     void centerViewOnLocalPixel(QPoint centerPos, int delta = 0);
 };
 
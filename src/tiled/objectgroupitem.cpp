@@ -28,7 +28,8 @@ using namespace Tiled;
 using namespace Tiled::Internal;
 
 ObjectGroupItem::ObjectGroupItem(ObjectGroup *objectGroup):
-    mObjectGroup(objectGroup)
+    mObjectGroup(objectGroup),
+    mDrawOrder(objectGroup->drawOrder())
 {
     // Since we don't do any painting, we can spare us the call to paint()
     setFlag(QGraphicsItem::ItemHasNoContents);
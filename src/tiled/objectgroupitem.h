@@ -21,12 +21,11 @@
 #ifndef OBJECTGROUPITEM_H
 #define OBJECTGROUPITEM_H
 
+#include "objectgroup.h"
+
 #include <QGraphicsItem>
 
 namespace Tiled {
-
-class ObjectGroup;
-
 namespace Internal {
 
 /**
@@ -43,6 +42,16 @@ public:
     ObjectGroup *objectGroup() const
     { return mObjectGroup; }
 
+    /**
+     * Returns the draw order that the z values of the object items are
+     * currently based on.
+     */
+    ObjectGroup::DrawOrder drawOrder() const
+    { return mDrawOrder; }
+
+    void setDrawOrder(ObjectGroup::DrawOrder drawOrder)
+    { mDrawOrder = drawOrder; }
+
     // QGraphicsItem
     QRectF boundingRect() const;
     void paint(QPainter *painter,
@@ -51,6 +60,7 @@ public:
 
 private:
     ObjectGroup *mObjectGroup;
+    ObjectGroup::DrawOrder mDrawOrder;
 };
 
 } // namespace Internal
@@ -26,9 +26,11 @@
 #include "mapdocument.h"
 #include "mapdocumentactionhandler.h"
 #include "objectgroup.h"
+#include "objectsearchindex.h"
 #include "utils.h"
 #include "mapobjectmodel.h"
 
+#include <QAbstractListModel>
 #include <QBoxLayout>
 #include <QApplication>
 #include <QContextMenuEvent>
@@ -46,9 +48,92 @@
 using namespace Tiled;
 using namespace Tiled::Internal;
 
+namespace Tiled {
+namespace Internal {
+
+/**
+ * A flat list of the objects matching the filter of the objects dock. Only
+ * the rows on screen are asked for, so this stays fast for many matches.
+ */
+class ObjectSearchResults : public QAbstractListModel
+{
+public:
+    ObjectSearchResults(QObject *parent)
+        : QAbstractListModel(parent)
+    {}
+
+    void setObjects(const QList<MapObject*> &objects)
+    {
+        beginResetModel();
+        mObjects = objects;
+        mRows.clear();
+        endResetModel();
+    }
+
+    MapObject *objectAt(const QModelIndex &index) const
+    {
+        return index.isValid() ? mObjects.at(index.row()) : 0;
+    }
+
+    /**
+     * Returns the row of \a mapObject, or -1 when it is not in the list.
+     */
+    int rowOf(MapObject *mapObject) const
+    {
+        if (mRows.isEmpty() && !mObjects.isEmpty()) {
+            mRows.reserve(mObjects.size());
+            for (int row = 0; row < mObjects.size(); ++row)
+                mRows.insert(mObjects.at(row), row);
+        }
+        return mRows.value(mapObject, -1);
+    }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const
+    {
+        return parent.isValid() ? 0 : mObjects.size();
+    }
+
+    int columnCount(const QModelIndex &parent = QModelIndex()) const
+    {
+        return parent.isValid() ? 0 : 2;
+    }
+
+    QVariant data(const QModelIndex &index, int role) const
+    {
+        if (role != Qt::DisplayRole)
+            return QVariant();
+
+        const MapObject *mapObject = mObjects.at(index.row());
+        return index.column() ? mapObject->type() : mapObject->name();
+    }
+
+    QVariant headerData(int section, Qt::Orientation orientation,
+                        int role) const
+    {
+        if (role == Qt::DisplayRole && orientation == Qt::Horizontal) {
+            switch (section) {
+            case 0: return MapObjectModel::tr("Name");
+            case 1: return MapObjectModel::tr("Type");
+            }
+        }
+        return QVariant();
+    }
+
+private:
+    QList<MapObject*> mObjects;
+    mutable QHash<MapObject*, int> mRows;
+};
+
+} // namespace Internal
+} // namespace Tiled
+
 ObjectsDock::ObjectsDock(QWidget *parent)
     : QDockWidget(parent)
     , mObjectsView(new ObjectsView)
+    , mFilterEdit(new QLineEdit)
+    , mResultsView(new QTreeView)
+    , mResults(new ObjectSearchResults(this))
+    , mSynchingResults(false)
     , mMapDocument(0)
 {
     setObjectName(QLatin1String("ObjectsDock"));
@@ -66,7 +151,28 @@ ObjectsDock::ObjectsDock(QWidget *parent)
     QVBoxLayout *layout = new QVBoxLayout(widget);
     layout->setMargin(5);
     layout->setSpacing(0);
+    layout->addWidget(mFilterEdit);
     layout->addWidget(mObjectsView);
+    layout->addWidget(mResultsView);
+
+    mResultsView->setRootIsDecorated(false);
+    mResultsView->setUniformRowHeights(true);
+    mResultsView->setSelectionBehavior(QAbstractItemView::SelectRows);
+    mResultsView->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    mResultsView->setModel(mResults);
+    mResultsView->setVisible(false);
+#if QT_VERSION >= 0x050000
+    mResultsView->header()->setSectionResizeMode(0, QHeaderView::Stretch);
+#else
+    mResultsView->header()->setResizeMode(0, QHeaderView::Stretch);
+#endif
+
+    connect(mFilterEdit, SIGNAL(textChanged(QString)), SLOT(updateFilter()));
+    connect(mResultsView->selectionModel(),
+            SIGNAL(selectionChanged(QItemSelection,QItemSelection)),
+            SLOT(resultsSelectionChanged()));
+    connect(mResultsView, SIGNAL(activated(QModelIndex)),
+            SLOT(resultActivated(QModelIndex)));
 
     mActionNewLayer = new QAction(this);
     mActionNewLayer->setIcon(QIcon(QLatin1String(":/images/16x16/document-new.png")));
@@ -120,8 +226,13 @@ void ObjectsDock::setMapDocument(MapDocument *mapDoc)
         restoreExpandedGroups(mMapDocument);
         connect(mMapDocument, SIGNAL(selectedObjectsChanged()),
                 this, SLOT(updateActions()));
+        connect(mMapDocument, SIGNAL(selectedObjectsChanged()),
+                this, SLOT(synchronizeResultsSelection()));
+        connect(mMapDocument->objectSearchIndex(), SIGNAL(changed()),
+                this, SLOT(updateFilter()));
     }
 
+    updateFilter();
     updateActions();
 }
 
@@ -141,6 +252,8 @@ void ObjectsDock::retranslateUi()
 {
     setWindowTitle(tr("Objects"));
 
+    mFilterEdit->setPlaceholderText(tr("Filter by name, type or property"));
+
     mActionNewLayer->setToolTip(tr("Add Object Layer"));
     mActionObjectProperties->setToolTip(tr("Object Properties"));
 
@@ -201,12 +314,7 @@ void ObjectsDock::restoreExpandedGroups(MapDocument *mapDoc)
     mExpandedGroups[mapDoc].clear();
 
     // Also restore the selection
-    foreach (MapObject *o, mapDoc->selectedObjects()) {
-        QModelIndex index = mObjectsView->model()->index(o);
-        mObjectsView->selectionModel()->select(index,
-                                               QItemSelectionModel::Select |
-                                               QItemSelectionModel::Rows);
-    }
+    mObjectsView->synchronizeSelection();
 }
 
 void ObjectsDock::documentAboutToClose(MapDocument *mapDocument)
@@ -214,12 +322,90 @@ void ObjectsDock::documentAboutToClose(MapDocument *mapDocument)
     mExpandedGroups.remove(mapDocument);
 }
 
+bool ObjectsDock::isFiltering() const
+{
+    return mMapDocument && !mFilterEdit->text().trimmed().isEmpty();
+}
+
+/**
+ * Shows the objects matching the filter in a flat list instead of the tree
+ * of object layers, or returns to the tree when there is no filter.
+ */
+void ObjectsDock::updateFilter()
+{
+    const bool filtering = isFiltering();
+
+    mObjectsView->setVisible(!filtering);
+    mResultsView->setVisible(filtering);
+
+    QList<MapObject*> objects;
+    if (filtering)
+        objects = mMapDocument->objectSearchIndex()->find(mFilterEdit->text());
+
+    mSynchingResults = true;
+    mResults->setObjects(objects);
+    mSynchingResults = false;
+
+    synchronizeResultsSelection();
+}
+
+void ObjectsDock::resultsSelectionChanged()
+{
+    if (mSynchingResults || !isFiltering())
+        return;
+
+    QList<MapObject*> selectedObjects;
+    foreach (const QModelIndex &index, mResultsView->selectionModel()->selectedRows())
+        selectedObjects.append(mResults->objectAt(index));
+
+    if (selectedObjects != mMapDocument->selectedObjects()) {
+        mSynchingResults = true;
+        if (selectedObjects.count() == 1) {
+            const QPointF center = selectedObjects.first()->bounds().center();
+            DocumentManager::instance()->centerViewOn(center);
+        }
+        mMapDocument->setSelectedObjects(selectedObjects);
+        mSynchingResults = false;
+    }
+}
+
+void ObjectsDock::resultActivated(const QModelIndex &index)
+{
+    if (MapObject *mapObject = mResults->objectAt(index)) {
+        mMapDocument->setCurrentObject(mapObject);
+        mMapDocument->emitEditCurrentObject();
+    }
+}
+
+/**
+ * Selects the rows of the selected objects that match the filter.
+ */
+void ObjectsDock::synchronizeResultsSelection()
+{
+    if (mSynchingResults || !isFiltering())
+        return;
+
+    QItemSelection selection;
+    foreach (MapObject *mapObject, mMapDocument->selectedObjects()) {
+        const int row = mResults->rowOf(mapObject);
+        if (row != -1)
+            selection.select(mResults->index(row), mResults->index(row));
+    }
+
+    mSynchingResults = true;
+    mResultsView->selectionModel()->select(selection,
+                                           QItemSelectionModel::ClearAndSelect |
+                                           QItemSelectionModel::Rows);
+    mSynchingResults = false;
+}
+
 ///// ///// ///// ///// /////
 
 ObjectsView::ObjectsView(QWidget *parent)
     : QTreeView(parent)
     , mMapDocument(0)
     , mSynching(false)
+    , mSelectionOutOfSync(false)
 {
     setRootIsDecorated(true);
     setHeaderHidden(false);
@@ -247,6 +433,7 @@ void ObjectsView::setMapDocument(MapDocument *mapDoc)
         mMapDocument->disconnect(this);
 
     mMapDocument = mapDoc;
+    mSelectionOutOfSync = false;
 
     if (mMapDocument) {
         setModel(mMapDocument->mapObjectModel());
@@ -327,6 +514,37 @@ void ObjectsView::selectionChanged(const QItemSelection &selected,
     }
 }
 
+/**
+ * Selects the rows of the objects selected in the map document, replacing the
+ * current selection of the view.
+ */
+void ObjectsView::synchronizeSelection()
+{
+    mSelectionOutOfSync = false;
+
+    if (!mMapDocument)
+        return;
+
+    QItemSelection selection;
+    foreach (MapObject *o, mMapDocument->selectedObjects()) {
+        const QModelIndex index = model()->index(o);
+        selection.select(index, index);
+    }
+
+    mSynching = true;
+    selectionModel()->select(selection, QItemSelectionModel::ClearAndSelect |
+                                        QItemSelectionModel::Rows);
+    mSynching = false;
+}
+
+void ObjectsView::showEvent(QShowEvent *event)
+{
+    QTreeView::showEvent(event);
+
+    if (mSelectionOutOfSync)
+        synchronizeSelection();
+}
+
 void ObjectsView::selectedObjectsChanged()
 {
     if (mSynching)
@@ -335,16 +553,16 @@ void ObjectsView::selectedObjectsChanged()
     if (!mMapDocument)
         return;
 
-    const QList<MapObject *> &selectedObjects = mMapDocument->selectedObjects();
-
-    mSynching = true;
-    clearSelection();
-    foreach (MapObject *o, selectedObjects) {
-        QModelIndex index = model()->index(o);
-        selectionModel()->select(index, QItemSelectionModel::Select |  QItemSelectionModel::Rows);
+    // While the view is hidden, the selection is synchronized once it is
+    // shown again
+    if (!isVisible()) {
+        mSelectionOutOfSync = true;
+        return;
     }
-    mSynching = false;
 
+    synchronizeSelection();
+
+    const QList<MapObject *> &selectedObjects = mMapDocument->selectedObjects();
     if (selectedObjects.count() == 1) {
         MapObject *o = selectedObjects.first();
         scrollTo(model()->index(o));
@@ -24,6 +24,7 @@
 #include <QDockWidget>
 #include <QTreeView>
 
+class QLineEdit;
 class QTreeView;
 
 namespace Tiled {
@@ -34,6 +35,7 @@ namespace Internal {
 
 class MapDocument;
 class MapObjectModel;
+class ObjectSearchResults;
 class ObjectsView;
 
 class ObjectsDock : public QDockWidget
@@ -54,9 +56,14 @@ private slots:
     void triggeredMoveToMenu(QAction *action);
     void objectProperties();
     void documentAboutToClose(MapDocument *mapDocument);
+    void updateFilter();
+    void resultsSelectionChanged();
+    void resultActivated(const QModelIndex &index);
+    void synchronizeResultsSelection();
 
 private:
     void retranslateUi();
+    bool isFiltering() const;
 
     void saveExpandedGroups(MapDocument *mapDoc);
     void restoreExpandedGroups(MapDocument *mapDoc);
@@ -66,6 +73,10 @@ private:
     QAction *mActionMoveToGroup;
 
     ObjectsView *mObjectsView;
+    QLineEdit *mFilterEdit;
+    QTreeView *mResultsView;
+    ObjectSearchResults *mResults;
+    bool mSynchingResults;
     MapDocument *mMapDocument;
     QMap<MapDocument*, QList<ObjectGroup*> > mExpandedGroups;
     QMenu *mMoveToMenu;
@@ -84,6 +95,11 @@ public:
 
     MapObjectModel *model() const;
 
+    void synchronizeSelection();
+
+protected:
+    void showEvent(QShowEvent *event);
+
 protected slots:
     virtual void selectionChanged(const QItemSelection &selected,
                                   const QItemSelection &deselected);
@@ -96,6 +112,7 @@ private slots:
 private:
     MapDocument *mMapDocument;
     bool mSynching;
+    bool mSelectionOutOfSync;
 };
 
 } // namespace Internal
@@ -0,0 +1,260 @@
+/*
+ * objectsearchindex.cpp
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "objectsearchindex.h"
+
+#include "map.h"
+#include "mapdocument.h"
+#include "mapobject.h"
+#include "objectgroup.h"
+
+#include <QtAlgorithms>
+
+using namespace Tiled;
+using namespace Tiled::Internal;
+
+/**
+ * Returns the sorted words in the name, type and properties of \a mapObject,
+ * without duplicates.
+ */
+static QStringList objectWords(const MapObject *mapObject)
+{
+    QStringList words = ObjectSearchIndex::words(mapObject->name());
+    words += ObjectSearchIndex::words(mapObject->type());
+
+    const Properties &properties = mapObject->properties();
+    Properties::const_iterator it = properties.constBegin();
+    Properties::const_iterator it_end = properties.constEnd();
+    for (; it != it_end; ++it) {
+        words += ObjectSearchIndex::words(it.key());
+        words += ObjectSearchIndex::words(it.value());
+    }
+
+    words.sort();
+    words.removeDuplicates();
+    return words;
+}
+
+static bool sizeLessThan(const QSet<MapObject*> &a, const QSet<MapObject*> &b)
+{
+    return a.size() < b.size();
+}
+
+ObjectSearchIndex::ObjectSearchIndex(MapDocument *mapDocument)
+    : QObject(mapDocument)
+    , mMapDocument(mapDocument)
+    , mBuilt(false)
+{
+    connect(mapDocument, SIGNAL(objectsAdded(QList<MapObject*>)),
+            SLOT(objectsAdded(QList<MapObject*>)));
+    connect(mapDocument, SIGNAL(objectsChanged(QList<MapObject*>)),
+            SLOT(objectsChanged(QList<MapObject*>)));
+    connect(mapDocument, SIGNAL(objectsRemoved(QList<MapObject*>)),
+            SLOT(objectsRemoved(QList<MapObject*>)));
+    connect(mapDocument, SIGNAL(propertiesChanged(Object*)),
+            SLOT(propertiesChanged(Object*)));
+    connect(mapDocument, SIGNAL(propertyAdded(Object*,QString)),
+            SLOT(propertyChanged(Object*,QString)));
+    connect(mapDocument, SIGNAL(propertyChanged(Object*,QString)),
+            SLOT(propertyChanged(Object*,QString)));
+    connect(mapDocument, SIGNAL(propertyRemoved(Object*,QString)),
+            SLOT(propertyChanged(Object*,QString)));
+    connect(mapDocument, SIGNAL(layerAdded(int)),
+            SLOT(layerAdded(int)));
+    connect(mapDocument, SIGNAL(layerAboutToBeRemoved(int)),
+            SLOT(layerAboutToBeRemoved(int)));
+}
+
+QList<MapObject*> ObjectSearchIndex::find(const QString &query) const
+{
+    build();
+
+    const Map *map = mMapDocument->map();
+    const QStringList queryWords = words(query);
+
+    QList<QSet<MapObject*> > candidates;
+    foreach (const QString &word, queryWords) {
+        candidates.append(objectsWithPrefix(word));
+        if (candidates.last().isEmpty())
+            return QList<MapObject*>();
+    }
+
+    // Intersecting is cheapest when starting with the smallest sets
+    qSort(candidates.begin(), candidates.end(), sizeLessThan);
+    QSet<MapObject*> matches;
+    if (!candidates.isEmpty()) {
+        matches = candidates.first();
+        for (int i = 1; i < candidates.size() && !matches.isEmpty(); ++i)
+            matches.intersect(candidates.at(i));
+    }
+
+    QList<MapObject*> result;
+    foreach (const ObjectGroup *objectGroup, map->objectGroups()) {
+        foreach (MapObject *mapObject, objectGroup->objects()) {
+            if (candidates.isEmpty() || matches.contains(mapObject))
+                result.append(mapObject);
+        }
+    }
+    return result;
+}
+
+QStringList ObjectSearchIndex::words(const QString &text)
+{
+    QStringList words;
+    QString word;
+
+    for (int i = 0, end = text.size(); i <= end; ++i) {
+        if (i < end && text.at(i).isLetterOrNumber()) {
+            word.append(text.at(i).toLower());
+        } else if (!word.isEmpty()) {
+            words.append(word);
+            word.clear();
+        }
+    }
+
+    return words;
+}
+
+void ObjectSearchIndex::objectsAdded(const QList<MapObject*> &objects)
+{
+    objectsChanged(objects);
+}
+
+void ObjectSearchIndex::objectsChanged(const QList<MapObject*> &objects)
+{
+    if (!mBuilt)
+        return;
+
+    bool modified = false;
+    foreach (MapObject *mapObject, objects)
+        modified |= updateObject(mapObject);
+
+    if (modified)
+        emit changed();
+}
+
+void ObjectSearchIndex::objectsRemoved(const QList<MapObject*> &objects)
+{
+    if (!mBuilt)
+        return;
+
+    bool modified = false;
+    foreach (MapObject *mapObject, objects)
+        modified |= removeObject(mapObject);
+
+    if (modified)
+        emit changed();
+}
+
+void ObjectSearchIndex::propertiesChanged(Object *object)
+{
+    if (object->typeId() == Object::MapObjectType)
+        objectsChanged(QList<MapObject*>() << static_cast<MapObject*>(object));
+}
+
+void ObjectSearchIndex::propertyChanged(Object *object, const QString &name)
+{
+    Q_UNUSED(name)
+    propertiesChanged(object);
+}
+
+void ObjectSearchIndex::layerAdded(int index)
+{
+    if (ObjectGroup *objectGroup = mMapDocument->map()->layerAt(index)->asObjectGroup())
+        objectsChanged(objectGroup->objects());
+}
+
+void ObjectSearchIndex::layerAboutToBeRemoved(int index)
+{
+    if (ObjectGroup *objectGroup = mMapDocument->map()->layerAt(index)->asObjectGroup())
+        objectsRemoved(objectGroup->objects());
+}
+
+void ObjectSearchIndex::build() const
+{
+    if (mBuilt)
+        return;
+
+    foreach (const ObjectGroup *objectGroup, mMapDocument->map()->objectGroups())
+        foreach (MapObject *mapObject, objectGroup->objects())
+            updateObject(mapObject);
+
+    mBuilt = true;
+}
+
+/**
+ * Indexes the current words of \a mapObject. Returns whether they changed.
+ */
+bool ObjectSearchIndex::updateObject(MapObject *mapObject) const
+{
+    const QStringList words = objectWords(mapObject);
+
+    QHash<MapObject*, QStringList>::iterator it = mWordsByObject.find(mapObject);
+    if (it != mWordsByObject.end()) {
+        // Objects are often changed without touching their words, for
+        // example when they are moved
+        if (it.value() == words)
+            return false;
+
+        removeObject(mapObject);
+    }
+
+    foreach (const QString &word, words)
+        mObjectsByWord[word].insert(mapObject);
+
+    mWordsByObject.insert(mapObject, words);
+    return true;
+}
+
+/**
+ * Removes \a mapObject from the index. Returns whether it was indexed.
+ */
+bool ObjectSearchIndex::removeObject(MapObject *mapObject) const
+{
+    QHash<MapObject*, QStringList>::iterator it = mWordsByObject.find(mapObject);
+    if (it == mWordsByObject.end())
+        return false;
+
+    foreach (const QString &word, it.value()) {
+        QMap<QString, QSet<MapObject*> >::iterator wordIt = mObjectsByWord.find(word);
+        wordIt.value().remove(mapObject);
+        if (wordIt.value().isEmpty())
+            mObjectsByWord.erase(wordIt);
+    }
+
+    mWordsByObject.erase(it);
+    return true;
+}
+
+/**
+ * Returns the objects having a word that starts with \a prefix. Since the
+ * words are sorted, these are found next to each other.
+ */
+QSet<MapObject*> ObjectSearchIndex::objectsWithPrefix(const QString &prefix) const
+{
+    QSet<MapObject*> objects;
+
+    QMap<QString, QSet<MapObject*> >::const_iterator it = mObjectsByWord.lowerBound(prefix);
+    QMap<QString, QSet<MapObject*> >::const_iterator it_end = mObjectsByWord.constEnd();
+    for (; it != it_end && it.key().startsWith(prefix); ++it)
+        objects.unite(it.value());
+
+    return objects;
+}
@@ -0,0 +1,100 @@
+/*
+ * objectsearchindex.h
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OBJECTSEARCHINDEX_H
+#define OBJECTSEARCHINDEX_H
+
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+
+namespace Tiled {
+
+class MapObject;
+class Object;
+class ObjectGroup;
+
+namespace Internal {
+
+class MapDocument;
+
+/**
+ * An index from the words in the names, types and properties of the objects
+ * of a map to the objects containing them.
+ *
+ * The index is built the first time it is searched. From then on it follows
+ * the changes made to the objects through the map document, so searching
+ * only needs to look at the words matching the query.
+ */
+class ObjectSearchIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    ObjectSearchIndex(MapDocument *mapDocument);
+
+    /**
+     * Returns the objects matching the given \a query, in the order in which
+     * they appear in the map. An object matches when each of the words of
+     * the query is the start of a word in its name, type, property names or
+     * property values. Matching is case insensitive.
+     */
+    QList<MapObject*> find(const QString &query) const;
+
+    /**
+     * Splits \a text into the lower case words used by the index.
+     */
+    static QStringList words(const QString &text);
+
+signals:
+    /**
+     * Emitted when the words of any object changed, after the index has been
+     * built. Searches may need to be repeated.
+     */
+    void changed();
+
+private slots:
+    void objectsAdded(const QList<MapObject*> &objects);
+    void objectsChanged(const QList<MapObject*> &objects);
+    void objectsRemoved(const QList<MapObject*> &objects);
+    void propertiesChanged(Object *object);
+    void propertyChanged(Object *object, const QString &name);
+    void layerAdded(int index);
+    void layerAboutToBeRemoved(int index);
+
+private:
+    void build() const;
+    bool updateObject(MapObject *mapObject) const;
+    bool removeObject(MapObject *mapObject) const;
+    QSet<MapObject*> objectsWithPrefix(const QString &prefix) const;
+
+    MapDocument *mMapDocument;
+    mutable bool mBuilt;
+    mutable QMap<QString, QSet<MapObject*> > mObjectsByWord;
+    mutable QHash<MapObject*, QStringList> mWordsByObject;
+};
+
+} // namespace Internal
+} // namespace Tiled
+
+#endif // OBJECTSEARCHINDEX_H
@@ -20,7 +20,6 @@
 
 #include "objectselectiontool.h"
 
-#include "changepolygon.h"
 #include "layer.h"
 #include "map.h"
 #include "mapdocument.h"
@@ -28,21 +27,20 @@
 #include "mapobjectitem.h"
 #include "maprenderer.h"
 #include "mapscene.h"
-#include "movemapobject.h"
 #include "objectgroup.h"
 #include "preferences.h"
 #include "raiselowerhelper.h"
-#include "resizemapobject.h"
-#include "rotatemapobject.h"
 #include "selectionrectangle.h"
 #include "snaphelper.h"
 #include "tile.h"
 #include "tileset.h"
+#include "transformmapobjects.h"
 
 #include <QApplication>
 #include <QGraphicsItem>
 #include <QGraphicsView>
 #include <QKeyEvent>
+#include <QPainterPath>
 #include <QTransform>
 #include <QUndoStack>
 
@@ -423,17 +421,19 @@ void ObjectSelectionTool::keyPressed(QKeyEvent *event)
             moveBy /= Preferences::instance()->gridFine();
     }
 
-    QUndoStack *undoStack = mapDocument()->undoStack();
-    undoStack->beginMacro(tr("Move %n Object(s)", "", items.size()));
-    int i = 0;
+    QList<MapObject*> mapObjects;
+    QVector<TransformState> oldStates;
     foreach (MapObjectItem *objectItem, items) {
         MapObject *object = objectItem->mapObject();
-        const QPointF oldPos = object->position();
-        object->setPosition(oldPos + moveBy);
-        undoStack->push(new MoveMapObject(mapDocument(), object, oldPos));
-        ++i;
+        mapObjects.append(object);
+        oldStates.append(TransformState(object));
+        object->setPosition(object->position() + moveBy);
     }
-    undoStack->endMacro();
+
+    QUndoStack *undoStack = mapDocument()->undoStack();
+    undoStack->push(new TransformMapObjects(mapDocument(), mapObjects, oldStates,
+                                            tr("Move %n Object(s)", "",
+                                               items.size())));
 }
 
 void ObjectSelectionTool::mouseEntered()
@@ -860,10 +860,39 @@ void ObjectSelectionTool::updateSelection(const QPointF &pos,
 
     QSet<MapObjectItem*> selectedItems;
 
-    foreach (QGraphicsItem *item, mapScene()->items(rect)) {
-        MapObjectItem *mapObjectItem = dynamic_cast<MapObjectItem*>(item);
-        if (mapObjectItem)
-            selectedItems.insert(mapObjectItem);
+    // Find the candidates using the spatial index of each object group. The
+    // pixel area covered by the rect is padded, since objects are drawn with
+    // a line width and tile objects may be drawn with an offset.
+    const MapRenderer *renderer = mapDocument()->renderer();
+    const Map *map = mapDocument()->map();
+
+    QPolygonF pixelArea;
+    pixelArea << renderer->screenToPixelCoords(rect.topLeft())
+              << renderer->screenToPixelCoords(rect.topRight())
+              << renderer->screenToPixelCoords(rect.bottomRight())
+              << renderer->screenToPixelCoords(rect.bottomLeft());
+
+    const qreal margin = qMax(map->tileWidth(), map->tileHeight());
+    const QRectF pixelRect = pixelArea.boundingRect().adjusted(-margin, -margin,
+                                                               margin, margin);
+
+    QPainterPath selectionPath;
+    selectionPath.addRect(rect);
+
+    foreach (Layer *layer, map->layers()) {
+        ObjectGroup *objectGroup = layer->asObjectGroup();
+        if (!objectGroup || !objectGroup->isVisible())
+            continue;
+
+        foreach (MapObject *object, objectGroup->objectsIn(pixelRect)) {
+            MapObjectItem *item = mapScene()->itemForObject(object);
+            if (!item || !item->isVisible())
+                continue;
+
+            // Use the same test as QGraphicsScene::items
+            if (item->collidesWithPath(item->mapFromScene(selectionPath)))
+                selectedItems.insert(item);
+        }
     }
 
     if (modifiers & (Qt::ControlModifier | Qt::ShiftModifier))
@@ -933,15 +962,7 @@ void ObjectSelectionTool::finishMoving(const QPointF &pos)
     if (mStart == pos) // Move is a no-op
         return;
 
-    QUndoStack *undoStack = mapDocument()->undoStack();
-    undoStack->beginMacro(tr("Move %n Object(s)", "", mMovingObjects.size()));
-    foreach (const MovingObject &object, mMovingObjects) {
-        undoStack->push(new MoveMapObject(mapDocument(),
-                                          object.item->mapObject(),
-                                          object.oldPosition));
-    }
-    undoStack->endMacro();
-
+    pushTransformCommand(tr("Move %n Object(s)", "", mMovingObjects.size()));
     mMovingObjects.clear();
 }
 
@@ -996,15 +1017,7 @@ void ObjectSelectionTool::finishRotating(const QPointF &pos)
     if (mStart == pos) // No rotation at all
         return;
 
-    QUndoStack *undoStack = mapDocument()->undoStack();
-    undoStack->beginMacro(tr("Rotate %n Object(s)", "", mMovingObjects.size()));
-    foreach (const MovingObject &object, mMovingObjects) {
-        MapObject *mapObject = object.item->mapObject();
-        undoStack->push(new MoveMapObject(mapDocument(), mapObject, object.oldPosition));
-        undoStack->push(new RotateMapObject(mapDocument(), mapObject, object.oldRotation));
-    }
-    undoStack->endMacro();
-
+    pushTransformCommand(tr("Rotate %n Object(s)", "", mMovingObjects.size()));
     mMovingObjects.clear();
 }
 
@@ -1038,6 +1051,7 @@ void ObjectSelectionTool::updateResizingItems(const QPointF &pos,
      * aspect ratio option.
      */
     SnapHelper snapHelper(renderer);
+    snapHelper.setSnapObjects(mapDocument()->map(), movingMapObjects());
     if (modifiers & Qt::AltModifier)
         snapHelper.toggleSnap();
     QPointF pixelPos = renderer->screenToPixelCoords(pos);
@@ -1243,18 +1257,7 @@ void ObjectSelectionTool::finishResizing(const QPointF &pos)
     if (mStart == pos) // No scaling at all
         return;
 
-    QUndoStack *undoStack = mapDocument()->undoStack();
-    undoStack->beginMacro(tr("Resize %n Object(s)", "", mMovingObjects.size()));
-    foreach (const MovingObject &object, mMovingObjects) {
-        MapObject *mapObject = object.item->mapObject();
-        undoStack->push(new MoveMapObject(mapDocument(), mapObject, object.oldPosition));
-        undoStack->push(new ResizeMapObject(mapDocument(), mapObject, object.oldSize));
-        
-        if (!object.oldPolygon.isEmpty())
-            undoStack->push(new ChangePolygon(mapDocument(), mapObject, object.oldPolygon));
-    }
-    undoStack->endMacro();
-
+    pushTransformCommand(tr("Resize %n Object(s)", "", mMovingObjects.size()));
     mMovingObjects.clear();
 }
 
@@ -1285,11 +1288,48 @@ void ObjectSelectionTool::saveSelectionState()
     }
 }
 
+/**
+ * Pushes a single command that changes all moving objects from their saved
+ * state to their current state.
+ */
+void ObjectSelectionTool::pushTransformCommand(const QString &text)
+{
+    QList<MapObject*> mapObjects;
+    QVector<TransformState> oldStates;
+
+    foreach (const MovingObject &object, mMovingObjects) {
+        mapObjects.append(object.item->mapObject());
+
+        TransformState oldState;
+        oldState.position = object.oldPosition;
+        oldState.size = object.oldSize;
+        oldState.polygon = object.oldPolygon;
+        oldState.rotation = object.oldRotation;
+        oldStates.append(oldState);
+    }
+
+    QUndoStack *undoStack = mapDocument()->undoStack();
+    undoStack->push(new TransformMapObjects(mapDocument(), mapObjects,
+                                            oldStates, text));
+}
+
+/**
+ * Returns the objects being moved, which should not be snapped to.
+ */
+QSet<MapObject*> ObjectSelectionTool::movingMapObjects() const
+{
+    QSet<MapObject*> objects;
+    foreach (const MovingObject &object, mMovingObjects)
+        objects.insert(object.item->mapObject());
+    return objects;
+}
+
 const QPointF ObjectSelectionTool::snapToGrid(const QPointF &diff,
                                               Qt::KeyboardModifiers modifiers)
 {
     MapRenderer *renderer = mapDocument()->renderer();
     SnapHelper snapHelper(renderer, modifiers);
+    snapHelper.setSnapObjects(mapDocument()->map(), movingMapObjects());
 
     if (snapHelper.snaps()) {
         const QPointF alignScreenPos = renderer->pixelToScreenCoords(mAlignPosition);
@@ -101,6 +101,9 @@ private:
     
     void setMode(Mode mode);
     void saveSelectionState();
+    void pushTransformCommand(const QString &text);
+
+    QSet<MapObject*> movingMapObjects() const;
 
     const QPointF snapToGrid(const QPointF &pos,
                              Qt::KeyboardModifiers modifiers);
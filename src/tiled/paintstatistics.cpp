@@ -0,0 +1,100 @@
+/*
+ * paintstatistics.cpp
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "paintstatistics.h"
+
+#include "layer.h"
+#include "maprenderer.h"
+
+#include <QDebug>
+#include <QHash>
+
+using namespace Tiled;
+using namespace Tiled::Internal;
+
+bool PaintStatistics::mEnabled = false;
+
+// Painting only happens on the GUI thread
+static QHash<const Layer*, PaintStatistics::LayerStatistics> layerStatistics;
+static int itemsPainted = 0;
+
+static bool slowerThan(const PaintStatistics::LayerStatistics &a,
+                       const PaintStatistics::LayerStatistics &b)
+{
+    return a.paintTime > b.paintTime;
+}
+
+void PaintStatistics::setEnabled(bool enabled)
+{
+    mEnabled = enabled;
+    CellRenderer::setCollectStatistics(enabled);
+}
+
+void PaintStatistics::beginFrame()
+{
+    layerStatistics.clear();
+    itemsPainted = 0;
+    CellRenderer::resetStatistics();
+}
+
+PaintStatistics::Frame PaintStatistics::endFrame(qint64 paintTime,
+                                                 qint64 exposedArea)
+{
+    Frame frame;
+    frame.paintTime = paintTime;
+    frame.drawCalls = CellRenderer::drawCallCount();
+    frame.fragments = CellRenderer::fragmentCount();
+    frame.itemsPainted = itemsPainted;
+    frame.exposedArea = exposedArea;
+    frame.layers = layerStatistics.values();
+    qStableSort(frame.layers.begin(), frame.layers.end(), slowerThan);
+    return frame;
+}
+
+void PaintStatistics::itemPainted(const Layer *layer, qint64 paintTime)
+{
+    ++itemsPainted;
+
+    // Objects that are being created are not part of a layer yet
+    if (!layer)
+        return;
+
+    LayerStatistics &statistics = layerStatistics[layer];
+    if (statistics.itemsPainted == 0)
+        statistics.name = layer->name();
+
+    statistics.paintTime += paintTime;
+    ++statistics.itemsPainted;
+}
+
+void PaintStatistics::log(const Frame &frame)
+{
+    qDebug().nospace() << "Frame painted in " << frame.paintTime / 1000000.0
+                       << " ms: " << frame.itemsPainted << " items, "
+                       << frame.drawCalls << " draw calls, "
+                       << frame.fragments << " cells, "
+                       << frame.exposedArea << " pixels exposed";
+
+    foreach (const LayerStatistics &layer, frame.layers) {
+        qDebug().nospace() << "    " << qPrintable(layer.name) << ": "
+                           << layer.paintTime / 1000000.0 << " ms, "
+                           << layer.itemsPainted << " items";
+    }
+}
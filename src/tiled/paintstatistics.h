@@ -0,0 +1,131 @@
+/*
+ * paintstatistics.h
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PAINTSTATISTICS_H
+#define PAINTSTATISTICS_H
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QString>
+
+namespace Tiled {
+
+class Layer;
+
+namespace Internal {
+
+/**
+ * Collects statistics about the painting of the map views, to find out
+ * which layers make painting slow. Only collected when enabled, which is
+ * done with the --paint-statistics command line option.
+ */
+class PaintStatistics
+{
+public:
+    struct LayerStatistics
+    {
+        LayerStatistics()
+            : paintTime(0)
+            , itemsPainted(0)
+        {}
+
+        QString name;
+        qint64 paintTime;       // in nanoseconds
+        int itemsPainted;
+    };
+
+    struct Frame
+    {
+        Frame()
+            : paintTime(0)
+            , drawCalls(0)
+            , fragments(0)
+            , itemsPainted(0)
+            , exposedArea(0)
+        {}
+
+        qint64 paintTime;       // in nanoseconds
+        int drawCalls;
+        int fragments;
+        int itemsPainted;
+        qint64 exposedArea;     // in device pixels
+
+        // Sorted by paint time, slowest first
+        QList<LayerStatistics> layers;
+    };
+
+    static bool isEnabled() { return mEnabled; }
+    static void setEnabled(bool enabled);
+
+    /**
+     * Starts collecting the statistics for a new frame.
+     */
+    static void beginFrame();
+
+    /**
+     * Returns the statistics of the frame started with beginFrame(), given
+     * the total \a paintTime and the \a exposedArea of the frame.
+     */
+    static Frame endFrame(qint64 paintTime, qint64 exposedArea);
+
+    /**
+     * Records that an item of the given \a layer was painted, taking
+     * \a paintTime nanoseconds. The \a layer may be 0.
+     */
+    static void itemPainted(const Layer *layer, qint64 paintTime);
+
+    /**
+     * Writes the statistics of the given \a frame to the debug output.
+     */
+    static void log(const Frame &frame);
+
+private:
+    static bool mEnabled;
+};
+
+/**
+ * Measures the time taken by painting an item of a layer, from its
+ * construction until its destruction, when paint statistics are enabled.
+ */
+class LayerPaintTimer
+{
+public:
+    explicit LayerPaintTimer(const Layer *layer)
+        : mLayer(layer)
+    {
+        if (PaintStatistics::isEnabled())
+            mTimer.start();
+    }
+
+    ~LayerPaintTimer()
+    {
+        if (mTimer.isValid())
+            PaintStatistics::itemPainted(mLayer, mTimer.nsecsElapsed());
+    }
+
+private:
+    const Layer *mLayer;
+    QElapsedTimer mTimer;
+};
+
+} // namespace Internal
+} // namespace Tiled
+
+#endif // PAINTSTATISTICS_H
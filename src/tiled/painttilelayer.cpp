@@ -37,34 +37,44 @@ PaintTileLayer::PaintTileLayer(MapDocument *mapDocument,
                                const TileLayer *source):
     mMapDocument(mapDocument),
     mTarget(target),
-    mSource(static_cast<TileLayer*>(source->clone())),
-    mX(x),
-    mY(y),
-    mPaintedRegion(x, y, source->width(), source->height()),
-    mMergeable(false)
+    mMergeable(false),
+    // Stamps smaller than a chunk are unlikely to repeat whole chunks
+    mShareChunks(source->width() >= CHUNK_SIZE &&
+                 source->height() >= CHUNK_SIZE)
 {
-    mErased = mTarget->copy(mX - mTarget->x(),
-                            mY - mTarget->y(),
-                            mSource->width(), mSource->height());
-    setText(QCoreApplication::translate("Undo Commands", "Paint"));
-}
+    // Only the cells that are actually painted over are remembered
+    for (int sy = 0; sy < source->height(); ++sy) {
+        for (int sx = 0; sx < source->width(); ++sx) {
+            const Cell &cell = source->cellAt(sx, sy);
+            if (cell.isEmpty())
+                continue;
 
-PaintTileLayer::~PaintTileLayer()
-{
-    delete mSource;
-    delete mErased;
+            const QPoint position(x + sx, y + sy);
+            const QPoint layerPosition = position - mTarget->position();
+            if (!mTarget->contains(layerPosition))
+                continue;
+
+            mChanges.append(position, mTarget->cellAt(layerPosition), cell);
+        }
+    }
+
+    setText(QCoreApplication::translate("Undo Commands", "Paint"));
 }
 
 void PaintTileLayer::undo()
 {
     TilePainter painter(mMapDocument, mTarget);
-    painter.setCells(mX, mY, mErased, mPaintedRegion);
+    painter.applyChanges(mChanges, true);
 }
 
 void PaintTileLayer::redo()
 {
     TilePainter painter(mMapDocument, mTarget);
-    painter.drawCells(mX, mY, mSource);
+    painter.applyChanges(mChanges);
+
+    // Let repeated placements of a stamp share their chunks
+    if (mShareChunks)
+        mTarget->shareEqualChunks();
 }
 
 bool PaintTileLayer::mergeWith(const QUndoCommand *other)
@@ -75,33 +85,7 @@ bool PaintTileLayer::mergeWith(const QUndoCommand *other)
           o->mMergeable))
         return false;
 
-    const QRegion newRegion = o->mPaintedRegion.subtracted(mPaintedRegion);
-    const QRegion combinedRegion = mPaintedRegion.united(o->mPaintedRegion);
-    const QRect bounds = QRect(mX, mY, mSource->width(), mSource->height());
-    const QRect combinedBounds = combinedRegion.boundingRect();
-
-    // Resize the erased tiles and source layers when necessary
-    if (bounds != combinedBounds) {
-        const QPoint shift = bounds.topLeft() - combinedBounds.topLeft();
-        mErased->resize(combinedBounds.size(), shift);
-        mSource->resize(combinedBounds.size(), shift);
-    }
-
-    mX = combinedBounds.left();
-    mY = combinedBounds.top();
-    mPaintedRegion = combinedRegion;
-
-    // Copy the painted tiles from the other command over
-    const QPoint pos = QPoint(o->mX, o->mY) - combinedBounds.topLeft();
-    mSource->merge(pos, o->mSource);
-
-    // Copy the newly erased tiles from the other command over
-    foreach (const QRect &rect, newRegion.rects())
-        for (int y = rect.top(); y <= rect.bottom(); ++y)
-            for (int x = rect.left(); x <= rect.right(); ++x)
-                mErased->setCell(x - mX,
-                                 y - mY,
-                                 o->mErased->cellAt(x - o->mX, y - o->mY));
-
+    mChanges.merge(o->mChanges);
+    mShareChunks |= o->mShareChunks;
     return true;
 }
@@ -21,9 +21,9 @@
 #ifndef PAINTTILELAYER_H
 #define PAINTTILELAYER_H
 
+#include "changedcells.h"
 #include "undocommands.h"
 
-#include <QRegion>
 #include <QUndoCommand>
 
 namespace Tiled {
@@ -54,8 +54,6 @@ public:
                    int x, int y,
                    const TileLayer *source);
 
-    ~PaintTileLayer();
-
     /**
      * Sets whether this undo command can be merged with an existing command.
      */
@@ -71,11 +69,9 @@ public:
 private:
     MapDocument *mMapDocument;
     TileLayer *mTarget;
-    TileLayer *mSource;
-    TileLayer *mErased;
-    int mX, mY;
-    QRegion mPaintedRegion;
+    ChangedCells mChanges;
     bool mMergeable;
+    bool mShareChunks;
 };
 
 } // namespace Internal
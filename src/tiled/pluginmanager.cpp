@@ -28,6 +28,11 @@
 #include <QDirIterator>
 #include <QPluginLoader>
 
+#if QT_VERSION >= 0x050000
+#include <QJsonArray>
+#include <QJsonObject>
+#endif
+
 using namespace Tiled;
 using namespace Tiled::Internal;
 
@@ -84,6 +89,21 @@ void PluginManager::loadPlugins()
             continue;
 
         QPluginLoader loader(pluginFile);
+
+#if QT_VERSION >= 0x050000
+        // Defer loading plugins that tell which interfaces they provide
+        const QJsonObject metaData = loader.metaData().value(QLatin1String("MetaData")).toObject();
+        const QJsonArray interfaces = metaData.value(QLatin1String("Interfaces")).toArray();
+        if (!interfaces.isEmpty()) {
+            QStringList iids;
+            foreach (const QJsonValue &value, interfaces)
+                iids.append(value.toString());
+
+            mPlugins.append(Plugin(pluginFile, iids));
+            continue;
+        }
+#endif
+
         QObject *instance = loader.instance();
 
         if (!instance) {
@@ -95,24 +115,51 @@ void PluginManager::loadPlugins()
     }
 }
 
+const QList<Plugin> &PluginManager::plugins() const
+{
+    for (int i = 0; i < mPlugins.size(); ++i)
+        load(mPlugins[i]);
+
+    return mPlugins;
+}
+
 const Plugin *PluginManager::pluginByFileName(const QString &pluginFileName) const
 {
-    foreach (const Plugin &plugin, mPlugins)
-        if (pluginFileName == plugin.fileName)
+    for (int i = 0; i < mPlugins.size(); ++i) {
+        Plugin &plugin = mPlugins[i];
+        if (pluginFileName == plugin.fileName) {
+            load(plugin);
             return &plugin;
+        }
+    }
 
     return 0;
 }
 
 const Plugin *PluginManager::pluginByNameFilter(const QString &pluginFilter) const
 {
-    foreach (const Plugin &plugin, mPlugins) {
-        MapWriterInterface *writer =
-                qobject_cast<MapWriterInterface*>(plugin.instance);
+    foreach (MapWriterInterface *writer, interfaces<MapWriterInterface>())
+        if (writer->nameFilters().contains(pluginFilter))
+            return plugin(writer);
 
-        if (writer && writer->nameFilters().contains(pluginFilter))
-            return &plugin;
+    return 0;
+}
+
+/**
+ * Loads the given \a plugin when this wasn't attempted before, and returns
+ * its instance. Returns 0 when the plugin failed to load.
+ */
+QObject *PluginManager::load(Plugin &plugin) const
+{
+    if (!plugin.loaded) {
+        plugin.loaded = true;
+
+        QPluginLoader loader(plugin.fileName);
+        plugin.instance = loader.instance();
+
+        if (!plugin.instance)
+            qWarning() << "Error:" << qPrintable(loader.errorString());
     }
 
-    return 0;
+    return plugin.instance;
 }
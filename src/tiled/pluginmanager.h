@@ -24,22 +24,34 @@
 #include <QList>
 #include <QObject>
 #include <QString>
+#include <QStringList>
 
 namespace Tiled {
 namespace Internal {
 
 /**
- * A loaded plugin.
+ * A plugin. Plugins that list the interfaces they provide in their metadata
+ * are only loaded when one of those interfaces is first requested.
  */
 struct Plugin
 {
     Plugin(const QString &fileName, QObject *instance)
         : fileName(fileName)
         , instance(instance)
+        , loaded(true)
+    {}
+
+    Plugin(const QString &fileName, const QStringList &interfaces)
+        : fileName(fileName)
+        , instance(0)
+        , interfaces(interfaces)
+        , loaded(false)
     {}
 
     QString fileName;
-    QObject *instance;
+    QObject *instance;          /**< The plugin instance, once loaded. */
+    QStringList interfaces;     /**< The interface IDs from the metadata. */
+    bool loaded;                /**< Whether loading was attempted. */
 };
 
 /**
@@ -56,24 +68,33 @@ public:
     static void deleteInstance();
 
     /**
-     * Scans the plugin directory for plugins and attempts to load them.
+     * Scans the plugin directory for plugins. Plugins that don't declare
+     * the interfaces they provide in their metadata are loaded right away,
+     * the others are loaded on demand.
      */
     void loadPlugins();
 
     /**
-     * Returns the list of plugins found by the plugin manager.
+     * Returns the list of plugins found by the plugin manager. Any plugins
+     * that were not loaded yet are loaded by this function.
      */
-    const QList<Plugin> &plugins() const { return mPlugins; }
+    const QList<Plugin> &plugins() const;
 
     /**
-     * Returns the list of plugins that implement a given interface.
+     * Returns the list of plugins that implement a given interface. Only the
+     * plugins that may provide this interface are loaded.
      */
     template<typename T> QList<T*> interfaces() const
     {
+        const QString iid = QLatin1String(qobject_interface_iid<T*>());
         QList<T*> results;
-        foreach (const Plugin &plugin, mPlugins)
-            if (T *result = qobject_cast<T*>(plugin.instance))
+        for (int i = 0; i < mPlugins.size(); ++i) {
+            Plugin &plugin = mPlugins[i];
+            if (!plugin.loaded && !plugin.interfaces.contains(iid))
+                continue;
+            if (T *result = qobject_cast<T*>(load(plugin)))
                 results.append(result);
+        }
         return results;
     }
 
@@ -101,9 +122,11 @@ private:
     PluginManager();
     ~PluginManager();
 
+    QObject *load(Plugin &plugin) const;
+
     static PluginManager *mInstance;
 
-    QList<Plugin> mPlugins;
+    mutable QList<Plugin> mPlugins;
 };
 
 } // namespace Internal
@@ -60,10 +60,18 @@ Preferences::Preferences()
     mLayerDataFormat = (Map::LayerDataFormat)
             mSettings->value(QLatin1String("LayerDataFormat"),
                              Map::Base64Zlib).toInt();
+    // May have been chosen in a build with more compression methods
+    if (!isLayerDataFormatSupported(mLayerDataFormat))
+        mLayerDataFormat = Map::Base64Zlib;
     mMapRenderOrder = (Map::RenderOrder)
             mSettings->value(QLatin1String("MapRenderOrder"),
                              Map::RightDown).toInt();
     mDtdEnabled = boolValue("DtdEnabled");
+    mStripUnusedTilesets = boolValue("StripUnusedTilesets");
+    mUpgradeXmlLayerData = boolValue("UpgradeXmlLayerData");
+    mCompressionLevel = intValue("CompressionLevel", DefaultCompressionLevel);
+    mCompressionStrategy = (CompressionStrategy)
+            intValue("CompressionStrategy", DefaultStrategy);
     mReloadTilesetsOnChange = boolValue("ReloadTilesets", true);
     mSettings->endGroup();
 
@@ -74,6 +82,7 @@ Preferences::Preferences()
     mShowTileAnimations = boolValue("ShowTileAnimations", true);
     mSnapToGrid = boolValue("SnapToGrid");
     mSnapToFineGrid = boolValue("SnapToFineGrid");
+    mSnapToObjects = boolValue("SnapToObjects");
     mGridColor = colorValue("GridColor", Qt::black);
     mGridFine = intValue("GridFine", 4);
     mObjectLineWidth = realValue("ObjectLineWidth", 2);
@@ -81,6 +90,15 @@ Preferences::Preferences()
     mShowTilesetGrid = boolValue("ShowTilesetGrid", true);
     mLanguage = stringValue("Language");
     mUseOpenGL = boolValue("OpenGL");
+    mUseChunkItems = boolValue("ChunkItems");
+    mFlattenLayers = boolValue("FlattenLayers");
+    mSnapshotZoom = boolValue("SnapshotZoom");
+    mUndoMemoryBudget = intValue("UndoMemoryBudget", 256);
+    mCacheMemoryBudget = intValue("CacheMemoryBudget", 512);
+    mObjectDotSize = intValue("ObjectDotSize", 2);
+    mObjectOutlineSize = intValue("ObjectOutlineSize", 6);
+    mAutosaveInterval = intValue("AutosaveInterval", 5);
+    mConsoleLineLimit = intValue("ConsoleLineLimit", 10000);
     mSettings->endGroup();
 
     // Retrieve defined object types
@@ -94,6 +112,7 @@ Preferences::Preferences()
     const int count = qMin(names.size(), colors.size());
     for (int i = 0; i < count; ++i)
         mObjectTypes.append(ObjectType(names.at(i), QColor(colors.at(i))));
+    updateObjectTypeColors();
 
     mSettings->beginGroup(QLatin1String("Automapping"));
     mAutoMapDrawing = boolValue("WhileDrawing");
@@ -180,6 +199,16 @@ void Preferences::setSnapToFineGrid(bool snapToFineGrid)
     emit snapToFineGridChanged(mSnapToFineGrid);
 }
 
+void Preferences::setSnapToObjects(bool snapToObjects)
+{
+    if (mSnapToObjects == snapToObjects)
+        return;
+
+    mSnapToObjects = snapToObjects;
+    mSettings->setValue(QLatin1String("Interface/SnapToObjects"), mSnapToObjects);
+    emit snapToObjectsChanged(mSnapToObjects);
+}
+
 void Preferences::setGridColor(QColor gridColor)
 {
     if (mGridColor == gridColor)
@@ -273,6 +302,41 @@ void Preferences::setDtdEnabled(bool enabled)
     mSettings->setValue(QLatin1String("Storage/DtdEnabled"), enabled);
 }
 
+void Preferences::setStripUnusedTilesets(bool strip)
+{
+    mStripUnusedTilesets = strip;
+    mSettings->setValue(QLatin1String("Storage/StripUnusedTilesets"), strip);
+}
+
+void Preferences::setUpgradeXmlLayerData(bool upgrade)
+{
+    mUpgradeXmlLayerData = upgrade;
+    mSettings->setValue(QLatin1String("Storage/UpgradeXmlLayerData"), upgrade);
+}
+
+int Preferences::compressionLevel() const
+{
+    return mCompressionLevel;
+}
+
+void Preferences::setCompressionLevel(int level)
+{
+    mCompressionLevel = level;
+    mSettings->setValue(QLatin1String("Storage/CompressionLevel"), level);
+}
+
+CompressionStrategy Preferences::compressionStrategy() const
+{
+    return mCompressionStrategy;
+}
+
+void Preferences::setCompressionStrategy(CompressionStrategy strategy)
+{
+    mCompressionStrategy = strategy;
+    mSettings->setValue(QLatin1String("Storage/CompressionStrategy"),
+                        strategy);
+}
+
 QString Preferences::language() const
 {
     return mLanguage;
@@ -319,9 +383,115 @@ void Preferences::setUseOpenGL(bool useOpenGL)
     emit useOpenGLChanged(mUseOpenGL);
 }
 
+void Preferences::setUseChunkItems(bool useChunkItems)
+{
+    if (mUseChunkItems == useChunkItems)
+        return;
+
+    mUseChunkItems = useChunkItems;
+    mSettings->setValue(QLatin1String("Interface/ChunkItems"), mUseChunkItems);
+
+    emit useChunkItemsChanged(mUseChunkItems);
+}
+
+void Preferences::setFlattenLayers(bool flattenLayers)
+{
+    if (mFlattenLayers == flattenLayers)
+        return;
+
+    mFlattenLayers = flattenLayers;
+    mSettings->setValue(QLatin1String("Interface/FlattenLayers"), mFlattenLayers);
+
+    emit flattenLayersChanged(mFlattenLayers);
+}
+
+void Preferences::setSnapshotZoom(bool snapshotZoom)
+{
+    if (mSnapshotZoom == snapshotZoom)
+        return;
+
+    mSnapshotZoom = snapshotZoom;
+    mSettings->setValue(QLatin1String("Interface/SnapshotZoom"), mSnapshotZoom);
+
+    emit snapshotZoomChanged(mSnapshotZoom);
+}
+
+void Preferences::setUndoMemoryBudget(int megabytes)
+{
+    if (mUndoMemoryBudget == megabytes)
+        return;
+
+    mUndoMemoryBudget = megabytes;
+    mSettings->setValue(QLatin1String("Interface/UndoMemoryBudget"),
+                        mUndoMemoryBudget);
+
+    emit undoMemoryBudgetChanged(mUndoMemoryBudget);
+}
+
+void Preferences::setCacheMemoryBudget(int megabytes)
+{
+    if (mCacheMemoryBudget == megabytes)
+        return;
+
+    mCacheMemoryBudget = megabytes;
+    mSettings->setValue(QLatin1String("Interface/CacheMemoryBudget"),
+                        mCacheMemoryBudget);
+
+    emit cacheMemoryBudgetChanged(mCacheMemoryBudget);
+}
+
+void Preferences::setObjectDotSize(int pixels)
+{
+    if (mObjectDotSize == pixels)
+        return;
+
+    mObjectDotSize = pixels;
+    mSettings->setValue(QLatin1String("Interface/ObjectDotSize"),
+                        mObjectDotSize);
+
+    emit objectDetailSizesChanged();
+}
+
+void Preferences::setObjectOutlineSize(int pixels)
+{
+    if (mObjectOutlineSize == pixels)
+        return;
+
+    mObjectOutlineSize = pixels;
+    mSettings->setValue(QLatin1String("Interface/ObjectOutlineSize"),
+                        mObjectOutlineSize);
+
+    emit objectDetailSizesChanged();
+}
+
+void Preferences::setAutosaveInterval(int minutes)
+{
+    if (mAutosaveInterval == minutes)
+        return;
+
+    mAutosaveInterval = minutes;
+    mSettings->setValue(QLatin1String("Interface/AutosaveInterval"),
+                        mAutosaveInterval);
+
+    emit autosaveIntervalChanged(mAutosaveInterval);
+}
+
+void Preferences::setConsoleLineLimit(int lines)
+{
+    if (mConsoleLineLimit == lines)
+        return;
+
+    mConsoleLineLimit = lines;
+    mSettings->setValue(QLatin1String("Interface/ConsoleLineLimit"),
+                        mConsoleLineLimit);
+
+    emit consoleLineLimitChanged(mConsoleLineLimit);
+}
+
 void Preferences::setObjectTypes(const ObjectTypes &objectTypes)
 {
     mObjectTypes = objectTypes;
+    updateObjectTypeColors();
 
     QStringList names;
     QStringList colors;
@@ -338,6 +508,20 @@ void Preferences::setObjectTypes(const ObjectTypes &objectTypes)
     emit objectTypesChanged();
 }
 
+/**
+ * Rebuilds the index used by objectTypeColor(). When several types only
+ * differ in case, the first one wins, like when searching the list.
+ */
+void Preferences::updateObjectTypeColors()
+{
+    mObjectTypeColors.clear();
+    foreach (const ObjectType &objectType, mObjectTypes) {
+        const QString name = objectType.name.toLower();
+        if (!mObjectTypeColors.contains(name))
+            mObjectTypeColors.insert(name, objectType.color);
+    }
+}
+
 static QString lastPathKey(Preferences::FileType fileType)
 {
     QString key = QLatin1String("LastPaths/");
@@ -23,8 +23,10 @@
 
 #include <QColor>
 #include <QDate>
+#include <QHash>
 #include <QObject>
 
+#include "compression.h"
 #include "map.h"
 #include "objecttypes.h"
 
@@ -50,6 +52,7 @@ public:
     bool showTileAnimations() const { return mShowTileAnimations; }
     bool snapToGrid() const { return mSnapToGrid; }
     bool snapToFineGrid() const { return mSnapToFineGrid; }
+    bool snapToObjects() const { return mSnapToObjects; }
     QColor gridColor() const { return mGridColor; }
     int gridFine() const { return mGridFine; }
     qreal objectLineWidth() const { return mObjectLineWidth; }
@@ -66,6 +69,26 @@ public:
     bool dtdEnabled() const;
     void setDtdEnabled(bool enabled);
 
+    /**
+     * Whether the tilesets that are not used by a map are left out when
+     * exporting it.
+     */
+    bool stripUnusedTilesets() const { return mStripUnusedTilesets; }
+    void setStripUnusedTilesets(bool strip);
+
+    /**
+     * Whether maps using the XML layer data format are switched to the
+     * layer data format for new maps when they are saved.
+     */
+    bool upgradeXmlLayerData() const { return mUpgradeXmlLayerData; }
+    void setUpgradeXmlLayerData(bool upgrade);
+
+    int compressionLevel() const;
+    void setCompressionLevel(int level);
+
+    CompressionStrategy compressionStrategy() const;
+    void setCompressionStrategy(CompressionStrategy strategy);
+
     QString language() const;
     void setLanguage(const QString &language);
 
@@ -75,9 +98,61 @@ public:
     bool useOpenGL() const { return mUseOpenGL; }
     void setUseOpenGL(bool useOpenGL);
 
+    bool useChunkItems() const { return mUseChunkItems; }
+    void setUseChunkItems(bool useChunkItems);
+
+    /**
+     * Whether the tile layers other than the current one are flattened into
+     * cached composites, so that repainting costs the same regardless of the
+     * number of layers that are not being edited.
+     */
+    bool flattenLayers() const { return mFlattenLayers; }
+    void setFlattenLayers(bool flattenLayers);
+
+    /**
+     * Whether the map view scales a snapshot of itself while zooming, and
+     * only renders the map again once the zoom level settles.
+     */
+    bool snapshotZoom() const { return mSnapshotZoom; }
+    void setSnapshotZoom(bool snapshotZoom);
+
+    int undoMemoryBudget() const { return mUndoMemoryBudget; }
+    int cacheMemoryBudget() const { return mCacheMemoryBudget; }
+
+    /**
+     * Objects smaller than this many pixels on screen are drawn as a dot.
+     */
+    int objectDotSize() const { return mObjectDotSize; }
+
+    /**
+     * Objects smaller than this many pixels on screen are drawn as just their
+     * bounds, unless they are tile objects.
+     */
+    int objectOutlineSize() const { return mObjectOutlineSize; }
+
+    /**
+     * Returns the number of minutes between autosaves of modified maps, or 0
+     * when autosaving is disabled.
+     */
+    int autosaveInterval() const { return mAutosaveInterval; }
+
+    /**
+     * Returns the number of lines kept in the console. Older lines are
+     * dropped.
+     */
+    int consoleLineLimit() const { return mConsoleLineLimit; }
+
     const ObjectTypes &objectTypes() const { return mObjectTypes; }
     void setObjectTypes(const ObjectTypes &objectTypes);
 
+    /**
+     * Looks up the color of the object type with the given \a name, which
+     * is matched case-insensitively. Returns an invalid color when there is
+     * no such object type.
+     */
+    QColor objectTypeColor(const QString &name) const
+    { return mObjectTypeColors.value(name.toLower()); }
+
     enum FileType {
         ObjectTypesFile,
         ImageFile,
@@ -112,11 +187,18 @@ public slots:
     void setShowTileAnimations(bool enabled);
     void setSnapToGrid(bool snapToGrid);
     void setSnapToFineGrid(bool snapToFineGrid);
+    void setSnapToObjects(bool snapToObjects);
     void setGridColor(QColor gridColor);
     void setGridFine(int gridFine);
     void setObjectLineWidth(qreal lineWidth);
     void setHighlightCurrentLayer(bool highlight);
     void setShowTilesetGrid(bool showTilesetGrid);
+    void setUndoMemoryBudget(int megabytes);
+    void setCacheMemoryBudget(int megabytes);
+    void setObjectDotSize(int pixels);
+    void setObjectOutlineSize(int pixels);
+    void setAutosaveInterval(int minutes);
+    void setConsoleLineLimit(int lines);
 
 signals:
     void showGridChanged(bool showGrid);
@@ -124,6 +206,7 @@ signals:
     void showTileAnimationsChanged(bool enabled);
     void snapToGridChanged(bool snapToGrid);
     void snapToFineGridChanged(bool snapToFineGrid);
+    void snapToObjectsChanged(bool snapToObjects);
     void gridColorChanged(QColor gridColor);
     void gridFineChanged(int gridFine);
     void objectLineWidthChanged(qreal lineWidth);
@@ -131,6 +214,14 @@ signals:
     void showTilesetGridChanged(bool showTilesetGrid);
 
     void useOpenGLChanged(bool useOpenGL);
+    void useChunkItemsChanged(bool useChunkItems);
+    void flattenLayersChanged(bool flattenLayers);
+    void snapshotZoomChanged(bool snapshotZoom);
+    void undoMemoryBudgetChanged(int megabytes);
+    void cacheMemoryBudgetChanged(int megabytes);
+    void objectDetailSizesChanged();
+    void autosaveIntervalChanged(int minutes);
+    void consoleLineLimitChanged(int lines);
 
     void objectTypesChanged();
 
@@ -148,6 +239,8 @@ private:
     int intValue(const char *key, int defaultValue) const;
     qreal realValue(const char *key, qreal defaultValue) const;
 
+    void updateObjectTypeColors();
+
     QSettings *mSettings;
 
     bool mShowGrid;
@@ -155,6 +248,7 @@ private:
     bool mShowTileAnimations;
     bool mSnapToGrid;
     bool mSnapToFineGrid;
+    bool mSnapToObjects;
     QColor mGridColor;
     int mGridFine;
     qreal mObjectLineWidth;
@@ -164,10 +258,24 @@ private:
     Map::LayerDataFormat mLayerDataFormat;
     Map::RenderOrder mMapRenderOrder;
     bool mDtdEnabled;
+    bool mStripUnusedTilesets;
+    bool mUpgradeXmlLayerData;
+    int mCompressionLevel;
+    CompressionStrategy mCompressionStrategy;
     QString mLanguage;
     bool mReloadTilesetsOnChange;
     bool mUseOpenGL;
+    bool mUseChunkItems;
+    bool mFlattenLayers;
+    bool mSnapshotZoom;
+    int mUndoMemoryBudget;
+    int mCacheMemoryBudget;
+    int mObjectDotSize;
+    int mObjectOutlineSize;
+    int mAutosaveInterval;
+    int mConsoleLineLimit;
     ObjectTypes mObjectTypes;
+    QHash<QString, QColor> mObjectTypeColors;  // by lowercase type name
 
     bool mAutoMapDrawing;
 
@@ -21,6 +21,7 @@
 #include "preferencesdialog.h"
 #include "ui_preferencesdialog.h"
 
+#include "cachemanager.h"
 #include "languagemanager.h"
 #include "objecttypesmodel.h"
 #include "preferences.h"
@@ -139,10 +140,30 @@ PreferencesDialog::PreferencesDialog(QWidget *parent) :
     connect(mUi->languageCombo, SIGNAL(currentIndexChanged(int)),
             SLOT(languageSelected(int)));
     connect(mUi->openGL, SIGNAL(toggled(bool)), SLOT(useOpenGLToggled(bool)));
+    connect(mUi->chunkItems, SIGNAL(toggled(bool)),
+            SLOT(useChunkItemsToggled(bool)));
+    connect(mUi->flattenLayers, SIGNAL(toggled(bool)),
+            SLOT(flattenLayersToggled(bool)));
+    connect(mUi->snapshotZoom, SIGNAL(toggled(bool)),
+            SLOT(snapshotZoomToggled(bool)));
     connect(mUi->gridColor, SIGNAL(colorChanged(QColor)),
             Preferences::instance(), SLOT(setGridColor(QColor)));
     connect(mUi->gridFine, SIGNAL(valueChanged(int)),
             Preferences::instance(), SLOT(setGridFine(int)));
+    connect(mUi->undoMemoryBudget, SIGNAL(valueChanged(int)),
+            Preferences::instance(), SLOT(setUndoMemoryBudget(int)));
+    connect(mUi->cacheMemoryBudget, SIGNAL(valueChanged(int)),
+            Preferences::instance(), SLOT(setCacheMemoryBudget(int)));
+    connect(CacheManager::instance(), SIGNAL(memoryUsageChanged()),
+            SLOT(updateCacheMemoryUsage()));
+    connect(mUi->objectOutlineSize, SIGNAL(valueChanged(int)),
+            Preferences::instance(), SLOT(setObjectOutlineSize(int)));
+    connect(mUi->objectDotSize, SIGNAL(valueChanged(int)),
+            Preferences::instance(), SLOT(setObjectDotSize(int)));
+    connect(mUi->autosaveInterval, SIGNAL(valueChanged(int)),
+            Preferences::instance(), SLOT(setAutosaveInterval(int)));
+    connect(mUi->consoleLineLimit, SIGNAL(valueChanged(int)),
+            Preferences::instance(), SLOT(setConsoleLineLimit(int)));
     connect(mUi->objectLineWidth, SIGNAL(valueChanged(double)),
             SLOT(objectLineWidthChanged(double)));
 
@@ -167,6 +188,8 @@ PreferencesDialog::PreferencesDialog(QWidget *parent) :
 
     connect(mUi->autoMapWhileDrawing, SIGNAL(toggled(bool)),
             SLOT(useAutomappingDrawingToggled(bool)));
+
+    updateCacheMemoryUsage();
 }
 
 PreferencesDialog::~PreferencesDialog()
@@ -206,6 +229,21 @@ void PreferencesDialog::useOpenGLToggled(bool useOpenGL)
     Preferences::instance()->setUseOpenGL(useOpenGL);
 }
 
+void PreferencesDialog::useChunkItemsToggled(bool useChunkItems)
+{
+    Preferences::instance()->setUseChunkItems(useChunkItems);
+}
+
+void PreferencesDialog::flattenLayersToggled(bool flattenLayers)
+{
+    Preferences::instance()->setFlattenLayers(flattenLayers);
+}
+
+void PreferencesDialog::snapshotZoomToggled(bool snapshotZoom)
+{
+    Preferences::instance()->setSnapshotZoom(snapshotZoom);
+}
+
 void PreferencesDialog::addObjectType()
 {
     const int newRow = mObjectTypesModel->objectTypes().size();
@@ -304,8 +342,14 @@ void PreferencesDialog::fromPreferences()
     const Preferences *prefs = Preferences::instance();
     mUi->reloadTilesetImages->setChecked(prefs->reloadTilesetsOnChange());
     mUi->enableDtd->setChecked(prefs->dtdEnabled());
+    mUi->stripUnusedTilesets->setChecked(prefs->stripUnusedTilesets());
+    mUi->upgradeXmlLayerData->setChecked(prefs->upgradeXmlLayerData());
+    mUi->compressionLevel->setValue(prefs->compressionLevel());
     if (mUi->openGL->isEnabled())
         mUi->openGL->setChecked(prefs->useOpenGL());
+    mUi->chunkItems->setChecked(prefs->useChunkItems());
+    mUi->flattenLayers->setChecked(prefs->flattenLayers());
+    mUi->snapshotZoom->setChecked(prefs->snapshotZoom());
 
     // Not found (-1) ends up at index 0, system default
     int languageIndex = mUi->languageCombo->findData(prefs->language());
@@ -314,6 +358,12 @@ void PreferencesDialog::fromPreferences()
     mUi->languageCombo->setCurrentIndex(languageIndex);
     mUi->gridColor->setColor(prefs->gridColor());
     mUi->gridFine->setValue(prefs->gridFine());
+    mUi->undoMemoryBudget->setValue(prefs->undoMemoryBudget());
+    mUi->cacheMemoryBudget->setValue(prefs->cacheMemoryBudget());
+    mUi->objectOutlineSize->setValue(prefs->objectOutlineSize());
+    mUi->objectDotSize->setValue(prefs->objectDotSize());
+    mUi->autosaveInterval->setValue(prefs->autosaveInterval());
+    mUi->consoleLineLimit->setValue(prefs->consoleLineLimit());
     mUi->objectLineWidth->setValue(prefs->objectLineWidth());
     mUi->autoMapWhileDrawing->setChecked(prefs->automappingDrawing());
     mObjectTypesModel->setObjectTypes(prefs->objectTypes());
@@ -325,6 +375,9 @@ void PreferencesDialog::toPreferences()
 
     prefs->setReloadTilesetsOnChanged(mUi->reloadTilesetImages->isChecked());
     prefs->setDtdEnabled(mUi->enableDtd->isChecked());
+    prefs->setStripUnusedTilesets(mUi->stripUnusedTilesets->isChecked());
+    prefs->setUpgradeXmlLayerData(mUi->upgradeXmlLayerData->isChecked());
+    prefs->setCompressionLevel(mUi->compressionLevel->value());
     prefs->setAutomappingDrawing(mUi->autoMapWhileDrawing->isChecked());
 }
 
@@ -332,3 +385,18 @@ void PreferencesDialog::useAutomappingDrawingToggled(bool enabled)
 {
     Preferences::instance()->setAutomappingDrawing(enabled);
 }
+
+void PreferencesDialog::updateCacheMemoryUsage()
+{
+    const CacheManager *manager = CacheManager::instance();
+
+    QStringList lines;
+    for (int i = 0; i < CacheManager::CacheTypeCount; ++i) {
+        const CacheManager::CacheType type = CacheManager::CacheType(i);
+        const qreal megabytes = manager->memoryUsage(type) / (1024.0 * 1024.0);
+        lines.append(tr("%1: %2 MB").arg(CacheManager::cacheTypeName(type))
+                     .arg(megabytes, 0, 'f', 1));
+    }
+
+    mUi->cacheMemoryUsage->setText(lines.join(QLatin1String("\n")));
+}
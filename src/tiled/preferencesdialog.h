@@ -53,7 +53,11 @@ private slots:
     void languageSelected(int index);
     void objectLineWidthChanged(double lineWidth);
     void useOpenGLToggled(bool useOpenGL);
+    void useChunkItemsToggled(bool useChunkItems);
+    void flattenLayersToggled(bool flattenLayers);
+    void snapshotZoomToggled(bool snapshotZoom);
     void useAutomappingDrawingToggled(bool enabled);
+    void updateCacheMemoryUsage();
 
     void addObjectType();
     void selectedObjectTypesChanged();
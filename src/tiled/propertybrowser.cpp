@@ -59,6 +59,7 @@ namespace Internal {
 PropertyBrowser::PropertyBrowser(QWidget *parent)
     : QtTreePropertyBrowser(parent)
     , mUpdating(false)
+    , mUpdatePending(false)
     , mObject(0)
     , mMapDocument(0)
     , mVariantManager(new VariantPropertyManager(this))
@@ -86,6 +87,16 @@ PropertyBrowser::PropertyBrowser(QWidget *parent)
     mLayerFormatNames.append(QCoreApplication::translate("PreferencesDialog", "Base64 (gzip compressed)"));
     mLayerFormatNames.append(QCoreApplication::translate("PreferencesDialog", "Base64 (zlib compressed)"));
     mLayerFormatNames.append(QCoreApplication::translate("PreferencesDialog", "CSV"));
+    mLayerFormats << Map::XML << Map::Base64 << Map::Base64Gzip
+                  << Map::Base64Zlib << Map::CSV;
+    if (isLayerDataFormatSupported(Map::Base64Zstandard)) {
+        mLayerFormatNames.append(QCoreApplication::translate("PreferencesDialog", "Base64 (Zstandard compressed)"));
+        mLayerFormats.append(Map::Base64Zstandard);
+    }
+    if (isLayerDataFormatSupported(Map::Base64Lz4)) {
+        mLayerFormatNames.append(QCoreApplication::translate("PreferencesDialog", "Base64 (LZ4 compressed)"));
+        mLayerFormats.append(Map::Base64Lz4);
+    }
 
     mRenderOrderNames.append(QCoreApplication::translate("PreferencesDialog", "Right Down"));
     mRenderOrderNames.append(QCoreApplication::translate("PreferencesDialog", "Right Up"));
@@ -102,11 +113,41 @@ PropertyBrowser::PropertyBrowser(QWidget *parent)
             SLOT(valueChanged(QtProperty*,QVariant)));
 }
 
+/**
+ * Returns a value identifying the set of built-in properties displayed for
+ * the given \a object.
+ */
+static int propertyLayout(const Object *object)
+{
+    int subType = 0;
+
+    switch (object->typeId()) {
+    case Object::MapObjectType:
+        subType = static_cast<const MapObject*>(object)->cell().isEmpty() ? 0 : 1;
+        break;
+    case Object::LayerType:
+        subType = static_cast<const Layer*>(object)->layerType();
+        break;
+    default:
+        break;
+    }
+
+    return object->typeId() * 16 + subType;
+}
+
 void PropertyBrowser::setObject(Object *object)
 {
     if (mObject == object)
         return;
 
+    // Keep the properties when they are the same for the new object
+    if (mObject && object && propertyLayout(mObject) == propertyLayout(object)) {
+        mObject = object;
+        updateProperties();
+        updateCustomProperties();
+        return;
+    }
+
     // Destroy all previous properties
     mVariantManager->clear();
     mGroupManager->clear();
@@ -167,6 +208,8 @@ void PropertyBrowser::setMapDocument(MapDocument *mapDocument)
                 SLOT(objectsChanged(QList<MapObject*>)));
         connect(mapDocument, SIGNAL(layerChanged(int)),
                 SLOT(layerChanged(int)));
+        connect(mapDocument, SIGNAL(layersChanged(QList<int>)),
+                SLOT(layersChanged(QList<int>)));
         connect(mapDocument, SIGNAL(objectGroupChanged(ObjectGroup*)),
                 SLOT(objectGroupChanged(ObjectGroup*)));
         connect(mapDocument, SIGNAL(imageLayerChanged(ImageLayer*)),
@@ -219,50 +262,56 @@ void PropertyBrowser::editCustomProperty(const QString &name)
 void PropertyBrowser::mapChanged()
 {
     if (mObject == mMapDocument->map())
-        updateProperties();
+        scheduleUpdateProperties();
 }
 
 void PropertyBrowser::objectsChanged(const QList<MapObject *> &objects)
 {
     if (mObject && mObject->typeId() == Object::MapObjectType)
         if (objects.contains(static_cast<MapObject*>(mObject)))
-            updateProperties();
+            scheduleUpdateProperties();
 }
 
 void PropertyBrowser::layerChanged(int index)
 {
     if (mObject == mMapDocument->map()->layerAt(index))
-        updateProperties();
+        scheduleUpdateProperties();
+}
+
+void PropertyBrowser::layersChanged(const QList<int> &indexes)
+{
+    foreach (int index, indexes)
+        layerChanged(index);
 }
 
 void PropertyBrowser::objectGroupChanged(ObjectGroup *objectGroup)
 {
     if (mObject == objectGroup)
-        updateProperties();
+        scheduleUpdateProperties();
 }
 
 void PropertyBrowser::imageLayerChanged(ImageLayer *imageLayer)
 {
     if (mObject == imageLayer)
-        updateProperties();
+        scheduleUpdateProperties();
 }
 
 void PropertyBrowser::tilesetChanged(Tileset *tileset)
 {
     if (mObject == tileset)
-        updateProperties();
+        scheduleUpdateProperties();
 }
 
 void PropertyBrowser::tileChanged(Tile *tile)
 {
     if (mObject == tile)
-        updateProperties();
+        scheduleUpdateProperties();
 }
 
 void PropertyBrowser::terrainChanged(Tileset *tileset, int index)
 {
     if (mObject == tileset->terrain(index))
-        updateProperties();
+        scheduleUpdateProperties();
 }
 
 void PropertyBrowser::propertyAdded(Object *object, const QString &name)
@@ -535,7 +584,8 @@ void PropertyBrowser::addTileProperties()
                                                      groupProperty);
 
     probabilityProperty->setToolTip(tr("Relative chance this tile will be "
-                                       "picked while painting terrain"));
+                                       "picked while painting terrain or "
+                                       "random tiles"));
 
     addProperty(groupProperty);
 }
@@ -587,7 +637,7 @@ void PropertyBrowser::applyMapValue(PropertyId id, const QVariant &val)
         break;
     }
     case LayerFormatProperty: {
-        Map::LayerDataFormat format = static_cast<Map::LayerDataFormat>(val.toInt());
+        Map::LayerDataFormat format = mLayerFormats.value(val.toInt(), Map::Base64Zlib);
         command = new ChangeMapProperty(mMapDocument, format);
         break;
     }
@@ -856,8 +906,32 @@ QtVariantProperty *PropertyBrowser::createProperty(PropertyId id, int type,
     return property;
 }
 
+/**
+ * Schedules an update of the built-in property values. Changes to the
+ * displayed object often come in bursts, for example while dragging objects,
+ * so the values are updated at most once per event loop iteration.
+ */
+void PropertyBrowser::scheduleUpdateProperties()
+{
+    if (mUpdatePending)
+        return;
+
+    mUpdatePending = true;
+    QMetaObject::invokeMethod(this, "updatePendingProperties",
+                              Qt::QueuedConnection);
+}
+
+void PropertyBrowser::updatePendingProperties()
+{
+    if (mUpdatePending && mObject)
+        updateProperties();
+
+    mUpdatePending = false;
+}
+
 void PropertyBrowser::updateProperties()
 {
+    mUpdatePending = false;
     mUpdating = true;
 
     switch (mObject->typeId()) {
@@ -869,7 +943,7 @@ void PropertyBrowser::updateProperties()
         mIdToProperty[HexSideLengthProperty]->setValue(map->hexSideLength());
         mIdToProperty[StaggerAxisProperty]->setValue(map->staggerAxis());
         mIdToProperty[StaggerIndexProperty]->setValue(map->staggerIndex());
-        mIdToProperty[LayerFormatProperty]->setValue(map->layerDataFormat());
+        mIdToProperty[LayerFormatProperty]->setValue(mLayerFormats.indexOf(map->layerDataFormat()));
         mIdToProperty[RenderOrderProperty]->setValue(map->renderOrder());
         QColor backgroundColor = map->backgroundColor();
         if (!backgroundColor.isValid())
@@ -954,9 +1028,6 @@ void PropertyBrowser::updateCustomProperties()
 
     mUpdating = true;
 
-    qDeleteAll(mNameToProperty);
-    mNameToProperty.clear();
-
     mCombinedProperties = mObject->properties();
     // Add properties from selected objects which mObject does not contain to mCombinedProperties.
     foreach (Object *obj, mMapDocument->currentObjects()) {
@@ -973,16 +1044,36 @@ void PropertyBrowser::updateCustomProperties()
         }
     }
 
+    // Remove the properties that are no longer there
+    QHash<QString, QtVariantProperty*>::iterator i = mNameToProperty.begin();
+    while (i != mNameToProperty.end()) {
+        if (mCombinedProperties.contains(i.key())) {
+            ++i;
+        } else {
+            mPropertyToId.remove(i.value());
+            delete i.value();
+            i = mNameToProperty.erase(i);
+        }
+    }
+
+    // Reuse the existing properties and only create the missing ones. Both
+    // are sorted by name, so new properties are inserted after the preceding
+    // one to keep the order.
+    QtProperty *precedingProperty = 0;
     QMapIterator<QString,QString> it(mCombinedProperties);
 
     while (it.hasNext()) {
         it.next();
-        QtVariantProperty *property = createProperty(CustomProperty,
-                                                     QVariant::String,
-                                                     it.key(),
-                                                     mCustomPropertiesGroup);
+        QtVariantProperty *property = mNameToProperty.value(it.key());
+        if (!property) {
+            property = mVariantManager->addProperty(QVariant::String, it.key());
+            mCustomPropertiesGroup->insertSubProperty(property, precedingProperty);
+            mPropertyToId.insert(property, CustomProperty);
+            mNameToProperty.insert(it.key(), property);
+        }
         property->setValue(it.value());
         updatePropertyColor(it.key());
+        precedingProperty = property;
     }
 
     mUpdating = false;
@@ -1012,6 +1103,7 @@ void PropertyBrowser::updatePropertyColor(const QString &name)
         if (obj == mObject)
             continue;
         if (obj->property(propertyName) != propertyValue) {
+            property->setNameColor(Qt::black);
             property->setValueColor(Qt::gray);
             return;
         }
@@ -25,6 +25,7 @@
 #include <QUndoCommand>
 
 #include <QtTreePropertyBrowser>
+#include "map.h"
 #include "properties.h"
 
 class QtGroupPropertyManager;
@@ -84,6 +85,7 @@ private slots:
     void mapChanged();
     void objectsChanged(const QList<MapObject*> &objects);
     void layerChanged(int index);
+    void layersChanged(const QList<int> &indexes);
     void objectGroupChanged(ObjectGroup *objectGroup);
     void imageLayerChanged(ImageLayer *imageLayer);
     void tilesetChanged(Tileset *tileset);
@@ -99,6 +101,8 @@ private slots:
 
     void valueChanged(QtProperty *property, const QVariant &val);
 
+    void updatePendingProperties();
+
 private:
     enum PropertyId {
         NameProperty,
@@ -151,9 +155,11 @@ private:
                                       const QString &name,
                                       QtProperty *parent);
 
+    void scheduleUpdateProperties();
     void updateProperties();
     void updateCustomProperties();
     bool mUpdating;
+    bool mUpdatePending;
 
     void updatePropertyColor(const QString &name);
 
@@ -175,6 +181,7 @@ private:
     Properties mCombinedProperties;
 
     QStringList mLayerFormatNames;
+    QList<Map::LayerDataFormat> mLayerFormats;  // Matching mLayerFormatNames
     QStringList mRenderOrderNames;
     QStringList mFlippingFlagNames;
     QStringList mDrawOrderNames;
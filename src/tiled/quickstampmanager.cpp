@@ -50,16 +50,10 @@ void QuickStampManager::saveQuickStamp(int index, AbstractTool *selectedTool)
     if (!mMapDocument)
         return;
 
-    const Map *map = mMapDocument->map();
-
     // The source of the saved stamp depends on which tool is selected
-    TileLayer *copy = 0;
+    TileStamp stamp;
     if (dynamic_cast<StampBrush*>(selectedTool)) {
-        TileLayer *stamp = (static_cast<StampBrush*>(selectedTool))->stamp();
-        if (!stamp)
-            return;
-
-        copy = static_cast<TileLayer*>(stamp->clone());
+        stamp = static_cast<StampBrush*>(selectedTool)->stamp();
     } else if (dynamic_cast<TileSelectionTool*>(selectedTool)) {
         const TileLayer *tileLayer =
                 dynamic_cast<TileLayer*>(mMapDocument->currentLayer());
@@ -70,35 +64,22 @@ void QuickStampManager::saveQuickStamp(int index, AbstractTool *selectedTool)
         if (selection.isEmpty())
             return;
 
-        copy = tileLayer->copy(selection.translated(-tileLayer->x(),
-                                                    -tileLayer->y()));
+        stamp = TileStamp(tileLayer->copy(
+                              selection.translated(-tileLayer->x(),
+                                                   -tileLayer->y())));
     } else if (dynamic_cast<BucketFillTool*>(selectedTool)) {
-        TileLayer *stamp = (static_cast<BucketFillTool*>(selectedTool))->stamp();
-        if (!stamp)
-            return;
-
-        copy = static_cast<TileLayer*>(stamp->clone());
+        stamp = static_cast<BucketFillTool*>(selectedTool)->stamp();
     }
 
-    if (!copy)
+    if (stamp.isNull())
         return;
 
-    Map *copyMap = new Map(map->orientation(),
-                           copy->width(), copy->height(),
-                           map->tileWidth(), map->tileHeight());
-
-    copyMap->setRenderOrder(map->renderOrder());
-    copyMap->addLayer(copy);
-
-    // Add tileset references to map and tileset manager
-    TilesetManager *tilesetManager = TilesetManager::instance();
-    foreach (Tileset *tileset, copy->usedTilesets()) {
-        copyMap->addTileset(tileset);
-        tilesetManager->addReference(tileset);
-    }
+    // Add tileset references to the tileset manager
+    TilesetManager::instance()->addReferences(
+                stamp.tileLayer()->usedTilesets().toList());
 
     eraseQuickStamp(index);
-    mQuickStamps[index] = copyMap;
+    mQuickStamps[index] = stamp;
 }
 
 void QuickStampManager::cleanQuickStamps()
@@ -109,12 +90,15 @@ void QuickStampManager::cleanQuickStamps()
 
 void QuickStampManager::eraseQuickStamp(int index)
 {
-    if (Map *quickStamp = mQuickStamps.at(index)) {
-        // Decrease reference to tilesets
-        TilesetManager *tilesetManager = TilesetManager::instance();
-        tilesetManager->removeReferences(quickStamp->tilesets());
-        delete quickStamp;
-    }
+    const TileStamp &quickStamp = mQuickStamps.at(index);
+    if (quickStamp.isNull())
+        return;
+
+    // Decrease reference to tilesets
+    TilesetManager *tilesetManager = TilesetManager::instance();
+    tilesetManager->removeReferences(
+                quickStamp.tileLayer()->usedTilesets().toList());
+    mQuickStamps[index] = TileStamp();
 }
 
 void QuickStampManager::selectQuickStamp(int index)
@@ -122,10 +106,44 @@ void QuickStampManager::selectQuickStamp(int index)
     if (!mMapDocument)
         return;
 
-    if (Map *stampMap = mQuickStamps.at(index)) {
-        mMapDocument->unifyTilesets(stampMap);
-        emit setStampBrush(static_cast<TileLayer*>(stampMap->layerAt(0)));
+    TileStamp stamp = mQuickStamps.at(index);
+    if (stamp.isNull())
+        return;
+
+    // Only when the stamp uses tilesets that are not part of the map yet, a
+    // new stamp needs to be made in which these tilesets may be replaced
+    const QList<Tileset*> &mapTilesets = mMapDocument->map()->tilesets();
+    const QList<Tileset*> stampTilesets =
+            stamp.tileLayer()->usedTilesets().toList();
+
+    bool unified = true;
+    foreach (Tileset *tileset, stampTilesets) {
+        if (!mapTilesets.contains(tileset)) {
+            unified = false;
+            break;
+        }
+    }
+
+    if (!unified) {
+        const Map *map = mMapDocument->map();
+        TileLayer *copy = static_cast<TileLayer*>(stamp.tileLayer()->clone());
+
+        Map stampMap(map->orientation(),
+                     copy->width(), copy->height(),
+                     map->tileWidth(), map->tileHeight());
+        stampMap.setRenderOrder(map->renderOrder());
+        stampMap.addLayer(copy);
+        foreach (Tileset *tileset, stampTilesets)
+            stampMap.addTileset(tileset);
+
+        // Moves the tileset references of the stamp to any replacements
+        mMapDocument->unifyTilesets(&stampMap);
+
+        stamp = TileStamp(static_cast<TileLayer*>(stampMap.takeLayerAt(0)));
+        mQuickStamps[index] = stamp;
     }
+
+    emit setStamp(stamp);
 }
 
 void QuickStampManager::setMapDocument(MapDocument *mapDocument)
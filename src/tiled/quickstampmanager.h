@@ -21,12 +21,13 @@
 #ifndef QUICKSTAMPMANAGER_H
 #define QUICKSTAMPMANAGER_H
 
+#include "tilestamp.h"
+
 #include <QObject>
 #include <QVector>
 
 namespace Tiled {
 
-class Map;
 class TileLayer;
 
 namespace Internal {
@@ -38,6 +39,9 @@ class MapDocument;
  * Implements a manager which handles lots of copy&paste slots.
  * Ctrl + <1..9> will store tile layers, and just <1..9> will recall these
  * tile layers.
+ *
+ * The quick stamps are stored as shared stamps, so recalling one doesn't
+ * copy its tiles. The stamps hold a reference to the tilesets they use.
  */
 class QuickStampManager: public QObject
 {
@@ -72,7 +76,7 @@ public slots:
     void setMapDocument(MapDocument *mapDocument);
 
 signals:
-    void setStampBrush(const TileLayer*);
+    void setStamp(const TileStamp &stamp);
 
 private:
     Q_DISABLE_COPY(QuickStampManager)
@@ -80,7 +84,7 @@ private:
     void cleanQuickStamps();
     void eraseQuickStamp(int index);
 
-    QVector<Map*> mQuickStamps;
+    QVector<TileStamp> mQuickStamps;
     MapDocument *mMapDocument;
 };
 
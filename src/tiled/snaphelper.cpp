@@ -20,18 +20,85 @@
 
 #include "snaphelper.h"
 
+#include "map.h"
+#include "mapobject.h"
+#include "objectgroup.h"
 #include "preferences.h"
 
+#include <QTransform>
+
 namespace Tiled {
 namespace Internal {
 
+namespace {
+
+/**
+ * Returns the outline of \a object in pixel coordinates, taking into account
+ * its rotation. Sets \a closed to whether the last point connects back to
+ * the first.
+ */
+QPolygonF snapOutline(const MapObject *object, bool &closed)
+{
+    closed = true;
+
+    QPolygonF outline;
+    if (!object->cell().isEmpty()) {
+        outline = QPolygonF(object->boundsUseTile());
+        outline.pop_back();     // QPolygonF(QRectF) repeats the first point
+    } else if (object->shape() == MapObject::Polygon ||
+               object->shape() == MapObject::Polyline) {
+        outline = object->polygon().translated(object->position());
+        closed = object->shape() == MapObject::Polygon;
+    } else {
+        outline = QPolygonF(object->bounds());
+        outline.pop_back();
+    }
+
+    if (object->rotation() != 0) {
+        const QPointF &origin = object->position();
+        QTransform transform;
+        transform.translate(origin.x(), origin.y());
+        transform.rotate(object->rotation());
+        transform.translate(-origin.x(), -origin.y());
+        outline = transform.map(outline);
+    }
+
+    return outline;
+}
+
+inline qreal squaredLength(const QPointF &point)
+{
+    return point.x() * point.x() + point.y() * point.y();
+}
+
+/**
+ * Returns the point on the segment from \a a to \a b closest to \a point.
+ */
+QPointF closestPointOnSegment(const QPointF &point,
+                              const QPointF &a, const QPointF &b)
+{
+    const QPointF segment = b - a;
+    const qreal length = squaredLength(segment);
+    if (length == 0)
+        return a;
+
+    const QPointF offset = point - a;
+    const qreal t = (offset.x() * segment.x() +
+                     offset.y() * segment.y()) / length;
+    return a + segment * qBound(qreal(0), t, qreal(1));
+}
+
+} // anonymous namespace
+
 SnapHelper::SnapHelper(const MapRenderer *renderer,
                        Qt::KeyboardModifiers modifiers)
     : mRenderer(renderer)
+    , mMap(0)
 {
     Preferences *preferences = Preferences::instance();
     mSnapToGrid = preferences->snapToGrid();
     mSnapToFineGrid = preferences->snapToFineGrid();
+    mSnapToObjects = preferences->snapToObjects();
 
     if (modifiers & Qt::ControlModifier)
         toggleSnap();
@@ -41,10 +108,21 @@ void SnapHelper::toggleSnap()
 {
     mSnapToGrid = !mSnapToGrid;
     mSnapToFineGrid = false;
+    mSnapToObjects = !mSnapToObjects;
+}
+
+void SnapHelper::setSnapObjects(const Map *map,
+                                const QSet<MapObject*> &ignored)
+{
+    mMap = map;
+    mIgnoredObjects = ignored;
 }
 
 void SnapHelper::snap(QPointF &pixelPos) const
 {
+    if (snapsToObjects() && snapToObjects(pixelPos))
+        return;
+
     if (mSnapToFineGrid || mSnapToGrid) {
         QPointF tileCoords = mRenderer->pixelToTileCoords(pixelPos);
         if (mSnapToFineGrid) {
@@ -58,5 +136,69 @@ void SnapHelper::snap(QPointF &pixelPos) const
     }
 }
 
+/**
+ * Moves \a pixelPos to the closest object vertex within a quarter of a tile.
+ * When there is no such vertex, it is moved to the closest object edge
+ * within that distance instead. Returns whether it was moved.
+ */
+bool SnapHelper::snapToObjects(QPointF &pixelPos) const
+{
+    const qreal range = qMin(mMap->tileWidth(), mMap->tileHeight()) / 4.0;
+    const qreal maxDistance = range * range;
+    const QRectF area(pixelPos.x() - range, pixelPos.y() - range,
+                      range * 2, range * 2);
+
+    qreal vertexDistance = maxDistance;
+    qreal edgeDistance = maxDistance;
+    QPointF vertex;
+    QPointF edgePoint;
+    bool foundVertex = false;
+    bool foundEdge = false;
+
+    foreach (const ObjectGroup *objectGroup, mMap->objectGroups()) {
+        if (!objectGroup->isVisible())
+            continue;
+
+        foreach (MapObject *object, objectGroup->objectsIn(area)) {
+            if (!object->isVisible() || mIgnoredObjects.contains(object))
+                continue;
+
+            bool closed;
+            const QPolygonF outline = snapOutline(object, closed);
+            const int count = outline.size();
+
+            for (int i = 0; i < count; ++i) {
+                const QPointF &point = outline.at(i);
+                const qreal distance = squaredLength(point - pixelPos);
+                if (distance <= vertexDistance) {
+                    vertexDistance = distance;
+                    vertex = point;
+                    foundVertex = true;
+                }
+
+                if (foundVertex || (i == count - 1 && !closed))
+                    continue;
+
+                const QPointF &next = outline.at((i + 1) % count);
+                const QPointF closest = closestPointOnSegment(pixelPos,
+                                                              point, next);
+                const qreal edge = squaredLength(closest - pixelPos);
+                if (edge <= edgeDistance) {
+                    edgeDistance = edge;
+                    edgePoint = closest;
+                    foundEdge = true;
+                }
+            }
+        }
+    }
+
+    if (foundVertex)
+        pixelPos = vertex;
+    else if (foundEdge)
+        pixelPos = edgePoint;
+
+    return foundVertex || foundEdge;
+}
+
 } // namespace Internal
 } // namespace Tiled
@@ -23,7 +23,13 @@
 
 #include "maprenderer.h"
 
+#include <QSet>
+
 namespace Tiled {
+
+class Map;
+class MapObject;
+
 namespace Internal {
 
 class SnapHelper
@@ -33,14 +39,34 @@ public:
 
     void toggleSnap();
 
-    bool snaps() const { return mSnapToGrid || mSnapToFineGrid; }
+    /**
+     * Allows snapping to the vertices and edges of the objects in the
+     * visible object groups of \a map, when enabled in the preferences. The
+     * \a ignored objects, usually the ones being moved, are not snapped to.
+     *
+     * Object snapping takes precedence over grid snapping. Only objects
+     * near the snapped position are looked at, through the spatial index
+     * of each object group.
+     */
+    void setSnapObjects(const Map *map,
+                        const QSet<MapObject*> &ignored = QSet<MapObject*>());
+
+    bool snaps() const
+    { return mSnapToGrid || mSnapToFineGrid || snapsToObjects(); }
 
     void snap(QPointF &pixelPos) const;
 
 private:
+    bool snapsToObjects() const { return mSnapToObjects && mMap; }
+    bool snapToObjects(QPointF &pixelPos) const;
+
     const MapRenderer *mRenderer;
     bool mSnapToGrid;
     bool mSnapToFineGrid;
+    bool mSnapToObjects;
+
+    const Map *mMap;
+    QSet<MapObject*> mIgnoredObjects;
 };
 
 } // namespace Internal
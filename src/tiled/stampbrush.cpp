@@ -28,6 +28,7 @@
 #include "mapscene.h"
 #include "painttilelayer.h"
 #include "tilelayer.h"
+#include "tile.h"
 
 #include <math.h>
 #include <QVector>
@@ -41,7 +42,6 @@ StampBrush::StampBrush(QObject *parent)
                                ":images/22x22/stock-tool-clone.png")),
                        QKeySequence(tr("B")),
                        parent)
-    , mStamp(0)
     , mStampX(0), mStampY(0)
     , mBrushBehavior(Free)
     , mStampReferenceX(0)
@@ -52,7 +52,6 @@ StampBrush::StampBrush(QObject *parent)
 
 StampBrush::~StampBrush()
 {
-    delete mStamp;
 }
 
 void StampBrush::tilePositionChanged(const QPoint &)
@@ -147,7 +146,7 @@ void StampBrush::mouseReleased(QGraphicsSceneMouseEvent *event)
 
 void StampBrush::configureBrush(const QVector<QPoint> &list)
 {
-    if (!mStamp)
+    if (mStamp.isNull())
         return;
 
     QRegion reg;
@@ -156,7 +155,7 @@ void StampBrush::configureBrush(const QVector<QPoint> &list)
     if (mIsRandom)
         stampRegion = brushItem()->tileLayer()->region();
     else
-        stampRegion = mStamp->region();
+        stampRegion = mStamp.region();
 
     Map *map = mapDocument()->map();
 
@@ -170,11 +169,10 @@ void StampBrush::configureBrush(const QVector<QPoint> &list)
             reg += update;
 
             if (mIsRandom) {
-                TileLayer *newStamp = getRandomTileLayer();
-                stamp->merge(p, newStamp);
-                delete newStamp;
+                if (!mRandomCellPicker.isEmpty() && stamp->contains(p))
+                    stamp->setCell(p.x(), p.y(), mRandomCellPicker.pick());
             } else {
-                stamp->merge(p, mStamp);
+                stamp->merge(p, mStamp.tileLayer());
             }
 
         }
@@ -186,7 +184,7 @@ void StampBrush::configureBrush(const QVector<QPoint> &list)
 
 void StampBrush::modifiersChanged(Qt::KeyboardModifiers modifiers)
 {
-    if (!mStamp)
+    if (mStamp.isNull())
         return;
 
     if (modifiers & Qt::ShiftModifier) {
@@ -210,7 +208,7 @@ void StampBrush::modifiersChanged(Qt::KeyboardModifiers modifiers)
         if (mIsRandom)
             setRandomStamp();
         else
-            brushItem()->setTileLayer(mStamp);
+            brushItem()->setTileStamp(mStamp);
 
         updatePosition();
     }
@@ -229,45 +227,48 @@ void StampBrush::mapDocumentChanged(MapDocument *oldDocument,
 
     // Reset the brush, since it probably became invalid
     brushItem()->setTileRegion(QRegion());
-    setStamp(0);
+    setStamp(TileStamp());
 }
 
 TileLayer *StampBrush::getRandomTileLayer() const
 {
-    if (mRandomList.empty())
+    if (mRandomCellPicker.isEmpty())
         return 0;
 
     TileLayer *ret = new TileLayer(QString(), 0, 0, 1, 1);
-    ret->setCell(0, 0, mRandomList.at(rand() % mRandomList.size()));
+    ret->setCell(0, 0, mRandomCellPicker.pick());
     return ret;
 }
 
 void StampBrush::updateRandomList()
 {
-    mRandomList.clear();
+    mRandomCellPicker.clear();
 
-    if (!mStamp)
+    const TileLayer *stamp = mStamp.tileLayer();
+    if (!stamp)
         return;
 
-    for (int x = 0; x < mStamp->width(); x++)
-        for (int y = 0; y < mStamp->height(); y++)
-            if (!mStamp->cellAt(x, y).isEmpty())
-                mRandomList.append(mStamp->cellAt(x, y));
+    for (int x = 0; x < stamp->width(); x++) {
+        for (int y = 0; y < stamp->height(); y++) {
+            const Cell &cell = stamp->cellAt(x, y);
+            if (!cell.isEmpty())
+                mRandomCellPicker.add(cell, cell.tile->terrainProbability());
+        }
+    }
 }
 
-void StampBrush::setStamp(TileLayer *stamp)
+void StampBrush::setStamp(const TileStamp &stamp)
 {
     if (mStamp == stamp)
         return;
 
-    delete mStamp;
     mStamp = stamp;
 
     if (mIsRandom) {
         updateRandomList();
         setRandomStamp();
     } else {
-        brushItem()->setTileLayer(mStamp);
+        brushItem()->setTileStamp(mStamp);
     }
 
     updatePosition();
@@ -291,7 +292,7 @@ void StampBrush::beginCapture()
 
     mCaptureStart = tilePosition();
 
-    setStamp(0);
+    setStamp(TileStamp());
 }
 
 void StampBrush::endCapture()
@@ -369,12 +370,12 @@ void StampBrush::updatePosition()
         mStampY = tilePos.y();
     }
 
-    if (mIsRandom || !mStamp) {
+    if (mIsRandom || mStamp.isNull()) {
         mStampX = tilePos.x();
         mStampY = tilePos.y();
     } else {
-        mStampX = tilePos.x() - mStamp->width() / 2;
-        mStampY = tilePos.y() - mStamp->height() / 2;
+        mStampX = tilePos.x() - mStamp.tileLayer()->width() / 2;
+        mStampY = tilePos.y() - mStamp.tileLayer()->height() / 2;
     }
     brushItem()->setTileLayerPosition(QPoint(mStampX, mStampY));
 }
@@ -387,7 +388,7 @@ void StampBrush::setRandom(bool value)
         updateRandomList();
         setRandomStamp();
     } else {
-        brushItem()->setTileLayer(mStamp);
+        brushItem()->setTileStamp(mStamp);
     }
 }
 
@@ -23,7 +23,9 @@
 #define STAMPBRUSH_H
 
 #include "abstracttiletool.h"
+#include "randompicker.h"
 #include "tilelayer.h"
+#include "tilestamp.h"
 
 namespace Tiled {
 
@@ -54,16 +56,14 @@ public:
     void languageChanged();
 
     /**
-     * Sets the stamp that is drawn when painting. The stamp brush takes
-     * ownership over the stamp layer.
+     * Sets the stamp that is drawn when painting.
      */
-    void setStamp(TileLayer *stamp);
+    void setStamp(const TileStamp &stamp);
 
     /**
-     * This returns the actual tile layer which is used to define the current
-     * state.
+     * This returns the stamp which is used to define the current state.
      */
-    TileLayer *stamp() const { return mStamp; }
+    const TileStamp &stamp() const { return mStamp; }
 
 public slots:
     void setRandom(bool value);
@@ -104,10 +104,10 @@ private:
     void updatePosition();
 
     /**
-     * mStamp is a tile layer in which is the selection the user made
-     * either by rightclicking (Capture) or at the tilesetdock
+     * mStamp is a stamp of the selection the user made either by
+     * rightclicking (Capture) or at the tilesetdock
      */
-    TileLayer *mStamp;
+    TileStamp mStamp;
 
     QPoint mCaptureStart;
     int mStampX, mStampY;
@@ -151,17 +151,18 @@ private:
     int mStampReferenceX, mStampReferenceY;
 
     bool mIsRandom;
-    QList<Cell> mRandomList;
+    RandomPicker<Cell> mRandomCellPicker;
 
     /**
      * Returns a tile layer containing one tile randomly choosen
-     * from mRandomList.
+     * from mRandomCellPicker.
      */
     TileLayer *getRandomTileLayer() const;
 
     /**
-     * Updates the list used random stamps.
-     * This is done by taking all non-null tiles from the original stamp mStamp.
+     * Updates the picker used for random stamps.
+     * This is done by taking all non-null tiles from the original stamp
+     * mStamp, weighted by their probability.
      */
     void updateRandomList();
 
@@ -35,7 +35,6 @@
 
 #include <math.h>
 #include <QVector>
-#include <climits>
 
 using namespace Tiled;
 using namespace Tiled::Internal;
@@ -180,13 +179,32 @@ void TerrainBrush::mapDocumentChanged(MapDocument *oldDocument,
 {
     AbstractTileTool::mapDocumentChanged(oldDocument, newDocument);
 
+    if (oldDocument)
+        oldDocument->disconnect(this, SLOT(tileTerrainChanged()));
+    if (newDocument)
+        connect(newDocument, SIGNAL(tileTerrainChanged(QList<Tile*>)),
+                this, SLOT(tileTerrainChanged()));
+
     // Reset the brush, since it probably became invalid
     brushItem()->setTileLayer(0);
+    mBrushState = BrushState();
 
     // Don't use setTerrain since we do not want to update the brush right now
     mTerrain = firstTerrain(newDocument);
 }
 
+/**
+ * The terrain of the tiles decides which tiles the brush picks, so the brush
+ * is computed again.
+ */
+void TerrainBrush::tileTerrainChanged()
+{
+    mBrushState = BrushState();
+
+    if (mIsActive && brushItem()->isVisible())
+        updateBrush(tilePosition());
+}
+
 void TerrainBrush::setTerrain(const Terrain *terrain)
 {
     if (mTerrain == terrain)
@@ -265,58 +283,11 @@ static Tile *findBestTile(Tileset *tileset, unsigned terrain, unsigned considera
     if (terrain == 0xFFFFFFFF)
         return NULL;
 
-    QList<Tile*> matches;
-    int penalty = INT_MAX;
-
-    // TODO: this is a slow linear search, perhaps we could use a better find algorithm...
-    foreach (Tile *t, tileset->tiles()) {
-        if ((t->terrain() & considerationMask) != (terrain & considerationMask))
-            continue;
-
-        // calculate the tile transition penalty based on shortest distance to target terrain type
-        int tr = tileset->terrainTransitionPenalty(t->terrain() >> 24, terrain >> 24);
-        int tl = tileset->terrainTransitionPenalty((t->terrain() >> 16) & 0xFF, (terrain >> 16) & 0xFF);
-        int br = tileset->terrainTransitionPenalty((t->terrain() >> 8) & 0xFF, (terrain >> 8) & 0xFF);
-        int bl = tileset->terrainTransitionPenalty(t->terrain() & 0xFF, terrain & 0xFF);
-
-        // if there is no path to the destination terrain, this isn't a useful transition
-        if (tr < 0 || tl < 0 || br < 0 || bl < 0)
-            continue;
-
-        // add tile to the candidate list
-        int transitionPenalty = tr + tl + br + bl;
-        if (transitionPenalty <= penalty) {
-            if (transitionPenalty < penalty)
-                matches.clear();
-            penalty = transitionPenalty;
-
-            matches.push_back(t);
-        }
-    }
+    const TerrainMatches &matches = tileset->terrainMatches(terrain, considerationMask);
 
     // choose a candidate at random, with consideration for terrain probability
-    if (!matches.isEmpty()) {
-        // determine the range of probability
-        float sum = 0.f;
-        for (int i = 0; i < matches.size(); ++i) {
-            float probability = matches.at(i)->terrainProbability();
-            if (probability > 0.f)
-                sum += probability;
-        }
-
-        float random = ((float)rand() / RAND_MAX) * sum;
-
-        // determine which match was hit
-        sum = 0.f;
-        for (int i = 0; i < matches.size(); ++i) {
-            float probability = matches.at(i)->terrainProbability();
-            if (probability > 0.f) {
-                sum += probability;
-                if (random <= sum)
-                    return matches[i];
-            }
-        }
-    }
+    if (!matches.isEmpty())
+        return matches.pick();
 
     // TODO: conveniently, the NULL tile doesn't currently work, but when it does, we need to signal a failure to find any matches some other way
     return NULL;
@@ -376,6 +347,18 @@ void TerrainBrush::updateBrush(QPoint cursorPos, const QVector<QPoint> *list)
     if (!currentLayer->bounds().contains(cursorPos))
         return;
 
+    // if nothing changed since the brush was last computed, keep it
+    const TileLayer *brush = brushItem()->tileLayer();
+    if (!list && brush &&
+            brush->revision() == mBrushState.brushRevision &&
+            mBrushState.layer == currentLayer &&
+            mBrushState.revision == currentLayer->revision() &&
+            mBrushState.terrain == mTerrain &&
+            mBrushState.mode == mBrushMode &&
+            mBrushState.position == cursorPos &&
+            mBrushState.corner == paintCorner)
+        return;
+
     Tileset *terrainTileset = 0;
     int terrainId = -1;
     if (mTerrain) {
@@ -383,15 +366,23 @@ void TerrainBrush::updateBrush(QPoint cursorPos, const QVector<QPoint> *list)
         terrainId = mTerrain->id();
     }
 
-    // allocate a buffer to build the terrain tilemap (TODO: this could be retained per layer to save regular allocation)
-    Tile **newTerrain = new Tile*[numTiles];
+    // the buffer to build the terrain tilemap, and the flags for each tile
+    // that may be considered, are retained between updates
+    if (mChecked.size() != numTiles) {
+        mNewTerrain.resize(numTiles);
+        mChecked.fill(0, numTiles);
+    } else {
+        foreach (int i, mCheckedIndexes)
+            mChecked[i] = 0;
+    }
+    mCheckedIndexes.clear();
 
-    // allocate a buffer of flags for each tile that may be considered (TODO: this could be retained per layer to save regular allocation)
-    char *checked = new char[numTiles];
-    memset(checked, 0, numTiles);
+    Tile **newTerrain = mNewTerrain.data();
+    char *checked = mChecked.data();
 
     // create a consideration list, and push the start points
-    QList<QPoint> transitionList;
+    QVector<QPoint> transitionList;
+    int next = 0;
     int initialTiles = 0;
 
     if (list) {
@@ -408,9 +399,9 @@ void TerrainBrush::updateBrush(QPoint cursorPos, const QVector<QPoint> *list)
     QRect brushRect(cursorPos, cursorPos);
 
     // produce terrain with transitions using a simple, relative naive approach (considers each tile once, and doesn't allow re-consideration if selection was bad)
-    while (!transitionList.isEmpty()) {
+    while (next < transitionList.size()) {
         // get the next point in the consideration list
-        QPoint p = transitionList.takeFirst();
+        QPoint p = transitionList.at(next++);
         int x = p.x(), y = p.y();
         int i = y*layerWidth + x;
 
@@ -495,6 +486,7 @@ void TerrainBrush::updateBrush(QPoint cursorPos, const QVector<QPoint> *list)
         // add tile to the brush
         newTerrain[i] = paste;
         checked[i] = true;
+        mCheckedIndexes.append(i);
 
         // expand the brush rect to fit the edit set
         brushRect |= QRect(p, p);
@@ -543,12 +535,22 @@ void TerrainBrush::updateBrush(QPoint cursorPos, const QVector<QPoint> *list)
 
     // set the new tile layer as the brush
     brushItem()->setTileLayer(stamp);
-
-    delete[] checked;
-    delete[] newTerrain;
+    delete stamp;
 
     brushItem()->setTileLayerPosition(brushRect.topLeft());
 
+    if (!list) {
+        mBrushState.layer = currentLayer;
+        mBrushState.revision = currentLayer->revision();
+        mBrushState.terrain = mTerrain;
+        mBrushState.mode = mBrushMode;
+        mBrushState.position = cursorPos;
+        mBrushState.corner = paintCorner;
+        mBrushState.brushRevision = brushItem()->tileLayer()->revision();
+    } else {
+        mBrushState = BrushState();
+    }
+
     mPaintX = cursorPos.x();
     mPaintY = cursorPos.y();
     mOffsetX = cursorPos.x() - brushRect.left();
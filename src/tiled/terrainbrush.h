@@ -26,6 +26,8 @@
 #include "abstracttiletool.h"
 #include "tilelayer.h"
 
+#include <QVector>
+
 namespace Tiled {
 
 class Tile;
@@ -96,6 +98,9 @@ protected:
     void mapDocumentChanged(MapDocument *oldDocument,
                             MapDocument *newDocument);
 
+private slots:
+    void tileTerrainChanged();
+
 private:
     void beginPaint();
 
@@ -148,6 +153,36 @@ private:
      * When drawing circles this will be the midpoint.
      */
     int mLineReferenceX, mLineReferenceY;
+
+    /**
+     * Buffers used by updateBrush(), retained between calls. Only the cells
+     * checked by the previous update are reset, rather than the whole layer.
+     */
+    QVector<Tile*> mNewTerrain;
+    QVector<char> mChecked;
+    QVector<int> mCheckedIndexes;
+
+    /**
+     * What the current brush was computed for, so that it isn't computed
+     * again when nothing changed.
+     */
+    struct BrushState
+    {
+        BrushState()
+            : layer(0), revision(0), terrain(0), mode(PaintTile)
+            , corner(0), brushRevision(0)
+        {}
+
+        const TileLayer *layer;
+        unsigned revision;
+        const Terrain *terrain;
+        BrushMode mode;
+        QPoint position;
+        int corner;
+        unsigned brushRevision;
+    };
+
+    BrushState mBrushState;
 };
 
 } // namespace Internal
@@ -48,9 +48,11 @@ TerrainModel::TerrainModel(MapDocument *mapDocument,
     connect(mapDocument, SIGNAL(tilesetAboutToBeRemoved(int)),
             this, SLOT(tilesetAboutToBeRemoved(int)));
     connect(mapDocument, SIGNAL(tilesetRemoved(Tileset*)),
-            this, SLOT(tilesetRemoved()));
+            this, SLOT(tilesetRemoved(Tileset*)));
     connect(mapDocument, SIGNAL(tilesetNameChanged(Tileset*)),
             this, SLOT(tilesetNameChanged(Tileset*)));
+    connect(mapDocument, SIGNAL(tilesetChanged(Tileset*)),
+            this, SLOT(tilesetChanged(Tileset*)));
 }
 
 TerrainModel::~TerrainModel()
@@ -115,10 +117,20 @@ QVariant TerrainModel::data(const QModelIndex &index, int role) const
         case Qt::DisplayRole:
         case Qt::EditRole:
             return terrain->name();
-        case Qt::DecorationRole:
-            if (Tile *imageTile = terrain->imageTile())
-                return imageTile->image();
+        case Qt::DecorationRole: {
+            // Returning the same icon lets it keep its scaled pixmaps
+            QHash<const Terrain*, QIcon>::const_iterator it =
+                    mThumbnails.constFind(terrain);
+            if (it != mThumbnails.constEnd())
+                return it.value();
+
+            if (Tile *imageTile = terrain->imageTile()) {
+                const QIcon icon(imageTile->image());
+                mThumbnails.insert(terrain, icon);
+                return icon;
+            }
             break;
+        }
         case TerrainRole:
             return QVariant::fromValue(terrain);
         }
@@ -223,6 +235,7 @@ Terrain *TerrainModel::takeTerrainAt(Tileset *tileset, int index)
 
     beginRemoveRows(tilesetIndex, index, index);
     Terrain *terrain = tileset->takeTerrainAt(index);
+    mThumbnails.remove(terrain);
     endRemoveRows();
     emit terrainRemoved(terrain);
     emit dataChanged(tilesetIndex, tilesetIndex); // for TerrainFilterModel
@@ -246,6 +259,8 @@ void TerrainModel::setTerrainImage(Tileset *tileset, int index, int tileId)
 
 void TerrainModel::emitTerrainChanged(Terrain *terrain)
 {
+    mThumbnails.remove(terrain);
+
     const QModelIndex index = TerrainModel::index(terrain);
     emit dataChanged(index, index);
     emit terrainChanged(terrain->tileset(), index.row());
@@ -266,8 +281,9 @@ void TerrainModel::tilesetAboutToBeRemoved(int index)
     beginRemoveRows(QModelIndex(), index, index);
 }
 
-void TerrainModel::tilesetRemoved()
+void TerrainModel::tilesetRemoved(Tileset *tileset)
 {
+    removeThumbnails(tileset);
     endRemoveRows();
 }
 
@@ -276,3 +292,26 @@ void TerrainModel::tilesetNameChanged(Tileset *tileset)
     const QModelIndex index = TerrainModel::index(tileset);
     emit dataChanged(index, index);
 }
+
+/**
+ * The tile images may have changed, so the thumbnails of the terrains of
+ * \a tileset are created again. Only the rows of these terrains are updated.
+ */
+void TerrainModel::tilesetChanged(Tileset *tileset)
+{
+    const int count = tileset->terrainCount();
+    if (count == 0 || !mMapDocument->map()->tilesets().contains(tileset))
+        return;
+
+    removeThumbnails(tileset);
+
+    const QModelIndex tilesetIndex = TerrainModel::index(tileset);
+    emit dataChanged(index(0, 0, tilesetIndex),
+                     index(count - 1, 0, tilesetIndex));
+}
+
+void TerrainModel::removeThumbnails(Tileset *tileset)
+{
+    foreach (const Terrain *terrain, tileset->terrains())
+        mThumbnails.remove(terrain);
+}
@@ -24,6 +24,8 @@
 #define TERRAINMODEL_H
 
 #include <QAbstractItemModel>
+#include <QHash>
+#include <QIcon>
 #include <tileset.h>
 
 namespace Tiled {
@@ -37,6 +39,9 @@ class MapDocument;
 
 /**
  * A model providing a tree view on the terrain types available on a map.
+ *
+ * The icon of each terrain is kept until its image changes, so that the
+ * views can reuse the thumbnails scaled from it.
  */
 class TerrainModel : public QAbstractItemModel
 {
@@ -122,13 +127,16 @@ private slots:
     void tilesetAboutToBeAdded(int index);
     void tilesetAdded();
     void tilesetAboutToBeRemoved(int index);
-    void tilesetRemoved();
+    void tilesetRemoved(Tileset *tileset);
     void tilesetNameChanged(Tileset *tileset);
+    void tilesetChanged(Tileset *tileset);
 
 private:
     void emitTerrainChanged(Terrain *terrain);
+    void removeThumbnails(Tileset *tileset);
 
     MapDocument *mMapDocument;
+    mutable QHash<const Terrain*, QIcon> mThumbnails;
 };
 
 } // namespace Internal
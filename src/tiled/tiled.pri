@@ -0,0 +1,344 @@
+# The sources of the Tiled application, except for main.cpp. These are
+# shared with the tests that need to run parts of the application.
+
+include($$PWD/../qtpropertybrowser/src/qtpropertybrowser.pri)
+
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+greaterThan(QT_MAJOR_VERSION, 4) {
+    QT += widgets
+}
+contains(QT_CONFIG, opengl):!macx: QT += opengl
+
+DEFINES += QT_NO_CAST_FROM_ASCII \
+    QT_NO_CAST_TO_ASCII
+
+macx {
+    LIBS += -framework Foundation
+    DEFINES += QT_NO_OPENGL
+}
+
+SOURCES += $$PWD/aboutdialog.cpp \
+    $$PWD/abstractimagetool.cpp \
+    $$PWD/abstractobjecttool.cpp \
+    $$PWD/abstracttiletool.cpp \
+    $$PWD/abstracttool.cpp \
+    $$PWD/addremovelayer.cpp \
+    $$PWD/addremovemapobject.cpp \
+    $$PWD/addremoveterrain.cpp \
+    $$PWD/addremovetiles.cpp \
+    $$PWD/addremovetileset.cpp \
+    $$PWD/automapper.cpp \
+    $$PWD/automapperwrapper.cpp \
+    $$PWD/automappingmanager.cpp \
+    $$PWD/autosavemanager.cpp \
+    $$PWD/automappingutils.cpp \
+    $$PWD/brushitem.cpp \
+    $$PWD/bucketfilltool.cpp \
+    $$PWD/cachemanager.cpp \
+    $$PWD/changedcells.cpp \
+    $$PWD/changeimagelayerposition.cpp \
+    $$PWD/changeimagelayerproperties.cpp \
+    $$PWD/changelayer.cpp \
+    $$PWD/changemapobject.cpp \
+    $$PWD/changemapobjectsorder.cpp \
+    $$PWD/changemapproperty.cpp \
+    $$PWD/changeobjectgroupproperties.cpp \
+    $$PWD/changepolygon.cpp \
+    $$PWD/changeproperties.cpp \
+    $$PWD/changetileanimation.cpp \
+    $$PWD/changetileobjectgroup.cpp \
+    $$PWD/changetileprobability.cpp \
+    $$PWD/changeselectedarea.cpp \
+    $$PWD/changetileterrain.cpp \
+    $$PWD/clipboardmanager.cpp \
+    $$PWD/colorbutton.cpp \
+    $$PWD/commandbutton.cpp \
+    $$PWD/command.cpp \
+    $$PWD/commanddatamodel.cpp \
+    $$PWD/commanddialog.cpp \
+    $$PWD/commandlineparser.cpp \
+    $$PWD/consoledock.cpp \
+    $$PWD/createellipseobjecttool.cpp \
+    $$PWD/createmultipointobjecttool.cpp \
+    $$PWD/createobjecttool.cpp \
+    $$PWD/createpolygonobjecttool.cpp \
+    $$PWD/createpolylineobjecttool.cpp \
+    $$PWD/createrectangleobjecttool.cpp \
+    $$PWD/createscalableobjecttool.cpp \
+    $$PWD/createtileobjecttool.cpp \
+    $$PWD/documentmanager.cpp \
+    $$PWD/editpolygontool.cpp \
+    $$PWD/editterraindialog.cpp \
+    $$PWD/eraser.cpp \
+    $$PWD/erasetiles.cpp \
+    $$PWD/exportasimagedialog.cpp \
+    $$PWD/fileedit.cpp \
+    $$PWD/filesystemwatcher.cpp \
+    $$PWD/filltiles.cpp \
+    $$PWD/flipmapobjects.cpp \
+    $$PWD/geometry.cpp \
+    $$PWD/gridcache.cpp \
+    $$PWD/imagelayeritem.cpp \
+    $$PWD/imagemovementtool.cpp \
+    $$PWD/languagemanager.cpp \
+    $$PWD/layerdock.cpp \
+    $$PWD/layermodel.cpp \
+    $$PWD/mainwindow.cpp \
+    $$PWD/mapdocumentactionhandler.cpp \
+    $$PWD/mapdocument.cpp \
+    $$PWD/maploader.cpp \
+    $$PWD/mapobjectitem.cpp \
+    $$PWD/mapobjectmodel.cpp \
+    $$PWD/mapsaver.cpp \
+    $$PWD/mapscene.cpp \
+    $$PWD/mapsdock.cpp \
+    $$PWD/mapsindexer.cpp \
+    $$PWD/mapview.cpp \
+    $$PWD/minimap.cpp \
+    $$PWD/minimapdock.cpp \
+    $$PWD/movabletabwidget.cpp \
+    $$PWD/movelayer.cpp \
+    $$PWD/movemapobject.cpp \
+    $$PWD/movemapobjecttogroup.cpp \
+    $$PWD/movetileset.cpp \
+    $$PWD/newmapdialog.cpp \
+    $$PWD/newtilesetdialog.cpp \
+    $$PWD/objectgroupitem.cpp \
+    $$PWD/objectsdock.cpp \
+    $$PWD/objectsearchindex.cpp \
+    $$PWD/objectselectiontool.cpp \
+    $$PWD/objecttypes.cpp \
+    $$PWD/objecttypesmodel.cpp \
+    $$PWD/offsetlayer.cpp \
+    $$PWD/offsetmapdialog.cpp \
+    $$PWD/paintstatistics.cpp \
+    $$PWD/painttilelayer.cpp \
+    $$PWD/patreondialog.cpp \
+    $$PWD/pluginmanager.cpp \
+    $$PWD/preferences.cpp \
+    $$PWD/preferencesdialog.cpp \
+    $$PWD/propertiesdock.cpp \
+    $$PWD/propertybrowser.cpp \
+    $$PWD/quickstampmanager.cpp \
+    $$PWD/raiselowerhelper.cpp \
+    $$PWD/renamelayer.cpp \
+    $$PWD/renameterrain.cpp \
+    $$PWD/resizedialog.cpp \
+    $$PWD/resizehelper.cpp \
+    $$PWD/resizemap.cpp \
+    $$PWD/resizemapobject.cpp \
+    $$PWD/resizetilelayer.cpp \
+    $$PWD/rotatemapobject.cpp \
+    $$PWD/selectionrectangle.cpp \
+    $$PWD/snaphelper.cpp \
+    $$PWD/stampbrush.cpp \
+    $$PWD/terrainbrush.cpp \
+    $$PWD/terraindock.cpp \
+    $$PWD/terrainmodel.cpp \
+    $$PWD/terrainview.cpp \
+    $$PWD/tileanimationdriver.cpp \
+    $$PWD/tileanimationeditor.cpp \
+    $$PWD/tilecollisioneditor.cpp \
+    $$PWD/tiledapplication.cpp \
+    $$PWD/tilelayercompositeitem.cpp \
+    $$PWD/tilelayerglrenderer.cpp \
+    $$PWD/tilelayeritem.cpp \
+    $$PWD/tilelayerprefetcher.cpp \
+    $$PWD/tilepainter.cpp \
+    $$PWD/tileselectionitem.cpp \
+    $$PWD/tileselectiontool.cpp \
+    $$PWD/tilesetchanges.cpp \
+    $$PWD/tilesetdock.cpp \
+    $$PWD/tilesetmanager.cpp \
+    $$PWD/tilesetmodel.cpp \
+    $$PWD/tilesetview.cpp \
+    $$PWD/tilestamp.cpp \
+    $$PWD/tilestatisticsdock.cpp \
+    $$PWD/tmxmapreader.cpp \
+    $$PWD/tmxmapwriter.cpp \
+    $$PWD/toolmanager.cpp \
+    $$PWD/transformmapobjects.cpp \
+    $$PWD/undodock.cpp \
+    $$PWD/undomemorymanager.cpp \
+    $$PWD/utils.cpp \
+    $$PWD/varianteditorfactory.cpp \
+    $$PWD/variantpropertymanager.cpp \
+    $$PWD/world.cpp \
+    $$PWD/worldview.cpp \
+    $$PWD/zoomable.cpp \
+    $$PWD/magicwandtool.cpp
+
+HEADERS += $$PWD/aboutdialog.h \
+    $$PWD/abstractimagetool.h \
+    $$PWD/abstractobjecttool.h \
+    $$PWD/abstracttiletool.h \
+    $$PWD/abstracttool.h \
+    $$PWD/addremovelayer.h \
+    $$PWD/addremovemapobject.h \
+    $$PWD/addremoveterrain.h \
+    $$PWD/addremovetiles.h \
+    $$PWD/addremovetileset.h \
+    $$PWD/automapper.h \
+    $$PWD/automapperwrapper.h \
+    $$PWD/automappingmanager.h \
+    $$PWD/autosavemanager.h \
+    $$PWD/automappingutils.h \
+    $$PWD/brushitem.h \
+    $$PWD/bucketfilltool.h \
+    $$PWD/cachemanager.h \
+    $$PWD/changedcells.h \
+    $$PWD/changeimagelayerposition.h \
+    $$PWD/changeimagelayerproperties.h \
+    $$PWD/changelayer.h \
+    $$PWD/changemapobject.h \
+    $$PWD/changemapobjectsorder.h \
+    $$PWD/changemapproperty.h \
+    $$PWD/changeobjectgroupproperties.h \
+    $$PWD/changepolygon.h \
+    $$PWD/changeproperties.h \
+    $$PWD/changetileanimation.h \
+    $$PWD/changetileobjectgroup.h \
+    $$PWD/changetileprobability.h \
+    $$PWD/changeselectedarea.h \
+    $$PWD/changetileterrain.h \
+    $$PWD/clipboardmanager.h \
+    $$PWD/colorbutton.h \
+    $$PWD/commandbutton.h \
+    $$PWD/commanddatamodel.h \
+    $$PWD/commanddialog.h \
+    $$PWD/command.h \
+    $$PWD/commandlineparser.h \
+    $$PWD/consoledock.h \
+    $$PWD/createellipseobjecttool.h \
+    $$PWD/createmultipointobjecttool.h \
+    $$PWD/createobjecttool.h \
+    $$PWD/createpolygonobjecttool.h \
+    $$PWD/createpolylineobjecttool.h \
+    $$PWD/createrectangleobjecttool.h \
+    $$PWD/createscalableobjecttool.h \
+    $$PWD/createtileobjecttool.h \
+    $$PWD/documentmanager.h \
+    $$PWD/editpolygontool.h \
+    $$PWD/editterraindialog.h \
+    $$PWD/eraser.h \
+    $$PWD/erasetiles.h \
+    $$PWD/exportasimagedialog.h \
+    $$PWD/fileedit.h \
+    $$PWD/filesystemwatcher.h \
+    $$PWD/filltiles.h \
+    $$PWD/flipmapobjects.h \
+    $$PWD/geometry.h \
+    $$PWD/gridcache.h \
+    $$PWD/imagelayeritem.h \
+    $$PWD/imagemovementtool.h \
+    $$PWD/languagemanager.h \
+    $$PWD/layerdock.h \
+    $$PWD/layermodel.h \
+    $$PWD/macsupport.h \
+    $$PWD/mainwindow.h \
+    $$PWD/mapdocumentactionhandler.h \
+    $$PWD/mapdocument.h \
+    $$PWD/maploader.h \
+    $$PWD/mapobjectitem.h \
+    $$PWD/mapobjectmodel.h \
+    $$PWD/mapsaver.h \
+    $$PWD/mapscene.h \
+    $$PWD/mapsdock.h \
+    $$PWD/mapsindexer.h \
+    $$PWD/mapview.h \
+    $$PWD/minimap.h \
+    $$PWD/minimapdock.h \
+    $$PWD/movabletabwidget.h \
+    $$PWD/movelayer.h \
+    $$PWD/movemapobject.h \
+    $$PWD/movemapobjecttogroup.h \
+    $$PWD/movetileset.h \
+    $$PWD/newmapdialog.h \
+    $$PWD/newtilesetdialog.h \
+    $$PWD/objectgroupitem.h \
+    $$PWD/objectsdock.h \
+    $$PWD/objectsearchindex.h \
+    $$PWD/objectselectiontool.h \
+    $$PWD/objecttypes.h \
+    $$PWD/objecttypesmodel.h \
+    $$PWD/offsetlayer.h \
+    $$PWD/offsetmapdialog.h \
+    $$PWD/paintstatistics.h \
+    $$PWD/painttilelayer.h \
+    $$PWD/patreondialog.h \
+    $$PWD/pluginmanager.h \
+    $$PWD/preferencesdialog.h \
+    $$PWD/preferences.h \
+    $$PWD/propertiesdock.h \
+    $$PWD/propertybrowser.h \
+    $$PWD/quickstampmanager.h \
+    $$PWD/raiselowerhelper.h \
+    $$PWD/rangeset.h \
+    $$PWD/renamelayer.h \
+    $$PWD/renameterrain.h \
+    $$PWD/resizedialog.h \
+    $$PWD/resizehelper.h \
+    $$PWD/resizemap.h \
+    $$PWD/resizemapobject.h \
+    $$PWD/resizetilelayer.h \
+    $$PWD/rotatemapobject.h \
+    $$PWD/selectionrectangle.h \
+    $$PWD/snaphelper.h \
+    $$PWD/stampbrush.h \
+    $$PWD/terrainbrush.h \
+    $$PWD/terraindock.h \
+    $$PWD/terrainmodel.h \
+    $$PWD/terrainview.h \
+    $$PWD/tileanimationdriver.h \
+    $$PWD/tileanimationeditor.h \
+    $$PWD/tilecollisioneditor.h \
+    $$PWD/tiledapplication.h \
+    $$PWD/tilelayercompositeitem.h \
+    $$PWD/tilelayerglrenderer.h \
+    $$PWD/tilelayeritem.h \
+    $$PWD/tilelayerprefetcher.h \
+    $$PWD/tilepainter.h \
+    $$PWD/tileselectionitem.h \
+    $$PWD/tileselectiontool.h \
+    $$PWD/tilesetchanges.h \
+    $$PWD/tilesetdock.h \
+    $$PWD/tilesetmanager.h \
+    $$PWD/tilesetmodel.h \
+    $$PWD/tilesetview.h \
+    $$PWD/tilestamp.h \
+    $$PWD/tilestatisticsdock.h \
+    $$PWD/tmxmapreader.h \
+    $$PWD/tmxmapwriter.h \
+    $$PWD/toolmanager.h \
+    $$PWD/transformmapobjects.h \
+    $$PWD/undocommands.h \
+    $$PWD/undodock.h \
+    $$PWD/undomemorymanager.h \
+    $$PWD/utils.h \
+    $$PWD/varianteditorfactory.h \
+    $$PWD/variantpropertymanager.h \
+    $$PWD/world.h \
+    $$PWD/worldview.h \
+    $$PWD/zoomable.h \
+    $$PWD/magicwandtool.h
+
+macx {
+    OBJECTIVE_SOURCES += $$PWD/macsupport.mm
+}
+
+FORMS += $$PWD/aboutdialog.ui \
+    $$PWD/commanddialog.ui \
+    $$PWD/editterraindialog.ui \
+    $$PWD/exportasimagedialog.ui \
+    $$PWD/mainwindow.ui \
+    $$PWD/newmapdialog.ui \
+    $$PWD/newtilesetdialog.ui \
+    $$PWD/offsetmapdialog.ui \
+    $$PWD/patreondialog.ui \
+    $$PWD/preferencesdialog.ui \
+    $$PWD/resizedialog.ui \
+    $$PWD/tileanimationeditor.ui
+
+RESOURCES += $$PWD/tiled.qrc
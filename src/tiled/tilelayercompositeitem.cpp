@@ -0,0 +1,258 @@
+/*
+ * tilelayercompositeitem.cpp
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tilelayercompositeitem.h"
+
+#include "mapdocument.h"
+#include "maprenderer.h"
+#include "paintstatistics.h"
+#include "tilelayer.h"
+#include "tilelayeritem.h"
+#include "tilelayerglrenderer.h"
+
+#include <QStyleOptionGraphicsItem>
+#include <QtCore/qmath.h>
+
+using namespace Tiled;
+using namespace Tiled::Internal;
+
+namespace {
+
+// The amount of pixmap memory each composite may use for its cache, in KB
+const int MaxCacheCost = 32 * 1024;
+
+inline quint64 chunkKey(int x, int y)
+{
+    return (quint64(quint32(y)) << 32) | quint32(x);
+}
+
+} // anonymous namespace
+
+TileLayerCompositeItem::TileLayerCompositeItem(const QList<TileLayerItem*> &items)
+    : mItems(items)
+    , mChunks(CacheManager::LayerCompositeChunks, items.first()->mMapDocument,
+              MaxCacheCost, 1024)
+    , mCacheScale(0)
+    , mCacheRevisions(items.size())
+    , mCacheGenerations(items.size())
+    , mCacheOpacities(items.size())
+{
+    Q_ASSERT(!items.isEmpty());
+
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+
+    for (int i = 0; i < mItems.size(); ++i) {
+        mCacheRevisions[i] = mItems.at(i)->tileLayer()->revision();
+        mCacheGenerations[i] = mItems.at(i)->mCacheGeneration;
+        mCacheOpacities[i] = mItems.at(i)->tileLayer()->opacity();
+    }
+
+    syncWithLayerItems();
+}
+
+void TileLayerCompositeItem::syncWithLayerItems()
+{
+    prepareGeometryChange();
+
+    mBoundingRect = QRectF();
+    foreach (const TileLayerItem *item, mItems)
+        mBoundingRect |= item->boundingRect();
+}
+
+void TileLayerCompositeItem::repaintRegion(const QRegion &region)
+{
+    // When none of the layers changed, the region changed in another layer
+    bool changed = false;
+    QMargins margins;
+
+    for (int i = 0; i < mItems.size(); ++i) {
+        const TileLayer *layer = mItems.at(i)->tileLayer();
+        const unsigned revision = layer->revision();
+        if (revision != mCacheRevisions.at(i)) {
+            mCacheRevisions[i] = revision;
+            changed = true;
+        }
+
+        const QMargins m = layer->drawMargins();
+        margins = QMargins(qMax(margins.left(), m.left()),
+                           qMax(margins.top(), m.top()),
+                           qMax(margins.right(), m.right()),
+                           qMax(margins.bottom(), m.bottom()));
+    }
+
+    if (!changed)
+        return;
+
+    const TileLayerItem *first = mItems.first();
+    const MapRenderer *renderer = first->mMapDocument->renderer();
+
+    foreach (const QRect &r, region.rects()) {
+        const QRectF bounds = renderer->boundingRect(r).adjusted(-margins.left(),
+                                                                 -margins.top(),
+                                                                 margins.right(),
+                                                                 margins.bottom());
+        const QRect range = first->chunkRange(bounds);
+
+        for (int y = range.top(); y <= range.bottom(); ++y)
+            for (int x = range.left(); x <= range.right(); ++x)
+                mChunks.remove(chunkKey(x, y));
+    }
+}
+
+void TileLayerCompositeItem::repaintTiles(const QSet<Tile*> &tiles)
+{
+    QSet<quint64> chunks;
+    foreach (TileLayerItem *item, mItems)
+        chunks |= item->chunksShowing(tiles);
+
+    foreach (quint64 key, chunks) {
+        mChunks.remove(key);
+
+        const int x = qint32(quint32(key));
+        const int y = qint32(quint32(key >> 32));
+        update(mItems.first()->chunkRect(x, y) & mBoundingRect);
+    }
+}
+
+QRectF TileLayerCompositeItem::boundingRect() const
+{
+    return mBoundingRect;
+}
+
+void TileLayerCompositeItem::paint(QPainter *painter,
+                                   const QStyleOptionGraphicsItem *option,
+                                   QWidget *widget)
+{
+    syncCacheRevisions();
+
+    const QRectF exposed = option->exposedRect & mBoundingRect;
+    if (exposed.isEmpty())
+        return;
+
+    const qreal scale =
+            option->levelOfDetailFromTransform(painter->worldTransform());
+    const TileLayerItem *first = mItems.first();
+
+    bool drawLayers = !first->canCache(scale);
+#ifndef QT_NO_OPENGL
+    drawLayers |= TileLayerGLRenderer::canRender(painter);
+#endif
+
+    // Without a pixmap cache, there is nothing to gain from compositing
+    if (drawLayers) {
+        foreach (TileLayerItem *item, mItems) {
+            painter->save();
+            painter->setOpacity(painter->opacity() * item->tileLayer()->opacity());
+            item->paint(painter, option, widget);
+            painter->restore();
+        }
+        return;
+    }
+
+    if (scale != mCacheScale) {
+        mChunks.clear();
+        mCacheScale = scale;
+    }
+
+    const QRect range = first->chunkRange(exposed);
+
+    for (int y = range.top(); y <= range.bottom(); ++y) {
+        for (int x = range.left(); x <= range.right(); ++x) {
+            const QRectF rect = first->chunkRect(x, y);
+            const quint64 key = chunkKey(x, y);
+
+            if (const QPixmap *cached = mChunks.object(key)) {
+                painter->drawPixmap(rect, *cached, QRectF(cached->rect()));
+                continue;
+            }
+
+            const QPixmap pixmap = renderChunk(x, y, scale,
+                                               painter->renderHints());
+            painter->drawPixmap(rect, pixmap, QRectF(pixmap.rect()));
+
+            const int cost = pixmap.width() * pixmap.height() * 4 / 1024;
+            mChunks.insert(key, new QPixmap(pixmap), qMax(cost, 1));
+        }
+    }
+}
+
+/**
+ * Drops the whole cache when any of the layers has changed in ways that were
+ * not announced through repaintRegion(), when its opacity changed or when any
+ * of the layer items has dropped its own cache.
+ */
+void TileLayerCompositeItem::syncCacheRevisions()
+{
+    bool changed = false;
+
+    for (int i = 0; i < mItems.size(); ++i) {
+        TileLayerItem *item = mItems.at(i);
+        item->syncCacheRevision();
+
+        const unsigned revision = item->tileLayer()->revision();
+        const unsigned generation = item->mCacheGeneration;
+        const qreal opacity = item->tileLayer()->opacity();
+
+        if (revision != mCacheRevisions.at(i) ||
+                generation != mCacheGenerations.at(i) ||
+                opacity != mCacheOpacities.at(i)) {
+            mCacheRevisions[i] = revision;
+            mCacheGenerations[i] = generation;
+            mCacheOpacities[i] = opacity;
+            changed = true;
+        }
+    }
+
+    if (changed)
+        mChunks.clear();
+}
+
+/**
+ * Renders the chunk at \a x, \a y by drawing the cached chunks of each of
+ * the layers on top of each other.
+ */
+QPixmap TileLayerCompositeItem::renderChunk(int x, int y, qreal scale,
+                                            QPainter::RenderHints renderHints)
+{
+    const QRectF rect = mItems.first()->chunkRect(x, y);
+
+    QPixmap pixmap(qCeil(rect.width() * scale),
+                   qCeil(rect.height() * scale));
+    pixmap.fill(Qt::transparent);
+
+    QPainter painter(&pixmap);
+    painter.setRenderHints(renderHints);
+    painter.scale(pixmap.width() / rect.width(),
+                  pixmap.height() / rect.height());
+    painter.translate(-rect.topLeft());
+
+    foreach (TileLayerItem *item, mItems) {
+        if (!rect.intersects(item->boundingRect()))
+            continue;
+
+        LayerPaintTimer paintTimer(item->tileLayer());
+
+        item->setCacheScale(scale);
+        painter.setOpacity(item->tileLayer()->opacity());
+        item->drawCachedChunk(&painter, x, y, scale);
+    }
+
+    return pixmap;
+}
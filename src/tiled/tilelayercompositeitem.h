@@ -0,0 +1,109 @@
+/*
+ * tilelayercompositeitem.h
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TILELAYERCOMPOSITEITEM_H
+#define TILELAYERCOMPOSITEITEM_H
+
+#include "cachemanager.h"
+
+#include <QGraphicsItem>
+#include <QList>
+#include <QPainter>
+#include <QPixmap>
+#include <QSet>
+#include <QVector>
+
+namespace Tiled {
+
+class Tile;
+
+namespace Internal {
+
+class TileLayerItem;
+
+/**
+ * Displays a number of consecutive tile layers as a single item, caching
+ * the result of drawing them on top of each other.
+ *
+ * This is used while highlighting the current layer, for the layers below
+ * and above it. Edits to the current layer then only need to redraw the
+ * composites instead of each of the other layers. The layer items
+ * themselves are hidden while they are part of a composite.
+ */
+class TileLayerCompositeItem : public QGraphicsItem
+{
+public:
+    /**
+     * Constructor.
+     *
+     * @param items the items of the layers to be displayed, from bottom to
+     *              top
+     */
+    explicit TileLayerCompositeItem(const QList<TileLayerItem*> &items);
+
+    const QList<TileLayerItem*> &layerItems() const { return mItems; }
+
+    /**
+     * Updates the bounding rect of this item. Should be called when the
+     * bounding rect of any of the layer items may have changed.
+     */
+    void syncWithLayerItems();
+
+    /**
+     * Drops the cached rendering of the given \a region, in tile
+     * coordinates, if any of the layers has changed since the last time the
+     * cache was brought up to date.
+     */
+    void repaintRegion(const QRegion &region);
+
+    /**
+     * Drops the cached rendering of the chunks showing any of the given
+     * animated \a tiles and schedules them for repainting.
+     */
+    void repaintTiles(const QSet<Tile*> &tiles);
+
+    // QGraphicsItem
+    QRectF boundingRect() const;
+    void paint(QPainter *painter,
+               const QStyleOptionGraphicsItem *option,
+               QWidget *widget = 0);
+
+private:
+    void syncCacheRevisions();
+    QPixmap renderChunk(int x, int y, qreal scale,
+                        QPainter::RenderHints renderHints);
+
+    QList<TileLayerItem*> mItems;
+    QRectF mBoundingRect;
+
+    ManagedCache<quint64, QPixmap> mChunks;
+    qreal mCacheScale;
+
+    // The layer revisions, cache generations and opacities the cache is
+    // based on
+    QVector<unsigned> mCacheRevisions;
+    QVector<unsigned> mCacheGenerations;
+    QVector<qreal> mCacheOpacities;
+};
+
+} // namespace Internal
+} // namespace Tiled
+
+#endif // TILELAYERCOMPOSITEITEM_H
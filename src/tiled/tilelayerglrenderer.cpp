@@ -0,0 +1,698 @@
+/*
+ * tilelayerglrenderer.cpp
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tilelayerglrenderer.h"
+
+#ifndef QT_NO_OPENGL
+
+#include "mapdocument.h"
+#include "maprenderer.h"
+#include "tile.h"
+#include "tilelayer.h"
+#include "tileset.h"
+#include "tilesetmanager.h"
+
+#include <QGLContext>
+#include <QGLShaderProgram>
+#include <QMatrix4x4>
+#include <QPaintEngine>
+#include <QPainter>
+#include <QtCore/qmath.h>
+
+#include <climits>
+
+using namespace Tiled;
+using namespace Tiled::Internal;
+
+namespace {
+
+// The amount of vertex data each layer may keep around, in KB
+const int MaxBufferCost = 64 * 1024;
+
+// The size of the animation tables, which need to match the array sizes
+// and the loop count in the vertex shader
+const int MaxAnimations = 16;
+const int MaxFrames = 64;
+const int MaxAnimationFrames = 32;
+
+// Each animation is stored as its first frame, its frame count, its duration
+// and the offset of its time. Each frame is stored as the texture offset of
+// its image from the first frame and the time at which it ends.
+const char *vertexShader =
+        "attribute highp vec2 vertex;\n"
+        "attribute highp vec2 texCoord;\n"
+        "attribute highp float animation;\n"
+        "uniform highp mat4 matrix;\n"
+        "uniform highp float time;\n"
+        "uniform highp vec4 animations[16];\n"
+        "uniform highp vec4 frames[64];\n"
+        "varying highp vec2 uv;\n"
+        "void main() {\n"
+        "    highp vec2 offset = vec2(0.0, 0.0);\n"
+        "    if (animation >= 0.0) {\n"
+        "        highp vec4 a = animations[int(animation)];\n"
+        "        highp float t = mod(time + a.w, a.z);\n"
+        "        for (int i = 0; i < 32; ++i) {\n"
+        "            if (float(i) >= a.y)\n"
+        "                break;\n"
+        "            highp vec4 frame = frames[int(a.x) + i];\n"
+        "            offset = frame.xy;\n"
+        "            if (t < frame.z)\n"
+        "                break;\n"
+        "        }\n"
+        "    }\n"
+        "    uv = texCoord + offset;\n"
+        "    gl_Position = matrix * vec4(vertex, 0.0, 1.0);\n"
+        "}\n";
+
+const char *fragmentShader =
+        "uniform sampler2D tileImage;\n"
+        "uniform lowp float opacity;\n"
+        "varying highp vec2 uv;\n"
+        "void main() {\n"
+        "    gl_FragColor = texture2D(tileImage, uv) * opacity;\n"
+        "}\n";
+
+enum { VertexAttribute, TexCoordAttribute, AnimationAttribute };
+
+struct Vertex {
+    GLfloat x, y;
+    GLfloat u, v;
+    GLfloat animation;  // -1 when the quad is not animated
+};
+
+struct RecordedBatch {
+    QPixmap pixmap;
+    int first;
+    int count;
+};
+
+/**
+ * A paint engine that turns the pixmaps drawn to it into textured quads,
+ * clipped to the given rectangle. It only supports the axis-aligned
+ * transformations used for drawing tiles.
+ *
+ * While an animation is set, the quads drawn from its tileset image refer
+ * to it and have their texture coordinates moved to the first frame.
+ */
+class QuadRecorder : public QPaintEngine
+{
+public:
+    QuadRecorder(const QRectF &clipRect, bool insetSource)
+        : QPaintEngine(QPaintEngine::AllFeatures)
+        , mClipRect(clipRect)
+        , mInsetSource(insetSource)
+        , mAnimation(-1)
+        , mAnimationPixmapKey(0)
+        , mFellBack(false)
+    {}
+
+    bool begin(QPaintDevice *) { return true; }
+    bool end() { return true; }
+    Type type() const { return QPaintEngine::User; }
+
+    void updateState(const QPaintEngineState &state)
+    {
+        if (state.state() & QPaintEngine::DirtyTransform)
+            mTransform = state.transform();
+    }
+
+    void drawPixmap(const QRectF &r, const QPixmap &pm, const QRectF &sr);
+
+    /**
+     * Sets the \a animation the following quads belong to, when drawn from
+     * the pixmap with the given \a pixmapKey. The \a frameOffset is the
+     * texture offset of the frame being drawn from the first frame.
+     */
+    void setAnimation(int animation, qint64 pixmapKey,
+                      const QPointF &frameOffset)
+    {
+        mAnimation = animation;
+        mAnimationPixmapKey = pixmapKey;
+        mFrameOffset = frameOffset;
+        mFellBack = false;
+    }
+
+    /**
+     * Returns whether any quad was drawn from another pixmap since the
+     * animation was set, which happens for flipped tiles.
+     */
+    bool fellBack() const { return mFellBack; }
+
+    QVector<Vertex> vertices;
+    QVector<RecordedBatch> batches;
+
+private:
+    const QRectF mClipRect;
+    const bool mInsetSource;
+    QTransform mTransform;
+    int mAnimation;
+    qint64 mAnimationPixmapKey;
+    QPointF mFrameOffset;
+    bool mFellBack;
+};
+
+void QuadRecorder::drawPixmap(const QRectF &r, const QPixmap &pm,
+                              const QRectF &sr)
+{
+    if (pm.isNull() || r.isEmpty())
+        return;
+
+    const QRectF clipped = mTransform.mapRect(r) & mClipRect;
+    if (clipped.isEmpty())
+        return;
+
+    bool invertible;
+    const QTransform inverse = mTransform.inverted(&invertible);
+    if (!invertible)
+        return;
+
+    // Keep linear filtering from sampling the neighbouring tiles when the
+    // pixmap is a whole tileset image
+    QRectF source = sr;
+    if (mInsetSource)
+        source.adjust(0.5, 0.5, -0.5, -0.5);
+
+    const QPointF corners[4] = {
+        clipped.topLeft(), clipped.topRight(),
+        clipped.bottomRight(), clipped.bottomLeft()
+    };
+
+    const bool animated = mAnimation != -1 &&
+            pm.cacheKey() == mAnimationPixmapKey;
+    if (mAnimation != -1 && !animated)
+        mFellBack = true;
+
+    Vertex quad[4];
+    for (int i = 0; i < 4; ++i) {
+        const QPointF p = inverse.map(corners[i]);
+        const qreal sx = source.left() +
+                (p.x() - r.left()) / r.width() * source.width();
+        const qreal sy = source.top() +
+                (p.y() - r.top()) / r.height() * source.height();
+
+        quad[i].x = corners[i].x();
+        quad[i].y = corners[i].y();
+        quad[i].u = sx / pm.width();
+        quad[i].v = sy / pm.height();
+        quad[i].animation = animated ? mAnimation : -1;
+
+        if (animated) {
+            quad[i].u -= mFrameOffset.x();
+            quad[i].v -= mFrameOffset.y();
+        }
+    }
+
+    if (batches.isEmpty() || batches.last().pixmap.cacheKey() != pm.cacheKey()) {
+        RecordedBatch batch;
+        batch.pixmap = pm;
+        batch.first = vertices.size();
+        batch.count = 0;
+        batches.append(batch);
+    }
+
+    vertices << quad[0] << quad[1] << quad[2]
+             << quad[0] << quad[2] << quad[3];
+    batches.last().count += 6;
+}
+
+/**
+ * A paint device that has a QuadRecorder as its paint engine.
+ */
+class RecordingDevice : public QPaintDevice
+{
+public:
+    explicit RecordingDevice(QuadRecorder *engine)
+        : mEngine(engine)
+    {}
+
+    QPaintEngine *paintEngine() const { return mEngine; }
+
+protected:
+    int metric(PaintDeviceMetric metric) const
+    {
+        switch (metric) {
+        case PdmWidth:
+        case PdmHeight:
+        case PdmWidthMM:
+        case PdmHeightMM:
+            return 1 << 24;
+        case PdmNumColors:
+            return INT_MAX;
+        case PdmDepth:
+            return 32;
+        case PdmDpiX:
+        case PdmDpiY:
+        case PdmPhysicalDpiX:
+        case PdmPhysicalDpiY:
+            return 72;
+#if QT_VERSION >= 0x050000
+        case PdmDevicePixelRatio:
+            return 1;
+#endif
+        default:
+            return QPaintDevice::metric(metric);
+        }
+    }
+
+private:
+    QuadRecorder *mEngine;
+};
+
+} // anonymous namespace
+
+TileLayerGLRenderer::TileLayerGLRenderer(const TileLayer *layer,
+                                         MapDocument *mapDocument)
+    : mLayer(layer)
+    , mMapDocument(mapDocument)
+    , mChunks(MaxBufferCost)
+    , mAnimationsChanged(true)
+    , mTimeOrigin(0)
+    , mContext(0)
+    , mProgram(0)
+    , mProgramFailed(false)
+    , mSmooth(false)
+    , mPainter(0)
+{
+    resetAnimations();
+}
+
+TileLayerGLRenderer::~TileLayerGLRenderer()
+{
+    mChunks.clear();
+    delete mProgram;
+}
+
+bool TileLayerGLRenderer::canRender(QPainter *painter)
+{
+    const QPaintEngine *engine = painter->paintEngine();
+    if (!engine || engine->type() != QPaintEngine::OpenGL2)
+        return false;
+
+    const QGLContext *context = QGLContext::currentContext();
+    return context && QGLShaderProgram::hasOpenGLShaderPrograms(context);
+}
+
+bool TileLayerGLRenderer::begin(QPainter *painter, const QRectF &exposed)
+{
+    QGLContext *context = const_cast<QGLContext*>(QGLContext::currentContext());
+    if (context != mContext) {
+        // The viewport was recreated, which takes the buffers with it
+        clear();
+        delete mProgram;
+        mProgram = 0;
+        mProgramFailed = false;
+        mContext = context;
+    }
+
+    if (mProgramFailed)
+        return false;
+
+    // The tile coordinates of a chunk depend on the filtering
+    const bool smooth =
+            painter->testRenderHint(QPainter::SmoothPixmapTransform);
+    if (smooth != mSmooth) {
+        mChunks.clear();
+        mSmooth = smooth;
+    }
+
+    painter->beginNativePainting();
+
+    if (!mProgram) {
+        mProgram = new QGLShaderProgram(mContext);
+        mProgram->addShaderFromSourceCode(QGLShader::Vertex, vertexShader);
+        mProgram->addShaderFromSourceCode(QGLShader::Fragment, fragmentShader);
+        mProgram->bindAttributeLocation("vertex", VertexAttribute);
+        mProgram->bindAttributeLocation("texCoord", TexCoordAttribute);
+        mProgram->bindAttributeLocation("animation", AnimationAttribute);
+
+        mAnimationsChanged = true;
+
+        if (!mProgram->link()) {
+            qWarning("Failed to link tile layer shader program: %s",
+                     qPrintable(mProgram->log()));
+            delete mProgram;
+            mProgram = 0;
+            mProgramFailed = true;
+            painter->endNativePainting();
+            return false;
+        }
+    }
+
+    const QPaintDevice *device = painter->device();
+    const QTransform transform = painter->combinedTransform();
+
+    QMatrix4x4 projection;
+    projection.ortho(0, device->width(), device->height(), 0, -1, 1);
+
+    mProgram->bind();
+    mProgram->setUniformValue("matrix", projection * QMatrix4x4(transform));
+    mProgram->setUniformValue("opacity", GLfloat(painter->opacity()));
+    mProgram->setUniformValue("tileImage", 0);
+    mProgram->setUniformValue("time",
+                              GLfloat(TilesetManager::instance()->animationTime() -
+                                      mTimeOrigin));
+    uploadAnimations();
+    mProgram->enableAttributeArray(VertexAttribute);
+    mProgram->enableAttributeArray(TexCoordAttribute);
+    mProgram->enableAttributeArray(AnimationAttribute);
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+    // Native painting is not clipped, so restrict it to the exposed area
+    int ratio = 1;
+#if QT_VERSION >= 0x050000
+    ratio = device->devicePixelRatio();
+#endif
+    const QRect clip = transform.mapRect(exposed).toAlignedRect()
+            & QRect(0, 0, device->width(), device->height());
+
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(clip.x() * ratio,
+              (device->height() - clip.y() - clip.height()) * ratio,
+              clip.width() * ratio,
+              clip.height() * ratio);
+
+    mPainter = painter;
+    return true;
+}
+
+void TileLayerGLRenderer::drawChunk(quint64 key, const QRectF &rect)
+{
+    Q_ASSERT(mPainter);
+
+    Chunk *chunk = mChunks.object(key);
+    if (!chunk) {
+        chunk = createChunk(rect);
+
+        const int cost = chunk->buffer.isCreated() ? chunk->buffer.size() / 1024
+                                                   : 0;
+        if (!mChunks.insert(key, chunk, qMax(cost, 1)))
+            return;
+
+        // The chunk may have added animations
+        uploadAnimations();
+    }
+
+    if (chunk->batches.isEmpty())
+        return;
+
+    const GLint filter = mSmooth ? GL_LINEAR : GL_NEAREST;
+
+    chunk->buffer.bind();
+    mProgram->setAttributeBuffer(VertexAttribute, GL_FLOAT,
+                                 0, 2, sizeof(Vertex));
+    mProgram->setAttributeBuffer(TexCoordAttribute, GL_FLOAT,
+                                 2 * sizeof(GLfloat), 2, sizeof(Vertex));
+    mProgram->setAttributeBuffer(AnimationAttribute, GL_FLOAT,
+                                 4 * sizeof(GLfloat), 1, sizeof(Vertex));
+
+    foreach (const Batch &batch, chunk->batches) {
+        mContext->bindTexture(batch.pixmap, GL_TEXTURE_2D, GL_RGBA,
+                              QGLContext::PremultipliedAlphaBindOption);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+        glDrawArrays(GL_TRIANGLES, batch.first, batch.count);
+    }
+
+    chunk->buffer.release();
+}
+
+void TileLayerGLRenderer::end()
+{
+    Q_ASSERT(mPainter);
+
+    mProgram->disableAttributeArray(VertexAttribute);
+    mProgram->disableAttributeArray(TexCoordAttribute);
+    mProgram->disableAttributeArray(AnimationAttribute);
+    mProgram->release();
+
+    glDisable(GL_SCISSOR_TEST);
+
+    mPainter->endNativePainting();
+    mPainter = 0;
+}
+
+bool TileLayerGLRenderer::animatesTiles(quint64 key, const QSet<Tile*> &tiles)
+{
+    const Chunk *chunk = mChunks.object(key);
+    if (!chunk || chunk->frameTiles.isEmpty())
+        return true;
+
+    foreach (Tile *tile, tiles)
+        if (chunk->frameTiles.contains(tile))
+            return false;
+
+    return true;
+}
+
+void TileLayerGLRenderer::removeChunk(quint64 key)
+{
+    mChunks.remove(key);
+}
+
+void TileLayerGLRenderer::clear()
+{
+    mChunks.clear();
+    resetAnimations();
+}
+
+/**
+ * Forgets the animations. Only done along with removing all chunks, since
+ * they refer to the animations by index.
+ */
+void TileLayerGLRenderer::resetAnimations()
+{
+    mAnimationIndexes.clear();
+    mAnimations.clear();
+    mFrames.clear();
+    mAnimationsChanged = true;
+    mTimeOrigin = TilesetManager::instance()->animationTime();
+}
+
+/**
+ * Sets the animation tables on the bound shader program when they changed.
+ */
+void TileLayerGLRenderer::uploadAnimations()
+{
+    if (!mAnimationsChanged)
+        return;
+
+    if (!mAnimations.isEmpty()) {
+        mProgram->setUniformValueArray("animations", mAnimations.constData(),
+                                       mAnimations.size());
+        mProgram->setUniformValueArray("frames", mFrames.constData(),
+                                       mFrames.size());
+    }
+
+    mAnimationsChanged = false;
+}
+
+/**
+ * Returns the index of the animation of \a tile in the animation tables,
+ * adding it when necessary. Returns -1 when the shader can't animate this
+ * tile, because its frames are not all part of one tileset image, one of
+ * them has no duration or the tables are full.
+ */
+int TileLayerGLRenderer::animationIndex(Tile *tile)
+{
+    QHash<Tile*, int>::const_iterator it = mAnimationIndexes.constFind(tile);
+    if (it != mAnimationIndexes.constEnd())
+        return it.value();
+
+    const Tileset *tileset = tile->tileset();
+    const QVector<Frame> &frames = tile->frames();
+    const QSize imageSize = tileset->image().size();
+
+    bool usable = !imageSize.isEmpty() &&
+            frames.size() <= MaxAnimationFrames &&
+            mAnimations.size() < MaxAnimations &&
+            mFrames.size() + frames.size() <= MaxFrames;
+
+    QVector<QVector4D> frameData;
+    int duration = 0;
+
+    for (int i = 0; usable && i < frames.size(); ++i) {
+        const Frame &frame = frames.at(i);
+        const QRect rect = tileset->imageRect(frame.tileId);
+        if (frame.duration <= 0 || rect.isNull()) {
+            usable = false;
+            break;
+        }
+
+        duration += frame.duration;
+        frameData.append(QVector4D(qreal(rect.x()) / imageSize.width(),
+                                   qreal(rect.y()) / imageSize.height(),
+                                   duration, 0));
+    }
+
+    int index = -1;
+
+    if (usable && duration > 0) {
+        // Chosen so that the shader shows the frame the tile is at now, after
+        // which both advance by the same time
+        const qint64 time = TilesetManager::instance()->animationTime() - mTimeOrigin;
+        const qint64 offset = ((tile->animationTime() - time) % duration + duration) % duration;
+
+        index = mAnimations.size();
+        mAnimations.append(QVector4D(mFrames.size(), frames.size(),
+                                     duration, offset));
+        mFrames += frameData;
+        mAnimationsChanged = true;
+    }
+
+    mAnimationIndexes.insert(tile, index);
+    return index;
+}
+
+/**
+ * Returns the cells of the layer, in layer coordinates, that may be drawn
+ * within \a rect.
+ */
+QRect TileLayerGLRenderer::cellRange(const QRectF &rect) const
+{
+    const MapRenderer *renderer = mMapDocument->renderer();
+    const QMargins margins = mLayer->drawMargins();
+    const int margin = qMax(qMax(margins.left(), margins.right()),
+                            qMax(margins.top(), margins.bottom()));
+    const QRectF area = rect.adjusted(-margin, -margin, margin, margin);
+
+    QPolygonF corners;
+    corners << renderer->screenToTileCoords(area.topLeft())
+            << renderer->screenToTileCoords(area.topRight())
+            << renderer->screenToTileCoords(area.bottomRight())
+            << renderer->screenToTileCoords(area.bottomLeft());
+    const QRectF bounds = corners.boundingRect();
+
+    // Leave some room for the staggered orientations
+    const QRect range(QPoint(qFloor(bounds.left()) - 2,
+                             qFloor(bounds.top()) - 2),
+                      QPoint(qFloor(bounds.right()) + 2,
+                             qFloor(bounds.bottom()) + 2));
+
+    return range.translated(-mLayer->position()) &
+            QRect(0, 0, mLayer->width(), mLayer->height());
+}
+
+/**
+ * Records the tiles within \a rect by letting the map renderer draw them,
+ * and uploads the resulting quads to a new vertex buffer.
+ */
+TileLayerGLRenderer::Chunk *TileLayerGLRenderer::createChunk(const QRectF &rect)
+{
+    QuadRecorder recorder(rect, mSmooth);
+    RecordingDevice device(&recorder);
+    MapRenderer *renderer = mMapDocument->renderer();
+
+    bool usesAnimations = false;
+    foreach (const Tileset *tileset, mLayer->usedTilesets())
+        if (!tileset->animatedTiles().isEmpty())
+            usesAnimations = true;
+
+    // The cells around the chunk, with the position they have in the map
+    TileLayer *part = 0;
+    QList<Tile*> animatedTiles;
+    QSet<Tile*> frameTiles;
+
+    if (usesAnimations) {
+        const QRect range = cellRange(rect);
+        if (!range.isEmpty()) {
+            part = mLayer->copy(range);
+            part->setPosition(mLayer->position() + range.topLeft());
+
+            foreach (Tile *tile, part->tileUsage().keys()) {
+                if (!tile->isAnimated())
+                    continue;
+                if (animationIndex(tile) != -1)
+                    animatedTiles.append(tile);
+                else
+                    frameTiles.insert(tile);
+            }
+        }
+    }
+
+    QPainter painter(&device);
+
+    if (animatedTiles.isEmpty()) {
+        renderer->drawTileLayer(&painter, mLayer, rect);
+    } else {
+        // The cells of each animated tile are recorded on their own, so that
+        // their quads can be told apart. They end up on top of the others.
+        QList<TileLayer*> tileLayers;
+        foreach (Tile *tile, animatedTiles) {
+            const QRegion region = part->tileRegion(QList<Tile*>() << tile);
+            TileLayer *tileLayer = part->copy(region);
+            tileLayer->setPosition(part->position() +
+                                   region.boundingRect().topLeft());
+            tileLayers.append(tileLayer);
+        }
+
+        part->erase(part->tileRegion(animatedTiles));
+        renderer->drawTileLayer(&painter, part, rect);
+
+        for (int i = 0; i < animatedTiles.size(); ++i) {
+            Tile *tile = animatedTiles.at(i);
+            const int index = mAnimationIndexes.value(tile);
+            const int first = int(mAnimations.at(index).x());
+            const QVector4D &frame = mFrames.at(first + tile->currentFrameIndex());
+
+            recorder.setAnimation(index, tile->tileset()->image().cacheKey(),
+                                  QPointF(frame.x(), frame.y()));
+            renderer->drawTileLayer(&painter, tileLayers.at(i), rect);
+
+            // Flipped cells are drawn from another pixmap, and show the
+            // current frame
+            if (recorder.fellBack())
+                frameTiles.insert(tile);
+        }
+
+        qDeleteAll(tileLayers);
+    }
+
+    painter.end();
+    delete part;
+
+    Chunk *chunk = new Chunk;
+    chunk->frameTiles = frameTiles;
+    if (recorder.vertices.isEmpty())
+        return chunk;
+
+    chunk->buffer.setUsagePattern(QGLBuffer::StaticDraw);
+    if (!chunk->buffer.create())
+        return chunk;
+
+    chunk->buffer.bind();
+    chunk->buffer.allocate(recorder.vertices.constData(),
+                           recorder.vertices.size() * sizeof(Vertex));
+    chunk->buffer.release();
+
+    foreach (const RecordedBatch &recorded, recorder.batches) {
+        Batch batch;
+        batch.pixmap = recorded.pixmap;
+        batch.first = recorded.first;
+        batch.count = recorded.count;
+        chunk->batches.append(batch);
+    }
+
+    return chunk;
+}
+
+#endif // QT_NO_OPENGL
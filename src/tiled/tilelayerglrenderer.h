@@ -0,0 +1,151 @@
+/*
+ * tilelayerglrenderer.h
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TILELAYERGLRENDERER_H
+#define TILELAYERGLRENDERER_H
+
+#ifndef QT_NO_OPENGL
+
+#include <QCache>
+#include <QGLBuffer>
+#include <QHash>
+#include <QPixmap>
+#include <QRectF>
+#include <QSet>
+#include <QVector>
+#include <QVector4D>
+
+class QGLContext;
+class QGLShaderProgram;
+class QPainter;
+
+namespace Tiled {
+
+class Tile;
+class TileLayer;
+
+namespace Internal {
+
+class MapDocument;
+
+/**
+ * Renders a tile layer through OpenGL from vertex buffers.
+ *
+ * The geometry of the tiles is recorded per chunk of the layer by having the
+ * map renderer draw the chunk to a recording paint device. This way the
+ * drawing order and positioning logic of each map orientation is reused.
+ * The resulting quads are uploaded to a vertex buffer once, and drawn with
+ * one call for each source pixmap until the chunk is removed.
+ *
+ * Animated tiles from tilesets based on a single image are animated by the
+ * shader. Their frames are kept in a table of texture offsets, from which
+ * the current frame is chosen based on the animation time, so that chunks
+ * showing them don't need to be recorded again when their frame changes.
+ */
+class TileLayerGLRenderer
+{
+public:
+    TileLayerGLRenderer(const TileLayer *layer, MapDocument *mapDocument);
+    ~TileLayerGLRenderer();
+
+    /**
+     * Returns whether the given \a painter paints through an OpenGL context
+     * that supports the shader programs used by this renderer.
+     */
+    static bool canRender(QPainter *painter);
+
+    /**
+     * Switches the \a painter to native painting and sets up the shader
+     * program for drawing the \a exposed area. Returns false when the
+     * program could not be created, in which case nothing should be drawn.
+     */
+    bool begin(QPainter *painter, const QRectF &exposed);
+
+    /**
+     * Draws the chunk with the given \a key, covering \a rect in scene
+     * coordinates. Its vertex buffer is created when necessary.
+     */
+    void drawChunk(quint64 key, const QRectF &rect);
+
+    /**
+     * Ends the native painting started by begin().
+     */
+    void end();
+
+    /**
+     * Returns whether the chunk with the given \a key shows all of the given
+     * animated \a tiles through the shader, in which case it doesn't need to
+     * be removed when their frames change.
+     */
+    bool animatesTiles(quint64 key, const QSet<Tile*> &tiles);
+
+    void removeChunk(quint64 key);
+    void clear();
+
+private:
+    struct Batch {
+        QPixmap pixmap;
+        int first;
+        int count;
+    };
+
+    struct Chunk {
+        Chunk() : buffer(QGLBuffer::VertexBuffer) {}
+
+        QGLBuffer buffer;
+        QVector<Batch> batches;
+
+        // Animated tiles drawn at their current frame
+        QSet<Tile*> frameTiles;
+    };
+
+    Chunk *createChunk(const QRectF &rect);
+    QRect cellRange(const QRectF &rect) const;
+    int animationIndex(Tile *tile);
+    void resetAnimations();
+    void uploadAnimations();
+
+    const TileLayer *mLayer;
+    MapDocument *mMapDocument;
+    QCache<quint64, Chunk> mChunks;
+
+    // The animations used by the chunks, and the texture offsets and end
+    // times of their frames
+    QHash<Tile*, int> mAnimationIndexes;
+    QVector<QVector4D> mAnimations;
+    QVector<QVector4D> mFrames;
+    bool mAnimationsChanged;
+    qint64 mTimeOrigin;
+
+    QGLContext *mContext;
+    QGLShaderProgram *mProgram;
+    bool mProgramFailed;
+    bool mSmooth;
+    QPainter *mPainter;
+
+    Q_DISABLE_COPY(TileLayerGLRenderer)
+};
+
+} // namespace Internal
+} // namespace Tiled
+
+#endif // QT_NO_OPENGL
+
+#endif // TILELAYERGLRENDERER_H
@@ -25,16 +25,101 @@
 #include "map.h"
 #include "mapdocument.h"
 #include "maprenderer.h"
+#include "paintstatistics.h"
+#include "tilelayerglrenderer.h"
+#include "tilelayerprefetcher.h"
 
+#include <QMap>
 #include <QPainter>
 #include <QStyleOptionGraphicsItem>
+#include <QtCore/qmath.h>
 
 using namespace Tiled;
 using namespace Tiled::Internal;
 
+namespace {
+
+// The width and height of a cached chunk, in tiles
+const int ChunkTiles = 32;
+
+// Chunks that would be larger than this, in pixels, are not cached. When
+// zoomed in this far few tiles are visible and drawing them is cheap.
+const int MaxChunkPixels = 2048;
+
+// The amount of pixmap memory each layer may use for its cache, in KB
+const int MaxCacheCost = 32 * 1024;
+
+// The number of chunks each layer renders ahead at a time
+const int MaxPrefetchChunks = 16;
+
+inline quint64 chunkKey(int x, int y)
+{
+    return (quint64(quint32(y)) << 32) | quint32(x);
+}
+
+} // anonymous namespace
+
+namespace Tiled {
+namespace Internal {
+
+/**
+ * Displays one chunk of a tile layer, when the TileLayerItem is split into
+ * chunk items. The bounding rect only covers the occupied part of the
+ * chunk, and the painting is left to the TileLayerItem.
+ */
+class TileLayerChunkItem : public QGraphicsItem
+{
+public:
+    TileLayerChunkItem(int x, int y, TileLayerItem *parent)
+        : QGraphicsItem(parent)
+        , mLayerItem(parent)
+        , mX(x)
+        , mY(y)
+    {
+        setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+    }
+
+    void setBoundingRect(const QRectF &rect)
+    {
+        if (mBoundingRect == rect)
+            return;
+
+        prepareGeometryChange();
+        mBoundingRect = rect;
+    }
+
+    QRectF boundingRect() const { return mBoundingRect; }
+
+    void paint(QPainter *painter,
+               const QStyleOptionGraphicsItem *option,
+               QWidget *)
+    {
+        mLayerItem->paintChunk(painter, option, mX, mY);
+    }
+
+private:
+    TileLayerItem *mLayerItem;
+    const int mX;
+    const int mY;
+    QRectF mBoundingRect;
+};
+
+} // namespace Internal
+} // namespace Tiled
+
 TileLayerItem::TileLayerItem(TileLayer *layer, MapDocument *mapDocument)
     : mLayer(layer)
     , mMapDocument(mapDocument)
+    , mChunks(CacheManager::TileLayerChunks, mapDocument, MaxCacheCost, 1024)
+    , mCacheScale(0)
+    , mCacheRevision(0)
+    , mCacheGeneration(0)
+    , mAnimatedChunksRevision(0)
+    , mUseChunkItems(false)
+    , mPrefetcher(0)
+#ifndef QT_NO_OPENGL
+    , mGLRenderer(0)
+#endif
 {
     setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
 
@@ -42,6 +127,14 @@ TileLayerItem::TileLayerItem(TileLayer *layer, MapDocument *mapDocument)
     setOpacity(mLayer->opacity());
 }
 
+TileLayerItem::~TileLayerItem()
+{
+    delete mPrefetcher;
+#ifndef QT_NO_OPENGL
+    delete mGLRenderer;
+#endif
+}
+
 void TileLayerItem::syncWithTileLayer()
 {
     prepareGeometryChange();
@@ -59,6 +152,96 @@ void TileLayerItem::syncWithTileLayer()
                                           -margins.top(),
                                           margins.right(),
                                           margins.bottom());
+
+    // The map size, orientation or tile offsets may have changed
+    invalidateCache();
+
+    if (mUseChunkItems)
+        rebuildChunkItems();
+}
+
+void TileLayerItem::setUseChunkItems(bool useChunkItems)
+{
+    if (mUseChunkItems == useChunkItems)
+        return;
+
+    mUseChunkItems = useChunkItems;
+    setFlag(QGraphicsItem::ItemHasNoContents, useChunkItems);
+
+    if (useChunkItems) {
+        rebuildChunkItems();
+    } else {
+        qDeleteAll(mChunkItems);
+        mChunkItems.clear();
+        update();
+    }
+}
+
+void TileLayerItem::repaintRegion(const QRegion &region)
+{
+    // When this layer did not change, the region changed in another layer
+    const unsigned revision = mLayer->revision();
+    if (revision == mCacheRevision)
+        return;
+
+    mCacheRevision = revision;
+
+    const MapRenderer *renderer = mMapDocument->renderer();
+
+    foreach (const QRect &r, region.rects()) {
+        // Only the tiles in the chunks around the changed area matter
+        const QMargins margins =
+                mLayer->drawMargins(r.translated(-mLayer->position()));
+        const QRectF bounds = renderer->boundingRect(r).adjusted(-margins.left(),
+                                                                 -margins.top(),
+                                                                 margins.right(),
+                                                                 margins.bottom());
+        const QRect range = chunkRange(bounds);
+
+        for (int y = range.top(); y <= range.bottom(); ++y) {
+            for (int x = range.left(); x <= range.right(); ++x) {
+                mChunks.remove(chunkKey(x, y));
+#ifndef QT_NO_OPENGL
+                if (mGLRenderer)
+                    mGLRenderer->removeChunk(chunkKey(x, y));
+#endif
+            }
+        }
+
+        // Cells may have been filled or cleared
+        if (mUseChunkItems)
+            updateChunkItems(range);
+    }
+}
+
+void TileLayerItem::repaintTiles(const QSet<Tile*> &tiles)
+{
+    foreach (quint64 key, chunksShowing(tiles)) {
+        mChunks.remove(key);
+#ifndef QT_NO_OPENGL
+        // Chunks that animate these tiles in the shader only need a repaint
+        if (mGLRenderer && !mGLRenderer->animatesTiles(key, tiles))
+            mGLRenderer->removeChunk(key);
+#endif
+        if (TileLayerChunkItem *item = mChunkItems.value(key)) {
+            item->update();
+        } else if (!mUseChunkItems) {
+            const int x = qint32(quint32(key));
+            const int y = qint32(quint32(key >> 32));
+            update(chunkRect(x, y) & mBoundingRect);
+        }
+    }
+}
+
+void TileLayerItem::invalidateCache()
+{
+    mChunks.clear();
+    ++mCacheGeneration;
+    mAnimatedChunksRevision = 0;
+#ifndef QT_NO_OPENGL
+    if (mGLRenderer)
+        mGLRenderer->clear();
+#endif
 }
 
 QRectF TileLayerItem::boundingRect() const
@@ -70,7 +253,443 @@ void TileLayerItem::paint(QPainter *painter,
                           const QStyleOptionGraphicsItem *option,
                           QWidget *)
 {
-    MapRenderer *renderer = mMapDocument->renderer();
     // TODO: Display a border around the layer when selected
-    renderer->drawTileLayer(painter, mLayer, option->exposedRect);
+
+    LayerPaintTimer paintTimer(mLayer);
+
+    syncCacheRevision();
+
+    const QRectF exposed = option->exposedRect & mBoundingRect;
+    if (exposed.isEmpty())
+        return;
+
+#ifndef QT_NO_OPENGL
+    if (TileLayerGLRenderer::canRender(painter)) {
+        if (!mGLRenderer)
+            mGLRenderer = new TileLayerGLRenderer(mLayer, mMapDocument);
+
+        if (mGLRenderer->begin(painter, exposed)) {
+            const QRect range = chunkRange(exposed);
+
+            for (int y = range.top(); y <= range.bottom(); ++y)
+                for (int x = range.left(); x <= range.right(); ++x)
+                    mGLRenderer->drawChunk(chunkKey(x, y), chunkRect(x, y));
+
+            mGLRenderer->end();
+            return;
+        }
+    }
+#endif
+
+    const qreal scale =
+            option->levelOfDetailFromTransform(painter->worldTransform());
+
+    if (!canCache(scale)) {
+        MapRenderer *renderer = mMapDocument->renderer();
+        renderer->drawTileLayer(painter, mLayer, option->exposedRect);
+        return;
+    }
+
+    setCacheScale(scale);
+
+    const QRect range = chunkRange(exposed);
+
+    for (int y = range.top(); y <= range.bottom(); ++y)
+        for (int x = range.left(); x <= range.right(); ++x)
+            drawCachedChunk(painter, x, y, scale);
+}
+
+/**
+ * Paints the chunk at \a x, \a y on behalf of its chunk item.
+ */
+void TileLayerItem::paintChunk(QPainter *painter,
+                               const QStyleOptionGraphicsItem *option,
+                               int x, int y)
+{
+    LayerPaintTimer paintTimer(mLayer);
+
+    syncCacheRevision();
+
+    const QRectF rect = chunkRect(x, y);
+    const QRectF exposed = option->exposedRect & rect & mBoundingRect;
+    if (exposed.isEmpty())
+        return;
+
+#ifndef QT_NO_OPENGL
+    if (TileLayerGLRenderer::canRender(painter)) {
+        if (!mGLRenderer)
+            mGLRenderer = new TileLayerGLRenderer(mLayer, mMapDocument);
+
+        if (mGLRenderer->begin(painter, exposed)) {
+            mGLRenderer->drawChunk(chunkKey(x, y), rect);
+            mGLRenderer->end();
+            return;
+        }
+    }
+#endif
+
+    const qreal scale =
+            option->levelOfDetailFromTransform(painter->worldTransform());
+
+    if (!canCache(scale)) {
+        // Tiles overlapping the neighbouring chunks are drawn by those too
+        painter->save();
+        painter->setClipRect(rect, Qt::IntersectClip);
+        mMapDocument->renderer()->drawTileLayer(painter, mLayer, exposed);
+        painter->restore();
+        return;
+    }
+
+    setCacheScale(scale);
+    drawCachedChunk(painter, x, y, scale);
+}
+
+/**
+ * Drops the whole cache when the layer has changed in ways that were not
+ * announced through repaintRegion().
+ */
+void TileLayerItem::syncCacheRevision()
+{
+    const unsigned revision = mLayer->revision();
+    if (revision != mCacheRevision) {
+        invalidateCache();
+        mCacheRevision = revision;
+    }
+}
+
+/**
+ * Drops the cached chunks when they were rendered at a different scale.
+ */
+void TileLayerItem::setCacheScale(qreal scale)
+{
+    if (scale != mCacheScale) {
+        mChunks.clear();
+        mCacheScale = scale;
+    }
+}
+
+/**
+ * Returns whether the chunks are cached when painting at \a scale.
+ */
+bool TileLayerItem::canCache(qreal scale) const
+{
+    const QSizeF size = chunkSize();
+    return size.width() * scale <= MaxChunkPixels &&
+            size.height() * scale <= MaxChunkPixels;
+}
+
+/**
+ * Returns the chunks showing any of the given animated \a tiles.
+ */
+QSet<quint64> TileLayerItem::chunksShowing(const QSet<Tile*> &tiles)
+{
+    if (mAnimatedChunksRevision != mLayer->revision())
+        updateAnimatedChunks();
+
+    QSet<quint64> chunks;
+    if (mAnimatedChunks.isEmpty())
+        return chunks;
+
+    foreach (Tile *tile, tiles) {
+        QHash<Tile*, QVector<quint64> >::const_iterator it =
+                mAnimatedChunks.find(tile);
+        if (it != mAnimatedChunks.end())
+            foreach (quint64 key, it.value())
+                chunks.insert(key);
+    }
+
+    return chunks;
+}
+
+/**
+ * Draws the chunk at \a x, \a y from the cache, rendering it first when
+ * it isn't cached yet.
+ */
+void TileLayerItem::drawCachedChunk(QPainter *painter, int x, int y,
+                                    qreal scale)
+{
+    const QRectF rect = chunkRect(x, y);
+    const quint64 key = chunkKey(x, y);
+
+    if (const QPixmap *cached = mChunks.object(key)) {
+        painter->drawPixmap(rect, *cached, QRectF(cached->rect()));
+        return;
+    }
+
+    const QPixmap pixmap = renderChunk(rect, scale, painter->renderHints());
+    painter->drawPixmap(rect, pixmap, QRectF(pixmap.rect()));
+
+    const int cost = pixmap.width() * pixmap.height() * 4 / 1024;
+    mChunks.insert(key, new QPixmap(pixmap), qMax(cost, 1));
+}
+
+void TileLayerItem::prefetch(const QRectF &rect, qreal scale,
+                             QPainter::RenderHints renderHints)
+{
+    // When the layer changed, the chunks are dropped on the next paint
+    if (scale != mCacheScale || mLayer->revision() != mCacheRevision)
+        return;
+    if (!canCache(scale))
+        return;
+
+    if (!mPrefetcher)
+        mPrefetcher = new TileLayerPrefetcher(this);
+    else if (mPrefetcher->isBusy())
+        return;
+
+    const QRectF area = rect & mBoundingRect;
+    if (area.isEmpty())
+        return;
+
+    // The chunks closest to the center of the area are rendered first
+    QMap<qreal, QPoint> missing;
+    const QRect range = chunkRange(area);
+    for (int y = range.top(); y <= range.bottom(); ++y) {
+        for (int x = range.left(); x <= range.right(); ++x) {
+            if (mChunks.contains(chunkKey(x, y)))
+                continue;
+
+            const QPointF offset = chunkRect(x, y).center() - area.center();
+            missing.insertMulti(offset.x() * offset.x() +
+                                offset.y() * offset.y(), QPoint(x, y));
+        }
+    }
+
+    QVector<quint64> keys;
+    QVector<QRectF> rects;
+
+    QMap<qreal, QPoint>::const_iterator it = missing.constBegin();
+    for (; it != missing.constEnd() && keys.size() < MaxPrefetchChunks; ++it) {
+        const QPoint &chunk = it.value();
+        keys.append(chunkKey(chunk.x(), chunk.y()));
+        rects.append(chunkRect(chunk.x(), chunk.y()));
+    }
+
+    mPrefetcher->start(keys, rects, scale, renderHints);
+}
+
+/**
+ * Adds a chunk rendered by the prefetcher to the cache, unless the layer or
+ * the scale changed since it started rendering.
+ */
+void TileLayerItem::chunkPrefetched(quint64 key, const QPixmap &pixmap,
+                                    qreal scale, unsigned revision,
+                                    unsigned generation)
+{
+    if (scale != mCacheScale || generation != mCacheGeneration)
+        return;
+    if (revision != mLayer->revision() || mChunks.contains(key))
+        return;
+
+    const int cost = pixmap.width() * pixmap.height() * 4 / 1024;
+    mChunks.insert(key, new QPixmap(pixmap), qMax(cost, 1));
+}
+
+QSizeF TileLayerItem::chunkSize() const
+{
+    const Map *map = mMapDocument->map();
+    return QSizeF(map->tileWidth() * ChunkTiles,
+                  map->tileHeight() * ChunkTiles);
+}
+
+/**
+ * Returns the scene area covered by the chunk at \a x, \a y.
+ */
+QRectF TileLayerItem::chunkRect(int x, int y) const
+{
+    const QSizeF size = chunkSize();
+    return QRectF(QPointF(x * size.width(), y * size.height()), size);
+}
+
+/**
+ * Returns the range of chunks overlapping \a rect, in scene coordinates.
+ */
+QRect TileLayerItem::chunkRange(const QRectF &rect) const
+{
+    const QSizeF size = chunkSize();
+    return QRect(QPoint(qFloor(rect.left() / size.width()),
+                        qFloor(rect.top() / size.height())),
+                 QPoint(qFloor(rect.right() / size.width()),
+                        qFloor(rect.bottom() / size.height())));
+}
+
+/**
+ * Finds the chunks in which each of the animated tiles of this layer is
+ * displayed.
+ */
+void TileLayerItem::updateAnimatedChunks()
+{
+    mAnimatedChunks.clear();
+    mAnimatedChunksRevision = mLayer->revision();
+
+    QHash<Tile*, QSet<quint64> > chunks;
+
+    for (int y = 0; y < mLayer->height(); ++y) {
+        for (int x = 0; x < mLayer->width(); ++x) {
+            Tile *tile = mLayer->cellAt(x, y).tile;
+            if (!tile || !tile->isAnimated())
+                continue;
+
+            const QRect range = chunkRange(cellBounds(x, y));
+            QSet<quint64> &tileChunks = chunks[tile];
+
+            for (int cy = range.top(); cy <= range.bottom(); ++cy)
+                for (int cx = range.left(); cx <= range.right(); ++cx)
+                    tileChunks.insert(chunkKey(cx, cy));
+        }
+    }
+
+    QHash<Tile*, QSet<quint64> >::const_iterator it = chunks.constBegin();
+    for (; it != chunks.constEnd(); ++it)
+        mAnimatedChunks.insert(it.key(), it.value().toList().toVector());
+}
+
+/**
+ * Renders the part of the layer within \a rect, which is in scene
+ * coordinates, to a pixmap at the given \a scale.
+ */
+QPixmap TileLayerItem::renderChunk(const QRectF &rect, qreal scale,
+                                   QPainter::RenderHints renderHints) const
+{
+    QPixmap pixmap(qCeil(rect.width() * scale),
+                   qCeil(rect.height() * scale));
+    pixmap.fill(Qt::transparent);
+
+    QPainter painter(&pixmap);
+    painter.setRenderHints(renderHints);
+    painter.scale(pixmap.width() / rect.width(),
+                  pixmap.height() / rect.height());
+    painter.translate(-rect.topLeft());
+
+    mMapDocument->renderer()->drawTileLayer(&painter, mLayer,
+                                            rect & mBoundingRect);
+    return pixmap;
+}
+
+/**
+ * Returns the scene area in which the cell at \a x, \a y, in layer
+ * coordinates, may be drawn.
+ */
+QRectF TileLayerItem::cellBounds(int x, int y) const
+{
+    const MapRenderer *renderer = mMapDocument->renderer();
+    const QMargins margins = mLayer->drawMargins(QRect(x, y, 1, 1));
+    const QRect tileRect(mLayer->x() + x, mLayer->y() + y, 1, 1);
+
+    return renderer->boundingRect(tileRect).adjusted(-margins.left(),
+                                                     -margins.top(),
+                                                     margins.right(),
+                                                     margins.bottom());
+}
+
+/**
+ * Recreates the chunk items based on the cells occupied in the whole layer.
+ */
+void TileLayerItem::rebuildChunkItems()
+{
+    QHash<quint64, QRectF> rects;
+
+    for (int y = 0; y < mLayer->height(); ++y) {
+        for (int x = 0; x < mLayer->width(); ++x) {
+            if (mLayer->cellAt(x, y).isEmpty())
+                continue;
+
+            const QRectF bounds = cellBounds(x, y);
+            const QRect range = chunkRange(bounds);
+
+            for (int cy = range.top(); cy <= range.bottom(); ++cy) {
+                for (int cx = range.left(); cx <= range.right(); ++cx) {
+                    QRectF &rect = rects[chunkKey(cx, cy)];
+                    rect |= bounds & chunkRect(cx, cy);
+                }
+            }
+        }
+    }
+
+    QHash<quint64, TileLayerChunkItem*>::iterator it = mChunkItems.begin();
+    while (it != mChunkItems.end()) {
+        if (!rects.contains(it.key())) {
+            delete it.value();
+            it = mChunkItems.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    QHash<quint64, QRectF>::const_iterator rectIt = rects.constBegin();
+    for (; rectIt != rects.constEnd(); ++rectIt) {
+        const int x = qint32(quint32(rectIt.key()));
+        const int y = qint32(quint32(rectIt.key() >> 32));
+        setChunkItemRect(x, y, rectIt.value() & mBoundingRect);
+    }
+}
+
+/**
+ * Updates the bounding rects of the chunk items within the given \a range
+ * of chunks, creating or removing items as cells got filled or cleared.
+ */
+void TileLayerItem::updateChunkItems(const QRect &range)
+{
+    const MapRenderer *renderer = mMapDocument->renderer();
+    const QMargins margins = mLayer->drawMargins();
+
+    for (int cy = range.top(); cy <= range.bottom(); ++cy) {
+        for (int cx = range.left(); cx <= range.right(); ++cx) {
+            const QRectF rect = chunkRect(cx, cy);
+
+            // Find the cells that could draw into this chunk. The corners
+            // are mapped separately since the chunk may not be aligned to
+            // the tile grid.
+            const QRectF area = rect.adjusted(-margins.right(),
+                                              -margins.bottom(),
+                                              margins.left(),
+                                              margins.top());
+            QPolygonF corners;
+            corners << renderer->screenToTileCoords(area.topLeft())
+                    << renderer->screenToTileCoords(area.topRight())
+                    << renderer->screenToTileCoords(area.bottomLeft())
+                    << renderer->screenToTileCoords(area.bottomRight());
+
+            const QRectF tileArea = corners.boundingRect();
+            const QRect cells = QRect(QPoint(qFloor(tileArea.left()) - 1,
+                                             qFloor(tileArea.top()) - 1),
+                                      QPoint(qFloor(tileArea.right()) + 1,
+                                             qFloor(tileArea.bottom()) + 1))
+                    .translated(-mLayer->position())
+                    & QRect(QPoint(0, 0), mLayer->size());
+
+            QRectF occupied;
+            for (int y = cells.top(); y <= cells.bottom(); ++y)
+                for (int x = cells.left(); x <= cells.right(); ++x)
+                    if (!mLayer->cellAt(x, y).isEmpty())
+                        occupied |= cellBounds(x, y) & rect;
+
+            setChunkItemRect(cx, cy, occupied & mBoundingRect);
+        }
+    }
+}
+
+/**
+ * Sets the bounding rect of the item for the chunk at \a x, \a y. The
+ * item is created when needed, and removed when the \a rect is empty.
+ */
+void TileLayerItem::setChunkItemRect(int x, int y, const QRectF &rect)
+{
+    const quint64 key = chunkKey(x, y);
+    TileLayerChunkItem *item = mChunkItems.value(key);
+
+    if (rect.isEmpty()) {
+        if (item) {
+            mChunkItems.remove(key);
+            delete item;
+        }
+        return;
+    }
+
+    if (!item) {
+        item = new TileLayerChunkItem(x, y, this);
+        mChunkItems.insert(key, item);
+    }
+
+    item->setBoundingRect(rect);
 }
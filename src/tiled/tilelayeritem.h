@@ -21,15 +21,28 @@
 #ifndef TILELAYERITEM_H
 #define TILELAYERITEM_H
 
+#include "cachemanager.h"
+
 #include <QGraphicsItem>
+#include <QHash>
+#include <QPainter>
+#include <QPixmap>
+#include <QSet>
+#include <QVector>
 
 namespace Tiled {
 
+class Tile;
 class TileLayer;
+class Tileset;
 
 namespace Internal {
 
 class MapDocument;
+class TileLayerChunkItem;
+class TileLayerCompositeItem;
+class TileLayerGLRenderer;
+class TileLayerPrefetcher;
 
 /**
  * A graphics item displaying a tile layer in a QGraphicsView.
@@ -44,6 +57,7 @@ public:
      * @param mapDocument the map document owning the map of this layer
      */
     TileLayerItem(TileLayer *layer, MapDocument *mapDocument);
+    ~TileLayerItem();
 
     /**
      * Updates the size and position of this item. Should be called when the
@@ -55,6 +69,45 @@ public:
      */
     void syncWithTileLayer();
 
+    TileLayer *tileLayer() const { return mLayer; }
+
+    /**
+     * Sets whether the layer is displayed by a grid of child items, one for
+     * each chunk that has any tiles in it. Their bounding rects only cover
+     * the occupied cells, so that the scene index can skip empty areas and
+     * repaints stay local.
+     */
+    void setUseChunkItems(bool useChunkItems);
+    bool useChunkItems() const { return mUseChunkItems; }
+
+    /**
+     * Drops the cached rendering of the given \a region, in tile
+     * coordinates, if this layer has changed since the last time its cache
+     * was brought up to date. Should be called when a region of the map has
+     * changed.
+     */
+    void repaintRegion(const QRegion &region);
+
+    /**
+     * Drops the cached rendering of the chunks showing any of the given
+     * animated \a tiles and schedules them for repainting.
+     */
+    void repaintTiles(const QSet<Tile*> &tiles);
+
+    /**
+     * Drops the cached rendering of the whole layer. Should be called when
+     * the tiles used by this layer may look different.
+     */
+    void invalidateCache();
+
+    /**
+     * Starts rendering the chunks within \a rect, in scene coordinates, that
+     * are not cached yet on the worker threads. Only does something when
+     * the layer was last painted at the same \a scale.
+     */
+    void prefetch(const QRectF &rect, qreal scale,
+                  QPainter::RenderHints renderHints);
+
     // QGraphicsItem
     QRectF boundingRect() const;
     void paint(QPainter *painter,
@@ -62,9 +115,68 @@ public:
                QWidget *widget = 0);
 
 private:
+    friend class TileLayerChunkItem;
+    friend class TileLayerCompositeItem;
+    friend class TileLayerPrefetcher;
+
+    void syncCacheRevision();
+    void setCacheScale(qreal scale);
+    bool canCache(qreal scale) const;
+    QSet<quint64> chunksShowing(const QSet<Tile*> &tiles);
+
+    void paintChunk(QPainter *painter,
+                    const QStyleOptionGraphicsItem *option,
+                    int x, int y);
+    void drawCachedChunk(QPainter *painter, int x, int y, qreal scale);
+    void rebuildChunkItems();
+    void updateChunkItems(const QRect &range);
+    void setChunkItemRect(int x, int y, const QRectF &rect);
+    QRectF cellBounds(int x, int y) const;
+
+    QSizeF chunkSize() const;
+    QRectF chunkRect(int x, int y) const;
+    QRect chunkRange(const QRectF &rect) const;
+    void updateAnimatedChunks();
+    QPixmap renderChunk(const QRectF &rect, qreal scale,
+                        QPainter::RenderHints renderHints) const;
+    void chunkPrefetched(quint64 key, const QPixmap &pixmap, qreal scale,
+                         unsigned revision, unsigned generation);
+
     TileLayer *mLayer;
     MapDocument *mMapDocument;
     QRectF mBoundingRect;
+
+    /**
+     * The layer is cached in chunks of a fixed number of tiles, rendered at
+     * the scale of the last paint.
+     */
+    ManagedCache<quint64, QPixmap> mChunks;
+    qreal mCacheScale;
+    unsigned mCacheRevision;
+
+    /**
+     * Increased each time the whole cache is dropped, so that composites
+     * including this layer know to drop theirs as well.
+     */
+    unsigned mCacheGeneration;
+
+    /**
+     * For each animated tile used by this layer, the chunks it appears in.
+     * Rebuilt when the layer has changed.
+     */
+    QHash<Tile*, QVector<quint64> > mAnimatedChunks;
+    unsigned mAnimatedChunksRevision;
+
+    bool mUseChunkItems;
+    QHash<quint64, TileLayerChunkItem*> mChunkItems;
+
+    // Created when chunks are first prefetched
+    TileLayerPrefetcher *mPrefetcher;
+
+#ifndef QT_NO_OPENGL
+    // Draws the chunks from vertex buffers when painting through OpenGL
+    TileLayerGLRenderer *mGLRenderer;
+#endif
 };
 
 } // namespace Internal
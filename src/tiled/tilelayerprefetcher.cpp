@@ -0,0 +1,190 @@
+/*
+ * tilelayerprefetcher.cpp
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tilelayerprefetcher.h"
+
+#include "map.h"
+#include "mapdocument.h"
+#include "maprenderer.h"
+#include "tilelayer.h"
+#include "tilelayeritem.h"
+
+#include <QImage>
+#include <QPixmap>
+#include <QRunnable>
+#include <QSharedPointer>
+#include <QtCore/qmath.h>
+
+using namespace Tiled;
+using namespace Tiled::Internal;
+
+namespace {
+
+/**
+ * A copy of the layer and the map properties needed to render it, which can
+ * be used from the worker threads while the map is being edited.
+ */
+class PrefetchSnapshot
+{
+public:
+    PrefetchSnapshot(const MapDocument *mapDocument, const TileLayer *layer)
+    {
+        const Map *map = mapDocument->map();
+        mMap = new Map(map->orientation(),
+                       map->width(), map->height(),
+                       map->tileWidth(), map->tileHeight());
+        mMap->setRenderOrder(map->renderOrder());
+        mMap->setHexSideLength(map->hexSideLength());
+        mMap->setStaggerAxis(map->staggerAxis());
+        mMap->setStaggerIndex(map->staggerIndex());
+        mMap->setInfinite(map->isInfinite());
+
+        mLayer = static_cast<TileLayer*>(layer->clone());
+        mMap->addLayer(mLayer);
+
+        mRenderer = MapDocument::createRenderer(mMap);
+        mRenderer->setFlags(mapDocument->renderer()->flags());
+    }
+
+    ~PrefetchSnapshot()
+    {
+        delete mRenderer;
+        delete mMap;
+    }
+
+    const TileLayer *layer() const { return mLayer; }
+    const MapRenderer *renderer() const { return mRenderer; }
+
+private:
+    Q_DISABLE_COPY(PrefetchSnapshot)
+
+    Map *mMap;
+    TileLayer *mLayer;
+    MapRenderer *mRenderer;
+};
+
+class PrefetchChunkJob : public QRunnable
+{
+public:
+    PrefetchChunkJob(const QSharedPointer<PrefetchSnapshot> &snapshot,
+                     TileLayerPrefetcher *receiver,
+                     int index,
+                     const QRectF &rect,
+                     const QRectF &exposed,
+                     qreal scale,
+                     QPainter::RenderHints renderHints)
+        : mSnapshot(snapshot)
+        , mReceiver(receiver)
+        , mIndex(index)
+        , mRect(rect)
+        , mExposed(exposed)
+        , mScale(scale)
+        , mRenderHints(renderHints)
+    {}
+
+    void run()
+    {
+        QImage image(qCeil(mRect.width() * mScale),
+                     qCeil(mRect.height() * mScale),
+                     QImage::Format_ARGB32_Premultiplied);
+        image.fill(Qt::transparent);
+
+        QPainter painter(&image);
+        painter.setRenderHints(mRenderHints);
+        painter.scale(image.width() / mRect.width(),
+                      image.height() / mRect.height());
+        painter.translate(-mRect.topLeft());
+
+        mSnapshot->renderer()->drawTileLayer(&painter, mSnapshot->layer(),
+                                             mExposed);
+        painter.end();
+
+        // The receiver waits for its jobs before it is deleted
+        QMetaObject::invokeMethod(mReceiver, "chunkRendered",
+                                  Qt::QueuedConnection,
+                                  Q_ARG(int, mIndex),
+                                  Q_ARG(QImage, image));
+    }
+
+private:
+    const QSharedPointer<PrefetchSnapshot> mSnapshot;
+    TileLayerPrefetcher * const mReceiver;
+    const int mIndex;
+    const QRectF mRect;
+    const QRectF mExposed;
+    const qreal mScale;
+    const QPainter::RenderHints mRenderHints;
+};
+
+} // anonymous namespace
+
+TileLayerPrefetcher::TileLayerPrefetcher(TileLayerItem *item)
+    : mItem(item)
+    , mJobs(JobSystem::Background)
+    , mPending(0)
+    , mScale(0)
+    , mRevision(0)
+    , mGeneration(0)
+{
+}
+
+TileLayerPrefetcher::~TileLayerPrefetcher()
+{
+    // Only the jobs that are already running are waited for
+    mJobs.cancel();
+    mJobs.wait();
+}
+
+void TileLayerPrefetcher::start(const QVector<quint64> &keys,
+                                const QVector<QRectF> &rects,
+                                qreal scale,
+                                QPainter::RenderHints renderHints)
+{
+    Q_ASSERT(!isBusy());
+    Q_ASSERT(keys.size() == rects.size());
+
+    if (keys.isEmpty())
+        return;
+
+    mKeys = keys;
+    mPending = keys.size();
+    mScale = scale;
+    mRevision = mItem->mLayer->revision();
+    mGeneration = mItem->mCacheGeneration;
+
+    const QSharedPointer<PrefetchSnapshot> snapshot(
+                new PrefetchSnapshot(mItem->mMapDocument, mItem->mLayer));
+
+    for (int i = 0; i < keys.size(); ++i) {
+        const QRectF &rect = rects.at(i);
+        mJobs.start(new PrefetchChunkJob(snapshot, this, i,
+                                         rect, rect & mItem->mBoundingRect,
+                                         scale, renderHints));
+    }
+}
+
+void TileLayerPrefetcher::chunkRendered(int index, const QImage &image)
+{
+    mItem->chunkPrefetched(mKeys.at(index), QPixmap::fromImage(image),
+                           mScale, mRevision, mGeneration);
+
+    if (--mPending == 0)
+        mKeys.clear();
+}
@@ -0,0 +1,89 @@
+/*
+ * tilelayerprefetcher.h
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TILELAYERPREFETCHER_H
+#define TILELAYERPREFETCHER_H
+
+#include "jobsystem.h"
+
+#include <QObject>
+#include <QPainter>
+#include <QRectF>
+#include <QVector>
+
+class QImage;
+
+namespace Tiled {
+namespace Internal {
+
+class TileLayerItem;
+
+/**
+ * Renders the chunks of a TileLayerItem on the worker threads before they
+ * are needed, so that scrolling into areas that were not visible before
+ * does not have to wait for them.
+ *
+ * The chunks are rendered to a QImage from a copy of the layer, which
+ * shares its cells with the layer until either of them changes. Once
+ * rendered they are handed to the item on the GUI thread, which drops them
+ * when the layer or the scale changed in the meantime.
+ */
+class TileLayerPrefetcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TileLayerPrefetcher(TileLayerItem *item);
+    ~TileLayerPrefetcher();
+
+    /**
+     * Returns whether chunks are still being rendered. Only one set of
+     * chunks is rendered at a time.
+     */
+    bool isBusy() const { return !mKeys.isEmpty(); }
+
+    /**
+     * Starts rendering the chunks with the given \a keys, covering \a rects
+     * in scene coordinates, at the given \a scale.
+     */
+    void start(const QVector<quint64> &keys,
+               const QVector<QRectF> &rects,
+               qreal scale,
+               QPainter::RenderHints renderHints);
+
+private slots:
+    void chunkRendered(int index, const QImage &image);
+
+private:
+    TileLayerItem *mItem;
+    JobGroup mJobs;
+
+    // The chunks being rendered and the state of the layer they are for
+    QVector<quint64> mKeys;
+    int mPending;
+    qreal mScale;
+    unsigned mRevision;
+    unsigned mGeneration;
+};
+
+} // namespace Internal
+} // namespace Tiled
+
+#endif // TILELAYERPREFETCHER_H
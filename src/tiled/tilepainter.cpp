@@ -21,9 +21,13 @@
 
 #include "tilepainter.h"
 
+#include "changedcells.h"
 #include "mapdocument.h"
 #include "tilelayer.h"
 #include "map.h"
+#include "regionbuilder.h"
+
+#include <QBitArray>
 
 using namespace Tiled;
 using namespace Tiled::Internal;
@@ -76,7 +80,7 @@ Cell TilePainter::cellAt(int x, int y) const
 void TilePainter::setCell(int x, int y, const Cell &cell)
 {
     const QRegion &selection = mMapDocument->selectedArea();
-    if (!(selection.isEmpty() || selection.contains(QPoint(x, y))))
+    if (!(selection.isEmpty() || mMapDocument->selectionMask().contains(x, y)))
         return;
 
     const int layerX = x - mTileLayer->x();
@@ -174,6 +178,38 @@ void TilePainter::drawStamp(const TileLayer *stamp,
     mMapDocument->emitRegionChanged(region);
 }
 
+void TilePainter::applyChanges(const ChangedCells &changes, bool revert)
+{
+    const QRegion region = changes.region();
+    const QRegion paintable = paintableRegion(region);
+    if (paintable.isEmpty())
+        return;
+
+    // Only when part of the changes can't be painted each position needs
+    // to be checked
+    const bool clipped = paintable != region;
+    const QRect bounds = mTileLayer->bounds();
+    const QRegion &selection = mMapDocument->selectedArea();
+    const RegionMask &selectionMask = mMapDocument->selectionMask();
+
+    DrawMarginsWatcher watcher(mMapDocument, mTileLayer);
+
+    foreach (const ChangedCells::Change &change, changes.changes()) {
+        if (clipped) {
+            if (!bounds.contains(change.position))
+                continue;
+            if (!(selection.isEmpty() || selectionMask.contains(change.position)))
+                continue;
+        }
+
+        mTileLayer->setCell(change.position.x() - mTileLayer->x(),
+                            change.position.y() - mTileLayer->y(),
+                            revert ? change.before : change.after);
+    }
+
+    mMapDocument->emitRegionChanged(paintable);
+}
+
 void TilePainter::erase(const QRegion &region)
 {
     const QRegion paintable = paintableRegion(region);
@@ -184,108 +220,100 @@ void TilePainter::erase(const QRegion &region)
     mMapDocument->emitRegionChanged(paintable);
 }
 
-static QRegion fillRegion(const TileLayer *layer, QPoint fillOrigin)
+static bool runLessThan(const QRect &a, const QRect &b)
 {
-    // Create that region that will hold the fill
-    QRegion fillRegion;
+    return a.y() < b.y() || (a.y() == b.y() && a.x() < b.x());
+}
 
+/**
+ * Pushes a seed for each run of unvisited cells matching \a matchCell on
+ * row \a y between \a left and \a right.
+ */
+static void pushSeeds(const TileLayer *layer, const Cell &matchCell,
+                      const QBitArray &visited,
+                      int left, int right, int y,
+                      QVector<QPoint> &seeds)
+{
+    const int layerWidth = layer->width();
+    bool inRun = false;
+
+    for (int x = left; x <= right; ++x) {
+        const bool matches = !visited.testBit(y * layerWidth + x) &&
+                layer->cellAt(x, y) == matchCell;
+
+        if (matches && !inRun)
+            seeds.append(QPoint(x, y));
+
+        inRun = matches;
+    }
+}
+
+/**
+ * Computes the region of cells connected to \a fillOrigin that are equal to
+ * the cell at that position, in layer coordinates.
+ *
+ * Each seed is grown into the full horizontal run it is part of, after which
+ * the rows above and below the run are scanned for new seeds. The runs are
+ * collected and turned into a region at the end.
+ */
+static QRegion fillRegion(const TileLayer *layer, QPoint fillOrigin)
+{
     // Silently quit if parameters are unsatisfactory
     if (!layer->contains(fillOrigin))
-        return fillRegion;
+        return QRegion();
 
     // Cache cell that we will match other cells against
     const Cell matchCell = layer->cellAt(fillOrigin);
 
-    // Grab map dimensions for later use.
     const int layerWidth = layer->width();
     const int layerHeight = layer->height();
-    const int layerSize = layerWidth * layerHeight;
-
-    // Create a queue to hold cells that need filling
-    QList<QPoint> fillPositions;
-    fillPositions.append(fillOrigin);
-
-    // Create an array that will store which cells have been processed
-    // This is faster than checking if a given cell is in the region/list
-    QVector<quint8> processedCellsVec(layerSize);
-    quint8 *processedCells = processedCellsVec.data();
-
-    // Loop through queued positions and fill them, while at the same time
-    // checking adjacent positions to see if they should be added
-    while (!fillPositions.empty()) {
-        const QPoint currentPoint = fillPositions.takeFirst();
-        const int startOfLine = currentPoint.y() * layerWidth;
-
-        // Seek as far left as we can
-        int left = currentPoint.x();
-        while (left > 0 && layer->cellAt(left - 1, currentPoint.y()) == matchCell)
+
+    // Stores which cells have been filled, which is faster than checking
+    // whether they are part of the runs
+    QBitArray visited(layerWidth * layerHeight);
+
+    QVector<QRect> runs;
+    QVector<QPoint> seeds;
+    seeds.append(fillOrigin);
+
+    while (!seeds.isEmpty()) {
+        const QPoint seed = seeds.last();
+        seeds.pop_back();
+
+        const int y = seed.y();
+        const int startOfLine = y * layerWidth;
+
+        // The seed may have become part of another run in the meantime
+        if (visited.testBit(startOfLine + seed.x()))
+            continue;
+
+        // Seek as far left and right as we can
+        int left = seed.x();
+        while (left > 0 && layer->cellAt(left - 1, y) == matchCell)
             --left;
 
-        // Seek as far right as we can
-        int right = currentPoint.x();
-        while (right + 1 < layerWidth && layer->cellAt(right + 1, currentPoint.y()) == matchCell)
+        int right = seed.x();
+        while (right + 1 < layerWidth && layer->cellAt(right + 1, y) == matchCell)
             ++right;
 
-        // Add cells between left and right to the region
-        fillRegion += QRegion(left, currentPoint.y(), right - left + 1, 1);
-
-        // Add cell strip to processed cells
-        memset(&processedCells[startOfLine + left],
-               1,
-               right - left);
-
-        // These variables cache whether the last cell was added to the queue
-        // or not as an optimization, since adjacent cells on the x axis
-        // do not need to be added to the queue.
-        bool lastAboveCell = false;
-        bool lastBelowCell = false;
-
-        // Loop between left and right and check if cells above or
-        // below need to be added to the queue
-        for (int x = left; x <= right; ++x) {
-            const QPoint fillPoint(x, currentPoint.y());
-
-            // Check cell above
-            if (fillPoint.y() > 0) {
-                QPoint aboveCell(fillPoint.x(), fillPoint.y() - 1);
-                if (!processedCells[aboveCell.y() * layerWidth + aboveCell.x()] &&
-                    layer->cellAt(aboveCell) == matchCell)
-                {
-                    // Do not add the above cell to the queue if its
-                    // x-adjacent cell was added.
-                    if (!lastAboveCell)
-                        fillPositions.append(aboveCell);
-
-                    lastAboveCell = true;
-                } else {
-                    lastAboveCell = false;
-                }
-
-                processedCells[aboveCell.y() * layerWidth + aboveCell.x()] = 1;
-            }
+        visited.fill(true, startOfLine + left, startOfLine + right + 1);
+        runs.append(QRect(left, y, right - left + 1, 1));
 
-            // Check cell below
-            if (fillPoint.y() + 1 < layerHeight) {
-                QPoint belowCell(fillPoint.x(), fillPoint.y() + 1);
-                if (!processedCells[belowCell.y() * layerWidth + belowCell.x()] &&
-                    layer->cellAt(belowCell) == matchCell)
-                {
-                    // Do not add the below cell to the queue if its
-                    // x-adjacent cell was added.
-                    if (!lastBelowCell)
-                        fillPositions.append(belowCell);
-
-                    lastBelowCell = true;
-                } else {
-                    lastBelowCell = false;
-                }
-
-                processedCells[belowCell.y() * layerWidth + belowCell.x()] = 1;
-            }
-        }
+        if (y > 0)
+            pushSeeds(layer, matchCell, visited, left, right, y - 1, seeds);
+        if (y + 1 < layerHeight)
+            pushSeeds(layer, matchCell, visited, left, right, y + 1, seeds);
     }
 
-    return fillRegion;
+    // The runs of a row never touch, since each of them was grown as far
+    // as possible
+    qSort(runs.begin(), runs.end(), runLessThan);
+
+    RegionBuilder builder;
+    foreach (const QRect &run, runs)
+        builder.addRun(run.x(), run.y(), run.width());
+
+    return builder.region();
 }
 
 QRegion TilePainter::computePaintableFillRegion(const QPoint &fillOrigin) const
@@ -295,7 +323,7 @@ QRegion TilePainter::computePaintableFillRegion(const QPoint &fillOrigin) const
 
     const QRegion &selection = mMapDocument->selectedArea();
     if (!selection.isEmpty())
-        region &= selection;
+        region = mMapDocument->selectionMask().intersected(region);
 
     return region;
 }
@@ -309,7 +337,7 @@ QRegion TilePainter::computeFillRegion(const QPoint &fillOrigin) const
 bool TilePainter::isDrawable(int x, int y) const
 {
     const QRegion &selection = mMapDocument->selectedArea();
-    if (!(selection.isEmpty() || selection.contains(QPoint(x, y))))
+    if (!(selection.isEmpty() || mMapDocument->selectionMask().contains(x, y)))
         return false;
 
     const int layerX = x - mTileLayer->x();
@@ -328,7 +356,7 @@ QRegion TilePainter::paintableRegion(const QRegion &region) const
 
     const QRegion &selection = mMapDocument->selectedArea();
     if (!selection.isEmpty())
-        intersection &= selection;
+        intersection = mMapDocument->selectionMask().intersected(intersection);
 
     return intersection;
 }
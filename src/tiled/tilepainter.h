@@ -31,6 +31,7 @@ class TileLayer;
 
 namespace Internal {
 
+class ChangedCells;
 class MapDocument;
 
 /**
@@ -89,6 +90,12 @@ public:
      */
     void drawStamp(const TileLayer *stamp, const QRegion &drawRegion);
 
+    /**
+     * Sets the changed cells to their cells after the change, or to their
+     * cells before the change when \a revert is true.
+     */
+    void applyChanges(const ChangedCells &changes, bool revert = false);
+
     /**
      * Erases the cells in the given region.
      */
@@ -37,9 +37,12 @@ TileSelectionItem::TileSelectionItem(MapDocument *mapDocument)
 {
     setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
 
-    connect(mMapDocument, SIGNAL(selectedAreaChanged(QRegion,QRegion)),
+    connect(mMapDocument, SIGNAL(selectedAreaModified(QRegion,QRegion)),
             this, SLOT(selectionChanged(QRegion,QRegion)));
+    connect(mMapDocument, SIGNAL(mapChanged()),
+            this, SLOT(mapChanged()));
 
+    updateChunks(mapDocument->selectionMask().differenceChunks(RegionMask()));
     updateBoundingRect();
 }
 
@@ -52,24 +55,95 @@ void TileSelectionItem::paint(QPainter *painter,
                               const QStyleOptionGraphicsItem *option,
                               QWidget *)
 {
-    const QRegion &selection = mMapDocument->selectedArea();
     QColor highlight = QApplication::palette().highlight().color();
     highlight.setAlpha(128);
 
+    if (highlight != mChunkColor) {
+        mChunkColor = highlight;
+
+        QHash<ChunkKey, ChunkShape>::iterator it = mChunkShapes.begin();
+        for (; it != mChunkShapes.end(); ++it)
+            it.value().recorded = false;
+    }
+
     MapRenderer *renderer = mMapDocument->renderer();
-    renderer->drawTileSelection(painter, selection, highlight,
-                                option->exposedRect);
+    const QRectF &exposed = option->exposedRect;
+
+    QHash<ChunkKey, ChunkShape>::iterator it = mChunkShapes.begin();
+    for (; it != mChunkShapes.end(); ++it) {
+        ChunkShape &shape = it.value();
+        if (!shape.bounds.intersects(exposed))
+            continue;
+
+        if (!shape.recorded) {
+            shape.picture = QPicture();
+            QPainter recorder(&shape.picture);
+            renderer->drawTileSelection(&recorder, shape.region, highlight,
+                                        shape.bounds);
+            recorder.end();
+            shape.recorded = true;
+        }
+
+        painter->drawPicture(0, 0, shape.picture);
+    }
+}
+
+void TileSelectionItem::selectionChanged(const QRegion &added,
+                                         const QRegion &removed)
+{
+    prepareGeometryChange();
+    updateBoundingRect();
+
+    // Only the chunks touched by the changes need to be recorded again and
+    // repainted
+    RegionMask changed(added);
+    changed.add(removed);
+
+    const QVector<QRect> chunks = changed.differenceChunks(RegionMask());
+    updateChunks(chunks);
+
+    const MapRenderer *renderer = mMapDocument->renderer();
+    foreach (const QRect &chunk, chunks)
+        update(renderer->boundingRect(chunk));
 }
 
-void TileSelectionItem::selectionChanged(const QRegion &newSelection,
-                                         const QRegion &oldSelection)
+/**
+ * The renderer may have changed, so all of the chunks are recorded again.
+ */
+void TileSelectionItem::mapChanged()
 {
     prepareGeometryChange();
     updateBoundingRect();
 
-    // Make sure changes within the bounding rect are updated
-    const QRect changedArea = newSelection.xored(oldSelection).boundingRect();
-    update(mMapDocument->renderer()->boundingRect(changedArea));
+    mChunkShapes.clear();
+    updateChunks(mMapDocument->selectionMask().differenceChunks(RegionMask()));
+
+    update();
+}
+
+/**
+ * Updates the regions of the given \a chunks from the current selection. They
+ * are recorded again when they are next painted.
+ */
+void TileSelectionItem::updateChunks(const QVector<QRect> &chunks)
+{
+    const RegionMask &selectionMask = mMapDocument->selectionMask();
+    const MapRenderer *renderer = mMapDocument->renderer();
+
+    foreach (const QRect &chunk, chunks) {
+        const ChunkKey key(chunk.x(), chunk.y());
+        const QRegion region = selectionMask.intersected(QRegion(chunk));
+
+        if (region.isEmpty()) {
+            mChunkShapes.remove(key);
+            continue;
+        }
+
+        ChunkShape &shape = mChunkShapes[key];
+        shape.region = region;
+        shape.bounds = renderer->boundingRect(region.boundingRect());
+        shape.recorded = false;
+    }
 }
 
 void TileSelectionItem::updateBoundingRect()
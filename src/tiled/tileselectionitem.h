@@ -21,8 +21,14 @@
 #ifndef TILESELECTIONITEM_H
 #define TILESELECTIONITEM_H
 
-#include <QObject>
+#include "regionmask.h"
+
+#include <QColor>
 #include <QGraphicsItem>
+#include <QHash>
+#include <QObject>
+#include <QPair>
+#include <QPicture>
 
 namespace Tiled {
 namespace Internal {
@@ -31,6 +37,12 @@ class MapDocument;
 
 /**
  * A graphics item displaying a tile selection.
+ *
+ * The selection is drawn in chunks of cells, each of which keeps a recording
+ * of how the renderer draws its part of the selection. When the selection
+ * changes, only the chunks touched by the added and removed cells are
+ * recorded again and repainted, and only the chunks within the exposed area
+ * are painted.
  */
 class TileSelectionItem : public QObject,
                           public QGraphicsItem
@@ -52,14 +64,29 @@ public:
                QWidget *widget = 0);
 
 private slots:
-    void selectionChanged(const QRegion &newSelection,
-                          const QRegion &oldSelection);
+    void selectionChanged(const QRegion &added, const QRegion &removed);
+    void mapChanged();
 
 private:
+    struct ChunkShape
+    {
+        ChunkShape() : recorded(false) {}
+
+        QRegion region;         // part of the selection within the chunk
+        QRectF bounds;          // screen area covered by the region
+        QPicture picture;
+        bool recorded;
+    };
+
+    typedef QPair<int, int> ChunkKey;   // chunk x, chunk y in cells
+
+    void updateChunks(const QVector<QRect> &chunks);
     void updateBoundingRect();
 
     MapDocument *mMapDocument;
     QRectF mBoundingRect;
+    QHash<ChunkKey, ChunkShape> mChunkShapes;
+    QColor mChunkColor;                 // color the chunks were recorded in
 };
 
 } // namespace Internal
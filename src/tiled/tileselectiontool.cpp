@@ -90,14 +90,22 @@ void TileSelectionTool::mouseReleased(QGraphicsSceneMouseEvent *event)
         mSelecting = false;
 
         MapDocument *document = mapDocument();
-        QRegion selection = document->selectedArea();
         const QRect area = selectedArea();
+        QRegion selection;
 
-        switch (mSelectionMode) {
-        case Replace:   selection = area; break;
-        case Add:       selection += area; break;
-        case Subtract:  selection -= area; break;
-        case Intersect: selection &= area; break;
+        if (mSelectionMode == Replace) {
+            selection = area;
+        } else {
+            RegionMask mask = document->selectionMask();
+
+            switch (mSelectionMode) {
+            case Replace:   break;
+            case Add:       mask.add(area); break;
+            case Subtract:  mask.remove(area); break;
+            case Intersect: mask &= RegionMask(QRegion(area)); break;
+            }
+
+            selection = mask.toRegion();
         }
 
         if (selection != document->selectedArea()) {
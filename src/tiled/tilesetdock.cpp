@@ -171,16 +171,43 @@ public:
         return false;
     }
 
+    const QList<Tile*> &tiles() const { return mTiles; }
+
 private:
     QList<Tile*> mTiles;
 };
 
+template<typename Condition>
+static bool layerHasCell(const TileLayer *tileLayer, const Condition &condition)
+{
+    return tileLayer->hasCell(condition);
+}
+
+// Specific tiles are looked up in the tile index of the layer
+static bool layerHasCell(const TileLayer *tileLayer,
+                         const MatchesAnyTile &condition)
+{
+    return tileLayer->referencesAnyTile(condition.tiles());
+}
+
+template<typename Condition>
+static QRegion layerRegion(const TileLayer *tileLayer, const Condition &condition)
+{
+    return tileLayer->region(condition);
+}
+
+static QRegion layerRegion(const TileLayer *tileLayer,
+                           const MatchesAnyTile &condition)
+{
+    return tileLayer->tileRegion(condition.tiles());
+}
+
 template<typename Condition>
 static bool hasTileReferences(MapDocument *mapDocument, Condition condition)
 {
     foreach (Layer *layer, mapDocument->map()->layers()) {
         if (TileLayer *tileLayer = layer->asTileLayer()) {
-            if (tileLayer->hasCell(condition))
+            if (layerHasCell(tileLayer, condition))
                 return true;
 
         } else if (ObjectGroup *objectGroup = layer->asObjectGroup()) {
@@ -201,7 +228,7 @@ static void removeTileReferences(MapDocument *mapDocument, Condition condition)
 
     foreach (Layer *layer, mapDocument->map()->layers()) {
         if (TileLayer *tileLayer = layer->asTileLayer()) {
-            const QRegion refs = tileLayer->region(condition);
+            const QRegion refs = layerRegion(tileLayer, condition);
             if (!refs.isEmpty())
                 undoStack->push(new EraseTiles(mapDocument, tileLayer, refs));
 
@@ -355,11 +382,13 @@ void TilesetDock::setMapDocument(MapDocument *mapDocument)
         mCurrentTilesets.insert(mMapDocument, tilesetName);
     }
 
-    // Clear previous content
+    // Clear previous content. The views are kept around for when the
+    // document is shown again.
+    mTabBar->blockSignals(true);
     while (mTabBar->count())
         mTabBar->removeTab(0);
     while (mViewStack->count())
-        delete mViewStack->widget(0);
+        mViewStack->removeWidget(mViewStack->widget(0));
 
     mTilesets.clear();
 
@@ -372,14 +401,11 @@ void TilesetDock::setMapDocument(MapDocument *mapDocument)
     if (mMapDocument) {
         mTilesets = mMapDocument->map()->tilesets();
 
-        foreach (Tileset *tileset, mTilesets) {
-            TilesetView *view = new TilesetView;
-            view->setMapDocument(mMapDocument);
-            view->setZoomable(mZoomable);
-
+        // The views are only created once their tab becomes current
+        foreach (Tileset *tileset, mTilesets)
             mTabBar->addTab(tileset->name());
+        foreach (TilesetView *view, mTilesetViews.value(mMapDocument))
             mViewStack->addWidget(view);
-        }
 
         connect(mMapDocument, SIGNAL(tilesetAdded(int,Tileset*)),
                 SLOT(tilesetAdded(int,Tileset*)));
@@ -405,6 +431,7 @@ void TilesetDock::setMapDocument(MapDocument *mapDocument)
         }
     }
 
+    mTabBar->blockSignals(false);
     updateActions();
 
     widget()->show();
@@ -459,27 +486,15 @@ void TilesetDock::updateActions()
 
     if (index > -1) {
         view = tilesetViewAt(index);
-        if (view) {
-            Tileset *tileset = mTilesets.at(index);
-
-            if (!view->model()) {
-                // Lazily set up the model
-                view->setModel(new TilesetModel(tileset, view));
-
-                QItemSelectionModel *s = view->selectionModel();
-                connect(s, SIGNAL(selectionChanged(QItemSelection,QItemSelection)),
-                        SLOT(selectionChanged()));
-                connect(s, SIGNAL(currentChanged(QModelIndex,QModelIndex)),
-                        SLOT(updateCurrentTile()));
-                connect(view, SIGNAL(pressed(QModelIndex)),
-                        SLOT(indexPressed(QModelIndex)));
-            }
+        if (!view)
+            view = createTilesetView(index);
 
-            mViewStack->setCurrentIndex(index);
-            external = tileset->isExternal();
-            hasImageSource = !tileset->imageSource().isEmpty();
-            hasSelection = view->selectionModel()->hasSelection();
-        }
+        Tileset *tileset = mTilesets.at(index);
+
+        mViewStack->setCurrentWidget(view);
+        external = tileset->isExternal();
+        hasImageSource = !tileset->imageSource().isEmpty();
+        hasSelection = view->selectionModel()->hasSelection();
     }
 
     const bool tilesetIsDisplayed = view != 0;
@@ -554,26 +569,22 @@ void TilesetDock::indexPressed(const QModelIndex &index)
 
 void TilesetDock::tilesetAdded(int index, Tileset *tileset)
 {
-    TilesetView *view = new TilesetView;
-    view->setMapDocument(mMapDocument);
-    view->setZoomable(mZoomable);
-
     mTilesets.insert(index, tileset);
     mTabBar->insertTab(index, tileset->name());
-    mViewStack->insertWidget(index, view);
 
     updateActions();
 }
 
 void TilesetDock::tilesetChanged(Tileset *tileset)
 {
-    // Update the affected tileset model, if it exists
-    const int index = mTilesets.indexOf(tileset);
-    if (index < 0)
-        return;
-
-    if (TilesetModel *model = tilesetViewAt(index)->tilesetModel())
-        model->tilesetChanged();
+    // Update the affected tileset models, including those of the views kept
+    // for other documents
+    QMap<MapDocument*, TilesetViews>::const_iterator it = mTilesetViews.constBegin();
+    QMap<MapDocument*, TilesetViews>::const_iterator end = mTilesetViews.constEnd();
+    for (; it != end; ++it) {
+        if (TilesetView *view = it.value().value(tileset))
+            view->tilesetModel()->tilesetChanged();
+    }
 }
 
 void TilesetDock::tilesetRemoved(Tileset *tileset)
@@ -584,7 +595,7 @@ void TilesetDock::tilesetRemoved(Tileset *tileset)
 
     mTilesets.removeAt(index);
     mTabBar->removeTab(index);
-    delete tilesetViewAt(index);
+    delete mTilesetViews[mMapDocument].take(tileset);
 
     // Make sure we don't reference this tileset anymore
     if (mCurrentTiles) {
@@ -604,11 +615,9 @@ void TilesetDock::tilesetMoved(int from, int to)
 {
     mTilesets.insert(to, mTilesets.takeAt(from));
 
-    // Move the related tileset views
-    QWidget *widget = mViewStack->widget(from);
-    mViewStack->removeWidget(widget);
-    mViewStack->insertWidget(to, widget);
-    mViewStack->setCurrentIndex(mTabBar->currentIndex());
+    // The view of the moved tileset remains current
+    if (TilesetView *view = currentTilesetView())
+        mViewStack->setCurrentWidget(view);
 
     // Update the titles of the affected tabs
     const int start = qMin(from, to);
@@ -625,9 +634,9 @@ void TilesetDock::tilesetMoved(int from, int to)
  */
 void TilesetDock::removeTileset()
 {
-    const int currentIndex = mViewStack->currentIndex();
+    const int currentIndex = mTabBar->currentIndex();
     if (currentIndex != -1)
-        removeTileset(mViewStack->currentIndex());
+        removeTileset(currentIndex);
 }
 
 /**
@@ -734,12 +743,46 @@ Tileset *TilesetDock::currentTileset() const
 
 TilesetView *TilesetDock::currentTilesetView() const
 {
-    return static_cast<TilesetView *>(mViewStack->currentWidget());
+    const int index = mTabBar->currentIndex();
+    if (index == -1)
+        return 0;
+
+    return tilesetViewAt(index);
 }
 
+/**
+ * Returns the view for the tileset at the given \a index, or 0 when it
+ * hasn't been created yet.
+ */
 TilesetView *TilesetDock::tilesetViewAt(int index) const
 {
-    return static_cast<TilesetView *>(mViewStack->widget(index));
+    return mTilesetViews.value(mMapDocument).value(mTilesets.at(index));
+}
+
+/**
+ * Creates the view and model for the tileset at the given \a index. The view
+ * is kept until the tileset is removed or the map document is closed.
+ */
+TilesetView *TilesetDock::createTilesetView(int index)
+{
+    Tileset *tileset = mTilesets.at(index);
+
+    TilesetView *view = new TilesetView;
+    view->setMapDocument(mMapDocument);
+    view->setZoomable(mZoomable);
+    view->setModel(new TilesetModel(tileset, view));
+
+    QItemSelectionModel *s = view->selectionModel();
+    connect(s, SIGNAL(selectionChanged(QItemSelection,QItemSelection)),
+            SLOT(selectionChanged()));
+    connect(s, SIGNAL(currentChanged(QModelIndex,QModelIndex)),
+            SLOT(updateCurrentTile()));
+    connect(view, SIGNAL(pressed(QModelIndex)),
+            SLOT(indexPressed(QModelIndex)));
+
+    mTilesetViews[mMapDocument].insert(tileset, view);
+    mViewStack->addWidget(view);
+    return view;
 }
 
 void TilesetDock::editTilesetProperties()
@@ -934,7 +977,11 @@ void TilesetDock::tileAnimationChanged(Tile *tile)
 
 void TilesetDock::documentAboutToClose(MapDocument *mapDocument)
 {
+    if (mapDocument == mMapDocument)
+        setMapDocument(0);
+
     mCurrentTilesets.remove(mapDocument);
+    qDeleteAll(mTilesetViews.take(mapDocument));
 }
 
 void TilesetDock::refreshTilesetMenu()
@@ -24,6 +24,7 @@
 #define TILESETDOCK_H
 
 #include <QDockWidget>
+#include <QHash>
 #include <QList>
 #include <QMap>
 
@@ -139,6 +140,7 @@ private:
     Tileset *currentTileset() const;
     TilesetView *currentTilesetView() const;
     TilesetView *tilesetViewAt(int index) const;
+    TilesetView *createTilesetView(int index);
 
     MapDocument *mMapDocument;
     QList<Tileset*> mTilesets;
@@ -160,6 +162,9 @@ private:
 
     QMap<MapDocument *, QString> mCurrentTilesets;
 
+    typedef QHash<Tileset*, TilesetView*> TilesetViews;
+    QMap<MapDocument *, TilesetViews> mTilesetViews;
+
     QToolButton *mTilesetMenuButton;
     QMenu *mTilesetMenu; //opens on click of mTilesetMenu
     QActionGroup *mTilesetActionGroup;
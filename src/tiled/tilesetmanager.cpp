@@ -22,30 +22,85 @@
 #include "tilesetmanager.h"
 
 #include "filesystemwatcher.h"
+#include "mapsaver.h"
 #include "tileanimationdriver.h"
 #include "tile.h"
 #include "tileset.h"
+#include "trace.h"
 
 #include <QImage>
+#include <QThread>
 
 using namespace Tiled;
 using namespace Tiled::Internal;
 
+namespace Tiled {
+namespace Internal {
+
+/**
+ * Decodes a changed tileset image on a worker thread, so that saving a large
+ * tileset image in an image editor doesn't block the user interface.
+ */
+class TilesetImageDecoder : public QThread
+{
+public:
+    TilesetImageDecoder(const QString &fileName, QObject *parent)
+        : QThread(parent)
+        , mFileName(fileName)
+        , mHash(0)
+    {}
+
+    ~TilesetImageDecoder()
+    {
+        wait();
+    }
+
+    const QString &fileName() const { return mFileName; }
+    const QImage &image() const { return mImage; }
+
+    /**
+     * Returns a hash of the pixels of the decoded image, used to skip the
+     * reload when the image did not actually change.
+     */
+    uint hash() const { return mHash; }
+
+protected:
+    void run()
+    {
+        TILED_TRACE_SCOPE_DETAIL("TilesetManager::decodeImage", mFileName);
+
+        mImage = QImage(mFileName);
+        if (mImage.isNull())
+            return;
+
+        const int bytesPerLine = (mImage.width() * mImage.depth() + 7) / 8;
+
+        mHash = qHash(qMakePair(mImage.width(), mImage.height())) ^ mImage.format();
+        for (int y = 0; y < mImage.height(); ++y) {
+            const char *line = reinterpret_cast<const char*>(mImage.constScanLine(y));
+            mHash = mHash * 31 + qHash(QByteArray::fromRawData(line, bytesPerLine));
+        }
+    }
+
+private:
+    const QString mFileName;
+    QImage mImage;
+    uint mHash;
+};
+
+} // namespace Internal
+} // namespace Tiled
+
 TilesetManager *TilesetManager::mInstance = 0;
 
 TilesetManager::TilesetManager():
     mWatcher(new FileSystemWatcher(this)),
     mAnimationDriver(new TileAnimationDriver(this)),
+    mAnimationTime(0),
     mReloadTilesetsOnChange(false)
 {
-    connect(mWatcher, SIGNAL(fileChanged(QString)),
-            this, SLOT(fileChanged(QString)));
-
-    mChangedFilesTimer.setInterval(500);
-    mChangedFilesTimer.setSingleShot(true);
-
-    connect(&mChangedFilesTimer, SIGNAL(timeout()),
-            this, SLOT(fileChangedTimeout()));
+    connect(mWatcher, SIGNAL(filesChanged(QStringList)),
+            this, SLOT(filesChanged(QStringList)));
 
     connect(mAnimationDriver, SIGNAL(update(int)),
             this, SLOT(advanceTileAnimations(int)));
@@ -56,6 +111,8 @@ TilesetManager::~TilesetManager()
     // Since all MapDocuments should be deleted first, we assert that there are
     // no remaining tileset references.
     Q_ASSERT(mTilesets.size() == 0);
+
+    qDeleteAll(mImageDecoders);
 }
 
 TilesetManager *TilesetManager::instance()
@@ -105,6 +162,8 @@ void TilesetManager::addReference(Tileset *tileset)
         mTilesets.insert(tileset, 1);
         if (!tileset->imageSource().isEmpty())
             mWatcher->addPath(tileset->imageSource());
+
+        TILED_TRACE_COUNTER("Tilesets", mTilesets.size());
     }
 }
 
@@ -115,10 +174,14 @@ void TilesetManager::removeReference(Tileset *tileset)
 
     if (mTilesets.value(tileset) == 0) {
         mTilesets.remove(tileset);
-        if (!tileset->imageSource().isEmpty())
+        if (!tileset->imageSource().isEmpty()) {
             mWatcher->removePath(tileset->imageSource());
+            mImageHashes.remove(tileset->imageSource());
+        }
 
         delete tileset;
+
+        TILED_TRACE_COUNTER("Tilesets", mTilesets.size());
     }
 }
 
@@ -144,7 +207,12 @@ void TilesetManager::forceTilesetReload(Tileset *tileset)
     if (!mTilesets.contains(tileset))
         return;
 
+    TILED_TRACE_SCOPE_DETAIL("TilesetManager::reloadTileset",
+                             tileset->imageSource());
+
     QString fileName = tileset->imageSource();
+    mImageHashes.remove(fileName);
+    MapSaver::waitForSaves(tileset);
     if (tileset->loadFromImage(fileName))
         emit tilesetChanged(tileset);
 }
@@ -169,43 +237,96 @@ bool TilesetManager::animateTiles() const
     return mAnimationDriver->state() == QAbstractAnimation::Running;
 }
 
-void TilesetManager::fileChanged(const QString &path)
+/**
+ * The watcher only reports the changes once they have settled, since GIMP
+ * (for example) seems to generate many file changes during a save, and some
+ * of the intermediate attempts to reload the tileset images actually fail
+ * (at least for .png files). The changed images are then decoded in parallel.
+ */
+void TilesetManager::filesChanged(const QStringList &paths)
 {
     if (!mReloadTilesetsOnChange)
         return;
 
-    /*
-     * Use a one-shot timer since GIMP (for example) seems to generate many
-     * file changes during a save, and some of the intermediate attempts to
-     * reload the tileset images actually fail (at least for .png files).
-     */
-    mChangedFiles.insert(path);
-    mChangedFilesTimer.start();
+    QSet<QString> imageSources;
+    foreach (Tileset *tileset, tilesets())
+        imageSources.insert(tileset->imageSource());
+
+    foreach (const QString &fileName, paths) {
+        if (!imageSources.contains(fileName))
+            continue;
+
+        // Decode again once the current decoding of this file has finished
+        if (mImageDecoders.contains(fileName)) {
+            mDecodeAgain.insert(fileName);
+            continue;
+        }
+
+        startDecoding(fileName);
+    }
 }
 
-void TilesetManager::fileChangedTimeout()
+/**
+ * Starts decoding the given image on a worker thread. The images of
+ * different tilesets are decoded in parallel.
+ */
+void TilesetManager::startDecoding(const QString &fileName)
 {
+    TilesetImageDecoder *decoder = new TilesetImageDecoder(fileName, this);
+    mImageDecoders.insert(fileName, decoder);
+    connect(decoder, SIGNAL(finished()), SLOT(imageDecoded()));
+    decoder->start();
+}
+
+void TilesetManager::imageDecoded()
+{
+    TilesetImageDecoder *decoder = static_cast<TilesetImageDecoder*>(sender());
+    const QString fileName = decoder->fileName();
+    const QImage image = decoder->image();
+    const uint hash = decoder->hash();
+
+    mImageDecoders.remove(fileName);
+    decoder->deleteLater();
+
+    // The file changed again while it was being decoded
+    if (mDecodeAgain.remove(fileName)) {
+        startDecoding(fileName);
+        return;
+    }
+
+    // Intermediate states during a save may fail to decode
+    if (image.isNull())
+        return;
+
+    // Saving the image without changing it doesn't need a reload
+    QHash<QString, uint>::const_iterator it = mImageHashes.constFind(fileName);
+    if (it != mImageHashes.constEnd() && it.value() == hash)
+        return;
+
+    mImageHashes.insert(fileName, hash);
+
+    TILED_TRACE_SCOPE_DETAIL("TilesetManager::reloadTileset", fileName);
+
     foreach (Tileset *tileset, tilesets()) {
-        QString fileName = tileset->imageSource();
-        if (mChangedFiles.contains(fileName))
-            if (tileset->loadFromImage(fileName))
+        if (tileset->imageSource() == fileName) {
+            MapSaver::waitForSaves(tileset);
+            if (tileset->loadFromImage(image, fileName))
                 emit tilesetChanged(tileset);
+        }
     }
-
-    mChangedFiles.clear();
 }
 
 void TilesetManager::advanceTileAnimations(int ms)
 {
-    // TODO: This could be more optimal by keeping track of the list of
-    // actually animated tiles
-    foreach (Tileset *tileset, tilesets()) {
-        bool imageChanged = false;
+    QSet<Tile*> changedTiles;
 
-        foreach (Tile *tile, tileset->tiles())
-            imageChanged |= tile->advanceAnimation(ms);
+    mAnimationTime += ms;
 
-        if (imageChanged)
-            emit repaintTileset(tileset);
-    }
+    foreach (Tileset *tileset, tilesets())
+        foreach (Tile *tile, tileset->animatedTiles())
+            if (tile->advanceAnimation(ms))
+                changedTiles.insert(tile);
+
+    if (!changedTiles.isEmpty())
+        emit repaintTiles(changedTiles);
 }
@@ -23,20 +23,23 @@
 #define TILESETMANAGER_H
 
 #include <QObject>
+#include <QHash>
 #include <QList>
 #include <QMap>
 #include <QString>
 #include <QSet>
-#include <QTimer>
+#include <QStringList>
 
 namespace Tiled {
 
+class Tile;
 class Tileset;
 
 namespace Internal {
 
 class FileSystemWatcher;
 class TileAnimationDriver;
+class TilesetImageDecoder;
 
 /**
  * A tileset specification that uniquely identifies a certain tileset. Does not
@@ -131,6 +134,12 @@ public:
     void setAnimateTiles(bool enabled);
     bool animateTiles() const;
 
+    /**
+     * Returns the total time in milliseconds by which the tile animations
+     * have been advanced.
+     */
+    qint64 animationTime() const { return mAnimationTime; }
+
 signals:
     /**
      * Emitted when a tileset's images have changed and views need updating.
@@ -138,15 +147,15 @@ signals:
     void tilesetChanged(Tileset *tileset);
 
     /**
-     * Emitted when any images of the tiles in the given \a tileset have
+     * Emitted when the current frame of the given animated \a tiles has
      * changed. This is used to trigger repaints for displaying tile
      * animations.
      */
-    void repaintTileset(Tileset *tileset);
+    void repaintTiles(const QSet<Tile*> &tiles);
 
 private slots:
-    void fileChanged(const QString &path);
-    void fileChangedTimeout();
+    void filesChanged(const QStringList &paths);
+    void imageDecoded();
 
     void advanceTileAnimations(int ms);
 
@@ -163,6 +172,8 @@ private:
      */
     ~TilesetManager();
 
+    void startDecoding(const QString &fileName);
+
     static TilesetManager *mInstance;
 
     /**
@@ -171,8 +182,10 @@ private:
     QMap<Tileset*, int> mTilesets;
     FileSystemWatcher *mWatcher;
     TileAnimationDriver *mAnimationDriver;
-    QSet<QString> mChangedFiles;
-    QTimer mChangedFilesTimer;
+    qint64 mAnimationTime;
+    QMap<QString, TilesetImageDecoder*> mImageDecoders;
+    QSet<QString> mDecodeAgain;
+    QHash<QString, uint> mImageHashes;
     bool mReloadTilesetsOnChange;
 };
 
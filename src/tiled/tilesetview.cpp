@@ -216,10 +216,9 @@ void TileDelegate::paint(QPainter *painter,
     if (!tile)
         return;
 
-    const QPixmap &tileImage = tile->image();
     const int extra = mTilesetView->drawGrid() ? 1 : 0;
     const qreal zoom = mTilesetView->scale();
-    const QSize tileSize = tileImage.size() * zoom;
+    const QSize tileSize = tile->size() * zoom;
 
     // Compute rectangle to draw the image in: bottom- and left-aligned
     QRect targetRect = option.rect.adjusted(0, 0, -extra, -extra);
@@ -231,7 +230,14 @@ void TileDelegate::paint(QPainter *painter,
         if (zoomable->smoothTransform())
             painter->setRenderHint(QPainter::SmoothPixmapTransform);
 
-    painter->drawPixmap(targetRect, tileImage);
+    // Draw from the tileset image when possible, since the tile pixmaps are
+    // only created when needed
+    const Tileset *tileset = tile->tileset();
+    const QRect sourceRect = tileset->imageRect(tile->id());
+    if (!sourceRect.isNull())
+        painter->drawPixmap(targetRect, tileset->image(), sourceRect);
+    else
+        painter->drawPixmap(targetRect, tile->image());
 
     // Overlay with film strip when animated
     if (mTilesetView->markAnimatedTiles() && tile->isAnimated()) {
@@ -314,6 +320,30 @@ QSize TileDelegate::sizeHint(const QStyleOptionViewItem & /* option */,
     return QSize(extra, extra);
 }
 
+/**
+ * Returns whether all tiles of the given tileset are displayed at the same
+ * size, which is the case for tilesets based on a single image.
+ */
+static bool hasUniformTileSize(const Tileset *tileset)
+{
+#if QT_VERSION >= 0x050200
+    return !tileset->imageSource().isEmpty();
+#else
+    Q_UNUSED(tileset)
+    return true;
+#endif
+}
+
+static void setSectionResizeMode(QHeaderView *header,
+                                 QHeaderView::ResizeMode mode)
+{
+#if QT_VERSION >= 0x050000
+    header->setSectionResizeMode(mode);
+#else
+    header->setResizeMode(mode);
+#endif
+}
+
 } // anonymous namespace
 
 
@@ -326,7 +356,6 @@ TilesetView::TilesetView(QWidget *parent)
     , mEraseTerrain(false)
     , mTerrainId(-1)
     , mHoveredCorner(0)
-    , mTerrainChanged(false)
 {
     setHorizontalScrollMode(QAbstractItemView::ScrollPerPixel);
     setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
@@ -337,13 +366,8 @@ TilesetView::TilesetView(QWidget *parent)
     QHeaderView *vHeader = verticalHeader();
     hHeader->hide();
     vHeader->hide();
-#if QT_VERSION >= 0x050000
-    hHeader->setSectionResizeMode(QHeaderView::ResizeToContents);
-    vHeader->setSectionResizeMode(QHeaderView::ResizeToContents);
-#else
-    hHeader->setResizeMode(QHeaderView::ResizeToContents);
-    vHeader->setResizeMode(QHeaderView::ResizeToContents);
-#endif
+    setSectionResizeMode(hHeader, QHeaderView::ResizeToContents);
+    setSectionResizeMode(vHeader, QHeaderView::ResizeToContents);
     hHeader->setMinimumSectionSize(1);
     vHeader->setMinimumSectionSize(1);
 
@@ -370,16 +394,27 @@ QSize TilesetView::sizeHint() const
     return QSize(130, 100);
 }
 
+void TilesetView::setModel(QAbstractItemModel *model)
+{
+    if (QAbstractItemModel *previousModel = QTableView::model())
+        disconnect(previousModel, SIGNAL(modelReset()),
+                   this, SLOT(updateSectionSizes()));
+
+    QTableView::setModel(model);
+
+    if (model)
+        connect(model, SIGNAL(modelReset()), SLOT(updateSectionSizes()));
+
+    updateSectionSizes();
+}
+
 int TilesetView::sizeHintForColumn(int column) const
 {
-    Q_UNUSED(column)
     const TilesetModel *model = tilesetModel();
     if (!model)
         return -1;
-#if QT_VERSION >= 0x050200
-    if (model->tileset()->imageSource().isEmpty())
+    if (!hasUniformTileSize(model->tileset()))
         return QTableView::sizeHintForColumn(column);
-#endif
 
     const int tileWidth = model->tileset()->tileWidth();
     return qRound(tileWidth * scale()) + (mDrawGrid ? 1 : 0);
@@ -387,14 +422,11 @@ int TilesetView::sizeHintForColumn(int column) const
 
 int TilesetView::sizeHintForRow(int row) const
 {
-    Q_UNUSED(row)
     const TilesetModel *model = tilesetModel();
     if (!model)
         return -1;
-#if QT_VERSION >= 0x050200
-    if (model->tileset()->imageSource().isEmpty())
+    if (!hasUniformTileSize(model->tileset()))
         return QTableView::sizeHintForRow(row);
-#endif
 
     const int tileHeight = model->tileset()->tileHeight();
     return qRound(tileHeight * scale()) + (mDrawGrid ? 1 : 0);
@@ -525,6 +557,15 @@ void TilesetView::leaveEvent(QEvent *event)
     QTableView::leaveEvent(event);
 }
 
+/**
+ * Makes sure a terrain change in progress ends up on the undo stack.
+ */
+void TilesetView::hideEvent(QHideEvent *event)
+{
+    finishTerrainChange();
+    QTableView::hideEvent(event);
+}
+
 /**
  * Override to support zooming in and out using the mouse wheel.
  */
@@ -623,14 +664,50 @@ void TilesetView::editTileProperties()
 void TilesetView::setDrawGrid(bool drawGrid)
 {
     mDrawGrid = drawGrid;
-    if (TilesetModel *model = tilesetModel())
-        model->tilesetChanged();
+    adjustScale();
 }
 
 void TilesetView::adjustScale()
 {
-    if (TilesetModel *model = tilesetModel())
+    TilesetModel *model = tilesetModel();
+    if (!model)
+        return;
+
+    // When all tiles have the same size, only the section sizes change
+    if (hasUniformTileSize(model->tileset())) {
+        updateSectionSizes();
+        updateGeometries();
+        viewport()->update();
+    } else {
         model->tilesetChanged();
+    }
+}
+
+/**
+ * When all tiles have the same size, the sections are given a fixed size
+ * instead of asking the size of each tile, which is slow for tilesets with
+ * many tiles.
+ */
+void TilesetView::updateSectionSizes()
+{
+    QHeaderView *hHeader = horizontalHeader();
+    QHeaderView *vHeader = verticalHeader();
+
+    const TilesetModel *model = tilesetModel();
+    if (!model || !hasUniformTileSize(model->tileset())) {
+        setSectionResizeMode(hHeader, QHeaderView::ResizeToContents);
+        setSectionResizeMode(vHeader, QHeaderView::ResizeToContents);
+        return;
+    }
+
+    setSectionResizeMode(hHeader, QHeaderView::Fixed);
+    setSectionResizeMode(vHeader, QHeaderView::Fixed);
+    hHeader->setDefaultSectionSize(sizeHintForColumn(0));
+    vHeader->setDefaultSectionSize(sizeHintForRow(0));
+
+    // Resetting the headers applies the default size to all sections
+    hHeader->reset();
+    vHeader->reset();
 }
 
 void TilesetView::applyTerrain()
@@ -649,19 +726,40 @@ void TilesetView::applyTerrain()
     if (terrain == tile->terrain())
         return;
 
-    QUndoCommand *command = new ChangeTileTerrain(mMapDocument, tile, terrain);
-    mMapDocument->undoStack()->push(command);
-    mTerrainChanged = true;
+    ChangeTileTerrain::Changes::iterator change = mTerrainChanges.find(tile);
+    if (change != mTerrainChanges.end())
+        change->to = terrain;
+    else
+        mTerrainChanges.insert(tile, ChangeTileTerrain::Change(tile->terrain(),
+                                                               terrain));
+
+    // While dragging, the change is applied to the tile and only this tile is
+    // reported as changed. A single undo command is pushed when the mouse is
+    // released.
+    tile->setTerrain(terrain);
+    mMapDocument->emitTileTerrainChanged(QList<Tile*>() << tile);
 }
 
 void TilesetView::finishTerrainChange()
 {
-    if (!mTerrainChanged)
+    ChangeTileTerrain::Changes changes;
+
+    ChangeTileTerrain::Changes::const_iterator i = mTerrainChanges.constBegin();
+    ChangeTileTerrain::Changes::const_iterator i_end = mTerrainChanges.constEnd();
+    for (; i != i_end; ++i)
+        if (i.value().from != i.value().to)
+            changes.insert(i.key(), i.value());
+
+    mTerrainChanges.clear();
+
+    if (changes.isEmpty())
         return;
 
+    QUndoStack *undoStack = mMapDocument->undoStack();
+    undoStack->push(new ChangeTileTerrain(mMapDocument, changes));
+
     // Prevent further merging since mouse was released
-    mMapDocument->undoStack()->push(new ChangeTileTerrain);
-    mTerrainChanged = false;
+    undoStack->push(new ChangeTileTerrain);
 }
 
 Tile *TilesetView::currentTile() const
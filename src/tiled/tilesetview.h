@@ -21,6 +21,7 @@
 #ifndef TILESETVIEW_H
 #define TILESETVIEW_H
 
+#include "changetileterrain.h"
 #include "tilesetmodel.h"
 
 #include <QTableView>
@@ -49,6 +50,8 @@ public:
 
     QSize sizeHint() const;
 
+    void setModel(QAbstractItemModel *model);
+
     int sizeHintForColumn(int column) const;
     int sizeHintForRow(int row) const;
 
@@ -119,6 +122,7 @@ protected:
     void mouseMoveEvent(QMouseEvent *event);
     void mouseReleaseEvent(QMouseEvent *event);
     void leaveEvent(QEvent *);
+    void hideEvent(QHideEvent *);
     void wheelEvent(QWheelEvent *event);
     void contextMenuEvent(QContextMenuEvent *event);
 
@@ -129,6 +133,7 @@ private slots:
     void setDrawGrid(bool drawGrid);
 
     void adjustScale();
+    void updateSectionSizes();
 
 private:
     void applyTerrain();
@@ -145,7 +150,7 @@ private:
     int mTerrainId;
     QModelIndex mHoveredIndex;
     int mHoveredCorner;
-    bool mTerrainChanged;
+    ChangeTileTerrain::Changes mTerrainChanges;
 };
 
 inline bool TilesetView::markAnimatedTiles() const
@@ -0,0 +1,63 @@
+/*
+ * tilestamp.cpp
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tilestamp.h"
+
+#include "tilelayer.h"
+
+using namespace Tiled;
+using namespace Tiled::Internal;
+
+class TileStamp::Data
+{
+public:
+    explicit Data(TileLayer *tileLayer)
+        : tileLayer(tileLayer)
+        , region(tileLayer->region())
+    {}
+
+    ~Data() { delete tileLayer; }
+
+    TileLayer * const tileLayer;
+    const QRegion region;
+
+private:
+    Q_DISABLE_COPY(Data)
+};
+
+TileStamp::TileStamp()
+{
+}
+
+TileStamp::TileStamp(TileLayer *tileLayer)
+{
+    if (tileLayer)
+        d = QSharedPointer<const Data>(new Data(tileLayer));
+}
+
+const TileLayer *TileStamp::tileLayer() const
+{
+    return d ? d->tileLayer : 0;
+}
+
+QRegion TileStamp::region() const
+{
+    return d ? d->region : QRegion();
+}
@@ -0,0 +1,80 @@
+/*
+ * tilestamp.h
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TILESTAMP_H
+#define TILESTAMP_H
+
+#include <QRegion>
+#include <QSharedPointer>
+
+namespace Tiled {
+
+class TileLayer;
+
+namespace Internal {
+
+/**
+ * A stamp of tiles, as used by the stamp brush, the bucket fill tool and the
+ * quick stamps. Stamps are immutable and implicitly shared, so passing them
+ * around doesn't copy the tiles. To change a stamp, a modified clone of its
+ * tile layer is wrapped in a new stamp.
+ *
+ * The region covered by the tiles is computed once, when the stamp is
+ * created, since this requires looking at every cell.
+ */
+class TileStamp
+{
+public:
+    /**
+     * Creates a null stamp.
+     */
+    TileStamp();
+
+    /**
+     * Creates a stamp from the given \a tileLayer, taking ownership over it.
+     * The tile layer should not be modified afterwards.
+     */
+    explicit TileStamp(TileLayer *tileLayer);
+
+    bool isNull() const { return !d; }
+
+    /**
+     * Returns the tile layer of this stamp, or 0 for a null stamp.
+     */
+    const TileLayer *tileLayer() const;
+
+    /**
+     * Returns the region occupied by the tiles of this stamp, in the
+     * coordinates of its tile layer.
+     */
+    QRegion region() const;
+
+    bool operator==(const TileStamp &other) const { return d == other.d; }
+    bool operator!=(const TileStamp &other) const { return d != other.d; }
+
+private:
+    class Data;
+    QSharedPointer<const Data> d;
+};
+
+} // namespace Internal
+} // namespace Tiled
+
+#endif // TILESTAMP_H
@@ -0,0 +1,241 @@
+/*
+ * tilestatisticsdock.cpp
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tilestatisticsdock.h"
+
+#include "map.h"
+#include "mapdocument.h"
+#include "tile.h"
+#include "tilelayer.h"
+#include "tileset.h"
+
+#include <QEvent>
+#include <QHeaderView>
+#include <QMap>
+#include <QSet>
+#include <QTimer>
+#include <QTreeWidget>
+
+using namespace Tiled;
+using namespace Tiled::Internal;
+
+static QString formatShare(int count, qint64 total)
+{
+    if (total <= 0)
+        return QString();
+    return QString::number(100.0 * count / total, 'f', 1) + QLatin1Char('%');
+}
+
+static QTreeWidgetItem *addRow(QTreeWidgetItem *parent,
+                               const QString &name,
+                               int count,
+                               const QString &share)
+{
+    QTreeWidgetItem *item = new QTreeWidgetItem(parent);
+    item->setText(0, name);
+    item->setText(1, QString::number(count));
+    item->setText(2, share);
+    item->setTextAlignment(1, Qt::AlignRight | Qt::AlignVCenter);
+    item->setTextAlignment(2, Qt::AlignRight | Qt::AlignVCenter);
+    return item;
+}
+
+TileStatisticsDock::TileStatisticsDock(QWidget *parent)
+    : QDockWidget(parent)
+    , mMapDocument(0)
+    , mTreeWidget(new QTreeWidget(this))
+    , mUpdateTimer(new QTimer(this))
+{
+    setObjectName(QLatin1String("TileStatisticsDock"));
+
+    mTreeWidget->setColumnCount(3);
+    mTreeWidget->setRootIsDecorated(true);
+    mTreeWidget->setUniformRowHeights(true);
+    mTreeWidget->header()->setStretchLastSection(false);
+
+    // Edits often come in quick succession, for example while painting
+    mUpdateTimer->setSingleShot(true);
+    mUpdateTimer->setInterval(100);
+    connect(mUpdateTimer, SIGNAL(timeout()), SLOT(updateStatistics()));
+
+    connect(this, SIGNAL(visibilityChanged(bool)), SLOT(scheduleUpdate()));
+
+    setWidget(mTreeWidget);
+    retranslateUi();
+}
+
+void TileStatisticsDock::setMapDocument(MapDocument *mapDocument)
+{
+    if (mMapDocument == mapDocument)
+        return;
+
+    if (mMapDocument)
+        mMapDocument->disconnect(this);
+
+    mMapDocument = mapDocument;
+
+    if (mMapDocument) {
+        connect(mMapDocument, SIGNAL(mapChanged()), SLOT(scheduleUpdate()));
+        connect(mMapDocument, SIGNAL(regionChanged(QRegion)),
+                SLOT(scheduleUpdate()));
+        connect(mMapDocument, SIGNAL(layerAdded(int)), SLOT(scheduleUpdate()));
+        connect(mMapDocument, SIGNAL(layerRemoved(int)), SLOT(scheduleUpdate()));
+        connect(mMapDocument, SIGNAL(layerRenamed(int)), SLOT(scheduleUpdate()));
+        connect(mMapDocument, SIGNAL(layerChanged(int)), SLOT(scheduleUpdate()));
+        connect(mMapDocument, SIGNAL(tilesetAdded(int,Tileset*)),
+                SLOT(scheduleUpdate()));
+        connect(mMapDocument, SIGNAL(tilesetRemoved(Tileset*)),
+                SLOT(scheduleUpdate()));
+        connect(mMapDocument, SIGNAL(tilesetMoved(int,int)),
+                SLOT(scheduleUpdate()));
+        connect(mMapDocument, SIGNAL(tilesetNameChanged(Tileset*)),
+                SLOT(scheduleUpdate()));
+        connect(mMapDocument, SIGNAL(tilesetChanged(Tileset*)),
+                SLOT(scheduleUpdate()));
+    }
+
+    if (isVisible())
+        updateStatistics();
+    else
+        mTreeWidget->clear();
+}
+
+void TileStatisticsDock::changeEvent(QEvent *e)
+{
+    QDockWidget::changeEvent(e);
+    switch (e->type()) {
+    case QEvent::LanguageChange:
+        retranslateUi();
+        break;
+    default:
+        break;
+    }
+}
+
+void TileStatisticsDock::scheduleUpdate()
+{
+    if (isVisible())
+        mUpdateTimer->start();
+}
+
+/**
+ * Fills the tree from the usage counts of the tile layers. Only the used
+ * tilesets and tiles are looked at, so this is cheap even for large maps.
+ */
+void TileStatisticsDock::updateStatistics()
+{
+    mUpdateTimer->stop();
+
+    // Remember which tilesets were expanded, so that updating doesn't
+    // collapse them again
+    QSet<QString> expandedTilesets;
+    QTreeWidgetItem *oldTilesetsItem = mTreeWidget->topLevelItem(1);
+    if (oldTilesetsItem) {
+        for (int i = 0; i < oldTilesetsItem->childCount(); ++i) {
+            QTreeWidgetItem *item = oldTilesetsItem->child(i);
+            if (item->isExpanded())
+                expandedTilesets.insert(item->text(0));
+        }
+    }
+
+    mTreeWidget->clear();
+
+    if (!mMapDocument)
+        return;
+
+    const Map *map = mMapDocument->map();
+
+    QTreeWidgetItem *layersItem = new QTreeWidgetItem(mTreeWidget);
+    layersItem->setText(0, tr("Tile Layers"));
+    layersItem->setFirstColumnSpanned(true);
+
+    QHash<Tileset*, int> tilesetCounts;
+    QHash<Tile*, int> tileCounts;
+    qint64 usedCells = 0;
+
+    foreach (const TileLayer *tileLayer, map->tileLayers()) {
+        const int count = tileLayer->usedCellCount();
+        const qint64 cells = qint64(tileLayer->width()) * tileLayer->height();
+        addRow(layersItem, tileLayer->name(), count, formatShare(count, cells));
+
+        if (count == 0)
+            continue;
+
+        usedCells += count;
+
+        const QHash<Tileset*, int> tilesets = tileLayer->tilesetUsage();
+        QHash<Tileset*, int>::const_iterator it = tilesets.begin();
+        for (; it != tilesets.end(); ++it)
+            tilesetCounts[it.key()] += it.value();
+
+        const QHash<Tile*, int> tiles = tileLayer->tileUsage();
+        QHash<Tile*, int>::const_iterator tileIt = tiles.begin();
+        for (; tileIt != tiles.end(); ++tileIt)
+            tileCounts[tileIt.key()] += tileIt.value();
+    }
+
+    // Group the used tiles by tileset, ordered by their ID
+    QHash<Tileset*, QMap<int, int> > tilesByTileset;
+    QHash<Tile*, int>::const_iterator tileIt = tileCounts.begin();
+    for (; tileIt != tileCounts.end(); ++tileIt) {
+        Tile *tile = tileIt.key();
+        tilesByTileset[tile->tileset()].insert(tile->id(), tileIt.value());
+    }
+
+    QTreeWidgetItem *tilesetsItem = new QTreeWidgetItem(mTreeWidget);
+    tilesetsItem->setText(0, tr("Tilesets"));
+    tilesetsItem->setFirstColumnSpanned(true);
+
+    foreach (Tileset *tileset, map->tilesets()) {
+        const int count = tilesetCounts.value(tileset);
+        QTreeWidgetItem *tilesetItem = addRow(tilesetsItem, tileset->name(),
+                                              count,
+                                              formatShare(count, usedCells));
+
+        const QMap<int, int> tiles = tilesByTileset.value(tileset);
+        QMap<int, int>::const_iterator it = tiles.begin();
+        for (; it != tiles.end(); ++it) {
+            addRow(tilesetItem, tr("Tile %1").arg(it.key()), it.value(),
+                   formatShare(it.value(), count));
+        }
+
+        if (expandedTilesets.contains(tileset->name()))
+            tilesetItem->setExpanded(true);
+    }
+
+    layersItem->setExpanded(true);
+    tilesetsItem->setExpanded(true);
+
+    mTreeWidget->resizeColumnToContents(1);
+    mTreeWidget->resizeColumnToContents(2);
+}
+
+void TileStatisticsDock::retranslateUi()
+{
+    setWindowTitle(tr("Tile Statistics"));
+
+    mTreeWidget->setHeaderLabels(QStringList()
+                                 << tr("Name")
+                                 << tr("Cells")
+                                 << tr("Share"));
+
+    if (mMapDocument)
+        scheduleUpdate();
+}
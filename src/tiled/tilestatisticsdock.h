@@ -0,0 +1,68 @@
+/*
+ * tilestatisticsdock.h
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TILESTATISTICSDOCK_H
+#define TILESTATISTICSDOCK_H
+
+#include <QDockWidget>
+
+class QTimer;
+class QTreeWidget;
+
+namespace Tiled {
+namespace Internal {
+
+class MapDocument;
+
+/**
+ * Shows how often each tileset and tile is used by the tile layers of the
+ * current map, and how much of each tile layer is filled.
+ *
+ * The numbers come from the usage counts kept by the tile layers themselves,
+ * so updating them after an edit doesn't require looking at the cells.
+ */
+class TileStatisticsDock : public QDockWidget
+{
+    Q_OBJECT
+
+public:
+    TileStatisticsDock(QWidget *parent = 0);
+
+    void setMapDocument(MapDocument *mapDocument);
+
+protected:
+    void changeEvent(QEvent *e);
+
+private slots:
+    void scheduleUpdate();
+    void updateStatistics();
+
+private:
+    void retranslateUi();
+
+    MapDocument *mMapDocument;
+    QTreeWidget *mTreeWidget;
+    QTimer *mUpdateTimer;
+};
+
+} // namespace Internal
+} // namespace Tiled
+
+#endif // TILESTATISTICSDOCK_H
@@ -37,6 +37,27 @@ namespace {
 
 class EditorMapReader : public MapReader
 {
+public:
+    EditorMapReader()
+        : mUseTilesetManager(true)
+    {
+        setParallelLayerDecoding(true);
+        setParallelImageDecoding(true);
+        setLazyLayerDecoding(true);
+        setMemoryMappingEnabled(true);
+    }
+
+    /**
+     * Prepares the reader for use on a worker thread. The TilesetManager is
+     * not consulted and the pixmaps are only created by
+     * loadDeferredImages().
+     */
+    void setReadingOnWorkerThread()
+    {
+        mUseTilesetManager = false;
+        setDeferredImageLoading(true);
+    }
+
 protected:
     /**
      * Overridden to make sure the resolved reference is a clean path.
@@ -54,8 +75,9 @@ protected:
     Tileset *readExternalTileset(const QString &source, QString *error)
     {
         // Check if this tileset is already loaded
-        TilesetManager *manager = TilesetManager::instance();
-        Tileset *tileset = manager->findTileset(source);
+        Tileset *tileset = 0;
+        if (mUseTilesetManager)
+            tileset = TilesetManager::instance()->findTileset(source);
 
         // If not, try to load it
         if (!tileset)
@@ -63,15 +85,30 @@ protected:
 
         return tileset;
     }
+
+private:
+    bool mUseTilesetManager;
 };
 
 } // anonymous namespace
 
-Map *TmxMapReader::read(const QString &fileName)
+TmxMapReader::TmxMapReader()
+    : mDeferredReader(0)
+{
+}
+
+TmxMapReader::~TmxMapReader()
+{
+    delete mDeferredReader;
+}
+
+Map *TmxMapReader::read(const QString &fileName,
+                        ProgressContext *progress)
 {
     mError.clear();
 
     EditorMapReader reader;
+    reader.setProgressContext(progress);
     Map *map = reader.readMap(fileName);
     if (!map)
         mError = reader.errorString();
@@ -79,6 +116,48 @@ Map *TmxMapReader::read(const QString &fileName)
     return map;
 }
 
+Map *TmxMapReader::readDeferred(const QString &fileName)
+{
+    mError.clear();
+
+    EditorMapReader *reader = new EditorMapReader;
+    reader->setReadingOnWorkerThread();
+
+    Map *map = reader->readMap(fileName);
+    if (map) {
+        delete mDeferredReader;
+        mDeferredReader = reader;
+    } else {
+        mError = reader->errorString();
+        delete reader;
+    }
+
+    return map;
+}
+
+void TmxMapReader::finishDeferredRead(Map *map)
+{
+    Q_ASSERT(mDeferredReader);
+
+    mDeferredReader->loadDeferredImages();
+    delete mDeferredReader;
+    mDeferredReader = 0;
+
+    // Share the external tilesets that are already loaded, as read() does
+    TilesetManager *manager = TilesetManager::instance();
+    foreach (Tileset *tileset, map->tilesets()) {
+        if (tileset->fileName().isEmpty())
+            continue;
+
+        if (Tileset *loaded = manager->findTileset(tileset->fileName())) {
+            map->replaceTileset(tileset, loaded);
+            delete tileset;
+        }
+    }
+
+    map->recomputeDrawMargins();
+}
+
 Map *TmxMapReader::fromByteArray(const QByteArray &data)
 {
     mError.clear();
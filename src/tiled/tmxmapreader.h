@@ -28,6 +28,7 @@
 
 namespace Tiled {
 
+class MapReader;
 class Tileset;
 
 namespace Internal {
@@ -40,7 +41,25 @@ class TmxMapReader : public MapReaderInterface
     Q_DECLARE_TR_FUNCTIONS(TmxMapReader)
 
 public:
-    Map *read(const QString &fileName);
+    TmxMapReader();
+    ~TmxMapReader();
+
+    Map *read(const QString &fileName,
+              ProgressContext *progress = 0);
+
+    /**
+     * Reads the map like read(), but in a way that is safe on a worker
+     * thread. No pixmaps are created and already loaded tilesets are not
+     * shared yet, so the map can't be used until finishDeferredRead() has
+     * been called on the GUI thread.
+     */
+    Map *readDeferred(const QString &fileName);
+
+    /**
+     * Finishes loading the \a map returned by readDeferred(). Needs to be
+     * called on the GUI thread.
+     */
+    void finishDeferredRead(Map *map);
 
     /**
      * Reads the map given by \a data. This is for retrieving a map from the
@@ -60,7 +79,10 @@ public:
     QString errorString() const { return mError; }
 
 private:
+    Q_DISABLE_COPY(TmxMapReader)
+
     QString mError;
+    MapReader *mDeferredReader;
 };
 
 } // namespace Internal
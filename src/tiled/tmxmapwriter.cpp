@@ -29,12 +29,23 @@
 using namespace Tiled;
 using namespace Tiled::Internal;
 
-bool TmxMapWriter::write(const Map *map, const QString &fileName)
+TmxMapWriter::TmxMapWriter()
+    : mLayerDataCache(0)
+{
+}
+
+bool TmxMapWriter::write(const Map *map, const QString &fileName,
+                         ProgressContext *progress)
 {
     Preferences *prefs = Preferences::instance();
 
     MapWriter writer;
     writer.setDtdEnabled(prefs->dtdEnabled());
+    writer.setParallelLayerEncoding(true);
+    writer.setCompressionLevel(prefs->compressionLevel());
+    writer.setCompressionStrategy(prefs->compressionStrategy());
+    writer.setLayerDataCache(mLayerDataCache);
+    writer.setProgressContext(progress);
 
     bool result = writer.writeMap(map, fileName);
     if (!result)
@@ -28,6 +28,7 @@
 
 namespace Tiled {
 
+class LayerDataCache;
 class Tileset;
 
 namespace Internal {
@@ -40,7 +41,10 @@ class TmxMapWriter : public MapWriterInterface
     Q_DECLARE_TR_FUNCTIONS(TmxMapReader)
 
 public:
-    bool write(const Map *map, const QString &fileName);
+    TmxMapWriter();
+
+    bool write(const Map *map, const QString &fileName,
+               ProgressContext *progress = 0);
 
     bool writeTileset(const Tileset *tileset, const QString &fileName);
 
@@ -57,8 +61,15 @@ public:
 
     QString errorString() const { return mError; }
 
+    /**
+     * Sets the cache used to avoid encoding unchanged tile layers again
+     * when writing a map. The cache is not owned by the writer.
+     */
+    void setLayerDataCache(LayerDataCache *cache) { mLayerDataCache = cache; }
+
 private:
     QString mError;
+    LayerDataCache *mLayerDataCache;
 };
 
 } // namespace Internal
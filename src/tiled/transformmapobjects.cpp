@@ -0,0 +1,78 @@
+/*
+ * transformmapobjects.cpp
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "transformmapobjects.h"
+
+#include "mapdocument.h"
+#include "mapobject.h"
+#include "mapobjectmodel.h"
+
+using namespace Tiled;
+using namespace Tiled::Internal;
+
+TransformState::TransformState(const MapObject *mapObject)
+    : position(mapObject->position())
+    , size(mapObject->size())
+    , polygon(mapObject->polygon())
+    , rotation(mapObject->rotation())
+{
+}
+
+TransformMapObjects::TransformMapObjects(MapDocument *mapDocument,
+                                         const QList<MapObject *> &mapObjects,
+                                         const QVector<TransformState> &oldStates,
+                                         const QString &text)
+    : QUndoCommand(text)
+    , mMapDocument(mapDocument)
+    , mMapObjects(mapObjects)
+    , mOldStates(oldStates)
+{
+    Q_ASSERT(mMapObjects.size() == mOldStates.size());
+
+    mNewStates.reserve(mMapObjects.size());
+    foreach (const MapObject *mapObject, mMapObjects)
+        mNewStates.append(TransformState(mapObject));
+}
+
+void TransformMapObjects::undo()
+{
+    setStates(mOldStates);
+}
+
+void TransformMapObjects::redo()
+{
+    setStates(mNewStates);
+}
+
+void TransformMapObjects::setStates(const QVector<TransformState> &states)
+{
+    for (int i = 0; i < mMapObjects.size(); ++i) {
+        MapObject *mapObject = mMapObjects.at(i);
+        const TransformState &state = states.at(i);
+
+        mapObject->setPosition(state.position);
+        mapObject->setSize(state.size);
+        mapObject->setPolygon(state.polygon);
+        mapObject->setRotation(state.rotation);
+    }
+
+    mMapDocument->mapObjectModel()->emitObjectsChanged(mMapObjects);
+}
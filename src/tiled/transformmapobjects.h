@@ -0,0 +1,89 @@
+/*
+ * transformmapobjects.h
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef TRANSFORMMAPOBJECTS_H
+#define TRANSFORMMAPOBJECTS_H
+
+#include <QList>
+#include <QPointF>
+#include <QPolygonF>
+#include <QSizeF>
+#include <QUndoCommand>
+#include <QVector>
+
+namespace Tiled {
+
+class MapObject;
+
+namespace Internal {
+
+class MapDocument;
+
+/**
+ * The position, size, polygon and rotation of a map object.
+ */
+struct TransformState
+{
+    TransformState()
+        : rotation(0)
+    {}
+
+    explicit TransformState(const MapObject *mapObject);
+
+    QPointF position;
+    QSizeF size;
+    QPolygonF polygon;
+    qreal rotation;
+};
+
+/**
+ * A command that moves, resizes and/or rotates any number of map objects at
+ * once. The change is announced with a single objectsChanged signal, so
+ * that large selections don't cause a refresh for each object.
+ */
+class TransformMapObjects : public QUndoCommand
+{
+public:
+    /**
+     * Constructs a command that changes the \a mapObjects from their
+     * \a oldStates to their current state.
+     */
+    TransformMapObjects(MapDocument *mapDocument,
+                        const QList<MapObject*> &mapObjects,
+                        const QVector<TransformState> &oldStates,
+                        const QString &text);
+
+    void undo();
+    void redo();
+
+private:
+    void setStates(const QVector<TransformState> &states);
+
+    MapDocument *mMapDocument;
+    QList<MapObject*> mMapObjects;
+    QVector<TransformState> mOldStates;
+    QVector<TransformState> mNewStates;
+};
+
+} // namespace Internal
+} // namespace Tiled
+
+#endif // TRANSFORMMAPOBJECTS_H
@@ -21,7 +21,10 @@
 
 #include "undodock.h"
 
+#include "undomemorymanager.h"
+
 #include <QEvent>
+#include <QLabel>
 #include <QUndoView>
 #include <QVBoxLayout>
 
@@ -44,6 +47,12 @@ UndoDock::UndoDock(QUndoGroup *undoGroup, QWidget *parent)
     layout->setMargin(5);
     layout->addWidget(mUndoView);
 
+    mMemoryUsage = new QLabel(widget);
+    layout->addWidget(mMemoryUsage);
+
+    connect(UndoMemoryManager::instance(), SIGNAL(memoryUsageChanged()),
+            SLOT(updateMemoryUsage()));
+
     setWidget(widget);
     retranslateUi();
 }
@@ -64,4 +73,20 @@ void UndoDock::retranslateUi()
 {
     setWindowTitle(tr("History"));
     mUndoView->setEmptyLabel(tr("<empty>"));
+    updateMemoryUsage();
+}
+
+/**
+ * Shows how much of the undo memory budget is used by the tiles stored in
+ * the undo history, and how much memory the compressed tiles take.
+ */
+void UndoDock::updateMemoryUsage()
+{
+    const UndoMemoryManager *manager = UndoMemoryManager::instance();
+    const qreal megabyte = 1024 * 1024;
+
+    mMemoryUsage->setText(tr("Tiles: %1 of %2 MB, compressed: %3 MB")
+                          .arg(manager->uncompressedSize() / megabyte, 0, 'f', 1)
+                          .arg(manager->budget() / megabyte, 0, 'f', 0)
+                          .arg(manager->compressedSize() / megabyte, 0, 'f', 1));
 }
@@ -24,6 +24,7 @@
 
 #include <QDockWidget>
 
+class QLabel;
 class QUndoGroup;
 class QUndoView;
 
@@ -44,9 +45,13 @@ public:
 protected:
     void changeEvent(QEvent *e);
 
+private slots:
+    void updateMemoryUsage();
+
 private:
     void retranslateUi();
     QUndoView *mUndoView;
+    QLabel *mMemoryUsage;
 };
 
 } // namespace Internal
@@ -0,0 +1,137 @@
+/*
+ * undomemorymanager.cpp
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "undomemorymanager.h"
+
+#include "changedcells.h"
+#include "preferences.h"
+
+#include <QTimer>
+
+using namespace Tiled;
+using namespace Tiled::Internal;
+
+UndoMemoryManager *UndoMemoryManager::mInstance = 0;
+
+UndoMemoryManager::UndoMemoryManager()
+    : mBudget(0)
+    , mUncompressedSize(0)
+    , mCompressedSize(0)
+    , mEnforceBudgetPending(false)
+{
+    Preferences *prefs = Preferences::instance();
+    setBudget(prefs->undoMemoryBudget());
+    connect(prefs, SIGNAL(undoMemoryBudgetChanged(int)),
+            SLOT(setBudget(int)));
+}
+
+UndoMemoryManager *UndoMemoryManager::instance()
+{
+    if (!mInstance)
+        mInstance = new UndoMemoryManager;
+    return mInstance;
+}
+
+void UndoMemoryManager::deleteInstance()
+{
+    delete mInstance;
+    mInstance = 0;
+}
+
+void UndoMemoryManager::setBudget(int megabytes)
+{
+    mBudget = qint64(megabytes) * 1024 * 1024;
+    scheduleEnforceBudget();
+}
+
+/**
+ * Compresses the least recently used changes until the uncompressed changes
+ * fit within the budget. The most recently used changes are always kept
+ * uncompressed, since they are the most likely to be undone.
+ */
+void UndoMemoryManager::enforceBudget()
+{
+    mEnforceBudgetPending = false;
+
+    qint64 uncompressedSize = 0;
+    qint64 compressedSize = 0;
+
+    foreach (const ChangedCells *changedCells, mChangedCells) {
+        uncompressedSize += changedCells->memoryUsage();
+        compressedSize += changedCells->compressedSize();
+    }
+
+    const int last = mChangedCells.size() - 1;
+    for (int i = 0; i < last && uncompressedSize > mBudget; ++i) {
+        ChangedCells *changedCells = mChangedCells.at(i);
+        if (changedCells->isCompressed() || changedCells->isEmpty())
+            continue;
+
+        uncompressedSize -= changedCells->memoryUsage();
+        changedCells->compress();
+        compressedSize += changedCells->compressedSize();
+    }
+
+    mUncompressedSize = uncompressedSize;
+    mCompressedSize = compressedSize;
+    emit memoryUsageChanged();
+}
+
+void UndoMemoryManager::add(ChangedCells *changedCells)
+{
+    mChangedCells.append(changedCells);
+    scheduleEnforceBudget();
+}
+
+void UndoMemoryManager::remove(ChangedCells *changedCells)
+{
+    // The instance may already be gone while the application shuts down
+    if (!mInstance)
+        return;
+
+    mInstance->mChangedCells.removeOne(changedCells);
+    mInstance->scheduleEnforceBudget();
+}
+
+void UndoMemoryManager::touch(const ChangedCells *changedCells)
+{
+    ChangedCells *touched = const_cast<ChangedCells*>(changedCells);
+    if (mChangedCells.last() != touched) {
+        mChangedCells.removeOne(touched);
+        mChangedCells.append(touched);
+    }
+
+    // The changes may have been decompressed or grown
+    scheduleEnforceBudget();
+}
+
+/**
+ * The budget is enforced from the event loop, so that the changes are not
+ * compressed while they are still being set up by undo commands.
+ */
+void UndoMemoryManager::scheduleEnforceBudget()
+{
+    if (mEnforceBudgetPending)
+        return;
+
+    mEnforceBudgetPending = true;
+    QTimer::singleShot(0, this, SLOT(enforceBudget()));
+}
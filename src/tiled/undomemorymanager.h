@@ -0,0 +1,99 @@
+/*
+ * undomemorymanager.h
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef UNDOMEMORYMANAGER_H
+#define UNDOMEMORYMANAGER_H
+
+#include <QList>
+#include <QObject>
+
+namespace Tiled {
+namespace Internal {
+
+class ChangedCells;
+
+/**
+ * Keeps track of the memory used by the cells stored in the undo history of
+ * all map documents. When this exceeds the undo memory budget set in the
+ * preferences, the least recently used changes are compressed. They are
+ * decompressed again when they are undone or redone.
+ */
+class UndoMemoryManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * Returns the undo memory manager instance. Creates the instance when it
+     * doesn't exist yet.
+     */
+    static UndoMemoryManager *instance();
+
+    /**
+     * Deletes the undo memory manager instance if it exists.
+     */
+    static void deleteInstance();
+
+    /**
+     * Returns the number of bytes the uncompressed changes may use.
+     */
+    qint64 budget() const { return mBudget; }
+
+    /**
+     * Returns the number of bytes used by uncompressed changes.
+     */
+    qint64 uncompressedSize() const { return mUncompressedSize; }
+
+    /**
+     * Returns the number of bytes used by compressed changes.
+     */
+    qint64 compressedSize() const { return mCompressedSize; }
+
+signals:
+    void memoryUsageChanged();
+
+private slots:
+    void setBudget(int megabytes);
+    void enforceBudget();
+
+private:
+    friend class ChangedCells;
+
+    UndoMemoryManager();
+
+    void add(ChangedCells *changedCells);
+    static void remove(ChangedCells *changedCells);
+    void touch(const ChangedCells *changedCells);
+    void scheduleEnforceBudget();
+
+    QList<ChangedCells*> mChangedCells;     // least recently used first
+    qint64 mBudget;
+    qint64 mUncompressedSize;
+    qint64 mCompressedSize;
+    bool mEnforceBudgetPending;
+
+    static UndoMemoryManager *mInstance;
+};
+
+} // namespace Internal
+} // namespace Tiled
+
+#endif // UNDOMEMORYMANAGER_H
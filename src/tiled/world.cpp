@@ -0,0 +1,80 @@
+/*
+ * world.cpp
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "world.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QXmlStreamReader>
+
+using namespace Tiled::Internal;
+
+World *World::read(const QString &fileName, QString *error)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        if (error)
+            *error = QCoreApplication::translate("World", "Could not open file for reading.");
+        return 0;
+    }
+
+    QXmlStreamReader xml(&file);
+    if (!xml.readNextStartElement() || xml.name() != QLatin1String("world")) {
+        if (error)
+            *error = QCoreApplication::translate("World", "Not a world file.");
+        return 0;
+    }
+
+    const QDir dir = QFileInfo(fileName).dir();
+
+    World *world = new World;
+    world->mFileName = fileName;
+
+    while (xml.readNextStartElement()) {
+        if (xml.name() == QLatin1String("map")) {
+            const QXmlStreamAttributes atts = xml.attributes();
+            const QString source = atts.value(QLatin1String("source")).toString();
+
+            if (!source.isEmpty()) {
+                MapEntry entry;
+                entry.fileName = QDir::cleanPath(dir.absoluteFilePath(source));
+                entry.position = QPoint(atts.value(QLatin1String("x")).toString().toInt(),
+                                        atts.value(QLatin1String("y")).toString().toInt());
+                world->mMaps.append(entry);
+            }
+        }
+
+        xml.skipCurrentElement();
+    }
+
+    if (xml.hasError()) {
+        if (error)
+            *error = QCoreApplication::translate("World", "%3\n\nLine %1, column %2")
+                    .arg(xml.lineNumber())
+                    .arg(xml.columnNumber())
+                    .arg(xml.errorString());
+        delete world;
+        return 0;
+    }
+
+    return world;
+}
@@ -0,0 +1,72 @@
+/*
+ * world.h
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WORLD_H
+#define WORLD_H
+
+#include <QList>
+#include <QPoint>
+#include <QString>
+
+namespace Tiled {
+namespace Internal {
+
+/**
+ * A set of maps placed next to each other, as read from a world file.
+ *
+ * A world file is a small XML file listing the maps and their position in
+ * pixels:
+ *
+ * \code
+ * <world>
+ *  <map source="town.tmx" x="0" y="0"/>
+ *  <map source="forest.tmx" x="1280" y="0"/>
+ * </world>
+ * \endcode
+ *
+ * The map sources are relative to the location of the world file.
+ */
+class World
+{
+public:
+    struct MapEntry
+    {
+        QString fileName;
+        QPoint position;
+    };
+
+    /**
+     * Reads the world file with the given \a fileName. Returns 0 and sets
+     * \a error when the file could not be read.
+     */
+    static World *read(const QString &fileName, QString *error = 0);
+
+    const QString &fileName() const { return mFileName; }
+    const QList<MapEntry> &maps() const { return mMaps; }
+
+private:
+    QString mFileName;
+    QList<MapEntry> mMaps;
+};
+
+} // namespace Internal
+} // namespace Tiled
+
+#endif // WORLD_H
@@ -0,0 +1,420 @@
+/*
+ * worldview.cpp
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "worldview.h"
+
+#include "imagelayer.h"
+#include "imagelayeritem.h"
+#include "map.h"
+#include "mapdocument.h"
+#include "maploader.h"
+#include "maprenderer.h"
+#include "mapsindexer.h"
+#include "tilelayer.h"
+#include "tilelayeritem.h"
+#include "world.h"
+#include "zoomable.h"
+
+#include <QFileInfo>
+#include <QGraphicsItem>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <QTimer>
+#include <QWheelEvent>
+
+using namespace Tiled;
+using namespace Tiled::Internal;
+
+/**
+ * The memory used by the preview pixmaps, in kilobytes.
+ */
+static const int PreviewCacheSize = 32 * 1024;
+
+/**
+ * Returns the size of the map described by \a info, in pixels. For
+ * staggered and hexagonal maps this is an estimate, which gets corrected
+ * once the map is loaded.
+ */
+static QSizeF mapSize(const MapInfo &info)
+{
+    switch (info.orientation) {
+    case Map::Isometric: {
+        const int side = info.width + info.height;
+        return QSizeF(side * info.tileWidth / 2, side * info.tileHeight / 2);
+    }
+    case Map::Staggered:
+    case Map::Hexagonal:
+        return QSizeF(info.width * info.tileWidth + info.tileWidth / 2,
+                      (info.height + 1) * info.tileHeight / 2);
+    default:
+        return QSizeF(info.width * info.tileWidth,
+                      info.height * info.tileHeight);
+    }
+}
+
+namespace Tiled {
+namespace Internal {
+
+/**
+ * Displays one map of the world. Shows the thumbnail of the map until it is
+ * loaded, after which its tile and image layers are displayed by child
+ * items.
+ */
+class WorldMapItem : public QGraphicsItem
+{
+public:
+    WorldMapItem(const QString &fileName, WorldView *view)
+        : mFileName(fileName)
+        , mView(view)
+        , mMapDocument(0)
+        , mLoadFailed(false)
+    {
+        setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+    }
+
+    ~WorldMapItem()
+    {
+        // The layer items refer to the map document
+        qDeleteAll(childItems());
+        delete mMapDocument;
+    }
+
+    const QString &fileName() const { return mFileName; }
+
+    bool isLoaded() const { return mMapDocument != 0; }
+
+    bool loadFailed() const { return mLoadFailed; }
+    void setLoadFailed() { mLoadFailed = true; }
+
+    void setMapInfo(const MapInfo &info);
+    void setMapDocument(MapDocument *mapDocument);
+    void unload();
+
+    QRectF boundingRect() const { return QRectF(QPointF(), mSize); }
+    void paint(QPainter *painter,
+               const QStyleOptionGraphicsItem *option,
+               QWidget *widget = 0);
+
+private:
+    const QString mFileName;
+    WorldView *mView;
+    MapDocument *mMapDocument;
+    QSizeF mSize;
+    bool mLoadFailed;
+};
+
+} // namespace Internal
+} // namespace Tiled
+
+void WorldMapItem::setMapInfo(const MapInfo &info)
+{
+    if (mMapDocument)
+        return;
+
+    prepareGeometryChange();
+    mSize = mapSize(info);
+}
+
+/**
+ * Displays the layers of the loaded map. Takes ownership of the given
+ * \a mapDocument.
+ */
+void WorldMapItem::setMapDocument(MapDocument *mapDocument)
+{
+    unload();
+
+    prepareGeometryChange();
+    mMapDocument = mapDocument;
+    mSize = mapDocument->renderer()->mapSize();
+
+    int z = 0;
+    foreach (Layer *layer, mapDocument->map()->layers()) {
+        QGraphicsItem *layerItem = 0;
+
+        if (TileLayer *tileLayer = layer->asTileLayer())
+            layerItem = new TileLayerItem(tileLayer, mapDocument);
+        else if (ImageLayer *imageLayer = layer->asImageLayer())
+            layerItem = new ImageLayerItem(imageLayer, mapDocument);
+
+        if (!layerItem)
+            continue;
+
+        layerItem->setParentItem(this);
+        layerItem->setZValue(z++);
+        layerItem->setVisible(layer->isVisible());
+        layerItem->setOpacity(layer->opacity());
+    }
+}
+
+/**
+ * Deletes the loaded map along with the items displaying it, falling back to
+ * showing the thumbnail.
+ */
+void WorldMapItem::unload()
+{
+    if (!mMapDocument)
+        return;
+
+    // The layer items refer to the map document
+    qDeleteAll(childItems());
+
+    delete mMapDocument;
+    mMapDocument = 0;
+
+    update();
+}
+
+void WorldMapItem::paint(QPainter *painter,
+                         const QStyleOptionGraphicsItem *option,
+                         QWidget *)
+{
+    const qreal lod = option->levelOfDetailFromTransform(painter->worldTransform());
+    mView->mapPainted(this, lod * qMax(mSize.width(), mSize.height()));
+
+    // Once loaded, the layers are painted by the child items
+    if (mMapDocument)
+        return;
+
+    const QRectF rect = boundingRect();
+    const QPixmap preview = mView->preview(mFileName);
+
+    if (!preview.isNull())
+        painter->drawPixmap(rect, preview, QRectF(preview.rect()));
+    else
+        painter->fillRect(rect, QColor(128, 128, 128, 64));
+
+    QPen pen(Qt::gray);
+    pen.setCosmetic(true);
+    painter->setPen(pen);
+    painter->setBrush(Qt::NoBrush);
+    painter->drawRect(rect);
+}
+
+
+WorldView::WorldView(World *world, QWidget *parent)
+    : QGraphicsView(parent)
+    , mWorld(world)
+    , mZoomable(new Zoomable(this))
+    , mIndexer(new MapsIndexer(this))
+    , mPreviews(PreviewCacheSize)
+    , mUnloadPending(false)
+{
+    setWindowTitle(tr("World - %1").arg(QFileInfo(world->fileName()).fileName()));
+    setDragMode(QGraphicsView::ScrollHandDrag);
+    setTransformationAnchor(QGraphicsView::AnchorUnderMouse);
+    setScene(new QGraphicsScene(this));
+
+    connect(mZoomable, SIGNAL(scaleChanged(qreal)), SLOT(adjustScale(qreal)));
+    connect(mIndexer, SIGNAL(mapInfoChanged(QString)),
+            SLOT(mapInfoChanged(QString)));
+
+    foreach (const World::MapEntry &entry, world->maps()) {
+        if (mItems.contains(entry.fileName))
+            continue;
+
+        WorldMapItem *item = new WorldMapItem(entry.fileName, this);
+        item->setPos(entry.position);
+        scene()->addItem(item);
+        mItems.insert(entry.fileName, item);
+
+        const QDateTime lastModified = QFileInfo(entry.fileName).lastModified();
+        if (const MapInfo *info = mIndexer->mapInfo(entry.fileName, lastModified))
+            if (info->valid)
+                item->setMapInfo(*info);
+    }
+}
+
+WorldView::~WorldView()
+{
+    // Waits for the running loaders, discarding their maps
+    qDeleteAll(mLoaders.keys());
+    mLoaders.clear();
+
+    // Deletes the items, which unload their maps
+    delete scene();
+
+    delete mWorld;
+}
+
+void WorldView::wheelEvent(QWheelEvent *event)
+{
+    if (event->modifiers() & Qt::ControlModifier
+        && event->orientation() == Qt::Vertical)
+    {
+        mZoomable->handleWheelDelta(event->delta());
+        return;
+    }
+
+    QGraphicsView::wheelEvent(event);
+}
+
+/**
+ * Emits mapActivated() for the map that was double-clicked.
+ */
+void WorldView::mouseDoubleClickEvent(QMouseEvent *event)
+{
+    if (event->button() == Qt::LeftButton) {
+        if (QGraphicsItem *item = itemAt(event->pos())) {
+            // Loaded maps are displayed by their child items
+            while (item->parentItem())
+                item = item->parentItem();
+
+            if (WorldMapItem *mapItem = dynamic_cast<WorldMapItem*>(item)) {
+                emit mapActivated(mapItem->fileName());
+                return;
+            }
+        }
+    }
+
+    QGraphicsView::mouseDoubleClickEvent(event);
+}
+
+void WorldView::adjustScale(qreal scale)
+{
+    setTransform(QTransform::fromScale(scale, scale));
+    setRenderHint(QPainter::SmoothPixmapTransform,
+                  mZoomable->smoothTransform());
+}
+
+void WorldView::mapInfoChanged(const QString &fileName)
+{
+    WorldMapItem *item = mItems.value(fileName);
+    if (!item)
+        return;
+
+    if (const MapInfo *info = mIndexer->mapInfo(fileName, QDateTime()))
+        if (info->valid)
+            item->setMapInfo(*info);
+
+    mPreviews.remove(fileName);
+    item->update();
+}
+
+/**
+ * Returns the thumbnail of the given map file as a pixmap. The pixmaps are
+ * kept in a cache limited to PreviewCacheSize, while the MapsIndexer reads
+ * them back from its disk cache when needed again.
+ */
+QPixmap WorldView::preview(const QString &fileName)
+{
+    if (const QPixmap *pixmap = mPreviews.object(fileName))
+        return *pixmap;
+
+    const QImage image = mIndexer->thumbnailImage(fileName);
+    if (image.isNull())
+        return QPixmap();
+
+    const QPixmap pixmap = QPixmap::fromImage(image);
+    const int cost = qMax(1, pixmap.width() * pixmap.height() * 4 / 1024);
+    mPreviews.insert(fileName, new QPixmap(pixmap), cost);
+    return pixmap;
+}
+
+/**
+ * Called when the given map \a item is painted at \a screenSize pixels.
+ *
+ * Maps that would show their thumbnail enlarged more than twice are
+ * queued for loading, while loaded maps that became smaller than their
+ * thumbnail are unloaded again. The difference between these thresholds
+ * avoids loading and unloading a map over and over at a certain zoom level.
+ */
+void WorldView::mapPainted(WorldMapItem *item, qreal screenSize)
+{
+    const bool needsDetail = screenSize > 2 * MapsIndexer::ThumbnailSize;
+
+    if (item->isLoaded()) {
+        if (needsDetail) {
+            mDistant.removeOne(item);
+            mLoaded.removeOne(item);
+            mLoaded.append(item);
+        } else if (screenSize < MapsIndexer::ThumbnailSize &&
+                   !mDistant.contains(item)) {
+            // Unloading is deferred, since the item is being painted
+            mDistant.append(item);
+            if (!mUnloadPending) {
+                mUnloadPending = true;
+                QTimer::singleShot(0, this, SLOT(unloadDistantMaps()));
+            }
+        }
+        return;
+    }
+
+    if (!needsDetail || item->loadFailed() || mLoaders.key(item))
+        return;
+
+    mLoadQueue.removeOne(item);
+    mLoadQueue.append(item);
+
+    // Maps that were scrolled past are not worth loading anymore
+    while (mLoadQueue.size() > MaxLoadedMaps)
+        mLoadQueue.removeFirst();
+
+    startLoaders();
+}
+
+/**
+ * Loads the most recently requested maps, up to MaxLoaders at a time.
+ */
+void WorldView::startLoaders()
+{
+    while (mLoaders.size() < MaxLoaders && !mLoadQueue.isEmpty()) {
+        WorldMapItem *item = mLoadQueue.takeLast();
+
+        MapLoader *loader = new MapLoader(item->fileName(), this);
+        connect(loader, SIGNAL(finished()), SLOT(loaderFinished()));
+        mLoaders.insert(loader, item);
+        loader->start(QThread::LowPriority);
+    }
+}
+
+void WorldView::loaderFinished()
+{
+    MapLoader *loader = static_cast<MapLoader*>(sender());
+    WorldMapItem *item = mLoaders.take(loader);
+
+    if (MapDocument *mapDocument = loader->takeMapDocument()) {
+        item->setMapDocument(mapDocument);
+        mLoaded.append(item);
+
+        // Drop the maps that were least recently painted
+        while (mLoaded.size() > MaxLoadedMaps) {
+            WorldMapItem *leastRecent = mLoaded.takeFirst();
+            mDistant.removeOne(leastRecent);
+            leastRecent->unload();
+        }
+    } else {
+        item->setLoadFailed();
+    }
+
+    loader->deleteLater();
+    startLoaders();
+}
+
+void WorldView::unloadDistantMaps()
+{
+    mUnloadPending = false;
+
+    foreach (WorldMapItem *item, mDistant) {
+        mLoaded.removeOne(item);
+        item->unload();
+    }
+    mDistant.clear();
+}
@@ -0,0 +1,105 @@
+/*
+ * worldview.h
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WORLDVIEW_H
+#define WORLDVIEW_H
+
+#include <QCache>
+#include <QGraphicsView>
+#include <QHash>
+#include <QList>
+#include <QPixmap>
+
+namespace Tiled {
+namespace Internal {
+
+class MapLoader;
+class MapsIndexer;
+class World;
+class WorldMapItem;
+class Zoomable;
+
+/**
+ * Shows all the maps of a world next to each other, for getting an overview
+ * and checking the borders between maps.
+ *
+ * Maps are first shown using the thumbnails of the MapsIndexer, which only
+ * needs their header to be read. Maps that are large enough on screen to
+ * need more detail than their thumbnail are loaded in the background and
+ * then displayed by the same layer items as used by the map scene, so their
+ * rendering is cached in chunks within the cache memory budget. At most
+ * MaxLoadedMaps maps are kept loaded, dropping the ones that were least
+ * recently painted.
+ */
+class WorldView : public QGraphicsView
+{
+    Q_OBJECT
+
+public:
+    /**
+     * Constructor. Takes ownership of the given \a world.
+     */
+    explicit WorldView(World *world, QWidget *parent = 0);
+    ~WorldView();
+
+    Zoomable *zoomable() const { return mZoomable; }
+
+    static const int MaxLoadedMaps = 16;
+    static const int MaxLoaders = 2;
+
+signals:
+    /**
+     * Emitted when a map was double-clicked.
+     */
+    void mapActivated(const QString &fileName);
+
+protected:
+    void wheelEvent(QWheelEvent *event);
+    void mouseDoubleClickEvent(QMouseEvent *event);
+
+private slots:
+    void adjustScale(qreal scale);
+    void mapInfoChanged(const QString &fileName);
+    void loaderFinished();
+    void unloadDistantMaps();
+
+private:
+    friend class WorldMapItem;
+
+    QPixmap preview(const QString &fileName);
+    void mapPainted(WorldMapItem *item, qreal screenSize);
+    void startLoaders();
+
+    World *mWorld;
+    Zoomable *mZoomable;
+    MapsIndexer *mIndexer;
+    QHash<QString, WorldMapItem*> mItems;
+    QCache<QString, QPixmap> mPreviews;
+    QList<WorldMapItem*> mLoaded;       // least recently painted first
+    QList<WorldMapItem*> mLoadQueue;    // most recently requested last
+    QList<WorldMapItem*> mDistant;
+    QHash<MapLoader*, WorldMapItem*> mLoaders;
+    bool mUnloadPending;
+};
+
+} // namespace Internal
+} // namespace Tiled
+
+#endif // WORLDVIEW_H
@@ -0,0 +1,176 @@
+/*
+ * main.cpp
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of the TMX Diff tool.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "tmxdiff.h"
+
+#if QT_VERSION >= 0x050000
+#include <QGuiApplication>
+#else
+#include <QApplication>
+#endif
+
+#include <QDebug>
+#include <QStringList>
+
+namespace {
+
+struct CommandLineOptions {
+    CommandLineOptions()
+        : showHelp(false)
+        , showVersion(false)
+        , scale(1.0)
+        , maxAreas(10)
+    {}
+
+    bool showHelp;
+    bool showVersion;
+    QString oldFile;
+    QString newFile;
+    QString imageFile;
+    qreal scale;
+    int maxAreas;
+};
+
+} // anonymous namespace
+
+static void showHelp()
+{
+    // TODO: Make translatable
+    qWarning() <<
+            "Usage:\n"
+            "  tmxdiff [options] [old file] [new file]\n"
+            "\n"
+            "Options:\n"
+            "  -h --help               : Display this help\n"
+            "  -v --version            : Display the version\n"
+            "     --image FILE         : Write an image of the new map to FILE, in which\n"
+            "                            the changes are highlighted\n"
+            "  -s --scale SCALE        : The scale of the image (default: 1)\n"
+            "     --areas COUNT        : The number of changed areas listed for each tile\n"
+            "                            layer (default: 10)\n"
+            "\n"
+            "The exit status is 0 when the maps are the same, 1 when they differ and 2\n"
+            "when either map could not be read.\n";
+}
+
+static void showVersion()
+{
+    qWarning() << "TMX Map Diff"
+            << qPrintable(QCoreApplication::applicationVersion());
+}
+
+static void parseCommandLineArguments(CommandLineOptions &options)
+{
+    const QStringList arguments = QCoreApplication::arguments();
+
+    for (int i = 1; i < arguments.size(); ++i) {
+        const QString &arg = arguments.at(i);
+        if (arg == QLatin1String("--help") || arg == QLatin1String("-h")) {
+            options.showHelp = true;
+        } else if (arg == QLatin1String("--version")
+                || arg == QLatin1String("-v")) {
+            options.showVersion = true;
+        } else if (arg == QLatin1String("--image")) {
+            i++;
+            if (i >= arguments.size())
+                options.showHelp = true;
+            else
+                options.imageFile = arguments.at(i);
+        } else if (arg == QLatin1String("--scale")
+                || arg == QLatin1String("-s")) {
+            i++;
+            if (i >= arguments.size()) {
+                options.showHelp = true;
+            } else {
+                bool scaleIsDouble;
+                options.scale = arguments.at(i).toDouble(&scaleIsDouble);
+                if (!scaleIsDouble || options.scale <= 0.0) {
+                    qWarning() << arguments.at(i) << ": the specified scale is not a positive number.";
+                    options.showHelp = true;
+                }
+            }
+        } else if (arg == QLatin1String("--areas")) {
+            i++;
+            if (i >= arguments.size()) {
+                options.showHelp = true;
+            } else {
+                bool maxAreasIsInt;
+                options.maxAreas = arguments.at(i).toInt(&maxAreasIsInt);
+                if (!maxAreasIsInt || options.maxAreas < 0) {
+                    qWarning() << arguments.at(i) << ": the specified number of areas is not a positive integer.";
+                    options.showHelp = true;
+                }
+            }
+        } else if (arg.isEmpty()) {
+            options.showHelp = true;
+        } else if (arg.at(0) == QLatin1Char('-')) {
+            qWarning() << "Unknown option" << arg;
+            options.showHelp = true;
+        } else if (options.oldFile.isEmpty()) {
+            options.oldFile = arg;
+        } else if (options.newFile.isEmpty()) {
+            options.newFile = arg;
+        } else {
+            // All args are already defined. Show help.
+            options.showHelp = true;
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    // Tileset images are loaded as pixmaps, which needs a GUI application
+#if QT_VERSION >= 0x050000
+    QGuiApplication a(argc, argv);
+#else
+    QApplication a(argc, argv);
+#endif
+
+    a.setOrganizationDomain(QLatin1String("mapeditor.org"));
+    a.setApplicationName(QLatin1String("TmxDiff"));
+    a.setApplicationVersion(QLatin1String("1.0"));
+
+    CommandLineOptions options;
+    parseCommandLineArguments(options);
+
+    if (options.showVersion) {
+        showVersion();
+        return 0;
+    }
+    if (options.showHelp || options.oldFile.isEmpty() || options.newFile.isEmpty()) {
+        showHelp();
+        return options.showHelp ? 0 : 2;
+    }
+
+    TmxDiff diff;
+    diff.setImageFileName(options.imageFile);
+    diff.setScale(options.scale);
+    diff.setMaxAreas(options.maxAreas);
+
+    return diff.diff(options.oldFile, options.newFile);
+}
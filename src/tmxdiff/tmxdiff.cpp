@@ -0,0 +1,654 @@
+/*
+ * tmxdiff.cpp
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of the TMX Diff tool.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "tmxdiff.h"
+
+#include "hexagonalrenderer.h"
+#include "imagelayer.h"
+#include "isometricrenderer.h"
+#include "jobsystem.h"
+#include "map.h"
+#include "mapobject.h"
+#include "mapreader.h"
+#include "objectgroup.h"
+#include "orthogonalrenderer.h"
+#include "staggeredrenderer.h"
+#include "tile.h"
+#include "tilelayer.h"
+#include "tileset.h"
+
+#include <QDebug>
+#include <QHash>
+#include <QImage>
+#include <QPainter>
+#include <QRunnable>
+#include <QSet>
+#include <QTextStream>
+
+#include <cstdio>
+
+using namespace Tiled;
+
+namespace {
+
+MapRenderer *createRenderer(const Map *map)
+{
+    switch (map->orientation()) {
+    case Map::Isometric:
+        return new IsometricRenderer(map);
+    case Map::Staggered:
+        return new StaggeredRenderer(map);
+    case Map::Hexagonal:
+        return new HexagonalRenderer(map);
+    case Map::Orthogonal:
+    default:
+        return new OrthogonalRenderer(map);
+    }
+}
+
+QString quoted(const QString &string)
+{
+    return QLatin1Char('"') + string + QLatin1Char('"');
+}
+
+QString sizeToString(const QSize &size)
+{
+    return QString(QLatin1String("%1x%2")).arg(size.width()).arg(size.height());
+}
+
+QString pointToString(const QPoint &point)
+{
+    return QString(QLatin1String("%1,%2")).arg(point.x()).arg(point.y());
+}
+
+QString layerTypeToString(const Layer *layer)
+{
+    switch (layer->layerType()) {
+    case Layer::TileLayerType:      return QLatin1String("tile layer");
+    case Layer::ObjectGroupType:    return QLatin1String("object layer");
+    case Layer::ImageLayerType:     return QLatin1String("image layer");
+    default:                        return QLatin1String("layer");
+    }
+}
+
+/**
+ * Appends a description of the change to \a changes when \a oldValue and
+ * \a newValue differ.
+ */
+void compareValues(QStringList &changes, const char *what,
+                   const QString &oldValue, const QString &newValue)
+{
+    if (oldValue != newValue) {
+        changes.append(QString(QLatin1String("%1 %2 -> %3"))
+                       .arg(QLatin1String(what), oldValue, newValue));
+    }
+}
+
+void compareProperties(QStringList &changes,
+                       const Properties &oldProperties,
+                       const Properties &newProperties)
+{
+    Properties::const_iterator it = oldProperties.constBegin();
+    Properties::const_iterator it_end = oldProperties.constEnd();
+    for (; it != it_end; ++it) {
+        Properties::const_iterator newIt = newProperties.constFind(it.key());
+        if (newIt == newProperties.constEnd()) {
+            changes.append(QString(QLatin1String("property %1 removed"))
+                           .arg(quoted(it.key())));
+        } else if (newIt.value() != it.value()) {
+            changes.append(QString(QLatin1String("property %1 %2 -> %3"))
+                           .arg(quoted(it.key()),
+                                quoted(it.value()),
+                                quoted(newIt.value())));
+        }
+    }
+
+    it = newProperties.constBegin();
+    it_end = newProperties.constEnd();
+    for (; it != it_end; ++it) {
+        if (!oldProperties.contains(it.key())) {
+            changes.append(QString(QLatin1String("property %1 added"))
+                           .arg(quoted(it.key())));
+        }
+    }
+}
+
+QString objectName(const MapObject *object)
+{
+    QString name = QLatin1String("object");
+    if (object->id() > 0)
+        name += QString(QLatin1String(" %1")).arg(object->id());
+    if (!object->name().isEmpty())
+        name += QLatin1Char(' ') + quoted(object->name());
+    return name;
+}
+
+/**
+ * Lists the ways in which the two objects differ.
+ */
+QStringList objectChanges(const MapObject *oldObject,
+                          const MapObject *newObject)
+{
+    QStringList changes;
+
+    if (oldObject->name() != newObject->name())
+        changes.append(QLatin1String("renamed to ") + quoted(newObject->name()));
+    if (oldObject->type() != newObject->type())
+        changes.append(QLatin1String("type changed to ") +
+                       quoted(newObject->type()));
+    if (oldObject->position() != newObject->position())
+        changes.append(QLatin1String("moved"));
+    if (oldObject->size() != newObject->size())
+        changes.append(QLatin1String("resized"));
+    if (oldObject->rotation() != newObject->rotation())
+        changes.append(QLatin1String("rotated"));
+    if (oldObject->shape() != newObject->shape())
+        changes.append(QLatin1String("shape changed"));
+    else if (oldObject->polygon() != newObject->polygon())
+        changes.append(QLatin1String("points changed"));
+    if (oldObject->cell() != newObject->cell())
+        changes.append(QLatin1String("tile changed"));
+    if (oldObject->isVisible() != newObject->isVisible())
+        changes.append(QLatin1String(newObject->isVisible() ? "shown" : "hidden"));
+
+    compareProperties(changes, oldObject->properties(), newObject->properties());
+    return changes;
+}
+
+/**
+ * Computes the cells that differ between two tile layers. The chunks are
+ * compared by their content hashes first, so that only the chunks that
+ * changed are compared cell by cell.
+ */
+class TileLayerDiffJob : public QRunnable
+{
+public:
+    TileLayerDiffJob(const TileLayer *oldLayer,
+                     const TileLayer *newLayer,
+                     QRegion *result)
+        : mOldLayer(oldLayer)
+        , mNewLayer(newLayer)
+        , mResult(result)
+    {}
+
+    void run()
+    {
+        QRegion changed = mNewLayer->computeDiffRegion(mOldLayer, true);
+
+        // Tiles placed outside of the area of the old layer are new as well
+        const QRect oldArea = mOldLayer->bounds().translated(
+                    -mNewLayer->position());
+        const QRegion outside = QRegion(0, 0,
+                                        mNewLayer->width(),
+                                        mNewLayer->height()).subtracted(oldArea);
+        if (!outside.isEmpty())
+            changed += mNewLayer->region().intersected(outside);
+
+        *mResult = changed;
+    }
+
+private:
+    const TileLayer *mOldLayer;
+    const TileLayer *mNewLayer;
+    QRegion *mResult;
+};
+
+} // anonymous namespace
+
+TmxDiff::TmxDiff()
+    : mScale(1.0)
+    , mMaxAreas(10)
+{
+}
+
+TmxDiff::~TmxDiff()
+{
+}
+
+int TmxDiff::diff(const QString &oldFileName, const QString &newFileName)
+{
+    MapReader oldReader;
+    Map *oldMap = oldReader.readMap(oldFileName);
+    if (!oldMap) {
+        qWarning().nospace() << "Error while reading " << oldFileName << ":\n"
+                             << qPrintable(oldReader.errorString());
+        return 2;
+    }
+
+    MapReader newReader;
+    Map *newMap = newReader.readMap(newFileName);
+    if (!newMap) {
+        qWarning().nospace() << "Error while reading " << newFileName << ":\n"
+                             << qPrintable(newReader.errorString());
+        qDeleteAll(oldMap->tilesets());
+        delete oldMap;
+        return 2;
+    }
+
+    mMapChanges.clear();
+    mLayerChanges.clear();
+
+    compareMaps(oldMap, newMap);
+    unifyTilesets(oldMap, newMap);
+    matchLayers(oldMap, newMap);
+    compareTileLayers();
+
+    for (int i = 0; i < mLayerChanges.size(); ++i)
+        compareLayer(mLayerChanges[i]);
+
+    QTextStream out(stdout);
+    report(out);
+    out.flush();
+
+    bool differ = !mMapChanges.isEmpty();
+    foreach (const LayerChanges &layerChanges, mLayerChanges)
+        if (!layerChanges.changes.isEmpty())
+            differ = true;
+
+    bool imageWritten = true;
+    if (!mImageFileName.isEmpty())
+        imageWritten = writeImage(newMap);
+
+    QSet<Tileset*> tilesets = oldMap->tilesets().toSet();
+    tilesets.unite(newMap->tilesets().toSet());
+    tilesets.unite(mReplacedTilesets.toSet());
+    mReplacedTilesets.clear();
+    mLayerChanges.clear();
+
+    delete newMap;
+    delete oldMap;
+    qDeleteAll(tilesets);
+
+    if (!imageWritten)
+        return 2;
+
+    return differ ? 1 : 0;
+}
+
+void TmxDiff::compareMaps(const Map *oldMap, const Map *newMap)
+{
+    compareValues(mMapChanges, "orientation",
+                  orientationToString(oldMap->orientation()),
+                  orientationToString(newMap->orientation()));
+    compareValues(mMapChanges, "render order",
+                  renderOrderToString(oldMap->renderOrder()),
+                  renderOrderToString(newMap->renderOrder()));
+    compareValues(mMapChanges, "size",
+                  sizeToString(oldMap->size()),
+                  sizeToString(newMap->size()));
+    compareValues(mMapChanges, "tile size",
+                  sizeToString(oldMap->tileSize()),
+                  sizeToString(newMap->tileSize()));
+    compareValues(mMapChanges, "background color",
+                  oldMap->backgroundColor().name(),
+                  newMap->backgroundColor().name());
+    compareProperties(mMapChanges, oldMap->properties(), newMap->properties());
+}
+
+/**
+ * Makes the new map use the tilesets of the old map where they are the
+ * same, so that the cells of both maps refer to the same tiles and the
+ * chunks can be compared by their hashes.
+ *
+ * Tilesets are matched by name. The changes to the tilesets are added to
+ * the changes of the map.
+ */
+void TmxDiff::unifyTilesets(const Map *oldMap, Map *newMap)
+{
+    QHash<QString, Tileset*> oldTilesets;
+    foreach (Tileset *tileset, oldMap->tilesets())
+        if (!oldTilesets.contains(tileset->name()))
+            oldTilesets.insert(tileset->name(), tileset);
+
+    const QList<Tileset*> newTilesets = newMap->tilesets();
+    foreach (Tileset *newTileset, newTilesets) {
+        const QString name = QLatin1String("tileset ") +
+                quoted(newTileset->name());
+
+        Tileset *oldTileset = oldTilesets.take(newTileset->name());
+        if (!oldTileset) {
+            mMapChanges.append(name + QLatin1String(" added"));
+            continue;
+        }
+
+        QStringList changes;
+        compareProperties(changes, oldTileset->properties(),
+                          newTileset->properties());
+
+        const bool sameTiles =
+                oldTileset->similarityKey() == newTileset->similarityKey() &&
+                oldTileset->tileCount() == newTileset->tileCount();
+
+        if (!sameTiles) {
+            changes.append(QLatin1String("tiles changed"));
+        } else {
+            for (int i = 0; i < newTileset->tileCount(); ++i) {
+                QStringList tileChanges;
+                compareProperties(tileChanges,
+                                  oldTileset->tileAt(i)->properties(),
+                                  newTileset->tileAt(i)->properties());
+                if (!tileChanges.isEmpty()) {
+                    changes.append(QString(QLatin1String("tile %1: %2"))
+                                   .arg(i)
+                                   .arg(tileChanges.join(QLatin1String(", "))));
+                }
+            }
+        }
+
+        foreach (const QString &change, changes)
+            mMapChanges.append(name + QLatin1String(": ") + change);
+
+        if (sameTiles) {
+            newMap->replaceTileset(newTileset, oldTileset);
+            mReplacedTilesets.append(newTileset);
+        }
+    }
+
+    foreach (Tileset *tileset, oldTilesets) {
+        mMapChanges.append(QLatin1String("tileset ") +
+                           quoted(tileset->name()) +
+                           QLatin1String(" removed"));
+    }
+}
+
+/**
+ * Pairs the layers of both maps by their name. When several layers have
+ * the same name, they are paired in the order they appear in.
+ */
+void TmxDiff::matchLayers(const Map *oldMap, const Map *newMap)
+{
+    QHash<QString, QList<Layer*> > oldLayers;
+    foreach (Layer *layer, oldMap->layers())
+        oldLayers[layer->name()].append(layer);
+
+    foreach (Layer *layer, newMap->layers()) {
+        LayerChanges layerChanges;
+        layerChanges.newLayer = layer;
+
+        QHash<QString, QList<Layer*> >::iterator it =
+                oldLayers.find(layer->name());
+        if (it != oldLayers.end() && !it.value().isEmpty())
+            layerChanges.oldLayer = it.value().takeFirst();
+
+        mLayerChanges.append(layerChanges);
+    }
+
+    // The remaining layers were removed, in the order of the old map
+    foreach (Layer *layer, oldMap->layers()) {
+        const QList<Layer*> &remaining = oldLayers.value(layer->name());
+        if (remaining.contains(layer)) {
+            LayerChanges layerChanges;
+            layerChanges.oldLayer = layer;
+            mLayerChanges.append(layerChanges);
+        }
+    }
+}
+
+/**
+ * Computes the changed cells of the tile layers, comparing the pairs of
+ * layers in parallel.
+ */
+void TmxDiff::compareTileLayers()
+{
+    JobGroup jobs(JobSystem::Interactive);
+
+    for (int i = 0; i < mLayerChanges.size(); ++i) {
+        LayerChanges &layerChanges = mLayerChanges[i];
+        if (!layerChanges.oldLayer || !layerChanges.newLayer)
+            continue;
+
+        const TileLayer *oldLayer = layerChanges.oldLayer->asTileLayer();
+        const TileLayer *newLayer = layerChanges.newLayer->asTileLayer();
+        if (oldLayer && newLayer) {
+            jobs.start(new TileLayerDiffJob(oldLayer, newLayer,
+                                            &layerChanges.changedCells));
+        }
+    }
+
+    jobs.wait();
+}
+
+void TmxDiff::compareLayer(LayerChanges &layerChanges) const
+{
+    const Layer *oldLayer = layerChanges.oldLayer;
+    const Layer *newLayer = layerChanges.newLayer;
+    QStringList &changes = layerChanges.changes;
+
+    if (!oldLayer) {
+        changes.append(layerTypeToString(newLayer) + QLatin1String(" added"));
+        return;
+    }
+    if (!newLayer) {
+        changes.append(layerTypeToString(oldLayer) + QLatin1String(" removed"));
+        return;
+    }
+    if (oldLayer->layerType() != newLayer->layerType()) {
+        changes.append(QString(QLatin1String("changed from %1 to %2"))
+                       .arg(layerTypeToString(oldLayer),
+                            layerTypeToString(newLayer)));
+        return;
+    }
+
+    if (oldLayer->isVisible() != newLayer->isVisible())
+        changes.append(QLatin1String(newLayer->isVisible() ? "shown" : "hidden"));
+    compareValues(changes, "opacity",
+                  QString::number(oldLayer->opacity()),
+                  QString::number(newLayer->opacity()));
+    compareValues(changes, "position",
+                  pointToString(oldLayer->position()),
+                  pointToString(newLayer->position()));
+    if (oldLayer->isTileLayer()) {
+        compareValues(changes, "size",
+                      sizeToString(oldLayer->size()),
+                      sizeToString(newLayer->size()));
+    }
+    compareProperties(changes, oldLayer->properties(), newLayer->properties());
+
+    if (oldLayer->isTileLayer()) {
+        const QRegion &changedCells = layerChanges.changedCells;
+        if (!changedCells.isEmpty()) {
+            const QVector<QRect> rects = changedCells.rects();
+            qint64 cellCount = 0;
+            foreach (const QRect &rect, rects)
+                cellCount += qint64(rect.width()) * rect.height();
+
+            changes.append(QString(QLatin1String("%1 cells changed in %2 areas"))
+                           .arg(cellCount).arg(rects.size()));
+
+            for (int i = 0; i < rects.size() && i < mMaxAreas; ++i) {
+                const QRect &rect = rects.at(i);
+                changes.append(QString(QLatin1String("    %1 %2"))
+                               .arg(pointToString(rect.topLeft()),
+                                    sizeToString(rect.size())));
+            }
+            if (rects.size() > mMaxAreas) {
+                changes.append(QString(QLatin1String("    ... %1 more areas"))
+                               .arg(rects.size() - mMaxAreas));
+            }
+        }
+    } else if (oldLayer->isObjectGroup()) {
+        compareObjectGroups(static_cast<const ObjectGroup*>(oldLayer),
+                            static_cast<const ObjectGroup*>(newLayer),
+                            layerChanges);
+    } else if (oldLayer->isImageLayer()) {
+        compareImageLayers(static_cast<const ImageLayer*>(oldLayer),
+                           static_cast<const ImageLayer*>(newLayer),
+                           changes);
+    }
+}
+
+/**
+ * Objects are matched by their ID. Objects without an ID, as saved by
+ * older versions, are matched in the order they appear in.
+ */
+void TmxDiff::compareObjectGroups(const ObjectGroup *oldGroup,
+                                  const ObjectGroup *newGroup,
+                                  LayerChanges &layerChanges) const
+{
+    QStringList &changes = layerChanges.changes;
+
+    compareValues(changes, "color",
+                  oldGroup->color().name(), newGroup->color().name());
+    compareValues(changes, "draw order",
+                  drawOrderToString(oldGroup->drawOrder()),
+                  drawOrderToString(newGroup->drawOrder()));
+
+    QHash<int, const MapObject*> oldObjects;
+    QList<const MapObject*> oldObjectsWithoutId;
+    foreach (const MapObject *object, oldGroup->objects()) {
+        if (object->id() > 0)
+            oldObjects.insert(object->id(), object);
+        else
+            oldObjectsWithoutId.append(object);
+    }
+
+    foreach (const MapObject *newObject, newGroup->objects()) {
+        const MapObject *oldObject = 0;
+        if (newObject->id() > 0)
+            oldObject = oldObjects.take(newObject->id());
+        else if (!oldObjectsWithoutId.isEmpty())
+            oldObject = oldObjectsWithoutId.takeFirst();
+
+        if (!oldObject) {
+            changes.append(objectName(newObject) + QLatin1String(" added"));
+            layerChanges.changedObjects.append(newObject);
+            continue;
+        }
+
+        const QStringList objectChangeList = objectChanges(oldObject, newObject);
+        if (!objectChangeList.isEmpty()) {
+            changes.append(objectName(oldObject) + QLatin1String(": ") +
+                           objectChangeList.join(QLatin1String(", ")));
+            layerChanges.changedObjects.append(newObject);
+        }
+    }
+
+    // Report the removed objects in the order of the old group
+    foreach (const MapObject *object, oldGroup->objects()) {
+        const bool remaining = object->id() > 0
+                ? oldObjects.contains(object->id())
+                : oldObjectsWithoutId.contains(object);
+        if (remaining) {
+            changes.append(objectName(object) + QLatin1String(" removed"));
+            layerChanges.removedObjects.append(object);
+        }
+    }
+}
+
+void TmxDiff::compareImageLayers(const ImageLayer *oldLayer,
+                                 const ImageLayer *newLayer,
+                                 QStringList &changes) const
+{
+    compareValues(changes, "image",
+                  oldLayer->imageSource(), newLayer->imageSource());
+    compareValues(changes, "transparent color",
+                  oldLayer->transparentColor().name(),
+                  newLayer->transparentColor().name());
+}
+
+void TmxDiff::report(QTextStream &out) const
+{
+    foreach (const QString &change, mMapChanges)
+        out << "map: " << change << '\n';
+
+    foreach (const LayerChanges &layerChanges, mLayerChanges) {
+        if (layerChanges.changes.isEmpty())
+            continue;
+
+        const Layer *layer = layerChanges.newLayer ? layerChanges.newLayer
+                                                   : layerChanges.oldLayer;
+        const QString name = QLatin1String("layer ") + quoted(layer->name());
+
+        foreach (const QString &change, layerChanges.changes) {
+            if (change.startsWith(QLatin1Char(' ')))
+                out << change << '\n';
+            else
+                out << name << ": " << change << '\n';
+        }
+    }
+}
+
+/**
+ * Renders the visible layers of the new map and highlights the changed
+ * cells and objects on top of them.
+ */
+bool TmxDiff::writeImage(const Map *newMap) const
+{
+    MapRenderer *renderer = createRenderer(newMap);
+
+    QSize imageSize = renderer->mapSize();
+    imageSize.rwidth() *= mScale;
+    imageSize.rheight() *= mScale;
+
+    QImage image(imageSize, QImage::Format_ARGB32);
+    image.fill(Qt::transparent);
+
+    QPainter painter(&image);
+    painter.setTransform(QTransform::fromScale(mScale, mScale));
+
+    const QRectF exposed(QPointF(), renderer->mapSize());
+
+    foreach (Layer *layer, newMap->layers()) {
+        if (!layer->isVisible())
+            continue;
+
+        painter.setOpacity(layer->opacity());
+
+        if (const TileLayer *tileLayer = layer->asTileLayer())
+            renderer->drawTileLayer(&painter, tileLayer, exposed);
+        else if (const ImageLayer *imageLayer = layer->asImageLayer())
+            renderer->drawImageLayer(&painter, imageLayer, exposed);
+    }
+
+    painter.setOpacity(1);
+
+    const QColor highlight(255, 0, 0, 128);
+    const QColor removed(0, 0, 255);
+
+    foreach (const LayerChanges &layerChanges, mLayerChanges) {
+        if (!layerChanges.changedCells.isEmpty()) {
+            const QPoint offset = layerChanges.newLayer->position();
+            const QRegion region = layerChanges.changedCells.translated(offset);
+            renderer->drawTileSelection(&painter, region, highlight, exposed);
+        }
+
+        foreach (const MapObject *object, layerChanges.changedObjects)
+            renderer->drawMapObject(&painter, object, highlight);
+        foreach (const MapObject *object, layerChanges.removedObjects)
+            renderer->drawMapObject(&painter, object, removed);
+    }
+
+    painter.end();
+    delete renderer;
+
+    if (!image.save(mImageFileName)) {
+        qWarning() << "Unable to write" << mImageFileName;
+        return false;
+    }
+    return true;
+}
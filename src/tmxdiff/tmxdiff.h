@@ -0,0 +1,130 @@
+/*
+ * tmxdiff.h
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of the TMX Diff tool.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TMXDIFF_H
+#define TMXDIFF_H
+
+#include <QList>
+#include <QRegion>
+#include <QString>
+#include <QStringList>
+
+class QTextStream;
+
+namespace Tiled {
+class ImageLayer;
+class Layer;
+class Map;
+class MapObject;
+class ObjectGroup;
+class TileLayer;
+class Tileset;
+}
+
+using namespace Tiled;
+
+/**
+ * Compares two maps and reports what changed, layer by layer. Meant for
+ * reviewing changes to maps under version control, where text diffs of
+ * the layer data are not useful.
+ *
+ * Tile layers are compared chunk by chunk using the content hashes of the
+ * chunks, so only the chunks that changed are compared cell by cell.
+ */
+class TmxDiff
+{
+public:
+    TmxDiff();
+    ~TmxDiff();
+
+    qreal scale() const { return mScale; }
+    int maxAreas() const { return mMaxAreas; }
+    const QString &imageFileName() const { return mImageFileName; }
+
+    void setScale(qreal scale) { mScale = scale; }
+
+    /**
+     * Sets the maximum number of changed areas that are listed for each
+     * tile layer. The remaining areas are only counted.
+     */
+    void setMaxAreas(int maxAreas) { mMaxAreas = maxAreas; }
+
+    /**
+     * Sets the file to which an image of the new map is written, in which
+     * the changes are highlighted. No image is written when the file name
+     * is empty.
+     */
+    void setImageFileName(const QString &fileName)
+    { mImageFileName = fileName; }
+
+    /**
+     * Compares the maps and writes the changes to the standard output.
+     *
+     * Returns 0 when the maps are the same, 1 when they differ and 2 when
+     * either of the maps could not be read.
+     */
+    int diff(const QString &oldFileName, const QString &newFileName);
+
+private:
+    struct LayerChanges
+    {
+        LayerChanges() : oldLayer(0), newLayer(0) {}
+
+        Layer *oldLayer;
+        Layer *newLayer;
+        QStringList changes;
+        QRegion changedCells;   // in the coordinates of the new layer
+        QList<const MapObject*> changedObjects;     // includes added ones
+        QList<const MapObject*> removedObjects;
+    };
+
+    void compareMaps(const Map *oldMap, const Map *newMap);
+    void unifyTilesets(const Map *oldMap, Map *newMap);
+    void matchLayers(const Map *oldMap, const Map *newMap);
+    void compareTileLayers();
+    void compareLayer(LayerChanges &layerChanges) const;
+    void compareObjectGroups(const ObjectGroup *oldGroup,
+                             const ObjectGroup *newGroup,
+                             LayerChanges &layerChanges) const;
+    void compareImageLayers(const ImageLayer *oldLayer,
+                            const ImageLayer *newLayer,
+                            QStringList &changes) const;
+
+    void report(QTextStream &out) const;
+    bool writeImage(const Map *newMap) const;
+
+    qreal mScale;
+    int mMaxAreas;
+    QString mImageFileName;
+
+    QStringList mMapChanges;
+    QList<LayerChanges> mLayerChanges;
+    QList<Tileset*> mReplacedTilesets;
+};
+
+#endif // TMXDIFF_H
@@ -0,0 +1,198 @@
+/*
+ * main.cpp
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of the TMX Lint tool.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "tmxlint.h"
+
+#if QT_VERSION >= 0x050000
+#include <QGuiApplication>
+#else
+#include <QApplication>
+#endif
+
+#include <QDebug>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QStringList>
+
+namespace {
+
+struct CommandLineOptions {
+    CommandLineOptions()
+        : showHelp(false)
+        , showVersion(false)
+        , maxCells(4096 * 4096)
+    {}
+
+    bool showHelp;
+    bool showVersion;
+    QStringList paths;
+    QStringList layers;
+    qint64 maxCells;
+};
+
+} // anonymous namespace
+
+static void showHelp()
+{
+    // TODO: Make translatable
+    qWarning() <<
+            "Usage:\n"
+            "  tmxlint [options] [files or directories...]\n"
+            "\n"
+            "Options:\n"
+            "  -h --help               : Display this help\n"
+            "  -v --version            : Display the version\n"
+            "     --layers NAMES       : Only check the layers with the given, comma\n"
+            "                            separated names\n"
+            "     --max-cells COUNT    : The number of cells above which a tile layer is\n"
+            "                            reported as oversized (default: 16777216)\n"
+            "\n"
+            "Directories are searched for .tmx files recursively. Each issue is written\n"
+            "on its own line, with tab separated fields: the file, the severity, the\n"
+            "name of the check and the message.\n"
+            "\n"
+            "The exit status is 0 when no errors were found, 1 when errors were found\n"
+            "and 2 when no maps were given.\n";
+}
+
+static void showVersion()
+{
+    qWarning() << "TMX Map Lint"
+            << qPrintable(QCoreApplication::applicationVersion());
+}
+
+static void parseCommandLineArguments(CommandLineOptions &options)
+{
+    const QStringList arguments = QCoreApplication::arguments();
+
+    for (int i = 1; i < arguments.size(); ++i) {
+        const QString &arg = arguments.at(i);
+        if (arg == QLatin1String("--help") || arg == QLatin1String("-h")) {
+            options.showHelp = true;
+        } else if (arg == QLatin1String("--version")
+                || arg == QLatin1String("-v")) {
+            options.showVersion = true;
+        } else if (arg == QLatin1String("--layers")) {
+            i++;
+            if (i >= arguments.size())
+                options.showHelp = true;
+            else
+                options.layers = arguments.at(i).split(QLatin1Char(','),
+                                                       QString::SkipEmptyParts);
+        } else if (arg == QLatin1String("--max-cells")) {
+            i++;
+            if (i >= arguments.size()) {
+                options.showHelp = true;
+            } else {
+                bool maxCellsIsInt;
+                options.maxCells = arguments.at(i).toLongLong(&maxCellsIsInt);
+                if (!maxCellsIsInt || options.maxCells < 0) {
+                    qWarning() << arguments.at(i) << ": the specified number of cells is not a positive integer.";
+                    options.showHelp = true;
+                }
+            }
+        } else if (arg.isEmpty()) {
+            options.showHelp = true;
+        } else if (arg.at(0) == QLatin1Char('-')) {
+            qWarning() << "Unknown option" << arg;
+            options.showHelp = true;
+        } else {
+            options.paths.append(arg);
+        }
+    }
+}
+
+/**
+ * Returns the maps at the given \a paths, searching directories for .tmx
+ * files. The maps found in each directory are sorted, so that the output
+ * doesn't depend on the order of the directory entries.
+ */
+static QStringList findMaps(const QStringList &paths)
+{
+    QStringList fileNames;
+
+    foreach (const QString &path, paths) {
+        if (!QFileInfo(path).isDir()) {
+            fileNames.append(path);
+            continue;
+        }
+
+        QStringList found;
+        QDirIterator it(path, QStringList(QLatin1String("*.tmx")),
+                        QDir::Files, QDirIterator::Subdirectories);
+        while (it.hasNext())
+            found.append(it.next());
+
+        found.sort();
+        fileNames.append(found);
+    }
+
+    return fileNames;
+}
+
+int main(int argc, char *argv[])
+{
+    // Tiles hold pixmaps, which needs a GUI application. No window is
+    // shown, so there is no need for a display.
+#if QT_VERSION >= 0x050000
+    if (qgetenv("QT_QPA_PLATFORM").isEmpty())
+        qputenv("QT_QPA_PLATFORM", "minimal");
+
+    QGuiApplication a(argc, argv);
+#else
+    QApplication a(argc, argv);
+#endif
+
+    a.setOrganizationDomain(QLatin1String("mapeditor.org"));
+    a.setApplicationName(QLatin1String("TmxLint"));
+    a.setApplicationVersion(QLatin1String("1.0"));
+
+    CommandLineOptions options;
+    parseCommandLineArguments(options);
+
+    if (options.showVersion) {
+        showVersion();
+        return 0;
+    }
+    if (options.showHelp) {
+        showHelp();
+        return 0;
+    }
+
+    const QStringList fileNames = findMaps(options.paths);
+    if (fileNames.isEmpty()) {
+        showHelp();
+        return 2;
+    }
+
+    TmxLint lint;
+    lint.setLayerFilter(options.layers);
+    lint.setMaxCells(options.maxCells);
+
+    return lint.lint(fileNames);
+}
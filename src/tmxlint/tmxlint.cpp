@@ -0,0 +1,371 @@
+/*
+ * tmxlint.cpp
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of the TMX Lint tool.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "tmxlint.h"
+
+#include "imagelayer.h"
+#include "jobsystem.h"
+#include "map.h"
+#include "mapobject.h"
+#include "mapreader.h"
+#include "objectgroup.h"
+#include "tile.h"
+#include "tilelayer.h"
+#include "tileset.h"
+
+#include <QFileInfo>
+#include <QImageReader>
+#include <QRunnable>
+#include <QTextStream>
+#include <QVector>
+
+#include <cstdio>
+
+namespace {
+
+/**
+ * Reads the external tilesets of a map through the cache.
+ */
+class LintReader : public MapReader
+{
+public:
+    explicit LintReader(LintCache &cache)
+        : mCache(cache)
+    {}
+
+protected:
+    Tileset *readExternalTileset(const QString &source, QString *error)
+    {
+        return mCache.tileset(source, error);
+    }
+
+private:
+    LintCache &mCache;
+};
+
+class MapLintJob : public QRunnable
+{
+public:
+    MapLintJob(const TmxLint *lint,
+               const QString &fileName,
+               LintCache *cache,
+               QList<TmxLint::Issue> *issues)
+        : mLint(lint)
+        , mFileName(fileName)
+        , mCache(cache)
+        , mIssues(issues)
+    {}
+
+    void run()
+    {
+        *mIssues = mLint->lintMap(mFileName, *mCache);
+    }
+
+private:
+    const TmxLint *mLint;
+    const QString mFileName;
+    LintCache *mCache;
+    QList<TmxLint::Issue> *mIssues;
+};
+
+} // anonymous namespace
+
+/**
+ * Checks whether the image at \a source can be read, looking only at its
+ * header.
+ */
+static QString checkImage(const QString &source)
+{
+    if (!QFileInfo(source).isFile())
+        return QString(QLatin1String("missing image '%1'")).arg(source);
+
+    QImageReader reader(source);
+    if (!reader.canRead())
+        return QString(QLatin1String("unreadable image '%1'")).arg(source);
+
+    return QString();
+}
+
+static void checkTilesetImages(const Tileset *tileset,
+                               const QString &fileName,
+                               LintCache &cache,
+                               QList<TmxLint::Issue> &issues)
+{
+    if (!tileset->imageSource().isEmpty()) {
+        const QString error = cache.imageError(tileset->imageSource());
+        if (!error.isEmpty()) {
+            issues.append(TmxLint::Issue(fileName, TmxLint::Error,
+                                         QLatin1String("image"),
+                                         QString(QLatin1String("tileset '%1': %2"))
+                                         .arg(tileset->name(), error)));
+        }
+        return;
+    }
+
+    // Images embedded in the tileset don't have a source
+    foreach (const Tile *tile, tileset->tiles()) {
+        if (tile->imageSource().isEmpty())
+            continue;
+
+        const QString error = cache.imageError(tile->imageSource());
+        if (!error.isEmpty()) {
+            issues.append(TmxLint::Issue(fileName, TmxLint::Error,
+                                         QLatin1String("image"),
+                                         QString(QLatin1String("tileset '%1', tile %2: %3"))
+                                         .arg(tileset->name())
+                                         .arg(tile->id())
+                                         .arg(error)));
+        }
+    }
+}
+
+
+LintCache::~LintCache()
+{
+    qDeleteAll(mOwnedTilesets);
+}
+
+Tileset *LintCache::tileset(const QString &fileName, QString *error)
+{
+    QMutexLocker locker(&mTilesetMutex);
+
+    QHash<QString, Tileset*>::const_iterator it = mTilesets.constFind(fileName);
+    if (it != mTilesets.constEnd()) {
+        if (!it.value())
+            *error = mTilesetErrors.value(fileName);
+        return it.value();
+    }
+
+    MapReader reader;
+    reader.setImageLoading(false);
+    reader.setDeferredImageLoading(true);
+
+    Tileset *tileset = reader.readTileset(fileName);
+    mTilesets.insert(fileName, tileset);
+
+    if (tileset) {
+        mOwnedTilesets.insert(tileset);
+        checkTilesetImages(tileset, fileName, *this, mTilesetIssues);
+    } else {
+        *error = reader.errorString();
+        mTilesetErrors.insert(fileName, *error);
+    }
+
+    return tileset;
+}
+
+bool LintCache::owns(const Tileset *tileset) const
+{
+    QMutexLocker locker(&mTilesetMutex);
+    return mOwnedTilesets.contains(tileset);
+}
+
+QString LintCache::imageError(const QString &source)
+{
+    QMutexLocker locker(&mImageMutex);
+
+    QHash<QString, QString>::const_iterator it = mImageErrors.constFind(source);
+    if (it != mImageErrors.constEnd())
+        return it.value();
+
+    // Other images may be checked in the meantime
+    locker.unlock();
+    const QString error = checkImage(source);
+    locker.relock();
+
+    mImageErrors.insert(source, error);
+    return error;
+}
+
+QList<TmxLint::Issue> LintCache::tilesetIssues() const
+{
+    QMutexLocker locker(&mTilesetMutex);
+    return mTilesetIssues;
+}
+
+
+TmxLint::TmxLint()
+    : mMaxCells(4096 * 4096)
+{
+}
+
+int TmxLint::lint(const QStringList &fileNames) const
+{
+    LintCache cache;
+    QVector<QList<Issue> > results(fileNames.size());
+
+    {
+        JobGroup jobs(JobSystem::Interactive);
+        for (int i = 0; i < fileNames.size(); ++i)
+            jobs.start(new MapLintJob(this, fileNames.at(i), &cache,
+                                      &results[i]));
+        jobs.wait();
+    }
+
+    // The issues of the external tilesets are reported after the maps
+    results.append(cache.tilesetIssues());
+
+    QTextStream out(stdout);
+    int errorCount = 0;
+    int warningCount = 0;
+
+    foreach (const QList<Issue> &issues, results) {
+        foreach (const Issue &issue, issues) {
+            if (issue.severity == Error)
+                ++errorCount;
+            else
+                ++warningCount;
+
+            // Keep each issue on a single line
+            out << issue.fileName << '\t'
+                << (issue.severity == Error ? "error" : "warning") << '\t'
+                << issue.check << '\t'
+                << issue.message.simplified() << '\n';
+        }
+    }
+    out.flush();
+
+    QTextStream(stderr) << fileNames.size() << " maps checked, "
+                        << errorCount << " errors, "
+                        << warningCount << " warnings\n";
+
+    return errorCount > 0 ? 1 : 0;
+}
+
+QList<TmxLint::Issue> TmxLint::lintMap(const QString &fileName,
+                                       LintCache &cache) const
+{
+    QList<Issue> issues;
+
+    LintReader reader(cache);
+    reader.setImageLoading(false);
+    reader.setDeferredImageLoading(true);   // embedded images are still read
+    reader.setMemoryMappingEnabled(true);
+    reader.setParallelLayerDecoding(true);
+    reader.setLayerFilter(mLayerFilter);
+
+    // Tiles that don't exist in the tilesets make reading fail
+    Map *map = reader.readMap(fileName);
+    if (!map) {
+        issues.append(Issue(fileName, Error, QLatin1String("read"),
+                            reader.errorString()));
+        return issues;
+    }
+
+    const QList<Tileset*> tilesets = map->tilesets();
+    foreach (const Tileset *tileset, tilesets)
+        if (!cache.owns(tileset))
+            checkTilesetImages(tileset, fileName, cache, issues);
+
+    checkLayers(map, fileName, cache, issues);
+    checkObjectIds(map, fileName, issues);
+
+    delete map;
+    foreach (Tileset *tileset, tilesets)
+        if (!cache.owns(tileset))
+            delete tileset;
+
+    return issues;
+}
+
+void TmxLint::checkLayers(const Map *map, const QString &fileName,
+                          LintCache &cache, QList<Issue> &issues) const
+{
+    const QRect mapBounds(0, 0, map->width(), map->height());
+
+    foreach (Layer *layer, map->layers()) {
+        if (TileLayer *tileLayer = layer->asTileLayer()) {
+            const qint64 cells = qint64(tileLayer->width()) *
+                    tileLayer->height();
+
+            if (cells > mMaxCells) {
+                issues.append(Issue(fileName, Warning,
+                                    QLatin1String("layer-size"),
+                                    QString(QLatin1String("layer '%1' has %2 cells, more than %3"))
+                                    .arg(layer->name())
+                                    .arg(cells)
+                                    .arg(mMaxCells)));
+            }
+
+            if (!map->isInfinite() && !mapBounds.contains(tileLayer->bounds())) {
+                issues.append(Issue(fileName, Warning,
+                                    QLatin1String("layer-size"),
+                                    QString(QLatin1String("layer '%1' extends outside of the map"))
+                                    .arg(layer->name())));
+            }
+        } else if (ImageLayer *imageLayer = layer->asImageLayer()) {
+            if (imageLayer->imageSource().isEmpty())
+                continue;
+
+            const QString error = cache.imageError(imageLayer->imageSource());
+            if (!error.isEmpty()) {
+                issues.append(Issue(fileName, Error, QLatin1String("image"),
+                                    QString(QLatin1String("layer '%1': %2"))
+                                    .arg(layer->name(), error)));
+            }
+        }
+    }
+}
+
+/**
+ * Objects refer to each other by their IDs, so these need to be unique.
+ * IDs at or above the next object ID would be given out again to new
+ * objects.
+ */
+void TmxLint::checkObjectIds(const Map *map, const QString &fileName,
+                             QList<Issue> &issues) const
+{
+    QHash<int, const ObjectGroup*> usedIds;
+
+    foreach (Layer *layer, map->layers()) {
+        const ObjectGroup *objectGroup = layer->asObjectGroup();
+        if (!objectGroup)
+            continue;
+
+        foreach (const MapObject *object, objectGroup->objects()) {
+            const int id = object->id();
+
+            if (const ObjectGroup *other = usedIds.value(id)) {
+                issues.append(Issue(fileName, Error, QLatin1String("object-id"),
+                                    QString(QLatin1String("object ID %1 in layer '%2' is already used in layer '%3'"))
+                                    .arg(id)
+                                    .arg(objectGroup->name(), other->name())));
+                continue;
+            }
+            usedIds.insert(id, objectGroup);
+
+            if (id >= map->nextObjectId()) {
+                issues.append(Issue(fileName, Warning, QLatin1String("object-id"),
+                                    QString(QLatin1String("object ID %1 in layer '%2' is not below the next object ID %3"))
+                                    .arg(id)
+                                    .arg(objectGroup->name())
+                                    .arg(map->nextObjectId())));
+            }
+        }
+    }
+}
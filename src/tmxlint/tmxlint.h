@@ -0,0 +1,167 @@
+/*
+ * tmxlint.h
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of the TMX Lint tool.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TMXLINT_H
+#define TMXLINT_H
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+class LintCache;
+
+namespace Tiled {
+class Map;
+class Tileset;
+}
+
+using namespace Tiled;
+
+/**
+ * Checks maps for problems that would otherwise only show up when they are
+ * loaded: images that are missing, tiles that don't exist in the tilesets,
+ * object IDs that are used twice and layers that are too large.
+ *
+ * The maps are read on the job system in parallel, without loading the
+ * images of their tilesets and image layers. External tilesets are only
+ * read once for all the maps.
+ */
+class TmxLint
+{
+public:
+    enum Severity {
+        Warning,
+        Error
+    };
+
+    struct Issue
+    {
+        Issue(const QString &fileName, Severity severity,
+              const QString &check, const QString &message)
+            : fileName(fileName)
+            , severity(severity)
+            , check(check)
+            , message(message)
+        {}
+
+        QString fileName;
+        Severity severity;
+        QString check;
+        QString message;
+    };
+
+    TmxLint();
+
+    const QStringList &layerFilter() const { return mLayerFilter; }
+    qint64 maxCells() const { return mMaxCells; }
+
+    /**
+     * Sets the names of the layers to check. Other layers are skipped while
+     * reading the maps. An empty list, the default, checks all layers.
+     */
+    void setLayerFilter(const QStringList &layerNames)
+    { mLayerFilter = layerNames; }
+
+    /**
+     * Sets the number of cells above which a tile layer is reported as
+     * oversized.
+     */
+    void setMaxCells(qint64 maxCells) { mMaxCells = maxCells; }
+
+    /**
+     * Checks the given maps and writes the issues found to the standard
+     * output, one per line with tab separated fields: the file, the
+     * severity, the name of the check and the message.
+     *
+     * Returns 0 when no errors were found and 1 otherwise.
+     */
+    int lint(const QStringList &fileNames) const;
+
+    /**
+     * Checks a single map. Called from the job system, so it may not touch
+     * any state other than the given \a cache.
+     */
+    QList<Issue> lintMap(const QString &fileName, LintCache &cache) const;
+
+private:
+    void checkLayers(const Map *map, const QString &fileName,
+                     LintCache &cache, QList<Issue> &issues) const;
+    void checkObjectIds(const Map *map, const QString &fileName,
+                        QList<Issue> &issues) const;
+
+    QStringList mLayerFilter;
+    qint64 mMaxCells;
+};
+
+/**
+ * The state shared by the checks of all maps, so that each external tileset
+ * is only read once and each image is only checked once.
+ */
+class LintCache
+{
+public:
+    ~LintCache();
+
+    /**
+     * Returns the tileset read from \a fileName, reading it when it is
+     * requested for the first time. The images of the tileset are checked
+     * when it is read, and any issues found are added to tilesetIssues().
+     *
+     * Returns 0 and sets \a error when the tileset can't be read.
+     */
+    Tileset *tileset(const QString &fileName, QString *error);
+
+    /**
+     * Returns whether \a tileset was read by this cache, in which case it is
+     * owned by it.
+     */
+    bool owns(const Tileset *tileset) const;
+
+    /**
+     * Returns why the image at \a source can't be used, or an empty string
+     * when it can.
+     */
+    QString imageError(const QString &source);
+
+    QList<TmxLint::Issue> tilesetIssues() const;
+
+private:
+    mutable QMutex mTilesetMutex;
+    QHash<QString, Tileset*> mTilesets;     // 0 for tilesets that failed
+    QHash<QString, QString> mTilesetErrors;
+    QSet<const Tileset*> mOwnedTilesets;
+    QList<TmxLint::Issue> mTilesetIssues;
+
+    QMutex mImageMutex;
+    QHash<QString, QString> mImageErrors;
+};
+
+#endif // TMXLINT_H
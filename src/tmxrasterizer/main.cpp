@@ -35,7 +35,10 @@
 #endif
 
 #include <QDebug>
+#include <QFile>
+#include <QPair>
 #include <QStringList>
+#include <QTextStream>
 
 namespace {
 
@@ -47,6 +50,12 @@ struct CommandLineOptions {
         , tileSize(0)
         , useAntiAliasing(false)
         , ignoreVisibility(false)
+        , threadCount(0)
+        , batch(false)
+        , pyramid(false)
+        , stream(false)
+        , animated(false)
+        , showObjects(false)
     {}
 
     bool showHelp;
@@ -57,6 +66,14 @@ struct CommandLineOptions {
     int tileSize;
     bool useAntiAliasing;
     bool ignoreVisibility;
+    int threadCount;
+    bool batch;
+    bool pyramid;
+    bool stream;
+    bool animated;
+    bool showObjects;
+    QString batchFile;
+    QStringList batchFiles;
     QStringList layersToHide;
 };
 
@@ -68,6 +85,9 @@ static void showHelp()
     qWarning() <<
             "Usage:\n"
             "  tmxrasterizer [options] [input file] [output file]\n"
+            "  tmxrasterizer [options] --batch [input file] [output file] ...\n"
+            "  tmxrasterizer [options] --batch-file [list file]\n"
+            "  tmxrasterizer [options] --pyramid [input file] [output directory]\n"
             "\n"
             "Options:\n"
             "  -h --help               : Display this help\n"
@@ -79,7 +99,21 @@ static void showHelp()
             "     --ignore-visibility  : Ignore all layer visibility flags in the map file, and render all\n"
             "                            layers in the output (default is to omit invisible layers)\n"
             "     --hide-layer         : Specifies a layer to omit from the output image\n"
-            "                            Can be repeated to hide multiple layers\n";
+            "                            Can be repeated to hide multiple layers\n"
+            "     --show-objects       : Draw the object layers (default is to omit them)\n"
+            "     --threads COUNT      : The number of threads used for rendering (default: 1,\n"
+            "                            or one per core in batch, pyramid and animated mode)\n"
+            "     --batch              : Render any number of input files, each followed by\n"
+            "                            its output file, sharing the loaded tilesets\n"
+            "     --batch-file FILE    : Like --batch, but reads the files from FILE, which\n"
+            "                            has an input and output file on each line separated\n"
+            "                            by a tab\n"
+            "     --pyramid            : Render the map to a pyramid of 256x256 images, stored\n"
+            "                            as z/x/y.png in the output directory\n"
+            "     --stream             : Write the output image as PNG one band of rows at a\n"
+            "                            time, for maps too large to fit in memory\n"
+            "     --animated           : Write an animated PNG showing the animations of the\n"
+            "                            tiles\n";
 }
 
 static void showVersion()
@@ -125,6 +159,36 @@ static void parseCommandLineArguments(CommandLineOptions &options)
                     options.showHelp = true;
                 }
             }
+        } else if (arg == QLatin1String("--threads")) {
+            i++;
+            if (i >= arguments.size()) {
+                options.showHelp = true;
+            } else {
+                bool threadCountIsInt;
+                options.threadCount = arguments.at(i).toInt(&threadCountIsInt);
+                if (!threadCountIsInt || options.threadCount < 1) {
+                    qWarning() << arguments.at(i) << ": the specified thread count is not a positive integer.";
+                    options.showHelp = true;
+                }
+            }
+        } else if (arg == QLatin1String("--batch")) {
+            options.batch = true;
+        } else if (arg == QLatin1String("--batch-file")) {
+            i++;
+            if (i >= arguments.size()) {
+                options.showHelp = true;
+            } else {
+                options.batch = true;
+                options.batchFile = arguments.at(i);
+            }
+        } else if (arg == QLatin1String("--pyramid")) {
+            options.pyramid = true;
+        } else if (arg == QLatin1String("--stream")) {
+            options.stream = true;
+        } else if (arg == QLatin1String("--animated")) {
+            options.animated = true;
+        } else if (arg == QLatin1String("--show-objects")) {
+            options.showObjects = true;
         } else if (arg == QLatin1String("--hide-layer")) {
             i++;
             if (i >= arguments.size()) {
@@ -142,6 +206,8 @@ static void parseCommandLineArguments(CommandLineOptions &options)
         } else if (arg.at(0) == QLatin1Char('-')) {
             qWarning() << "Unknown option" << arg;
             options.showHelp = true;
+        } else if (options.batch) {
+            options.batchFiles.append(arg);
         } else if (options.fileToOpen.isEmpty()) {
             options.fileToOpen = arg;
         } else if (options.fileToSave.isEmpty()) {
@@ -153,6 +219,57 @@ static void parseCommandLineArguments(CommandLineOptions &options)
     }
 }
 
+typedef QList<QPair<QString, QString> > FilePairs;
+
+/**
+ * Collects the input and output files to render in batch mode, either from
+ * the command line or from the batch file. Returns false on error.
+ */
+static bool collectBatchFiles(const CommandLineOptions &options,
+                              FilePairs &files)
+{
+    if (!options.batchFile.isEmpty()) {
+        QFile file(options.batchFile);
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            qWarning() << "Unable to open" << options.batchFile;
+            return false;
+        }
+
+        QTextStream stream(&file);
+        int lineNumber = 0;
+        while (!stream.atEnd()) {
+            const QString line = stream.readLine();
+            ++lineNumber;
+            if (line.trimmed().isEmpty())
+                continue;
+
+            const QStringList parts = line.split(QLatin1Char('\t'));
+            if (parts.size() != 2) {
+                qWarning().nospace() << options.batchFile << ":" << lineNumber
+                                     << ": expected an input and output file separated by a tab";
+                return false;
+            }
+            files.append(qMakePair(parts.at(0), parts.at(1)));
+        }
+    }
+
+    QStringList arguments = options.batchFiles;
+    if (!options.fileToSave.isEmpty())
+        arguments.prepend(options.fileToSave);
+    if (!options.fileToOpen.isEmpty())
+        arguments.prepend(options.fileToOpen);
+
+    if (arguments.size() % 2 != 0) {
+        qWarning() << "Each input file needs to be followed by an output file";
+        return false;
+    }
+
+    for (int i = 0; i < arguments.size(); i += 2)
+        files.append(qMakePair(arguments.at(i), arguments.at(i + 1)));
+
+    return true;
+}
+
 int main(int argc, char *argv[])
 {
 #if QT_VERSION >= 0x050000
@@ -172,7 +289,18 @@ int main(int argc, char *argv[])
         showVersion();
         return 0;
     }
-    if (options.showHelp || options.fileToOpen.isEmpty() || options.fileToSave.isEmpty()) {
+
+    FilePairs batchFiles;
+    if (options.batch && !options.showHelp) {
+        if (!collectBatchFiles(options, batchFiles))
+            return 1;
+    }
+
+    const bool missingFiles = options.batch
+            ? batchFiles.isEmpty()
+            : options.fileToOpen.isEmpty() || options.fileToSave.isEmpty();
+
+    if (options.showHelp || missingFiles) {
         showHelp();
         return 0;
     }
@@ -185,6 +313,10 @@ int main(int argc, char *argv[])
     w.setAntiAliasing(options.useAntiAliasing);
     w.setIgnoreVisibility(options.ignoreVisibility);
     w.setLayersToHide(options.layersToHide);
+    w.setThreadCount(options.threadCount);
+    w.setStreamOutput(options.stream);
+    w.setAnimated(options.animated);
+    w.setShowObjects(options.showObjects);
 
 
     if (options.tileSize > 0) {
@@ -193,6 +325,11 @@ int main(int argc, char *argv[])
         w.setScale(options.scale);
     }
 
+    if (options.batch)
+        return w.renderBatch(batchFiles);
+    if (options.pyramid)
+        return w.renderPyramid(options.fileToOpen, options.fileToSave);
+
     return w.render(options.fileToOpen, options.fileToSave);
 }
 
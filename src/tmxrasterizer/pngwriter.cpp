@@ -0,0 +1,301 @@
+/*
+ * pngwriter.cpp
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of the TMX Rasterizer.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "pngwriter.h"
+
+#if defined(Q_OS_WIN) && QT_VERSION >= 0x050000
+#include <QtZlib/zlib.h>
+#else
+#include <zlib.h>
+#endif
+
+#include <QImage>
+#include <QtEndian>
+
+namespace {
+
+// The amount of compressed data collected before writing an IDAT chunk
+const int OutputBufferSize = 256 * 1024;
+
+QByteArray bigEndian(quint32 value)
+{
+    uchar bytes[4];
+    qToBigEndian(value, bytes);
+    return QByteArray(reinterpret_cast<const char*>(bytes), 4);
+}
+
+QByteArray bigEndian16(quint16 value)
+{
+    uchar bytes[2];
+    qToBigEndian(value, bytes);
+    return QByteArray(reinterpret_cast<const char*>(bytes), 2);
+}
+
+} // anonymous namespace
+
+struct PngWriter::Stream : z_stream
+{
+};
+
+PngWriter::PngWriter()
+    : mStream(0)
+    , mWidth(0)
+    , mHeight(0)
+    , mFrameCount(1)
+    , mFrameIndex(0)
+    , mSequenceNumber(0)
+    , mRowsWritten(0)
+    , mOutputSize(0)
+{
+}
+
+PngWriter::~PngWriter()
+{
+    if (mStream) {
+        deflateEnd(mStream);
+        delete mStream;
+    }
+}
+
+bool PngWriter::open(const QString &fileName, int width, int height,
+                     int frameCount)
+{
+    Q_ASSERT(!mStream);
+
+    mFile.setFileName(fileName);
+    if (!mFile.open(QIODevice::WriteOnly))
+        return false;
+
+    mWidth = width;
+    mHeight = height;
+    mFrameCount = qMax(1, frameCount);
+    mSequenceNumber = 0;
+    mFrameRect = QRect(0, 0, width, height);
+    mRowsWritten = 0;
+
+    // The frames of an animation are started by beginFrame()
+    mFrameIndex = mFrameCount > 1 ? -1 : 0;
+
+    mStream = new Stream;
+    mStream->zalloc = Z_NULL;
+    mStream->zfree = Z_NULL;
+    mStream->opaque = Z_NULL;
+    if (deflateInit(mStream, Z_DEFAULT_COMPRESSION) != Z_OK) {
+        delete mStream;
+        mStream = 0;
+        return false;
+    }
+
+    // Each row starts with its filter type, which is always 0 (none)
+    mRow.resize(1 + width * 4);
+    mRow[0] = 0;
+    mOutput.resize(OutputBufferSize);
+    mOutputSize = 0;
+
+    static const char signature[] = { '\x89', 'P', 'N', 'G',
+                                      '\r', '\n', '\x1a', '\n' };
+    if (mFile.write(signature, sizeof(signature)) != sizeof(signature))
+        return false;
+
+    QByteArray header;
+    header += bigEndian(width);
+    header += bigEndian(height);
+    header += char(8);  // bit depth
+    header += char(6);  // color type: RGBA
+    header += char(0);  // compression method
+    header += char(0);  // filter method
+    header += char(0);  // interlace method
+    if (!writeChunk("IHDR", header))
+        return false;
+
+    if (mFrameCount > 1) {
+        QByteArray animationControl;
+        animationControl += bigEndian(mFrameCount);
+        animationControl += bigEndian(0);     // number of plays: forever
+        if (!writeChunk("acTL", animationControl))
+            return false;
+    }
+
+    return true;
+}
+
+bool PngWriter::beginFrame(const QRect &rect, int delay)
+{
+    Q_ASSERT(mStream);
+    Q_ASSERT(mFrameIndex + 1 < mFrameCount);
+    Q_ASSERT(mFrameIndex >= 0 || rect == QRect(0, 0, mWidth, mHeight));
+    Q_ASSERT(QRect(0, 0, mWidth, mHeight).contains(rect));
+
+    if (mFrameIndex >= 0 && !finishFrame())
+        return false;
+
+    ++mFrameIndex;
+    mFrameRect = rect;
+    mRowsWritten = 0;
+    mRow.resize(1 + rect.width() * 4);
+
+    QByteArray frameControl;
+    frameControl += bigEndian(mSequenceNumber++);
+    frameControl += bigEndian(rect.width());
+    frameControl += bigEndian(rect.height());
+    frameControl += bigEndian(rect.x());
+    frameControl += bigEndian(rect.y());
+    frameControl += bigEndian16(qBound(0, delay, 0xFFFF));
+    frameControl += bigEndian16(1000);  // the delay is in milliseconds
+    frameControl += char(0);            // dispose op: none
+    frameControl += char(0);            // blend op: source
+    return writeChunk("fcTL", frameControl);
+}
+
+bool PngWriter::writeRows(const QImage &image)
+{
+    Q_ASSERT(mStream);
+    Q_ASSERT(mFrameIndex >= 0);
+    Q_ASSERT(image.width() == mFrameRect.width());
+    Q_ASSERT(image.format() == QImage::Format_ARGB32);
+
+    const int width = mFrameRect.width();
+    const int height = mFrameRect.height();
+
+    for (int y = 0; y < image.height() && mRowsWritten < height; ++y) {
+        const QRgb *line = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+        uchar *row = reinterpret_cast<uchar*>(mRow.data()) + 1;
+
+        for (int x = 0; x < width; ++x) {
+            const QRgb pixel = line[x];
+            *row++ = qRed(pixel);
+            *row++ = qGreen(pixel);
+            *row++ = qBlue(pixel);
+            *row++ = qAlpha(pixel);
+        }
+
+        mStream->next_in = reinterpret_cast<Bytef*>(mRow.data());
+        mStream->avail_in = mRow.size();
+        if (!deflate(Z_NO_FLUSH))
+            return false;
+
+        ++mRowsWritten;
+    }
+
+    return true;
+}
+
+bool PngWriter::close()
+{
+    Q_ASSERT(mStream);
+    Q_ASSERT(mFrameIndex == mFrameCount - 1);
+
+    if (!finishFrame())
+        return false;
+
+    deflateEnd(mStream);
+    delete mStream;
+    mStream = 0;
+
+    if (!writeChunk("IEND", QByteArray()))
+        return false;
+
+    mFile.close();
+    return mFile.error() == QFile::NoError;
+}
+
+/**
+ * Compresses the remaining rows of the current frame and resets the stream
+ * for the next one.
+ */
+bool PngWriter::finishFrame()
+{
+    Q_ASSERT(mRowsWritten == mFrameRect.height());
+
+    mStream->next_in = Z_NULL;
+    mStream->avail_in = 0;
+    if (!deflate(Z_FINISH))
+        return false;
+
+    return deflateReset(mStream) == Z_OK;
+}
+
+/**
+ * Compresses the pending input, writing a chunk of image data each time the
+ * output buffer is full. With Z_FINISH, also writes the remaining output.
+ */
+bool PngWriter::deflate(int flush)
+{
+    for (;;) {
+        mStream->next_out = reinterpret_cast<Bytef*>(mOutput.data()) + mOutputSize;
+        mStream->avail_out = OutputBufferSize - mOutputSize;
+
+        const int result = ::deflate(mStream, flush);
+        if (result == Z_STREAM_ERROR)
+            return false;
+
+        mOutputSize = OutputBufferSize - mStream->avail_out;
+
+        const bool finished = flush == Z_FINISH && result == Z_STREAM_END;
+        if (mOutputSize == OutputBufferSize || (finished && mOutputSize > 0)) {
+            if (!writeImageData(QByteArray::fromRawData(mOutput.constData(),
+                                                        mOutputSize)))
+                return false;
+            mOutputSize = 0;
+        }
+
+        if (finished)
+            return true;
+
+        // All input was consumed and there was room left for the output
+        if (flush != Z_FINISH && mStream->avail_in == 0 && mStream->avail_out > 0)
+            return true;
+    }
+}
+
+/**
+ * Writes compressed image data. The data of the first frame is the image
+ * that is shown by viewers that don't support animations, while the data
+ * of the other frames is numbered along with their frame control chunks.
+ */
+bool PngWriter::writeImageData(const QByteArray &data)
+{
+    if (mFrameIndex == 0)
+        return writeChunk("IDAT", data);
+
+    return writeChunk("fdAT", bigEndian(mSequenceNumber++) + data);
+}
+
+bool PngWriter::writeChunk(const char *type, const QByteArray &data)
+{
+    QByteArray chunk = bigEndian(data.size());
+    chunk += QByteArray(type, 4);
+    chunk += data;
+
+    const uLong crc = crc32(crc32(0L, Z_NULL, 0),
+                            reinterpret_cast<const Bytef*>(chunk.constData() + 4),
+                            chunk.size() - 4);
+    chunk += bigEndian(crc);
+
+    return mFile.write(chunk) == chunk.size();
+}
@@ -0,0 +1,107 @@
+/*
+ * pngwriter.h
+ * Copyright 2015, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of the TMX Rasterizer.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PNGWRITER_H
+#define PNGWRITER_H
+
+#include <QFile>
+#include <QRect>
+#include <QString>
+
+class QImage;
+
+/**
+ * Writes a PNG image row by row, so that images can be written that would
+ * not fit in memory as a whole. The rows are compressed as they come in,
+ * so only a small buffer is kept.
+ *
+ * Can also write an animated PNG (APNG), in which each frame after the
+ * first one replaces a part of the image.
+ */
+class PngWriter
+{
+public:
+    PngWriter();
+    ~PngWriter();
+
+    /**
+     * Creates the file \a fileName and writes the header for an image of
+     * the given size. When \a frameCount is more than one, an animated
+     * image is written, which loops forever. Returns false on error.
+     */
+    bool open(const QString &fileName, int width, int height,
+              int frameCount = 1);
+
+    /**
+     * Starts the next frame of an animated image, which replaces the given
+     * \a rect of the image and is shown for \a delay milliseconds. Needs
+     * to be called before the rows of each frame, including the first one,
+     * which has to cover the whole image. Returns false on error.
+     */
+    bool beginFrame(const QRect &rect, int delay);
+
+    /**
+     * Writes the rows of the given \a image, which needs to be as wide as
+     * the PNG image, or as the current frame, and in ARGB32 format. Returns
+     * false on error.
+     */
+    bool writeRows(const QImage &image);
+
+    /**
+     * Finishes the image after all rows have been written. Returns false on
+     * error.
+     */
+    bool close();
+
+    QString errorString() const { return mFile.errorString(); }
+
+private:
+    struct Stream;
+
+    bool deflate(int flush);
+    bool finishFrame();
+    bool writeImageData(const QByteArray &data);
+    bool writeChunk(const char *type, const QByteArray &data);
+
+    QFile mFile;
+    Stream *mStream;
+    int mWidth;
+    int mHeight;
+    int mFrameCount;
+    int mFrameIndex;
+    quint32 mSequenceNumber;
+    QRect mFrameRect;
+    int mRowsWritten;
+    QByteArray mRow;
+    QByteArray mOutput;
+    int mOutputSize;
+
+    Q_DISABLE_COPY(PngWriter)
+};
+
+#endif // PNGWRITER_H
@@ -32,14 +32,32 @@
 #include "imagelayer.h"
 #include "isometricrenderer.h"
 #include "map.h"
+#include "mapobject.h"
 #include "mapreader.h"
 #include "objectgroup.h"
 #include "orthogonalrenderer.h"
+#include "pngwriter.h"
 #include "staggeredrenderer.h"
+#include "tile.h"
 #include "tilelayer.h"
+#include "tileset.h"
 
-
+#include <QAtomicInt>
 #include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QPainterPath>
+#include <QRunnable>
+#include <QSet>
+#include <QThread>
+#include <QThreadPool>
+#include <QVector>
+#include <QtAlgorithms>
+
+#include <algorithm>
 
 using namespace Tiled;
 
@@ -47,7 +65,11 @@ TmxRasterizer::TmxRasterizer():
     mScale(1.0),
     mTileSize(0),
     mUseAntiAliasing(true),
-    mIgnoreVisibility(false)
+    mIgnoreVisibility(false),
+    mThreadCount(0),
+    mStreamOutput(false),
+    mAnimated(false),
+    mShowObjects(false)
 {
 }
 
@@ -55,9 +77,9 @@ TmxRasterizer::~TmxRasterizer()
 {
 }
 
-bool TmxRasterizer::shouldDrawLayer(Layer *layer)
+bool TmxRasterizer::shouldDrawLayer(Layer *layer) const
 {
-    if (layer->isObjectGroup())
+    if (layer->isObjectGroup() && !mShowObjects)
         return false;
 
     if (mLayersToHide.contains(layer->name(), Qt::CaseInsensitive)) 
@@ -69,35 +91,332 @@ bool TmxRasterizer::shouldDrawLayer(Layer *layer)
     return layer->isVisible();
 }
 
-int TmxRasterizer::render(const QString &mapFileName,
-                          const QString &imageFileName)
-{
-    Map *map;
-    MapRenderer *renderer;
-    MapReader reader;
-    map = reader.readMap(mapFileName);
-    if (!map) {
-        qWarning().nospace() << "Error while reading " << mapFileName << ":\n"
-                             << qPrintable(reader.errorString());
-        return 1;
-    }
+namespace {
 
+MapRenderer *createRenderer(Map *map)
+{
     switch (map->orientation()) {
     case Map::Isometric:
-        renderer = new IsometricRenderer(map);
-        break;
+        return new IsometricRenderer(map);
     case Map::Staggered:
-        renderer = new StaggeredRenderer(map);
-        break;
+        return new StaggeredRenderer(map);
     case Map::Hexagonal:
-        renderer = new HexagonalRenderer(map);
-        break;
+        return new HexagonalRenderer(map);
     case Map::Orthogonal:
     default:
-        renderer = new OrthogonalRenderer(map);
+        return new OrthogonalRenderer(map);
+    }
+}
+
+/**
+ * Returns the area in which the non-empty cells of \a tileLayer are drawn.
+ */
+QRectF contentRect(const MapRenderer *renderer, const TileLayer *tileLayer)
+{
+    const QRect content = tileLayer->contentBounds();
+    if (content.isEmpty())
+        return QRectF();
+
+    const QMargins margins = tileLayer->drawMargins(content);
+    const QRect area = content.translated(tileLayer->position());
+    return QRectF(renderer->boundingRect(area)).adjusted(-margins.left(),
+                                                         -margins.top(),
+                                                         margins.right(),
+                                                         margins.bottom());
+}
+
+/**
+ * Returns the color in which the given \a object is drawn. Without access to
+ * the object type colors of the editor, this is the color of its object
+ * group.
+ */
+QColor objectColor(const MapObject *object)
+{
+    const ObjectGroup *objectGroup = object->objectGroup();
+    if (objectGroup && objectGroup->color().isValid())
+        return objectGroup->color();
+
+    return Qt::gray;
+}
+
+/**
+ * The outlines of the objects of one color, combined into paths so that
+ * they are drawn in a few calls instead of one per object.
+ */
+struct ObjectBatch
+{
+    ObjectBatch()
+    {
+        // Overlapping objects should not cut holes into each other
+        filled.setFillRule(Qt::WindingFill);
+    }
+
+    QPainterPath filled;    // rectangles and polygons
+    QPainterPath lines;     // polylines
+};
+
+typedef QMap<QRgb, ObjectBatch> ObjectBatches;
+
+/**
+ * Draws the batched objects the way MapRenderer::drawMapObject() draws each
+ * of them, and clears the batches.
+ */
+void drawObjectBatches(QPainter *painter, const MapRenderer *renderer,
+                       ObjectBatches &batches)
+{
+    if (batches.isEmpty())
+        return;
+
+    const qreal lineWidth = renderer->objectLineWidth();
+    const qreal scale = painter->transform().m11();
+    const qreal shadowDist = (lineWidth == 0 ? 1 : lineWidth) / scale;
+    const QPointF shadowOffset = QPointF(shadowDist * 0.5,
+                                         shadowDist * 0.5);
+
+    painter->save();
+    painter->setRenderHint(QPainter::Antialiasing);
+
+    ObjectBatches::const_iterator it = batches.constBegin();
+    for (; it != batches.constEnd(); ++it) {
+        const QColor color = QColor::fromRgba(it.key());
+        const ObjectBatch &batch = it.value();
+
+        QPen linePen(color, lineWidth, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin);
+        linePen.setCosmetic(true);
+        QPen shadowPen(linePen);
+        shadowPen.setColor(Qt::black);
+
+        QColor brushColor = color;
+        brushColor.setAlpha(50);
+
+        painter->setPen(shadowPen);
+        painter->setBrush(Qt::NoBrush);
+        painter->drawPath(batch.filled.translated(shadowOffset));
+        painter->drawPath(batch.lines.translated(shadowOffset));
+
+        painter->setPen(linePen);
+        painter->setBrush(brushColor);
+        painter->drawPath(batch.filled);
+        painter->setBrush(Qt::NoBrush);
+        painter->drawPath(batch.lines);
+    }
+
+    painter->restore();
+    batches.clear();
+}
+
+/**
+ * Adds the outline of \a object to its batch. Returns false for objects that
+ * can't be batched, which are tile objects and ellipses.
+ */
+bool batchObject(const MapRenderer *renderer, const MapObject *object,
+                 ObjectBatches &batches)
+{
+    if (!object->cell().isEmpty())
+        return false;
+
+    QPolygonF screenPolygon;
+    bool closed = true;
+
+    switch (object->shape()) {
+    case MapObject::Ellipse:
+        return false;
+
+    case MapObject::Rectangle: {
+        const QRectF bounds = object->bounds();
+        if (bounds.isNull()) {
+            const QPointF pos = renderer->pixelToScreenCoords(bounds.topLeft());
+            screenPolygon = QPolygonF(QRectF(pos - QPointF(10, 10),
+                                             QSizeF(20, 20)));
+        } else {
+            screenPolygon = renderer->pixelToScreenCoords(QPolygonF(bounds));
+        }
         break;
     }
 
+    case MapObject::Polyline:
+        closed = false;
+        // fall through
+    case MapObject::Polygon:
+        screenPolygon = renderer->pixelToScreenCoords(
+                    object->polygon().translated(object->position()));
+        break;
+    }
+
+    if (object->rotation() != qreal(0)) {
+        const QPointF origin = renderer->pixelToScreenCoords(object->position());
+        QTransform transform;
+        transform.translate(origin.x(), origin.y());
+        transform.rotate(object->rotation());
+        transform.translate(-origin.x(), -origin.y());
+        screenPolygon = transform.map(screenPolygon);
+    }
+
+    ObjectBatch &batch = batches[objectColor(object).rgba()];
+
+    if (closed) {
+        // Give all polygons the same orientation, so that they don't cancel
+        // each other out where they overlap
+        qreal area = 0;
+        for (int i = 0, j = screenPolygon.size() - 1; i < screenPolygon.size(); j = i++) {
+            area += screenPolygon.at(j).x() * screenPolygon.at(i).y() -
+                    screenPolygon.at(i).x() * screenPolygon.at(j).y();
+        }
+        if (area < 0)
+            std::reverse(screenPolygon.begin(), screenPolygon.end());
+
+        batch.filled.addPolygon(screenPolygon);
+        batch.filled.closeSubpath();
+    } else {
+        batch.lines.addPolygon(screenPolygon);
+    }
+
+    return true;
+}
+
+/**
+ * Draws the objects of \a objectGroup within the \a exposed area. Only the
+ * objects found in this area by the spatial index of the group are looked
+ * at. Consecutive rectangles, polygons and polylines are combined into one
+ * path per color.
+ */
+void drawObjectGroup(QPainter *painter, const MapRenderer *renderer,
+                     const ObjectGroup *objectGroup, const QRectF &exposed)
+{
+    QList<MapObject*> objects;
+
+    if (exposed.isNull()) {
+        objects = objectGroup->objects();
+    } else {
+        // The index doesn't know about the tile images of tile objects, nor
+        // about the placeholder drawn for rectangles without a size
+        int margin = 10;
+        foreach (const Tileset *tileset, objectGroup->map()->tilesets()) {
+            const QSize tileSize = tileset->tileSize();
+            const QPoint offset = tileset->tileOffset();
+            margin = qMax(margin, qMax(tileSize.width(), tileSize.height()) +
+                          qMax(qAbs(offset.x()), qAbs(offset.y())));
+        }
+
+        const QRectF area = exposed.adjusted(-margin, -margin, margin, margin);
+        const QRectF pixelArea = renderer->screenToPixelCoords(QPolygonF(area))
+                .boundingRect();
+        objects = objectGroup->objectsIn(pixelArea);
+    }
+
+    ObjectBatches batches;
+
+    foreach (const MapObject *object, objects) {
+        if (!object->isVisible())
+            continue;
+
+        if (batchObject(renderer, object, batches))
+            continue;
+
+        // Keep the drawing order of the objects that are drawn one by one
+        drawObjectBatches(painter, renderer, batches);
+
+        if (object->rotation() != qreal(0)) {
+            const QPointF origin = renderer->pixelToScreenCoords(object->position());
+            painter->save();
+            painter->translate(origin);
+            painter->rotate(object->rotation());
+            painter->translate(-origin);
+        }
+
+        renderer->drawMapObject(painter, object, objectColor(object));
+
+        if (object->rotation() != qreal(0))
+            painter->restore();
+    }
+
+    drawObjectBatches(painter, renderer, batches);
+}
+
+void drawLayers(QPainter *painter, MapRenderer *renderer,
+                const QList<Layer*> &layers, const QRectF &exposed)
+{
+    foreach (Layer *layer, layers) {
+        painter->setOpacity(layer->opacity());
+
+        const TileLayer *tileLayer = dynamic_cast<const TileLayer*>(layer);
+        const ObjectGroup *objectGroup = dynamic_cast<const ObjectGroup*>(layer);
+        const ImageLayer *imageLayer = dynamic_cast<const ImageLayer*>(layer);
+
+        if (tileLayer) {
+            // Skip the layer when its tiles are all outside of this area
+            const QRectF content = contentRect(renderer, tileLayer);
+            if (content.isEmpty() ||
+                    (!exposed.isNull() && !exposed.intersects(content)))
+                continue;
+
+            renderer->drawTileLayer(painter, tileLayer, exposed);
+        } else if (objectGroup) {
+            drawObjectGroup(painter, renderer, objectGroup, exposed);
+        } else if (imageLayer) {
+            renderer->drawImageLayer(painter, imageLayer, exposed);
+        }
+    }
+}
+
+/**
+ * Renders the given layers to a horizontal band of the output image.
+ */
+class BandRenderer : public QThread
+{
+public:
+    BandRenderer(MapRenderer *renderer,
+                 const QList<Layer*> &layers,
+                 const QImage &band,
+                 const QTransform &transform,
+                 QPainter::RenderHints renderHints)
+        : mRenderer(renderer)
+        , mLayers(layers)
+        , mBand(band)
+        , mTransform(transform)
+        , mRenderHints(renderHints)
+    {}
+
+    const QImage &band() const { return mBand; }
+
+    /**
+     * Renders the band on the calling thread.
+     */
+    void render()
+    {
+        QPainter painter(&mBand);
+        painter.setRenderHints(mRenderHints);
+        painter.setTransform(mTransform);
+
+        const QRectF exposed = mTransform.inverted().mapRect(QRectF(mBand.rect()));
+        drawLayers(&painter, mRenderer, mLayers, exposed);
+    }
+
+protected:
+    void run()
+    {
+        render();
+    }
+
+private:
+    MapRenderer *mRenderer;
+    const QList<Layer*> mLayers;
+    QImage mBand;
+    const QTransform mTransform;
+    const QPainter::RenderHints mRenderHints;
+};
+
+} // anonymous namespace
+
+/**
+ * Returns the size of the output image for the given \a map, and sets up
+ * the \a transform and \a renderHints to use when drawing it.
+ */
+QSize TmxRasterizer::outputSize(const Map *map,
+                                const MapRenderer *renderer,
+                                QTransform *transform,
+                                QPainter::RenderHints *renderHints) const
+{
     qreal xScale, yScale;
 
     if (mTileSize > 0) {
@@ -107,46 +426,953 @@ int TmxRasterizer::render(const QString &mapFileName,
         xScale = yScale = mScale;
     }
 
-    QSize mapSize = renderer->mapSize();
-    mapSize.rwidth() *= xScale;
-    mapSize.rheight() *= yScale;
-
-    QImage image(mapSize, QImage::Format_ARGB32);
-    image.fill(Qt::transparent);
-    QPainter painter(&image);
+    *transform = QTransform();
+    *renderHints = 0;
 
     if (xScale != qreal(1) || yScale != qreal(1)) {
         if (mUseAntiAliasing) {
-            painter.setRenderHints(QPainter::SmoothPixmapTransform |
-                                   QPainter::Antialiasing);
+            *renderHints = QPainter::SmoothPixmapTransform |
+                    QPainter::Antialiasing;
         }
-        painter.setTransform(QTransform::fromScale(xScale, yScale));
+        *transform = QTransform::fromScale(xScale, yScale);
     }
+
+    QSize mapSize = renderer->mapSize();
+    mapSize.rwidth() *= xScale;
+    mapSize.rheight() *= yScale;
+    return mapSize;
+}
+
+QList<Layer*> TmxRasterizer::layersToDraw(const Map *map) const
+{
     // Perform a similar rendering than found in saveasimagedialog.cpp
+    QList<Layer*> layers;
     foreach (Layer *layer, map->layers()) {
+        if (!shouldDrawLayer(layer))
+            continue;
+
+        // Caches the content bounds and builds the spatial index of the
+        // objects before the layers are drawn by threads
+        if (TileLayer *tileLayer = layer->asTileLayer())
+            tileLayer->contentBounds();
+        else if (ObjectGroup *objectGroup = layer->asObjectGroup())
+            objectGroup->objectsIn(QRectF());
+
+        layers.append(layer);
+    }
+    return layers;
+}
+
+/**
+ * Keeps the external tilesets loaded while rendering a batch of maps, so
+ * that maps sharing a tileset don't each load and slice its image. Safe to
+ * use from multiple threads.
+ *
+ * The tilesets are read on the threads of the pool, so their images are
+ * only loaded as image data, without any pixmaps.
+ */
+class TilesetCache
+{
+public:
+    ~TilesetCache()
+    {
+        qDeleteAll(mTilesets);
+    }
+
+    Tileset *tileset(const QString &fileName, QString *error)
+    {
+        const QString key = QFileInfo(fileName).canonicalFilePath();
+
+        {
+            QMutexLocker locker(&mMutex);
+            if (Tileset *tileset = mTilesets.value(key))
+                return tileset;
+        }
+
+        MapReader reader;
+        reader.setDeferredImageLoading(true);
+        Tileset *tileset = reader.readTileset(fileName);
+        if (!tileset) {
+            *error = reader.errorString();
+            return 0;
+        }
+        reader.loadDeferredImages();
+
+        QMutexLocker locker(&mMutex);
+
+        // Another thread may have loaded the same tileset in the meantime
+        if (Tileset *existing = mTilesets.value(key)) {
+            delete tileset;
+            return existing;
+        }
+
+        mTilesets.insert(key, tileset);
+        mCachedTilesets.insert(tileset);
+        return tileset;
+    }
+
+    bool contains(Tileset *tileset) const
+    {
+        QMutexLocker locker(&mMutex);
+        return mCachedTilesets.contains(tileset);
+    }
+
+private:
+    mutable QMutex mMutex;
+    QHash<QString, Tileset*> mTilesets;
+    QSet<Tileset*> mCachedTilesets;
+};
+
+namespace {
+
+/**
+ * A map reader that takes the external tilesets from a TilesetCache.
+ */
+class CachingMapReader : public MapReader
+{
+public:
+    explicit CachingMapReader(TilesetCache *tilesetCache)
+        : mTilesetCache(tilesetCache)
+    {
+        // Used on the threads of the pool, where pixmaps can't be created
+        setDeferredImageLoading(true);
+    }
+
+protected:
+    Tileset *readExternalTileset(const QString &source, QString *error)
+    {
+        return mTilesetCache->tileset(source, error);
+    }
+
+private:
+    TilesetCache *mTilesetCache;
+};
+
+/**
+ * Renders one map of a batch on a thread of the pool.
+ */
+class RenderTask : public QRunnable
+{
+public:
+    RenderTask(const TmxRasterizer *rasterizer,
+               TilesetCache *tilesetCache,
+               const QString &mapFileName,
+               const QString &imageFileName,
+               QAtomicInt *failures)
+        : mRasterizer(rasterizer)
+        , mTilesetCache(tilesetCache)
+        , mMapFileName(mapFileName)
+        , mImageFileName(imageFileName)
+        , mFailures(failures)
+    {}
+
+    void run()
+    {
+        CachingMapReader reader(mTilesetCache);
+        if (mRasterizer->renderMap(reader, mMapFileName, mImageFileName,
+                                   1, mTilesetCache) != 0) {
+            mFailures->ref();
+        }
+    }
+
+private:
+    const TmxRasterizer *mRasterizer;
+    TilesetCache *mTilesetCache;
+    const QString mMapFileName;
+    const QString mImageFileName;
+    QAtomicInt *mFailures;
+};
+
+// The amount of memory used by each band of rows when streaming the output
+const int StreamBandBytes = 16 * 1024 * 1024;
+
+// The size of the images of a tile pyramid
+const int PyramidTileSize = 256;
+
+QString pyramidTilePath(const QString &directory, int z, int x, int y)
+{
+    return QString(QLatin1String("%1/%2/%3/%4.png"))
+            .arg(directory).arg(z).arg(x).arg(y);
+}
+
+bool isTransparent(const QImage &image)
+{
+    for (int y = 0; y < image.height(); ++y) {
+        const QRgb *line = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+        for (int x = 0; x < image.width(); ++x)
+            if (qAlpha(line[x]) != 0)
+                return false;
+    }
+    return true;
+}
+
+/**
+ * Renders one image of the most detailed level of a tile pyramid directly
+ * from the map. The image is not saved when nothing was drawn on it.
+ */
+class PyramidTileTask : public QRunnable
+{
+public:
+    PyramidTileTask(MapRenderer *renderer,
+                    const QList<Layer*> &layers,
+                    const QTransform &transform,
+                    QPainter::RenderHints renderHints,
+                    const QPoint &origin,
+                    const QString &fileName,
+                    QAtomicInt *failures)
+        : mRenderer(renderer)
+        , mLayers(layers)
+        , mTransform(transform)
+        , mRenderHints(renderHints)
+        , mOrigin(origin)
+        , mFileName(fileName)
+        , mFailures(failures)
+    {}
+
+    void run()
+    {
+        QImage image(PyramidTileSize, PyramidTileSize, QImage::Format_ARGB32);
+        image.fill(Qt::transparent);
+
+        const QTransform transform =
+                mTransform * QTransform::fromTranslate(-mOrigin.x(),
+                                                       -mOrigin.y());
+
+        QPainter painter(&image);
+        painter.setRenderHints(mRenderHints);
+        painter.setTransform(transform);
+
+        const QRectF exposed = transform.inverted().mapRect(QRectF(image.rect()));
+        drawLayers(&painter, mRenderer, mLayers, exposed);
+        painter.end();
+
+        if (!isTransparent(image) && !image.save(mFileName))
+            mFailures->ref();
+    }
+
+private:
+    MapRenderer *mRenderer;
+    const QList<Layer*> mLayers;
+    const QTransform mTransform;
+    const QPainter::RenderHints mRenderHints;
+    const QPoint mOrigin;
+    const QString mFileName;
+    QAtomicInt *mFailures;
+};
+
+/**
+ * Creates an image of a less detailed level of a tile pyramid by
+ * downsampling the four images below it, which are read back from disk.
+ */
+class PyramidDownsampleTask : public QRunnable
+{
+public:
+    PyramidDownsampleTask(const QString &directory, int z, int x, int y,
+                          QAtomicInt *failures)
+        : mDirectory(directory)
+        , mZ(z)
+        , mX(x)
+        , mY(y)
+        , mFailures(failures)
+    {}
+
+    void run()
+    {
+        QImage image(PyramidTileSize * 2, PyramidTileSize * 2,
+                     QImage::Format_ARGB32);
+        image.fill(Qt::transparent);
+
+        bool empty = true;
+        QPainter painter(&image);
+        painter.setCompositionMode(QPainter::CompositionMode_Source);
+
+        for (int dy = 0; dy < 2; ++dy) {
+            for (int dx = 0; dx < 2; ++dx) {
+                const QImage child(pyramidTilePath(mDirectory, mZ + 1,
+                                                   mX * 2 + dx, mY * 2 + dy));
+                if (child.isNull())
+                    continue;
+
+                painter.drawImage(dx * PyramidTileSize, dy * PyramidTileSize,
+                                  child);
+                empty = false;
+            }
+        }
+
+        painter.end();
+
+        if (empty)
+            return;
+
+        const QImage scaled = image.scaled(PyramidTileSize, PyramidTileSize,
+                                           Qt::IgnoreAspectRatio,
+                                           Qt::SmoothTransformation);
+
+        if (!scaled.save(pyramidTilePath(mDirectory, mZ, mX, mY)))
+            mFailures->ref();
+    }
+
+private:
+    const QString mDirectory;
+    const int mZ;
+    const int mX;
+    const int mY;
+    QAtomicInt *mFailures;
+};
+
+// The longest animation that is rendered, and the most frames it may have
+const int MaxAnimationDuration = 60 * 1000;
+const int MaxAnimationFrames = 1000;
+
+int animationDuration(const Tile *tile)
+{
+    int duration = 0;
+    foreach (const Frame &frame, tile->frames())
+        duration += qMax(0, frame.duration);
+    return duration;
+}
+
+/**
+ * Returns the tile shown by the animation of \a tile at \a time.
+ */
+Tile *frameTileAt(Tile *tile, int time)
+{
+    const int duration = animationDuration(tile);
+    if (duration <= 0)
+        return tile;
+
+    time %= duration;
+
+    foreach (const Frame &frame, tile->frames()) {
+        if (time < frame.duration) {
+            Tile *frameTile = tile->tileset()->tileAt(frame.tileId);
+            return frameTile ? frameTile : tile;
+        }
+        time -= qMax(0, frame.duration);
+    }
+
+    return tile;
+}
+
+/**
+ * The animated tiles shown by the layers being drawn, and the times at which
+ * any of them shows its next frame.
+ */
+struct Animation
+{
+    QList<Tile*> tiles;
+    QVector<QRegion> cells;     // the animated cells of each layer
+    QVector<int> frameTimes;    // sorted, starting at 0
+    int duration;
+};
+
+void findAnimation(const QList<Layer*> &layers, Animation &animation)
+{
+    QSet<Tile*> tiles;
+    foreach (Layer *layer, layers) {
+        if (TileLayer *tileLayer = layer->asTileLayer()) {
+            foreach (Tile *tile, tileLayer->tileUsage().keys())
+                if (tile->isAnimated() && animationDuration(tile) > 0)
+                    tiles.insert(tile);
+        }
+    }
+    animation.tiles = tiles.toList();
+
+    foreach (Layer *layer, layers) {
+        TileLayer *tileLayer = layer->asTileLayer();
+        animation.cells.append(tileLayer ? tileLayer->tileRegion(animation.tiles)
+                                         : QRegion());
+    }
+
+    // The animation repeats once all tiles are back at their first frame
+    qint64 duration = 1;
+    foreach (const Tile *tile, animation.tiles) {
+        qint64 a = duration;
+        qint64 b = animationDuration(tile);
+        while (b) {
+            const qint64 t = a % b;
+            a = b;
+            b = t;
+        }
+        duration = duration / a * animationDuration(tile);
+        if (duration >= MaxAnimationDuration) {
+            duration = MaxAnimationDuration;
+            break;
+        }
+    }
+
+    QSet<int> frameTimes;
+    frameTimes.insert(0);
+    foreach (const Tile *tile, animation.tiles) {
+        qint64 time = 0;
+        while (time < duration) {
+            foreach (const Frame &frame, tile->frames()) {
+                time += qMax(0, frame.duration);
+                if (time >= duration)
+                    break;
+                frameTimes.insert(int(time));
+            }
+        }
+    }
 
-        if (!shouldDrawLayer(layer)) 
+    animation.frameTimes = frameTimes.toList().toVector();
+    qSort(animation.frameTimes);
+    animation.duration = int(duration);
+
+    // Cut the animation off at the first frame that is too many
+    if (animation.frameTimes.size() > MaxAnimationFrames) {
+        qWarning() << "The animation is cut off after" << MaxAnimationFrames
+                   << "frames";
+        animation.duration = animation.frameTimes.at(MaxAnimationFrames);
+        animation.frameTimes.resize(MaxAnimationFrames);
+    }
+}
+
+/**
+ * Returns the area of the image in which the animated cells are drawn.
+ */
+QRegion animatedArea(const MapRenderer *renderer,
+                     const QList<Layer*> &layers,
+                     const Animation &animation,
+                     const QTransform &transform,
+                     const QRect &imageRect)
+{
+    QRegion area;
+
+    for (int i = 0; i < layers.size(); ++i) {
+        const TileLayer *tileLayer = layers.at(i)->asTileLayer();
+        if (!tileLayer)
             continue;
 
+        const QMargins margins = tileLayer->drawMargins();
+        foreach (const QRect &rect, animation.cells.at(i).rects()) {
+            const QRect cells = rect.translated(tileLayer->position());
+            const QRectF bounds = QRectF(renderer->boundingRect(cells))
+                    .adjusted(-margins.left(), -margins.top(),
+                              margins.right(), margins.bottom());
+            area += transform.mapRect(bounds).toAlignedRect() & imageRect;
+        }
+    }
 
-        painter.setOpacity(layer->opacity());
+    return area;
+}
 
-        const TileLayer *tileLayer = dynamic_cast<const TileLayer*>(layer);
-        const ImageLayer *imageLayer = dynamic_cast<const ImageLayer*>(layer);
+/**
+ * Returns the layers as they are drawn at \a time. Layers with animated
+ * cells are replaced by clones that show the current frame in these cells,
+ * which are added to \a clones.
+ */
+QList<Layer*> layersAtTime(const QList<Layer*> &layers,
+                           const Animation &animation,
+                           int time,
+                           QList<Layer*> &clones)
+{
+    QList<Layer*> result;
 
-        if (tileLayer) {
-            renderer->drawTileLayer(&painter, tileLayer);
-        } else if (imageLayer) {
-            renderer->drawImageLayer(&painter, imageLayer);
+    for (int i = 0; i < layers.size(); ++i) {
+        const QRegion &cells = animation.cells.at(i);
+        if (cells.isEmpty()) {
+            result.append(layers.at(i));
+            continue;
+        }
+
+        TileLayer *clone = static_cast<TileLayer*>(layers.at(i)->clone());
+        foreach (const QRect &rect, cells.rects()) {
+            for (int y = rect.top(); y <= rect.bottom(); ++y) {
+                for (int x = rect.left(); x <= rect.right(); ++x) {
+                    Cell cell = clone->cellAt(x, y);
+                    if (cell.tile && cell.tile->isAnimated()) {
+                        cell.tile = frameTileAt(cell.tile, time);
+                        clone->setCell(x, y, cell);
+                    }
+                }
+            }
+        }
+
+        // Caches the content bounds before the layer is drawn by a thread
+        clone->contentBounds();
+
+        clones.append(clone);
+        result.append(clone);
+    }
+
+    return result;
+}
+
+/**
+ * Renders a frame of an animation. The \a area of the image that shows
+ * animated cells is drawn again on top of the first frame, and the part
+ * within \a frameRect is kept.
+ */
+class FrameRenderer : public QRunnable
+{
+public:
+    FrameRenderer(MapRenderer *renderer,
+                  const QList<Layer*> &layers,
+                  const QImage &firstFrame,
+                  const QRegion &area,
+                  const QRect &frameRect,
+                  const QTransform &transform,
+                  QPainter::RenderHints renderHints,
+                  QImage *frame)
+        : mRenderer(renderer)
+        , mLayers(layers)
+        , mFirstFrame(firstFrame)
+        , mArea(area)
+        , mFrameRect(frameRect)
+        , mTransform(transform)
+        , mRenderHints(renderHints)
+        , mFrame(frame)
+    {}
+
+    void run()
+    {
+        QImage frame = mFirstFrame.copy(mFrameRect);
+
+        QPainter painter(&frame);
+        painter.setClipRegion(mArea.translated(-mFrameRect.topLeft()));
+        painter.setCompositionMode(QPainter::CompositionMode_Source);
+        painter.fillRect(frame.rect(), Qt::transparent);
+        painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+
+        const QTransform transform =
+                mTransform * QTransform::fromTranslate(-mFrameRect.x(),
+                                                       -mFrameRect.y());
+        painter.setRenderHints(mRenderHints);
+        painter.setTransform(transform);
+
+        const QRectF exposed = transform.inverted().mapRect(QRectF(frame.rect()));
+        drawLayers(&painter, mRenderer, mLayers, exposed);
+        painter.end();
+
+        *mFrame = frame;
+    }
+
+private:
+    MapRenderer *mRenderer;
+    const QList<Layer*> mLayers;
+    const QImage mFirstFrame;
+    const QRegion mArea;
+    const QRect mFrameRect;
+    const QTransform mTransform;
+    const QPainter::RenderHints mRenderHints;
+    QImage *mFrame;
+};
+
+void runTask(QThreadPool &pool, QRunnable *task)
+{
+#if QT_VERSION >= 0x050000
+    pool.start(task);
+#else
+    // Pixmaps may only be used outside of the GUI thread since Qt 5
+    Q_UNUSED(pool)
+    task->run();
+    delete task;
+#endif
+}
+
+int failureCount(const QAtomicInt &failures)
+{
+#if QT_VERSION >= 0x050000
+    return failures.load();
+#else
+    return int(failures);
+#endif
+}
+
+} // anonymous namespace
+
+int TmxRasterizer::render(const QString &mapFileName,
+                          const QString &imageFileName)
+{
+    // The frames of an animation are rendered on all cores by default
+    int threadCount = qMax(1, mThreadCount);
+    if (mAnimated && mThreadCount == 0)
+        threadCount = QThread::idealThreadCount();
+
+    MapReader reader;
+    return renderMap(reader, mapFileName, imageFileName,
+                     qMax(1, threadCount), 0);
+}
+
+int TmxRasterizer::renderBatch(const QList<QPair<QString, QString> > &files)
+{
+    TilesetCache tilesetCache;
+    QAtomicInt failures(0);
+
+    QThreadPool pool;
+    if (mThreadCount > 0)
+        pool.setMaxThreadCount(mThreadCount);
+
+    for (int i = 0; i < files.size(); ++i) {
+        RenderTask *task = new RenderTask(this, &tilesetCache,
+                                          files.at(i).first,
+                                          files.at(i).second,
+                                          &failures);
+        runTask(pool, task);
+    }
+
+    pool.waitForDone();
+
+    return failureCount(failures) == 0 ? 0 : 1;
+}
+
+int TmxRasterizer::renderPyramid(const QString &mapFileName,
+                                 const QString &directory)
+{
+    MapReader reader;
+    Map *map = reader.readMap(mapFileName);
+    if (!map) {
+        qWarning().nospace() << "Error while reading " << mapFileName << ":\n"
+                             << qPrintable(reader.errorString());
+        return 1;
+    }
+
+    // Outside of the GUI thread this only sets up the image data
+    if (reader.isDeferredImageLoadingEnabled()) {
+        reader.loadDeferredImages();
+        map->recomputeDrawMargins();
+    }
+
+    MapRenderer *renderer = createRenderer(map);
+
+    QPainter::RenderHints renderHints;
+    QTransform transform;
+    const QSize mapSize = outputSize(map, renderer, &transform, &renderHints);
+    const QList<Layer*> layers = layersToDraw(map);
+
+    // The most detailed level shows the map at the requested scale
+    const int columns = (mapSize.width() + PyramidTileSize - 1) / PyramidTileSize;
+    const int rows = (mapSize.height() + PyramidTileSize - 1) / PyramidTileSize;
+
+    int maxZoom = 0;
+    while ((1 << maxZoom) < qMax(columns, rows))
+        ++maxZoom;
+
+    QAtomicInt failures(0);
+    QThreadPool pool;
+    if (mThreadCount > 0)
+        pool.setMaxThreadCount(mThreadCount);
+
+    for (int x = 0; x < columns; ++x) {
+        QDir().mkpath(QString(QLatin1String("%1/%2/%3"))
+                      .arg(directory).arg(maxZoom).arg(x));
+
+        for (int y = 0; y < rows; ++y) {
+            const QPoint origin(x * PyramidTileSize, y * PyramidTileSize);
+            runTask(pool, new PyramidTileTask(renderer, layers,
+                                              transform, renderHints, origin,
+                                              pyramidTilePath(directory,
+                                                              maxZoom, x, y),
+                                              &failures));
+        }
+    }
+
+    pool.waitForDone();
+
+    // Each level is built from the one below it
+    for (int z = maxZoom - 1; z >= 0; --z) {
+        const int levelShift = maxZoom - z;
+        const int levelColumns = ((columns - 1) >> levelShift) + 1;
+        const int levelRows = ((rows - 1) >> levelShift) + 1;
+
+        for (int x = 0; x < levelColumns; ++x) {
+            QDir().mkpath(QString(QLatin1String("%1/%2/%3"))
+                          .arg(directory).arg(z).arg(x));
+
+            for (int y = 0; y < levelRows; ++y)
+                runTask(pool, new PyramidDownsampleTask(directory, z, x, y,
+                                                        &failures));
+        }
+
+        pool.waitForDone();
+    }
+
+    delete renderer;
+    qDeleteAll(map->tilesets());
+    delete map;
+
+    if (failureCount(failures) != 0) {
+        qWarning() << "Error while writing the tile images to" << directory;
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * Reads the map from \a mapFileName using the given \a reader and renders
+ * it to \a imageFileName, using \a threadCount threads. Tilesets that are
+ * part of the \a tilesetCache are not deleted afterwards.
+ */
+int TmxRasterizer::renderMap(MapReader &reader,
+                             const QString &mapFileName,
+                             const QString &imageFileName,
+                             int threadCount,
+                             const TilesetCache *tilesetCache) const
+{
+    Map *map = reader.readMap(mapFileName);
+    if (!map) {
+        qWarning().nospace() << "Error while reading " << mapFileName << ":\n"
+                             << qPrintable(reader.errorString());
+        return 1;
+    }
+
+    MapRenderer *renderer = createRenderer(map);
+
+    QPainter::RenderHints renderHints;
+    QTransform transform;
+    const QSize mapSize = outputSize(map, renderer, &transform, &renderHints);
+
+    const QList<Layer*> layers = layersToDraw(map);
+
+    threadCount = qMin(threadCount, mapSize.height());
+#if QT_VERSION < 0x050000
+    // Pixmaps may only be drawn outside of the GUI thread since Qt 5
+    threadCount = 1;
+#endif
+
+    if (mStreamOutput || mAnimated) {
+        const bool written = mAnimated
+                ? renderAnimated(renderer, layers, transform,
+                                 renderHints, mapSize,
+                                 imageFileName, threadCount)
+                : renderStreamed(renderer, layers, transform,
+                                 renderHints, mapSize,
+                                 imageFileName, threadCount);
+
+        delete renderer;
+        foreach (Tileset *tileset, map->tilesets())
+            if (!tilesetCache || !tilesetCache->contains(tileset))
+                delete tileset;
+        delete map;
+
+        return written ? 0 : 1;
+    }
+
+    QImage image(mapSize, QImage::Format_ARGB32);
+    image.fill(Qt::transparent);
+
+    if (threadCount > 1) {
+        // Each thread draws to its own band of rows of the image
+        QList<BandRenderer*> bandRenderers;
+        const int bandHeight = (mapSize.height() + threadCount - 1) / threadCount;
+        const int bytesPerLine = image.bytesPerLine();
+        uchar *bits = image.bits();
+
+        for (int top = 0; top < mapSize.height(); top += bandHeight) {
+            const int height = qMin(bandHeight, mapSize.height() - top);
+            const QImage band(bits + top * bytesPerLine,
+                              mapSize.width(), height,
+                              bytesPerLine, image.format());
+            const QTransform bandTransform =
+                    transform * QTransform::fromTranslate(0, -top);
+
+            BandRenderer *bandRenderer = new BandRenderer(renderer, layers,
+                                                          band, bandTransform,
+                                                          renderHints);
+            bandRenderers.append(bandRenderer);
+            bandRenderer->start();
         }
+
+        foreach (BandRenderer *bandRenderer, bandRenderers)
+            bandRenderer->wait();
+
+        qDeleteAll(bandRenderers);
+    } else {
+        QPainter painter(&image);
+        painter.setRenderHints(renderHints);
+        painter.setTransform(transform);
+        drawLayers(&painter, renderer, layers,
+                   QRectF(QPointF(), renderer->mapSize()));
     }
 
     // Save image
     image.save(imageFileName);
 
     delete renderer;
-    qDeleteAll(map->tilesets());
+    foreach (Tileset *tileset, map->tilesets())
+        if (!tilesetCache || !tilesetCache->contains(tileset))
+            delete tileset;
     delete map;
 
     return 0;
 }
+
+/**
+ * Renders the map to a PNG file one band of rows at a time, writing each
+ * band before the next one is drawn. Up to \a threadCount bands are drawn
+ * in parallel, so the memory used only depends on the width of the image.
+ */
+bool TmxRasterizer::renderStreamed(MapRenderer *renderer,
+                                   const QList<Layer*> &layers,
+                                   const QTransform &transform,
+                                   QPainter::RenderHints renderHints,
+                                   const QSize &mapSize,
+                                   const QString &imageFileName,
+                                   int threadCount) const
+{
+    if (!imageFileName.endsWith(QLatin1String(".png"), Qt::CaseInsensitive))
+        qWarning() << "Streamed output is always written as PNG:" << imageFileName;
+
+    PngWriter writer;
+    if (!writer.open(imageFileName, mapSize.width(), mapSize.height())) {
+        qWarning().nospace() << "Error while writing " << imageFileName << ": "
+                             << qPrintable(writer.errorString());
+        return false;
+    }
+
+    const int bytesPerLine = qMax(1, mapSize.width()) * 4;
+    const int bandHeight = qBound(1, StreamBandBytes / bytesPerLine,
+                                  qMax(1, mapSize.height()));
+    threadCount = qMax(1, threadCount);
+
+    for (int top = 0; top < mapSize.height(); ) {
+        QList<BandRenderer*> bandRenderers;
+
+        for (int i = 0; i < threadCount && top < mapSize.height(); ++i) {
+            const int height = qMin(bandHeight, mapSize.height() - top);
+            QImage band(mapSize.width(), height, QImage::Format_ARGB32);
+            band.fill(Qt::transparent);
+
+            const QTransform bandTransform =
+                    transform * QTransform::fromTranslate(0, -top);
+
+            // The local image is released first, so that the renderer
+            // draws to the band without detaching it
+            bandRenderers.append(new BandRenderer(renderer, layers,
+                                                  band, bandTransform,
+                                                  renderHints));
+            band = QImage();
+
+            if (threadCount > 1)
+                bandRenderers.last()->start();
+            else
+                bandRenderers.last()->render();
+
+            top += height;
+        }
+
+        bool written = true;
+        foreach (BandRenderer *bandRenderer, bandRenderers) {
+            bandRenderer->wait();
+            if (written)
+                written = writer.writeRows(bandRenderer->band());
+        }
+        qDeleteAll(bandRenderers);
+
+        if (!written) {
+            qWarning().nospace() << "Error while writing " << imageFileName
+                                 << ": " << qPrintable(writer.errorString());
+            return false;
+        }
+    }
+
+    if (!writer.close()) {
+        qWarning().nospace() << "Error while writing " << imageFileName << ": "
+                             << qPrintable(writer.errorString());
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Renders the animations of the tiles to an animated PNG file. The first
+ * frame is rendered as a whole, after which only the area showing animated
+ * cells is rendered again for each of the other frames. Up to \a threadCount
+ * frames are rendered in parallel.
+ */
+bool TmxRasterizer::renderAnimated(MapRenderer *renderer,
+                                   const QList<Layer*> &layers,
+                                   const QTransform &transform,
+                                   QPainter::RenderHints renderHints,
+                                   const QSize &mapSize,
+                                   const QString &imageFileName,
+                                   int threadCount) const
+{
+    if (!imageFileName.endsWith(QLatin1String(".png"), Qt::CaseInsensitive))
+        qWarning() << "Animations are always written as PNG:" << imageFileName;
+
+    Animation animation;
+    findAnimation(layers, animation);
+
+    const QRect imageRect(QPoint(), mapSize);
+    const QRegion area = animatedArea(renderer, layers, animation,
+                                      transform, imageRect);
+    const QRect frameRect = area.boundingRect();
+
+    // Nothing changes between the frames when no animated cell is visible
+    if (area.isEmpty()) {
+        animation.frameTimes.resize(1);
+        animation.duration = 0;
+    }
+
+    const int frameCount = animation.frameTimes.size();
+
+    QImage firstFrame(mapSize, QImage::Format_ARGB32);
+    firstFrame.fill(Qt::transparent);
+    {
+        QPainter painter(&firstFrame);
+        painter.setRenderHints(renderHints);
+        painter.setTransform(transform);
+        drawLayers(&painter, renderer, layers,
+                   QRectF(QPointF(), renderer->mapSize()));
+    }
+
+    PngWriter writer;
+    bool written = writer.open(imageFileName, mapSize.width(), mapSize.height(),
+                               frameCount);
+
+    if (written && frameCount > 1) {
+        const int delay = animation.frameTimes.at(1);
+        written = writer.beginFrame(imageRect, delay);
+    }
+    if (written)
+        written = writer.writeRows(firstFrame);
+
+    threadCount = qMax(1, threadCount);
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(threadCount);
+
+    for (int first = 1; written && first < frameCount; first += threadCount) {
+        const int last = qMin(frameCount, first + threadCount);
+
+        QList<Layer*> clones;
+        QVector<QImage> frames(last - first);
+
+        for (int i = first; i < last; ++i) {
+            const QList<Layer*> frameLayers =
+                    layersAtTime(layers, animation,
+                                 animation.frameTimes.at(i), clones);
+
+            runTask(pool, new FrameRenderer(renderer, frameLayers,
+                                            firstFrame, area, frameRect,
+                                            transform, renderHints,
+                                            &frames[i - first]));
+        }
+
+        pool.waitForDone();
+        qDeleteAll(clones);
+
+        for (int i = first; written && i < last; ++i) {
+            const int end = i + 1 < frameCount ? animation.frameTimes.at(i + 1)
+                                               : animation.duration;
+            written = writer.beginFrame(frameRect,
+                                        end - animation.frameTimes.at(i)) &&
+                    writer.writeRows(frames.at(i - first));
+        }
+    }
+
+    if (written)
+        written = writer.close();
+
+    if (!written) {
+        qWarning().nospace() << "Error while writing " << imageFileName << ": "
+                             << qPrintable(writer.errorString());
+        return false;
+    }
+
+    return true;
+}
@@ -31,11 +31,23 @@
 
 #include "layer.h"
 
+#include <QList>
+#include <QPainter>
+#include <QPair>
 #include <QString>
 #include <QStringList>
+#include <QTransform>
+
+namespace Tiled {
+class Map;
+class MapReader;
+class MapRenderer;
+}
 
 using namespace Tiled;
 
+class TilesetCache;
+
 class TmxRasterizer
 {
 
@@ -47,24 +59,101 @@ public:
     int tileSize() const { return mTileSize; }
     bool useAntiAliasing() const { return mUseAntiAliasing; }
     bool IgnoreVisibility() const { return mIgnoreVisibility; }
+    int threadCount() const { return mThreadCount; }
+    bool streamOutput() const { return mStreamOutput; }
+    bool animated() const { return mAnimated; }
+    bool showObjects() const { return mShowObjects; }
 
     void setScale(qreal scale) { mScale = scale; }
     void setTileSize(int tileSize) { mTileSize = tileSize; }
     void setAntiAliasing(bool useAntiAliasing) { mUseAntiAliasing = useAntiAliasing; }
     void setIgnoreVisibility(bool IgnoreVisibility) { mIgnoreVisibility = IgnoreVisibility; }
+    void setThreadCount(int threadCount) { mThreadCount = threadCount; }
+
+    /**
+     * Sets whether the image is written to a PNG file one band of rows at a
+     * time, instead of being created in memory as a whole. This allows
+     * rendering maps that are too large to fit in memory as a single image.
+     */
+    void setStreamOutput(bool streamOutput) { mStreamOutput = streamOutput; }
+
+    /**
+     * Sets whether the animations of the tiles are rendered, writing an
+     * animated PNG that loops over all of them. Only the parts of the map
+     * that show animated tiles are rendered again for each frame, and the
+     * frames are rendered in parallel.
+     */
+    void setAnimated(bool animated) { mAnimated = animated; }
+
+    /**
+     * Sets whether object layers are drawn. Only the objects in the area
+     * being drawn are looked at, and rectangles, polygons and polylines are
+     * drawn in batches per color.
+     */
+    void setShowObjects(bool showObjects) { mShowObjects = showObjects; }
 
     void setLayersToHide(QStringList layersToHide) { mLayersToHide = layersToHide; }
 
     int render(const QString &mapFileName, const QString &imageFileName);
 
+    /**
+     * Renders each of the given maps to the image file it is paired with.
+     * The maps are rendered in parallel by threadCount() threads, or one
+     * thread per core when no thread count was set. External tilesets are
+     * only loaded once and shared between the maps.
+     *
+     * Returns 0 when all maps were rendered, 1 otherwise.
+     */
+    int renderBatch(const QList<QPair<QString, QString> > &files);
+
+    /**
+     * Renders the map to a pyramid of 256x256 images in the given
+     * \a directory, stored as z/x/y.png. The most detailed level shows the
+     * map at the requested scale, and each level above it is downsampled
+     * by a factor of two. Images that would be fully transparent are not
+     * written.
+     *
+     * Returns 0 on success, 1 otherwise.
+     */
+    int renderPyramid(const QString &mapFileName, const QString &directory);
+
+    int renderMap(MapReader &reader,
+                  const QString &mapFileName,
+                  const QString &imageFileName,
+                  int threadCount,
+                  const TilesetCache *tilesetCache) const;
+
 private:
     qreal mScale;
     int mTileSize;
     bool mUseAntiAliasing;
     bool mIgnoreVisibility;
+    int mThreadCount;
+    bool mStreamOutput;
+    bool mAnimated;
+    bool mShowObjects;
     QStringList mLayersToHide;
 
-    bool shouldDrawLayer(Layer *layer);
+    bool shouldDrawLayer(Layer *layer) const;
+    QSize outputSize(const Map *map,
+                     const MapRenderer *renderer,
+                     QTransform *transform,
+                     QPainter::RenderHints *renderHints) const;
+    QList<Layer*> layersToDraw(const Map *map) const;
+    bool renderStreamed(MapRenderer *renderer,
+                        const QList<Layer*> &layers,
+                        const QTransform &transform,
+                        QPainter::RenderHints renderHints,
+                        const QSize &mapSize,
+                        const QString &imageFileName,
+                        int threadCount) const;
+    bool renderAnimated(MapRenderer *renderer,
+                        const QList<Layer*> &layers,
+                        const QTransform &transform,
+                        QPainter::RenderHints renderHints,
+                        const QSize &mapSize,
+                        const QString &imageFileName,
+                        int threadCount) const;
 
 };
 
@@ -31,10 +31,21 @@ macx {
     QMAKE_RPATHDIR =
 }
 
+win32 {
+    lessThan(QT_MAJOR_VERSION, 5) {
+        INCLUDEPATH += ../zlib
+    }
+} else {
+    # The PNG writer uses zlib directly
+    LIBS += -lz
+}
+
 SOURCES += main.cpp \
+         pngwriter.cpp \
          tmxrasterizer.cpp
 
-HEADERS += tmxrasterizer.h
+HEADERS += pngwriter.h \
+         tmxrasterizer.h
 
 manpage.path = $${PREFIX}/share/man/man1/
 manpage.files += ../../docs/tmxrasterizer.1
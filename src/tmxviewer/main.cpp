@@ -30,6 +30,7 @@
 
 #include <QApplication>
 #include <QDebug>
+#include <QTimer>
 
 namespace {
 
@@ -37,10 +38,16 @@ struct CommandLineOptions {
     CommandLineOptions()
         : showHelp(false)
         , showVersion(false)
+        , useOpenGL(false)
+        , useCache(true)
+        , benchmark(false)
     {}
 
     bool showHelp;
     bool showVersion;
+    bool useOpenGL;
+    bool useCache;
+    bool benchmark;
     QString fileToOpen;
 };
 
@@ -53,7 +60,10 @@ static void showHelp()
             "Usage: tmxviewer [option] [file]\n\n"
             "Options:\n"
             "  -h --help    : Display this help\n"
-            "  -v --version : Display the version";
+            "  -v --version : Display the version\n"
+            "  --opengl     : Paint the map through OpenGL\n"
+            "  --no-cache   : Don't cache the rendering of tile layers\n"
+            "  --benchmark  : Pan and zoom across the map, print the frame times and quit";
 }
 
 static void showVersion()
@@ -73,6 +83,12 @@ static void parseCommandLineArguments(CommandLineOptions &options)
         } else if (arg == QLatin1String("--version")
                 || arg == QLatin1String("-v")) {
             options.showVersion = true;
+        } else if (arg == QLatin1String("--opengl")) {
+            options.useOpenGL = true;
+        } else if (arg == QLatin1String("--no-cache")) {
+            options.useCache = false;
+        } else if (arg == QLatin1String("--benchmark")) {
+            options.benchmark = true;
         } else if (arg.at(0) == QLatin1Char('-')) {
             qWarning() << "Unknown option" << arg;
             options.showHelp = true;
@@ -109,9 +125,17 @@ int main(int argc, char *argv[])
         return 0;
 
     TmxViewer w;
+    w.setUseOpenGL(options.useOpenGL);
+    w.setUseCache(options.useCache);
     if (!w.viewMap(options.fileToOpen))
         return 1;
 
+    if (options.benchmark) {
+        // A fixed size makes the results comparable
+        w.resize(1024, 768);
+        QTimer::singleShot(0, &w, SLOT(runBenchmark()));
+    }
+
     w.show();
     return a.exec();
 }
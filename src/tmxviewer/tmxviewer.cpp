@@ -41,12 +41,35 @@
 
 #include <QCoreApplication>
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QGraphicsItem>
 #include <QGraphicsScene>
 #include <QStyleOptionGraphicsItem>
+#include <QTextStream>
+#include <QVector>
+#include <QtCore/qmath.h>
+
+#ifndef QT_NO_OPENGL
+#include <QGLWidget>
+#endif
 
 using namespace Tiled;
 
+/**
+ * Returns the value below which \a percent of the given sorted \a values
+ * fall, using the nearest rank.
+ */
+static qint64 percentile(const QVector<qint64> &values, int percent)
+{
+    const int rank = qCeil(values.size() * percent / 100.0);
+    return values.at(qBound(0, rank - 1, values.size() - 1));
+}
+
+static QString msecs(qint64 nsecs)
+{
+    return QString::number(nsecs / 1000000.0, 'f', 3);
+}
+
 /**
  * Item that represents a map object.
  */
@@ -90,33 +113,104 @@ private:
 };
 
 /**
- * Item that represents a tile layer.
+ * Item that displays the part of a tile layer within a fixed area of the
+ * scene. Drawing is clipped to that area, so that tiles reaching into
+ * neighbouring chunks are not drawn twice.
  */
-class TileLayerItem : public QGraphicsItem
+class TileLayerChunkItem : public QGraphicsItem
 {
 public:
-    TileLayerItem(TileLayer *tileLayer, MapRenderer *renderer,
-                  QGraphicsItem *parent = 0)
+    TileLayerChunkItem(TileLayer *tileLayer, MapRenderer *renderer,
+                       const QRectF &rect, QGraphicsItem *parent)
         : QGraphicsItem(parent)
         , mTileLayer(tileLayer)
         , mRenderer(renderer)
+        , mRect(rect)
     {
         setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
     }
 
     QRectF boundingRect() const
     {
-        return mRenderer->boundingRect(mTileLayer->bounds());
+        return mRect;
     }
 
     void paint(QPainter *p, const QStyleOptionGraphicsItem *option, QWidget *)
     {
-        mRenderer->drawTileLayer(p, mTileLayer, option->rect);
+        const QRectF exposed = option->exposedRect & mRect;
+        p->setClipRect(exposed);
+        mRenderer->drawTileLayer(p, mTileLayer, exposed);
     }
 
 private:
     TileLayer *mTileLayer;
     MapRenderer *mRenderer;
+    QRectF mRect;
+};
+
+/**
+ * Item that represents a tile layer. The layer is displayed by child items
+ * covering a grid over the scene, leaving out the areas without tiles, so
+ * that only the chunks that are in view need to be painted.
+ */
+class TileLayerItem : public QGraphicsItem
+{
+public:
+    TileLayerItem(TileLayer *tileLayer, MapRenderer *renderer,
+                  bool useCache, QGraphicsItem *parent = 0)
+        : QGraphicsItem(parent)
+    {
+        setFlag(QGraphicsItem::ItemHasNoContents);
+
+        // The scene area in which each chunk of the layer may draw tiles
+        const QMargins margins = tileLayer->drawMargins();
+        const QPoint position = tileLayer->position();
+        QVector<QRectF> occupied;
+        foreach (const QRect &rect, tileLayer->chunkRects()) {
+            const QRect bounds = renderer->boundingRect(rect.translated(position));
+            occupied.append(bounds.adjusted(-margins.left(), -margins.top(),
+                                            margins.right(), margins.bottom()));
+        }
+
+        QRectF layerRect;
+        foreach (const QRectF &rect, occupied)
+            layerRect |= rect;
+
+        const int firstX = qFloor(layerRect.left() / ChunkSize);
+        const int firstY = qFloor(layerRect.top() / ChunkSize);
+        const int lastX = qCeil(layerRect.right() / ChunkSize);
+        const int lastY = qCeil(layerRect.bottom() / ChunkSize);
+
+        for (int y = firstY; y < lastY; ++y) {
+            for (int x = firstX; x < lastX; ++x) {
+                const QRectF rect(x * ChunkSize, y * ChunkSize,
+                                  ChunkSize, ChunkSize);
+
+                bool hasTiles = false;
+                foreach (const QRectF &bounds, occupied) {
+                    if (bounds.intersects(rect)) {
+                        hasTiles = true;
+                        break;
+                    }
+                }
+                if (!hasTiles)
+                    continue;
+
+                QGraphicsItem *item = new TileLayerChunkItem(tileLayer,
+                                                             renderer,
+                                                             rect, this);
+                if (useCache)
+                    item->setCacheMode(QGraphicsItem::DeviceCoordinateCache);
+            }
+        }
+    }
+
+    QRectF boundingRect() const { return QRectF(); }
+    void paint(QPainter *, const QStyleOptionGraphicsItem *, QWidget *) {}
+
+private:
+    // The size of the chunk items in pixels
+    static const int ChunkSize = 512;
 };
 
 /**
@@ -151,7 +245,8 @@ public:
 class MapItem : public QGraphicsItem
 {
 public:
-    MapItem(Map *map, MapRenderer *renderer, QGraphicsItem *parent = 0)
+    MapItem(Map *map, MapRenderer *renderer, bool useCache,
+            QGraphicsItem *parent = 0)
         : QGraphicsItem(parent)
     {
         setFlag(QGraphicsItem::ItemHasNoContents);
@@ -159,7 +254,7 @@ public:
         // Create a child item for each layer
         foreach (Layer *layer, map->layers()) {
             if (TileLayer *tileLayer = layer->asTileLayer()) {
-                new TileLayerItem(tileLayer, renderer, this);
+                new TileLayerItem(tileLayer, renderer, useCache, this);
             } else if (ObjectGroup *objectGroup = layer->asObjectGroup()) {
                 new ObjectGroupItem(objectGroup, renderer, this);
             }
@@ -175,7 +270,8 @@ TmxViewer::TmxViewer(QWidget *parent) :
     QGraphicsView(parent),
     mScene(new QGraphicsScene(this)),
     mMap(0),
-    mRenderer(0)
+    mRenderer(0),
+    mUseCache(true)
 {
     setWindowTitle(tr("TMX Viewer"));
 
@@ -230,7 +326,84 @@ bool TmxViewer::viewMap(const QString &fileName)
         break;
     }
 
-    mScene->addItem(new MapItem(mMap, mRenderer));
+    mScene->addItem(new MapItem(mMap, mRenderer, mUseCache));
 
     return true;
 }
+
+void TmxViewer::setUseOpenGL(bool useOpenGL)
+{
+#ifndef QT_NO_OPENGL
+    if (useOpenGL && QGLFormat::hasOpenGL()) {
+        if (!qobject_cast<QGLWidget*>(viewport())) {
+            QGLFormat format = QGLFormat::defaultFormat();
+            format.setDepth(false); // No need for a depth buffer
+            setViewport(new QGLWidget(format));
+        }
+    } else {
+        if (useOpenGL)
+            qWarning() << "OpenGL is not available";
+        if (qobject_cast<QGLWidget*>(viewport()))
+            setViewport(0);
+    }
+
+    // The OpenGL viewport is always repainted as a whole
+    setViewportUpdateMode(useOpenGL ? QGraphicsView::FullViewportUpdate
+                                    : QGraphicsView::MinimalViewportUpdate);
+    viewport()->setAttribute(Qt::WA_StaticContents);
+#else
+    if (useOpenGL)
+        qWarning() << "OpenGL is not available";
+#endif
+}
+
+/**
+ * Pans across the whole map at a number of zoom levels, painting the view
+ * once for each step, and prints the distribution of the frame times.
+ * Quits the application when done.
+ */
+void TmxViewer::runBenchmark()
+{
+    static const qreal scales[] = { 1.0, 0.5, 0.25, 2.0 };
+    static const int stepsPerScale = 100;
+
+    QVector<qint64> frameTimes;
+    QElapsedTimer timer;
+
+    if (mRenderer) {
+        const QSize mapSize = mRenderer->mapSize();
+
+        for (size_t i = 0; i < sizeof(scales) / sizeof(scales[0]); ++i) {
+            setTransform(QTransform::fromScale(scales[i], scales[i]));
+
+            for (int step = 0; step < stepsPerScale; ++step) {
+                // Pan diagonally, back and forth
+                const qreal t = qreal(step) / (stepsPerScale - 1);
+                const qreal f = i % 2 ? 1 - t : t;
+                centerOn(mapSize.width() * f, mapSize.height() * f);
+
+                timer.start();
+                viewport()->repaint();
+                frameTimes.append(timer.nsecsElapsed());
+            }
+        }
+    }
+
+    if (!frameTimes.isEmpty()) {
+        qSort(frameTimes);
+
+        qint64 total = 0;
+        foreach (qint64 frameTime, frameTimes)
+            total += frameTime;
+
+        QTextStream out(stdout);
+        out << "frames: " << frameTimes.size() << "\n";
+        out << "mean: " << msecs(total / frameTimes.size()) << " ms\n";
+        out << "p50: " << msecs(percentile(frameTimes, 50)) << " ms\n";
+        out << "p90: " << msecs(percentile(frameTimes, 90)) << " ms\n";
+        out << "p99: " << msecs(percentile(frameTimes, 99)) << " ms\n";
+        out << "max: " << msecs(frameTimes.last()) << " ms\n";
+    }
+
+    QCoreApplication::quit();
+}
@@ -46,10 +46,25 @@ public:
 
     bool viewMap(const QString &fileName);
 
+    /**
+     * Sets whether the map is painted through an OpenGL viewport.
+     */
+    void setUseOpenGL(bool useOpenGL);
+
+    /**
+     * Sets whether the rendering of the tile layers is cached in pixmaps.
+     * Takes effect for the next map that is viewed.
+     */
+    void setUseCache(bool useCache) { mUseCache = useCache; }
+
+public slots:
+    void runBenchmark();
+
 private:
     QGraphicsScene *mScene;
     Tiled::Map *mMap;
     Tiled::MapRenderer *mRenderer;
+    bool mUseCache;
 };
 
 #endif // TMXVIEWER_H
@@ -9,6 +9,8 @@ INSTALLS += target
 greaterThan(QT_MAJOR_VERSION, 4) {
     QT += widgets
 }
+contains(QT_CONFIG, opengl):!macx: QT += opengl
+macx: DEFINES += QT_NO_OPENGL
 
 win32 {
     DESTDIR = ../..
@@ -0,0 +1,193 @@
+#include "automapper.h"
+#include "geometry.h"
+#include "map.h"
+#include "mapdocument.h"
+#include "tilelayer.h"
+#include "tileset.h"
+#include "tilesetmanager.h"
+
+#include <QElapsedTimer>
+#include <QtTest/QtTest>
+
+using namespace Tiled;
+using namespace Tiled::Internal;
+
+/**
+ * Benchmarks AutoMapper on generated maps. Each rule matches a footprint of
+ * tiles on the "set" layer and places a tile on the "out" layer.
+ */
+class test_AutoMapper : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void autoMap_data();
+    void autoMap();
+
+    void coherentRegions_data();
+    void coherentRegions();
+
+private:
+    static Map *createRulesMap(Tileset *tileset, int ruleCount, int footprint);
+    static Map *createWorkingMap(Tileset *tileset, int size);
+};
+
+static const int TileCount = 16;
+
+Map *test_AutoMapper::createRulesMap(Tileset *tileset,
+                                     int ruleCount, int footprint)
+{
+    // The rules are placed below each other, with one row in between
+    const int height = ruleCount * (footprint + 1);
+    Map *map = new Map(Map::Orthogonal, footprint, height, 32, 32);
+    map->addTileset(tileset);
+
+    TileLayer *regions = new TileLayer(QLatin1String("regions"),
+                                       0, 0, footprint, height);
+    TileLayer *input = new TileLayer(QLatin1String("input_set"),
+                                     0, 0, footprint, height);
+    TileLayer *output = new TileLayer(QLatin1String("output_out"),
+                                      0, 0, footprint, height);
+
+    for (int rule = 0; rule < ruleCount; ++rule) {
+        const int top = rule * (footprint + 1);
+
+        for (int y = 0; y < footprint; ++y) {
+            for (int x = 0; x < footprint; ++x) {
+                const int tile = (rule + x * 3 + y * 5) % TileCount;
+                regions->setCell(x, top + y, Cell(tileset->tileAt(0)));
+                input->setCell(x, top + y, Cell(tileset->tileAt(tile)));
+            }
+        }
+
+        output->setCell(0, top, Cell(tileset->tileAt(rule % TileCount)));
+    }
+
+    map->addLayer(regions);
+    map->addLayer(input);
+    map->addLayer(output);
+    return map;
+}
+
+Map *test_AutoMapper::createWorkingMap(Tileset *tileset, int size)
+{
+    Map *map = new Map(Map::Orthogonal, size, size, 32, 32);
+    map->addTileset(tileset);
+
+    TileLayer *set = new TileLayer(QLatin1String("set"), 0, 0, size, size);
+    TileLayer *out = new TileLayer(QLatin1String("out"), 0, 0, size, size);
+
+    qsrand(size);
+    for (int y = 0; y < size; ++y)
+        for (int x = 0; x < size; ++x)
+            set->setCell(x, y, Cell(tileset->tileAt(qrand() % TileCount)));
+
+    map->addLayer(set);
+    map->addLayer(out);
+    return map;
+}
+
+void test_AutoMapper::autoMap_data()
+{
+    QTest::addColumn<int>("size");
+    QTest::addColumn<int>("ruleCount");
+    QTest::addColumn<int>("footprint");
+
+    QTest::newRow("64x64, 8 rules of 1x1") << 64 << 8 << 1;
+    QTest::newRow("64x64, 8 rules of 3x3") << 64 << 8 << 3;
+    QTest::newRow("256x256, 8 rules of 3x3") << 256 << 8 << 3;
+    QTest::newRow("256x256, 64 rules of 1x1") << 256 << 64 << 1;
+    QTest::newRow("256x256, 64 rules of 3x3") << 256 << 64 << 3;
+    QTest::newRow("1024x1024, 64 rules of 3x3") << 1024 << 64 << 3;
+}
+
+void test_AutoMapper::autoMap()
+{
+    QFETCH(int, size);
+    QFETCH(int, ruleCount);
+    QFETCH(int, footprint);
+
+    Tileset *tileset = new Tileset(QLatin1String("tileset"), 32, 32);
+    for (int i = 0; i < TileCount; ++i)
+        tileset->addTile(QPixmap(32, 32));
+
+    MapDocument mapDocument(createWorkingMap(tileset, size));
+
+    Map *rules = createRulesMap(tileset, ruleCount, footprint);
+    TilesetManager::instance()->addReferences(rules->tilesets());
+
+    AutoMapper autoMapper(&mapDocument, rules, QLatin1String("rules.tmx"));
+    QVERIFY2(autoMapper.errorString().isEmpty(),
+             qPrintable(autoMapper.errorString()));
+
+    qint64 elapsed = 0;
+    int runs = 0;
+
+    QBENCHMARK {
+        QElapsedTimer timer;
+        timer.start();
+
+        QVERIFY(autoMapper.prepareAutoMap());
+        QRegion where(0, 0, size, size);
+        autoMapper.autoMap(&where);
+        autoMapper.cleanAll();
+
+        elapsed += timer.elapsed();
+        ++runs;
+    }
+
+    if (elapsed > 0) {
+        const qreal seconds = elapsed / 1000.0;
+        const qreal cells = qreal(size) * size * runs;
+        qDebug("%.0f rules/sec, %.0f cells/sec",
+               ruleCount * runs / seconds, cells / seconds);
+    }
+}
+
+void test_AutoMapper::coherentRegions_data()
+{
+    QTest::addColumn<QRegion>("region");
+    QTest::addColumn<int>("regionCount");
+
+    QRegion ring = QRegion(0, 0, 10, 10) - QRegion(2, 2, 6, 6);
+    QRegion diagonal = QRegion(0, 0, 2, 2) + QRegion(2, 2, 2, 2);
+    QRegion comb = QRegion(0, 0, 9, 1);
+    for (int x = 0; x < 9; x += 2)
+        comb += QRegion(x, 1, 1, 5);
+
+    QRegion checkers;
+    for (int y = 0; y < 16; ++y)
+        for (int x = y % 2; x < 16; x += 2)
+            checkers += QRegion(x, y, 1, 1);
+
+    QTest::newRow("empty") << QRegion() << 0;
+    QTest::newRow("ring") << ring << 1;
+    QTest::newRow("ring with center") << ring + QRegion(4, 4, 2, 2) << 2;
+    QTest::newRow("diagonal") << diagonal << 2;
+    QTest::newRow("comb") << comb << 1;
+    QTest::newRow("comb without back") << comb - QRegion(0, 0, 9, 1) << 5;
+    QTest::newRow("checkers") << checkers << 128;
+}
+
+/**
+ * Checks that coherentRegions splits a region into its connected parts,
+ * which together make up the original region.
+ */
+void test_AutoMapper::coherentRegions()
+{
+    QFETCH(QRegion, region);
+    QFETCH(int, regionCount);
+
+    const QList<QRegion> regions = Tiled::coherentRegions(region);
+    QCOMPARE(regions.size(), regionCount);
+
+    QRegion united;
+    foreach (const QRegion &coherent, regions) {
+        QVERIFY(!united.intersects(coherent));
+        united += coherent;
+    }
+    QCOMPARE(united, region);
+}
+
+QTEST_MAIN(test_AutoMapper)
+#include "test_automapper.moc"
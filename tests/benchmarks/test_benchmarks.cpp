@@ -0,0 +1,246 @@
+#include "compression.h"
+#include "map.h"
+#include "mapreader.h"
+#include "mapwriter.h"
+#include "tilelayer.h"
+#include "tileset.h"
+
+#include <QBuffer>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QtTest/QtTest>
+
+using namespace Tiled;
+
+/**
+ * Benchmarks MapReader and MapWriter on a generated map, for each layer data
+ * format. The map can be configured with the TILED_BENCHMARK_SIZE,
+ * TILED_BENCHMARK_LAYERS and TILED_BENCHMARK_TILESETS environment variables.
+ */
+class test_Benchmarks : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void writeMap_data();
+    void writeMap();
+
+    void readMap_data();
+    void readMap();
+
+private:
+    void addFormats();
+    QByteArray writeMap(Map::LayerDataFormat format) const;
+    void report(qint64 elapsed, int runs) const;
+
+    Map *mMap;
+};
+
+Q_DECLARE_METATYPE(Map::LayerDataFormat)
+
+static const int TileCount = 64;
+
+static int intFromEnvironment(const char *name, int defaultValue)
+{
+    bool ok;
+    const int value = qgetenv(name).toInt(&ok);
+    return ok && value > 0 ? value : defaultValue;
+}
+
+/**
+ * Resets the peak resident set size of this process, so that the next call
+ * to peakMemory() only covers what happened in between. Only supported on
+ * Linux.
+ */
+static void resetPeakMemory()
+{
+#ifdef Q_OS_LINUX
+    QFile file(QLatin1String("/proc/self/clear_refs"));
+    if (file.open(QIODevice::WriteOnly))
+        file.write("5");
+#endif
+}
+
+/**
+ * Returns the peak resident set size of this process in kB, or -1 when it
+ * is unknown.
+ */
+static int peakMemory()
+{
+#ifdef Q_OS_LINUX
+    QFile file(QLatin1String("/proc/self/status"));
+    if (!file.open(QIODevice::ReadOnly))
+        return -1;
+
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine();
+        if (line.startsWith("VmHWM:"))
+            return line.mid(6).trimmed().split(' ').first().toInt();
+    }
+#endif
+    return -1;
+}
+
+void test_Benchmarks::initTestCase()
+{
+    const int size = intFromEnvironment("TILED_BENCHMARK_SIZE", 512);
+    const int layerCount = intFromEnvironment("TILED_BENCHMARK_LAYERS", 4);
+    const int tilesetCount = intFromEnvironment("TILED_BENCHMARK_TILESETS", 2);
+
+    mMap = new Map(Map::Orthogonal, size, size, 32, 32);
+
+    QList<Tileset*> tilesets;
+    for (int i = 0; i < tilesetCount; ++i) {
+        Tileset *tileset = new Tileset(QString(QLatin1String("tileset%1")).arg(i),
+                                       32, 32);
+        for (int j = 0; j < TileCount; ++j)
+            tileset->addTile(QPixmap(32, 32));
+        mMap->addTileset(tileset);
+        tilesets.append(tileset);
+    }
+
+    qsrand(size);
+    for (int i = 0; i < layerCount; ++i) {
+        TileLayer *layer = new TileLayer(QString(QLatin1String("layer%1")).arg(i),
+                                         0, 0, size, size);
+
+        // Leave some cells empty and flip some others, like in real maps
+        for (int y = 0; y < size; ++y) {
+            for (int x = 0; x < size; ++x) {
+                const int value = qrand() % (TileCount * tilesetCount * 5 / 4);
+                if (value >= TileCount * tilesetCount)
+                    continue;
+
+                Cell cell(tilesets.at(value / TileCount)->tileAt(value % TileCount));
+                cell.flippedHorizontally = qrand() % 8 == 0;
+                layer->setCell(x, y, cell);
+            }
+        }
+
+        mMap->addLayer(layer);
+    }
+
+    qDebug("%dx%d, %d layers, %d tilesets",
+           size, size, layerCount, tilesetCount);
+}
+
+void test_Benchmarks::cleanupTestCase()
+{
+    qDeleteAll(mMap->tilesets());
+    delete mMap;
+    mMap = 0;
+}
+
+void test_Benchmarks::addFormats()
+{
+    QTest::addColumn<Map::LayerDataFormat>("format");
+
+    QTest::newRow("xml") << Map::XML;
+    QTest::newRow("csv") << Map::CSV;
+    QTest::newRow("base64") << Map::Base64;
+    QTest::newRow("gzip") << Map::Base64Gzip;
+    QTest::newRow("zlib") << Map::Base64Zlib;
+    if (isCompressionMethodSupported(Zstandard))
+        QTest::newRow("zstd") << Map::Base64Zstandard;
+    if (isCompressionMethodSupported(Lz4))
+        QTest::newRow("lz4") << Map::Base64Lz4;
+}
+
+QByteArray test_Benchmarks::writeMap(Map::LayerDataFormat format) const
+{
+    mMap->setLayerDataFormat(format);
+
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    MapWriter writer;
+    writer.writeMap(mMap, &buffer);
+    return data;
+}
+
+void test_Benchmarks::report(qint64 elapsed, int runs) const
+{
+    if (elapsed > 0) {
+        const qreal seconds = elapsed / 1000.0;
+        const qreal cells = qreal(mMap->width()) * mMap->height() *
+                mMap->layerCount() * runs;
+        qDebug("%.0f cells/sec", cells / seconds);
+    }
+
+    const int peak = peakMemory();
+    if (peak != -1)
+        qDebug("%d kB peak memory", peak);
+}
+
+void test_Benchmarks::writeMap_data()
+{
+    addFormats();
+}
+
+void test_Benchmarks::writeMap()
+{
+    QFETCH(Map::LayerDataFormat, format);
+
+    qint64 elapsed = 0;
+    int runs = 0;
+
+    resetPeakMemory();
+
+    QBENCHMARK {
+        QElapsedTimer timer;
+        timer.start();
+
+        const QByteArray data = writeMap(format);
+        QVERIFY(!data.isEmpty());
+
+        elapsed += timer.elapsed();
+        ++runs;
+    }
+
+    report(elapsed, runs);
+}
+
+void test_Benchmarks::readMap_data()
+{
+    addFormats();
+}
+
+void test_Benchmarks::readMap()
+{
+    QFETCH(Map::LayerDataFormat, format);
+
+    QByteArray data = writeMap(format);
+
+    qint64 elapsed = 0;
+    int runs = 0;
+
+    resetPeakMemory();
+
+    QBENCHMARK {
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::ReadOnly);
+
+        QElapsedTimer timer;
+        timer.start();
+
+        MapReader reader;
+        Map *map = reader.readMap(&buffer);
+
+        elapsed += timer.elapsed();
+        ++runs;
+
+        QVERIFY2(map, qPrintable(reader.errorString()));
+        QCOMPARE(map->layerCount(), mMap->layerCount());
+
+        qDeleteAll(map->tilesets());
+        delete map;
+    }
+
+    report(elapsed, runs);
+}
+
+QTEST_MAIN(test_Benchmarks)
+#include "test_benchmarks.moc"
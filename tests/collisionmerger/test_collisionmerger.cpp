@@ -0,0 +1,168 @@
+#include "collisionmerger.h"
+#include "mapobject.h"
+#include "objectgroup.h"
+#include "tile.h"
+#include "tilelayer.h"
+#include "tileset.h"
+
+#include <QtTest/QtTest>
+
+using namespace Tiled;
+
+class test_CollisionMerger : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void emptyLayer();
+    void mergesFullCells();
+    void keepsTypesApart();
+    void unitesPartialShapes();
+    void flipsShapes();
+
+private:
+    static ObjectGroup *collision(MapObject *object);
+    static qreal totalArea(const ObjectGroup *objectGroup);
+
+    Tileset *mTileset;
+    Tile *mSolid;
+    Tile *mWater;
+    Tile *mLeftHalf;
+};
+
+ObjectGroup *test_CollisionMerger::collision(MapObject *object)
+{
+    ObjectGroup *objectGroup = new ObjectGroup;
+    objectGroup->addObject(object);
+    return objectGroup;
+}
+
+qreal test_CollisionMerger::totalArea(const ObjectGroup *objectGroup)
+{
+    qreal area = 0;
+    foreach (const MapObject *object, objectGroup->objects()) {
+        if (object->shape() == MapObject::Rectangle) {
+            area += object->width() * object->height();
+        } else {
+            // Shoelace formula
+            const QPolygonF &polygon = object->polygon();
+            qreal sum = 0;
+            for (int i = 0; i < polygon.size(); ++i) {
+                const QPointF &a = polygon.at(i);
+                const QPointF &b = polygon.at((i + 1) % polygon.size());
+                sum += a.x() * b.y() - b.x() * a.y();
+            }
+            area += qAbs(sum) / 2;
+        }
+    }
+    return area;
+}
+
+void test_CollisionMerger::initTestCase()
+{
+    mTileset = new Tileset(QLatin1String("tiles"), 16, 16);
+    mSolid = mTileset->addTile(QPixmap(16, 16));
+    mWater = mTileset->addTile(QPixmap(16, 16));
+    mLeftHalf = mTileset->addTile(QPixmap(16, 16));
+
+    mSolid->setObjectGroup(collision(new MapObject(QString(), QString(),
+                                                   QPointF(0, 0),
+                                                   QSizeF(16, 16))));
+    mWater->setObjectGroup(collision(new MapObject(QString(),
+                                                   QLatin1String("water"),
+                                                   QPointF(0, 0),
+                                                   QSizeF(16, 16))));
+    mLeftHalf->setObjectGroup(collision(new MapObject(QString(), QString(),
+                                                      QPointF(0, 0),
+                                                      QSizeF(8, 16))));
+}
+
+void test_CollisionMerger::cleanupTestCase()
+{
+    delete mTileset;
+    mTileset = 0;
+}
+
+void test_CollisionMerger::emptyLayer()
+{
+    TileLayer layer(QString(), 0, 0, 10, 10);
+    ObjectGroup *merged = mergeCollisionShapes(&layer, QSize(16, 16));
+    QVERIFY(merged->isEmpty());
+    delete merged;
+}
+
+void test_CollisionMerger::mergesFullCells()
+{
+    // An L shape, which greedy meshing covers with two rectangles
+    TileLayer layer(QString(), 0, 0, 10, 10);
+    for (int x = 0; x < 5; ++x)
+        layer.setCell(x, 2, Cell(mSolid));
+    for (int y = 3; y < 7; ++y)
+        layer.setCell(0, y, Cell(mSolid));
+
+    ObjectGroup *merged = mergeCollisionShapes(&layer, QSize(16, 16));
+    QCOMPARE(merged->objectCount(), 2);
+    QCOMPARE(merged->objects().at(0)->bounds(), QRectF(0, 32, 80, 16));
+    QCOMPARE(merged->objects().at(1)->bounds(), QRectF(0, 48, 16, 64));
+    delete merged;
+}
+
+void test_CollisionMerger::keepsTypesApart()
+{
+    TileLayer layer(QString(), 0, 0, 4, 1);
+    layer.setCell(0, 0, Cell(mSolid));
+    layer.setCell(1, 0, Cell(mSolid));
+    layer.setCell(2, 0, Cell(mWater));
+    layer.setCell(3, 0, Cell(mWater));
+
+    ObjectGroup *merged = mergeCollisionShapes(&layer, QSize(16, 16));
+    QCOMPARE(merged->objectCount(), 2);
+
+    foreach (const MapObject *object, merged->objects()) {
+        if (object->type() == QLatin1String("water"))
+            QCOMPARE(object->bounds(), QRectF(32, 0, 32, 16));
+        else
+            QCOMPARE(object->bounds(), QRectF(0, 0, 32, 16));
+    }
+    delete merged;
+}
+
+void test_CollisionMerger::unitesPartialShapes()
+{
+    // Half-cell shapes stacked vertically become a single polygon
+    TileLayer layer(QString(), 0, 0, 1, 3);
+    for (int y = 0; y < 3; ++y)
+        layer.setCell(0, y, Cell(mLeftHalf));
+
+    ObjectGroup *merged = mergeCollisionShapes(&layer, QSize(16, 16));
+    QCOMPARE(merged->objectCount(), 1);
+
+    const MapObject *object = merged->objects().first();
+    QCOMPARE(object->shape(), MapObject::Polygon);
+    QCOMPARE(object->position(), QPointF(0, 0));
+    QCOMPARE(totalArea(merged), qreal(8 * 48));
+    delete merged;
+}
+
+void test_CollisionMerger::flipsShapes()
+{
+    TileLayer layer(QString(), 0, 0, 1, 1);
+    Cell cell(mLeftHalf);
+    cell.flippedHorizontally = true;
+    layer.setCell(0, 0, cell);
+
+    ObjectGroup *merged = mergeCollisionShapes(&layer, QSize(16, 16));
+    QCOMPARE(merged->objectCount(), 1);
+
+    const MapObject *object = merged->objects().first();
+    const QRectF bounds = object->polygon().boundingRect()
+            .translated(object->position());
+    QCOMPARE(bounds, QRectF(8, 0, 8, 16));
+    delete merged;
+}
+
+QTEST_MAIN(test_CollisionMerger)
+#include "test_collisionmerger.moc"
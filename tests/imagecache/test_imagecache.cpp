@@ -0,0 +1,107 @@
+#include "imagecache.h"
+
+#include <QDir>
+#include <QFile>
+#include <QtTest/QtTest>
+
+using namespace Tiled;
+
+class test_ImageCache : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void diskCacheRoundTrip();
+    void corruptDiskCache();
+    void smallImagesAreNotStored();
+
+private:
+    QStringList cachedFiles() const;
+
+    QString mImageFileName;
+    QString mCacheDirectory;
+};
+
+void test_ImageCache::init()
+{
+    mImageFileName = QDir::temp().filePath(QLatin1String("test_imagecache.png"));
+    mCacheDirectory = QDir::temp().filePath(QLatin1String("test_imagecache"));
+    ImageCache::setDiskCacheDirectory(mCacheDirectory);
+}
+
+void test_ImageCache::cleanup()
+{
+    ImageCache::setDiskCacheDirectory(QString());
+    ImageCache::clear();
+
+    foreach (const QString &fileName, cachedFiles())
+        QFile::remove(QDir(mCacheDirectory).filePath(fileName));
+    QDir().rmdir(mCacheDirectory);
+    QFile::remove(mImageFileName);
+}
+
+QStringList test_ImageCache::cachedFiles() const
+{
+    return QDir(mCacheDirectory).entryList(QDir::Files);
+}
+
+/**
+ * Returns an image large enough to be stored in the disk cache.
+ */
+static QImage largeImage()
+{
+    QImage image(1024, 512, QImage::Format_ARGB32);
+    image.fill(qRgba(255, 0, 0, 128));
+    for (int x = 0; x < image.width(); ++x)
+        image.setPixel(x, x % image.height(), qRgba(0, 0, 255, 255));
+    return image;
+}
+
+void test_ImageCache::diskCacheRoundTrip()
+{
+    const QImage image = largeImage();
+    QVERIFY(image.save(mImageFileName));
+
+    const QImage decoded = ImageCache::loadImage(mImageFileName);
+    QCOMPARE(decoded.format(), QImage::Format_ARGB32_Premultiplied);
+    QCOMPARE(cachedFiles().size(), 1);
+
+    // Forget the image in memory, so that it is read from the disk cache
+    ImageCache::clear();
+
+    const QImage cached = ImageCache::loadImage(mImageFileName);
+    QCOMPARE(cached.format(), QImage::Format_ARGB32_Premultiplied);
+    QCOMPARE(cached, decoded);
+}
+
+void test_ImageCache::corruptDiskCache()
+{
+    QVERIFY(largeImage().save(mImageFileName));
+
+    const QImage decoded = ImageCache::loadImage(mImageFileName);
+    QCOMPARE(cachedFiles().size(), 1);
+    ImageCache::clear();
+
+    QFile file(QDir(mCacheDirectory).filePath(cachedFiles().first()));
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.write("garbage");
+    file.close();
+
+    QCOMPARE(ImageCache::loadImage(mImageFileName), decoded);
+}
+
+void test_ImageCache::smallImagesAreNotStored()
+{
+    QImage image(16, 16, QImage::Format_ARGB32);
+    image.fill(qRgba(0, 255, 0, 255));
+    QVERIFY(image.save(mImageFileName));
+
+    QVERIFY(!ImageCache::loadImage(mImageFileName).isNull());
+    QVERIFY(cachedFiles().isEmpty());
+}
+
+QTEST_MAIN(test_ImageCache)
+#include "test_imagecache.moc"
@@ -0,0 +1,149 @@
+#include "jobsystem.h"
+
+#include <QRunnable>
+#include <QVector>
+#include <QtTest/QtTest>
+
+using namespace Tiled;
+
+class test_JobSystem : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void runsAllJobs();
+    void nestedGroups();
+    void canceledJobsAreSkipped();
+    void autoDelete();
+};
+
+namespace {
+
+/**
+ * Marks its own slot in a list of results, so that no locking is needed.
+ */
+class MarkJob : public QRunnable
+{
+public:
+    MarkJob(QVector<int> *results, int index)
+        : mResults(results)
+        , mIndex(index)
+    {}
+
+    void run() { (*mResults)[mIndex] = mIndex + 1; }
+
+private:
+    QVector<int> *mResults;
+    int mIndex;
+};
+
+/**
+ * Starts a nested group of jobs and waits for them.
+ */
+class NestingJob : public QRunnable
+{
+public:
+    NestingJob(QVector<int> *results, int first, int count)
+        : mResults(results)
+        , mFirst(first)
+        , mCount(count)
+    {}
+
+    void run()
+    {
+        JobGroup jobs;
+        for (int i = mFirst; i < mFirst + mCount; ++i)
+            jobs.start(new MarkJob(mResults, i));
+        jobs.wait();
+    }
+
+private:
+    QVector<int> *mResults;
+    int mFirst;
+    int mCount;
+};
+
+class DeletionJob : public QRunnable
+{
+public:
+    explicit DeletionJob(bool *deleted) : mDeleted(deleted) {}
+    ~DeletionJob() { *mDeleted = true; }
+
+    void run() {}
+
+private:
+    bool *mDeleted;
+};
+
+} // anonymous namespace
+
+void test_JobSystem::runsAllJobs()
+{
+    QVERIFY(JobSystem::workerCount() >= 1);
+
+    QVector<int> results(1000);
+
+    JobGroup jobs;
+    for (int i = 0; i < results.size(); ++i)
+        jobs.start(new MarkJob(&results, i));
+    jobs.wait();
+
+    for (int i = 0; i < results.size(); ++i)
+        QCOMPARE(results.at(i), i + 1);
+}
+
+void test_JobSystem::nestedGroups()
+{
+    // More nesting jobs than workers, so that waiting workers need to help
+    const int nestingJobs = JobSystem::workerCount() * 4;
+    QVector<int> results(nestingJobs * 50);
+
+    JobGroup jobs(JobSystem::Interactive);
+    for (int i = 0; i < nestingJobs; ++i)
+        jobs.start(new NestingJob(&results, i * 50, 50));
+    jobs.wait();
+
+    for (int i = 0; i < results.size(); ++i)
+        QCOMPARE(results.at(i), i + 1);
+}
+
+void test_JobSystem::canceledJobsAreSkipped()
+{
+    QVector<int> results(100);
+
+    JobGroup jobs(JobSystem::Background);
+    jobs.cancel();
+    QVERIFY(jobs.isCanceled());
+
+    for (int i = 0; i < results.size(); ++i)
+        jobs.start(new MarkJob(&results, i));
+    jobs.wait();
+
+    QCOMPARE(results.count(0), results.size());
+}
+
+void test_JobSystem::autoDelete()
+{
+    bool deleted = false;
+    DeletionJob *job = new DeletionJob(&deleted);
+    job->setAutoDelete(false);
+
+    {
+        JobGroup jobs;
+        jobs.start(job);
+    }   // waits for the job
+
+    QVERIFY(!deleted);
+    delete job;
+    QVERIFY(deleted);
+
+    deleted = false;
+    {
+        JobGroup jobs;
+        jobs.start(new DeletionJob(&deleted));
+    }
+    QVERIFY(deleted);
+}
+
+QTEST_MAIN(test_JobSystem)
+#include "test_jobsystem.moc"
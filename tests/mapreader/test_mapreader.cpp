@@ -1,9 +1,15 @@
+#include "imageutils.h"
 #include "map.h"
+#include "mapcellcache.h"
 #include "mapobject.h"
 #include "objectgroup.h"
+#include "tile.h"
 #include "tilelayer.h"
+#include "tileset.h"
 #include "mapreader.h"
+#include "mapwriter.h"
 
+#include <QBuffer>
 #include <QtTest/QtTest>
 
 using namespace Tiled;
@@ -14,6 +20,29 @@ class test_MapReader : public QObject
 
 private slots:
     void loadMap();
+
+    void layerDataRoundTrip_data();
+    void layerDataRoundTrip();
+
+    void xmlLayerData();
+
+    void infiniteMapRoundTrip_data();
+    void infiniteMapRoundTrip();
+
+    void lazyLayerDecoding_data();
+    void lazyLayerDecoding();
+
+    void sharedTilesetImages();
+    void transparentColor();
+
+    void internedPropertyNames();
+
+    void parallelImageDecoding();
+
+    void layerFilter();
+    void tileImageSizes();
+
+    void cellCache();
 };
 
 void test_MapReader::loadMap()
@@ -53,5 +82,618 @@ void test_MapReader::loadMap()
     QCOMPARE(mapObject->height(), qreal(64));
 }
 
+Q_DECLARE_METATYPE(Map::LayerDataFormat)
+
+void test_MapReader::layerDataRoundTrip_data()
+{
+    QTest::addColumn<Map::LayerDataFormat>("format");
+    QTest::addColumn<bool>("parallel");
+
+    QTest::newRow("xml") << Map::XML << false;
+    QTest::newRow("csv") << Map::CSV << false;
+    QTest::newRow("csv-parallel") << Map::CSV << true;
+    QTest::newRow("base64") << Map::Base64 << false;
+    QTest::newRow("base64-parallel") << Map::Base64 << true;
+    QTest::newRow("gzip") << Map::Base64Gzip << false;
+    QTest::newRow("zlib") << Map::Base64Zlib << false;
+    QTest::newRow("zlib-parallel") << Map::Base64Zlib << true;
+}
+
+void test_MapReader::layerDataRoundTrip()
+{
+    QFETCH(Map::LayerDataFormat, format);
+    QFETCH(bool, parallel);
+
+    // Large enough for the data to span several decoding blocks
+    Map map(Map::Orthogonal, 150, 130, 32, 32);
+    map.setLayerDataFormat(format);
+
+    Tileset *tileset = new Tileset(QLatin1String("tileset"), 32, 32);
+    for (int i = 0; i < 3; ++i)
+        tileset->addTile(QPixmap(32, 32));
+    map.addTileset(tileset);
+
+    for (int i = 0; i < 2; ++i) {
+        TileLayer *layer = new TileLayer(QLatin1String("layer"), 0, 0,
+                                         map.width(), map.height());
+        qsrand(i + 1);
+        for (int y = 0; y < layer->height(); ++y) {
+            for (int x = 0; x < layer->width(); ++x) {
+                const int value = qrand() % 8;
+                if (value < 3) {
+                    Cell cell(tileset->tileAt(value));
+                    cell.flippedHorizontally = qrand() % 2;
+                    layer->setCell(x, y, cell);
+                }
+            }
+        }
+        map.addLayer(layer);
+    }
+
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    MapWriter writer;
+    writer.setParallelLayerEncoding(parallel);
+    writer.writeMap(&map, &buffer);
+    buffer.close();
+
+    buffer.open(QIODevice::ReadOnly);
+    MapReader reader;
+    reader.setParallelLayerDecoding(parallel);
+    QScopedPointer<Map> readMap(reader.readMap(&buffer));
+
+    QVERIFY2(readMap, qPrintable(reader.errorString()));
+    QCOMPARE(readMap->layerDataFormat(), format);
+    QCOMPARE(readMap->layerCount(), map.layerCount());
+
+    for (int i = 0; i < map.layerCount(); ++i) {
+        const TileLayer *layer = map.layerAt(i)->asTileLayer();
+        const TileLayer *readLayer = readMap->layerAt(i)->asTileLayer();
+        QVERIFY(readLayer);
+
+        for (int y = 0; y < layer->height(); ++y) {
+            for (int x = 0; x < layer->width(); ++x) {
+                const Cell &cell = layer->cellAt(x, y);
+                const Cell &readCell = readLayer->cellAt(x, y);
+                QCOMPARE(readCell.isEmpty(), cell.isEmpty());
+                if (cell.isEmpty())
+                    continue;
+                QCOMPARE(readCell.tile->id(), cell.tile->id());
+                QCOMPARE(readCell.flippedHorizontally, cell.flippedHorizontally);
+            }
+        }
+    }
+
+    qDeleteAll(readMap->tilesets());
+    qDeleteAll(map.tilesets());
+}
+
+static Map *readMapData(const QByteArray &data, QString *error)
+{
+    QByteArray copy = data;
+    QBuffer buffer(&copy);
+    buffer.open(QIODevice::ReadOnly);
+
+    MapReader reader;
+    Map *map = reader.readMap(&buffer);
+    *error = reader.errorString();
+    return map;
+}
+
+/**
+ * Checks the handling of <tile> elements that the writer doesn't produce.
+ */
+void test_MapReader::xmlLayerData()
+{
+    Map map(Map::Orthogonal, 4, 3, 32, 32);
+    map.setLayerDataFormat(Map::XML);
+
+    Tileset *tileset = new Tileset(QLatin1String("tileset"), 32, 32);
+    for (int i = 0; i < 2; ++i)
+        tileset->addTile(QPixmap(32, 32));
+    map.addTileset(tileset);
+
+    TileLayer *layer = new TileLayer(QLatin1String("layer"), 0, 0,
+                                     map.width(), map.height());
+    for (int y = 0; y < layer->height(); ++y)
+        for (int x = 0; x < layer->width(); ++x)
+            layer->setCell(x, y, Cell(tileset->tileAt((x + y) % 2)));
+    map.addLayer(layer);
+
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    MapWriter writer;
+    writer.writeMap(&map, &buffer);
+    buffer.close();
+
+    // Tiles without a valid gid are left empty
+    QByteArray edited = data;
+    const QByteArray firstTile("<tile gid=\"1\"/>");
+    const QByteArray secondTile("<tile gid=\"2\"/>");
+    const int first = edited.indexOf(firstTile);
+    QVERIFY(first != -1);
+    edited.replace(first, firstTile.size(), "<tile/>");
+    const int second = edited.indexOf(secondTile, first);
+    QVERIFY(second != -1);
+    edited.replace(second, secondTile.size(), "<tile gid=\"2x\"/>");
+
+    QString error;
+    QScopedPointer<Map> readMap(readMapData(edited, &error));
+    QVERIFY2(readMap, qPrintable(error));
+
+    const TileLayer *readLayer = readMap->layerAt(0)->asTileLayer();
+    QVERIFY(readLayer->cellAt(0, 0).isEmpty());
+    QVERIFY(readLayer->cellAt(1, 0).isEmpty());
+    for (int y = 0; y < layer->height(); ++y) {
+        for (int x = y == 0 ? 2 : 0; x < layer->width(); ++x) {
+            const Cell &readCell = readLayer->cellAt(x, y);
+            QVERIFY(!readCell.isEmpty());
+            QCOMPARE(readCell.tile->id(), layer->cellAt(x, y).tile->id());
+        }
+    }
+    qDeleteAll(readMap->tilesets());
+
+    // More tiles than fit in the layer are an error
+    QByteArray tooMany = data;
+    tooMany.replace("</data>", "<tile gid=\"1\"/></data>");
+    readMap.reset(readMapData(tooMany, &error));
+    QVERIFY(!readMap);
+    QVERIFY(error.contains(QLatin1String("Too many")));
+
+    qDeleteAll(map.tilesets());
+}
+
+void test_MapReader::infiniteMapRoundTrip_data()
+{
+    QTest::addColumn<Map::LayerDataFormat>("format");
+
+    QTest::newRow("xml") << Map::XML;
+    QTest::newRow("csv") << Map::CSV;
+    QTest::newRow("zlib") << Map::Base64Zlib;
+}
+
+void test_MapReader::infiniteMapRoundTrip()
+{
+    QFETCH(Map::LayerDataFormat, format);
+
+    Map map(Map::Orthogonal, 1000, 800, 32, 32);
+    map.setLayerDataFormat(format);
+    map.setInfinite(true);
+
+    Tileset *tileset = new Tileset(QLatin1String("tileset"), 32, 32);
+    for (int i = 0; i < 3; ++i)
+        tileset->addTile(QPixmap(32, 32));
+    map.addTileset(tileset);
+
+    // A few areas far apart from each other, like in a large world
+    TileLayer *layer = new TileLayer(QLatin1String("layer"), 0, 0,
+                                     map.width(), map.height());
+    for (int i = 0; i < 40; ++i) {
+        layer->setCell(10 + i, 5, Cell(tileset->tileAt(i % 3)));
+        layer->setCell(990, 700 + i, Cell(tileset->tileAt(1)));
+    }
+    layer->setCell(999, 799, Cell(tileset->tileAt(2)));
+    map.addLayer(layer);
+
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    MapWriter writer;
+    writer.writeMap(&map, &buffer);
+    buffer.close();
+
+    QCOMPARE(data.count("<chunk "), layer->chunkRects().size());
+
+    buffer.open(QIODevice::ReadOnly);
+    MapReader reader;
+    QScopedPointer<Map> readMap(reader.readMap(&buffer));
+
+    QVERIFY2(readMap, qPrintable(reader.errorString()));
+    QVERIFY(readMap->isInfinite());
+
+    const TileLayer *readLayer = readMap->layerAt(0)->asTileLayer();
+    QVERIFY(readLayer);
+    QCOMPARE(readLayer->chunkRects(), layer->chunkRects());
+
+    for (int y = 0; y < layer->height(); ++y) {
+        for (int x = 0; x < layer->width(); ++x) {
+            const Cell &cell = layer->cellAt(x, y);
+            const Cell &readCell = readLayer->cellAt(x, y);
+            QCOMPARE(readCell.isEmpty(), cell.isEmpty());
+            if (!cell.isEmpty())
+                QCOMPARE(readCell.tile->id(), cell.tile->id());
+        }
+    }
+
+    qDeleteAll(readMap->tilesets());
+    qDeleteAll(map.tilesets());
+}
+
+/**
+ * Compares the tiles of two layers that use different tilesets.
+ */
+static void compareCells(const TileLayer *layer, const TileLayer *expected)
+{
+    QVERIFY(layer);
+    QCOMPARE(layer->size(), expected->size());
+
+    for (int y = 0; y < expected->height(); ++y) {
+        for (int x = 0; x < expected->width(); ++x) {
+            const Cell &cell = expected->cellAt(x, y);
+            const Cell &readCell = layer->cellAt(x, y);
+            QCOMPARE(readCell.isEmpty(), cell.isEmpty());
+            if (!cell.isEmpty())
+                QCOMPARE(readCell.tile->id(), cell.tile->id());
+        }
+    }
+}
+
+void test_MapReader::lazyLayerDecoding_data()
+{
+    QTest::addColumn<Map::LayerDataFormat>("format");
+
+    QTest::newRow("csv") << Map::CSV;
+    QTest::newRow("base64") << Map::Base64;
+    QTest::newRow("zlib") << Map::Base64Zlib;
+}
+
+void test_MapReader::lazyLayerDecoding()
+{
+    QFETCH(Map::LayerDataFormat, format);
+
+    Map map(Map::Orthogonal, 40, 30, 32, 32);
+    map.setLayerDataFormat(format);
+
+    Tileset *tileset = new Tileset(QLatin1String("tileset"), 32, 32);
+    for (int i = 0; i < 4; ++i)
+        tileset->addTile(QPixmap(32, 32));
+    map.addTileset(tileset);
+
+    TileLayer *visible = new TileLayer(QLatin1String("visible"), 0, 0, 40, 30);
+    TileLayer *hidden = new TileLayer(QLatin1String("hidden"), 0, 0, 40, 30);
+    hidden->setVisible(false);
+    for (int y = 0; y < 30; ++y) {
+        for (int x = 0; x < 40; ++x) {
+            visible->setCell(x, y, Cell(tileset->tileAt((x + y) % 4)));
+            if ((x * y) % 3 == 0)
+                hidden->setCell(x, y, Cell(tileset->tileAt(x % 4)));
+        }
+    }
+    map.addLayer(visible);
+    map.addLayer(hidden);
+
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    MapWriter writer;
+    writer.writeMap(&map, &buffer);
+    buffer.close();
+
+    buffer.open(QIODevice::ReadOnly);
+    MapReader reader;
+    reader.setLazyLayerDecoding(true);
+    QScopedPointer<Map> readMap(reader.readMap(&buffer));
+    QVERIFY2(readMap, qPrintable(reader.errorString()));
+
+    TileLayer *readVisible = readMap->layerAt(0)->asTileLayer();
+    TileLayer *readHidden = readMap->layerAt(1)->asTileLayer();
+    QVERIFY(readVisible->isLoaded());
+    QVERIFY(!readHidden->isLoaded());
+
+    // Saving the untouched layer writes back the data as it was read
+    QByteArray rewritten;
+    QBuffer rewriteBuffer(&rewritten);
+    rewriteBuffer.open(QIODevice::WriteOnly);
+    writer.writeMap(readMap.data(), &rewriteBuffer);
+    rewriteBuffer.close();
+    QVERIFY(!readHidden->isLoaded());
+
+    rewriteBuffer.open(QIODevice::ReadOnly);
+    MapReader rereader;
+    QScopedPointer<Map> rereadMap(rereader.readMap(&rewriteBuffer));
+    QVERIFY2(rereadMap, qPrintable(rereader.errorString()));
+    compareCells(rereadMap->layerAt(1)->asTileLayer(), hidden);
+
+    // Clones get their own loader
+    QScopedPointer<Layer> clone(readHidden->clone());
+    QVERIFY(!clone->asTileLayer()->isLoaded());
+
+    // Reading a cell decodes the layer
+    QVERIFY(!readHidden->cellAt(0, 0).isEmpty());
+    QVERIFY(readHidden->isLoaded());
+    compareCells(readHidden, hidden);
+
+    QVERIFY(clone->asTileLayer()->computeDiffRegion(readHidden).isEmpty());
+
+    qDeleteAll(rereadMap->tilesets());
+    qDeleteAll(readMap->tilesets());
+    qDeleteAll(map.tilesets());
+}
+
+/**
+ * Checks that tilesets loaded from the same image share their pixmaps, as
+ * long as they use the same transparent color.
+ */
+void test_MapReader::sharedTilesetImages()
+{
+    QImage image(64, 64, QImage::Format_ARGB32);
+    image.fill(qRgba(255, 0, 255, 255));
+
+    Tileset first(QLatin1String("first"), 32, 32);
+    Tileset second(QLatin1String("second"), 32, 32);
+    Tileset masked(QLatin1String("masked"), 32, 32);
+    masked.setTransparentColor(QColor(255, 0, 255));
+
+    QVERIFY(first.loadFromImage(image, QLatin1String("image.png")));
+    QVERIFY(second.loadFromImage(image, QLatin1String("image.png")));
+    QVERIFY(masked.loadFromImage(image, QLatin1String("image.png")));
+
+    QCOMPARE(second.image().cacheKey(), first.image().cacheKey());
+    QCOMPARE(second.tileCount(), 4);
+    QVERIFY(masked.image().cacheKey() != first.image().cacheKey());
+}
+
+/**
+ * Checks that the transparent color is turned into alpha, in the
+ * premultiplied format used for drawing.
+ */
+void test_MapReader::transparentColor()
+{
+    // An odd width, to cover the pixels that don't fill a vector
+    QImage image(7, 2, QImage::Format_RGB32);
+    image.fill(qRgb(255, 0, 255));
+    image.setPixel(3, 0, qRgb(10, 20, 30));
+    image.setPixel(6, 1, qRgb(10, 20, 30));
+
+    const QImage result = premultipliedImage(image, QColor(255, 0, 255));
+    QCOMPARE(result.format(), QImage::Format_ARGB32_Premultiplied);
+
+    for (int y = 0; y < image.height(); ++y) {
+        for (int x = 0; x < image.width(); ++x) {
+            const QRgb expected = image.pixel(x, y) == qRgb(255, 0, 255) ?
+                        0 : image.pixel(x, y);
+            QCOMPARE(result.pixel(x, y), expected);
+        }
+    }
+}
+
+/**
+ * Checks that the objects of a map that was read share their property names.
+ */
+void test_MapReader::internedPropertyNames()
+{
+    Map map(Map::Orthogonal, 10, 10, 32, 32);
+    ObjectGroup *objectGroup = new ObjectGroup(QLatin1String("objects"),
+                                               0, 0, 10, 10);
+    for (int i = 0; i < 2; ++i) {
+        MapObject *object = new MapObject;
+        object->setProperty(QLatin1String("kind"), QString::number(i));
+        objectGroup->addObject(object);
+    }
+    map.addLayer(objectGroup);
+
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    MapWriter writer;
+    writer.writeMap(&map, &buffer);
+    buffer.close();
+
+    buffer.open(QIODevice::ReadOnly);
+    MapReader reader;
+    QScopedPointer<Map> readMap(reader.readMap(&buffer));
+    QVERIFY2(readMap, qPrintable(reader.errorString()));
+
+    const ObjectGroup *readGroup = readMap->layerAt(0)->asObjectGroup();
+    QVERIFY(readGroup);
+    QCOMPARE(readGroup->objectCount(), 2);
+
+    const QString first = readGroup->objectAt(0)->properties().constBegin().key();
+    const QString second = readGroup->objectAt(1)->properties().constBegin().key();
+    QCOMPARE(first, QString(QLatin1String("kind")));
+    QCOMPARE(second.constData(), first.constData());
+}
+
+/**
+ * Checks that a tileset image decoded in the background ends up in the tiles,
+ * and that the cells referring to the tiles are read correctly meanwhile.
+ */
+void test_MapReader::parallelImageDecoding()
+{
+    QImage image(64, 32, QImage::Format_ARGB32);
+    image.fill(qRgba(0, 128, 255, 255));
+
+    const QString imageFileName =
+            QDir::temp().filePath(QLatin1String("test_mapreader_tiles.png"));
+    QVERIFY(image.save(imageFileName));
+
+    const QString tmx = QString(QLatin1String(
+            "<map version=\"1.0\" orientation=\"orthogonal\""
+            " width=\"2\" height=\"1\" tilewidth=\"32\" tileheight=\"32\">"
+            " <tileset firstgid=\"1\" name=\"tiles\""
+            "  tilewidth=\"32\" tileheight=\"32\">"
+            "  <image source=\"%1\" width=\"64\" height=\"32\"/>"
+            " </tileset>"
+            " <layer name=\"layer\" width=\"2\" height=\"1\">"
+            "  <data encoding=\"csv\">2,1</data>"
+            " </layer>"
+            "</map>")).arg(imageFileName);
+
+    QByteArray data = tmx.toUtf8();
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+
+    MapReader reader;
+    reader.setParallelImageDecoding(true);
+    QScopedPointer<Map> map(reader.readMap(&buffer));
+    QFile::remove(imageFileName);
+    QVERIFY2(map, qPrintable(reader.errorString()));
+
+    Tileset *tileset = map->tilesetAt(0);
+    QCOMPARE(tileset->tileCount(), 2);
+    QCOMPARE(tileset->imageWidth(), 64);
+    QVERIFY(!tileset->tileAt(1)->image().isNull());
+
+    const TileLayer *layer = map->layerAt(0)->asTileLayer();
+    QCOMPARE(layer->cellAt(0, 0).tile, tileset->tileAt(1));
+    QCOMPARE(layer->cellAt(1, 0).tile, tileset->tileAt(0));
+
+    qDeleteAll(map->tilesets());
+}
+
+/**
+ * Checks that only the layers in the layer filter are read, and that the
+ * tiles are set up from the image size when images aren't loaded.
+ */
+void test_MapReader::layerFilter()
+{
+    const QString tmx = QLatin1String(
+            "<map version=\"1.0\" orientation=\"orthogonal\""
+            " width=\"2\" height=\"1\" tilewidth=\"32\" tileheight=\"32\">"
+            " <tileset firstgid=\"1\" name=\"tiles\""
+            "  tilewidth=\"32\" tileheight=\"32\">"
+            "  <image source=\"missing.png\" width=\"64\" height=\"32\"/>"
+            " </tileset>"
+            " <layer name=\"ground\" width=\"2\" height=\"1\">"
+            "  <data encoding=\"base64\">corrupt</data>"
+            " </layer>"
+            " <layer name=\"collision\" width=\"2\" height=\"1\">"
+            "  <data encoding=\"csv\">2,1</data>"
+            " </layer>"
+            " <objectgroup name=\"spawns\">"
+            "  <object x=\"0\" y=\"0\"/>"
+            " </objectgroup>"
+            " <imagelayer name=\"sky\">"
+            "  <image source=\"missing.png\"/>"
+            " </imagelayer>"
+            "</map>");
+
+    QByteArray data = tmx.toUtf8();
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+
+    MapReader reader;
+    reader.setLayerFilter(QStringList() << QLatin1String("collision")
+                                        << QLatin1String("spawns"));
+    reader.setImageLoading(false);
+    QScopedPointer<Map> map(reader.readMap(&buffer));
+    QVERIFY2(map, qPrintable(reader.errorString()));
+
+    QCOMPARE(map->layerCount(), 2);
+    QCOMPARE(map->layerAt(0)->name(), QLatin1String("collision"));
+    QCOMPARE(map->layerAt(1)->name(), QLatin1String("spawns"));
+
+    Tileset *tileset = map->tilesetAt(0);
+    QCOMPARE(tileset->tileCount(), 2);
+    QVERIFY(tileset->tileAt(0)->image().isNull());
+
+    const TileLayer *layer = map->layerAt(0)->asTileLayer();
+    QCOMPARE(layer->cellAt(0, 0).tile, tileset->tileAt(1));
+    QCOMPARE(layer->cellAt(1, 0).tile, tileset->tileAt(0));
+
+    qDeleteAll(map->tilesets());
+}
+
+/**
+ * Checks that the tiles with their own image get the size stored in the map
+ * when images aren't loaded.
+ */
+void test_MapReader::tileImageSizes()
+{
+    const QString tmx = QLatin1String(
+            "<map version=\"1.0\" orientation=\"orthogonal\""
+            " width=\"1\" height=\"1\" tilewidth=\"32\" tileheight=\"32\">"
+            " <tileset firstgid=\"1\" name=\"collection\""
+            "  tilewidth=\"48\" tileheight=\"64\">"
+            "  <tile id=\"0\">"
+            "   <image source=\"missing.png\" width=\"16\" height=\"24\"/>"
+            "  </tile>"
+            "  <tile id=\"1\">"
+            "   <image source=\"missing.png\" width=\"48\" height=\"64\"/>"
+            "  </tile>"
+            " </tileset>"
+            "</map>");
+
+    QByteArray data = tmx.toUtf8();
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+
+    MapReader reader;
+    reader.setImageLoading(false);
+    QScopedPointer<Map> map(reader.readMap(&buffer));
+    QVERIFY2(map, qPrintable(reader.errorString()));
+
+    Tileset *tileset = map->tilesetAt(0);
+    QCOMPARE(tileset->tileCount(), 2);
+    QCOMPARE(tileset->tileAt(0)->size(), QSize(16, 24));
+    QCOMPARE(tileset->tileAt(1)->size(), QSize(48, 64));
+    QVERIFY(tileset->tileAt(1)->image().isNull());
+    QCOMPARE(tileset->tileSize(), QSize(48, 64));
+
+    qDeleteAll(map->tilesets());
+}
+
+/**
+ * Checks that the cells of a saved map are cached, and that the cache is
+ * no longer used once the map file changes.
+ */
+void test_MapReader::cellCache()
+{
+    const QString cacheDirectory =
+            QDir::temp().filePath(QLatin1String("test_mapreader_cells"));
+    const QString fileName =
+            QDir::temp().filePath(QLatin1String("test_mapreader_cells.tmx"));
+    MapCellCache::setDirectory(cacheDirectory);
+
+    Map map(Map::Orthogonal, 40, 30, 32, 32);
+    map.setLayerDataFormat(Map::CSV);
+
+    Tileset *tileset = new Tileset(QLatin1String("tileset"), 32, 32);
+    for (int i = 0; i < 3; ++i)
+        tileset->addTile(QPixmap(32, 32));
+    map.addTileset(tileset);
+
+    TileLayer *layer = new TileLayer(QLatin1String("layer"), 0, 0,
+                                     map.width(), map.height());
+    for (int y = 0; y < layer->height(); ++y) {
+        for (int x = 0; x < layer->width(); ++x) {
+            if ((x + y) % 3 == 0)
+                continue;
+            Cell cell(tileset->tileAt((x * y) % 3));
+            cell.flippedVertically = x % 2;
+            layer->setCell(x, y, cell);
+        }
+    }
+    map.addLayer(layer);
+
+    MapWriter writer;
+    QVERIFY2(writer.writeMap(&map, fileName), qPrintable(writer.errorString()));
+    QVERIFY(MapCellCache(fileName).isValid());
+
+    MapReader reader;
+    QScopedPointer<Map> readMap(reader.readMap(fileName));
+    QVERIFY2(readMap, qPrintable(reader.errorString()));
+    QCOMPARE(readMap->layerDataFormat(), Map::CSV);
+    compareCells(readMap->layerAt(0)->asTileLayer(), layer);
+    qDeleteAll(readMap->tilesets());
+
+    // Changing the file invalidates the entry
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::Append));
+    file.write("\n");
+    file.close();
+    QVERIFY(!MapCellCache(fileName).isValid());
+
+    MapCellCache::setDirectory(QString());
+    QFile::remove(fileName);
+    foreach (const QString &entry, QDir(cacheDirectory).entryList(QDir::Files))
+        QFile::remove(QDir(cacheDirectory).filePath(entry));
+    QDir().rmdir(cacheDirectory);
+
+    qDeleteAll(map.tilesets());
+}
+
 QTEST_MAIN(test_MapReader)
 #include "test_mapreader.moc"
@@ -0,0 +1,435 @@
+#include "hexagonalrenderer.h"
+#include "isometricrenderer.h"
+#include "map.h"
+#include "mapreader.h"
+#include "orthogonalrenderer.h"
+#include "staggeredrenderer.h"
+#include "tilelayer.h"
+#include "tileset.h"
+
+#include <QElapsedTimer>
+#include <QPainter>
+#include <QThread>
+#include <QtTest/QtTest>
+
+using namespace Tiled;
+
+/**
+ * Benchmarks drawing the tile layers of generated and example maps, for each
+ * orientation, at several zoom levels, viewport sizes and render orders.
+ */
+class test_MapRenderer : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void drawTileLayers_data();
+    void drawTileLayers();
+
+    void convertCoordinateArrays_data();
+    void convertCoordinateArrays();
+
+    void hexagonalScreenToTileCoords_data();
+    void hexagonalScreenToTileCoords();
+
+    void renderInThread();
+
+    void drawFlippedCells();
+
+private:
+    Map *createMap(Map::Orientation orientation) const;
+    static MapRenderer *createRenderer(const Map *map);
+
+    Tileset *mTileset;
+};
+
+Q_DECLARE_METATYPE(Map::Orientation)
+Q_DECLARE_METATYPE(Map::RenderOrder)
+Q_DECLARE_METATYPE(Map::StaggerAxis)
+Q_DECLARE_METATYPE(Map::StaggerIndex)
+
+static const int MapSize = 256;
+static const int LayerCount = 2;
+
+void test_MapRenderer::initTestCase()
+{
+    QImage image(256, 256, QImage::Format_ARGB32);
+    for (int y = 0; y < image.height(); ++y)
+        for (int x = 0; x < image.width(); ++x)
+            image.setPixel(x, y, qRgba(x, y, (x ^ y) & 0xFF, 0xFF));
+
+    mTileset = new Tileset(QLatin1String("tileset"), 64, 64);
+    QVERIFY(mTileset->loadFromImage(image, QLatin1String("generated.png")));
+
+    CellRenderer::setCollectStatistics(true);
+}
+
+void test_MapRenderer::cleanupTestCase()
+{
+    CellRenderer::setCollectStatistics(false);
+
+    delete mTileset;
+    mTileset = 0;
+}
+
+Map *test_MapRenderer::createMap(Map::Orientation orientation) const
+{
+    const int tileHeight = orientation == Map::Orthogonal ? 64 : 32;
+    Map *map = new Map(orientation, MapSize, MapSize, 64, tileHeight);
+    map->setHexSideLength(orientation == Map::Hexagonal ? 16 : 0);
+    map->addTileset(mTileset);
+
+    qsrand(orientation + 1);
+    for (int i = 0; i < LayerCount; ++i) {
+        TileLayer *layer = new TileLayer(QString(QLatin1String("layer%1")).arg(i),
+                                         0, 0, MapSize, MapSize);
+
+        // Leave the second layer mostly empty, like a decoration layer
+        for (int y = 0; y < MapSize; ++y) {
+            for (int x = 0; x < MapSize; ++x) {
+                if (i > 0 && qrand() % 4 != 0)
+                    continue;
+                const int id = qrand() % mTileset->tileCount();
+                layer->setCell(x, y, Cell(mTileset->tileAt(id)));
+            }
+        }
+
+        map->addLayer(layer);
+    }
+
+    return map;
+}
+
+MapRenderer *test_MapRenderer::createRenderer(const Map *map)
+{
+    switch (map->orientation()) {
+    case Map::Isometric:
+        return new IsometricRenderer(map);
+    case Map::Staggered:
+        return new StaggeredRenderer(map);
+    case Map::Hexagonal:
+        return new HexagonalRenderer(map);
+    default:
+        return new OrthogonalRenderer(map);
+    }
+}
+
+void test_MapRenderer::drawTileLayers_data()
+{
+    QTest::addColumn<QString>("fileName");
+    QTest::addColumn<Map::Orientation>("orientation");
+    QTest::addColumn<Map::RenderOrder>("renderOrder");
+    QTest::addColumn<qreal>("zoom");
+    QTest::addColumn<QSize>("viewport");
+
+    const Map::Orientation orientations[] = {
+        Map::Orthogonal, Map::Isometric, Map::Staggered, Map::Hexagonal
+    };
+    const Map::RenderOrder renderOrders[] = {
+        Map::RightDown, Map::RightUp, Map::LeftDown, Map::LeftUp
+    };
+    const qreal zooms[] = { 0.25, 0.5, 2 };
+
+    const QSize large(1920, 1080);
+    const QSize small(800, 600);
+
+    for (int o = 0; o < 4; ++o) {
+        const Map::Orientation orientation = orientations[o];
+        const QString name = orientationToString(orientation);
+
+        for (int r = 0; r < 4; ++r) {
+            const Map::RenderOrder renderOrder = renderOrders[r];
+            const QString row = name + QLatin1String(", ") +
+                    renderOrderToString(renderOrder);
+            QTest::newRow(qPrintable(row))
+                    << QString() << orientation << renderOrder << qreal(1) << large;
+        }
+
+        for (int z = 0; z < 3; ++z) {
+            const QString row = QString(QLatin1String("%1, zoom %2"))
+                    .arg(name).arg(zooms[z]);
+            QTest::newRow(qPrintable(row))
+                    << QString() << orientation << Map::RightDown << zooms[z] << large;
+        }
+
+        const QString row = name + QLatin1String(", 800x600");
+        QTest::newRow(qPrintable(row))
+                << QString() << orientation << Map::RightDown << qreal(1) << small;
+    }
+
+    const char *examples[] = {
+        "desert.tmx",
+        "sewers.tmx",
+        "isometric_grass_and_water.tmx",
+        "hexagonal-mini.tmx",
+        "perspective_walls.tmx"
+    };
+
+    for (int i = 0; i < 5; ++i) {
+        const QString fileName = QLatin1String("../../examples/") +
+                QLatin1String(examples[i]);
+        if (!QFile::exists(fileName))
+            continue;
+
+        for (int z = -1; z < 3; ++z) {
+            const qreal zoom = z == -1 ? 1 : zooms[z];
+            const QString row = QString(QLatin1String("%1, zoom %2"))
+                    .arg(QLatin1String(examples[i])).arg(zoom);
+            QTest::newRow(qPrintable(row))
+                    << fileName << Map::Orthogonal << Map::RightDown << zoom << large;
+        }
+    }
+}
+
+void test_MapRenderer::drawTileLayers()
+{
+    QFETCH(QString, fileName);
+    QFETCH(Map::Orientation, orientation);
+    QFETCH(Map::RenderOrder, renderOrder);
+    QFETCH(qreal, zoom);
+    QFETCH(QSize, viewport);
+
+    QScopedPointer<Map> map;
+    if (fileName.isEmpty()) {
+        map.reset(createMap(orientation));
+        map->setRenderOrder(renderOrder);
+    } else {
+        MapReader reader;
+        map.reset(reader.readMap(fileName));
+        QVERIFY2(map, qPrintable(reader.errorString()));
+    }
+
+    QScopedPointer<MapRenderer> renderer(createRenderer(map.data()));
+
+    // Look at the center of the map
+    const QSizeF exposedSize(viewport.width() / zoom, viewport.height() / zoom);
+    const QSize mapSize = renderer->mapSize();
+    const QRectF exposed(QPointF((mapSize.width() - exposedSize.width()) / 2,
+                                 (mapSize.height() - exposedSize.height()) / 2),
+                         exposedSize);
+
+    QImage image(viewport, QImage::Format_ARGB32_Premultiplied);
+
+    qint64 elapsed = 0;
+    int frames = 0;
+    CellRenderer::resetStatistics();
+
+    QBENCHMARK {
+        image.fill(0);
+
+        QElapsedTimer timer;
+        timer.start();
+
+        QPainter painter(&image);
+        painter.scale(zoom, zoom);
+        painter.translate(-exposed.topLeft());
+
+        foreach (Layer *layer, map->layers()) {
+            if (const TileLayer *tileLayer = layer->asTileLayer())
+                if (tileLayer->isVisible())
+                    renderer->drawTileLayer(&painter, tileLayer, exposed);
+        }
+
+        painter.end();
+
+        elapsed += timer.elapsed();
+        ++frames;
+    }
+
+    if (frames > 0) {
+        qDebug("%.2f ms/frame, %d fragments/frame, %d draw calls/frame",
+               qreal(elapsed) / frames,
+               CellRenderer::fragmentCount() / frames,
+               CellRenderer::drawCallCount() / frames);
+    }
+
+    // The generated maps share the tileset of this test
+    if (!fileName.isEmpty())
+        qDeleteAll(map->tilesets());
+}
+
+void test_MapRenderer::convertCoordinateArrays_data()
+{
+    QTest::addColumn<Map::Orientation>("orientation");
+
+    QTest::newRow("orthogonal") << Map::Orthogonal;
+    QTest::newRow("isometric") << Map::Isometric;
+    QTest::newRow("staggered") << Map::Staggered;
+    QTest::newRow("hexagonal") << Map::Hexagonal;
+}
+
+/**
+ * Checks that converting an array of points gives the same results as
+ * converting each point on its own.
+ */
+void test_MapRenderer::convertCoordinateArrays()
+{
+    QFETCH(Map::Orientation, orientation);
+
+    Map map(orientation, 30, 20, 64, 32);
+    map.setHexSideLength(orientation == Map::Hexagonal ? 16 : 0);
+    QScopedPointer<MapRenderer> renderer(createRenderer(&map));
+
+    QPolygonF points;
+    for (int i = 0; i < 100; ++i)
+        points << QPointF(i * 13.7 - 200, i * 7.3 - 100);
+
+    QPolygonF converted = renderer->pixelToScreenCoords(points);
+    for (int i = 0; i < points.size(); ++i)
+        QCOMPARE(converted.at(i), renderer->pixelToScreenCoords(points.at(i)));
+
+    converted = renderer->screenToPixelCoords(points);
+    for (int i = 0; i < points.size(); ++i)
+        QCOMPARE(converted.at(i), renderer->screenToPixelCoords(points.at(i)));
+
+    converted = points;
+    renderer->tileToScreenCoords(converted.data(), converted.size());
+    for (int i = 0; i < points.size(); ++i)
+        QCOMPARE(converted.at(i), renderer->tileToScreenCoords(points.at(i)));
+
+    converted = points;
+    renderer->screenToTileCoords(converted.data(), converted.size());
+    for (int i = 0; i < points.size(); ++i)
+        QCOMPARE(converted.at(i), renderer->screenToTileCoords(points.at(i)));
+}
+
+void test_MapRenderer::hexagonalScreenToTileCoords_data()
+{
+    QTest::addColumn<Map::StaggerAxis>("staggerAxis");
+    QTest::addColumn<Map::StaggerIndex>("staggerIndex");
+
+    QTest::newRow("x, odd") << Map::StaggerX << Map::StaggerOdd;
+    QTest::newRow("x, even") << Map::StaggerX << Map::StaggerEven;
+    QTest::newRow("y, odd") << Map::StaggerY << Map::StaggerOdd;
+    QTest::newRow("y, even") << Map::StaggerY << Map::StaggerEven;
+}
+
+/**
+ * Checks that points around the center of each hexagon map back to its tile.
+ */
+void test_MapRenderer::hexagonalScreenToTileCoords()
+{
+    QFETCH(Map::StaggerAxis, staggerAxis);
+    QFETCH(Map::StaggerIndex, staggerIndex);
+
+    Map map(Map::Hexagonal, 10, 10, 32, 28);
+    map.setHexSideLength(12);
+    map.setStaggerAxis(staggerAxis);
+    map.setStaggerIndex(staggerIndex);
+    HexagonalRenderer renderer(&map);
+
+    const QPointF offsets[] = {
+        QPointF(16, 14), QPointF(10, 14), QPointF(22, 14),
+        QPointF(16, 6), QPointF(16, 22)
+    };
+
+    for (int y = 0; y < map.height(); ++y) {
+        for (int x = 0; x < map.width(); ++x) {
+            const QPointF topLeft = renderer.tileToScreenCoords(x, y);
+            for (int i = 0; i < 5; ++i) {
+                const QPoint tile = renderer.screenToTileCoords(topLeft + offsets[i]).toPoint();
+                QCOMPARE(tile, QPoint(x, y));
+            }
+        }
+    }
+}
+
+namespace {
+
+/**
+ * Draws the tile layers of a map to an image.
+ */
+void drawMap(const MapRenderer *renderer, const Map *map, QImage *image)
+{
+    image->fill(0);
+
+    QPainter painter(image);
+    foreach (Layer *layer, map->layers())
+        if (const TileLayer *tileLayer = layer->asTileLayer())
+            renderer->drawTileLayer(&painter, tileLayer, QRectF(image->rect()));
+}
+
+class RenderThread : public QThread
+{
+public:
+    RenderThread(const MapRenderer *renderer, const Map *map, QImage *image)
+        : mRenderer(renderer)
+        , mMap(map)
+        , mImage(image)
+    {}
+
+protected:
+    void run() { drawMap(mRenderer, mMap, mImage); }
+
+private:
+    const MapRenderer *mRenderer;
+    const Map *mMap;
+    QImage *mImage;
+};
+
+} // anonymous namespace
+
+/**
+ * Checks that rendering to an image in a worker thread, which can't use
+ * pixmaps, gives the same result as rendering on the GUI thread.
+ */
+void test_MapRenderer::renderInThread()
+{
+    QScopedPointer<Map> map(createMap(Map::Orthogonal));
+    QScopedPointer<MapRenderer> renderer(createRenderer(map.data()));
+
+    QImage expected(512, 512, QImage::Format_ARGB32_Premultiplied);
+    drawMap(renderer.data(), map.data(), &expected);
+
+    QImage image(512, 512, QImage::Format_ARGB32_Premultiplied);
+    RenderThread thread(renderer.data(), map.data(), &image);
+    thread.start();
+    QVERIFY(thread.wait(10000));
+
+    QCOMPARE(image, expected);
+}
+
+/**
+ * Checks that drawing flipped cells from the flipped copies of the tileset
+ * image gives the same result as drawing them transformed.
+ */
+void test_MapRenderer::drawFlippedCells()
+{
+    Map map(Map::Orthogonal, 8, 8, 64, 64);
+    map.addTileset(mTileset);
+
+    TileLayer *layer = new TileLayer(QLatin1String("layer"), 0, 0, 8, 8);
+    for (int y = 0; y < 8; ++y) {
+        for (int x = 0; x < 8; ++x) {
+            const int flags = (x + y * 8) % 8;
+            Cell cell(mTileset->tileAt((x + y) % mTileset->tileCount()));
+            cell.flippedHorizontally = flags & 1;
+            cell.flippedVertically = flags & 2;
+            cell.flippedAntiDiagonally = flags & 4;
+            layer->setCell(x, y, cell);
+        }
+    }
+    map.addLayer(layer);
+
+    QScopedPointer<MapRenderer> renderer(createRenderer(&map));
+
+    CellRenderer::setFlippedPixmapsEnabled(false);
+    QImage expected(512, 512, QImage::Format_ARGB32_Premultiplied);
+    drawMap(renderer.data(), &map, &expected);
+
+    CellRenderer::setFlippedPixmapsEnabled(true);
+    CellRenderer::resetStatistics();
+    QImage image(512, 512, QImage::Format_ARGB32_Premultiplied);
+    drawMap(renderer.data(), &map, &image);
+
+    QCOMPARE(image, expected);
+
+    // One call for the unflipped cells and one for each kind of flip
+    QVERIFY(CellRenderer::drawCallCount() < map.width() * map.height());
+}
+
+QTEST_MAIN(test_MapRenderer)
+#include "test_maprenderer.moc"
@@ -0,0 +1,91 @@
+#include "numberutils.h"
+
+#include <QtTest/QtTest>
+
+using namespace Tiled;
+
+class test_NumberUtils : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void matchesQStringNumber_data();
+    void matchesQStringNumber();
+    void randomValues();
+    void appendNumber();
+};
+
+void test_NumberUtils::matchesQStringNumber_data()
+{
+    QTest::addColumn<double>("value");
+    QTest::addColumn<int>("precision");
+
+    const double values[] = {
+        0.0, -0.0, 1.0, -1.0, 12.5, 0.1, 0.3, 1.1, 0.1 + 0.2, 1.0 / 3.0,
+        0.0001, 0.00009999, 0.000123456, 123456.0, 999999.0, 999999.5,
+        999999.9999999, 1000000.0, 1234567.0, -32.75, 1e-10, 1e20,
+        4294967296.0, 3.14159265358979
+    };
+    const int precisions[] = { 6, 15 };
+
+    for (int p = 0; p < 2; ++p) {
+        for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i) {
+            const QByteArray name = QByteArray::number(values[i], 'g', 17) +
+                    " @" + QByteArray::number(precisions[p]);
+            QTest::newRow(name.constData()) << values[i] << precisions[p];
+        }
+    }
+}
+
+void test_NumberUtils::matchesQStringNumber()
+{
+    QFETCH(double, value);
+    QFETCH(int, precision);
+
+    char buffer[MaxNumberLength];
+    const int length = formatNumber(value, buffer, precision);
+
+    QCOMPARE(QString::fromLatin1(buffer, length),
+             QString::number(value, 'g', precision));
+}
+
+/**
+ * Checks values like the ones found in maps: whole numbers, halves and
+ * quarters, and coordinates with a few decimals.
+ */
+void test_NumberUtils::randomValues()
+{
+    qsrand(1);
+
+    for (int i = 0; i < 100000; ++i) {
+        double value;
+        switch (i % 4) {
+        case 0: value = qrand() % 20000 - 10000; break;
+        case 1: value = (qrand() % 80000) / 4.0; break;
+        case 2: value = (qrand() % 2000000 - 1000000) / 1000.0; break;
+        default: value = qrand() / double(RAND_MAX) * 1000; break;
+        }
+
+        char buffer[MaxNumberLength];
+        const int length = formatNumber(value, buffer);
+        const QString text = QString::fromLatin1(buffer, length);
+        const QString expected = QString::number(value);
+        if (text != expected)
+            QFAIL(qPrintable(QString(QLatin1String("%1 formatted as %2"))
+                             .arg(expected, text)));
+    }
+}
+
+void test_NumberUtils::appendNumber()
+{
+    QString text(QLatin1String("x="));
+    Tiled::appendNumber(text, 2.5);
+    QCOMPARE(text, QString(QLatin1String("x=2.5")));
+
+    QByteArray data("y=");
+    Tiled::appendNumber(data, -0.125);
+    QCOMPARE(data, QByteArray("y=-0.125"));
+}
+
+QTEST_MAIN(test_NumberUtils)
+#include "test_numberutils.moc"
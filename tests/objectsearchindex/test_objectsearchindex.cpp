@@ -0,0 +1,123 @@
+#include "map.h"
+#include "mapdocument.h"
+#include "mapobject.h"
+#include "mapobjectmodel.h"
+#include "objectgroup.h"
+#include "objectsearchindex.h"
+
+#include <QtTest/QtTest>
+
+using namespace Tiled;
+using namespace Tiled::Internal;
+
+class test_ObjectSearchIndex : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void words();
+    void find();
+    void followsChanges();
+    void findInManyObjects();
+};
+
+static Map *createMap(int objectCount)
+{
+    Map *map = new Map(Map::Orthogonal, 100, 100, 32, 32);
+    ObjectGroup *objectGroup = new ObjectGroup(QLatin1String("Objects"),
+                                               0, 0, 100, 100);
+
+    for (int i = 0; i < objectCount; ++i) {
+        const QString name = QString(QLatin1String("Object %1")).arg(i);
+        const QString type = i % 2 ? QLatin1String("Enemy")
+                                   : QLatin1String("Item");
+        MapObject *mapObject = new MapObject(name, type,
+                                             QPointF(i % 100, i / 100),
+                                             QSizeF(1, 1));
+        if (i % 10 == 0)
+            mapObject->setProperty(QLatin1String("loot"),
+                                   QLatin1String("Golden Key"));
+        objectGroup->addObject(mapObject);
+    }
+
+    map->addLayer(objectGroup);
+    return map;
+}
+
+void test_ObjectSearchIndex::words()
+{
+    QCOMPARE(ObjectSearchIndex::words(QLatin1String("Golden  Key-2")),
+             QStringList() << QLatin1String("golden")
+                           << QLatin1String("key")
+                           << QLatin1String("2"));
+    QVERIFY(ObjectSearchIndex::words(QLatin1String(" - ")).isEmpty());
+}
+
+void test_ObjectSearchIndex::find()
+{
+    MapDocument mapDocument(createMap(100));
+    ObjectSearchIndex *index = mapDocument.objectSearchIndex();
+
+    QCOMPARE(index->find(QLatin1String("enemy")).size(), 50);
+    QCOMPARE(index->find(QLatin1String("ENE")).size(), 50);
+    QCOMPARE(index->find(QLatin1String("gold")).size(), 10);
+    QCOMPARE(index->find(QLatin1String("loot item")).size(), 10);
+    QCOMPARE(index->find(QLatin1String("loot enemy")).size(), 0);
+    QCOMPARE(index->find(QLatin1String("dragon")).size(), 0);
+    QCOMPARE(index->find(QString()).size(), 100);
+
+    // The matches are in map order
+    const QList<MapObject*> objects = index->find(QLatin1String("gold"));
+    QCOMPARE(objects.first()->name(), QString(QLatin1String("Object 0")));
+    QCOMPARE(objects.last()->name(), QString(QLatin1String("Object 90")));
+}
+
+void test_ObjectSearchIndex::followsChanges()
+{
+    MapDocument mapDocument(createMap(20));
+    ObjectSearchIndex *index = mapDocument.objectSearchIndex();
+    QSignalSpy spy(index, SIGNAL(changed()));
+
+    QCOMPARE(index->find(QLatin1String("dragon")).size(), 0);
+
+    ObjectGroup *objectGroup = mapDocument.map()->objectGroups().first();
+    MapObject *mapObject = objectGroup->objectAt(3);
+    MapObjectModel *model = mapDocument.mapObjectModel();
+
+    model->setObjectName(mapObject, QLatin1String("Red Dragon"));
+    QCOMPARE(index->find(QLatin1String("dragon")),
+             QList<MapObject*>() << mapObject);
+    QCOMPARE(spy.count(), 1);
+
+    // Moving an object doesn't change its words
+    model->setObjectPosition(mapObject, QPointF(5, 5));
+    QCOMPARE(spy.count(), 1);
+
+    mapDocument.setProperty(mapObject, QLatin1String("hoard"),
+                            QLatin1String("treasure"));
+    QCOMPARE(index->find(QLatin1String("treasure")).size(), 1);
+
+    mapDocument.removeProperty(mapObject, QLatin1String("hoard"));
+    QCOMPARE(index->find(QLatin1String("treasure")).size(), 0);
+
+    model->removeObject(objectGroup, mapObject);
+    QCOMPARE(index->find(QLatin1String("dragon")).size(), 0);
+
+    model->insertObject(objectGroup, -1, mapObject);
+    QCOMPARE(index->find(QLatin1String("dragon")).size(), 1);
+    QCOMPARE(spy.count(), 5);
+}
+
+void test_ObjectSearchIndex::findInManyObjects()
+{
+    MapDocument mapDocument(createMap(50000));
+    ObjectSearchIndex *index = mapDocument.objectSearchIndex();
+    index->find(QString());     // builds the index
+
+    QBENCHMARK {
+        QCOMPARE(index->find(QLatin1String("gold item")).size(), 5000);
+    }
+}
+
+QTEST_MAIN(test_ObjectSearchIndex)
+#include "test_objectsearchindex.moc"
@@ -0,0 +1,160 @@
+#include "regionmask.h"
+
+#include <QtTest/QtTest>
+
+using namespace Tiled;
+
+class test_RegionMask : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void emptyMask();
+    void containsMatchesRegion();
+    void roundTrip();
+    void negativeCoordinates();
+    void combineMatchesRegion();
+    void intersected();
+    void differenceBoundingRect();
+    void differenceChunks();
+
+private:
+    static QRegion noisyRegion(const QRect &area, int seed);
+};
+
+/**
+ * Returns a region made up of randomly chosen cells within \a area.
+ */
+QRegion test_RegionMask::noisyRegion(const QRect &area, int seed)
+{
+    qsrand(seed);
+
+    QVector<QRect> rects;
+    for (int y = area.top(); y <= area.bottom(); ++y)
+        for (int x = area.left(); x <= area.right(); ++x)
+            if (qrand() % 3 == 0)
+                rects.append(QRect(x, y, 1, 1));
+
+    QRegion region;
+    foreach (const QRect &rect, rects)
+        region += rect;
+    return region;
+}
+
+void test_RegionMask::emptyMask()
+{
+    RegionMask mask;
+    QVERIFY(mask.isEmpty());
+    QVERIFY(!mask.contains(0, 0));
+    QVERIFY(mask.toRegion().isEmpty());
+
+    mask.add(QRect(3, 3, 10, 10));
+    mask.remove(QRect(0, 0, 20, 20));
+    QVERIFY(mask.isEmpty());
+}
+
+void test_RegionMask::containsMatchesRegion()
+{
+    const QRect area(0, 0, 70, 40);
+    const QRegion region = noisyRegion(area, 1);
+    const RegionMask mask(region);
+
+    for (int y = area.top() - 1; y <= area.bottom() + 1; ++y)
+        for (int x = area.left() - 1; x <= area.right() + 1; ++x)
+            QCOMPARE(mask.contains(x, y), region.contains(QPoint(x, y)));
+}
+
+void test_RegionMask::roundTrip()
+{
+    const QRegion region = noisyRegion(QRect(5, 7, 100, 50), 2);
+    QCOMPARE(RegionMask(region).toRegion(), region);
+
+    // Runs continuing across chunks are merged
+    const QRegion wide(QRect(10, 3, 100, 40));
+    QCOMPARE(RegionMask(wide).toRegion().rectCount(), 1);
+}
+
+void test_RegionMask::negativeCoordinates()
+{
+    const QRegion region = noisyRegion(QRect(-50, -40, 80, 60), 3);
+    const RegionMask mask(region);
+
+    QCOMPARE(mask.toRegion(), region);
+    QCOMPARE(mask.contains(-1, -1), region.contains(QPoint(-1, -1)));
+    QCOMPARE(mask.contains(-33, -32), region.contains(QPoint(-33, -32)));
+}
+
+void test_RegionMask::combineMatchesRegion()
+{
+    const QRegion a = noisyRegion(QRect(0, 0, 80, 80), 4);
+    const QRegion b = noisyRegion(QRect(20, 30, 80, 80), 5);
+
+    RegionMask united(a);
+    united |= RegionMask(b);
+    QCOMPARE(united.toRegion(), a.united(b));
+
+    RegionMask intersected(a);
+    intersected &= RegionMask(b);
+    QCOMPARE(intersected.toRegion(), a.intersected(b));
+
+    RegionMask subtracted(a);
+    subtracted -= RegionMask(b);
+    QCOMPARE(subtracted.toRegion(), a.subtracted(b));
+
+    RegionMask added(a);
+    added.add(b);
+    QCOMPARE(added.toRegion(), a.united(b));
+
+    RegionMask removed(a);
+    removed.remove(b);
+    QCOMPARE(removed.toRegion(), a.subtracted(b));
+}
+
+void test_RegionMask::intersected()
+{
+    const QRegion region = noisyRegion(QRect(0, 0, 60, 60), 6);
+    const RegionMask mask(region);
+    const QRect rect(10, 15, 40, 20);
+
+    QCOMPARE(mask.intersected(QRegion(rect)), region.intersected(rect));
+}
+
+void test_RegionMask::differenceBoundingRect()
+{
+    const QRegion a = noisyRegion(QRect(0, 0, 50, 50), 7);
+    QRegion b = a;
+    b += QRect(70, 3, 2, 2);
+    b -= QRect(4, 40, 5, 5);
+
+    QCOMPARE(RegionMask(a).differenceBoundingRect(RegionMask(b)),
+             a.xored(b).boundingRect());
+    QCOMPARE(RegionMask(a).differenceBoundingRect(RegionMask(a)), QRect());
+}
+
+void test_RegionMask::differenceChunks()
+{
+    const QRegion a = noisyRegion(QRect(0, 0, 50, 50), 7);
+    QRegion b = a;
+    b += QRect(70, 3, 2, 2);
+    b -= QRect(4, 40, 5, 5);
+
+    const int size = RegionMask::chunkSize();
+    QVector<QRect> chunks = RegionMask(a).differenceChunks(RegionMask(b));
+
+    QRegion chunkRegion;
+    foreach (const QRect &chunk, chunks) {
+        QCOMPARE(chunk.size(), QSize(size, size));
+        QCOMPARE(chunk.x() % size, 0);
+        QCOMPARE(chunk.y() % size, 0);
+        chunkRegion += chunk;
+    }
+
+    // The chunks cover the difference and nothing but chunks touching it
+    QVERIFY(a.xored(b).subtracted(chunkRegion).isEmpty());
+    QCOMPARE(chunks.size(), 2);
+
+    QVERIFY(RegionMask(a).differenceChunks(RegionMask(a)).isEmpty());
+}
+
+QTEST_MAIN(test_RegionMask)
+#include "test_regionmask.moc"
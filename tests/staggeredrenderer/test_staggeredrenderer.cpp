@@ -2,8 +2,10 @@
 #include "mapobject.h"
 #include "objectgroup.h"
 #include "tilelayer.h"
+#include "tileset.h"
 #include "staggeredrenderer.h"
 
+#include <QPainter>
 #include <QtTest/QtTest>
 
 using namespace Tiled;
@@ -29,10 +31,34 @@ private slots:
 
     void relativeCoordinates();
 
+    void drawTileLayer_data();
+    void drawTileLayer();
+
 private:
     Map *mMap;
 };
 
+Q_DECLARE_METATYPE(Map::StaggerAxis)
+
+/**
+ * Draws the tile layer of \a map within \a exposed into an image covering
+ * that same area.
+ */
+static QImage drawLayer(const Map *map, const QRect &exposed)
+{
+    StaggeredRenderer renderer(map);
+
+    QImage image(exposed.size(), QImage::Format_ARGB32_Premultiplied);
+    image.fill(0);
+
+    QPainter painter(&image);
+    painter.translate(-exposed.topLeft());
+    renderer.drawTileLayer(&painter,
+                           static_cast<const TileLayer*>(map->layerAt(0)),
+                           exposed);
+    return image;
+}
+
 void test_StaggeredRenderer::initTestCase()
 {
     mMap = new Map(Map::Staggered, 10, 10, 64, 32);
@@ -140,5 +166,62 @@ void test_StaggeredRenderer::relativeCoordinates()
     QCOMPARE(renderer.bottomRight(1, 1), QPoint(2, 2));
 }
 
+void test_StaggeredRenderer::drawTileLayer_data()
+{
+    QTest::addColumn<Map::StaggerAxis>("staggerAxis");
+    QTest::addColumn<int>("spacing");
+
+    QTest::newRow("y, full") << Map::StaggerY << 1;
+    QTest::newRow("y, sparse") << Map::StaggerY << 37;
+    QTest::newRow("x, full") << Map::StaggerX << 1;
+    QTest::newRow("x, sparse") << Map::StaggerX << 37;
+}
+
+/**
+ * Checks that drawing part of a layer gives the same result as drawing all
+ * of it, and measures how long drawing a viewport takes.
+ */
+void test_StaggeredRenderer::drawTileLayer()
+{
+    QFETCH(Map::StaggerAxis, staggerAxis);
+    QFETCH(int, spacing);
+
+    QImage image(64, 32, QImage::Format_ARGB32);
+    Tileset tileset(QLatin1String("tileset"), 64, 32);
+    for (int i = 0; i < 4; ++i) {
+        image.fill(qRgba(64 * i, 255 - 64 * i, 128, 200));
+        tileset.addTile(QPixmap::fromImage(image));
+    }
+
+    const int size = 64;
+    Map map(Map::Staggered, size, size, 64, 32);
+    map.setStaggerAxis(staggerAxis);
+
+    TileLayer *tileLayer = new TileLayer(QString(), 0, 0, size, size);
+    for (int i = 0; i < size * size; i += spacing)
+        tileLayer->setCell(i % size, i / size, Cell(tileset.tileAt(i % 4)));
+    map.addLayer(tileLayer);
+
+    StaggeredRenderer renderer(&map);
+    const QSize mapSize = renderer.mapSize();
+
+    // Compare a part of the map to the same area of the whole map
+    const QRect whole(QPoint(), mapSize);
+    const QRect part(mapSize.width() / 3 + 7, mapSize.height() / 3 + 5,
+                     800, 600);
+    QCOMPARE(drawLayer(&map, part),
+             drawLayer(&map, whole).copy(part));
+
+    QImage viewport(part.size(), QImage::Format_ARGB32_Premultiplied);
+
+    QBENCHMARK {
+        viewport.fill(0);
+
+        QPainter painter(&viewport);
+        painter.translate(-part.topLeft());
+        renderer.drawTileLayer(&painter, tileLayer, part);
+    }
+}
+
 QTEST_MAIN(test_StaggeredRenderer)
 #include "test_staggeredrenderer.moc"
@@ -1,4 +1,15 @@
 TEMPLATE=subdirs
 SUBDIRS = \
+    automapper \
+    benchmarks \
+    collisionmerger \
+    imagecache \
+    jobsystem \
     mapreader \
-    staggeredrenderer
+    maprenderer \
+    numberutils \
+    objectsearchindex \
+    regionmask \
+    staggeredrenderer \
+    tileatlas \
+    tilelayer
@@ -0,0 +1,115 @@
+#include "tile.h"
+#include "tileatlas.h"
+#include "tileset.h"
+
+#include <QtTest/QtTest>
+
+using namespace Tiled;
+
+class test_TileAtlas : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void packsWithoutOverlap();
+    void usesPowerOfTwoPages();
+    void rejectsOversizedTiles();
+    void rendersTiles();
+
+private:
+    Tileset *mTileset;
+};
+
+void test_TileAtlas::initTestCase()
+{
+    mTileset = new Tileset(QLatin1String("collection"), 0, 0);
+
+    // Tiles of varying sizes, like in an image collection
+    for (int i = 0; i < 40; ++i) {
+        QPixmap image(8 + (i * 7) % 57, 8 + (i * 13) % 45);
+        image.fill(QColor(i * 6, 255 - i * 6, 0));
+        mTileset->addTile(image);
+    }
+}
+
+void test_TileAtlas::cleanupTestCase()
+{
+    delete mTileset;
+    mTileset = 0;
+}
+
+void test_TileAtlas::packsWithoutOverlap()
+{
+    TileAtlas atlas(128, 1);
+    foreach (const Tile *tile, mTileset->tiles())
+        atlas.addTile(tile);
+    atlas.addTile(mTileset->tileAt(0));     // Ignored, already added
+
+    QVERIFY(atlas.pack());
+    QVERIFY(atlas.pageCount() > 1);
+
+    const QList<TileAtlas::Placement> &placements = atlas.placements();
+    QCOMPARE(placements.size(), mTileset->tileCount());
+
+    for (int i = 0; i < placements.size(); ++i) {
+        const TileAtlas::Placement &a = placements.at(i);
+        QCOMPARE(a.rect.size(), a.tile->size());
+
+        const QRect page(QPoint(), atlas.pageSize(a.page));
+        QVERIFY(page.contains(a.rect));
+
+        for (int j = i + 1; j < placements.size(); ++j) {
+            const TileAtlas::Placement &b = placements.at(j);
+            if (a.page == b.page)
+                QVERIFY(!a.rect.intersects(b.rect));
+        }
+    }
+}
+
+void test_TileAtlas::usesPowerOfTwoPages()
+{
+    TileAtlas atlas(1024, 0);
+    foreach (const Tile *tile, mTileset->tiles())
+        atlas.addTile(tile);
+
+    QVERIFY(atlas.pack());
+    QCOMPARE(atlas.pageCount(), 1);
+
+    const QSize size = atlas.pageSize(0);
+    QVERIFY(size.width() > 0 && (size.width() & (size.width() - 1)) == 0);
+    QVERIFY(size.height() > 0 && (size.height() & (size.height() - 1)) == 0);
+}
+
+void test_TileAtlas::rejectsOversizedTiles()
+{
+    TileAtlas atlas(32, 0);
+    atlas.addTile(mTileset->tileAt(1));     // 15x21
+    atlas.addTile(mTileset->tileAt(5));     // 43x28
+
+    QVERIFY(!atlas.pack());
+    QVERIFY(atlas.placements().isEmpty());
+}
+
+void test_TileAtlas::rendersTiles()
+{
+    TileAtlas atlas(256, 1);
+    atlas.addTile(mTileset->tileAt(3));
+    atlas.addTile(mTileset->tileAt(4));
+
+    QVERIFY(atlas.pack());
+
+    const QImage page = atlas.renderPage(0);
+    QCOMPARE(page.size(), atlas.pageSize(0));
+
+    foreach (const TileAtlas::Placement &placement, atlas.placements()) {
+        const QColor expected = placement.tile->image().toImage()
+                .pixel(0, 0);
+        QCOMPARE(QColor(page.pixel(placement.rect.topLeft())), expected);
+    }
+}
+
+QTEST_MAIN(test_TileAtlas)
+#include "test_tileatlas.moc"
@@ -0,0 +1,824 @@
+#include "packedcell.h"
+#include "tile.h"
+#include "tilelayer.h"
+#include "tileset.h"
+
+#include <QtTest/QtTest>
+
+using namespace Tiled;
+
+class test_TileLayer : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void emptyLayer();
+    void setCellAcrossChunks();
+    void regionSpanningChunks();
+    void hasCellMatchingEmpty();
+    void rotateAndFlip();
+    void resize();
+    void packedCell();
+    void copyAndSetCells();
+    void computeDiffRegion();
+    void mergeMatchesCellByCell();
+    void setCellsMatchesCellByCell();
+    void rotateAndFlipRoundTrip();
+    void offsetMatchesCellByCell_data();
+    void offsetMatchesCellByCell();
+    void tilesetReferences();
+    void revision();
+    void emptyChunks();
+    void cellRow();
+    void tileRegion();
+    void tileUsage();
+    void recomputeDrawMargins();
+    void drawMarginsInArea();
+    void contentBounds();
+    void memoryUsage();
+    void chunkHash();
+    void shareEqualChunks();
+
+private:
+    void fillRandomly(TileLayer &layer, int seed);
+    static bool sameCells(const TileLayer &a, const TileLayer &b);
+
+    Tileset *mTileset;
+};
+
+void test_TileLayer::initTestCase()
+{
+    mTileset = new Tileset(QLatin1String("tileset"), 32, 32);
+    mTileset->addTile(QPixmap(32, 32));
+    mTileset->addTile(QPixmap(32, 32));
+}
+
+void test_TileLayer::cleanupTestCase()
+{
+    delete mTileset;
+    mTileset = 0;
+}
+
+void test_TileLayer::emptyLayer()
+{
+    TileLayer layer(QString(), 0, 0, 100, 37);
+
+    QVERIFY(layer.isEmpty());
+    QVERIFY(layer.region().isEmpty());
+    QVERIFY(layer.cellAt(99, 36).isEmpty());
+    QVERIFY(layer.usedTilesets().isEmpty());
+
+    // Setting an empty cell should not make the layer non-empty
+    layer.setCell(50, 20, Cell());
+    QVERIFY(layer.isEmpty());
+}
+
+void test_TileLayer::setCellAcrossChunks()
+{
+    TileLayer layer(QString(), 0, 0, 100, 37);
+    const Cell cell(mTileset->tileAt(0));
+
+    for (int x = 0; x < 100; x += 7)
+        layer.setCell(x, x % 37, cell);
+
+    QVERIFY(!layer.isEmpty());
+
+    for (int y = 0; y < 37; ++y)
+        for (int x = 0; x < 100; ++x)
+            QCOMPARE(layer.cellAt(x, y) == cell, x % 7 == 0 && x % 37 == y);
+
+    QVERIFY(layer.referencesTileset(mTileset));
+    QCOMPARE(layer.usedTilesets().size(), 1);
+
+    layer.removeReferencesToTileset(mTileset);
+    QVERIFY(layer.isEmpty());
+}
+
+void test_TileLayer::regionSpanningChunks()
+{
+    TileLayer layer(QString(), 3, 4, 100, 37);
+    const Cell cell(mTileset->tileAt(0));
+
+    for (int x = 10; x < 60; ++x)
+        layer.setCell(x, 20, cell);
+    layer.setCell(99, 36, cell);
+
+    QRegion expected = QRect(13, 24, 50, 1);
+    expected += QRect(102, 40, 1, 1);
+
+    QCOMPARE(layer.region(), expected);
+}
+
+static bool cellIsEmpty(const Cell &cell) { return cell.isEmpty(); }
+
+void test_TileLayer::hasCellMatchingEmpty()
+{
+    TileLayer layer(QString(), 0, 0, 20, 20);
+
+    for (int y = 0; y < 20; ++y)
+        for (int x = 0; x < 20; ++x)
+            layer.setCell(x, y, Cell(mTileset->tileAt(0)));
+
+    // The parts of the chunks outside of the layer should not count
+    QVERIFY(!layer.hasCell(cellIsEmpty));
+    QVERIFY(layer.region(cellIsEmpty).isEmpty());
+
+    layer.setCell(19, 0, Cell());
+    QVERIFY(layer.hasCell(cellIsEmpty));
+    QCOMPARE(layer.region(cellIsEmpty), QRegion(19, 0, 1, 1));
+}
+
+void test_TileLayer::rotateAndFlip()
+{
+    TileLayer layer(QString(), 0, 0, 40, 20);
+    const Cell cell(mTileset->tileAt(1));
+    layer.setCell(2, 3, cell);
+
+    layer.rotate(RotateRight);
+    QCOMPARE(layer.size(), QSize(20, 40));
+    QCOMPARE(layer.cellAt(20 - 3 - 1, 2).tile, cell.tile);
+    QVERIFY(layer.cellAt(20 - 3 - 1, 2).flippedAntiDiagonally);
+
+    layer.rotate(RotateLeft);
+    QCOMPARE(layer.size(), QSize(40, 20));
+    QVERIFY(layer.cellAt(2, 3) == cell);
+
+    layer.flip(FlipHorizontally);
+    QCOMPARE(layer.cellAt(40 - 2 - 1, 3).tile, cell.tile);
+    QVERIFY(layer.cellAt(40 - 2 - 1, 3).flippedHorizontally);
+    QVERIFY(layer.cellAt(2, 3).isEmpty());
+}
+
+void test_TileLayer::resize()
+{
+    TileLayer layer(QString(), 0, 0, 40, 20);
+    const Cell cell(mTileset->tileAt(0));
+    layer.setCell(2, 3, cell);
+    layer.setCell(35, 15, cell);
+
+    layer.resize(QSize(17, 50), QPoint(5, 30));
+
+    QCOMPARE(layer.size(), QSize(17, 50));
+    QVERIFY(layer.cellAt(7, 33) == cell);
+    QCOMPARE(layer.region(), QRegion(7, 33, 1, 1));
+}
+
+void test_TileLayer::packedCell()
+{
+    CellPacker packer;
+    PackedCell packed;
+
+    QVERIFY(packer.pack(Cell(), packed));
+    QVERIFY(packed.isEmpty());
+    QVERIFY(packer.unpack(packed) == Cell());
+
+    Cell cell(mTileset->tileAt(1));
+    cell.flippedVertically = true;
+    cell.flippedAntiDiagonally = true;
+
+    QVERIFY(packer.pack(cell, packed));
+    QVERIFY(!packed.isEmpty());
+    QCOMPARE(packed.tilesetIndex(), 0);
+    QCOMPARE(packed.tileId(), 1);
+    QCOMPARE(packer.tileAt(packed), cell.tile);
+    QVERIFY(packer.unpack(packed) == cell);
+    QCOMPARE(packer.tilesets().size(), 1);
+}
+
+void test_TileLayer::copyAndSetCells()
+{
+    TileLayer layer(QString(), 0, 0, 64, 64);
+    const Cell cell(mTileset->tileAt(0));
+    const Cell otherCell(mTileset->tileAt(1));
+
+    for (int y = 0; y < 64; ++y)
+        for (int x = 0; x < 64; ++x)
+            layer.setCell(x, y, cell);
+
+    // Both chunk-aligned and unaligned areas should be copied correctly
+    const QRegion region = QRegion(16, 16, 32, 32) + QRegion(3, 5, 7, 2);
+    TileLayer *copied = layer.copy(region);
+
+    QCOMPARE(copied->size(), QSize(45, 43));
+    QCOMPARE(copied->region(), region.translated(-3, -5));
+
+    // Modifying the original should not affect the copy
+    layer.erase(QRegion(0, 0, 64, 64));
+    layer.setCell(20, 20, otherCell);
+    QVERIFY(copied->cellAt(20 - 3, 20 - 5) == cell);
+
+    // Setting the cells back should restore the copied area
+    layer.setCells(3, 5, copied, region);
+    QCOMPARE(layer.region(), region);
+    QVERIFY(layer.cellAt(20, 20) == cell);
+
+    delete copied;
+}
+
+void test_TileLayer::computeDiffRegion()
+{
+    TileLayer layer(QString(), 0, 0, 50, 50);
+    const Cell cell(mTileset->tileAt(0));
+    const Cell otherCell(mTileset->tileAt(1));
+
+    for (int y = 0; y < 50; ++y)
+        for (int x = 0; x < 50; ++x)
+            layer.setCell(x, y, cell);
+
+    TileLayer *changed = static_cast<TileLayer*>(layer.clone());
+    QVERIFY(layer.computeDiffRegion(changed).isEmpty());
+
+    for (int y = 10; y < 30; ++y)
+        for (int x = 12; x < 40; ++x)
+            changed->setCell(x, y, otherCell);
+    changed->setCell(49, 49, Cell());
+
+    QRegion expected = QRegion(12, 10, 28, 20) + QRegion(49, 49, 1, 1);
+    QCOMPARE(layer.computeDiffRegion(changed), expected);
+
+    // An offset layer compares against the overlapping part only
+    changed->setPosition(12, 10);
+    QCOMPARE(layer.computeDiffRegion(changed), QRegion(24, 20, 26, 20));
+
+    delete changed;
+}
+
+void test_TileLayer::fillRandomly(TileLayer &layer, int seed)
+{
+    qsrand(seed);
+
+    for (int y = 0; y < layer.height(); ++y) {
+        for (int x = 0; x < layer.width(); ++x) {
+            const int r = qrand() % 3;
+            Cell cell;
+            if (r > 0) {
+                cell.tile = mTileset->tileAt(r - 1);
+                cell.flippedHorizontally = qrand() % 2;
+            }
+            layer.setCell(x, y, cell);
+        }
+    }
+}
+
+bool test_TileLayer::sameCells(const TileLayer &a, const TileLayer &b)
+{
+    if (a.size() != b.size())
+        return false;
+
+    for (int y = 0; y < a.height(); ++y)
+        for (int x = 0; x < a.width(); ++x)
+            if (a.cellAt(x, y) != b.cellAt(x, y))
+                return false;
+
+    return true;
+}
+
+void test_TileLayer::mergeMatchesCellByCell()
+{
+    TileLayer source(QString(), 0, 0, 37, 21);
+    fillRandomly(source, 1);
+
+    const QPoint positions[] = {
+        QPoint(0, 0), QPoint(5, 3), QPoint(16, 16), QPoint(60, 40)
+    };
+
+    for (unsigned i = 0; i < sizeof(positions) / sizeof(positions[0]); ++i) {
+        const QPoint pos = positions[i];
+
+        TileLayer layer(QString(), 0, 0, 70, 50);
+        fillRandomly(layer, 2);
+        TileLayer *expected = static_cast<TileLayer*>(layer.clone());
+
+        for (int y = 0; y < source.height(); ++y) {
+            for (int x = 0; x < source.width(); ++x) {
+                const Cell &cell = source.cellAt(x, y);
+                if (!cell.isEmpty() && expected->contains(x + pos.x(), y + pos.y()))
+                    expected->setCell(x + pos.x(), y + pos.y(), cell);
+            }
+        }
+
+        layer.merge(pos, &source);
+        QVERIFY(sameCells(layer, *expected));
+        delete expected;
+    }
+}
+
+void test_TileLayer::setCellsMatchesCellByCell()
+{
+    TileLayer source(QString(), 0, 0, 40, 33);
+    fillRandomly(source, 3);
+
+    const QPoint positions[] = {
+        QPoint(0, 0), QPoint(7, 2), QPoint(16, 32), QPoint(-5, -9)
+    };
+    const QRegion mask = QRegion(3, 3, 30, 20) + QRegion(0, 30, 64, 2);
+
+    for (unsigned i = 0; i < sizeof(positions) / sizeof(positions[0]); ++i) {
+        const QPoint pos = positions[i];
+
+        for (int masked = 0; masked < 2; ++masked) {
+            TileLayer layer(QString(), 0, 0, 64, 64);
+            fillRandomly(layer, 4);
+            TileLayer *expected = static_cast<TileLayer*>(layer.clone());
+
+            for (int y = 0; y < source.height(); ++y) {
+                for (int x = 0; x < source.width(); ++x) {
+                    const QPoint p(x + pos.x(), y + pos.y());
+                    if (!expected->contains(p))
+                        continue;
+                    if (masked && !mask.contains(p))
+                        continue;
+                    expected->setCell(p.x(), p.y(), source.cellAt(x, y));
+                }
+            }
+
+            layer.setCells(pos.x(), pos.y(), &source,
+                           masked ? mask : QRegion());
+            QVERIFY(sameCells(layer, *expected));
+
+            // Copying an area and setting it back should change nothing
+            const QRegion area = mask.translated(pos);
+            TileLayer *copied = layer.copy(area);
+            const QRect bounds = area.boundingRect();
+            layer.setCells(bounds.x(), bounds.y(), copied, area);
+            QVERIFY(sameCells(layer, *expected));
+
+            delete copied;
+            delete expected;
+        }
+    }
+}
+
+void test_TileLayer::rotateAndFlipRoundTrip()
+{
+    TileLayer original(QString(), 0, 0, 37, 21);
+    fillRandomly(original, 5);
+
+    TileLayer *layer = static_cast<TileLayer*>(original.clone());
+
+    layer->rotate(RotateRight);
+    QCOMPARE(layer->size(), QSize(21, 37));
+    QVERIFY(layer->cellAt(20, 0).tile == original.cellAt(0, 0).tile);
+    QVERIFY(layer->cellAt(0, 36).tile == original.cellAt(36, 20).tile);
+
+    for (int i = 0; i < 3; ++i)
+        layer->rotate(RotateRight);
+    QVERIFY(sameCells(*layer, original));
+
+    layer->rotate(RotateLeft);
+    QVERIFY(layer->cellAt(0, 36).tile == original.cellAt(0, 0).tile);
+    layer->rotate(RotateRight);
+    QVERIFY(sameCells(*layer, original));
+
+    layer->flip(FlipVertically);
+    QVERIFY(layer->cellAt(3, 20).tile == original.cellAt(3, 0).tile);
+    layer->flip(FlipVertically);
+    layer->flip(FlipHorizontally);
+    layer->flip(FlipHorizontally);
+    QVERIFY(sameCells(*layer, original));
+
+    delete layer;
+}
+
+void test_TileLayer::offsetMatchesCellByCell_data()
+{
+    QTest::addColumn<QPoint>("offset");
+    QTest::addColumn<QRect>("bounds");
+    QTest::addColumn<bool>("wrapX");
+    QTest::addColumn<bool>("wrapY");
+
+    const QRect all(0, 0, 100, 70);
+    const QRect part(10, 5, 60, 50);
+
+    QTest::newRow("aligned") << QPoint(32, -64) << all << false << false;
+    QTest::newRow("unaligned") << QPoint(7, 3) << all << false << false;
+    QTest::newRow("wrap aligned") << QPoint(32, 32) << all << true << true;
+    QTest::newRow("wrap unaligned") << QPoint(-45, 130) << all << true << true;
+    QTest::newRow("wrap x") << QPoint(20, 9) << all << true << false;
+    QTest::newRow("part") << QPoint(-3, 11) << part << false << false;
+    QTest::newRow("part wrap") << QPoint(33, -21) << part << true << true;
+    QTest::newRow("outside") << QPoint(5, 5) << QRect(90, 60, 30, 30) << true << false;
+}
+
+void test_TileLayer::offsetMatchesCellByCell()
+{
+    QFETCH(QPoint, offset);
+    QFETCH(QRect, bounds);
+    QFETCH(bool, wrapX);
+    QFETCH(bool, wrapY);
+
+    TileLayer original(QString(), 0, 0, 100, 70);
+    fillRandomly(original, 7);
+
+    TileLayer expected(QString(), 0, 0, 100, 70);
+    for (int y = 0; y < expected.height(); ++y) {
+        for (int x = 0; x < expected.width(); ++x) {
+            if (!bounds.contains(x, y)) {
+                expected.setCell(x, y, original.cellAt(x, y));
+                continue;
+            }
+
+            int oldX = x - offset.x();
+            int oldY = y - offset.y();
+            if (wrapX) {
+                while (oldX < bounds.left())
+                    oldX += bounds.width();
+                while (oldX > bounds.right())
+                    oldX -= bounds.width();
+            }
+            if (wrapY) {
+                while (oldY < bounds.top())
+                    oldY += bounds.height();
+                while (oldY > bounds.bottom())
+                    oldY -= bounds.height();
+            }
+
+            if (original.contains(oldX, oldY) && bounds.contains(oldX, oldY))
+                expected.setCell(x, y, original.cellAt(oldX, oldY));
+        }
+    }
+
+    TileLayer *layer = static_cast<TileLayer*>(original.clone());
+    layer->offset(offset, bounds, wrapX, wrapY);
+    QVERIFY(sameCells(*layer, expected));
+    QVERIFY(layer->usedTilesets() == expected.usedTilesets());
+
+    // The original chunks are not affected
+    TileLayer unchanged(QString(), 0, 0, 100, 70);
+    fillRandomly(unchanged, 7);
+    QVERIFY(sameCells(original, unchanged));
+
+    delete layer;
+}
+
+void test_TileLayer::tilesetReferences()
+{
+    Tileset otherTileset(QLatin1String("other"), 32, 32);
+    otherTileset.addTile(QPixmap(32, 32));
+
+    TileLayer layer(QString(), 0, 0, 40, 40);
+    fillRandomly(layer, 6);
+    layer.setCell(35, 35, Cell(otherTileset.tileAt(0)));
+
+    QCOMPARE(layer.usedTilesets().size(), 2);
+    QVERIFY(layer.referencesTileset(&otherTileset));
+
+    // Copies keep their own counts
+    TileLayer *copied = layer.copy(QRegion(0, 0, 32, 32));
+    QCOMPARE(copied->usedTilesets().size(), 1);
+    QVERIFY(!copied->referencesTileset(&otherTileset));
+
+    layer.erase(QRegion(30, 30, 10, 10));
+    QVERIFY(!layer.referencesTileset(&otherTileset));
+
+    layer.setCells(8, 8, copied);
+    layer.resize(QSize(20, 20), QPoint(-4, -4));
+    layer.replaceReferencesToTileset(mTileset, &otherTileset);
+    QCOMPARE(layer.usedTilesets().size(), 1);
+    QVERIFY(layer.referencesTileset(&otherTileset));
+    QVERIFY(!layer.referencesTileset(mTileset));
+
+    layer.removeReferencesToTileset(&otherTileset);
+    QVERIFY(layer.isEmpty());
+    QVERIFY(layer.region().isEmpty());
+
+    delete copied;
+}
+
+void test_TileLayer::revision()
+{
+    TileLayer layer(QString(), 0, 0, 40, 40);
+    const Cell cell(mTileset->tileAt(0));
+
+    const unsigned initial = layer.revision();
+    QVERIFY(initial != 0);
+    QCOMPARE(layer.revision(), initial);
+    QVERIFY(layer.cellAt(5, 5).isEmpty());
+    QCOMPARE(layer.revision(), initial);
+
+    layer.setCell(5, 5, cell);
+    const unsigned painted = layer.revision();
+    QVERIFY(painted != initial);
+
+    // Clones share the revision until either of them changes
+    TileLayer *clone = static_cast<TileLayer*>(layer.clone());
+    QCOMPARE(clone->revision(), painted);
+
+    clone->erase(QRegion(0, 0, 16, 16));
+    QVERIFY(clone->revision() != painted);
+    QCOMPARE(layer.revision(), painted);
+
+    layer.setCells(0, 0, clone);
+    QVERIFY(layer.revision() != painted);
+
+    const unsigned beforeFlip = layer.revision();
+    layer.flip(TileLayer::FlipHorizontally);
+    QVERIFY(layer.revision() != beforeFlip);
+
+    delete clone;
+}
+
+void test_TileLayer::emptyChunks()
+{
+    TileLayer layer(QString(), 0, 0, 40, 40);
+    layer.setCell(20, 5, Cell(mTileset->tileAt(0)));
+
+    QCOMPARE(layer.emptyChunkAt(0, 0), QRect(0, 0, 16, 16));
+    QVERIFY(layer.emptyChunkAt(20, 5).isNull());
+    QVERIFY(layer.emptyChunkAt(31, 15).isNull());
+
+    // Chunks along the edges are clipped to the layer
+    QCOMPARE(layer.emptyChunkAt(37, 37), QRect(32, 32, 8, 8));
+}
+
+void test_TileLayer::cellRow()
+{
+    TileLayer layer(QString(), 0, 0, 40, 40);
+    layer.setCell(20, 5, Cell(mTileset->tileAt(0)));
+    layer.setCell(21, 5, Cell(mTileset->tileAt(1)));
+
+    // No cells are returned for parts of rows without tiles
+    int count;
+    QVERIFY(!layer.cellRow(0, 5, &count));
+    QCOMPARE(count, 16);
+
+    // Rows run up to the end of their chunk
+    const Cell *cells = layer.cellRow(18, 5, &count);
+    QVERIFY(cells);
+    QCOMPARE(count, 14);
+    QVERIFY(cells[0].isEmpty());
+    QCOMPARE(cells[2].tile, mTileset->tileAt(0));
+    QCOMPARE(cells[3].tile, mTileset->tileAt(1));
+
+    // And are clipped to the layer
+    QVERIFY(!layer.cellRow(35, 5, &count));
+    QCOMPARE(count, 5);
+}
+
+namespace {
+
+struct ShowsTile
+{
+    explicit ShowsTile(const Tile *tile) : mTile(tile) {}
+    bool operator() (const Cell &cell) const { return cell.tile == mTile; }
+    const Tile *mTile;
+};
+
+} // anonymous namespace
+
+void test_TileLayer::tileRegion()
+{
+    TileLayer layer(QString(), 0, 0, 100, 100);
+    fillRandomly(layer, 7);
+
+    Tile *tile = mTileset->tileAt(0);
+    const QList<Tile*> tiles = QList<Tile*>() << tile;
+    const ShowsTile showsTile(tile);
+
+    QCOMPARE(layer.tileRegion(tiles), layer.region(showsTile));
+
+    // The index is kept up to date while setting cells
+    for (int i = 0; i < 20; ++i)
+        layer.setCell(i * 5, 50, Cell(mTileset->tileAt(i % 2)));
+    layer.setCell(99, 99, Cell());
+
+    QCOMPARE(layer.tileRegion(tiles), layer.region(showsTile));
+    QVERIFY(layer.referencesAnyTile(tiles));
+
+    // And rebuilt after other changes
+    layer.erase(QRegion(0, 0, 50, 50));
+    QCOMPARE(layer.tileRegion(tiles), layer.region(showsTile));
+
+    layer.erase(QRegion(0, 0, 100, 100));
+    QVERIFY(!layer.referencesAnyTile(tiles));
+    QVERIFY(layer.tileRegion(tiles).isEmpty());
+}
+
+/**
+ * Counts the cells showing \a tile by looking at all of them.
+ */
+static int countCells(const TileLayer &layer, Tile *tile)
+{
+    int count = 0;
+    for (int y = 0; y < layer.height(); ++y)
+        for (int x = 0; x < layer.width(); ++x)
+            if (layer.cellAt(x, y).tile == tile)
+                ++count;
+    return count;
+}
+
+void test_TileLayer::tileUsage()
+{
+    TileLayer layer(QString(), 0, 0, 100, 100);
+    QCOMPARE(layer.usedCellCount(), 0);
+    QVERIFY(layer.tilesetUsage().isEmpty());
+    QVERIFY(layer.tileUsage().isEmpty());
+
+    fillRandomly(layer, 11);
+
+    Tile *tile0 = mTileset->tileAt(0);
+    Tile *tile1 = mTileset->tileAt(1);
+    QHash<Tile*, int> usage = layer.tileUsage();
+    QCOMPARE(usage.value(tile0), countCells(layer, tile0));
+    QCOMPARE(usage.value(tile1), countCells(layer, tile1));
+    QCOMPARE(layer.usedCellCount(), usage.value(tile0) + usage.value(tile1));
+    QCOMPARE(layer.tilesetUsage().value(mTileset), layer.usedCellCount());
+
+    // The counts follow the cells as they are changed
+    for (int i = 0; i < 20; ++i)
+        layer.setCell(i * 5, 50, Cell(mTileset->tileAt(i % 2)));
+    layer.setCell(99, 99, Cell());
+    layer.erase(QRegion(0, 0, 30, 30));
+
+    usage = layer.tileUsage();
+    QCOMPARE(usage.value(tile0), countCells(layer, tile0));
+    QCOMPARE(usage.value(tile1), countCells(layer, tile1));
+    QCOMPARE(layer.usedCellCount(), usage.value(tile0) + usage.value(tile1));
+
+    layer.erase(QRegion(0, 0, 100, 100));
+    QCOMPARE(layer.usedCellCount(), 0);
+    QVERIFY(layer.tileUsage().isEmpty());
+}
+
+void test_TileLayer::recomputeDrawMargins()
+{
+    Tileset tallTileset(QLatin1String("tall"), 32, 64);
+    tallTileset.addTile(QPixmap(32, 64));
+    tallTileset.setTileOffset(QPoint(3, -4));
+
+    TileLayer layer(QString(), 0, 0, 100, 100);
+    layer.recomputeDrawMargins();
+    QCOMPARE(layer.drawMargins(), QMargins());
+
+    Cell cell(tallTileset.tileAt(0));
+    cell.flippedAntiDiagonally = true;
+    layer.setCell(5, 5, cell);
+    layer.recomputeDrawMargins();
+    QCOMPARE(layer.maxTileSize(), QSize(64, 32));
+    QCOMPARE(layer.drawMargins(), QMargins(0, 36, 67, 0));
+
+    // Rotating swaps the size back
+    layer.rotate(RotateRight);
+    layer.recomputeDrawMargins();
+    QCOMPARE(layer.maxTileSize(), QSize(32, 64));
+
+    // Only the tilesets that are still used are taken into account
+    layer.setCell(0, 0, Cell(mTileset->tileAt(0)));
+    layer.erase(QRegion(0, 0, 100, 100).subtracted(QRegion(0, 0, 1, 1)));
+    layer.recomputeDrawMargins();
+    QCOMPARE(layer.maxTileSize(), QSize(32, 32));
+    QCOMPARE(layer.drawMargins(), QMargins(0, 32, 32, 0));
+}
+
+void test_TileLayer::drawMarginsInArea()
+{
+    Tileset tallTileset(QLatin1String("tall"), 32, 64);
+    tallTileset.addTile(QPixmap(32, 64));
+
+    TileLayer layer(QString(), 0, 0, 100, 100);
+    layer.setCell(5, 5, Cell(mTileset->tileAt(0)));
+    layer.setCell(80, 80, Cell(tallTileset.tileAt(0)));
+    QCOMPARE(layer.drawMargins(), QMargins(0, 64, 32, 0));
+
+    // Only the chunks overlapping the area are taken into account
+    QCOMPARE(layer.drawMargins(QRect(0, 0, 10, 10)), QMargins(0, 32, 32, 0));
+    QCOMPARE(layer.drawMargins(QRect(70, 70, 20, 20)), QMargins(0, 64, 32, 0));
+    QCOMPARE(layer.drawMargins(QRect(40, 0, 10, 10)), QMargins());
+
+    // The margins remain after clearing, so the removed tile gets repainted
+    layer.erase(QRegion(80, 80, 1, 1));
+    QCOMPARE(layer.drawMargins(QRect(80, 80, 1, 1)), QMargins(0, 64, 32, 0));
+}
+
+void test_TileLayer::contentBounds()
+{
+    TileLayer layer(QString(), 0, 0, 100, 100);
+    QVERIFY(layer.contentBounds().isEmpty());
+
+    layer.setCell(20, 30, Cell(mTileset->tileAt(0)));
+    layer.setCell(25, 70, Cell(mTileset->tileAt(1)));
+    QCOMPARE(layer.contentBounds(), QRect(20, 30, 6, 41));
+
+    // A cell inside the bounds doesn't change them
+    layer.setCell(22, 50, Cell(mTileset->tileAt(0)));
+    QCOMPARE(layer.contentBounds(), QRect(20, 30, 6, 41));
+
+    // The bounds shrink again after erasing the outer cells
+    layer.erase(QRegion(25, 70, 1, 1));
+    QCOMPARE(layer.contentBounds(), QRect(20, 30, 3, 21));
+
+    // Clones share the cached bounds until either is changed
+    TileLayer *clone = static_cast<TileLayer*>(layer.clone());
+    QCOMPARE(clone->contentBounds(), QRect(20, 30, 3, 21));
+    clone->setCell(99, 99, Cell(mTileset->tileAt(0)));
+    QCOMPARE(clone->contentBounds(), QRect(20, 30, 80, 70));
+    QCOMPARE(layer.contentBounds(), QRect(20, 30, 3, 21));
+    delete clone;
+
+    layer.erase(QRegion(0, 0, 100, 100));
+    QVERIFY(layer.contentBounds().isEmpty());
+}
+
+void test_TileLayer::memoryUsage()
+{
+    TileLayer layer(QString(), 0, 0, 100, 37);
+    const qint64 emptyUsage = layer.memoryUsage();
+    const qint64 chunkUsage = CHUNK_SIZE * CHUNK_SIZE * sizeof(Cell);
+
+    // Only chunks that contain tiles take memory for their cells
+    layer.setCell(50, 20, Cell(mTileset->tileAt(0)));
+    QCOMPARE(layer.memoryUsage(), emptyUsage + chunkUsage);
+
+    layer.setCell(51, 20, Cell(mTileset->tileAt(1)));
+    QCOMPARE(layer.memoryUsage(), emptyUsage + chunkUsage);
+
+    layer.setCell(0, 0, Cell(mTileset->tileAt(1)));
+    QCOMPARE(layer.memoryUsage(), emptyUsage + 2 * chunkUsage);
+}
+
+void test_TileLayer::chunkHash()
+{
+    TileLayer layer(QString(), 0, 0, 40, 40);
+    const quint64 emptyHash = layer.chunkHash(5, 5);
+    const quint64 emptyLayerHash = layer.contentHash();
+    QCOMPARE(layer.chunkHash(20, 20), emptyHash);
+
+    // Changing a cell only changes the hash of its own chunk
+    layer.setCell(5, 5, Cell(mTileset->tileAt(0)));
+    const quint64 paintedHash = layer.chunkHash(5, 5);
+    QVERIFY(paintedHash != emptyHash);
+    QCOMPARE(layer.chunkHash(20, 20), emptyHash);
+    QVERIFY(layer.contentHash() != emptyLayerHash);
+
+    // The position and the flags of the cell are part of the hash
+    TileLayer other(QString(), 0, 0, 40, 40);
+    other.setCell(6, 5, Cell(mTileset->tileAt(0)));
+    QVERIFY(other.chunkHash(6, 5) != paintedHash);
+
+    Cell flipped(mTileset->tileAt(0));
+    flipped.flippedHorizontally = true;
+    other.setCell(6, 5, Cell());
+    other.setCell(5, 5, flipped);
+    QVERIFY(other.chunkHash(5, 5) != paintedHash);
+
+    other.setCell(5, 5, Cell(mTileset->tileAt(0)));
+    QCOMPARE(other.chunkHash(5, 5), paintedHash);
+    QCOMPARE(other.contentHash(), layer.contentHash());
+
+    // Comparing the hashes finds the same differences as comparing cells
+    QVERIFY(layer.computeDiffRegion(&other, true).isEmpty());
+    other.setCell(30, 30, Cell(mTileset->tileAt(1)));
+    QCOMPARE(layer.computeDiffRegion(&other, true), QRegion(30, 30, 1, 1));
+    QCOMPARE(layer.computeDiffRegion(&other, true),
+             layer.computeDiffRegion(&other));
+    other.setCell(30, 30, Cell());
+
+    // Clones have the same hashes until either of them changes
+    TileLayer *clone = static_cast<TileLayer*>(layer.clone());
+    QCOMPARE(clone->chunkHash(5, 5), paintedHash);
+
+    clone->merge(QPoint(0, 0), &other);
+    QCOMPARE(clone->chunkHash(5, 5), paintedHash);
+
+    // An allocated chunk without tiles has the same hash as an empty one
+    clone->erase(QRegion(5, 5, 1, 1));
+    QCOMPARE(clone->chunkHash(5, 5), emptyHash);
+    QCOMPARE(clone->contentHash(), emptyLayerHash);
+    QCOMPARE(layer.chunkHash(5, 5), paintedHash);
+
+    delete clone;
+}
+
+void test_TileLayer::shareEqualChunks()
+{
+    // A stamp of two by two chunks, placed four times at the same alignment
+    TileLayer stamp(QString(), 0, 0, 2 * CHUNK_SIZE, 2 * CHUNK_SIZE);
+    fillRandomly(stamp, 7);
+
+    TileLayer layer(QString(), 0, 0, 8 * CHUNK_SIZE, 2 * CHUNK_SIZE);
+    for (int i = 0; i < 4; ++i)
+        layer.merge(QPoint(i * 2 * CHUNK_SIZE, 0), &stamp);
+
+    TileLayer *expected = static_cast<TileLayer*>(layer.clone());
+    const qint64 chunkUsage = CHUNK_SIZE * CHUNK_SIZE * sizeof(Cell);
+    const qint64 usage = layer.memoryUsage();
+
+    QCOMPARE(layer.shareEqualChunks(), 12);
+    QCOMPARE(layer.memoryUsage(), usage - 12 * chunkUsage);
+    QVERIFY(layer.computeDiffRegion(expected).isEmpty());
+
+    // Changing a shared chunk leaves the others alone
+    Cell cell = expected->cellAt(0, 0);
+    cell.tile = cell.isEmpty() ? mTileset->tileAt(0) : 0;
+    layer.setCell(0, 0, cell);
+    QCOMPARE(layer.computeDiffRegion(expected), QRegion(0, 0, 1, 1));
+    QCOMPARE(layer.cellAt(2 * CHUNK_SIZE, 0), expected->cellAt(0, 0));
+
+    delete expected;
+}
+
+QTEST_MAIN(test_TileLayer)
+#include "test_tilelayer.moc"
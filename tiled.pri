@@ -19,6 +19,11 @@ win32-g++* {
 
 CONFIG += depend_includepath
 
+# Tracing support can be compiled out by passing DISABLE_TRACING=yes to qmake
+contains(DISABLE_TRACING, yes) {
+    DEFINES += TILED_NO_TRACING
+}
+
 !isEmpty(USE_FHS_PLUGIN_PATH) {
     DEFINES += TILED_PLUGIN_DIR=\\\"$${LIBDIR}/tiled/plugins/\\\"
 }